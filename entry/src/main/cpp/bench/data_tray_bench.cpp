@@ -0,0 +1,267 @@
+/**
+ * data_tray_bench.cpp — seqlock 槽位 SensorDataTray vs 单把 mutex + unordered_map
+ *
+ * 校验：带类型的值写入后按类型读回、字符串形式与 ArkTS 原先的 toString() 一致；
+ * 快照默认值 / 可选字段；TTL 衰减与 setTTL（先于写入、clear() 后保留）；超长字符串按 UTF-8 截断；
+ * 多个写线程反复写同一批槽位时，读线程看到的每个槽位都是某一次完整写入（无撕裂）；
+ * 64 个槽位占满后新 key 的 put() 返回 false。
+ * 然后在后台写线程持续 put 的情况下对比 getSnapshot 耗时。
+ *
+ * 用法: data_tray_bench [--ms N] [--check-only]
+ */
+#include "data_tray/data_tray.h"
+#include "perf_harness.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using data_tray::SensorDataTray;
+using data_tray::TrayValue;
+using data_tray::TrayValueType;
+using perf::elapsedMs;
+using perf::check;
+
+namespace {
+
+const char* const SNAPSHOT_KEYS[] = {"timeOfDay", "hour", "dayOfWeek", "isWeekend", "motionState",
+                                     "batteryLevel", "isCharging", "networkType", "geofence", "wifiSsid",
+                                     "wifiLostWork", "cellId", "latitude", "longitude", "stepCount"};
+
+// ============================================================
+// 原实现：一把 mutex 保护 unordered_map，getSnapshot 每个 key 查一次表、取一次时钟
+// ============================================================
+
+class LegacyTray {
+public:
+    void put(const std::string& key, const std::string& value, double quality, const std::string& source) {
+        std::lock_guard<std::mutex> lock(mu_);
+        slots_[key] = Slot{key, value, nowMs(), data_tray::getDefaultTTL(key), quality, source};
+    }
+
+    std::vector<std::string> snapshot() {
+        std::lock_guard<std::mutex> lock(mu_);
+        std::vector<std::string> values;
+        for (const char* key : SNAPSHOT_KEYS) {
+            auto it = slots_.find(key);
+            if (it == slots_.end()) {
+                values.emplace_back();
+                continue;
+            }
+            volatile int64_t age = nowMs() - it->second.updatedAt;
+            (void)age;
+            values.push_back(it->second.value);
+        }
+        return values;
+    }
+
+private:
+    struct Slot {
+        std::string key;
+        std::string value;
+        int64_t updatedAt;
+        int64_t ttlMs;
+        double quality;
+        std::string source;
+    };
+
+    static int64_t nowMs() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    std::unordered_map<std::string, Slot> slots_;
+    std::mutex mu_;
+};
+
+// ============================================================
+// 校验
+// ============================================================
+
+int runCheck() {
+    std::printf("check:\n");
+    SensorDataTray& tray = SensorDataTray::getInstance();
+    tray.clear();
+    int failures = 0;
+
+    tray.put("batteryLevel", TrayValue::ofDouble(87), 1.0, "battery");
+    tray.put("isCharging", TrayValue::ofBool(true), 1.0, "battery");
+    tray.put("latitude", TrayValue::ofDouble(31.230416), 1.0, "gps");
+    tray.put("stepCount", TrayValue::ofInt(12034));
+    tray.put("motionState", std::string("walking"), 0.9, "accelerometer");
+    auto battery = tray.get("batteryLevel");
+    auto charging = tray.get("isCharging");
+    failures += check("typed values read back by type",
+                      battery.value.type == TrayValueType::Double && battery.value.asDouble() == 87 &&
+                          charging.value.type == TrayValueType::Bool && charging.value.flag &&
+                          tray.get("stepCount").value.integer == 12034 && battery.fresh && battery.quality == 1.0);
+
+    auto snap = tray.getSnapshot();
+    failures += check("snapshot strings match toString()",
+                      snap.batteryLevel == "87" && snap.isCharging == "true" && snap.latitude == "31.230416" &&
+                          snap.stepCount == "12034" && snap.motionState == "walking");
+    failures += check("snapshot defaults / optional fields",
+                      snap.timeOfDay == "unknown" && snap.hour == "0" && snap.networkType == "none" &&
+                          !snap.geofence.has_value() && !snap.wifiSsid.has_value() && !snap.cellId.has_value());
+
+    tray.put("customSensor", std::string("x"));
+    auto status = tray.getStatus();
+    bool sourceDefault = false;
+    for (const auto& s : status) {
+        if (s.key == "customSensor") sourceDefault = s.source == "customSensor" && s.value == "x";
+    }
+    failures += check("dynamic keys register on first put", tray.size() == 6 && sourceDefault &&
+                                                                 !tray.get("neverWritten").value.has());
+
+    // TTL：先配置再写入；写入后缩短到 0 → 立即过期，quality 衰减到 0
+    tray.setTTL("noiseLevel", 12345);
+    tray.put("noiseLevel", TrayValue::ofDouble(40.5));
+    bool ttlApplied = false;
+    for (const auto& s : tray.getStatus()) {
+        if (s.key == "noiseLevel") ttlApplied = s.ttlMs == 12345 && s.value == "40.5";
+    }
+    tray.setTTL("motionState", 1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    auto stale = tray.get("motionState");
+    tray.clear();
+    bool ttlKept = false;
+    tray.put("noiseLevel", TrayValue::ofDouble(1));
+    for (const auto& s : tray.getStatus()) {
+        if (s.key == "noiseLevel") ttlKept = s.ttlMs == 12345;
+    }
+    failures += check("setTTL before / after put, kept by clear()",
+                      ttlApplied && !stale.fresh && stale.quality == 0.0 && ttlKept && tray.size() == 1);
+    tray.setTTL("motionState", 30 * 1000);
+
+    // 超长字符串：截断后仍是合法 UTF-8（“中” 为 3 字节，95 字节位于字符中间）
+    std::string longValue;
+    for (int i = 0; i < 40; i++) longValue += "中";
+    tray.put("geofence", longValue);
+    std::string stored = tray.get("geofence").value.text;
+    failures += check("long strings truncated on UTF-8 boundary",
+                      stored.size() == 93 && stored == longValue.substr(0, 93));
+    tray.clear();
+
+    // 并发：每次写入的字符串与数字来自同一个计数，读者看到的必须成对一致
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> writes{0};
+    std::vector<std::thread> writers;
+    const char* const keys[] = {"hour", "wifiSsid", "cellId", "customSensor"};
+    for (int w = 0; w < 3; w++) {
+        writers.emplace_back([&, w] {
+            uint64_t n = static_cast<uint64_t>(w) << 40;
+            while (!stop.load(std::memory_order_relaxed)) {
+                for (const char* key : keys) {
+                    TrayValue v = TrayValue::ofString("v" + std::to_string(n));
+                    v.integer = static_cast<int64_t>(n);
+                    tray.put(key, v, static_cast<double>(n % 100) / 100.0, "w" + std::to_string(n));
+                    n++;
+                }
+                writes.fetch_add(4, std::memory_order_relaxed);
+            }
+        });
+    }
+    size_t reads = 0, torn = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    while (elapsedMs(t0) < 300) {
+        for (const char* key : keys) {
+            auto r = tray.get(key);
+            if (!r.value.has()) continue;
+            reads++;
+            uint64_t n = static_cast<uint64_t>(r.value.integer);
+            if (r.value.text != "v" + std::to_string(n) || r.quality != static_cast<double>(n % 100) / 100.0) torn++;
+        }
+        for (const auto& s : tray.getStatus()) {
+            if (s.value.size() > 1 && s.source != "w" + s.value.substr(1)) torn++;
+        }
+    }
+    stop = true;
+    for (auto& t : writers) t.join();
+    failures += check("concurrent writers never tear a slot", torn == 0 && reads > 0);
+    std::printf("    (%zu reads against %llu writes)\n", reads, static_cast<unsigned long long>(writes.load()));
+    tray.clear();
+
+    // 槽位上限（放在最后：注册的 key 不回收）：占满后新 key 的 put 返回 false 且值被丢弃，已有 key 照常写入
+    int accepted = 0;
+    bool rejected = false;
+    for (int i = 0; i < SensorDataTray::MAX_SLOTS && !rejected; i++) {
+        if (tray.put("capKey" + std::to_string(i), std::string("v"))) {
+            accepted++;
+        } else {
+            rejected = true;
+        }
+    }
+    bool overflowRejected = rejected && !tray.put("capOverflow", std::string("v")) &&
+                            !tray.get("capOverflow").value.has() && tray.slotId("capOverflow") == -1;
+    failures += check("put() returns false once 64 slots are taken",
+                      overflowRejected && accepted > 0 && tray.put("hour", std::string("7")) &&
+                          tray.get("hour").value.text == "7");
+    tray.clear();
+    return failures;
+}
+
+// ============================================================
+// 计时
+// ============================================================
+
+template <typename PutFn, typename SnapFn>
+void timeUnderWrites(const char* label, int ms, PutFn put, SnapFn snap) {
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> puts{0};
+    std::thread writer([&] {
+        uint64_t n = 0;
+        while (!stop.load(std::memory_order_relaxed)) {
+            put(SNAPSHOT_KEYS[n % 15], std::to_string(n));
+            n++;
+            puts.fetch_add(1, std::memory_order_relaxed);
+        }
+    });
+    size_t snaps = 0, sink = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    double elapsed = 0;
+    while ((elapsed = elapsedMs(t0)) < ms) {
+        sink += snap();
+        snaps++;
+    }
+    stop = true;
+    writer.join();
+    std::printf("  %-26s %8.3f us / snapshot  (%zu snapshots, %llu concurrent puts)\n", label,
+                elapsed * 1000.0 / static_cast<double>(snaps), snaps, static_cast<unsigned long long>(puts.load()));
+    if (sink == 1) std::printf("\n");
+}
+
+void runTiming(int ms) {
+    std::printf("timing: getSnapshot with a writer thread calling put (%d ms each)\n", ms);
+    LegacyTray legacy;
+    timeUnderWrites(
+        "mutex + unordered_map", ms,
+        [&](const char* key, const std::string& v) { legacy.put(key, v, 1.0, "bench"); },
+        [&] { return legacy.snapshot().size(); });
+
+    SensorDataTray& tray = SensorDataTray::getInstance();
+    tray.clear();
+    timeUnderWrites(
+        "seqlock slots", ms,
+        [&](const char* key, const std::string& v) { tray.put(key, v, 1.0, "bench"); },
+        [&] { return tray.getSnapshot().timeOfDay.size(); });
+    tray.clear();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    int ms = 500;
+    bool checkOnly = false;
+    perf::Args().option("--ms", ms).flag("--check-only", checkOnly).parse(argc, argv);
+
+    int failures = runCheck();
+    if (!checkOnly) runTiming(ms);
+
+    return perf::reportMatch(failures);
+}
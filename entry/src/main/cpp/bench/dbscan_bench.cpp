@@ -0,0 +1,96 @@
+/**
+ * dbscan_bench.cpp — DBSCAN 邻居查询基准：网格索引 vs 线性扫描
+ *
+ * 合成 30 天 GPS 轨迹（家 / 公司 / 健身房 / 餐厅 + 通勤散点），
+ * 分别以 useSpatialIndex = true / false 聚类，输出耗时并校验两条路径结果一致。
+ *
+ * 用法: dbscan_bench [--sizes 1000,10000,100000] [--max-linear N]
+ *   --max-linear  线性扫描是 O(n²)，超过该点数时跳过（默认 10000）
+ */
+#include "dbscan_cluster.h"
+#include "trace_gen.h"
+#include "perf_harness.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using dbscan::ClusterConfig;
+using dbscan::ClusterResult;
+using dbscan::DBSCAN;
+using geo_utils::GeoPoint;
+using bench::makeTrace;
+
+namespace {
+
+double runMs(const std::vector<GeoPoint>& points, bool indexed, std::vector<ClusterResult>& out) {
+    ClusterConfig config;
+    config.useSpatialIndex = indexed;
+    DBSCAN db(config);
+
+    auto t0 = std::chrono::steady_clock::now();
+    out = db.cluster(points);
+    auto t1 = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(t1 - t0).count();
+}
+
+bool sameClusters(const std::vector<ClusterResult>& a, const std::vector<ClusterResult>& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].pointCount != b[i].pointCount) return false;
+        if (std::abs(a[i].centerLat - b[i].centerLat) > 1e-9) return false;
+        if (std::abs(a[i].centerLng - b[i].centerLng) > 1e-9) return false;
+    }
+    return true;
+}
+
+std::vector<size_t> parseSizes(const char* arg) {
+    std::vector<size_t> sizes;
+    std::string s(arg);
+    size_t pos = 0;
+    while (pos < s.size()) {
+        size_t comma = s.find(',', pos);
+        if (comma == std::string::npos) comma = s.size();
+        sizes.push_back(std::strtoull(s.substr(pos, comma - pos).c_str(), nullptr, 10));
+        pos = comma + 1;
+    }
+    return sizes;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    std::vector<size_t> sizes = {1000, 10000, 100000};
+    size_t maxLinear = 10000;
+
+    perf::Args()
+        .option("--sizes", [&](const char* v) { sizes = parseSizes(v); })
+        .option("--max-linear", maxLinear)
+        .parse(argc, argv);
+
+    std::printf("%10s %10s %12s %12s %9s %s\n", "points", "clusters", "grid(ms)", "linear(ms)", "speedup", "match");
+
+    int failures = 0;
+    for (size_t n : sizes) {
+        auto points = makeTrace(n, 42);
+
+        std::vector<ClusterResult> gridResult, linearResult;
+        double gridMs = runMs(points, true, gridResult);
+
+        if (n > maxLinear) {
+            std::printf("%10zu %10zu %12.2f %12s %9s %s\n", n, gridResult.size(), gridMs, "skipped", "-", "-");
+            continue;
+        }
+
+        double linearMs = runMs(points, false, linearResult);
+        bool match = sameClusters(gridResult, linearResult);
+        if (!match) failures++;
+
+        std::printf("%10zu %10zu %12.2f %12.2f %8.1fx %s\n", n, gridResult.size(), gridMs, linearMs,
+                    gridMs > 0 ? linearMs / gridMs : 0.0, match ? "yes" : "NO");
+    }
+
+    return failures == 0 ? 0 : 1;
+}
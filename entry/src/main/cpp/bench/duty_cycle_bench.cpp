@@ -0,0 +1,367 @@
+/**
+ * duty_cycle_bench.cpp — 占空比调度（合并唤醒 + 规则依赖 + TTL + 围栏距离）vs 按运动状态的固定定时器
+ *
+ * 模拟一天中的 10 小时：静止 / 步行 / 驾驶交替，期间靠近、进入、离开围栏。
+ * 模拟托盘：传感器采样时刷新它负责的 key，ageMs 随时间增长，TTL 取 data_tray 的默认值。
+ * 校验：规则引用的 key 在对应传感器启用期间从不过期；GPS / WiFi 单独看从不晚于各自的间隔采样；
+ * 没有启用的规则引用位置类 key 时 GPS 一次都不采样（规则经 RuleEngine::referencedKeys 得到），
+ * 新地点发现打开时则按其最低频率采样；
+ * 只有 event: / sequence: 条件的规则按事件类型启用对应传感器；
+ * 靠近围栏时 GPS 间隔短于远离时；合并后的唤醒次数少于不合并。
+ * 然后对比每小时的唤醒次数与各传感器采样次数，以及 plan() 的耗时。
+ *
+ * 用法: duty_cycle_bench [--hours N] [--check-only]
+ */
+#include "motion_detector/duty_cycle_scheduler.h"
+#include "context_engine/context_engine.h"
+#include "data_tray/data_tray.h"
+#include "perf_harness.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using motion_detector::MotionState;
+using sampling_strategy::DutyCycleScheduler;
+using sampling_strategy::KeyFreshness;
+using sampling_strategy::SchedulerInputs;
+using sampling_strategy::Sensor;
+using sampling_strategy::SENSOR_COUNT;
+using sampling_strategy::WakePlan;
+using perf::elapsedMs;
+using perf::check;
+
+namespace {
+
+const int64_t MINUTE = 60 * 1000;
+
+// ============================================================
+// 模拟场景
+// ============================================================
+
+/** 一段运动：持续时间内到最近围栏边界的距离从 fromM 线性变到 toM */
+struct Segment {
+    MotionState motion;
+    int64_t durationMs;
+    double fromM, toM;
+    double speedMps;
+};
+
+std::vector<Segment> daySegments(double hours) {
+    std::vector<Segment> one = {
+        {MotionState::STATIONARY, 120 * MINUTE, 40, 40, 0},       // 在家
+        {MotionState::WALKING, 10 * MINUTE, 40, 800, 1.4},        // 走出家门
+        {MotionState::DRIVING, 35 * MINUTE, 5000, 300, 12},       // 开车上班
+        {MotionState::WALKING, 5 * MINUTE, 300, 20, 1.3},         // 走进公司
+        {MotionState::STATIONARY, 180 * MINUTE, 60, 60, 0},       // 办公
+        {MotionState::WALKING, 20 * MINUTE, 60, 1500, 1.4},       // 午饭
+        {MotionState::STATIONARY, 200 * MINUTE, 3000, 3000, 0},   // 远离所有围栏
+        {MotionState::RUNNING, 30 * MINUTE, 3000, 200, 3.0},
+    };
+    std::vector<Segment> out;
+    int64_t total = 0;
+    while (total < static_cast<int64_t>(hours * 60 * MINUTE)) {
+        for (const auto& s : one) {
+            out.push_back(s);
+            total += s.durationMs;
+        }
+    }
+    return out;
+}
+
+/** 模拟托盘：key → 上次写入时间 */
+struct SimTray {
+    struct Entry {
+        std::string key;
+        int64_t writtenMs = -1;
+        int64_t ttlMs = 0;
+        uint8_t sensors = 0;
+    };
+    std::vector<Entry> entries;
+
+    explicit SimTray(const std::vector<std::string>& keys) {
+        for (const auto& k : keys) {
+            if (k.find(':') != std::string::npos) continue;   // event: / sequence: 由 pushEvent 产生，不在托盘里
+            entries.push_back({k, -1, data_tray::getDefaultTTL(k), DutyCycleScheduler::sensorsForKey(k)});
+        }
+    }
+
+    void sampled(Sensor s, int64_t now) {
+        for (auto& e : entries) {
+            if (e.sensors & (1u << static_cast<unsigned>(s))) e.writtenMs = now;
+        }
+    }
+
+    std::vector<KeyFreshness> freshness(int64_t now) const {
+        std::vector<KeyFreshness> out;
+        for (const auto& e : entries) out.push_back({e.key, e.writtenMs < 0 ? -1 : now - e.writtenMs, e.ttlMs});
+        return out;
+    }
+};
+
+struct SimStats {
+    int wakes = 0;
+    int samples[SENSOR_COUNT] = {0, 0, 0};
+    int64_t maxGapMs[SENSOR_COUNT] = {0, 0, 0};
+    int64_t maxStaleMs = 0;             // 规则引用的 key 超过 TTL 的最长时间（启用期间）
+    int64_t nearGpsIntervalMs = -1;     // 静止、距边界 < 100m 时的最大 GPS 间隔
+    int64_t farGpsIntervalMs = -1;      // 静止、距边界 > 2km 时的最小 GPS 间隔
+    int64_t gpsOverdueMs = 0;           // GPS 晚于单独调度到期时间采样的最大值
+    double planNs = 0;
+};
+
+/**
+ * 跑一遍调度：每次唤醒按计划采样，运动状态切换时立即重新规划（与 ContextAwarenessService 一致）
+ * coalesce = false 时每次唤醒只采样到期最早的那一个传感器
+ */
+SimStats simulate(const std::vector<Segment>& segments, const std::vector<std::string>& ruleKeys, bool coalesce,
+                  bool placeDiscovery = false) {
+    DutyCycleScheduler scheduler;
+    SimTray tray(ruleKeys);
+    SimStats stats;
+    int64_t last[SENSOR_COUNT] = {-1, -1, -1};
+    bool wasEnabled[SENSOR_COUNT] = {false, false, false};
+    int64_t planCalls = 0;
+    double planMs = 0;
+
+    int64_t segStart = 0;
+    int64_t now = 0;
+    std::vector<Sensor> sampled;
+    for (const auto& seg : segments) {
+        int64_t segEnd = segStart + seg.durationMs;
+        while (true) {
+            double frac = static_cast<double>(now - segStart) / static_cast<double>(seg.durationMs);
+            SchedulerInputs in;
+            in.nowMs = now;
+            in.motion = seg.motion;
+            in.ruleKeys = ruleKeys;
+            in.freshness = tray.freshness(now);
+            in.fenceDistanceMeters = seg.fromM + (seg.toM - seg.fromM) * frac;
+            in.speedMps = seg.speedMps;
+            in.placeDiscovery = placeDiscovery;
+            for (Sensor s : sampled) scheduler.markSampled(s, now);
+            sampled.clear();
+
+            auto t0 = std::chrono::steady_clock::now();
+            WakePlan plan = scheduler.plan(in);
+            planMs += elapsedMs(t0);
+            planCalls++;
+
+            // 规则引用的 key 在其传感器持续启用期间是否已经过期（刚重新启用时允许，会立即采样）
+            for (const auto& f : in.freshness) {
+                if (f.ageMs <= f.ttlMs) continue;
+                uint8_t sensors = DutyCycleScheduler::sensorsForKey(f.key);
+                for (size_t i = 0; i < SENSOR_COUNT; i++) {
+                    if ((sensors & (1u << i)) && plan.sensors[i].enabled && wasEnabled[i]) {
+                        stats.maxStaleMs = std::max(stats.maxStaleMs, f.ageMs - f.ttlMs);
+                    }
+                }
+            }
+            for (size_t i = 0; i < SENSOR_COUNT; i++) wasEnabled[i] = plan.sensors[i].enabled;
+
+            // 同为静止状态时比较围栏近处 / 远处的 GPS 间隔
+            const auto& gps = plan[Sensor::GPS];
+            bool still = seg.motion == MotionState::STATIONARY;
+            if (gps.enabled && still && in.fenceDistanceMeters < 100) {
+                stats.nearGpsIntervalMs = std::max(stats.nearGpsIntervalMs, gps.intervalMs);
+            }
+            if (gps.enabled && still && in.fenceDistanceMeters > 2000) {
+                if (stats.farGpsIntervalMs < 0 || gps.intervalMs < stats.farGpsIntervalMs) {
+                    stats.farGpsIntervalMs = gps.intervalMs;
+                }
+            }
+
+            if (plan.wakeAtMs >= segEnd) {
+                // 运动状态在下次唤醒前切换：到切换时刻重新规划
+                now = segEnd;
+                break;
+            }
+            now = plan.wakeAtMs;
+            stats.wakes++;
+            bool firedOne = false;
+            for (size_t i = 0; i < SENSOR_COUNT; i++) {
+                const auto& p = plan.sensors[i];
+                bool fire = coalesce ? p.fire : (p.enabled && p.dueMs == plan.wakeAtMs && !firedOne);
+                if (!fire) continue;
+                firedOne = true;
+                Sensor s = static_cast<Sensor>(i);
+                if (s == Sensor::GPS) stats.gpsOverdueMs = std::max(stats.gpsOverdueMs, now - p.dueMs);
+                if (last[i] >= 0) stats.maxGapMs[i] = std::max(stats.maxGapMs[i], now - last[i]);
+                last[i] = now;
+                stats.samples[i]++;
+                tray.sampled(s, now);
+                sampled.push_back(s);
+            }
+        }
+        segStart = segEnd;
+    }
+    stats.planNs = planCalls > 0 ? planMs * 1e6 / static_cast<double>(planCalls) : 0;
+    return stats;
+}
+
+/** 原实现：GPS / WiFi setInterval 按运动状态的固定间隔，加速度计每个样本都处理一次 */
+SimStats simulateLegacy(const std::vector<Segment>& segments) {
+    sampling_strategy::SamplingStrategy strategy;
+    SimStats stats;
+    for (const auto& seg : segments) {
+        auto iv = strategy.getIntervalsForState(seg.motion);
+        int64_t gps = iv.gpsIntervalMs > 0 ? seg.durationMs / iv.gpsIntervalMs : 0;
+        int64_t wifi = iv.wifiIntervalMs > 0 ? seg.durationMs / iv.wifiIntervalMs : 0;
+        int64_t accel = seg.durationMs / (iv.accelIntervalNs / 1000000);
+        stats.samples[0] += static_cast<int>(gps);
+        stats.samples[1] += static_cast<int>(wifi);
+        stats.samples[2] += static_cast<int>(accel);
+        stats.wakes += static_cast<int>(gps + wifi + accel);
+    }
+    return stats;
+}
+
+/** 用 RuleEngine 取启用规则引用的 key（位置规则可整体禁用） */
+std::vector<std::string> ruleKeys(bool locationRulesEnabled) {
+    using context_engine::Rule;
+    auto rule = [](const char* id, std::vector<context_engine::Condition> conds, bool enabled) {
+        Rule r;
+        r.id = id;
+        r.name = id;
+        r.conditions = std::move(conds);
+        r.action = {std::string(id) + "_action", "suggestion", "{}"};
+        r.priority = 1.0;
+        r.cooldownMs = 0;
+        r.enabled = enabled;
+        return r;
+    };
+    std::vector<Rule> rules = {
+        rule("morning_commute", {{"timeOfDay", "eq", "morning"}, {"motionState", "eq", "driving"}}, true),
+        rule("arrive_office", {{"geofence", "eq", "office"}, {"event:geofence_enter", "recent", "60000"}},
+             locationRulesEnabled),
+        rule("home_wifi", {{"wifiSsid", "eq", "home"}, {"isWeekend", "eq", "true"}}, true),
+        rule("near_gym", {{"latitude", "range", "31.2,31.3"}, {"longitude", "range", "121.4,121.5"}},
+             locationRulesEnabled),
+        rule("low_battery", {{"batteryLevel", "lt", "20"}}, true),
+    };
+    context_engine::RuleEngine engine;
+    engine.loadRules(rules);
+    return engine.referencedKeys();
+}
+
+/** 只有 recent(event:geofence_enter) 一个条件的规则（“到达任意围栏后提醒”） */
+std::vector<std::string> temporalRuleKeys() {
+    context_engine::Rule r;
+    r.id = "arrive_anywhere";
+    r.name = r.id;
+    r.conditions = {{"event:geofence_enter", "recent", "300000"}};
+    r.action = {"arrive_anywhere_action", "suggestion", "{}"};
+    r.priority = 1.0;
+    r.cooldownMs = 0;
+    r.enabled = true;
+    context_engine::RuleEngine engine;
+    engine.loadRules({r});
+    return engine.referencedKeys();
+}
+
+// ============================================================
+// 校验
+// ============================================================
+
+int runCheck(double hours) {
+    int failures = 0;
+    std::printf("check:\n");
+    std::vector<Segment> segments = daySegments(hours);
+
+    std::vector<std::string> withLocation = ruleKeys(true);
+    std::vector<std::string> withoutLocation = ruleKeys(false);
+    bool keysOk = withLocation == std::vector<std::string>{"batteryLevel", "event:geofence_enter", "geofence",
+                                                           "isWeekend", "latitude", "longitude", "motionState",
+                                                           "timeOfDay", "wifiSsid"} &&
+                  withoutLocation == std::vector<std::string>{"batteryLevel", "isWeekend", "motionState",
+                                                              "timeOfDay", "wifiSsid"};
+    failures += check("referencedKeys: enabled rules only, sorted", keysOk);
+
+    // 只靠时序条件的规则：事件类型决定哪个传感器必须采样
+    std::vector<std::string> eventOnly = temporalRuleKeys();
+    SimStats events = simulate(segments, eventOnly, true);
+    const uint8_t gpsBit = 1u << static_cast<unsigned>(Sensor::GPS), wifiBit = 1u << static_cast<unsigned>(Sensor::WIFI);
+    bool mapped = DutyCycleScheduler::sensorsForKey("event:geofence_exit") == gpsBit &&
+                  DutyCycleScheduler::sensorsForKey("event:wifi_lost_home") == wifiBit &&
+                  DutyCycleScheduler::sensorsForKey("sequence:wifi_lost_work,geofence_enter") == (gpsBit | wifiBit) &&
+                  DutyCycleScheduler::sensorsForKey("sequence:broken") == 0 &&
+                  DutyCycleScheduler::sensorsForKey("event:custom_tap") == 0;
+    failures += check("event-only rule: gps / wifi still scheduled",
+                      mapped && eventOnly == std::vector<std::string>{"event:geofence_enter"} &&
+                          events.samples[0] > 0 && events.samples[1] == 0 && events.gpsOverdueMs == 0);
+
+    SimStats s = simulate(segments, withLocation, true);
+    std::printf("    %d wakes, gps %d  wifi %d  accel %d, near-fence gps <= %llds, far gps >= %llds\n", s.wakes,
+                s.samples[0], s.samples[1], s.samples[2], static_cast<long long>(s.nearGpsIntervalMs / 1000),
+                static_cast<long long>(s.farGpsIntervalMs / 1000));
+    failures += check("rule keys never stale while sensor enabled", s.maxStaleMs == 0);
+    failures += check("gps never sampled after its own due time", s.gpsOverdueMs == 0);
+    failures += check("gps denser near fences than far from them",
+                      s.nearGpsIntervalMs > 0 && s.farGpsIntervalMs > s.nearGpsIntervalMs);
+
+    SimStats noLocation = simulate(segments, withoutLocation, true);
+    failures += check("no location rule: gps never sampled", noLocation.samples[0] == 0 && noLocation.samples[1] > 0);
+    SimStats discovery = simulate(segments, withoutLocation, true, true);
+    failures += check("place discovery: gps at its minimum rate",
+                      discovery.samples[0] > 0 && discovery.samples[0] < s.samples[0] &&
+                          discovery.maxGapMs[0] <= DutyCycleScheduler::PLACE_DISCOVERY_GPS_INTERVAL_MS &&
+                          discovery.gpsOverdueMs == 0);
+
+    SimStats separate = simulate(segments, withLocation, false);
+    failures += check("coalescing reduces wakeups", s.wakes < separate.wakes);
+
+    SchedulerInputs denied;
+    denied.motion = MotionState::WALKING;
+    denied.ruleKeys = withLocation;
+    denied.gpsAvailable = false;
+    DutyCycleScheduler scheduler;
+    failures += check("gps unavailable: disabled", !scheduler.plan(denied)[Sensor::GPS].enabled);
+
+    SchedulerInputs driving;
+    driving.motion = MotionState::DRIVING;
+    driving.ruleKeys = withLocation;
+    failures += check("driving: wifi off (SensorIntervals)", !scheduler.plan(driving)[Sensor::WIFI].enabled);
+    return failures;
+}
+
+// ============================================================
+// 计时
+// ============================================================
+
+void runTiming(double hours) {
+    std::vector<Segment> segments = daySegments(hours);
+    std::vector<std::string> keys = ruleKeys(true);
+    SimStats legacy = simulateLegacy(segments);
+    SimStats separate = simulate(segments, keys, false);
+    SimStats merged = simulate(segments, keys, true);
+    SimStats noLocation = simulate(segments, ruleKeys(false), true);
+    SimStats discovery = simulate(segments, ruleKeys(false), true, true);
+
+    std::printf("timing: %.0f h simulated, counts per hour\n", hours);
+    std::printf("  %-34s %-7s %7s   %7s %7s %7s\n", "", "", "wakes", "gps", "wifi", "accel");
+    auto row = [hours](const char* name, const SimStats& s) {
+        std::printf("  %-34s %-7s %7.1f   %7.1f %7.1f %7.1f\n", name, "", s.wakes / hours, s.samples[0] / hours,
+                    s.samples[1] / hours, s.samples[2] / hours);
+    };
+    row("fixed timers, per-sample motion", legacy);
+    row("scheduler, not coalesced", separate);
+    row("scheduler, coalesced", merged);
+    row("coalesced, no location rules", noLocation);
+    row("  + place discovery", discovery);
+    std::printf("  plan() %.0f ns per call\n", merged.planNs);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    double hours = 10;
+    bool checkOnly = false;
+    perf::Args().option("--hours", hours).flag("--check-only", checkOnly).parse(argc, argv);
+
+    int failures = runCheck(hours);
+    if (!checkOnly) runTiming(hours);
+
+    return perf::reportMatch(failures);
+}
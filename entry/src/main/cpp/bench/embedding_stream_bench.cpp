@@ -0,0 +1,245 @@
+/**
+ * embedding_stream_bench.cpp — 流式声纹提取（窗口 + 批量工作线程）vs 说完后整段同步提取
+ *
+ * 校验：窗口位置（重叠窗口、尾窗覆盖最后 windowMs、短语音整段、下一句续编号）；
+ * 嵌入与同步 extractEmbedding 完全一致；工作线程繁忙时积压的窗口合并为一次推理；
+ * destroyStream 后不再回调；多工作线程下 poll 结果按 segment 有序。
+ * 然后用“固定调用开销 + 按音频时长计费”的模拟模型，对比说话结束到拿到嵌入的延迟。
+ *
+ * 用法: embedding_stream_bench [--speech-ms N] [--check-only]
+ */
+#include "voiceprint/embedding_stream.h"
+#include "perf_harness.h"
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+using voiceprint::AudioSegment;
+using voiceprint::EmbeddingExtractor;
+using voiceprint::EnergyStubExtractor;
+using voiceprint::StreamingExtractor;
+using voiceprint::StreamOptions;
+using voiceprint::StreamResult;
+using perf::elapsedMs;
+using perf::check;
+
+namespace {
+
+constexpr size_t DIM = 192;
+constexpr int RATE = 16000;
+
+/**
+ * 模拟推理耗时：每次 computeBatch 固定开销（会话调度 / 特征前处理）+ 按音频时长计费，
+ * 嵌入仍由能量桩计算。批量调用只付一次固定开销。
+ */
+class CostModelExtractor : public EmbeddingExtractor {
+public:
+    CostModelExtractor(double overheadMs, double msPerAudioSecond)
+        : stub_(DIM), overheadMs_(overheadMs), msPerAudioSecond_(msPerAudioSecond) {}
+
+    size_t dim() const override { return DIM; }
+
+    void computeBatch(const std::vector<AudioSegment>& segments, std::vector<std::vector<float>>& out) override {
+        double audioSeconds = 0;
+        for (const auto& s : segments) audioSeconds += static_cast<double>(s.length) / s.sampleRate;
+        calls.fetch_add(1);
+        std::this_thread::sleep_for(std::chrono::microseconds(
+            static_cast<int64_t>((overheadMs_ + msPerAudioSecond_ * audioSeconds) * 1000.0)));
+        stub_.computeBatch(segments, out);
+    }
+
+    std::atomic<int> calls{0};
+
+private:
+    EnergyStubExtractor stub_;
+    double overheadMs_;
+    double msPerAudioSecond_;
+};
+
+std::vector<float> speech(size_t n, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::normal_distribution<float> noise(0.0f, 0.05f);
+    std::vector<float> pcm(n);
+    for (size_t i = 0; i < n; i++) {
+        float envelope = 0.3f + 0.2f * std::sin(static_cast<float>(i) / 4000.0f);
+        pcm[i] = envelope * std::sin(static_cast<float>(i) * 0.07f) + noise(rng);
+    }
+    return pcm;
+}
+
+std::vector<float> syncEmbedding(const float* samples, size_t n) {
+    EnergyStubExtractor stub(DIM);
+    std::vector<std::vector<float>> out;
+    stub.computeBatch({{samples, n, RATE}}, out);
+    return out[0];
+}
+
+void feed(StreamingExtractor& ex, int id, const std::vector<float>& pcm, size_t chunk) {
+    for (size_t off = 0; off < pcm.size(); off += chunk) {
+        ex.acceptWaveform(id, pcm.data() + off, std::min(chunk, pcm.size() - off));
+    }
+}
+
+// ============================================================
+// 校验
+// ============================================================
+
+int runCheck() {
+    std::printf("check:\n");
+    int failures = 0;
+    auto stub = std::make_shared<EnergyStubExtractor>(DIM);
+
+    {
+        StreamingExtractor ex(stub, 1);
+        int id = ex.createStream(StreamOptions{RATE, 1000, 500});
+        auto pcm = speech(RATE * 5 / 2, 1);  // 2.5 s
+        feed(ex, id, pcm, 1234);
+        ex.inputFinished(id);
+        auto shortPcm = speech(RATE / 2, 2);  // 下一句只有 0.5 s
+        feed(ex, id, shortPcm, 333);
+        ex.inputFinished(id);
+        bool emptyRejected = !ex.inputFinished(id) && !ex.acceptWaveform(999, pcm.data(), 1);
+        ex.flush();
+        auto results = ex.poll(id);
+
+        // 0-1s, 0.5-1.5s, 1-2s, 1.5-2.5s, 尾窗 1.5-2.5s（final），下一句 2.5-3s（final）
+        const int64_t expect[][3] = {{0, 16000, 0},     {8000, 24000, 0},  {16000, 32000, 0},
+                                     {24000, 40000, 0}, {24000, 40000, 1}, {40000, 48000, 1}};
+        bool windows = results.size() == 6;
+        for (size_t i = 0; windows && i < 6; i++) {
+            windows = results[i].segment == i && results[i].startSample == expect[i][0] &&
+                      results[i].endSample == expect[i][1] && results[i].final == (expect[i][2] == 1);
+        }
+        failures += check("overlapping windows, tail and next utterance", windows && emptyRejected);
+
+        bool same = windows;
+        for (size_t i = 0; same && i < 5; i++) {
+            same = results[i].embedding == syncEmbedding(pcm.data() + results[i].startSample,
+                                                         static_cast<size_t>(results[i].endSample - results[i].startSample));
+        }
+        same = same && results[5].embedding == syncEmbedding(shortPcm.data(), shortPcm.size());
+        failures += check("embeddings identical to sync extraction", same && ex.poll(id).empty());
+    }
+
+    {
+        // 单工作线程 + 慢模型，4 路同时说话：积压的窗口应合并推理
+        auto slow = std::make_shared<CostModelExtractor>(8.0, 4.0);
+        StreamingExtractor ex(slow, 1);
+        std::vector<int> ids;
+        for (int s = 0; s < 4; s++) ids.push_back(ex.createStream(StreamOptions{RATE, 500, 250}));
+        auto pcm = speech(RATE * 2, 3);
+        for (size_t off = 0; off < pcm.size(); off += 800) {
+            for (int id : ids) ex.acceptWaveform(id, pcm.data() + off, 800);
+        }
+        for (int id : ids) ex.inputFinished(id);
+        ex.flush();
+        auto st = ex.stats();
+        size_t total = 0;
+        for (int id : ids) total += ex.poll(id).size();
+        failures += check("queued windows batched into one inference",
+                          st.largestBatch > 1 && st.batches < st.segments && total == st.segments &&
+                              st.largestBatch <= StreamingExtractor::DEFAULT_MAX_BATCH &&
+                              slow->calls.load() == static_cast<int>(st.batches));
+    }
+
+    {
+        auto slow = std::make_shared<CostModelExtractor>(5.0, 0.0);
+        StreamingExtractor ex(slow, 1);
+        std::atomic<int> delivered{0};
+        std::atomic<bool> destroyed{false};
+        std::atomic<int> afterDestroy{0};
+        int id = ex.createStream(StreamOptions{RATE, 100, 100}, [&](StreamResult&&) {
+            delivered++;
+            if (destroyed.load()) afterDestroy++;
+        });
+        auto pcm = speech(RATE * 2, 4);  // 20 个窗口
+        feed(ex, id, pcm, 1600);
+        std::this_thread::sleep_for(std::chrono::milliseconds(12));
+        bool ok = ex.destroyStream(id);
+        destroyed = true;
+        ex.flush();
+        failures += check("destroyStream drops queued windows",
+                          ok && delivered.load() < 20 && afterDestroy.load() <= 1 && !ex.destroyStream(id) &&
+                              !ex.acceptWaveform(id, pcm.data(), 10));
+    }
+
+    {
+        StreamingExtractor ex(std::make_shared<CostModelExtractor>(0.5, 2.0), 3, 2);
+        int id = ex.createStream(StreamOptions{RATE, 200, 50});
+        feed(ex, id, speech(RATE * 2, 5), 4000);
+        ex.inputFinished(id);
+        ex.flush();
+        auto results = ex.poll(id);
+        bool ordered = !results.empty() && results.back().final;
+        for (size_t i = 0; ordered && i < results.size(); i++) ordered = results[i].segment == i;
+        failures += check("poll ordered by segment with 3 workers", ordered && ex.workerCount() == 3);
+    }
+    return failures;
+}
+
+// ============================================================
+// 计时
+// ============================================================
+
+void runTiming(int speechMs) {
+    // 同步路径：说完后在 JS 线程上对整段调用一次提取
+    const double overheadMs = 40.0, msPerSecond = 60.0;
+    std::printf("timing: %d ms utterance, model cost %.0f ms/call + %.0f ms per audio second (simulated)\n",
+                speechMs, overheadMs, msPerSecond);
+    auto pcm = speech(static_cast<size_t>(RATE) * speechMs / 1000, 6);
+
+    CostModelExtractor model(overheadMs, msPerSecond);
+    std::vector<std::vector<float>> out;
+    auto t0 = std::chrono::steady_clock::now();
+    model.computeBatch({{pcm.data(), pcm.size(), RATE}}, out);
+    double syncMs = elapsedMs(t0);
+
+    // 流式：100 ms 一块实时送入，说话期间窗口已在工作线程上提取
+    auto streamingModel = std::make_shared<CostModelExtractor>(overheadMs, msPerSecond);
+    StreamingExtractor ex(streamingModel, 2);
+    std::mutex mu;
+    std::chrono::steady_clock::time_point finishedAt, finalAt;
+    std::atomic<bool> gotFinal{false};
+    int id = ex.createStream(StreamOptions{}, [&](StreamResult&& r) {
+        if (!r.final) return;
+        std::lock_guard<std::mutex> lock(mu);
+        finalAt = std::chrono::steady_clock::now();
+        gotFinal = true;
+    });
+    const size_t chunk = RATE / 10;
+    for (size_t off = 0; off < pcm.size(); off += chunk) {
+        ex.acceptWaveform(id, pcm.data() + off, std::min(chunk, pcm.size() - off));
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    {
+        std::lock_guard<std::mutex> lock(mu);
+        finishedAt = std::chrono::steady_clock::now();
+    }
+    ex.inputFinished(id);
+    ex.flush();
+    double streamMs = gotFinal ? std::chrono::duration<double, std::milli>(finalAt - finishedAt).count() : -1.0;
+    auto st = ex.stats();
+
+    std::printf("  end of speech -> embedding  sync whole clip %8.1f ms\n", syncMs);
+    std::printf("  end of speech -> embedding  streaming       %8.1f ms  (%llu windows in %llu calls)\n", streamMs,
+                static_cast<unsigned long long>(st.segments), static_cast<unsigned long long>(st.batches));
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    int speechMs = 4000;
+    bool checkOnly = false;
+    perf::Args().option("--speech-ms", speechMs).flag("--check-only", checkOnly).parse(argc, argv);
+
+    int failures = runCheck();
+    if (!checkOnly) runTiming(speechMs);
+
+    return perf::reportMatch(failures);
+}
@@ -0,0 +1,202 @@
+/**
+ * event_buffer_bench.cpp — 按类型索引的 EventBuffer vs 逐条倒序扫描
+ *
+ * 随机推入若干类型的事件（容量超限时淘汰最旧的），在随机（含早于最新事件的模拟）
+ * 时刻查询 recent / within，结果必须与对整段事件序列的暴力扫描一致。
+ * 然后在 100 / 1000 / 10000 条事件容量下对比查询耗时，索引版不应随容量增长。
+ *
+ * 用法: event_buffer_bench [--events N] [--queries N] [--check-only]
+ */
+#include "context_engine.h"
+#include "perf_harness.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <random>
+#include <string>
+#include <vector>
+
+using context_engine::ContextEvent;
+using context_engine::EventBuffer;
+using context_engine::EventBufferConfig;
+using context_engine::EventTypeId;
+using perf::elapsedMs;
+
+namespace {
+
+int64_t steadyNowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+const char* const TYPES[] = {"geofence_enter", "geofence_exit", "motion_change", "app_open", "wifi_lost",
+                             "charging", "screen_on", "alarm"};
+constexpr size_t NUM_TYPES = sizeof(TYPES) / sizeof(TYPES[0]);
+constexpr size_t RARE_TYPE = NUM_TYPES - 1;  // timing: only the oldest event has this type
+
+struct Event {
+    size_t type;
+    int64_t ts;
+};
+
+/** 旧实现：倒序扫描整个缓冲区 */
+bool bruteRecent(const std::deque<Event>& events, size_t type, int64_t withinMs, int64_t now) {
+    int64_t cutoff = now - withinMs;
+    for (auto it = events.rbegin(); it != events.rend(); ++it) {
+        if (it->ts < cutoff) break;
+        if (it->ts > now) continue;
+        if (it->type == type) return true;
+    }
+    return false;
+}
+
+bool bruteSequence(const std::deque<Event>& events, size_t a, size_t b, int64_t withinMs, int64_t now) {
+    int64_t cutoff = now - withinMs;
+    const Event* latestB = nullptr;
+    for (auto it = events.rbegin(); it != events.rend(); ++it) {
+        if (it->ts < cutoff) break;
+        if (it->ts > now) continue;
+        if (it->type == b) {
+            latestB = &*it;
+            break;
+        }
+    }
+    if (latestB == nullptr) return false;
+    for (auto it = events.rbegin(); it != events.rend(); ++it) {
+        if (it->ts < cutoff) break;
+        if (it->type == a && it->ts < latestB->ts) return true;
+    }
+    return false;
+}
+
+/** 以当前时间为终点、间隔 1 – 60 s 生成 n 个事件 */
+std::vector<Event> randomEvents(std::mt19937& rng, size_t n, int64_t endMs) {
+    std::vector<Event> events(n);
+    int64_t ts = endMs;
+    for (size_t i = n; i-- > 0;) {
+        events[i] = {rng() % NUM_TYPES, ts};
+        ts -= 1000 + static_cast<int64_t>(rng() % 59000);
+    }
+    return events;
+}
+
+int runCheck(size_t numEvents, size_t numQueries) {
+    std::mt19937 rng(21);
+    EventBufferConfig config;
+    config.maxEvents = numEvents / 3;  // 超出容量，覆盖淘汰路径
+    EventBuffer buffer(config);
+    EventTypeId ids[NUM_TYPES];
+    for (size_t t = 0; t < NUM_TYPES; t++) ids[t] = buffer.internType(TYPES[t]);
+
+    int64_t endMs = steadyNowMs();
+    std::deque<Event> reference;
+    for (const auto& e : randomEvents(rng, numEvents, endMs)) {
+        ContextEvent event;
+        event.eventType = TYPES[e.type];
+        event.timestampMs = e.ts;
+        buffer.push(event);
+        reference.push_back(e);
+        if (reference.size() > config.maxEvents) reference.pop_front();
+    }
+
+    int failures = 0;
+    int64_t span = endMs - reference.front().ts;
+    for (size_t q = 0; q < numQueries; q++) {
+        int64_t now = endMs - static_cast<int64_t>(rng() % static_cast<uint64_t>(span + 1)) / (q % 2 ? 1 : 8);
+        int64_t within = 1000 + static_cast<int64_t>(rng() % 3600000);
+        size_t a = rng() % NUM_TYPES, b = rng() % NUM_TYPES;
+        bool recent = buffer.hasRecent(ids[a], within, now);
+        bool sequence = buffer.hasSequence(ids[a], ids[b], within, now);
+        if (recent != bruteRecent(reference, a, within, now) ||
+            sequence != bruteSequence(reference, a, b, within, now)) {
+            if (failures < 5) {
+                std::printf("  mismatch: now %lld within %lld %s→%s\n", static_cast<long long>(endMs - now),
+                            static_cast<long long>(within), TYPES[a], TYPES[b]);
+            }
+            failures++;
+        }
+    }
+
+    // 上下文快照只在配置后保留
+    ContextEvent event;
+    event.eventType = "alarm";
+    event.timestampMs = endMs;
+    event.context["geofence"] = "home";
+    context_engine::ContextMap got;
+    buffer.push(event);
+    if (buffer.lastContext("alarm", got)) failures++;
+    config.maxContexts = 4;
+    buffer.configure(config);
+    buffer.push(event);
+    if (!buffer.lastContext("alarm", got) || got["geofence"] != "home") failures++;
+    if (buffer.size() != config.maxEvents) failures++;
+
+    std::printf("check: %zu events (capacity %zu), %zu queries  %s\n", numEvents, config.maxEvents, numQueries,
+                failures == 0 ? "ok" : "FAIL");
+    return failures;
+}
+
+void runTiming(size_t numQueries) {
+    std::printf("timing: %zu recent + within queries\n", numQueries);
+    for (size_t capacity : {size_t(100), size_t(1000), size_t(10000)}) {
+        std::mt19937 rng(17);
+        int64_t endMs = steadyNowMs();
+        auto events = randomEvents(rng, capacity, endMs);
+        for (auto& e : events) e.type %= RARE_TYPE;
+        events.front().type = RARE_TYPE;
+
+        EventBufferConfig config;
+        config.maxEvents = capacity;
+        config.maxAgeMs = INT64_MAX / 2;
+        EventBuffer buffer(config);
+        EventTypeId ids[NUM_TYPES];
+        for (size_t t = 0; t < NUM_TYPES; t++) ids[t] = buffer.internType(TYPES[t]);
+        std::deque<Event> reference(events.begin(), events.end());
+        for (const auto& e : events) {
+            ContextEvent event;
+            event.eventType = TYPES[e.type];
+            event.timestampMs = e.ts;
+            buffer.push(event);
+        }
+
+        // 窗口覆盖整个缓冲区、查询稀有类型：旧实现要扫完全部事件
+        int64_t within = endMs - events.front().ts + 1;
+        size_t sink = 0;
+        auto t0 = std::chrono::steady_clock::now();
+        for (size_t q = 0; q < numQueries; q++) {
+            sink += bruteRecent(reference, RARE_TYPE, within, endMs);
+            sink += bruteSequence(reference, RARE_TYPE, q % RARE_TYPE, within, endMs);
+        }
+        double scanMs = elapsedMs(t0);
+
+        t0 = std::chrono::steady_clock::now();
+        for (size_t q = 0; q < numQueries; q++) {
+            sink += buffer.hasRecent(ids[RARE_TYPE], within, endMs);
+            sink += buffer.hasSequence(ids[RARE_TYPE], ids[q % RARE_TYPE], within, endMs);
+        }
+        double indexMs = elapsedMs(t0);
+
+        std::printf("  %5zu events  scan %8.3f us/query  indexed %8.3f us/query  (%.1fx)\n", capacity,
+                    scanMs * 1e3 / numQueries, indexMs * 1e3 / numQueries, indexMs > 0 ? scanMs / indexMs : 0.0);
+        if (sink == 0) std::printf("\n");
+    }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t numEvents = 3000;
+    size_t numQueries = 20000;
+    bool checkOnly = false;
+    perf::Args()
+        .option("--events", numEvents)
+        .option("--queries", numQueries)
+        .flag("--check-only", checkOnly)
+        .parse(argc, argv);
+
+    int failures = runCheck(numEvents, numQueries);
+    if (!checkOnly) runTiming(numQueries);
+
+    return perf::reportMatch(failures);
+}
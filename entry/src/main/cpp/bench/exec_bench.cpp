@@ -0,0 +1,201 @@
+/**
+ * exec_bench.cpp — posix_spawn + 管道事件循环 vs popen
+ *
+ * 校验：ChildProcess 的 stdout / stderr 分流与合并、退出码与终止信号、流式块按序到达且与 popen 读到的
+ * 字节一致；超时先发 SIGTERM、忽略 SIGTERM 时宽限期后 SIGKILL；其他线程 kill / cancel；
+ * 后台子进程占住管道时 shell 退出即返回；cwd 带引号。
+ * 然后对比短命令的启动耗时与大输出的吞吐。
+ *
+ * 用法: exec_bench [--runs N] [--check-only]
+ */
+#include "common/child_process.h"
+#include "perf_harness.h"
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+using native_common::ChildProcess;
+using native_common::ExitStatus;
+using native_common::OutputStream;
+using native_common::SpawnOptions;
+using perf::elapsedMs;
+using perf::check;
+
+namespace {
+
+struct RunOutput {
+    std::string out, err;
+    size_t chunks = 0;
+    ExitStatus status;
+    bool spawned = false;
+};
+
+RunOutput runCommand(const SpawnOptions& options, ChildProcess* external = nullptr) {
+    RunOutput r;
+    ChildProcess local;
+    ChildProcess& proc = external != nullptr ? *external : local;
+    r.spawned = proc.spawn(options);
+    if (!r.spawned) return r;
+    r.status = proc.run([&](OutputStream s, const char* data, size_t len) {
+        (s == OutputStream::STDERR ? r.err : r.out).append(data, len);
+        r.chunks++;
+    });
+    return r;
+}
+
+RunOutput runCommand(const std::string& command) {
+    SpawnOptions options;
+    options.command = command;
+    return runCommand(options);
+}
+
+/** 原实现：popen + fgets */
+std::string popenRead(const std::string& command, int* exitCode) {
+    std::string out;
+    FILE* pipe = popen(command.c_str(), "r");
+    if (pipe == nullptr) return out;
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), pipe)) > 0) out.append(buf, n);
+    int status = pclose(pipe);
+    if (exitCode != nullptr) *exitCode = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+    return out;
+}
+
+int runCheck() {
+    int failures = 0;
+
+    RunOutput r = runCommand("echo out; echo err >&2; exit 3");
+    failures += check("stdout / stderr split, exit code", r.spawned && r.out == "out\n" && r.err == "err\n" &&
+                                                              r.status.exitCode == 3 && r.status.signal == 0);
+
+    SpawnOptions merged;
+    merged.command = "echo a; echo b >&2; echo c";
+    merged.mergeStderr = true;
+    r = runCommand(merged);
+    failures += check("merged stderr keeps order", r.out == "a\nb\nc\n" && r.err.empty());
+
+    const std::string big = "seq 1 200000";
+    int popenExit = -1;
+    std::string expected = popenRead(big, &popenExit);
+    r = runCommand(big);
+    failures += check("large output matches popen", r.out == expected && popenExit == 0 && r.status.exitCode == 0);
+    std::printf("    (%zu bytes in %zu chunks)\n", r.out.size(), r.chunks);
+
+    // 流式：块在进程退出前就到达
+    {
+        SpawnOptions options;
+        options.command = "echo first; sleep 0.3; echo second";
+        ChildProcess proc;
+        proc.spawn(options);
+        auto t0 = std::chrono::steady_clock::now();
+        double firstAt = -1;
+        std::string out;
+        ExitStatus status = proc.run([&](OutputStream, const char* data, size_t len) {
+            if (firstAt < 0) firstAt = elapsedMs(t0);
+            out.append(data, len);
+        });
+        failures += check("chunks stream before exit", out == "first\nsecond\n" && firstAt >= 0 && firstAt < 200 &&
+                                                           status.durationMs >= 250);
+    }
+
+    // 超时
+    {
+        SpawnOptions options;
+        options.command = "sleep 5";
+        options.timeoutMs = 150;
+        r = runCommand(options);
+        failures += check("timeout sends SIGTERM", r.status.timedOut && r.status.signal == SIGTERM &&
+                                                       r.status.exitCode == -1 && r.status.durationMs < 1000);
+        options.command = "trap '' TERM; echo ready; sleep 5";
+        options.killGraceMs = 150;
+        r = runCommand(options);
+        failures += check("ignored SIGTERM escalates to SIGKILL", r.status.timedOut && r.status.signal == SIGKILL &&
+                                                                      r.out == "ready\n" && r.status.durationMs >= 280 &&
+                                                                      r.status.durationMs < 1500);
+    }
+
+    // 其他线程 kill / cancel
+    {
+        SpawnOptions options;
+        options.command = "sleep 5";
+        ChildProcess proc;
+        std::thread killer([&] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            proc.kill(SIGINT);
+        });
+        r = runCommand(options, &proc);
+        killer.join();
+        failures += check("kill from another thread", r.status.signal == SIGINT && !r.status.cancelled &&
+                                                          !proc.kill(SIGTERM));
+
+        ChildProcess cancelled;
+        std::thread canceller([&] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            cancelled.cancel();
+        });
+        r = runCommand(options, &cancelled);
+        canceller.join();
+        failures += check("cancel from another thread", r.status.cancelled && r.status.signal == SIGKILL &&
+                                                            r.status.durationMs < 1000);
+    }
+
+    r = runCommand("sleep 5 & echo bg");
+    failures += check("background child does not block return", r.out == "bg\n" && r.status.exitCode == 0 &&
+                                                                    r.status.durationMs < 1000);
+
+    {
+        SpawnOptions options;
+        options.command = "pwd";
+        options.cwd = "/";
+        r = runCommand(options);
+        SpawnOptions missing;
+        missing.command = "pwd";
+        missing.cwd = "/no such dir/it's";
+        RunOutput m = runCommand(missing);
+        failures += check("cwd", r.out == "/\n" && m.status.exitCode != 0 && m.out.empty());
+    }
+    return failures;
+}
+
+void runTiming(int runs) {
+    std::printf("\nshort command x %d\n", runs);
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < runs; i++) popenRead("true", nullptr);
+    double popenMs = elapsedMs(t0) / runs;
+    t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < runs; i++) runCommand("true");
+    double spawnMs = elapsedMs(t0) / runs;
+    std::printf("  popen %.3f ms   posix_spawn + poll %.3f ms\n", popenMs, spawnMs);
+
+    const std::string big = "head -c 50000000 /dev/zero";
+    t0 = std::chrono::steady_clock::now();
+    size_t popenBytes = popenRead(big, nullptr).size();
+    double popenBig = elapsedMs(t0);
+    size_t streamed = 0;
+    SpawnOptions options;
+    options.command = big;
+    ChildProcess proc;
+    proc.spawn(options);
+    t0 = std::chrono::steady_clock::now();
+    proc.run([&](OutputStream, const char*, size_t len) { streamed += len; });
+    double streamBig = elapsedMs(t0);
+    std::printf("  50 MB output: popen buffered %.1f ms (%zu MB resident)   streamed %.1f ms (%zu KB chunks)\n",
+                popenBig, popenBytes >> 20, streamBig, ChildProcess::READ_CHUNK >> 10);
+    if (streamed != popenBytes) std::printf("  byte count mismatch: %zu vs %zu\n", streamed, popenBytes);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    int runs = 200;
+    bool checkOnly = false;
+    perf::Args().option("--runs", runs).flag("--check-only", checkOnly).parse(argc, argv);
+
+    int failures = runCheck();
+    if (!checkOnly) runTiming(runs);
+
+    return perf::reportMatch(failures);
+}
@@ -0,0 +1,294 @@
+/**
+ * fusion_index_bench.cpp — 常驻编译融合索引 vs calculateAllConfidences 全量计算
+ *
+ * 在约 6 km × 6 km 范围内生成围栏，每个围栏学习若干 SSID / BT 设备；办公室围栏学到 50+ 个 BT 设备，
+ * 另有一批 “到处都能扫到” 的公共设备（耳机、手环）被多个围栏学到。
+ * 校验：scan 返回的每个围栏与 calculateConfidence 逐项一致；未返回的围栏全量置信度不超过
+ * floorConfidence()；最佳匹配与 “逐个计算、取严格更大者” 相同。
+ * 覆盖学习（阈值跨越）、清除、围栏移除 / 重新加入、无定位几条更新路径。
+ * 然后对比每次扫描的耗时（全量路径含按围栏组装 geofenceDistances，与 getLocationConfidence 一致）。
+ *
+ * 用法: fusion_index_bench [--fences N] [--bt N] [--scans N] [--check-only]
+ */
+#include "location_fusion/fusion_index.h"
+#include "perf_harness.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using geo_utils::Geofence;
+using location_fusion::FusionIndex;
+using location_fusion::FusionResult;
+using location_fusion::FusionScan;
+using location_fusion::LearnedSignals;
+using location_fusion::LocationFusion;
+using perf::elapsedMs;
+using perf::check;
+
+namespace {
+
+/** 同一份已学习信号同时维护在 map（原路径）和索引里 */
+struct World {
+    std::vector<Geofence> fences;
+    std::unordered_map<std::string, LearnedSignals> signals;
+    std::vector<std::vector<std::string>> fenceBt;  // 每个围栏常见的 BT 设备
+    std::vector<std::string> fenceSsid;
+    std::vector<std::string> commonBt;
+    FusionIndex index;
+};
+
+void learnBoth(World& w, size_t f, const std::string& ssid, const std::vector<std::string>& bt) {
+    LocationFusion::learnSignal(w.signals[w.fences[f].id], ssid, bt);
+    w.index.learn(w.fences[f].id, ssid, bt);
+}
+
+World buildWorld(size_t numFences, size_t officeBt, std::mt19937& rng) {
+    World w;
+    std::uniform_real_distribution<double> uLat(31.20, 31.254);
+    std::uniform_real_distribution<double> uLng(121.44, 121.503);
+    std::uniform_real_distribution<double> uRadius(50.0, 300.0);
+    for (int i = 0; i < 40; i++) w.commonBt.push_back("common_" + std::to_string(i));
+
+    for (size_t i = 0; i < numFences; i++) {
+        Geofence gf;
+        gf.id = "gf_" + std::to_string(i);
+        gf.name = gf.id;
+        gf.latitude = uLat(rng);
+        gf.longitude = uLng(rng);
+        gf.radiusMeters = uRadius(rng);
+        w.fences.push_back(gf);
+
+        bool office = i % 5 == 0;
+        w.fenceSsid.push_back(i % 7 == 3 ? "" : "ssid_" + std::to_string(i % 9 == 0 ? i / 9 : i));
+        std::vector<std::string> bt;
+        size_t nBt = office ? officeBt : static_cast<size_t>(rng() % 6);
+        for (size_t d = 0; d < nBt; d++) bt.push_back(gf.id + "_bt_" + std::to_string(d));
+        for (int c = 0; c < 3; c++) bt.push_back(w.commonBt[rng() % w.commonBt.size()]);
+        w.fenceBt.push_back(bt);
+    }
+    w.index.assignFences(w.fences);
+
+    // 学习次数 0 – 6 次，每次只看到部分设备，使一部分信号恰好跨过 / 没跨过阈值
+    for (size_t i = 0; i < numFences; i++) {
+        int visits = static_cast<int>(rng() % 7);
+        for (int v = 0; v < visits; v++) {
+            std::vector<std::string> seen;
+            for (const auto& d : w.fenceBt[i]) {
+                if (rng() % 4 != 0) seen.push_back(d);
+            }
+            learnBoth(w, i, rng() % 5 == 0 ? "guest_wifi" : w.fenceSsid[i], seen);
+        }
+    }
+    return w;
+}
+
+FusionScan randomScan(const World& w, std::mt19937& rng, size_t btCount) {
+    FusionScan s;
+    size_t f = rng() % w.fences.size();
+    const Geofence& gf = w.fences[f];
+    std::uniform_real_distribution<double> jitter(-0.004, 0.004);
+    s.hasLocation = rng() % 6 != 0;
+    s.latitude = gf.latitude + jitter(rng);
+    s.longitude = gf.longitude + jitter(rng);
+    s.gpsAccuracy = static_cast<double>(10 + rng() % 200);
+    int wifiKind = static_cast<int>(rng() % 4);
+    s.currentWifiSsid = wifiKind == 0 ? "" : wifiKind == 1 ? "unknown_ssid" : w.fenceSsid[f];
+    for (const auto& d : w.fenceBt[f]) {
+        if (s.currentBtDevices.size() < btCount && rng() % 2 == 0) s.currentBtDevices.push_back(d);
+    }
+    while (s.currentBtDevices.size() < btCount) {
+        s.currentBtDevices.push_back(rng() % 10 == 0 ? w.commonBt[rng() % w.commonBt.size()]
+                                                     : "stranger_" + std::to_string(rng() % 5000));
+    }
+    return s;
+}
+
+/** 原路径：所有围栏组装 geofenceDistances 后 calculateAllConfidences（getLocationConfidence 的做法） */
+std::vector<FusionResult> legacyAll(const World& w, const FusionScan& s) {
+    std::vector<std::pair<std::string, double>> distances;
+    distances.reserve(w.fences.size());
+    for (const auto& gf : w.fences) {
+        double d = s.hasLocation ? geo_utils::haversineDistance(s.latitude, s.longitude, gf.latitude, gf.longitude)
+                                 : 99999.0;
+        distances.emplace_back(gf.id, d);
+    }
+    LocationFusion fusion;
+    return fusion.calculateAllConfidences(distances, s.gpsAccuracy, s.currentWifiSsid, s.currentBtDevices, w.signals);
+}
+
+bool sameResult(const FusionResult& a, const FusionResult& b) {
+    return a.geofenceId == b.geofenceId && a.confidence == b.confidence && a.gpsConfidence == b.gpsConfidence &&
+           a.wifiConfidence == b.wifiConfidence && a.btConfidence == b.btConfidence && a.source == b.source;
+}
+
+/** scan 结果 ⊆ 全量结果且逐项一致，其余围栏不超过下限，最佳匹配相同 */
+bool agrees(const World& w, const FusionScan& s) {
+    auto all = legacyAll(w, s);
+    std::vector<FusionResult> got;
+    w.index.scan(s, got);
+
+    std::unordered_map<std::string, const FusionResult*> byId;
+    for (const auto& r : got) byId[r.geofenceId] = &r;
+    if (byId.size() != got.size()) return false;
+    size_t found = 0;
+    for (const auto& r : all) {
+        auto it = byId.find(r.geofenceId);
+        if (it == byId.end()) {
+            if (r.confidence > w.index.floorConfidence()) return false;
+        } else {
+            if (!sameResult(r, *it->second)) return false;
+            found++;
+        }
+    }
+    if (found != got.size()) return false;
+    for (size_t i = 1; i < got.size(); i++) {
+        if (got[i].confidence > got[i - 1].confidence) return false;
+    }
+
+    // getBestMatch：按列表顺序取严格更大者，> 0.5 才算
+    const FusionResult* best = nullptr;
+    for (const auto& r : all) {
+        if (r.confidence > (best ? best->confidence : 0.0)) best = &r;
+    }
+    bool legacyHas = best && best->confidence > 0.5;
+    bool indexHas = !got.empty() && got[0].confidence > 0.5;
+    return legacyHas == indexHas && (!legacyHas || got[0].geofenceId == best->geofenceId);
+}
+
+bool agreesMany(const World& w, std::mt19937& rng, int scans, size_t btCount) {
+    for (int i = 0; i < scans; i++) {
+        if (!agrees(w, randomScan(w, rng, btCount))) return false;
+    }
+    return true;
+}
+
+// ============================================================
+// 校验
+// ============================================================
+
+int runCheck(size_t numFences, size_t officeBt) {
+    std::printf("check (%zu fences):\n", numFences);
+    int failures = 0;
+    std::mt19937 rng(5);
+    World w = buildWorld(numFences, officeBt, rng);
+
+    failures += check("scan matches calculateAllConfidences", agreesMany(w, rng, 400, 60));
+    failures += check("short BT lists / no BT", agreesMany(w, rng, 100, 3) && agreesMany(w, rng, 100, 0));
+
+    // 继续学习越过阈值
+    for (int round = 0; round < 4; round++) {
+        for (size_t i = 0; i < numFences; i += 3) learnBoth(w, i, w.fenceSsid[i], w.fenceBt[i]);
+    }
+    failures += check("learning past the threshold", agreesMany(w, rng, 200, 60));
+
+    // 清除一部分围栏的信号，再用 setSignals 恢复另一部分
+    for (size_t i = 0; i < numFences; i += 4) {
+        w.signals.erase(w.fences[i].id);
+        w.index.clearSignals(w.fences[i].id);
+    }
+    for (size_t i = 2; i < numFences; i += 8) {
+        LearnedSignals sig;
+        sig.wifiSsids[w.fenceSsid[i].empty() ? "restored" : w.fenceSsid[i]] = 5;
+        for (const auto& d : w.fenceBt[i]) sig.btDevices[d] = 4;
+        sig.totalObservations = 6;
+        w.signals[w.fences[i].id] = sig;
+        w.index.setSignals(w.fences[i].id, sig);
+    }
+    failures += check("clearSignals / setSignals", agreesMany(w, rng, 200, 60));
+
+    // 移除围栏几何：信号保留但不再返回；重新加入后恢复
+    std::vector<Geofence> removed;
+    for (size_t i = 1; i < numFences; i += 6) removed.push_back(w.fences[i]);
+    for (const auto& gf : removed) w.index.removeFence(gf.id);
+    World view;
+    for (const auto& gf : w.fences) {
+        bool gone = false;
+        for (const auto& r : removed) gone = gone || r.id == gf.id;
+        if (!gone) view.fences.push_back(gf);
+    }
+    bool removedOk = w.index.fenceCount() == view.fences.size() && !w.index.removeFence(removed[0].id);
+    for (int i = 0; removedOk && i < 200; i++) {
+        FusionScan s = randomScan(w, rng, 60);
+        std::vector<FusionResult> got;
+        w.index.scan(s, got);
+        for (const auto& r : got) {
+            for (const auto& gone : removed) removedOk = removedOk && r.geofenceId != gone.id;
+        }
+    }
+    // 重新加入排在列表末尾；全量对照同样把它们挪到末尾
+    for (const auto& gf : removed) {
+        w.index.upsertFence(gf);
+        view.fences.push_back(gf);
+    }
+    std::swap(w.fences, view.fences);
+    failures += check("removeFence / upsertFence", removedOk && agreesMany(w, rng, 200, 60));
+    std::swap(w.fences, view.fences);
+
+    w.signals.clear();
+    w.index.clearAllSignals();
+    std::vector<FusionResult> got;
+    FusionScan s = randomScan(w, rng, 60);
+    s.hasLocation = false;
+    w.index.scan(s, got);
+    failures += check("clearAllSignals / no location", got.empty() && agreesMany(w, rng, 50, 60));
+    return failures;
+}
+
+// ============================================================
+// 计时
+// ============================================================
+
+void runTiming(size_t numFences, size_t officeBt, int scans) {
+    std::mt19937 rng(9);
+    World w = buildWorld(numFences, officeBt, rng);
+    for (int round = 0; round < 3; round++) {
+        for (size_t i = 0; i < numFences; i++) learnBoth(w, i, w.fenceSsid[i], w.fenceBt[i]);
+    }
+    std::vector<FusionScan> qs;
+    for (int i = 0; i < 256; i++) qs.push_back(randomScan(w, rng, officeBt + 10));
+
+    std::printf("timing: %zu fences, %zu BT devices per scan, %d scans\n", numFences, officeBt + 10, scans);
+    size_t sink = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < scans; i++) sink += legacyAll(w, qs[i % qs.size()]).size();
+    double legacyUs = elapsedMs(t0) * 1000.0 / scans;
+
+    std::vector<FusionResult> got;
+    size_t touched = 0;
+    t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < scans; i++) {
+        w.index.scan(qs[i % qs.size()], got);
+        sink += got.size();
+        touched += w.index.lastTouched();
+    }
+    double indexUs = elapsedMs(t0) * 1000.0 / scans;
+
+    std::printf("  calculateAllConfidences  %9.2f us / scan\n", legacyUs);
+    std::printf("  FusionIndex::scan        %9.2f us / scan  (%.1fx, %.1f fences touched)\n", indexUs,
+                indexUs > 0 ? legacyUs / indexUs : 0.0, static_cast<double>(touched) / scans);
+    if (sink == 1) std::printf("\n");
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t numFences = 300;
+    size_t officeBt = 55;
+    int scans = 2000;
+    bool checkOnly = false;
+    perf::Args()
+        .option("--fences", numFences)
+        .option("--bt", officeBt)
+        .option("--scans", scans)
+        .flag("--check-only", checkOnly)
+        .parse(argc, argv);
+
+    int failures = runCheck(numFences, officeBt);
+    if (!checkOnly) runTiming(numFences, officeBt, scans);
+
+    return perf::reportMatch(failures);
+}
@@ -0,0 +1,158 @@
+/**
+ * geo_batch_bench.cpp — 批量 haversine 内核：精度校验 + 吞吐
+ *
+ * 精度：随机全球点对、近距离（0.01 m – 5 km）、重合点、极点、近对跖点，
+ * 分别和标量 haversineDistance、标量内核对照，超出容差即返回非 0。
+ * 吞吐：同一组点逐对 haversineDistance vs haversineMany。
+ *
+ * 用法: geo_batch_bench [--points N] [--check-only]
+ */
+#include "geo_batch.h"
+#include "trace_gen.h"
+#include "perf_harness.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using geo_utils::GeoPointSoA;
+using geo_utils::haversineDistance;
+using geo_utils::haversineMany;
+using perf::elapsedMs;
+
+namespace {
+
+struct CheckCase {
+    const char* name;
+    double lat;
+    double lng;
+    GeoPointSoA pts;
+};
+
+/** 相对 haversineDistance 的容差：1 µm 或 1e-9 相对误差 */
+bool withinTolerance(double expected, double actual) {
+    return std::abs(expected - actual) <= std::max(1e-6, 1e-9 * expected);
+}
+
+int checkCase(const CheckCase& c) {
+    std::vector<double> batch;
+    haversineMany(c.lat, c.lng, c.pts, batch);
+    std::vector<double> scalarKernel(c.pts.size());
+    geo_utils::haversineManyScalar(c.lat, c.lng, c.pts, 0, c.pts.size(), scalarKernel.data());
+
+    int failures = 0;
+    double maxAbs = 0;
+    for (size_t i = 0; i < c.pts.size(); i++) {
+        double expected = haversineDistance(c.lat, c.lng, c.pts.lat[i], c.pts.lng[i]);
+        maxAbs = std::max(maxAbs, std::abs(expected - batch[i]));
+        if (!withinTolerance(expected, batch[i]) || !withinTolerance(scalarKernel[i], batch[i])) {
+            if (failures < 5) {
+                std::printf("  %s[%zu]: (%.8f, %.8f) expected %.9f, batch %.9f, scalar kernel %.9f\n", c.name, i,
+                            c.pts.lat[i], c.pts.lng[i], expected, batch[i], scalarKernel[i]);
+            }
+            failures++;
+        }
+    }
+    std::printf("%-12s %8zu points  max |err| %.3e m  %s\n", c.name, c.pts.size(), maxAbs,
+                failures == 0 ? "ok" : "FAIL");
+    return failures;
+}
+
+int runAccuracyChecks() {
+    std::mt19937_64 rng(7);
+    std::uniform_real_distribution<double> uLat(-90.0, 90.0);
+    std::uniform_real_distribution<double> uLng(-180.0, 180.0);
+    std::uniform_real_distribution<double> uUnit(0.0, 1.0);
+
+    std::vector<CheckCase> cases;
+
+    // 全球随机点对，覆盖 asin 的两个分支
+    CheckCase global{"global", 12.5, -45.0, {}};
+    for (int i = 0; i < 20001; i++) global.pts.push_back(uLat(rng), uLng(rng));
+    cases.push_back(std::move(global));
+
+    // 近距离：对数均匀 0.01 m – 5 km，随机方向
+    CheckCase nearby{"nearby", 31.2304, 121.4737, {}};
+    for (int i = 0; i < 20001; i++) {
+        double meters = std::pow(10.0, -2.0 + uUnit(rng) * 5.7);
+        double bearing = uUnit(rng) * 2 * geo_utils::PI;
+        double dLat = meters * std::cos(bearing) / geo_utils::METERS_PER_DEG_LAT;
+        double dLng = meters * std::sin(bearing) /
+                      (geo_utils::METERS_PER_DEG_LAT * std::cos(geo_utils::toRad(nearby.lat)));
+        nearby.pts.push_back(nearby.lat + dLat, nearby.lng + dLng);
+    }
+    cases.push_back(std::move(nearby));
+
+    // 重合点与 ±180° 经线两侧
+    CheckCase same{"same/dateline", 0.0, 179.9999, {}};
+    for (int i = 0; i < 7; i++) same.pts.push_back(0.0, 179.9999);
+    same.pts.push_back(0.0, -179.9999);
+    same.pts.push_back(0.0001, -180.0);
+    cases.push_back(std::move(same));
+
+    // 极点附近，经度任意
+    CheckCase pole{"pole", 89.9999, 0.0, {}};
+    for (int i = 0; i < 1001; i++) pole.pts.push_back(90.0 - uUnit(rng) * 0.01, uLng(rng));
+    cases.push_back(std::move(pole));
+
+    // 近对跖点：h → 1，haversine 自身精度下降，容差按相对误差
+    CheckCase antipode{"antipode", 10.0, 20.0, {}};
+    for (int i = 0; i < 1001; i++) antipode.pts.push_back(-10.0 + (uUnit(rng) - 0.5) * 0.1, -160.0 + (uUnit(rng) - 0.5) * 0.1);
+    cases.push_back(std::move(antipode));
+
+    int failures = 0;
+    for (const auto& c : cases) failures += checkCase(c);
+    return failures;
+}
+
+void runThroughput(size_t numPoints) {
+    auto trace = bench::makeTrace(numPoints, 42);
+    GeoPointSoA soa;
+    soa.assign(trace);
+
+    const int queries = 200;
+    std::vector<double> out(numPoints);
+    double sink = 0;
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (int q = 0; q < queries; q++) {
+        const auto& c = trace[(q * 7919) % numPoints];
+        for (size_t i = 0; i < numPoints; i++) {
+            out[i] = haversineDistance(c.latitude, c.longitude, trace[i].latitude, trace[i].longitude);
+        }
+        sink += out[q % numPoints];
+    }
+    double scalarMs = elapsedMs(t0);
+
+    t0 = std::chrono::steady_clock::now();
+    for (int q = 0; q < queries; q++) {
+        const auto& c = trace[(q * 7919) % numPoints];
+        haversineMany(c.latitude, c.longitude, soa, 0, numPoints, out.data());
+        sink += out[q % numPoints];
+    }
+    double batchMs = elapsedMs(t0);
+
+    double pairs = static_cast<double>(queries) * numPoints;
+    std::printf("throughput (%s): %zu points x %d queries\n", geo_utils::geoBatchBackend(), numPoints, queries);
+    std::printf("  haversineDistance %8.2f ms  %6.1f Mpairs/s\n", scalarMs, pairs / scalarMs / 1e3);
+    std::printf("  haversineMany     %8.2f ms  %6.1f Mpairs/s  (%.1fx)\n", batchMs, pairs / batchMs / 1e3,
+                batchMs > 0 ? scalarMs / batchMs : 0.0);
+    if (sink == 42.0) std::printf("\n");  // 防止循环被优化掉
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t numPoints = 10000;
+    bool checkOnly = false;
+    perf::Args().option("--points", numPoints).flag("--check-only", checkOnly).parse(argc, argv);
+
+    std::printf("backend: %s\n", geo_utils::geoBatchBackend());
+    int failures = runAccuracyChecks();
+    if (!checkOnly && numPoints > 0) runThroughput(numPoints);
+
+    std::printf("%s\n", failures == 0 ? "accuracy: ok" : "accuracy: FAIL");
+    return failures == 0 ? 0 : 1;
+}
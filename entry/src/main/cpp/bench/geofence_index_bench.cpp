@@ -0,0 +1,140 @@
+/**
+ * geofence_index_bench.cpp — 常驻围栏索引 vs getGeofencesAtLocation 全量扫描
+ *
+ * 在城市范围内随机生成围栏（50 – 500 m，少量 20 km 的大围栏），随机查询点，
+ * 校验 queryNearby / queryContaining 与全量扫描后过滤的结果一致，并对比耗时。
+ * 中途随机删除 / 替换一部分围栏，覆盖增量更新路径。
+ *
+ * 用法: geofence_index_bench [--fences N] [--queries N] [--margin M] [--check-only]
+ */
+#include "geofence_index.h"
+#include "perf_harness.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+using geo_utils::Geofence;
+using geo_utils::GeofenceIndex;
+using geo_utils::GeofenceMatch;
+using perf::elapsedMs;
+
+namespace {
+
+std::vector<std::string> ids(const std::vector<GeofenceMatch>& ms) {
+    std::vector<std::string> out;
+    for (const auto& m : ms) out.push_back(m.geofenceId);
+    std::sort(out.begin(), out.end());
+    return out;
+}
+
+/** 全量扫描后按同样条件过滤，作为对照 */
+std::vector<GeofenceMatch> bruteNearby(double lat, double lon, const std::vector<Geofence>& fences, double margin) {
+    // getGeofencesAtLocation 的结果与 fences 一一对应
+    auto all = geo_utils::getGeofencesAtLocation(lat, lon, fences);
+    std::vector<GeofenceMatch> out;
+    for (size_t i = 0; i < all.size(); i++) {
+        if (all[i].distance <= fences[i].radiusMeters + margin) out.push_back(all[i]);
+    }
+    return out;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t numFences = 1000;
+    size_t numQueries = 2000;
+    double margin = 300.0;
+    bool checkOnly = false;
+    perf::Args()
+        .option("--fences", numFences)
+        .option("--queries", numQueries)
+        .option("--margin", margin)
+        .flag("--check-only", checkOnly)
+        .parse(argc, argv);
+
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<double> uLat(31.10, 31.35);
+    std::uniform_real_distribution<double> uLng(121.30, 121.65);
+    std::uniform_real_distribution<double> uRadius(50.0, 500.0);
+
+    std::vector<Geofence> fences;
+    for (size_t i = 0; i < numFences; i++) {
+        Geofence gf;
+        gf.id = "gf_" + std::to_string(i);
+        gf.latitude = uLat(rng);
+        gf.longitude = uLng(rng);
+        gf.radiusMeters = (i % 200 == 0) ? 20000.0 : uRadius(rng);
+        fences.push_back(gf);
+    }
+
+    GeofenceIndex index;
+    index.assign(fences);
+
+    // 增量更新：删除每 7 个中的一个，移动每 11 个中的一个
+    std::vector<Geofence> kept;
+    for (size_t i = 0; i < fences.size(); i++) {
+        if (i % 7 == 3) {
+            index.remove(fences[i].id);
+            continue;
+        }
+        if (i % 11 == 5) {
+            fences[i].latitude = uLat(rng);
+            fences[i].longitude = uLng(rng);
+            index.upsert(fences[i]);
+        }
+        kept.push_back(fences[i]);
+    }
+    fences.swap(kept);
+
+    std::vector<std::pair<double, double>> queries;
+    for (size_t q = 0; q < numQueries; q++) queries.emplace_back(uLat(rng), uLng(rng));
+
+    int failures = 0;
+    size_t nearbyTotal = 0, containingTotal = 0;
+    for (const auto& [lat, lon] : queries) {
+        auto got = index.queryNearby(lat, lon, margin);
+        auto want = bruteNearby(lat, lon, fences, margin);
+        auto inside = index.queryContaining(lat, lon);
+        auto wantInside = bruteNearby(lat, lon, fences, 0.0);
+        nearbyTotal += got.size();
+        containingTotal += inside.size();
+        if (ids(got) != ids(want) || ids(inside) != ids(wantInside)) {
+            if (failures < 5) {
+                std::printf("  mismatch at (%.6f, %.6f): nearby %zu vs %zu, containing %zu vs %zu\n", lat, lon,
+                            got.size(), want.size(), inside.size(), wantInside.size());
+            }
+            failures++;
+        }
+    }
+    std::printf("%zu fences (%zu after updates), %zu queries, margin %.0f m\n", numFences, index.size(),
+                numQueries, margin);
+    std::printf("avg nearby %.1f, avg containing %.1f\n", static_cast<double>(nearbyTotal) / numQueries,
+                static_cast<double>(containingTotal) / numQueries);
+
+    if (!checkOnly) {
+        double sink = 0;
+        auto t0 = std::chrono::steady_clock::now();
+        for (const auto& [lat, lon] : queries) {
+            auto all = geo_utils::getGeofencesAtLocation(lat, lon, fences);
+            sink += all.size();
+        }
+        double scanMs = elapsedMs(t0);
+
+        t0 = std::chrono::steady_clock::now();
+        for (const auto& [lat, lon] : queries) {
+            auto near = index.queryNearby(lat, lon, margin);
+            sink += near.size();
+        }
+        double indexMs = elapsedMs(t0);
+
+        std::printf("getGeofencesAtLocation %8.3f us/query\n", scanMs * 1e3 / numQueries);
+        std::printf("queryNearby            %8.3f us/query  (%.1fx)\n", indexMs * 1e3 / numQueries,
+                    indexMs > 0 ? scanMs / indexMs : 0.0);
+        if (sink < 0) std::printf("\n");
+    }
+
+    return perf::reportMatch(failures);
+}
@@ -0,0 +1,236 @@
+/**
+ * incremental_bench.cpp — 增量 DBSCAN vs 全量重聚类
+ *
+ * 模拟后台任务：先载入历史点，然后每批追加新点并滑动窗口过期旧点，
+ * 对比 IncrementalDBSCAN（insert + expire + snapshot）与每次全量 cluster() 的耗时。
+ *
+ * 校验（每批）：存活点与滑动窗口一致；增量结果的划分符合 DBSCAN 定义 ——
+ * 核心点判定相同，核心点之间的连通分量与增量簇一一对应，边界点属于任意一个相邻核心点所在的簇
+ * （边界点归属与扫描顺序有关，全量结果也只是其中一种），其余点为噪声；常去地点的簇编号在批次之间保持稳定。
+ * 簇数不直接比较：只含少量边界点的小簇是否达到 minSamples 同样取决于边界点归属。
+ *
+ * 用法: incremental_bench [--points N] [--batches N] [--batch-size N] [--check-only]
+ */
+#include "dbscan_cluster.h"
+#include "incremental_dbscan.h"
+#include "trace_gen.h"
+#include "perf_harness.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <numeric>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using dbscan::ClusterConfig;
+using dbscan::ClusterResult;
+using dbscan::DBSCAN;
+using dbscan::IncrementalDBSCAN;
+using geo_utils::GeoPoint;
+using bench::makeTrace;
+using perf::elapsedMs;
+
+namespace {
+
+size_t findRoot(std::vector<size_t>& parent, size_t i) {
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+/**
+ * 按 DBSCAN 定义逐点校验增量结果的划分（邻居查询与 DBSCAN / IncrementalDBSCAN 相同的网格 + 弦长比较）
+ * @return 不符合的点数，第一处不符合写入 detail
+ */
+size_t partitionMismatches(const IncrementalDBSCAN& inc, const std::vector<GeoPoint>& window, std::string& detail) {
+    const ClusterConfig& config = inc.config();
+    geo_utils::GeoPointSoA soa;
+    soa.assign(window);
+    geo_utils::SpatialGrid grid(config.epsilonMeters);
+    grid.build(window);
+
+    std::vector<std::vector<size_t>> neighbors(window.size());
+    std::vector<uint8_t> core(window.size(), 0);
+    for (size_t i = 0; i < window.size(); i++) {
+        dbscan::queryNeighborsAt(grid, soa, i, config.epsilonMeters, neighbors[i]);
+        core[i] = neighbors[i].size() >= static_cast<size_t>(config.minSamples);
+    }
+
+    // 核心点连通分量
+    std::vector<size_t> parent(window.size());
+    std::iota(parent.begin(), parent.end(), 0);
+    for (size_t i = 0; i < window.size(); i++) {
+        if (!core[i]) continue;
+        for (size_t q : neighbors[i]) {
+            if (core[q]) parent[findRoot(parent, i)] = findRoot(parent, q);
+        }
+    }
+
+    // 增量结果按时间戳对回窗口下标（合成轨迹的时间戳唯一）
+    std::unordered_map<int64_t, size_t> byTimestamp;
+    for (size_t i = 0; i < window.size(); i++) byTimestamp[window[i].timestamp] = i;
+    std::vector<int> label(window.size(), -1);
+    std::vector<uint8_t> incCore(window.size(), 0);
+    std::vector<uint8_t> seen(window.size(), 0);
+    size_t mismatches = 0;
+    auto fail = [&](const std::string& what) {
+        if (mismatches++ == 0) detail = what;
+    };
+    inc.forEachPoint([&](const GeoPoint& p, int clusterId, bool isCore) {
+        auto it = byTimestamp.find(p.timestamp);
+        if (it == byTimestamp.end() || seen[it->second]) {
+            fail("point not in window");
+            return;
+        }
+        seen[it->second] = 1;
+        label[it->second] = clusterId;
+        incCore[it->second] = isCore;
+    });
+
+    std::unordered_map<size_t, int> rootToLabel;
+    std::unordered_map<int, size_t> labelToRoot;
+    for (size_t i = 0; i < window.size(); i++) {
+        if (!seen[i]) {
+            fail("window point missing");
+        } else if (core[i] != incCore[i]) {
+            fail("core flag differs at point " + std::to_string(i));
+        } else if (core[i]) {
+            size_t root = findRoot(parent, i);
+            auto r = rootToLabel.emplace(root, label[i]).first;
+            auto l = labelToRoot.emplace(label[i], root).first;
+            if (label[i] < 0 || r->second != label[i] || l->second != root) {
+                fail("core component split or merged at point " + std::to_string(i));
+            }
+        } else {
+            bool adjacent = false, inAdjacent = false;
+            for (size_t q : neighbors[i]) {
+                if (!core[q]) continue;
+                adjacent = true;
+                if (label[q] == label[i]) inAdjacent = true;
+            }
+            if (adjacent ? !inAdjacent : label[i] >= 0) {
+                fail("border / noise label wrong at point " + std::to_string(i));
+            }
+        }
+    }
+    return mismatches;
+}
+
+/**
+ * 离 (lat, lng) 最近的核心点所在的簇编号
+ * 不用簇中心：通勤散点会把簇拉长，中心偏离常去地点，分裂后最近的中心可能换成另一个簇
+ */
+int anchorCluster(const IncrementalDBSCAN& inc, double lat, double lng) {
+    int best = -1;
+    double bestDist = 1e18;
+    inc.forEachPoint([&](const GeoPoint& p, int clusterId, bool isCore) {
+        if (!isCore) return;
+        double d = geo_utils::haversineDistance(lat, lng, p.latitude, p.longitude);
+        if (d < bestDist) {
+            bestDist = d;
+            best = clusterId;
+        }
+    });
+    return best;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t numPoints = 5000;
+    size_t batches = 10;
+    size_t batchSize = 20;
+    bool checkOnly = false;
+
+    perf::Args()
+        .option("--points", numPoints)
+        .option("--batches", batches)
+        .option("--batch-size", batchSize)
+        .flag("--check-only", checkOnly)
+        .parse(argc, argv);
+
+    size_t streamed = std::min(numPoints, batches * batchSize);
+    auto trace = makeTrace(numPoints, 42);
+    size_t initial = numPoints - streamed;
+
+    // 窗口长度取初始历史跨度的 90%，保证每批都有旧点过期
+    int64_t window = static_cast<int64_t>((trace[initial - 1].timestamp - trace[0].timestamp) * 0.9);
+
+    ClusterConfig config;
+    IncrementalDBSCAN inc(config);
+    DBSCAN full(config);
+
+    std::deque<GeoPoint> live(trace.begin(), trace.begin() + initial);
+    auto t0 = std::chrono::steady_clock::now();
+    inc.insert(std::vector<GeoPoint>(live.begin(), live.end()));
+    auto prev = inc.snapshot();
+    std::printf("initial load: %zu points, %zu clusters, %.2f ms\n", initial, prev.size(), elapsedMs(t0));
+
+    // 记录各常去地点对应的簇 id，检查批次之间是否稳定
+    const double anchors[][2] = {{31.2304, 121.4737}, {31.2397, 121.4998}};
+    int anchorIds[2] = {anchorCluster(inc, anchors[0][0], anchors[0][1]),
+                        anchorCluster(inc, anchors[1][0], anchors[1][1])};
+
+    if (!checkOnly) {
+        std::printf("%6s %8s %10s %14s %12s %9s\n", "batch", "points", "clusters", "incremental(ms)", "full(ms)",
+                    "speedup");
+    }
+
+    double incTotal = 0, fullTotal = 0;
+    int failures = 0;
+    std::vector<ClusterResult> incResult;
+    for (size_t b = 0; b < batches && initial + b * batchSize < numPoints; b++) {
+        size_t lo = initial + b * batchSize;
+        size_t hi = std::min(lo + batchSize, numPoints);
+        std::vector<GeoPoint> fresh(trace.begin() + lo, trace.begin() + hi);
+        int64_t cutoff = fresh.back().timestamp - window;
+
+        for (const auto& p : fresh) live.push_back(p);
+        while (!live.empty() && live.front().timestamp < cutoff) live.pop_front();
+
+        t0 = std::chrono::steady_clock::now();
+        inc.insert(fresh);
+        inc.expire(cutoff);
+        incResult = inc.snapshot();
+        double incMs = elapsedMs(t0);
+
+        std::vector<GeoPoint> window(live.begin(), live.end());
+        if (!checkOnly) {
+            t0 = std::chrono::steady_clock::now();
+            full.cluster(window);
+            double fullMs = elapsedMs(t0);
+            incTotal += incMs;
+            fullTotal += fullMs;
+            std::printf("%6zu %8zu %10zu %14.2f %12.2f %8.1fx\n", b, inc.size(), incResult.size(), incMs, fullMs,
+                        incMs > 0 ? fullMs / incMs : 0.0);
+        }
+
+        if (inc.size() != window.size()) {
+            std::printf("  batch %zu size mismatch: incremental %zu vs window %zu\n", b, inc.size(), window.size());
+            failures++;
+        }
+        std::string detail;
+        size_t bad = partitionMismatches(inc, window, detail);
+        if (bad > 0) {
+            std::printf("  batch %zu partition mismatch: %zu points (%s)\n", b, bad, detail.c_str());
+            failures++;
+        }
+        for (int a = 0; a < 2; a++) {
+            int id = anchorCluster(inc, anchors[a][0], anchors[a][1]);
+            if (id != anchorIds[a]) {
+                std::printf("  batch %zu unstable id: cluster_%d -> cluster_%d\n", b, anchorIds[a], id);
+                failures++;
+            }
+        }
+    }
+
+    if (!checkOnly) {
+        std::printf("total: incremental %.2f ms, full %.2f ms (%.1fx)\n", incTotal, fullTotal,
+                    incTotal > 0 ? fullTotal / incTotal : 0.0);
+    }
+    return perf::reportMatch(failures);
+}
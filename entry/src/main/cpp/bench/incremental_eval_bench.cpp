@@ -0,0 +1,338 @@
+/**
+ * incremental_eval_bench.cpp — 托盘变化跟踪 + evaluateIncremental vs 定时全量 evaluate
+ *
+ * 校验：随机游走的上下文（每步只改少数 key，偶尔改动分裂 key、推入事件、增删规则）下，
+ * evaluateIncremental 每一步的结果（规则 / 置信度 / 顺序）与 evaluate 完全一致。
+ * SensorDataTray：阈值内的数值抖动不推进 epoch，getChangedSince 按 epoch 不漏报，订阅回调逐次收到变化。
+ *
+ * 然后模拟静止手机的一天（每 2 分钟刷新一次托盘）：只有 epoch 前进时才评估、且只重匹配
+ * 受影响的规则，对比旧做法（每次都全量 evaluate）的评估次数、规则匹配次数与耗时。
+ *
+ * 用法: incremental_eval_bench [--rules N] [--steps N] [--check-only]
+ */
+#include "context_engine.h"
+#include "data_tray/data_tray.h"
+#include "perf_harness.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+using context_engine::Condition;
+using context_engine::ContextEvent;
+using context_engine::ContextMap;
+using context_engine::IncrementalStats;
+using context_engine::MatchResults;
+using context_engine::RateLimits;
+using context_engine::Rule;
+using context_engine::RuleEngine;
+using data_tray::SensorDataTray;
+using data_tray::TrayValue;
+using perf::elapsedMs;
+using perf::check;
+
+namespace {
+
+int64_t steadyNowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct KeySpec {
+    const char* key;
+    std::vector<const char*> values;
+};
+
+const std::vector<KeySpec>& keySpecs() {
+    static const std::vector<KeySpec> specs = {
+        {"timeOfDay", {"morning", "noon", "afternoon", "evening", "night"}},
+        {"isWeekend", {"true", "false"}},
+        {"motionState", {"stationary", "walking", "running", "driving"}},
+        {"geofence", {"home", "work", "gym", "mall"}},
+        {"networkType", {"wifi", "cellular", "none"}},
+        {"isCharging", {"true", "false"}},
+        {"batteryLevel", {"15", "30", "50", "80"}},
+        {"hour", {"7", "9", "12", "18", "22"}},
+        {"stepCount", {"1000", "5000", "10000"}},
+    };
+    return specs;
+}
+
+Rule randomRule(std::mt19937& rng, int id) {
+    const auto& specs = keySpecs();
+    Rule r;
+    r.id = "rule_" + std::to_string(id);
+    r.name = r.id;
+    r.priority = 1.0 + (rng() % 4) * 0.5;
+    r.cooldownMs = 0;
+    r.enabled = rng() % 10 != 0;
+    r.action = {"action_" + std::to_string(rng() % 30), "suggestion", "{}"};
+
+    int numConds = 1 + static_cast<int>(rng() % 3);
+    for (int c = 0; c < numConds; c++) {
+        const auto& spec = specs[rng() % specs.size()];
+        Condition cond;
+        cond.key = spec.key;
+        bool numeric = cond.key == "batteryLevel" || cond.key == "hour" || cond.key == "stepCount";
+        if (numeric) {
+            cond.op = rng() % 2 ? "gte" : "lt";
+            cond.value = spec.values[rng() % spec.values.size()];
+        } else {
+            cond.op = rng() % 5 ? "eq" : "neq";
+            cond.value = spec.values[rng() % spec.values.size()];
+        }
+        r.conditions.push_back(cond);
+    }
+    if (rng() % 12 == 0) r.conditions.push_back({"event:screen_on", "recent", "600000"});
+    return r;
+}
+
+std::vector<Rule> randomRules(std::mt19937& rng, int n) {
+    std::vector<Rule> rules;
+    for (int i = 0; i < n; i++) rules.push_back(randomRule(rng, i));
+    return rules;
+}
+
+void noLimits(RuleEngine& engine) {
+    RateLimits limits;
+    limits.categoryCooldownCount = 1 << 30;
+    limits.globalMaxPerHour = 1 << 30;
+    engine.setLimits(limits);
+}
+
+bool sameResults(const MatchResults& a, const MatchResults& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].ruleId != b[i].ruleId || a[i].confidence != b[i].confidence) return false;
+    }
+    return true;
+}
+
+// ============================================================
+// 校验
+// ============================================================
+
+int checkEquivalence(int numRules, int steps) {
+    std::mt19937 rng(11);
+    auto rules = randomRules(rng, numRules);
+    RuleEngine full, incremental;
+    full.loadRules(rules);
+    incremental.loadRules(rules);
+    noLimits(full);
+    noLimits(incremental);
+
+    const auto& specs = keySpecs();
+    ContextMap ctx;
+    for (const auto& spec : specs) ctx[spec.key] = spec.values[0];
+
+    MatchResults a, b;
+    IncrementalStats stats;
+    size_t mismatches = 0, fullPasses = 0, partialMatches = 0, partialSteps = 0, nonEmpty = 0;
+    int nextId = numRules;
+    for (int step = 0; step < steps; step++) {
+        // 大多数步只改 0–2 个 key；偶尔删掉 / 加回一个 key
+        int edits = static_cast<int>(rng() % 3);
+        for (int e = 0; e < edits; e++) {
+            const auto& spec = specs[rng() % specs.size()];
+            if (rng() % 10 == 0) {
+                ctx.erase(spec.key);
+            } else {
+                ctx[spec.key] = spec.values[rng() % spec.values.size()];
+            }
+        }
+        if (rng() % 40 == 0) {
+            ctx["unrelatedKey"] = std::to_string(step);  // 没有规则引用的 key 不应触发重匹配
+        }
+        if (step % 97 == 50) {
+            ContextEvent ev{{}, steadyNowMs(), "screen_on"};
+            full.pushEvent(ev);
+            incremental.pushEvent(ev);
+        }
+        if (step % 150 == 149) {
+            Rule r = randomRule(rng, nextId++);
+            full.addRule(r);
+            incremental.addRule(r);
+        }
+        if (step % 211 == 210) {
+            std::string victim = "rule_" + std::to_string(rng() % numRules);
+            full.removeRule(victim);
+            incremental.removeRule(victim);
+        }
+
+        full.evaluate(ctx, 5, a);
+        incremental.evaluateIncremental(ctx, 5, b, &stats);
+        if (!sameResults(a, b)) mismatches++;
+        if (!a.empty()) nonEmpty++;
+        if (stats.full) {
+            fullPasses++;
+        } else {
+            partialSteps++;
+            partialMatches += stats.rulesMatched;
+        }
+    }
+    std::printf("    (%d steps: %zu full passes, %zu incremental averaging %.1f rule matches, %zu non-empty)\n",
+                steps, fullPasses, partialSteps,
+                partialSteps ? static_cast<double>(partialMatches) / static_cast<double>(partialSteps) : 0.0,
+                nonEmpty);
+    return check("evaluateIncremental == evaluate every step", mismatches == 0 && nonEmpty > 0 &&
+                                                                    partialSteps > fullPasses);
+}
+
+int checkTray() {
+    SensorDataTray& tray = SensorDataTray::getInstance();
+    tray.clear();
+    int failures = 0;
+
+    std::vector<std::string> notified;
+    int token = tray.subscribe([&](const data_tray::TrayChange& c) { notified.push_back(c.key); });
+
+    tray.setChangeThreshold("batteryLevel", 5);
+    uint64_t e0 = tray.epoch();
+    tray.put("batteryLevel", TrayValue::ofDouble(80));
+    uint64_t e1 = tray.epoch();
+    tray.put("batteryLevel", TrayValue::ofDouble(77));     // −3：阈值内
+    tray.put("batteryLevel", TrayValue::ofDouble(76));     // 相对上次变化 −4：仍在阈值内
+    uint64_t e2 = tray.epoch();
+    tray.put("batteryLevel", TrayValue::ofDouble(75));     // −5：变化
+    uint64_t e3 = tray.epoch();
+    failures += check("numeric threshold gates the epoch",
+                      e1 == e0 + 1 && e2 == e1 && e3 == e1 + 1 && tray.getSnapshot().batteryLevel == "75");
+
+    tray.put("motionState", std::string("stationary"));
+    tray.put("motionState", std::string("stationary"));   // 相同字符串不算变化
+    tray.put("isCharging", TrayValue::ofBool(false));
+    uint64_t cursor = 0;
+    auto changes = tray.getChangedSince(e3, &cursor);
+    bool listed = changes.size() == 2 && cursor == e3 + 2;
+    auto none = tray.getChangedSince(cursor);
+    tray.put("isCharging", TrayValue::ofBool(true));
+    auto one = tray.getChangedSince(cursor, &cursor);
+    failures += check("getChangedSince reports each change once",
+                      listed && none.empty() && one.size() == 1 && one[0].key == "isCharging" &&
+                          one[0].value.flag);
+
+    tray.unsubscribe(token);
+    tray.put("isCharging", TrayValue::ofBool(false));
+    failures += check("subscribers notified per material change",
+                      notified.size() == 5 && notified[0] == "batteryLevel" && notified[2] == "motionState" &&
+                          notified[4] == "isCharging");
+    tray.setChangeThreshold("batteryLevel", 0);
+    tray.clear();
+    return failures;
+}
+
+// ============================================================
+// 静止手机的一天
+// ============================================================
+
+struct DayResult {
+    size_t ticks = 0;
+    size_t evaluations = 0;
+    size_t ruleMatches = 0;
+    double ms = 0.0;
+};
+
+/** 每 2 分钟刷新一次托盘；useTray = 只有 epoch 前进时才 evaluateIncremental，否则每次全量 evaluate */
+DayResult simulateDay(const std::vector<Rule>& rules, bool useTray, size_t& mismatches) {
+    SensorDataTray& tray = SensorDataTray::getInstance();
+    tray.clear();
+    tray.setChangeThreshold("batteryLevel", 5);
+    tray.setChangeThreshold("stepCount", 500);
+
+    RuleEngine engine, reference;
+    engine.loadRules(rules);
+    reference.loadRules(rules);
+    noLimits(engine);
+    noLimits(reference);
+
+    std::mt19937 rng(4);
+    DayResult result;
+    MatchResults out, expected;
+    IncrementalStats stats;
+    uint64_t lastEpoch = ~0ull;
+    double battery = 96.0;
+    int64_t steps = 0;
+    const char* motion = "stationary";
+    auto t0 = std::chrono::steady_clock::now();
+
+    for (int tick = 0; tick < 720; tick++) {
+        int minute = tick * 2;
+        int hour = minute / 60;
+        const char* timeOfDay = hour < 6 ? "night" : hour < 11 ? "morning" : hour < 14 ? "noon"
+                                : hour < 18 ? "afternoon" : hour < 22 ? "evening" : "night";
+        battery -= 0.06 + (rng() % 10) * 0.004;
+        if (rng() % 50 == 0) motion = motion[0] == 's' ? "walking" : "stationary";
+        if (motion[0] == 'w') steps += 150 + static_cast<int64_t>(rng() % 50);
+
+        tray.put("hour", TrayValue::ofDouble(hour), 1.0, "system");
+        tray.put("timeOfDay", std::string(timeOfDay), 1.0, "system");
+        tray.put("isWeekend", TrayValue::ofBool(false), 1.0, "system");
+        tray.put("batteryLevel", TrayValue::ofDouble(std::round(battery)), 1.0, "battery");
+        tray.put("isCharging", TrayValue::ofBool(false), 1.0, "battery");
+        tray.put("networkType", std::string("wifi"), 1.0, "wifi");
+        tray.put("geofence", std::string("home"), 1.0, "geofence");
+        tray.put("motionState", std::string(motion), 0.9, "accelerometer");
+        tray.put("stepCount", TrayValue::ofInt(steps), 1.0, "pedometer");
+        result.ticks++;
+
+        if (useTray && tray.epoch() == lastEpoch) continue;
+        lastEpoch = tray.epoch();
+
+        auto snap = tray.getSnapshot();
+        ContextMap ctx = {{"hour", snap.hour}, {"timeOfDay", snap.timeOfDay}, {"isWeekend", snap.isWeekend},
+                          {"batteryLevel", snap.batteryLevel}, {"isCharging", snap.isCharging},
+                          {"networkType", snap.networkType}, {"motionState", snap.motionState}};
+        if (snap.geofence) ctx["geofence"] = *snap.geofence;
+        if (snap.stepCount) ctx["stepCount"] = *snap.stepCount;
+
+        result.evaluations++;
+        if (useTray) {
+            engine.evaluateIncremental(ctx, 5, out, &stats);
+            result.ruleMatches += stats.rulesMatched;
+            reference.evaluate(ctx, 5, expected);
+            if (!sameResults(out, expected)) mismatches++;
+        } else {
+            engine.evaluate(ctx, 5, out);
+            result.ruleMatches += rules.size();
+        }
+    }
+    result.ms = elapsedMs(t0);
+    tray.setChangeThreshold("batteryLevel", 0);
+    tray.setChangeThreshold("stepCount", 0);
+    tray.clear();
+    return result;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    int numRules = 300;
+    int steps = 3000;
+    bool checkOnly = false;
+    perf::Args().option("--rules", numRules).option("--steps", steps).flag("--check-only", checkOnly).parse(argc, argv);
+
+    std::printf("check: %d rules\n", numRules);
+    int failures = checkEquivalence(numRules, steps);
+    failures += checkTray();
+
+    std::mt19937 rng(23);
+    auto rules = randomRules(rng, numRules);
+    size_t mismatches = 0;
+    DayResult polling = simulateDay(rules, false, mismatches);
+    DayResult tracked = simulateDay(rules, true, mismatches);
+    failures += check("day replay matches full evaluate", mismatches == 0 && tracked.evaluations < polling.ticks);
+
+    if (!checkOnly) {
+        std::printf("timing: stationary day, %zu tray refreshes, %d rules (upper bound: every rule per evaluation)\n",
+                    polling.ticks, numRules);
+        std::printf("  poll + evaluate            %4zu evaluations  %7zu rule matches  %7.2f ms\n",
+                    polling.evaluations, polling.ruleMatches, polling.ms);
+        std::printf("  epoch + evaluateIncremental %3zu evaluations  %7zu rule matches  %7.2f ms (incl. reference)\n",
+                    tracked.evaluations, tracked.ruleMatches, tracked.ms);
+    }
+
+    return perf::reportMatch(failures);
+}
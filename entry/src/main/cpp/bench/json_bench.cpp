@@ -0,0 +1,289 @@
+/**
+ * json_bench.cpp — 共享 JSON 层 vs 原 find() 式提取
+ *
+ * 校验：转义 / \u 代理对 / 嵌套 / 数字边界 / 非法输入的解析结果；
+ * Writer 输出再解析后逐值一致（含控制字符与引号）。
+ * 然后对比 evaluate 往返（解析上下文对象 + 序列化匹配结果）两种实现的耗时。
+ *
+ * 用法: json_bench [--iters N] [--check-only]
+ */
+#include "common/json.h"
+#include "perf_harness.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using native_common::json::Document;
+using native_common::json::Type;
+using native_common::json::Value;
+using native_common::json::Writer;
+using perf::elapsedMs;
+using perf::check;
+
+namespace {
+
+using ContextMap = std::unordered_map<std::string, std::string>;
+
+struct Result {
+    std::string ruleId;
+    double confidence;
+    std::string actionId, actionType, payload;
+};
+
+// ============================================================
+// 原实现：按 '"' 与 ':' 查找键值对，ostringstream 拼接结果（不处理转义）
+// ============================================================
+
+ContextMap legacyParseContext(const std::string& json) {
+    ContextMap ctx;
+    size_t pos = 0;
+    while (pos < json.size()) {
+        auto keyStart = json.find('"', pos);
+        if (keyStart == std::string::npos) break;
+        auto keyEnd = json.find('"', keyStart + 1);
+        if (keyEnd == std::string::npos) break;
+        std::string key = json.substr(keyStart + 1, keyEnd - keyStart - 1);
+        auto colon = json.find(':', keyEnd + 1);
+        if (colon == std::string::npos) break;
+        size_t valStart = colon + 1;
+        while (valStart < json.size() && (json[valStart] == ' ' || json[valStart] == '\t')) valStart++;
+        if (valStart >= json.size()) break;
+        std::string value;
+        if (json[valStart] == '"') {
+            auto valEnd = json.find('"', valStart + 1);
+            if (valEnd == std::string::npos) break;
+            value = json.substr(valStart + 1, valEnd - valStart - 1);
+            pos = valEnd + 1;
+        } else {
+            auto valEnd = json.find_first_of(",}", valStart);
+            if (valEnd == std::string::npos) valEnd = json.size();
+            value = json.substr(valStart, valEnd - valStart);
+            while (!value.empty() && (value.back() == ' ' || value.back() == '\t')) value.pop_back();
+            pos = valEnd;
+        }
+        ctx[key] = value;
+    }
+    return ctx;
+}
+
+std::string legacyResultsJson(const std::vector<Result>& results) {
+    std::ostringstream ss;
+    ss << "[";
+    for (size_t i = 0; i < results.size(); i++) {
+        if (i > 0) ss << ",";
+        const auto& r = results[i];
+        ss << "{\"ruleId\":\"" << r.ruleId << "\",\"confidence\":" << r.confidence << ",\"action\":{\"id\":\""
+           << r.actionId << "\",\"type\":\"" << r.actionType << "\",\"payload\":\"" << r.payload << "\"}}";
+    }
+    ss << "]";
+    return ss.str();
+}
+
+// ============================================================
+// 新实现：Document + Writer，文档与输出缓冲复用
+// ============================================================
+
+/** 与 context_engine_napi.cpp 的 parseContextMap 相同：原位填充，复用已有节点 */
+void parseContext(Document& doc, const std::string& json, ContextMap& ctx) {
+    if (!doc.parse(json)) {
+        ctx.clear();
+        return;
+    }
+    Value root = doc.root();
+    size_t filled = 0;
+    for (auto [key, value] : root.members()) {
+        if (key.empty()) continue;
+        ctx[std::string(key)].assign(value.text());
+        filled++;
+    }
+    if (ctx.size() == filled) return;
+    for (auto it = ctx.begin(); it != ctx.end();) {
+        if (root[it->first].exists()) {
+            ++it;
+        } else {
+            it = ctx.erase(it);
+        }
+    }
+}
+
+void resultsJson(const std::vector<Result>& results, std::string& out) {
+    out.clear();
+    Writer w(out);
+    w.beginArray();
+    for (const auto& r : results) {
+        w.beginObject();
+        w.member("ruleId", r.ruleId);
+        w.member("confidence", r.confidence);
+        w.key("action");
+        w.beginObject();
+        w.member("id", r.actionId);
+        w.member("type", r.actionType);
+        w.member("payload", r.payload);
+        w.endObject();
+        w.endObject();
+    }
+    w.endArray();
+}
+
+// ============================================================
+// 校验
+// ============================================================
+
+int runCheck() {
+    std::printf("check:\n");
+    int failures = 0;
+    Document doc;
+
+    failures += check("escapes decoded",
+                      doc.parse(R"({"a":"x\"y\\z\/\n\t","b":"plain"})") &&
+                          doc.root()["a"].str() == "x\"y\\z/\n\t" && doc.root()["b"].str() == "plain");
+
+    failures += check("\\u escapes and surrogate pairs",
+                      doc.parse(R"(["\u00e9","\u4e2d","\ud83d\ude00"])") &&
+                          doc.root().at(0).str() == "\xC3\xA9" && doc.root().at(1).str() == "\xE4\xB8\xAD" &&
+                          doc.root().at(2).str() == "\xF0\x9F\x98\x80");
+
+    bool nested = doc.parse(R"({"r":[{"id":"a","c":[{"k":1},{"k":2}]},{"id":"b","c":[]}],"n":null})");
+    Value r = doc.root()["r"];
+    failures += check("nested arrays / objects",
+                      nested && r.size() == 2 && r.at(0)["c"].at(1)["k"].int64() == 2 && r.at(1)["c"].size() == 0 &&
+                          r.at(1)["id"].str() == "b" && doc.root()["n"].isNull() && !doc.root()["zz"].exists() &&
+                          !r.at(5).exists());
+
+    failures += check("object value keeps raw text", doc.parse(R"({"payload": {"x": [1, 2]} })") &&
+                                                          doc.root()["payload"].text() == R"({"x": [1, 2]})");
+
+    failures += check("numbers",
+                      doc.parse("[0,-7,3.25,1e3,-2.5E-2,9007199254740993,true,false]") &&
+                          doc.root().at(0).num() == 0 && doc.root().at(1).int64() == -7 &&
+                          doc.root().at(2).num() == 3.25 && doc.root().at(3).num() == 1000 &&
+                          doc.root().at(4).num() == -0.025 && doc.root().at(5).int64() == 9007199254740993LL &&
+                          doc.root().at(6).boolean() && !doc.root().at(7).boolean(true) &&
+                          doc.root().at(1).text() == "-7");
+
+    const char* const invalid[] = {"", "{", "[1,]", "{\"a\" 1}", "{\"a\":1,}", "\"unterminated", "[01]",
+                                   "[1] x", "{\"a\":tru}", "\"\\x\"", "\"\\ud800\"", "[\"a\nb\"]"};
+    size_t accepted = 0;
+    for (const char* text : invalid) {
+        if (doc.parse(text)) accepted++;
+    }
+    failures += check("invalid input rejected", accepted == 0 && !doc.root().exists());
+
+    std::string deep(300, '[');
+    failures += check("nesting depth bounded", !doc.parse(deep + std::string(300, ']')));
+
+    // Writer → Document 往返
+    const std::string tricky = std::string("q\"b\\s/\b\f\n\r\t") + '\x01' + "中文";
+    std::string out;
+    Writer w(out);
+    w.beginObject();
+    w.member("s", tricky);
+    w.member("d", 0.1);
+    w.member("i", int64_t{-42});
+    w.member("t", true);
+    w.key("arr");
+    w.beginArray();
+    w.integer(1);
+    w.null();
+    w.beginObject();
+    w.endObject();
+    w.endArray();
+    w.key("raw");
+    w.raw("{\"k\":[1]}");
+    w.endObject();
+    failures += check("writer output re-parses",
+                      doc.parse(out) && doc.root()["s"].str() == tricky && doc.root()["d"].num() == 0.1 &&
+                          doc.root()["i"].int64() == -42 && doc.root()["t"].boolean() &&
+                          doc.root()["arr"].size() == 3 && doc.root()["arr"].at(1).isNull() &&
+                          doc.root()["arr"].at(2).isObject() && doc.root()["raw"]["k"].at(0).int64() == 1);
+
+    const double awkward[] = {1.0 / 3.0, 0.1 + 0.2, -2.5e-8, 1e300, 5e-324, 123456789.125, 0.6};
+    out.clear();
+    Writer shortest(out);
+    shortest.beginArray();
+    for (double v : awkward) shortest.number(v);
+    shortest.endArray();
+    bool exact = doc.parse(out);
+    for (size_t i = 0; exact && i < sizeof(awkward) / sizeof(awkward[0]); i++) {
+        exact = doc.root().at(i).num() == awkward[i];
+    }
+    failures += check("doubles round trip exactly", exact && doc.root().at(6).text() == "0.6");
+
+    // 结果序列化：含引号的 payload 原实现产生非法 JSON，新实现可解析
+    std::vector<Result> results = {{"r1", 0.75, "a1", "suggestion", "say \"hi\""}};
+    std::string fresh;
+    resultsJson(results, fresh);
+    failures += check("results with quotes stay valid",
+                      doc.parse(fresh) && doc.root().at(0)["action"]["payload"].str() == "say \"hi\"" &&
+                          !doc.parse(legacyResultsJson(results)));
+    return failures;
+}
+
+// ============================================================
+// 计时
+// ============================================================
+
+std::string benchContext() {
+    return R"({"hour":"8","timeOfDay":"morning","dayOfWeek":"3","isWeekend":"false","batteryLevel":"64",)"
+           R"("isCharging":"false","networkType":"wifi","motionState":"walking","geofence":"home",)"
+           R"("wifiSsid":"office-5g","bluetoothDevices":"2","ambientLight":"bright","noiseLevel":"quiet",)"
+           R"("screenOn":"true","headphonesConnected":"true","lastAppCategory":"music"})";
+}
+
+std::vector<Result> benchResults() {
+    std::vector<Result> results;
+    for (int i = 0; i < 5; i++) {
+        results.push_back({"rule_" + std::to_string(i), 1.0 - 0.1 * i, "action_" + std::to_string(i),
+                           "suggestion", "{\"text\":\"hello\"}"});
+    }
+    return results;
+}
+
+void runTiming(int iters) {
+    std::string ctxJson = benchContext();
+    auto results = benchResults();
+    size_t sink = 0;
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < iters; i++) {
+        auto ctx = legacyParseContext(ctxJson);
+        std::string out = legacyResultsJson(results);
+        sink += ctx.size() + out.size();
+    }
+    double legacyUs = elapsedMs(t0) * 1000.0 / iters;
+
+    Document doc;
+    ContextMap ctx;
+    std::string out;
+    t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < iters; i++) {
+        parseContext(doc, ctxJson, ctx);
+        resultsJson(results, out);
+        sink += ctx.size() + out.size();
+    }
+    double sharedUs = elapsedMs(t0) * 1000.0 / iters;
+
+    std::printf("timing: evaluate round trip, %zu-byte context, %zu results (mean of %d)\n", ctxJson.size(),
+                results.size(), iters);
+    std::printf("  find() + ostringstream %8.2f us\n", legacyUs);
+    std::printf("  Document + Writer      %8.2f us  (%.1fx)\n", sharedUs, sharedUs > 0 ? legacyUs / sharedUs : 0.0);
+    if (sink == 0) std::printf("\n");
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    int iters = 100000;
+    bool checkOnly = false;
+    perf::Args().option("--iters", iters).flag("--check-only", checkOnly).parse(argc, argv);
+
+    int failures = runCheck();
+    if (!checkOnly) runTiming(iters);
+
+    return perf::reportMatch(failures);
+}
@@ -0,0 +1,408 @@
+/**
+ * learner_history_bench.cpp — 定长列式历史 + 运行聚合 vs 无限增长的记录数组
+ *
+ * 校验：
+ *   - SleepPatternLearner：不跨午夜的整点记录在 10 条以内与原实现的算术平均一致；
+ *     跨午夜的入睡时间按圆周平均；模拟多天运动变化时每晚只推断出一次睡眠（原实现每次运动变化
+ *     重扫 24 小时，同一晚会被重复计入）；周末判定与日期推算；记录日志容量上限；快照读写。
+ *   - FeedbackLearner：偏好计数与原实现一致；日志保留最近 capacity 条、按规则过滤与原数组一致；
+ *     日志快照读写。
+ * 然后对比历史增长后单次更新的耗时。
+ *
+ * 用法: learner_history_bench [--days N] [--dir PATH] [--check-only]
+ */
+#include "feedback_learner/feedback_learner.h"
+#include "sleep_pattern/sleep_pattern.h"
+#include "perf_harness.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+using feedback_learner::FeedbackContext;
+using feedback_learner::FeedbackLearner;
+using feedback_learner::FeedbackRecord;
+using feedback_learner::FeedbackType;
+using sleep_pattern::MotionSnapshot;
+using sleep_pattern::SleepPatternLearner;
+using sleep_pattern::SleepRecord;
+using perf::elapsedMs;
+using perf::check;
+
+namespace {
+
+constexpr int64_t HOUR_MS = 60 * 60 * 1000;
+constexpr int64_t MIN_MS = 60 * 1000;
+constexpr int64_t DAY_MS = 24 * HOUR_MS;
+
+bool near(double a, double b, double eps = 1e-9) { return std::abs(a - b) <= eps; }
+
+// ============================================================
+// 原实现：vector 记录 + 每次全量重算
+// ============================================================
+
+struct LegacySleepLearner {
+    struct Snap {
+        std::string state;
+        int64_t timestamp;
+    };
+    std::vector<Snap> motionHistory;
+    std::vector<SleepRecord> records;
+    double typicalBedtime = 0, typicalWakeTime = 0, confidence = 0;
+
+    void recordMotionChange(const std::string& state, int64_t ts) {
+        motionHistory.push_back({state, ts});
+        int64_t cutoff = ts - DAY_MS;
+        while (motionHistory.size() > 2 && motionHistory.front().timestamp < cutoff) {
+            motionHistory.erase(motionHistory.begin());
+        }
+        detectSleep();
+    }
+
+    void recordFromWearable(const SleepRecord& r) {
+        records.push_back(r);
+        updatePattern();
+    }
+
+    void detectSleep() {
+        if (motionHistory.size() < 10) return;
+        int64_t start = 0, end = 0;
+        bool in = false;
+        for (const auto& s : motionHistory) {
+            if (s.state == "stationary") {
+                if (!in) {
+                    start = s.timestamp;
+                    in = true;
+                }
+                end = s.timestamp;
+            } else if (in) {
+                if (end - start > 4 * HOUR_MS) {
+                    SleepRecord r;
+                    r.bedtime = start;
+                    r.wakeTime = end;
+                    r.durationMs = end - start;
+                    r.source = "inferred";
+                    records.push_back(r);
+                    updatePattern();
+                }
+                in = false;
+            }
+        }
+    }
+
+    void updatePattern() {
+        double bedSum = 0, wakeSum = 0;
+        int count = 0;
+        for (const auto& rec : records) {
+            if (rec.bedtime > 0 && rec.wakeTime > 0) {
+                bedSum += (rec.bedtime / HOUR_MS) % 24;
+                wakeSum += (rec.wakeTime / HOUR_MS) % 24;
+                count++;
+            }
+        }
+        if (count > 0) {
+            typicalBedtime = bedSum / count;
+            typicalWakeTime = wakeSum / count;
+            confidence = std::min(1.0, count / 7.0);
+        }
+    }
+};
+
+SleepRecord wearable(int64_t bedtime, int64_t wakeTime) {
+    SleepRecord r;
+    r.bedtime = bedtime;
+    r.wakeTime = wakeTime;
+    r.durationMs = wakeTime - bedtime;
+    r.source = "wearable";
+    return r;
+}
+
+/**
+ * 模拟一天的运动变化（UTC）：07:00–22:50 每 10 分钟一次，走动 / 静止交替，22:50 固定为走动；
+ * 23:00 起静止，每 30 分钟一次到次日 06:30，07:00 起床走动（落到下一天的第一条）
+ */
+template <class Sink>
+void simulateDay(int64_t dayStart, Sink&& sink) {
+    for (int64_t t = 7 * 60; t <= 22 * 60 + 50; t += 10) {
+        bool walking = t == 22 * 60 + 50 || (t / 10) % 2 == 0;
+        sink(walking ? "walking" : "stationary", dayStart + t * MIN_MS);
+    }
+    for (int64_t t = 23 * 60; t <= 30 * 60 + 30; t += 30) sink("stationary", dayStart + t * MIN_MS);
+}
+
+int checkSleep(int days, const std::string& dir) {
+    int failures = 0;
+    const int64_t base = 19723 * DAY_MS;   // 2024-01-01（周一）00:00 UTC
+
+    // 整点、不跨午夜：前 10 条与算术平均一致
+    {
+        SleepPatternLearner learner;
+        LegacySleepLearner legacy;
+        bool same = true;
+        for (int d = 0; d < 10; d++) {
+            int64_t bed = base + d * DAY_MS + (1 + d % 3) * HOUR_MS;
+            int64_t wake = base + d * DAY_MS + (7 + d % 2) * HOUR_MS;
+            learner.recordFromWearable(wearable(bed, wake));
+            legacy.recordFromWearable(wearable(bed, wake));
+            const auto& p = learner.getPattern();
+            same = same && near(p.typicalBedtime, legacy.typicalBedtime) &&
+                   near(p.typicalWakeTime, legacy.typicalWakeTime) && near(p.confidence, legacy.confidence);
+        }
+        failures += check("sleep EWMA = mean for first 10 records", same);
+    }
+
+    // 跨午夜：23:30 与 00:30 → 00:00
+    {
+        SleepPatternLearner learner;
+        learner.recordFromWearable(wearable(base + 23 * HOUR_MS + 30 * MIN_MS, base + 31 * HOUR_MS));
+        learner.recordFromWearable(wearable(base + DAY_MS + 24 * HOUR_MS + 30 * MIN_MS, base + DAY_MS + 31 * HOUR_MS));
+        double bed = learner.getPattern().typicalBedtime;
+        failures += check("bedtime averaged across midnight", near(bed, 0.0) || near(bed, 24.0));
+    }
+
+    // 运动变化推断：每晚一次
+    {
+        SleepPatternLearner learner;
+        LegacySleepLearner legacy;
+        for (int d = 0; d < days; d++) {
+            simulateDay(base + d * DAY_MS, [&](const char* state, int64_t ts) {
+                MotionSnapshot s;
+                s.state = state;
+                s.timestamp = ts;
+                learner.recordMotionChange(s);
+                legacy.recordMotionChange(state, ts);
+            });
+        }
+        // 最后一晚要靠第二天 07:00 的走动收尾
+        MotionSnapshot wake;
+        wake.state = "walking";
+        wake.timestamp = base + days * DAY_MS + 7 * HOUR_MS;
+        learner.recordMotionChange(wake);
+
+        const auto& p = learner.getPattern();
+        auto recs = learner.recentRecords();
+        bool once = learner.recordCount() == days && recs.size() == static_cast<size_t>(days) &&
+                    recs.front().source == "inferred";
+        failures += check("one inferred sleep per night", once);
+        failures += check("inferred bedtime 23:00 / wake 06:30",
+                          near(p.typicalBedtime, 23.0) && near(p.typicalWakeTime, 6.5) &&
+                          near(p.sleepDurationHours, 7.5));
+        std::printf("    (%d nights: %d inferred, original rescan %zu)\n", days, learner.recordCount(),
+                    legacy.records.size());
+    }
+
+    // 周末判定与日期：UTC+8，周五 23:00、周六 01:00（仍算周五晚）、周日 23:00
+    {
+        SleepPatternLearner learner;
+        learner.setUtcOffsetMinutes(480);
+        const int64_t friday = (19727 * 24 - 8) * HOUR_MS;   // 2024-01-05 00:00 本地
+        learner.recordFromWearable(wearable(friday + 23 * HOUR_MS, friday + 31 * HOUR_MS));
+        learner.recordFromWearable(wearable(friday + DAY_MS + 25 * HOUR_MS, friday + DAY_MS + 33 * HOUR_MS));
+        learner.recordFromWearable(wearable(friday + 2 * DAY_MS + 23 * HOUR_MS, friday + 2 * DAY_MS + 30 * HOUR_MS));
+        const auto& p = learner.getPattern();
+        auto recs = learner.recentRecords();
+        failures += check("weekend nights and local dates",
+                          p.weekends.sampleCount == 2 && p.weekdays.sampleCount == 1 &&
+                          near(p.weekdays.bedtime, 23.0) && recs.size() == 3 &&
+                          recs[2].date == "2024-01-05" && recs[1].date == "2024-01-07" &&
+                          recs[0].date == "2024-01-07");
+    }
+
+    // 日志容量
+    SleepPatternLearner learner;
+    for (int i = 0; i < 1000; i++) {
+        int64_t day = base + i * DAY_MS;
+        learner.recordFromWearable(wearable(day + (22 + i % 3) * HOUR_MS, day + (30 + i % 2) * HOUR_MS));
+    }
+    auto latest = learner.recentRecords(1);
+    failures += check("sleep log bounded to capacity",
+                      learner.loggedRecords() == SleepPatternLearner::DEFAULT_RECORD_CAPACITY &&
+                      learner.recordCount() == 1000 && latest.size() == 1 &&
+                      latest[0].bedtime == base + 999 * DAY_MS + 22 * HOUR_MS);
+
+    // 快照
+    std::string path = dir + "/learner_history_sleep.snap";
+    SleepPatternLearner reloaded, patternOnly;
+    bool saved = learner.save(path);
+    bool loaded = reloaded.load(path);
+    auto a = learner.recentRecords(), b = reloaded.recentRecords();
+    bool sameLog = a.size() == b.size();
+    for (size_t i = 0; sameLog && i < a.size(); i++) {
+        sameLog = a[i].bedtime == b[i].bedtime && a[i].wakeTime == b[i].wakeTime &&
+                  a[i].durationMs == b[i].durationMs && a[i].source == b[i].source;
+    }
+    const auto& pa = learner.getPattern();
+    const auto& pb = reloaded.getPattern();
+    failures += check("sleep snapshot round trip",
+                      saved && loaded && sameLog && pa.typicalBedtime == pb.typicalBedtime &&
+                      pa.typicalWakeTime == pb.typicalWakeTime && pa.confidence == pb.confidence &&
+                      pa.weekends.sampleCount == pb.weekends.sampleCount);
+    bool noLog = learner.save(path, false) && patternOnly.load(path) && patternOnly.loggedRecords() == 0 &&
+                 patternOnly.getPattern().typicalBedtime == pa.typicalBedtime;
+    failures += check("sleep snapshot without log", noLog);
+    std::remove(path.c_str());
+    return failures;
+}
+
+int checkFeedback(const std::string& dir) {
+    int failures = 0;
+    std::mt19937 rng(17);
+    FeedbackLearner learner;
+    std::vector<FeedbackRecord> legacy;
+    const int total = 5000;
+    const size_t rules = 30;
+    for (int i = 0; i < total; i++) {
+        FeedbackRecord r{};
+        r.context.ruleId = "rule_" + std::to_string(rng() % rules);
+        r.type = static_cast<FeedbackType>(rng() % 4);
+        r.context.hour = static_cast<int>(rng() % 24);
+        r.timestamp = 1700000000000LL + i * MIN_MS;
+        if (r.type == FeedbackType::ADJUST) r.adjustment = {i % 2 ? "hour" : "minute", 7.0, 7.0 + i % 5, ""};
+        learner.recordFeedback(r);
+        legacy.push_back(r);
+    }
+
+    // 偏好计数：原实现对全部记录计数
+    bool sameCounts = learner.getAllPreferences().size() == rules;
+    for (const auto& [id, pref] : learner.getAllPreferences()) {
+        int counts[4] = {0, 0, 0, 0};
+        for (const auto& r : legacy) {
+            if (r.context.ruleId == id) counts[static_cast<int>(r.type)]++;
+        }
+        sameCounts = sameCounts && pref.usefulCount == counts[0] && pref.inaccurateCount == counts[1] &&
+                     pref.dismissCount == counts[2] && pref.adjustCount == counts[3];
+    }
+    failures += check("feedback counters match full history", sameCounts);
+
+    // 日志：最近 capacity 条，按规则过滤
+    size_t cap = FeedbackLearner::DEFAULT_LOG_CAPACITY;
+    bool sameLog = learner.loggedFeedback() == cap && learner.totalFeedback() == static_cast<uint64_t>(total);
+    for (size_t rule = 0; rule < rules && sameLog; rule += 7) {
+        std::string id = "rule_" + std::to_string(rule);
+        auto logged = learner.recentFeedback(0, id);
+        size_t k = 0;
+        for (size_t i = legacy.size(); i > legacy.size() - cap && sameLog; i--) {
+            const auto& r = legacy[i - 1];
+            if (r.context.ruleId != id) continue;
+            sameLog = k < logged.size() && logged[k].timestamp == r.timestamp && logged[k].type == r.type &&
+                      logged[k].hour == r.context.hour &&
+                      (r.type != FeedbackType::ADJUST ||
+                       (logged[k].adjustKey == r.adjustment.key &&
+                        logged[k].adjustedValue == r.adjustment.adjustedValue));
+            k++;
+        }
+        sameLog = sameLog && k == logged.size();
+    }
+    auto newest = learner.recentFeedback(3);
+    sameLog = sameLog && newest.size() == 3 && newest[0].timestamp == legacy.back().timestamp;
+    failures += check("feedback log keeps newest entries", sameLog);
+
+    // 快照：带日志 / 不带日志
+    std::string path = dir + "/learner_history_feedback.snap";
+    FeedbackLearner withLog, prefsOnly;
+    bool roundTrip = learner.savePreferences(path, true) && withLog.loadPreferences(path) &&
+                     withLog.exportPreferences() == learner.exportPreferences() &&
+                     withLog.loggedFeedback() == cap;
+    auto x = learner.recentFeedback(), y = withLog.recentFeedback();
+    for (size_t i = 0; roundTrip && i < x.size(); i++) {
+        roundTrip = x[i].ruleId == y[i].ruleId && x[i].timestamp == y[i].timestamp && x[i].type == y[i].type &&
+                    x[i].hour == y[i].hour && x[i].adjustedValue == y[i].adjustedValue;
+    }
+    failures += check("feedback log snapshot round trip", roundTrip);
+    bool noLog = learner.savePreferences(path) && prefsOnly.loadPreferences(path) &&
+                 prefsOnly.loggedFeedback() == 0 && prefsOnly.exportPreferences() == learner.exportPreferences();
+    failures += check("feedback snapshot without log", noLog);
+    std::remove(path.c_str());
+    return failures;
+}
+
+void runTiming(int days) {
+    std::printf("\nper-update cost after %d days of history\n", days);
+    const int64_t base = 19723 * DAY_MS;
+
+    // 运动变化：每分钟一次，原实现每次重扫 24 小时（1440 条）
+    {
+        SleepPatternLearner learner;
+        LegacySleepLearner legacy;
+        std::vector<std::pair<const char*, int64_t>> stream;
+        for (int d = 0; d < days; d++) {
+            for (int64_t t = 0; t < DAY_MS; t += MIN_MS) {
+                int64_t hour = t / HOUR_MS;
+                bool night = hour < 7 || hour >= 23;
+                stream.push_back({night || (t / MIN_MS) % 3 == 0 ? "stationary" : "walking", base + d * DAY_MS + t});
+            }
+        }
+        auto t0 = std::chrono::steady_clock::now();
+        for (const auto& [state, ts] : stream) legacy.recordMotionChange(state, ts);
+        double legacyUs = elapsedMs(t0) * 1000.0 / stream.size();
+        t0 = std::chrono::steady_clock::now();
+        for (const auto& [state, ts] : stream) {
+            MotionSnapshot s;
+            s.state = state;
+            s.timestamp = ts;
+            learner.recordMotionChange(s);
+        }
+        double ringUs = elapsedMs(t0) * 1000.0 / stream.size();
+        std::printf("  motion change   rescan %9.3f us   ring %7.3f us  (%.0fx)   records %zu vs %d\n",
+                    legacyUs, ringUs, ringUs > 0 ? legacyUs / ringUs : 0.0, legacy.records.size(),
+                    learner.recordCount());
+    }
+
+    // 睡眠记录：原实现每插入一条重算全部记录
+    {
+        const int n = days * 20;
+        SleepPatternLearner learner;
+        LegacySleepLearner legacy;
+        auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < n; i++) legacy.recordFromWearable(wearable(base + i * HOUR_MS, base + i * HOUR_MS + 8 * HOUR_MS));
+        double legacyUs = elapsedMs(t0) * 1000.0 / n;
+        t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < n; i++) learner.recordFromWearable(wearable(base + i * HOUR_MS, base + i * HOUR_MS + 8 * HOUR_MS));
+        double ewmaUs = elapsedMs(t0) * 1000.0 / n;
+        std::printf("  sleep record    rescan %9.3f us   EWMA %7.3f us  (%.0fx)   %d records\n", legacyUs, ewmaUs,
+                    ewmaUs > 0 ? legacyUs / ewmaUs : 0.0, n);
+    }
+
+    // 反馈：内存占用
+    {
+        const int n = days * 200;
+        FeedbackLearner learner;
+        std::vector<FeedbackRecord> legacy;
+        FeedbackContext ctx{};
+        ctx.timeOfDay = "evening";
+        ctx.geofence = "home";
+        ctx.wifiSsid = "HomeWiFi-5G";
+        ctx.motionState = "stationary";
+        auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < n; i++) {
+            FeedbackRecord r{};
+            r.context = ctx;
+            r.context.ruleId = "rule_" + std::to_string(i % 40);
+            r.type = static_cast<FeedbackType>(i % 3);
+            r.timestamp = i;
+            learner.recordFeedback(r);
+            legacy.push_back(r);
+        }
+        double us = elapsedMs(t0) * 1000.0 / n;
+        size_t rowBytes = sizeof(int64_t) + sizeof(uint32_t) + 3 * sizeof(uint8_t) + 2 * sizeof(float);
+        std::printf("  feedback        %d records: vector %zu KB (+ strings)   log %zu KB   %.3f us / record\n", n,
+                    legacy.capacity() * sizeof(FeedbackRecord) / 1024, learner.loggedFeedback() * rowBytes / 1024, us);
+    }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    int days = 30;
+    std::string dir = ".";
+    bool checkOnly = false;
+    perf::Args().option("--days", days).option("--dir", dir).flag("--check-only", checkOnly).parse(argc, argv);
+
+    int failures = checkSleep(days, dir) + checkFeedback(dir);
+    if (!checkOnly) runTiming(days);
+
+    return perf::reportMatch(failures);
+}
@@ -0,0 +1,250 @@
+/**
+ * metrics_bench.cpp — 每线程分片的埋点库 vs 全局原子计数
+ *
+ * 校验：分桶上下界连续且覆盖每个值；对数正态样本的 p50 / p90 / p99 与排序求得的精确值相差在桶宽内；
+ * 多线程并发记录后计数 / 总和精确；线程退出后分片被新线程复用；reset() 之后只报告增量；
+ * 争用的锁记录到非零等待；gauge 的最近值与最大值；同名注册去重、超出容量落到 metrics.overflow。
+ * 以 -DNATIVE_METRICS_DISABLED 编译（metrics_bench_off）时校验宏全部展开为空。
+ * 然后对比单次 SCOPE / COUNT / LOCK 的开销，以及多线程计数时分片与共享 atomic 的吞吐。
+ *
+ * 用法: metrics_bench [--n N] [--check-only]
+ */
+#include "common/metrics.h"
+#include "perf_harness.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace metrics = native_common::metrics;
+
+using perf::elapsedMs;
+using perf::check;
+
+namespace {
+
+/** 计数器 / 直方图在快照里的值（未出现即 0） */
+uint64_t histogramCount(const metrics::Snapshot& snap, const char* name) {
+    const metrics::HistogramSnapshot* h = snap.findHistogram(name);
+    return h != nullptr ? h->count : 0;
+}
+
+void instrumentedWork(int i) {
+    (void)i;
+    NATIVE_METRICS_SCOPE("bench.scope");
+    NATIVE_METRICS_COUNT("bench.count", 1);
+    NATIVE_METRICS_GAUGE("bench.gauge", i);
+    NATIVE_METRICS_RECORD("bench.record", 1000);
+}
+
+int runDisabledCheck() {
+    int failures = 0;
+    std::mutex mu;
+    for (int i = 0; i < 100; i++) {
+        instrumentedWork(i);
+        NATIVE_METRICS_LOCK(lock, mu, "bench.lock");
+    }
+    metrics::Snapshot snap = metrics::snapshot();
+    failures += check("disabled: macros compile out", !snap.enabled && snap.histograms.empty() &&
+                                                          snap.counters.empty() && snap.gauges.empty());
+    failures += check("disabled: LOCK still locks", mu.try_lock());
+    mu.unlock();
+    return failures;
+}
+
+int runCheck() {
+    if (!metrics::ENABLED) return runDisabledCheck();
+    int failures = 0;
+
+    // 分桶
+    bool contiguous = true;
+    for (size_t b = 0; b + 1 < metrics::BUCKETS; b++) {
+        if (metrics::bucketUpper(b) != metrics::bucketLower(b + 1)) contiguous = false;
+    }
+    std::mt19937_64 rng(7);
+    bool covers = true;
+    for (int i = 0; i < 100000; i++) {
+        uint64_t v = rng() >> (rng() % 64);
+        if (v >= metrics::bucketLower(metrics::BUCKETS - 1)) continue;
+        size_t b = metrics::bucketOf(v);
+        if (v < metrics::bucketLower(b) || v >= metrics::bucketUpper(b)) covers = false;
+    }
+    failures += check("buckets contiguous and cover values", contiguous && covers && metrics::bucketOf(0) == 0 &&
+                                                                 metrics::bucketOf(UINT64_MAX) == metrics::BUCKETS - 1);
+
+    // 分位数：对数正态，中位数约 20 µs
+    {
+        metrics::MetricId id = metrics::histogram("check.latency");
+        std::lognormal_distribution<double> dist(std::log(20000.0), 1.0);
+        std::vector<uint64_t> samples(200000);
+        for (auto& s : samples) {
+            s = static_cast<uint64_t>(dist(rng));
+            metrics::record(id, s);
+        }
+        std::sort(samples.begin(), samples.end());
+        const metrics::HistogramSnapshot* h = metrics::snapshot().findHistogram("check.latency");
+        bool close = h != nullptr && h->count == samples.size() && h->maxNs == samples.back();
+        for (double q : {0.5, 0.9, 0.99}) {
+            double exact = static_cast<double>(samples[static_cast<size_t>(q * samples.size()) - 1]);
+            double est = h != nullptr ? h->percentileNs(q) : 0.0;
+            // 1 / SUB_BUCKETS 的桶宽
+            if (std::fabs(est - exact) > exact * 0.25) close = false;
+            std::printf("    p%-4g exact %9.0f ns   estimate %9.0f ns\n", q * 100, exact, est);
+        }
+        failures += check("percentiles within bucket width", close);
+    }
+
+    // 多线程：各写各的分片，合计精确
+    {
+        constexpr int THREADS = 6;
+        constexpr int PER_THREAD = 50000;
+        std::vector<std::thread> threads;
+        for (int t = 0; t < THREADS; t++) {
+            threads.emplace_back([] {
+                for (int i = 0; i < PER_THREAD; i++) {
+                    NATIVE_METRICS_COUNT("check.concurrent_count", 2);
+                    NATIVE_METRICS_RECORD("check.concurrent_hist", 100);
+                }
+            });
+        }
+        for (auto& t : threads) t.join();
+        metrics::Snapshot snap = metrics::snapshot();
+        const metrics::HistogramSnapshot* h = snap.findHistogram("check.concurrent_hist");
+        failures += check("concurrent counts exact", snap.counterValue("check.concurrent_count") ==
+                                                             2ull * THREADS * PER_THREAD &&
+                                                         h != nullptr && h->count == uint64_t{THREADS} * PER_THREAD &&
+                                                         h->sumNs == 100ull * THREADS * PER_THREAD);
+
+        // 依次起停的线程复用交回的分片
+        size_t before = snap.threads;
+        for (int t = 0; t < 20; t++) {
+            std::thread([] { NATIVE_METRICS_COUNT("check.sequential", 1); }).join();
+        }
+        snap = metrics::snapshot();
+        failures += check("exited threads' shards are reused", snap.threads == before &&
+                                                                   snap.counterValue("check.sequential") == 20);
+    }
+
+    // reset：只报告之后的增量
+    {
+        metrics::reset();
+        metrics::Snapshot empty = metrics::snapshot();
+        for (int i = 0; i < 3; i++) instrumentedWork(i);
+        metrics::Snapshot after = metrics::snapshot();
+        const metrics::GaugeSnapshot* g = after.findGauge("bench.gauge");
+        failures += check("reset reports deltas only", empty.histograms.empty() && empty.counters.empty() &&
+                                                           after.counterValue("bench.count") == 3 &&
+                                                           histogramCount(after, "bench.scope") == 3 &&
+                                                           histogramCount(after, "check.latency") == 0 &&
+                                                           g != nullptr && g->value == 2 && g->max == 2 &&
+                                                           g->updates == 3);
+    }
+
+    // 锁等待：另一个线程持锁 20ms
+    {
+        std::mutex mu;
+        std::atomic<bool> held{false};
+        std::thread holder([&] {
+            std::lock_guard<std::mutex> lock(mu);
+            held = true;
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        });
+        while (!held) std::this_thread::yield();
+        { NATIVE_METRICS_LOCK(lock, mu, "check.lock_wait"); }
+        holder.join();
+        { NATIVE_METRICS_LOCK(lock, mu, "check.lock_wait"); }
+        const metrics::HistogramSnapshot* h = metrics::snapshot().findHistogram("check.lock_wait");
+        failures += check("contended lock records its wait", h != nullptr && h->count == 2 && h->buckets[0] == 1 &&
+                                                                 h->maxNs >= 10000000);
+    }
+
+    // 注册：同名同 id，超出容量共用 overflow
+    {
+        static char names[metrics::MAX_COUNTERS + 4][24];
+        bool dedupe = metrics::counter("check.dedupe") == metrics::counter("check.dedupe");
+        metrics::MetricId last = 0;
+        for (size_t i = 0; i < metrics::MAX_COUNTERS + 4; i++) {
+            std::snprintf(names[i], sizeof(names[i]), "check.fill_%zu", i);
+            last = metrics::counter(names[i]);
+        }
+        metrics::add(last, 5);
+        metrics::Snapshot snap = metrics::snapshot();
+        failures += check("dedupe by name, overflow slot", dedupe && last == metrics::MAX_COUNTERS - 1 &&
+                                                               snap.counterValue("metrics.overflow") == 5);
+    }
+    return failures;
+}
+
+void runTiming(int n) {
+    std::printf("\nper-call cost x %d\n", n);
+    volatile uint64_t sink = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < n; i++) sink = sink + static_cast<uint64_t>(i);
+    double bare = elapsedMs(t0) * 1e6 / n;
+
+    t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < n; i++) {
+        NATIVE_METRICS_COUNT("timing.count", 1);
+        sink = sink + static_cast<uint64_t>(i);
+    }
+    double count = elapsedMs(t0) * 1e6 / n;
+
+    t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < n; i++) {
+        NATIVE_METRICS_SCOPE("timing.scope");
+        sink = sink + static_cast<uint64_t>(i);
+    }
+    double scope = elapsedMs(t0) * 1e6 / n;
+
+    std::mutex mu;
+    t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < n; i++) {
+        std::lock_guard<std::mutex> lock(mu);
+        sink = sink + static_cast<uint64_t>(i);
+    }
+    double plainLock = elapsedMs(t0) * 1e6 / n;
+    t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < n; i++) {
+        NATIVE_METRICS_LOCK(lock, mu, "timing.lock");
+        sink = sink + static_cast<uint64_t>(i);
+    }
+    double timedLock = elapsedMs(t0) * 1e6 / n;
+    std::printf("  loop %.1f ns   COUNT %.1f ns   SCOPE %.1f ns   lock_guard %.1f ns   LOCK (uncontended) %.1f ns\n",
+                bare, count, scope, plainLock, timedLock);
+
+    unsigned threads = std::max(2u, std::min(8u, std::thread::hardware_concurrency()));
+    std::printf("\ncounting from %u threads, %d each\n", threads, n);
+    auto parallel = [&](auto body) {
+        std::vector<std::thread> pool;
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned t = 0; t < threads; t++) pool.emplace_back([&] {
+            for (int i = 0; i < n; i++) body();
+        });
+        for (auto& t : pool) t.join();
+        return elapsedMs(start);
+    };
+    std::atomic<uint64_t> shared{0};
+    double sharedMs = parallel([&] { shared.fetch_add(1, std::memory_order_relaxed); });
+    double shardMs = parallel([] { NATIVE_METRICS_COUNT("timing.parallel", 1); });
+    std::printf("  shared atomic fetch_add %.1f ms   per-thread shards %.1f ms\n", sharedMs, shardMs);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    int n = 2000000;
+    bool checkOnly = false;
+    perf::Args().option("--n", n).flag("--check-only", checkOnly).parse(argc, argv);
+
+    std::printf("metrics %s\n", metrics::ENABLED ? "enabled" : "disabled (NATIVE_METRICS_DISABLED)");
+    int failures = runCheck();
+    if (!checkOnly) runTiming(n);
+
+    return perf::reportMatch(failures);
+}
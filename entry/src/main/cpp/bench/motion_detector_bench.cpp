@@ -0,0 +1,291 @@
+/**
+ * motion_detector_bench.cpp — 环形特征窗口 + 整批推入 vs vector erase(begin()) + 逐样本重算均值
+ *
+ * 校验：detect / detectBatch 的状态判断与原实现（历史 vector + 每次求和）一致，
+ * 跳过窗口均值离阈值不足 1e-9 的样本（求和顺序不同，只差舍入）；
+ * 长时间流式推入后运行均值 / 方差与直接重算一致（无漂移）；
+ * 50Hz 合成步态信号（1.8 步 / 秒）的步频约 108 步 / 分钟，静止噪声不计步；
+ * 低采样率下带通特征关闭。
+ * 然后对比常见采样率下每个样本的处理耗时。
+ *
+ * 用法: motion_detector_bench [--seconds N] [--check-only]
+ */
+#include "motion_detector/motion_detector.h"
+#include "perf_harness.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using motion_detector::AccelerometerData;
+using motion_detector::MotionConfig;
+using motion_detector::MotionDetector;
+using motion_detector::MotionFeatureWindow;
+using motion_detector::MotionResult;
+using motion_detector::MotionState;
+using motion_detector::RunningWindow;
+using perf::elapsedMs;
+using perf::check;
+
+namespace {
+
+const double PI = 3.14159265358979323846;
+
+// ============================================================
+// 原实现：std::vector 历史 + erase(begin()) + 每次求和
+// ============================================================
+
+struct LegacyDetector {
+    MotionConfig config;
+    std::vector<double> history;
+    MotionState lastState = MotionState::UNKNOWN;
+    double lastAvg = 0;
+
+    MotionState fromAcceleration(double m) const {
+        if (m < config.stationaryThreshold) return MotionState::STATIONARY;
+        if (m < config.walkingThreshold) return MotionState::WALKING;
+        if (m < config.runningThreshold) return MotionState::RUNNING;
+        return MotionState::DRIVING;
+    }
+
+    MotionState detect(const AccelerometerData& a, double gpsSpeed) {
+        double magnitude = std::sqrt(a.x * a.x + a.y * a.y + a.z * a.z);
+        history.push_back(magnitude);
+        if (static_cast<int>(history.size()) > config.historySize) history.erase(history.begin());
+        double avg = 0;
+        for (double m : history) avg += m;
+        avg /= history.size();
+        lastAvg = avg;
+
+        MotionState state;
+        if (gpsSpeed >= 0 && gpsSpeed > config.highSpeedThreshold) {
+            state = MotionState::DRIVING;
+        } else if (gpsSpeed >= 0 && gpsSpeed > config.drivingSpeedThreshold) {
+            state = MotionState::DRIVING;
+        } else if (gpsSpeed > 1.5) {
+            state = avg > config.walkingThreshold ? MotionState::RUNNING : MotionState::WALKING;
+        } else {
+            state = fromAcceleration(avg);
+        }
+        lastState = state;
+        return state;
+    }
+
+    bool nearThreshold() const {
+        const double eps = 1e-9;
+        for (double t : {config.stationaryThreshold, config.walkingThreshold, config.runningThreshold}) {
+            if (std::fabs(lastAvg - t) < eps * t) return true;
+        }
+        return false;
+    }
+};
+
+/** 幅度 = magnitude 的随机方向加速度 */
+AccelerometerData sampleWithMagnitude(double magnitude, std::mt19937& rng) {
+    std::normal_distribution<double> n(0.0, 1.0);
+    double x = n(rng), y = n(rng), z = n(rng);
+    double norm = std::sqrt(x * x + y * y + z * z);
+    if (norm == 0) return AccelerometerData{0, 0, magnitude, 0};
+    return AccelerometerData{x / norm * magnitude, y / norm * magnitude, z / norm * magnitude, 0};
+}
+
+/** 重力 + 步态正弦（cadenceHz 步 / 秒）+ 高斯噪声 */
+std::vector<double> gaitSignal(double rateHz, double seconds, double cadenceHz, double amplitude,
+                               double noise, std::mt19937& rng) {
+    std::normal_distribution<double> n(0.0, noise);
+    std::vector<double> packed;
+    size_t count = static_cast<size_t>(rateHz * seconds);
+    for (size_t i = 0; i < count; i++) {
+        double t = i / rateHz;
+        double m = 9.81 + amplitude * std::sin(2 * PI * cadenceHz * t) + n(rng);
+        AccelerometerData a = sampleWithMagnitude(m, rng);
+        packed.insert(packed.end(), {a.x, a.y, a.z});
+    }
+    return packed;
+}
+
+// ============================================================
+// 校验
+// ============================================================
+
+int runCheck() {
+    int failures = 0;
+    std::printf("check:\n");
+
+    // 1. 逐样本 detect 与原实现状态一致（GPS 有 / 无、幅度跨越各阈值）
+    {
+        std::mt19937 rng(7);
+        std::uniform_real_distribution<double> mag(8.0, 17.0);
+        std::uniform_real_distribution<double> speed(-1.0, 25.0);
+        bool same = true;
+        for (int historySize : {1, 5, 12}) {
+            MotionConfig config;
+            config.historySize = historySize;
+            LegacyDetector legacy;
+            legacy.config = config;
+            MotionDetector detector(config);
+            for (int i = 0; i < 20000; i++) {
+                AccelerometerData a = sampleWithMagnitude(mag(rng), rng);
+                double gps = i % 3 == 0 ? -1.0 : speed(rng);
+                MotionState expected = legacy.detect(a, gps);
+                MotionResult r = detector.detect(a, gps);
+                if (r.state != expected && !legacy.nearThreshold()) same = false;
+                if (std::fabs(r.features.meanMagnitude - legacy.lastAvg) > 1e-9) same = false;
+            }
+        }
+        failures += check("detect state == legacy history average", same);
+    }
+
+    // 2. detectBatch 与逐样本 detect 的窗口特征与最终状态一致
+    {
+        std::mt19937 rng(11);
+        MotionConfig config;
+        config.sampleRateHz = 50;
+        config.historySize = 250;
+        MotionDetector perSample(config);
+        MotionDetector batched(config);
+        std::vector<double> packed = gaitSignal(50, 30, 1.9, 2.0, 0.3, rng);
+        bool same = true;
+        size_t count = packed.size() / 3;
+        size_t at = 0;
+        while (at < count) {
+            size_t n = std::min<size_t>(1 + rng() % 80, count - at);
+            MotionResult last{};
+            for (size_t i = 0; i < n; i++) {
+                const double* s = &packed[(at + i) * 3];
+                last = perSample.detect(AccelerometerData{s[0], s[1], s[2], 0}, 0.5);
+            }
+            MotionResult r = batched.detectBatch(&packed[at * 3], n, 0.5);
+            at += n;
+            same = same && r.state == last.state && r.magnitude == last.magnitude &&
+                   r.features.steps == last.features.steps &&
+                   std::fabs(r.features.variance - last.features.variance) < 1e-12 &&
+                   std::fabs(r.features.bandEnergy - last.features.bandEnergy) < 1e-12;
+        }
+        failures += check("detectBatch == per-sample detect", same);
+
+        // stride > 3：每个样本后面带时间戳
+        std::vector<double> strided;
+        for (size_t i = 0; i < count; i++) {
+            strided.insert(strided.end(), {packed[i * 3], packed[i * 3 + 1], packed[i * 3 + 2], i * 20.0});
+        }
+        MotionDetector stridedDetector(config);
+        MotionResult r = stridedDetector.detectBatch(strided.data(), count, 0.5, 4);
+        failures += check("detectBatch stride 4 == stride 3",
+                          r.features.steps == batched.features().steps &&
+                          r.features.meanMagnitude == batched.features().meanMagnitude);
+    }
+
+    // 3. 长时间流式推入：运行均值 / 方差无漂移
+    {
+        std::mt19937 rng(3);
+        std::normal_distribution<double> n(9.81, 0.8);
+        RunningWindow window(256);
+        std::vector<double> recent;
+        for (int i = 0; i < 2000000; i++) {
+            double v = n(rng);
+            window.push(v);
+            if (i >= 2000000 - 256) recent.push_back(v);
+        }
+        double mean = 0;
+        for (double v : recent) mean += v;
+        mean /= recent.size();
+        double var = 0;
+        for (double v : recent) var += (v - mean) * (v - mean);
+        var /= recent.size();
+        failures += check("running mean after 2M samples",
+                          std::fabs(window.mean() - mean) < 1e-9 * mean);
+        failures += check("running variance after 2M samples",
+                          std::fabs(window.variance() - var) < 1e-9 * var);
+    }
+
+    // 4. 步态特征：50Hz 下 1.8 步 / 秒 ≈ 108 步 / 分钟；静止噪声不计步
+    {
+        std::mt19937 rng(5);
+        MotionFeatureWindow walking(50, 500);
+        std::vector<double> packed = gaitSignal(50, 20, 1.8, 2.5, 0.3, rng);
+        walking.pushBatch(packed.data(), packed.size() / 3);
+        motion_detector::MotionFeatures f = walking.features();
+        std::printf("    walking: %d steps / %.1f s, cadence %.1f spm, band energy %.3f\n",
+                    f.steps, f.windowSeconds, f.cadence, f.bandEnergy);
+        failures += check("walking cadence ~108 spm", std::fabs(f.cadence - 108) <= 6.0);
+
+        MotionFeatureWindow still(50, 500);
+        packed = gaitSignal(50, 20, 1.8, 0.0, 0.05, rng);
+        still.pushBatch(packed.data(), packed.size() / 3);
+        f = still.features();
+        failures += check("stationary noise: no steps", f.steps == 0 && f.bandEnergy < 0.01);
+
+        MotionFeatureWindow lowRate(1, 5);
+        packed = gaitSignal(1, 20, 0.4, 2.5, 0.3, rng);
+        lowRate.pushBatch(packed.data(), packed.size() / 3);
+        f = lowRate.features();
+        failures += check("1Hz: band features disabled",
+                          !lowRate.bandEnabled() && f.steps == 0 && f.bandEnergy == 0 && f.samples == 5);
+    }
+
+    return failures;
+}
+
+// ============================================================
+// 计时
+// ============================================================
+
+void runTiming(double seconds) {
+    std::printf("timing: %.0f s of accelerometer data, 5 s window\n", seconds);
+    for (double rate : {50.0, 100.0, 200.0}) {
+        std::mt19937 rng(17);
+        std::vector<double> packed = gaitSignal(rate, seconds, 1.8, 2.5, 0.3, rng);
+        size_t count = packed.size() / 3;
+
+        MotionConfig config;
+        config.sampleRateHz = rate;
+        config.historySize = static_cast<int>(rate * 5);
+
+        int sink = 0;
+        LegacyDetector legacy;
+        legacy.config = config;
+        auto t0 = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < count; i++) {
+            const double* s = &packed[i * 3];
+            sink += static_cast<int>(legacy.detect(AccelerometerData{s[0], s[1], s[2], 0}, -1));
+        }
+        double legacyNs = elapsedMs(t0) * 1e6 / count;
+
+        MotionDetector perSample(config);
+        t0 = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < count; i++) {
+            const double* s = &packed[i * 3];
+            sink += static_cast<int>(perSample.detect(AccelerometerData{s[0], s[1], s[2], 0}, -1).state);
+        }
+        double ringNs = elapsedMs(t0) * 1e6 / count;
+
+        // 每批约 1 秒的样本
+        MotionDetector batched(config);
+        size_t batch = static_cast<size_t>(rate);
+        t0 = std::chrono::steady_clock::now();
+        for (size_t at = 0; at < count; at += batch) {
+            size_t n = std::min(batch, count - at);
+            sink += static_cast<int>(batched.detectBatch(&packed[at * 3], n, -1).state);
+        }
+        double batchNs = elapsedMs(t0) * 1e6 / count;
+
+        std::printf("  %5.0f Hz  legacy %8.1f ns/sample   ring detect %6.1f ns   batch %6.1f ns  (%.1fx)\n",
+                    rate, legacyNs, ringNs, batchNs, batchNs > 0 ? legacyNs / batchNs : 0.0);
+        if (sink == -1) std::printf("\n");
+    }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    double seconds = 600;
+    bool checkOnly = false;
+    perf::Args().option("--seconds", seconds).flag("--check-only", checkOnly).parse(argc, argv);
+
+    int failures = runCheck();
+    if (!checkOnly) runTiming(seconds);
+
+    return perf::reportMatch(failures);
+}
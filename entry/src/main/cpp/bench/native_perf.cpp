@@ -0,0 +1,224 @@
+/**
+ * native_perf.cpp — host 端原生基准与负载回放套件
+ *
+ * 各模块的 NAPI 无关核心库（native_cores.cmake）在开发机上直接跑设备上的热路径：
+ * 100k 点 GPS 轨迹、1000 条规则、24 小时事件流、1000 人声纹库（perf_workloads.h），
+ * 基准定义见 perf_geo.cpp / perf_context.cpp / perf_voiceprint.cpp。
+ * 结果为 Google Benchmark 格式的 JSON，--baseline 与之前的结果对比，用于发现性能回归。
+ *
+ * 校验：负载规模与事件流的上下文自洽；GPS CSV / 规则 JSON / 事件 JSONL 写出再读回与原负载一致；
+ * 每个基准跑 1 次迭代 × 2 次重复不出错，JSON 可解析且每个实例都有结果与汇总；
+ * 与自身对比没有回归，阈值为负时每项都报回归。
+ *
+ * 用法: native_perf [--filter REGEX] [--min-time S] [--repetitions N] [--json FILE] [--json-stdout]
+ *                   [--baseline FILE] [--max-regression F]
+ *                   [--gps-trace CSV] [--events JSONL] [--rules JSON] [--export-workloads DIR]
+ *                   [--list] [--check-only] [--dir DIR]
+ */
+#include "perf_harness.h"
+#include "perf_workloads.h"
+#include "common/json.h"
+#include "common/metrics.h"
+#include "geo_batch.h"
+#include "speaker_gallery.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+using perf::check;
+
+namespace {
+
+bool sameRules(const std::vector<context_engine::Rule>& a, const std::vector<context_engine::Rule>& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        const auto& x = a[i];
+        const auto& y = b[i];
+        if (x.id != y.id || x.priority != y.priority || x.cooldownMs != y.cooldownMs || x.enabled != y.enabled ||
+            x.action.id != y.action.id || x.action.type != y.action.type || x.action.payload != y.action.payload ||
+            x.conditions.size() != y.conditions.size()) {
+            return false;
+        }
+        for (size_t c = 0; c < x.conditions.size(); c++) {
+            if (x.conditions[c].key != y.conditions[c].key || x.conditions[c].op != y.conditions[c].op ||
+                x.conditions[c].value != y.conditions[c].value) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool sameEvents(const std::vector<bench::StreamEvent>& a, const std::vector<bench::StreamEvent>& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].timestampMs != b[i].timestampMs || a[i].eventType != b[i].eventType || a[i].key != b[i].key ||
+            a[i].value != b[i].value || a[i].context != b[i].context) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/** 事件流：时间单调、覆盖一整天，每条事件的上下文里 key 等于 value（value 为空表示 key 被移除） */
+bool streamConsistent(const std::vector<bench::StreamEvent>& events) {
+    if (events.size() < 1000) return false;
+    for (size_t i = 0; i < events.size(); i++) {
+        const auto& ev = events[i];
+        if (i > 0 && ev.timestampMs < events[i - 1].timestampMs) return false;
+        auto it = ev.context.find(ev.key);
+        if (ev.value.empty() ? it != ev.context.end() : (it == ev.context.end() || it->second != ev.value)) {
+            return false;
+        }
+    }
+    return events.back().timestampMs - events.front().timestampMs >= 23LL * 3600000;
+}
+
+bool exportWorkloads(const std::string& dir) {
+    bool ok = bench::saveGpsCsv(dir + "/gps_trace.csv", bench::gpsTrace()) &&
+              bench::saveEventsJsonl(dir + "/events_24h.jsonl", bench::eventStream()) &&
+              bench::saveRulesJson(dir + "/rules.json", bench::ruleSet());
+    std::printf("%s workloads to %s (gps_trace.csv, events_24h.jsonl, rules.json)\n", ok ? "exported" : "FAILED to export",
+                dir.c_str());
+    return ok;
+}
+
+int runCheck(const std::string& dir) {
+    int failures = 0;
+
+    const auto& trace = bench::gpsTrace();
+    const auto& events = bench::eventStream();
+    std::printf("  workloads: %zu GPS points, %zu geofences, %zu rules, %zu events, %zu speakers\n", trace.size(),
+                bench::geofences().size(), bench::ruleSet().size(), events.size(),
+                bench::speakerWorkload().names.size());
+    failures += check("workload sizes", trace.size() == bench::GPS_TRACE_POINTS &&
+                                            bench::ruleSet().size() == bench::RULE_COUNT &&
+                                            bench::speakerWorkload().names.size() == bench::SPEAKER_COUNT &&
+                                            bench::eventContexts().size() == events.size() &&
+                                            bench::eventContextJson().size() == events.size());
+    failures += check("24h event stream consistent", streamConsistent(events));
+
+    // 录制格式读回
+    {
+        std::string error;
+        std::vector<geo_utils::GeoPoint> points;
+        bool gpsOk = bench::saveGpsCsv(dir + "/native_perf_trace.csv", trace) &&
+                     bench::loadGpsCsv(dir + "/native_perf_trace.csv", points, &error) && points.size() == trace.size();
+        for (size_t i = 0; gpsOk && i < points.size(); i++) {
+            gpsOk = points[i].timestamp == trace[i].timestamp && std::fabs(points[i].latitude - trace[i].latitude) < 1e-7 &&
+                    std::fabs(points[i].longitude - trace[i].longitude) < 1e-7;
+        }
+        failures += check("GPS CSV round trip", gpsOk);
+
+        std::vector<context_engine::Rule> rules;
+        failures += check("rules JSON round trip", bench::saveRulesJson(dir + "/native_perf_rules.json", bench::ruleSet()) &&
+                                                       bench::loadRulesJson(dir + "/native_perf_rules.json", rules, &error) &&
+                                                       sameRules(rules, bench::ruleSet()));
+
+        std::vector<bench::StreamEvent> loaded;
+        failures += check("events JSONL round trip", bench::saveEventsJsonl(dir + "/native_perf_events.jsonl", events) &&
+                                                         bench::loadEventsJsonl(dir + "/native_perf_events.jsonl", loaded,
+                                                                                &error) &&
+                                                         sameEvents(loaded, events));
+        std::remove((dir + "/native_perf_trace.csv").c_str());
+        std::remove((dir + "/native_perf_rules.json").c_str());
+        std::remove((dir + "/native_perf_events.jsonl").c_str());
+    }
+
+    // 每个基准冒烟一次
+    perf::RunOptions options;
+    options.fixedIterations = 1;
+    options.repetitions = 2;
+    options.quiet = true;
+    options.jsonPath = dir + "/native_perf_check.json";
+    perf::RunSummary summary = perf::runBenchmarks(options);
+    std::vector<std::string> names = perf::listBenchmarks("");
+    failures += check("every benchmark runs without error", summary.instances == names.size() && summary.errors == 0);
+
+    native_common::json::Document doc;
+    bool parsed = doc.parse(summary.json) && doc.root()["context"].isObject();
+    size_t iterationsSeen = 0, mediansSeen = 0;
+    bool timesPositive = true;
+    for (auto b : doc.root()["benchmarks"].elements()) {
+        if (b["run_type"].str() == "aggregate") {
+            mediansSeen += b["aggregate_name"].str() == "median" ? 1 : 0;
+            continue;
+        }
+        iterationsSeen++;
+        if (!(b["real_time"].num(0) > 0) || b["time_unit"].str().empty()) timesPositive = false;
+    }
+    failures += check("JSON results parse, one entry per run", parsed && iterationsSeen == 2 * names.size() &&
+                                                                   mediansSeen == names.size() && timesPositive);
+
+    size_t compared = 0;
+    size_t selfRegressions = perf::compareWithBaseline(summary.json, summary.json, 0.10, &compared, true);
+    size_t forced = perf::compareWithBaseline(summary.json, summary.json, -0.5, nullptr, true);
+    failures += check("baseline comparison", selfRegressions == 0 && compared == names.size() &&
+                                                 forced == names.size());
+    std::remove(options.jsonPath.c_str());
+    return failures;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    perf::RunOptions options;
+    bench::WorkloadSources sources;
+    std::string exportDir;
+    std::string dir = ".";
+    bool list = false;
+    bool checkOnly = false;
+    std::string unknown;
+    perf::Args args;
+    args.option("--filter", options.filter)
+        .option("--min-time", options.minTime)
+        .option("--repetitions", [&](const char* v) { options.repetitions = std::max(1, std::atoi(v)); })
+        .option("--json", options.jsonPath)
+        .flag("--json-stdout", options.jsonToStdout)
+        .option("--baseline", options.baselinePath)
+        .option("--max-regression", options.maxRegression)
+        .option("--gps-trace", sources.gpsTracePath)
+        .option("--events", sources.eventsPath)
+        .option("--rules", sources.rulesPath)
+        .option("--export-workloads", exportDir)
+        .flag("--list", list)
+        .flag("--check-only", checkOnly)
+        .option("--dir", dir);
+    if (!args.parse(argc, argv, &unknown)) {
+        std::fprintf(stderr, "unknown option %s\n", unknown.c_str());
+        return 2;
+    }
+    bench::setWorkloadSources(sources);
+
+    if (list) {
+        for (const auto& name : perf::listBenchmarks(options.filter)) std::printf("%s\n", name.c_str());
+        return 0;
+    }
+    if (!exportDir.empty()) return exportWorkloads(exportDir) ? 0 : 1;
+
+    perf::addContext("executable", argv[0]);
+    perf::addContext("native_metrics", native_common::metrics::ENABLED ? "enabled" : "disabled");
+    perf::addContext("geo_batch_backend", geo_utils::geoBatchBackend());
+    perf::addContext("speaker_gallery_backend", voiceprint::SpeakerGallery::backend());
+    perf::addContext("gps_trace", bench::gpsTraceSource());
+    perf::addContext("events", bench::eventStreamSource());
+    perf::addContext("rules", bench::ruleSetSource());
+    perf::addContext("workload_sizes", std::to_string(bench::gpsTrace().size()) + " points, " +
+                                           std::to_string(bench::ruleSet().size()) + " rules, " +
+                                           std::to_string(bench::eventStream().size()) + " events, " +
+                                           std::to_string(bench::speakerWorkload().names.size()) + " speakers");
+
+    if (checkOnly) {
+        std::printf("native_perf check\n");
+        return perf::reportMatch(runCheck(dir));
+    }
+
+    perf::RunSummary summary = perf::runBenchmarks(options);
+    if (summary.errors > 0) {
+        std::fprintf(stderr, "%zu benchmark run(s) failed\n", summary.errors);
+        return 1;
+    }
+    if (!options.baselinePath.empty() && summary.regressions > 0) return 3;
+    return 0;
+}
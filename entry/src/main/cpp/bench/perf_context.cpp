@@ -0,0 +1,218 @@
+/**
+ * perf_context.cpp — context_engine / data_tray 的 native_perf 基准
+ *
+ * 输入为 1000 条规则与 24 小时事件流（perf_workloads.h）：
+ *   rule_engine/parse_rules_json       loadRules(rulesJson) 的 JSON 解析部分
+ *   rule_engine/load_rules             loadRules：编译条件 + 建决策树
+ *   rule_engine/add_rule_patch         已有 1000 条规则时修改一条（增量修补树）
+ *   rule_engine/evaluate_day           按事件回放 evaluate()，geofence / motion 事件同时 pushEvent；
+ *                                      默认限流（每小时 10 次）与冷却，与设备上的稳态一致
+ *   rule_engine/evaluate_incremental_day  同上，evaluateIncremental()
+ *   rule_engine/evaluate_json_day      evaluate(contextJson) 的完整原生路径：解析 + 评估 + 结果序列化
+ *   rule_engine/evaluate_batch_day/P   整天的上下文一次 evaluateBatch（dry run），P = 1 并行
+ *   linucb/select_update_day           每条事件 select + update
+ *   data_tray/replay_day               每条事件 put 变化的 key，再 getSnapshot()
+ */
+#include "perf_harness.h"
+#include "perf_workloads.h"
+#include "context_engine.h"
+#include "rule_json.h"
+#include "data_tray.h"
+#include "common/json.h"
+#include <chrono>
+
+namespace {
+
+using context_engine::ContextMap;
+using context_engine::MatchResults;
+using context_engine::Rule;
+using context_engine::RuleEngine;
+
+int64_t steadyNowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/** 时序条件关心的事件类型（其余事件只更新上下文） */
+bool isTemporalEvent(const std::string& type) {
+    return type == "geofence_enter" || type == "geofence_exit" || type == "motion_change";
+}
+
+int64_t eventCount() { return static_cast<int64_t>(bench::eventStream().size()); }
+
+void parseRulesJson(perf::State& state) {
+    const std::string& json = bench::ruleSetJson();
+    native_common::json::Document doc;
+    size_t rules = 0;
+    for (auto _ : state) {
+        auto parsed = context_engine::parseRulesArray(json, doc);
+        rules = parsed.size();
+        perf::doNotOptimize(parsed.data());
+    }
+    state.setItemsProcessed(state.iterations() * static_cast<int64_t>(rules));
+    state.setBytesProcessed(state.iterations() * static_cast<int64_t>(json.size()));
+}
+PERF_BENCHMARK("rule_engine/parse_rules_json", parseRulesJson)->unit(perf::Unit::Ms);
+
+void loadRules(perf::State& state) {
+    const auto& rules = bench::ruleSet();
+    RuleEngine engine;
+    for (auto _ : state) {
+        engine.loadRules(rules);
+        perf::clobberMemory();
+    }
+    context_engine::TreeStats stats = engine.treeStats();
+    state.setItemsProcessed(state.iterations() * static_cast<int64_t>(rules.size()));
+    state.setCounter("tree_nodes", static_cast<double>(stats.nodeCount));
+    state.setCounter("tree_depth", static_cast<double>(stats.maxDepth));
+}
+PERF_BENCHMARK("rule_engine/load_rules", loadRules)->unit(perf::Unit::Ms);
+
+void addRulePatch(perf::State& state) {
+    const auto& rules = bench::ruleSet();
+    RuleEngine engine;
+    engine.loadRules(rules);
+    // 轮流把一条规则的首个条件改成另一个值再改回来
+    std::vector<Rule> edited;
+    for (size_t i = 0; i < rules.size() && edited.size() < 64; i += rules.size() / 64 + 1) {
+        Rule r = rules[i];
+        if (!r.conditions.empty()) r.conditions.back().value += "_x";
+        edited.push_back(std::move(r));
+    }
+    size_t k = 0;
+    for (auto _ : state) {
+        engine.addRule(edited[k % edited.size()]);
+        k++;
+    }
+    state.setItemsProcessed(state.iterations());
+}
+PERF_BENCHMARK("rule_engine/add_rule_patch", addRulePatch);
+
+void evaluateDay(perf::State& state) {
+    const auto& events = bench::eventStream();
+    RuleEngine engine;
+    engine.loadRules(bench::ruleSet());
+    MatchResults out;
+    size_t matches = 0;
+    for (auto _ : state) {
+        matches = 0;
+        for (const auto& ev : events) {
+            if (isTemporalEvent(ev.eventType)) engine.pushEvent({ContextMap(), steadyNowMs(), ev.eventType});
+            engine.evaluate(ev.context, 5, out);
+            matches += out.size();
+        }
+        perf::doNotOptimize(matches);
+    }
+    state.setItemsProcessed(state.iterations() * eventCount());
+    state.setCounter("matches", static_cast<double>(matches));
+}
+PERF_BENCHMARK("rule_engine/evaluate_day", evaluateDay)->unit(perf::Unit::Ms);
+
+void evaluateIncrementalDay(perf::State& state) {
+    const auto& events = bench::eventStream();
+    RuleEngine engine;
+    engine.loadRules(bench::ruleSet());
+    MatchResults out;
+    context_engine::IncrementalStats stats;
+    size_t matched = 0, full = 0;
+    for (auto _ : state) {
+        matched = 0;
+        full = 0;
+        for (const auto& ev : events) {
+            if (isTemporalEvent(ev.eventType)) engine.pushEvent({ContextMap(), steadyNowMs(), ev.eventType});
+            engine.evaluateIncremental(ev.context, 5, out, &stats);
+            matched += stats.rulesMatched;
+            full += stats.full ? 1 : 0;
+        }
+        perf::doNotOptimize(matched);
+    }
+    state.setItemsProcessed(state.iterations() * eventCount());
+    state.setCounter("rules_matched_per_event", static_cast<double>(matched) / static_cast<double>(eventCount()));
+    state.setCounter("full_passes", static_cast<double>(full));
+}
+PERF_BENCHMARK("rule_engine/evaluate_incremental_day", evaluateIncrementalDay)->unit(perf::Unit::Ms);
+
+void evaluateJsonDay(perf::State& state) {
+    const auto& json = bench::eventContextJson();
+    RuleEngine engine;
+    engine.loadRules(bench::ruleSet());
+    native_common::json::Document doc;
+    ContextMap ctx;
+    MatchResults results;
+    std::string out;
+    int64_t bytes = 0;
+    for (const auto& s : json) bytes += static_cast<int64_t>(s.size());
+    for (auto _ : state) {
+        for (const auto& s : json) {
+            if (doc.parse(s)) context_engine::parseContextMap(doc.root(), ctx);
+            engine.evaluate(ctx, 5, results);
+            out.clear();
+            context_engine::matchResultsJson(results, out);
+        }
+        perf::doNotOptimize(out.data());
+    }
+    state.setItemsProcessed(state.iterations() * eventCount());
+    state.setBytesProcessed(state.iterations() * bytes);
+}
+PERF_BENCHMARK("rule_engine/evaluate_json_day", evaluateJsonDay)->unit(perf::Unit::Ms);
+
+void evaluateBatchDay(perf::State& state) {
+    const auto& contexts = bench::eventContexts();
+    RuleEngine engine;
+    engine.loadRules(bench::ruleSet());
+    context_engine::BatchOptions options;
+    options.dryRun = true;
+    options.parallel = state.arg(0) != 0;
+    size_t matches = 0;
+    for (auto _ : state) {
+        auto batch = engine.evaluateBatch(contexts, options);
+        matches = batch.ruleIndex.size();
+        perf::doNotOptimize(batch.offsets.data());
+    }
+    state.setItemsProcessed(state.iterations() * static_cast<int64_t>(contexts.size()));
+    state.setCounter("matches", static_cast<double>(matches));
+}
+PERF_BENCHMARK("rule_engine/evaluate_batch_day", evaluateBatchDay)->arg(0)->arg(1)->unit(perf::Unit::Ms);
+
+void linucbSelectUpdateDay(perf::State& state) {
+    const auto& events = bench::eventStream();
+    std::vector<std::string> actions;
+    for (int i = 0; i < 20; i++) actions.push_back("action_" + std::to_string(i));
+    context_engine::LinUCB bandit(0.5);
+    uint64_t picks = 0;
+    for (auto _ : state) {
+        for (const auto& ev : events) {
+            int idx = bandit.select(actions, ev.context);
+            // 奖励只取决于动作与运动状态，足以让各臂分化
+            auto motion = ev.context.find("motionState");
+            double reward = (motion != ev.context.end() && motion->second.size() % 4 == static_cast<size_t>(idx % 4))
+                                ? 1.0 : 0.0;
+            bandit.update(actions[static_cast<size_t>(idx)], reward, ev.context);
+            picks += static_cast<uint64_t>(idx);
+        }
+        perf::doNotOptimize(picks);
+    }
+    state.setItemsProcessed(state.iterations() * eventCount());
+}
+PERF_BENCHMARK("linucb/select_update_day", linucbSelectUpdateDay)->unit(perf::Unit::Ms);
+
+void dataTrayReplayDay(perf::State& state) {
+    const auto& events = bench::eventStream();
+    data_tray::SensorDataTray& tray = data_tray::SensorDataTray::getInstance();
+    tray.clear();
+    std::vector<int> slots;
+    for (const auto& ev : events) slots.push_back(tray.slotId(ev.key));
+    size_t populated = 0;
+    for (auto _ : state) {
+        for (size_t i = 0; i < events.size(); i++) {
+            tray.put(slots[i], data_tray::TrayValue::ofString(events[i].value), 1.0, events[i].eventType);
+            auto snap = tray.getSnapshot();
+            populated += snap.motionState.empty() ? 0 : 1;
+        }
+        perf::doNotOptimize(populated);
+    }
+    state.setItemsProcessed(state.iterations() * eventCount());
+}
+PERF_BENCHMARK("data_tray/replay_day", dataTrayReplayDay)->unit(perf::Unit::Ms);
+
+}  // namespace
@@ -0,0 +1,197 @@
+/**
+ * perf_geo.cpp — geo_utils / dbscan / location_fusion 的 native_perf 基准
+ *
+ * 输入为 100k 点 GPS 轨迹与 200 个围栏（perf_workloads.h）：
+ *   geo/haversine_batch          家到全部轨迹点的距离（SIMD 批量内核）
+ *   geo/percentile_radius        全部点的 95 分位半径
+ *   geo/geofences_at_location    每个点对全部围栏逐个判断（getGeofencesAtLocation）
+ *   geo/geofence_index_contains  常驻围栏网格索引查询
+ *   dbscan/cluster/N             轨迹前 N 个点的全量网格 DBSCAN
+ *   dbscan/incremental_hourly/N  前 N 个点按小时分批 insert + 滑出 24 小时窗口的 expire
+ *
+ * 常驻地点是几万点的稠密簇，DBSCAN 的邻居数随点数线性增长（整体 O(n²)，100k 点单次约 1 分钟），
+ * 所以聚类基准只取轨迹前 N 个点（10k 点约 3 天），与设备上按窗口聚类的规模相当。
+ *   location_fusion/scan         编译后的信号倒排 + 围栏网格，每个点一次扫描
+ */
+#include "perf_harness.h"
+#include "perf_workloads.h"
+#include "dbscan_cluster.h"
+#include "fusion_index.h"
+#include "geo_batch.h"
+#include "geofence_index.h"
+#include "incremental_dbscan.h"
+#include <random>
+
+namespace {
+
+using geo_utils::GeoPoint;
+using geo_utils::GeoPointSoA;
+
+/** 每个查询点一个的基准取轨迹的前 QUERY_POINTS 个点 */
+constexpr size_t QUERY_POINTS = 10000;
+
+const GeoPointSoA& traceSoA() {
+    static const GeoPointSoA soa = [] {
+        GeoPointSoA s;
+        s.assign(bench::gpsTrace());
+        return s;
+    }();
+    return soa;
+}
+
+void haversineBatch(perf::State& state) {
+    const GeoPointSoA& pts = traceSoA();
+    const auto& home = bench::geofences()[0];
+    std::vector<double> out;
+    for (auto _ : state) {
+        geo_utils::haversineMany(home.latitude, home.longitude, pts, out);
+        perf::doNotOptimize(out.data());
+    }
+    state.setItemsProcessed(state.iterations() * static_cast<int64_t>(pts.size()));
+    state.setLabel(geo_utils::geoBatchBackend());
+}
+PERF_BENCHMARK("geo/haversine_batch", haversineBatch);
+
+void percentileRadius(perf::State& state) {
+    const GeoPointSoA& pts = traceSoA();
+    const auto& home = bench::geofences()[0];
+    double radius = 0;
+    for (auto _ : state) {
+        radius = geo_utils::calculatePercentileRadius(pts, home.latitude, home.longitude, 0.95);
+        perf::doNotOptimize(radius);
+    }
+    state.setItemsProcessed(state.iterations() * static_cast<int64_t>(pts.size()));
+    state.setCounter("radius_m", radius);
+}
+PERF_BENCHMARK("geo/percentile_radius", percentileRadius);
+
+void geofencesAtLocation(perf::State& state) {
+    const auto& trace = bench::gpsTrace();
+    const auto& fences = bench::geofences();
+    GeoPointSoA centers;
+    centers.assign(fences);
+    size_t n = std::min(QUERY_POINTS, trace.size());
+    size_t inside = 0;
+    for (auto _ : state) {
+        inside = 0;
+        for (size_t i = 0; i < n; i++) {
+            auto matches = geo_utils::getGeofencesAtLocation(trace[i].latitude, trace[i].longitude, fences, centers);
+            for (const auto& m : matches) inside += m.inside ? 1 : 0;
+        }
+        perf::doNotOptimize(inside);
+    }
+    state.setItemsProcessed(state.iterations() * static_cast<int64_t>(n));
+    state.setCounter("inside", static_cast<double>(inside));
+}
+PERF_BENCHMARK("geo/geofences_at_location", geofencesAtLocation)->unit(perf::Unit::Ms);
+
+void geofenceIndexContains(perf::State& state) {
+    const auto& trace = bench::gpsTrace();
+    geo_utils::GeofenceIndex index;
+    index.assign(bench::geofences());
+    size_t inside = 0;
+    for (auto _ : state) {
+        inside = 0;
+        for (const auto& p : trace) inside += index.queryContaining(p.latitude, p.longitude).size();
+        perf::doNotOptimize(inside);
+    }
+    state.setItemsProcessed(state.iterations() * static_cast<int64_t>(trace.size()));
+    state.setCounter("inside", static_cast<double>(inside));
+}
+PERF_BENCHMARK("geo/geofence_index_contains", geofenceIndexContains)->unit(perf::Unit::Ms);
+
+/** 轨迹前 state.arg(0) 个点 */
+std::vector<GeoPoint> tracePrefix(const perf::State& state) {
+    const auto& trace = bench::gpsTrace();
+    size_t n = std::min(static_cast<size_t>(state.arg(0)), trace.size());
+    return std::vector<GeoPoint>(trace.begin(), trace.begin() + static_cast<std::ptrdiff_t>(n));
+}
+
+void dbscanCluster(perf::State& state) {
+    const std::vector<GeoPoint> points = tracePrefix(state);
+    size_t clusters = 0;
+    for (auto _ : state) {
+        dbscan::DBSCAN db;
+        auto result = db.cluster(points);
+        clusters = result.size();
+        perf::doNotOptimize(result.data());
+    }
+    state.setItemsProcessed(state.iterations() * static_cast<int64_t>(points.size()));
+    state.setCounter("clusters", static_cast<double>(clusters));
+}
+PERF_BENCHMARK("dbscan/cluster", dbscanCluster)->arg(2000)->arg(10000)->unit(perf::Unit::Ms);
+
+void dbscanIncrementalHourly(perf::State& state) {
+    const std::vector<GeoPoint> trace = tracePrefix(state);
+    constexpr int64_t HOUR_MS = 3600000;
+    constexpr int64_t WINDOW_MS = 24 * HOUR_MS;
+
+    // 按小时切分成批
+    std::vector<std::vector<GeoPoint>> batches;
+    for (const auto& p : trace) {
+        if (batches.empty() || p.timestamp / HOUR_MS != batches.back().front().timestamp / HOUR_MS) {
+            batches.emplace_back();
+        }
+        batches.back().push_back(p);
+    }
+    size_t clusters = 0;
+    for (auto _ : state) {
+        dbscan::IncrementalDBSCAN db;
+        for (const auto& batch : batches) {
+            db.insert(batch);
+            db.expire(batch.back().timestamp - WINDOW_MS);
+        }
+        clusters = db.clusterCount();
+        perf::doNotOptimize(clusters);
+    }
+    state.setItemsProcessed(state.iterations() * static_cast<int64_t>(trace.size()));
+    state.setCounter("batches", static_cast<double>(batches.size()));
+    state.setCounter("clusters", static_cast<double>(clusters));
+}
+PERF_BENCHMARK("dbscan/incremental_hourly", dbscanIncrementalHourly)->arg(2000)->arg(10000)->unit(perf::Unit::Ms);
+
+void locationFusionScan(perf::State& state) {
+    const auto& trace = bench::gpsTrace();
+    const auto& fences = bench::geofences();
+    location_fusion::FusionIndex index;
+    index.assignFences(fences);
+
+    // 常去地点学会各自的 SSID 和一批 BT 设备，其余 POI 只学到少量信号
+    std::mt19937 rng(9);
+    auto device = [&](size_t pool) { return "bt_" + std::to_string(rng() % pool); };
+    for (size_t f = 0; f < fences.size(); f++) {
+        int observations = f < 4 ? 20 : 3;
+        for (int o = 0; o < observations; o++) {
+            std::vector<std::string> bt;
+            for (int d = 0; d < (f < 4 ? 30 : 3); d++) bt.push_back(device(800));
+            index.learn(fences[f].id, "ssid_" + std::to_string(f), bt);
+        }
+    }
+
+    size_t n = std::min(QUERY_POINTS, trace.size());
+    std::vector<location_fusion::FusionScan> scans(n);
+    for (size_t i = 0; i < n; i++) {
+        auto& s = scans[i];
+        s.hasLocation = true;
+        s.latitude = trace[i].latitude;
+        s.longitude = trace[i].longitude;
+        s.gpsAccuracy = trace[i].accuracy;
+        s.currentWifiSsid = "ssid_" + std::to_string(rng() % 8);
+        for (int d = 0; d < 40; d++) s.currentBtDevices.push_back(device(2000));
+    }
+    std::vector<location_fusion::FusionResult> out;
+    size_t results = 0;
+    for (auto _ : state) {
+        results = 0;
+        for (const auto& s : scans) {
+            index.scan(s, out);
+            results += out.size();
+        }
+        perf::doNotOptimize(results);
+    }
+    state.setItemsProcessed(state.iterations() * static_cast<int64_t>(n));
+    state.setCounter("results", static_cast<double>(results));
+}
+PERF_BENCHMARK("location_fusion/scan", locationFusionScan)->unit(perf::Unit::Ms);
+
+}  // namespace
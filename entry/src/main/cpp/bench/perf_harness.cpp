@@ -0,0 +1,534 @@
+/**
+ * perf_harness.cpp — 基准注册表、迭代标定、控制台 / JSON 输出、基线对比
+ */
+#include "perf_harness.h"
+#include "common/json.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <memory>
+#include <regex>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
+
+namespace perf {
+
+using native_common::json::Document;
+using native_common::json::Value;
+using native_common::json::Writer;
+
+namespace {
+
+constexpr int64_t MAX_ITERATIONS = 1000000000;
+
+int64_t realNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/** 进程 CPU 时间：并行的实例（evaluateBatch 等）会高于 real_time */
+int64_t cpuNowNs() {
+    timespec ts{};
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+std::vector<std::unique_ptr<Benchmark>>& registry() {
+    static std::vector<std::unique_ptr<Benchmark>> benchmarks;
+    return benchmarks;
+}
+
+std::vector<std::pair<std::string, std::string>>& contextEntries() {
+    static std::vector<std::pair<std::string, std::string>> entries;
+    return entries;
+}
+
+double unitScaleNs(Unit u) {
+    switch (u) {
+        case Unit::Ns: return 1.0;
+        case Unit::Us: return 1e3;
+        case Unit::Ms: return 1e6;
+        case Unit::S: return 1e9;
+    }
+    return 1.0;
+}
+
+const char* unitName(Unit u) {
+    switch (u) {
+        case Unit::Ns: return "ns";
+        case Unit::Us: return "us";
+        case Unit::Ms: return "ms";
+        case Unit::S: return "s";
+    }
+    return "ns";
+}
+
+double unitScaleNs(std::string_view name) {
+    if (name == "us") return 1e3;
+    if (name == "ms") return 1e6;
+    if (name == "s") return 1e9;
+    return 1.0;
+}
+
+/** 1234567 → "1.23457M" */
+std::string humanRate(double v) {
+    const char* suffix[] = {"", "k", "M", "G", "T"};
+    int i = 0;
+    while (std::fabs(v) >= 1000.0 && i < 4) {
+        v /= 1000.0;
+        i++;
+    }
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.4g%s", v, suffix[i]);
+    return buf;
+}
+
+std::string isoDate() {
+    std::time_t t = std::time(nullptr);
+    std::tm local{};
+    localtime_r(&t, &local);
+    char buf[40];
+    std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S%z", &local);
+    return buf;
+}
+
+std::string hostName() {
+    char buf[256] = {};
+    if (gethostname(buf, sizeof(buf) - 1) != 0) return "";
+    return buf;
+}
+
+}  // namespace
+
+// ============================================================
+// State
+// ============================================================
+
+State::Iterator State::begin() {
+    if (!error_.empty()) return {this, 0};
+    started_ = true;
+    resumeTiming();
+    return {this, iterations_};
+}
+
+void State::pauseTiming() {
+    if (!running_) return;
+    realNs_ += realNowNs() - realStart_;
+    cpuNs_ += cpuNowNs() - cpuStart_;
+    running_ = false;
+}
+
+void State::resumeTiming() {
+    if (running_) return;
+    running_ = true;
+    cpuStart_ = cpuNowNs();
+    realStart_ = realNowNs();
+}
+
+void State::stopTimer() {
+    pauseTiming();
+    finished_ = true;
+}
+
+void State::skipWithError(std::string message) {
+    pauseTiming();
+    error_ = std::move(message);
+}
+
+Benchmark* registerBenchmark(const char* name, Function fn) {
+    registry().push_back(std::make_unique<Benchmark>(name, std::move(fn)));
+    return registry().back().get();
+}
+
+void addContext(const std::string& key, const std::string& value) {
+    for (auto& entry : contextEntries()) {
+        if (entry.first == key) {
+            entry.second = value;
+            return;
+        }
+    }
+    contextEntries().emplace_back(key, value);
+}
+
+// ============================================================
+// Runner
+// ============================================================
+
+struct RunResult {
+    std::string name;
+    int familyIndex = 0;
+    int instanceIndex = 0;
+    Unit unit = Unit::Us;
+    int64_t iterations = 0;
+    double realNs = 0;          // 每次迭代
+    double cpuNs = 0;
+    double itemsPerSecond = 0;
+    double bytesPerSecond = 0;
+    std::string label;
+    std::map<std::string, double> counters;
+    std::string error;
+};
+
+class Runner {
+public:
+    explicit Runner(const RunOptions& options) : options_(options) {}
+
+    struct Instance {
+        Benchmark* bench;
+        int familyIndex;
+        int instanceIndex;
+        std::vector<int64_t> args;
+        std::string name;
+    };
+
+    static std::vector<Instance> instances(const std::string& filter) {
+        std::vector<Instance> out;
+        std::regex re(filter.empty() ? std::string(".*") : filter);
+        int family = 0;
+        for (const auto& b : registry()) {
+            std::vector<std::vector<int64_t>> sets = b->argSets_;
+            if (sets.empty()) sets.push_back({});
+            int index = 0;
+            bool any = false;
+            for (const auto& args : sets) {
+                std::string name = b->name_;
+                for (int64_t a : args) name += "/" + std::to_string(a);
+                if (!std::regex_search(name, re)) continue;
+                out.push_back({b.get(), family, index++, args, name});
+                any = true;
+            }
+            if (any) family++;
+        }
+        return out;
+    }
+
+    /** 一次重复：跑 iterations 次，返回每次迭代的耗时 */
+    RunResult runOnce(const Instance& inst, int64_t iterations) {
+        State state(iterations, inst.args);
+        inst.bench->fn_(state);
+        state.pauseTiming();
+
+        RunResult r;
+        r.name = inst.name;
+        r.familyIndex = inst.familyIndex;
+        r.instanceIndex = inst.instanceIndex;
+        r.unit = inst.bench->unit_;
+        r.iterations = iterations;
+        r.label = state.label_;
+        r.counters = state.counters_;
+        r.error = state.error_;
+        if (r.error.empty() && !state.started_) r.error = "benchmark did not enter the state loop";
+        if (!r.error.empty()) return r;
+
+        double n = static_cast<double>(iterations);
+        r.realNs = static_cast<double>(state.realNs_) / n;
+        r.cpuNs = static_cast<double>(state.cpuNs_) / n;
+        double seconds = static_cast<double>(state.realNs_) / 1e9;
+        if (seconds > 0) {
+            r.itemsPerSecond = static_cast<double>(state.items_) / seconds;
+            r.bytesPerSecond = static_cast<double>(state.bytes_) / seconds;
+        }
+        return r;
+    }
+
+    /** 标定迭代次数：单次重复耗时达到 minTime 为止；标定的最后一轮即第一次重复 */
+    std::vector<RunResult> run(const Instance& inst) {
+        std::vector<RunResult> reps;
+        int64_t iterations = options_.fixedIterations > 0 ? options_.fixedIterations : inst.bench->iterations_;
+        RunResult first;
+        if (iterations > 0) {
+            first = runOnce(inst, iterations);
+        } else {
+            double minTime = inst.bench->minTime_ > 0 ? inst.bench->minTime_ : options_.minTime;
+            iterations = 1;
+            for (;;) {
+                first = runOnce(inst, iterations);
+                if (!first.error.empty()) break;
+                double seconds = first.realNs * static_cast<double>(iterations) / 1e9;
+                if (seconds >= minTime || iterations >= MAX_ITERATIONS) break;
+                double multiplier = minTime * 1.4 / std::max(seconds, 1e-9);
+                if (seconds / minTime <= 0.1) multiplier = std::min(multiplier, 10.0);
+                int64_t next = static_cast<int64_t>(static_cast<double>(iterations) * multiplier);
+                iterations = std::min(MAX_ITERATIONS, std::max(iterations + 1, next));
+            }
+        }
+        reps.push_back(first);
+        for (int rep = 1; rep < options_.repetitions && first.error.empty(); rep++) {
+            reps.push_back(runOnce(inst, iterations));
+        }
+        return reps;
+    }
+
+private:
+    const RunOptions& options_;
+};
+
+namespace {
+
+struct Aggregate {
+    const char* name;
+    double realNs;
+    double cpuNs;
+};
+
+std::vector<Aggregate> aggregates(const std::vector<RunResult>& reps) {
+    std::vector<double> real, cpu;
+    for (const auto& r : reps) {
+        if (!r.error.empty()) return {};
+        real.push_back(r.realNs);
+        cpu.push_back(r.cpuNs);
+    }
+    auto mean = [](const std::vector<double>& v) {
+        double s = 0;
+        for (double x : v) s += x;
+        return s / static_cast<double>(v.size());
+    };
+    auto median = [](std::vector<double> v) {
+        std::sort(v.begin(), v.end());
+        size_t n = v.size();
+        return n % 2 == 1 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2;
+    };
+    auto stddev = [&](const std::vector<double>& v) {
+        double m = mean(v), s = 0;
+        for (double x : v) s += (x - m) * (x - m);
+        return v.size() > 1 ? std::sqrt(s / static_cast<double>(v.size() - 1)) : 0.0;
+    };
+    auto minimum = [](const std::vector<double>& v) { return *std::min_element(v.begin(), v.end()); };
+    return {
+        {"mean", mean(real), mean(cpu)},
+        {"median", median(real), median(cpu)},
+        {"stddev", stddev(real), stddev(cpu)},
+        {"min", minimum(real), minimum(cpu)},
+    };
+}
+
+void writeRun(Writer& w, const RunResult& r, int repetitions, int repetitionIndex) {
+    double scale = unitScaleNs(r.unit);
+    w.beginObject();
+    w.member("name", r.name);
+    w.member("family_index", r.familyIndex);
+    w.member("per_family_instance_index", r.instanceIndex);
+    w.member("run_name", r.name);
+    w.member("run_type", "iteration");
+    w.member("repetitions", repetitions);
+    w.member("repetition_index", repetitionIndex);
+    w.member("threads", 1);
+    w.member("iterations", r.iterations);
+    if (!r.error.empty()) {
+        w.member("error_occurred", true);
+        w.member("error_message", r.error);
+    }
+    w.member("real_time", r.realNs / scale);
+    w.member("cpu_time", r.cpuNs / scale);
+    w.member("time_unit", unitName(r.unit));
+    if (r.itemsPerSecond > 0) w.member("items_per_second", r.itemsPerSecond);
+    if (r.bytesPerSecond > 0) w.member("bytes_per_second", r.bytesPerSecond);
+    if (!r.label.empty()) w.member("label", r.label);
+    for (const auto& [k, v] : r.counters) w.member(k, v);
+    w.endObject();
+}
+
+void writeAggregate(Writer& w, const RunResult& r, const Aggregate& a, int repetitions) {
+    double scale = unitScaleNs(r.unit);
+    w.beginObject();
+    w.member("name", r.name + "_" + a.name);
+    w.member("family_index", r.familyIndex);
+    w.member("per_family_instance_index", r.instanceIndex);
+    w.member("run_name", r.name);
+    w.member("run_type", "aggregate");
+    w.member("repetitions", repetitions);
+    w.member("threads", 1);
+    w.member("aggregate_name", a.name);
+    w.member("iterations", static_cast<int64_t>(repetitions));
+    w.member("real_time", a.realNs / scale);
+    w.member("cpu_time", a.cpuNs / scale);
+    w.member("time_unit", unitName(r.unit));
+    w.endObject();
+}
+
+void printHeader() {
+    std::printf("%-52s %14s %14s %12s %s\n", "Benchmark", "Time", "CPU", "Iterations", "UserCounters...");
+    std::printf("%s\n", std::string(110, '-').c_str());
+}
+
+void printRow(const std::string& name, const RunResult& r, double realNs, double cpuNs, bool withCounters) {
+    if (!r.error.empty()) {
+        std::printf("%-52s ERROR: %s\n", name.c_str(), r.error.c_str());
+        return;
+    }
+    double scale = unitScaleNs(r.unit);
+    std::printf("%-52s %11.4g %-2s %11.4g %-2s %12lld", name.c_str(), realNs / scale, unitName(r.unit),
+                cpuNs / scale, unitName(r.unit), static_cast<long long>(r.iterations));
+    if (withCounters) {
+        if (r.itemsPerSecond > 0) std::printf(" items_per_second=%s/s", humanRate(r.itemsPerSecond).c_str());
+        if (r.bytesPerSecond > 0) std::printf(" bytes_per_second=%sB/s", humanRate(r.bytesPerSecond).c_str());
+        for (const auto& [k, v] : r.counters) std::printf(" %s=%s", k.c_str(), humanRate(v).c_str());
+        if (!r.label.empty()) std::printf(" %s", r.label.c_str());
+    }
+    std::printf("\n");
+    std::fflush(stdout);
+}
+
+}  // namespace
+
+std::vector<std::string> listBenchmarks(const std::string& filter) {
+    std::vector<std::string> names;
+    for (const auto& inst : Runner::instances(filter)) names.push_back(inst.name);
+    return names;
+}
+
+RunSummary runBenchmarks(const RunOptions& options) {
+    RunSummary summary;
+    Runner runner(options);
+    auto instances = Runner::instances(options.filter);
+    bool console = !options.quiet && !options.jsonToStdout;
+    if (console) printHeader();
+
+    std::string& json = summary.json;
+    Writer w(json);
+    w.beginObject();
+    w.key("context");
+    w.beginObject();
+    w.member("date", isoDate());
+    w.member("host_name", hostName());
+    w.member("num_cpus", static_cast<int64_t>(std::thread::hardware_concurrency()));
+#ifdef NDEBUG
+    w.member("library_build_type", "release");
+#else
+    w.member("library_build_type", "debug");
+#endif
+    for (const auto& [k, v] : contextEntries()) w.member(k, v);
+    w.endObject();
+
+    w.key("benchmarks");
+    w.beginArray();
+    for (const auto& inst : instances) {
+        std::vector<RunResult> reps = runner.run(inst);
+        summary.instances++;
+        int repetitions = static_cast<int>(reps.size());
+        for (int i = 0; i < repetitions; i++) {
+            const RunResult& r = reps[static_cast<size_t>(i)];
+            if (!r.error.empty()) summary.errors++;
+            writeRun(w, r, repetitions, i);
+            if (console) printRow(r.name, r, r.realNs, r.cpuNs, true);
+        }
+        if (repetitions > 1) {
+            for (const auto& a : aggregates(reps)) {
+                writeAggregate(w, reps[0], a, repetitions);
+                if (console) printRow(reps[0].name + "_" + a.name, reps[0], a.realNs, a.cpuNs, false);
+            }
+        }
+    }
+    w.endArray();
+    w.endObject();
+    json.push_back('\n');
+
+    if (options.jsonToStdout) std::fputs(json.c_str(), stdout);
+    if (!options.jsonPath.empty()) {
+        std::ofstream out(options.jsonPath, std::ios::binary | std::ios::trunc);
+        out << json;
+        if (!out) {
+            std::fprintf(stderr, "cannot write %s\n", options.jsonPath.c_str());
+            summary.errors++;
+        }
+    }
+
+    if (!options.baselinePath.empty()) {
+        std::ifstream in(options.baselinePath, std::ios::binary);
+        std::stringstream buf;
+        buf << in.rdbuf();
+        if (!in) {
+            std::fprintf(stderr, "cannot read baseline %s\n", options.baselinePath.c_str());
+            summary.errors++;
+        } else {
+            summary.regressions = compareWithBaseline(json, buf.str(), options.maxRegression, &summary.compared,
+                                                      options.jsonToStdout);
+        }
+    }
+    return summary;
+}
+
+// ============================================================
+// 基线对比
+// ============================================================
+
+namespace {
+
+/** run_name → 代表耗时（ns）；保持首次出现的顺序 */
+std::vector<std::pair<std::string, double>> representativeTimes(const Document& doc) {
+    std::vector<std::pair<std::string, double>> order;
+    std::map<std::string, double> median, minimum;
+    for (Value b : doc.root()["benchmarks"].elements()) {
+        if (b["error_occurred"].boolean(false)) continue;
+        std::string name(b["run_name"].str(b["name"].str()));
+        double ns = b["real_time"].num(0) * unitScaleNs(b["time_unit"].str("ns"));
+        if (b["run_type"].str() == "aggregate") {
+            if (b["aggregate_name"].str() == "median") median[name] = ns;
+            continue;
+        }
+        auto it = minimum.find(name);
+        if (it == minimum.end()) {
+            minimum[name] = ns;
+            order.emplace_back(name, 0);
+        } else {
+            it->second = std::min(it->second, ns);
+        }
+    }
+    for (auto& [name, ns] : order) {
+        auto m = median.find(name);
+        ns = m != median.end() ? m->second : minimum[name];
+    }
+    return order;
+}
+
+std::string formatNs(double ns) {
+    char buf[32];
+    if (ns >= 1e9) std::snprintf(buf, sizeof(buf), "%.3g s", ns / 1e9);
+    else if (ns >= 1e6) std::snprintf(buf, sizeof(buf), "%.3g ms", ns / 1e6);
+    else if (ns >= 1e3) std::snprintf(buf, sizeof(buf), "%.3g us", ns / 1e3);
+    else std::snprintf(buf, sizeof(buf), "%.3g ns", ns);
+    return buf;
+}
+
+}  // namespace
+
+size_t compareWithBaseline(const std::string& currentJson, const std::string& baselineJson, double maxRegression,
+                           size_t* compared, bool quiet) {
+    Document current, baseline;
+    if (!current.parse(currentJson) || !baseline.parse(baselineJson)) {
+        std::fprintf(stderr, "baseline comparison: malformed JSON\n");
+        if (compared != nullptr) *compared = 0;
+        return 1;
+    }
+    auto base = representativeTimes(baseline);
+    std::map<std::string, double> baseByName(base.begin(), base.end());
+
+    size_t regressions = 0;
+    size_t matched = 0;
+    if (!quiet) {
+        std::printf("\n%-52s %12s %12s %9s\n", "Comparison (real_time)", "baseline", "current", "change");
+    }
+    for (const auto& [name, ns] : representativeTimes(current)) {
+        auto it = baseByName.find(name);
+        if (it == baseByName.end() || it->second <= 0) continue;
+        matched++;
+        double change = ns / it->second - 1.0;
+        bool regressed = change > maxRegression;
+        if (regressed) regressions++;
+        if (!quiet) {
+            std::printf("%-52s %12s %12s %+8.1f%%%s\n", name.c_str(), formatNs(it->second).c_str(),
+                        formatNs(ns).c_str(), change * 100, regressed ? "  REGRESSION" : "");
+        }
+    }
+    if (!quiet) {
+        std::printf("%zu compared, %zu regressed beyond %+.0f%%\n", matched, regressions, maxRegression * 100);
+    }
+    if (compared != nullptr) *compared = matched;
+    return regressions;
+}
+
+}  // namespace perf
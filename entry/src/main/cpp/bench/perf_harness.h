@@ -0,0 +1,252 @@
+/**
+ * perf_harness.h — host 端基准框架（Google Benchmark 风格，不引入第三方依赖）
+ *
+ * 注册与循环写法与 Google Benchmark 相同，准备工作放在循环外，不计时：
+ *   void ruleEngineEvaluate(perf::State& state) {
+ *       RuleEngine engine;  ...
+ *       for (auto _ : state) { ... perf::doNotOptimize(results); }
+ *       state.setItemsProcessed(state.iterations() * contexts.size());
+ *   }
+ *   PERF_BENCHMARK("rule_engine/evaluate", ruleEngineEvaluate)->arg(1000)->unit(perf::Unit::Ms);
+ *
+ * 迭代次数自动标定到单次重复至少 minTime 秒；--repetitions N 时另给出 mean / median / stddev / min 汇总。
+ * JSON 输出沿用 Google Benchmark 的格式（context + benchmarks[]，run_type / aggregate_name /
+ * real_time / cpu_time / time_unit / items_per_second），现成的对比脚本可以直接读；
+ * --baseline 与之前的 JSON 逐项对比，超出 --max-regression 即返回非 0。
+ *
+ * 末尾的 elapsedMs / check / Args / reportMatch 是各 *_bench 共用的小工具，全部内联，
+ * 只用这些的程序不需要链接 perf_harness.cpp。
+ */
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace perf {
+
+enum class Unit { Ns, Us, Ms, S };
+
+class State {
+public:
+    struct Iterator {
+        State* state;
+        int64_t remaining;
+        bool operator!=(const Iterator&) {
+            if (remaining-- > 0) return true;
+            state->stopTimer();
+            return false;
+        }
+        void operator++() {}
+        struct [[maybe_unused]] Value {};   // for (auto _ : state) 不触发 unused-variable
+        Value operator*() const { return {}; }
+    };
+
+    /** 第一次取 begin() 时开始计时 */
+    Iterator begin();
+    Iterator end() { return {this, 0}; }
+
+    /** 当前实例的参数（->arg / ->args 注册的第 i 个） */
+    int64_t arg(size_t i = 0) const { return i < args_.size() ? args_[i] : 0; }
+    int64_t iterations() const { return iterations_; }
+
+    /** 循环内不计时的部分（如每轮重建输入） */
+    void pauseTiming();
+    void resumeTiming();
+
+    void setItemsProcessed(int64_t n) { items_ = n; }
+    void setBytesProcessed(int64_t n) { bytes_ = n; }
+    void setLabel(std::string label) { label_ = std::move(label); }
+    /** 原样写入 JSON 的自定义计数（如命中数、簇数） */
+    void setCounter(const std::string& name, double value) { counters_[name] = value; }
+    /** 标记本实例失败，结果里带 error_message，不参与对比 */
+    void skipWithError(std::string message);
+
+private:
+    friend class Runner;
+    State(int64_t iterations, std::vector<int64_t> args) : iterations_(iterations), args_(std::move(args)) {}
+    void stopTimer();
+
+    int64_t iterations_;
+    std::vector<int64_t> args_;
+    bool running_ = false;
+    bool started_ = false;
+    bool finished_ = false;
+    int64_t realStart_ = 0;
+    int64_t cpuStart_ = 0;
+    int64_t realNs_ = 0;
+    int64_t cpuNs_ = 0;
+    int64_t items_ = 0;
+    int64_t bytes_ = 0;
+    std::string label_;
+    std::map<std::string, double> counters_;
+    std::string error_;
+};
+
+using Function = std::function<void(State&)>;
+
+class Benchmark {
+public:
+    Benchmark(std::string name, Function fn) : name_(std::move(name)), fn_(std::move(fn)) {}
+
+    /** 每个参数一个实例，名字追加 "/<v>" */
+    Benchmark* arg(int64_t v) { argSets_.push_back({v}); return this; }
+    Benchmark* args(std::vector<int64_t> v) { argSets_.push_back(std::move(v)); return this; }
+    Benchmark* unit(Unit u) { unit_ = u; return this; }
+    /** 固定迭代次数，不标定（很慢的端到端负载） */
+    Benchmark* iterations(int64_t n) { iterations_ = n; return this; }
+    Benchmark* minTime(double seconds) { minTime_ = seconds; return this; }
+
+private:
+    friend class Runner;
+    std::string name_;
+    Function fn_;
+    std::vector<std::vector<int64_t>> argSets_;
+    Unit unit_ = Unit::Us;
+    int64_t iterations_ = 0;
+    double minTime_ = 0;
+};
+
+Benchmark* registerBenchmark(const char* name, Function fn);
+
+/** 写进 JSON context 的附加信息（负载来源、内核后端等） */
+void addContext(const std::string& key, const std::string& value);
+
+/** 阻止编译器把结果当作无用计算删掉 */
+template <typename T>
+inline void doNotOptimize(T const& value) {
+    asm volatile("" : : "m"(value) : "memory");
+}
+
+template <typename T>
+inline void doNotOptimize(T& value) {
+    asm volatile("" : "+m"(value) : : "memory");
+}
+
+inline void clobberMemory() { asm volatile("" : : : "memory"); }
+
+struct RunOptions {
+    std::string filter;            // 正则，匹配实例名；空 = 全部
+    double minTime = 0.5;          // 秒
+    int repetitions = 1;
+    int64_t fixedIterations = 0;   // > 0 时所有实例都用这个次数（--check-only 冒烟）
+    std::string jsonPath;          // 空 = 不写文件
+    bool jsonToStdout = false;
+    bool quiet = false;
+    std::string baselinePath;
+    double maxRegression = 0.10;   // 相对基线慢 10% 以上算回归
+};
+
+struct RunSummary {
+    size_t instances = 0;
+    size_t errors = 0;
+    size_t regressions = 0;
+    size_t compared = 0;
+    std::string json;              // 写出的 JSON 全文
+};
+
+/** 已注册实例的名字（应用 filter 后） */
+std::vector<std::string> listBenchmarks(const std::string& filter);
+
+RunSummary runBenchmarks(const RunOptions& options);
+
+/**
+ * 对比两份 JSON：每个 run_name 取 median 汇总（没有则取各次重复的最小值）的 real_time，
+ * 换算到同一单位。打印 当前 / 基线 比值，返回超出阈值的项数；compared 为双方都有的项数。
+ */
+size_t compareWithBaseline(const std::string& currentJson, const std::string& baselineJson, double maxRegression,
+                           size_t* compared, bool quiet);
+
+// ============================================================
+// *_bench 共用：计时、校验行、命令行参数、结论行
+// ============================================================
+
+/** 自 t0 起经过的毫秒数 */
+inline double elapsedMs(std::chrono::steady_clock::time_point t0) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+/** 打印一行校验结果，返回失败数（0 / 1），调用方累加到 failures */
+inline int check(const char* name, bool ok) {
+    std::printf("  %-44s %s\n", name, ok ? "ok" : "FAIL");
+    return ok ? 0 : 1;
+}
+
+/** 打印结论行 match: yes / NO（ctest 日志里按它判断），返回进程退出码 */
+inline int reportMatch(int failures) {
+    std::printf("%s\n", failures == 0 ? "match: yes" : "match: NO");
+    return failures == 0 ? 0 : 1;
+}
+
+/**
+ * 命令行参数：先登记选项再 parse，值按目标变量的类型转换（int: atoi，size_t: strtoull，double: atof）
+ *   perf::Args().option("--points", numPoints).flag("--check-only", checkOnly).parse(argc, argv);
+ * 未登记的参数、缺值的选项都算无法识别：parse 返回 false，第一个写入 unknown，其余参数照常处理
+ */
+class Args {
+public:
+    Args& flag(const char* name, bool& out) {
+        options_.push_back({name, false, [&out](const char*) { out = true; }});
+        return *this;
+    }
+    Args& option(const char* name, int& out) {
+        return option(name, [&out](const char* v) { out = std::atoi(v); });
+    }
+    Args& option(const char* name, size_t& out) {
+        return option(name, [&out](const char* v) { out = std::strtoull(v, nullptr, 10); });
+    }
+    Args& option(const char* name, double& out) {
+        return option(name, [&out](const char* v) { out = std::atof(v); });
+    }
+    Args& option(const char* name, std::string& out) {
+        return option(name, [&out](const char* v) { out = v; });
+    }
+    /** 自定义解析（如逗号分隔的列表、需要下限的计数） */
+    Args& option(const char* name, std::function<void(const char*)> apply) {
+        options_.push_back({name, true, std::move(apply)});
+        return *this;
+    }
+
+    bool parse(int argc, char** argv, std::string* unknown = nullptr) const {
+        bool ok = true;
+        for (int i = 1; i < argc; i++) {
+            const Option* match = nullptr;
+            for (const auto& o : options_) {
+                if (std::strcmp(argv[i], o.name) == 0 && (!o.takesValue || i + 1 < argc)) {
+                    match = &o;
+                    break;
+                }
+            }
+            if (match == nullptr) {
+                if (ok && unknown != nullptr) *unknown = argv[i];
+                ok = false;
+                continue;
+            }
+            match->apply(match->takesValue ? argv[++i] : nullptr);
+        }
+        return ok;
+    }
+
+private:
+    struct Option {
+        const char* name;
+        bool takesValue;
+        std::function<void(const char*)> apply;
+    };
+    std::vector<Option> options_;
+};
+
+}  // namespace perf
+
+#define PERF_CONCAT_INNER(a, b) a##b
+#define PERF_CONCAT(a, b) PERF_CONCAT_INNER(a, b)
+
+#define PERF_BENCHMARK(name, fn) \
+    static ::perf::Benchmark* PERF_CONCAT(perfBenchmark_, __LINE__) [[maybe_unused]] = ::perf::registerBenchmark(name, fn)
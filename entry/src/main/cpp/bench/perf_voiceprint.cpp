@@ -0,0 +1,85 @@
+/**
+ * perf_voiceprint.cpp — 声纹库 / 流式提取的 native_perf 基准
+ *
+ *   voiceprint/enroll_gallery   清空后注册 1000 人（行归一化写入连续矩阵）
+ *   voiceprint/identify         1000 人库上 2000 次 1:N 识别（矩阵向量积 + top-3），计数 top-1 正确率
+ *   voiceprint/stream_minute    1 分钟 16 kHz 音频按 20 ms 分片送入流式提取（能量桩模型，2 个工作线程），
+ *                               衡量窗口切分 / 排队 / 批处理的开销
+ */
+#include "perf_harness.h"
+#include "perf_workloads.h"
+#include "embedding_stream.h"
+#include "speaker_gallery.h"
+#include <cmath>
+#include <memory>
+
+namespace {
+
+using voiceprint::SpeakerGallery;
+using voiceprint::SpeakerMatch;
+
+void enrollGallery(perf::State& state) {
+    const auto& w = bench::speakerWorkload();
+    SpeakerGallery gallery(w.dim);
+    for (auto _ : state) {
+        gallery.clear();
+        for (size_t s = 0; s < w.names.size(); s++) gallery.add(w.names[s], &w.embeddings[s * w.dim]);
+        perf::doNotOptimize(gallery.size());
+    }
+    state.setItemsProcessed(state.iterations() * static_cast<int64_t>(w.names.size()));
+    state.setLabel(SpeakerGallery::backend());
+}
+PERF_BENCHMARK("voiceprint/enroll_gallery", enrollGallery)->unit(perf::Unit::Ms);
+
+void identify(perf::State& state) {
+    const auto& w = bench::speakerWorkload();
+    SpeakerGallery gallery(w.dim);
+    for (size_t s = 0; s < w.names.size(); s++) gallery.add(w.names[s], &w.embeddings[s * w.dim]);
+    const size_t queries = w.queryOwner.size();
+    std::vector<SpeakerMatch> out;
+    size_t correct = 0;
+    for (auto _ : state) {
+        correct = 0;
+        for (size_t q = 0; q < queries; q++) {
+            gallery.bestMatches(&w.queries[q * w.dim], 0.5, 3, out);
+            int owner = w.queryOwner[q];
+            bool ok = owner < 0 ? out.empty() : (!out.empty() && out[0].name == w.names[static_cast<size_t>(owner)]);
+            correct += ok ? 1 : 0;
+        }
+        perf::doNotOptimize(correct);
+    }
+    state.setItemsProcessed(state.iterations() * static_cast<int64_t>(queries));
+    state.setCounter("top1_accuracy", static_cast<double>(correct) / static_cast<double>(queries));
+    state.setLabel(SpeakerGallery::backend());
+}
+PERF_BENCHMARK("voiceprint/identify", identify)->unit(perf::Unit::Ms);
+
+void streamMinute(perf::State& state) {
+    constexpr int SAMPLE_RATE = 16000;
+    constexpr size_t CHUNK = SAMPLE_RATE / 50;   // 20 ms
+    std::vector<float> audio(static_cast<size_t>(SAMPLE_RATE) * 60);
+    for (size_t i = 0; i < audio.size(); i++) {
+        // 4 Hz 包络的 220 Hz 音，能量随时间变化
+        double t = static_cast<double>(i) / SAMPLE_RATE;
+        audio[i] = static_cast<float>(0.3 * (1.2 + std::sin(2 * M_PI * 4 * t)) * std::sin(2 * M_PI * 220 * t));
+    }
+    voiceprint::StreamingExtractor extractor(std::make_shared<voiceprint::EnergyStubExtractor>(bench::SPEAKER_DIM), 2);
+    voiceprint::StreamOptions options;
+    options.sampleRate = SAMPLE_RATE;
+    size_t windows = 0;
+    for (auto _ : state) {
+        int id = extractor.createStream(options);
+        for (size_t off = 0; off < audio.size(); off += CHUNK) {
+            extractor.acceptWaveform(id, audio.data() + off, std::min(CHUNK, audio.size() - off));
+        }
+        extractor.inputFinished(id);
+        extractor.flush();
+        windows = extractor.poll(id).size();
+        extractor.destroyStream(id);
+    }
+    state.setItemsProcessed(state.iterations() * static_cast<int64_t>(windows));
+    state.setCounter("windows", static_cast<double>(windows));
+}
+PERF_BENCHMARK("voiceprint/stream_minute", streamMinute)->unit(perf::Unit::Ms);
+
+}  // namespace
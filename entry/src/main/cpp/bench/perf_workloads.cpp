@@ -0,0 +1,703 @@
+/**
+ * perf_workloads.cpp — 负载生成与录制文件读写
+ */
+#include "perf_workloads.h"
+#include "trace_gen.h"
+#include "rule_json.h"
+#include "common/json.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+namespace bench {
+
+using context_engine::Condition;
+using context_engine::ContextMap;
+using context_engine::Rule;
+using geo_utils::GeoPoint;
+using geo_utils::Geofence;
+using native_common::json::Document;
+using native_common::json::Value;
+using native_common::json::Writer;
+
+namespace {
+
+WorkloadSources g_sources;
+
+struct Loaded {
+    std::string source = "synthetic";
+};
+
+Loaded g_gpsLoaded, g_eventsLoaded, g_rulesLoaded;
+
+void fallback(Loaded& loaded, const char* what, const std::string& path, const std::string& error) {
+    std::fprintf(stderr, "%s: cannot use %s (%s), falling back to synthetic\n", what, path.c_str(), error.c_str());
+    loaded.source = "synthetic (failed to load " + path + ")";
+}
+
+bool readFile(const std::string& path, std::string& out) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    std::stringstream buf;
+    buf << in.rdbuf();
+    out = buf.str();
+    return true;
+}
+
+bool writeFile(const std::string& path, const std::string& data) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out << data;
+    return static_cast<bool>(out);
+}
+
+const char* timeOfDay(int hour) {
+    // 与 ContextAwarenessService 的划分一致
+    if (hour >= 5 && hour < 12) return "morning";
+    if (hour >= 12 && hour < 17) return "afternoon";
+    if (hour >= 17 && hour < 21) return "evening";
+    return "night";
+}
+
+}  // namespace
+
+void setWorkloadSources(const WorkloadSources& sources) { g_sources = sources; }
+
+std::string gpsTraceSource() {
+    gpsTrace();
+    return g_gpsLoaded.source;
+}
+
+std::string eventStreamSource() {
+    eventStream();
+    return g_eventsLoaded.source;
+}
+
+std::string ruleSetSource() {
+    ruleSet();
+    return g_rulesLoaded.source;
+}
+
+// ============================================================
+// GPS
+// ============================================================
+
+const std::vector<GeoPoint>& gpsTrace() {
+    static const std::vector<GeoPoint> trace = [] {
+        std::vector<GeoPoint> points;
+        if (!g_sources.gpsTracePath.empty()) {
+            std::string error;
+            if (loadGpsCsv(g_sources.gpsTracePath, points, &error)) {
+                g_gpsLoaded.source = g_sources.gpsTracePath;
+                return points;
+            }
+            fallback(g_gpsLoaded, "gps trace", g_sources.gpsTracePath, error);
+        }
+        return makeTrace(GPS_TRACE_POINTS, 42);
+    }();
+    return trace;
+}
+
+const std::vector<Geofence>& geofences() {
+    static const std::vector<Geofence> fences = [] {
+        std::vector<Geofence> out = {
+            {"home", "Home", 31.2304, 121.4737, 150, "home"},
+            {"work", "Work", 31.2397, 121.4998, 200, "work"},
+            {"gym", "Gym", 31.2200, 121.4600, 100, "gym"},
+            {"restaurant", "Restaurant", 31.2350, 121.4850, 80, "restaurant"},
+        };
+        // 周边 POI：上海市区 ±10 km
+        std::mt19937 rng(7);
+        std::uniform_real_distribution<double> dLat(-0.09, 0.09), dLng(-0.105, 0.105), radius(50, 400);
+        const char* categories[] = {"mall", "station", "school", "park", "hospital"};
+        for (size_t i = out.size(); i < GEOFENCE_COUNT; i++) {
+            Geofence gf;
+            gf.id = "poi_" + std::to_string(i);
+            gf.name = gf.id;
+            gf.latitude = 31.2304 + dLat(rng);
+            gf.longitude = 121.4737 + dLng(rng);
+            gf.radiusMeters = radius(rng);
+            gf.category = categories[i % 5];
+            out.push_back(gf);
+        }
+        return out;
+    }();
+    return fences;
+}
+
+bool saveGpsCsv(const std::string& path, const std::vector<GeoPoint>& points) {
+    std::string out = "timestamp,latitude,longitude,accuracy\n";
+    char line[128];
+    for (const auto& p : points) {
+        std::snprintf(line, sizeof(line), "%lld,%.8f,%.8f,%.1f\n", static_cast<long long>(p.timestamp), p.latitude,
+                      p.longitude, p.accuracy);
+        out += line;
+    }
+    return writeFile(path, out);
+}
+
+bool loadGpsCsv(const std::string& path, std::vector<GeoPoint>& out, std::string* error) {
+    std::ifstream in(path);
+    if (!in) {
+        if (error) *error = "cannot open";
+        return false;
+    }
+    out.clear();
+    std::string line;
+    size_t lineNo = 0;
+    bool first = true;
+    while (std::getline(in, line)) {
+        lineNo++;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty() || line[0] == '#') continue;
+        bool numeric = (line[0] >= '0' && line[0] <= '9') || line[0] == '-';
+        if (first && !numeric) {
+            first = false;
+            continue;
+        }
+        first = false;
+        const char* s = line.c_str();
+        char* end = nullptr;
+        GeoPoint p{};
+        p.timestamp = std::strtoll(s, &end, 10);
+        bool ok = end != s && *end == ',';
+        if (ok) {
+            s = end + 1;
+            p.latitude = std::strtod(s, &end);
+            ok = end != s && *end == ',';
+        }
+        if (ok) {
+            s = end + 1;
+            p.longitude = std::strtod(s, &end);
+            ok = end != s && (*end == '\0' || *end == ',');
+        }
+        p.accuracy = 10;
+        if (ok && *end == ',') {
+            s = end + 1;
+            p.accuracy = std::strtod(s, &end);
+            ok = end != s;
+        }
+        if (!ok || p.latitude < -90 || p.latitude > 90 || p.longitude < -180 || p.longitude > 180) {
+            if (error) *error = "malformed line " + std::to_string(lineNo);
+            return false;
+        }
+        out.push_back(p);
+    }
+    if (out.empty()) {
+        if (error) *error = "no points";
+        return false;
+    }
+    return true;
+}
+
+// ============================================================
+// 规则
+// ============================================================
+
+namespace {
+
+struct KeySpec {
+    const char* key;
+    std::vector<const char*> values;
+    bool numeric;
+};
+
+const std::vector<KeySpec>& keySpecs() {
+    static const std::vector<KeySpec> specs = {
+        {"timeOfDay", {"morning", "afternoon", "evening", "night"}, false},
+        {"hour", {"6", "8", "9", "12", "18", "21", "23"}, true},
+        {"dayOfWeek", {"1", "2", "3", "4", "5", "6", "7"}, false},
+        {"isWeekend", {"true", "false"}, false},
+        {"motionState", {"still", "walking", "running", "driving"}, false},
+        {"geofence", {"home", "work", "gym", "restaurant", "poi_10", "poi_20"}, false},
+        {"networkType", {"wifi", "cellular", "none"}, false},
+        {"wifiSsid", {"HomeWiFi", "CorpNet", "GymFree", "Cafe"}, false},
+        {"isCharging", {"true", "false"}, false},
+        {"batteryLevel", {"15", "20", "30", "50", "80"}, true},
+        {"stepCount", {"2000", "5000", "8000", "10000"}, true},
+        {"foregroundApp", {"music", "maps", "camera", "reader", "chat"}, false},
+    };
+    return specs;
+}
+
+}  // namespace
+
+std::vector<Rule> makeRules(size_t n, uint32_t seed) {
+    std::mt19937 rng(seed);
+    const auto& specs = keySpecs();
+    const char* actionTypes[] = {"suggestion", "automation", "notification"};
+    const int64_t cooldowns[] = {0, 300000, 1800000, 3600000};
+
+    std::vector<Rule> rules;
+    rules.reserve(n);
+    for (size_t id = 0; id < n; id++) {
+        Rule r;
+        r.id = "rule_" + std::to_string(id);
+        r.name = "Rule " + std::to_string(id);
+        r.priority = 1.0 + static_cast<double>(rng() % 4) * 0.5;
+        r.cooldownMs = cooldowns[rng() % 4];
+        r.enabled = rng() % 10 != 0;
+        r.action.id = "action_" + std::to_string(rng() % 60);
+        r.action.type = actionTypes[rng() % 3];
+        r.action.payload = "{\"source\":\"perf\"}";
+
+        if (rng() % 20 == 0) {
+            // 时序条件：最近进入围栏 / 离开围栏后开始移动
+            Condition cond;
+            if (rng() % 2 == 0) {
+                cond = {"event:geofence_enter", "recent", "600000"};
+            } else {
+                cond = {"sequence:geofence_exit,motion_change", "within", "900000"};
+            }
+            r.conditions.push_back(cond);
+        }
+        int numConds = 1 + static_cast<int>(rng() % 4);
+        for (int c = 0; c < numConds; c++) {
+            const auto& spec = specs[rng() % specs.size()];
+            Condition cond;
+            cond.key = spec.key;
+            int kind = static_cast<int>(rng() % 10);
+            auto pick = [&] { return std::string(spec.values[rng() % spec.values.size()]); };
+            if (spec.numeric) {
+                cond.op = kind < 4 ? "gte" : (kind < 8 ? "lte" : "range");
+                if (cond.op == "range") {
+                    std::string a = pick(), b = pick();
+                    if (std::atof(a.c_str()) > std::atof(b.c_str())) std::swap(a, b);
+                    cond.value = a + "," + b;
+                } else {
+                    cond.value = pick();
+                }
+            } else if (kind < 7) {
+                cond.op = "eq";
+                cond.value = pick();
+            } else if (kind < 9) {
+                cond.op = "in";
+                cond.value = pick() + "," + pick();
+            } else {
+                cond.op = "neq";
+                cond.value = pick();
+            }
+            r.conditions.push_back(cond);
+        }
+        rules.push_back(std::move(r));
+    }
+    return rules;
+}
+
+std::string rulesToJson(const std::vector<Rule>& rules) {
+    std::string out;
+    Writer w(out);
+    w.beginArray();
+    for (const auto& r : rules) {
+        w.beginObject();
+        w.member("id", r.id);
+        w.member("name", r.name);
+        w.member("priority", r.priority);
+        w.member("cooldownMs", r.cooldownMs);
+        w.member("enabled", r.enabled);
+        w.key("action");
+        w.beginObject();
+        w.member("id", r.action.id);
+        w.member("type", r.action.type);
+        w.member("payload", r.action.payload);
+        w.endObject();
+        w.key("conditions");
+        w.beginArray();
+        for (const auto& c : r.conditions) {
+            w.beginObject();
+            w.member("key", c.key);
+            w.member("op", c.op);
+            w.member("value", c.value);
+            w.endObject();
+        }
+        w.endArray();
+        w.endObject();
+    }
+    w.endArray();
+    return out;
+}
+
+bool saveRulesJson(const std::string& path, const std::vector<Rule>& rules) {
+    return writeFile(path, rulesToJson(rules));
+}
+
+bool loadRulesJson(const std::string& path, std::vector<Rule>& out, std::string* error) {
+    std::string text;
+    if (!readFile(path, text)) {
+        if (error) *error = "cannot open";
+        return false;
+    }
+    Document doc;
+    out = context_engine::parseRulesArray(text, doc);
+    if (out.empty()) {
+        if (error) *error = doc.root().exists() ? "no rules" : "malformed JSON at offset " + std::to_string(doc.errorOffset());
+        return false;
+    }
+    return true;
+}
+
+const std::vector<Rule>& ruleSet() {
+    static const std::vector<Rule> rules = [] {
+        std::vector<Rule> out;
+        if (!g_sources.rulesPath.empty()) {
+            std::string error;
+            if (loadRulesJson(g_sources.rulesPath, out, &error)) {
+                g_rulesLoaded.source = g_sources.rulesPath;
+                return out;
+            }
+            fallback(g_rulesLoaded, "rules", g_sources.rulesPath, error);
+        }
+        return makeRules(RULE_COUNT, 11);
+    }();
+    return rules;
+}
+
+const std::string& ruleSetJson() {
+    static const std::string json = rulesToJson(ruleSet());
+    return json;
+}
+
+// ============================================================
+// 24 小时事件流
+// ============================================================
+
+namespace {
+
+struct Segment {
+    int startMin;
+    const char* place;            // nullptr = 路上
+    double probs[4];              // still / walking / running / driving
+};
+
+/** 一个工作日 */
+const std::vector<Segment>& daySegments() {
+    static const std::vector<Segment> segments = {
+        {0, "home", {1.0, 0, 0, 0}},                       // 睡眠
+        {6 * 60 + 50, "home", {0.6, 0.4, 0, 0}},
+        {8 * 60, nullptr, {0.1, 0.6, 0, 0.3}},             // 步行去车站
+        {8 * 60 + 10, nullptr, {0.1, 0.05, 0, 0.85}},      // 通勤
+        {8 * 60 + 40, nullptr, {0.1, 0.9, 0, 0}},
+        {8 * 60 + 50, "work", {0.9, 0.1, 0, 0}},
+        {12 * 60, nullptr, {0.1, 0.9, 0, 0}},
+        {12 * 60 + 10, "restaurant", {0.95, 0.05, 0, 0}},
+        {12 * 60 + 50, nullptr, {0.1, 0.9, 0, 0}},
+        {13 * 60, "work", {0.9, 0.1, 0, 0}},
+        {18 * 60 + 20, nullptr, {0.1, 0.3, 0, 0.6}},
+        {18 * 60 + 40, "gym", {0.3, 0.2, 0.5, 0}},
+        {19 * 60 + 40, nullptr, {0.1, 0.2, 0, 0.7}},
+        {20 * 60 + 20, "home", {0.8, 0.2, 0, 0}},
+        {23 * 60, "home", {1.0, 0, 0, 0}},
+    };
+    return segments;
+}
+
+const char* placeSsid(const char* place) {
+    if (place == nullptr) return nullptr;
+    std::string p(place);
+    if (p == "home") return "HomeWiFi";
+    if (p == "work") return "CorpNet";
+    if (p == "gym") return "GymFree";
+    if (p == "restaurant") return "Cafe";
+    return nullptr;
+}
+
+class DayBuilder {
+public:
+    explicit DayBuilder(std::vector<StreamEvent>& out) : out_(out) {}
+
+    void set(int64_t ts, const char* eventType, const std::string& key, const std::string& value) {
+        auto it = ctx_.find(key);
+        if (it != ctx_.end() && it->second == value) return;
+        ctx_[key] = value;
+        emit(ts, eventType, key, value);
+    }
+
+    void erase(int64_t ts, const char* eventType, const std::string& key) {
+        if (ctx_.erase(key) == 0) return;
+        emit(ts, eventType, key, "");
+    }
+
+    /** 值不变也发出（计步、定位更新） */
+    void update(int64_t ts, const char* eventType, const std::string& key, const std::string& value) {
+        ctx_[key] = value;
+        emit(ts, eventType, key, value);
+    }
+
+    const ContextMap& context() const { return ctx_; }
+
+private:
+    void emit(int64_t ts, const char* eventType, const std::string& key, const std::string& value) {
+        StreamEvent ev;
+        ev.timestampMs = ts;
+        ev.eventType = eventType;
+        ev.key = key;
+        ev.value = value;
+        ev.context = ctx_;
+        out_.push_back(std::move(ev));
+    }
+
+    std::vector<StreamEvent>& out_;
+    ContextMap ctx_;
+};
+
+}  // namespace
+
+std::vector<StreamEvent> makeDayStream(uint32_t seed) {
+    constexpr int TICK_SEC = 10;
+    constexpr int64_t DAY_START = 1736092800000LL;   // 2025-01-06，周一
+    const char* motions[] = {"still", "walking", "running", "driving"};
+    const char* apps[] = {"music", "maps", "camera", "reader", "chat"};
+
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> uni(0.0, 1.0);
+    std::vector<StreamEvent> events;
+    events.reserve(6000);
+    DayBuilder day(events);
+
+    const auto& segments = daySegments();
+    const auto& fences = geofences();
+    auto fenceOf = [&](const char* place) {
+        for (const auto& gf : fences) {
+            if (gf.id == place) return &gf;
+        }
+        return &fences[0];
+    };
+
+    // 初始状态：在家睡觉、充电
+    day.set(DAY_START, "init", "dayOfWeek", "1");
+    day.set(DAY_START, "init", "isWeekend", "false");
+    day.set(DAY_START, "init", "hour", "0");
+    day.set(DAY_START, "init", "timeOfDay", timeOfDay(0));
+    day.set(DAY_START, "init", "isCharging", "true");
+    day.set(DAY_START, "init", "batteryLevel", "100");
+
+    const char* place = nullptr;
+    const char* motion = "";
+    double battery = 100;
+    int64_t steps = 0;
+    int cell = 0;
+    size_t seg = 0;
+    double lat = fences[0].latitude, lng = fences[0].longitude;
+    bool charging = true;
+
+    for (int sec = 0; sec < 86400; sec += TICK_SEC) {
+        int64_t ts = DAY_START + static_cast<int64_t>(sec) * 1000;
+        int minute = sec / 60;
+        while (seg + 1 < segments.size() && minute >= segments[seg + 1].startMin) seg++;
+        const Segment& s = segments[seg];
+
+        if (sec % 3600 == 0) {
+            int hour = sec / 3600;
+            day.set(ts, "time_tick", "hour", std::to_string(hour));
+            day.set(ts, "time_tick", "timeOfDay", timeOfDay(hour));
+        }
+
+        // 围栏 / 网络
+        bool placeChanged = (s.place == nullptr) != (place == nullptr) ||
+                            (s.place != nullptr && std::string(s.place) != place);
+        if (placeChanged) {
+            if (place != nullptr) day.erase(ts, "geofence_exit", "geofence");
+            place = s.place;
+            if (place != nullptr) {
+                day.set(ts, "geofence_enter", "geofence", place);
+                const geo_utils::Geofence* gf = fenceOf(place);
+                lat = gf->latitude;
+                lng = gf->longitude;
+            }
+            const char* ssid = placeSsid(place);
+            if (ssid != nullptr) {
+                day.set(ts, "wifi_change", "wifiSsid", ssid);
+                day.set(ts, "network_change", "networkType", "wifi");
+            } else {
+                day.erase(ts, "wifi_change", "wifiSsid");
+                day.set(ts, "network_change", "networkType", "cellular");
+            }
+        }
+
+        // 运动状态：检测器约每 30 秒出一个结果
+        if (sec % 30 == 0) {
+            double r = uni(rng), acc = 0;
+            const char* next = motions[0];
+            for (int m = 0; m < 4; m++) {
+                acc += s.probs[m];
+                if (r < acc) {
+                    next = motions[m];
+                    break;
+                }
+            }
+            if (std::string(next) != motion) {
+                motion = next;
+                day.set(ts, "motion_change", "motionState", motion);
+            }
+        }
+        bool walking = std::string(motion) == "walking", running = std::string(motion) == "running";
+        if ((walking || running) && sec % 30 == 0) {
+            steps += walking ? 50 + static_cast<int64_t>(rng() % 10) : 80 + static_cast<int64_t>(rng() % 20);
+            day.update(ts, "step_update", "stepCount", std::to_string(steps));
+        }
+
+        // 位置：路上每 10 秒一个定位，停留时每 5 分钟
+        bool moving = place == nullptr;
+        if (moving) {
+            lat += (uni(rng) - 0.45) * 0.0008;
+            lng += (uni(rng) - 0.45) * 0.0008;
+        }
+        if (moving || sec % 300 == 0) {
+            char buf[32];
+            std::snprintf(buf, sizeof(buf), "%.6f", lat + (uni(rng) - 0.5) * 0.0001);
+            day.update(ts, "location_update", "latitude", buf);
+            std::snprintf(buf, sizeof(buf), "%.6f", lng + (uni(rng) - 0.5) * 0.0001);
+            day.update(ts, "location_update", "longitude", buf);
+        }
+
+        // 基站：路上频繁切换，停留时偶尔在两个小区间跳
+        if ((moving && uni(rng) < 0.08) || (!moving && uni(rng) < 0.002)) {
+            cell = moving ? static_cast<int>(rng() % 400) : (cell % 2 == 0 ? cell + 1 : cell - 1);
+            day.set(ts, "cell_change", "cellId", "460-00-" + std::to_string(cell));
+        }
+
+        // 电量：6:55 拔下，23:00 插上
+        bool shouldCharge = minute < 6 * 60 + 55 || minute >= 23 * 60;
+        if (shouldCharge != charging) {
+            charging = shouldCharge;
+            day.set(ts, "charging_change", "isCharging", charging ? "true" : "false");
+        }
+        battery = charging ? std::min(100.0, battery + 0.15) : std::max(5.0, battery - (moving ? 0.05 : 0.025));
+        day.set(ts, "battery_change", "batteryLevel", std::to_string(static_cast<int>(battery)));
+
+        // 醒着时偶尔打开应用
+        bool awake = minute >= 6 * 60 + 50 && minute < 23 * 60 + 30;
+        if (awake && uni(rng) < 0.012) {
+            day.set(ts, "app_open", "foregroundApp", apps[rng() % 5]);
+        }
+    }
+    return events;
+}
+
+bool saveEventsJsonl(const std::string& path, const std::vector<StreamEvent>& events) {
+    std::string out, context;
+    for (const auto& ev : events) {
+        context.clear();
+        context_engine::contextMapJson(ev.context, context);
+        Writer w(out);
+        w.beginObject();
+        w.member("timestampMs", ev.timestampMs);
+        w.member("eventType", ev.eventType);
+        w.member("key", ev.key);
+        w.member("value", ev.value);
+        w.key("context");
+        w.raw(context);
+        w.endObject();
+        out.push_back('\n');
+    }
+    return writeFile(path, out);
+}
+
+bool loadEventsJsonl(const std::string& path, std::vector<StreamEvent>& out, std::string* error) {
+    std::ifstream in(path);
+    if (!in) {
+        if (error) *error = "cannot open";
+        return false;
+    }
+    out.clear();
+    Document doc;
+    std::string line;
+    size_t lineNo = 0;
+    while (std::getline(in, line)) {
+        lineNo++;
+        if (line.empty() || line == "\r") continue;
+        if (!doc.parse(line) || !doc.root().isObject()) {
+            if (error) *error = "malformed JSON on line " + std::to_string(lineNo);
+            return false;
+        }
+        Value root = doc.root();
+        StreamEvent ev;
+        ev.timestampMs = root["timestampMs"].int64(0);
+        ev.eventType = std::string(root["eventType"].str());
+        ev.key = std::string(root["key"].str());
+        ev.value = std::string(root["value"].text());
+        context_engine::parseContextMap(root["context"], ev.context);
+        out.push_back(std::move(ev));
+    }
+    if (out.empty()) {
+        if (error) *error = "no events";
+        return false;
+    }
+    return true;
+}
+
+const std::vector<StreamEvent>& eventStream() {
+    static const std::vector<StreamEvent> events = [] {
+        std::vector<StreamEvent> out;
+        if (!g_sources.eventsPath.empty()) {
+            std::string error;
+            if (loadEventsJsonl(g_sources.eventsPath, out, &error)) {
+                g_eventsLoaded.source = g_sources.eventsPath;
+                return out;
+            }
+            fallback(g_eventsLoaded, "events", g_sources.eventsPath, error);
+        }
+        return makeDayStream(5);
+    }();
+    return events;
+}
+
+const std::vector<std::string>& eventContextJson() {
+    static const std::vector<std::string> json = [] {
+        std::vector<std::string> out;
+        out.reserve(eventStream().size());
+        for (const auto& ev : eventStream()) {
+            std::string s;
+            context_engine::contextMapJson(ev.context, s);
+            out.push_back(std::move(s));
+        }
+        return out;
+    }();
+    return json;
+}
+
+const std::vector<ContextMap>& eventContexts() {
+    static const std::vector<ContextMap> contexts = [] {
+        std::vector<ContextMap> out;
+        out.reserve(eventStream().size());
+        for (const auto& ev : eventStream()) out.push_back(ev.context);
+        return out;
+    }();
+    return contexts;
+}
+
+// ============================================================
+// 声纹
+// ============================================================
+
+const SpeakerWorkload& speakerWorkload() {
+    static const SpeakerWorkload workload = [] {
+        SpeakerWorkload w;
+        std::mt19937 rng(3);
+        std::normal_distribution<float> gauss(0.0f, 1.0f);
+        const size_t dim = w.dim;
+        w.embeddings.resize(SPEAKER_COUNT * dim);
+        for (size_t s = 0; s < SPEAKER_COUNT; s++) {
+            w.names.push_back("speaker_" + std::to_string(s));
+            for (size_t d = 0; d < dim; d++) w.embeddings[s * dim + d] = gauss(rng);
+        }
+        // 同一说话人的查询与其中心的余弦约 0.7；库外说话人是新的随机向量
+        w.queries.resize(SPEAKER_QUERIES * dim);
+        for (size_t q = 0; q < SPEAKER_QUERIES; q++) {
+            bool unknown = rng() % 10 == 0;
+            int owner = unknown ? -1 : static_cast<int>(rng() % SPEAKER_COUNT);
+            w.queryOwner.push_back(owner);
+            for (size_t d = 0; d < dim; d++) {
+                float base = owner >= 0 ? w.embeddings[static_cast<size_t>(owner) * dim + d] : gauss(rng);
+                w.queries[q * dim + d] = base + (owner >= 0 ? gauss(rng) : 0.0f);
+            }
+        }
+        return w;
+    }();
+    return workload;
+}
+
+}  // namespace bench
@@ -0,0 +1,107 @@
+/**
+ * perf_workloads.h — native_perf 的合成 / 录制负载
+ *
+ * 每种负载默认按固定种子合成，也可以换成从设备导出的录制文件（--gps-trace / --events / --rules）：
+ *   GPS 轨迹      100k 点，30 天（trace_gen.h）；录制格式 CSV：timestamp,latitude,longitude[,accuracy]
+ *   围栏          4 个常去地点 + 196 个周边 POI
+ *   规则集        1000 条，条件的 key / 取值与事件流的上下文一致，约 5% 带时序条件
+ *   24 小时事件流  工作日的一天：睡眠、通勤、上班、午饭、健身、回家；每条事件带变化后的完整上下文。
+ *                 录制格式 JSONL，每行即 pushEvent 的 JSON 再加 timestampMs / key / value：
+ *                 {"timestampMs":..., "eventType":"motion_change", "key":"motionState", "value":"walking",
+ *                  "context":{...}}
+ *   声纹库        1000 人 × 192 维，每人一个中心向量；查询为中心 + 噪声，另含 10% 库外说话人
+ *
+ * 访问函数首次调用时生成 / 加载并缓存，之后返回同一份数据；基准的准备阶段调用，不计时。
+ * 录制文件读取失败时打印原因并退回合成负载。
+ */
+#pragma once
+
+#include "context_engine.h"
+#include "geo_utils.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+constexpr size_t GPS_TRACE_POINTS = 100000;
+constexpr size_t GEOFENCE_COUNT = 200;
+constexpr size_t RULE_COUNT = 1000;
+constexpr size_t SPEAKER_COUNT = 1000;
+constexpr size_t SPEAKER_DIM = 192;
+constexpr size_t SPEAKER_QUERIES = 2000;
+
+struct WorkloadSources {
+    std::string gpsTracePath;
+    std::string eventsPath;
+    std::string rulesPath;
+};
+
+/** 在第一次访问负载之前设置 */
+void setWorkloadSources(const WorkloadSources& sources);
+
+/** "synthetic" 或录制文件路径，写进 JSON context */
+std::string gpsTraceSource();
+std::string eventStreamSource();
+std::string ruleSetSource();
+
+// ============================================================
+// GPS
+// ============================================================
+
+const std::vector<geo_utils::GeoPoint>& gpsTrace();
+const std::vector<geo_utils::Geofence>& geofences();
+
+bool saveGpsCsv(const std::string& path, const std::vector<geo_utils::GeoPoint>& points);
+/** 空行与 '#' 开头的行跳过，首行不是数字时视为表头；出错返回 false，error 为原因 */
+bool loadGpsCsv(const std::string& path, std::vector<geo_utils::GeoPoint>& out, std::string* error);
+
+// ============================================================
+// 规则与事件流
+// ============================================================
+
+/** 一条传感器事件：key 变为 value 之后的完整上下文 */
+struct StreamEvent {
+    int64_t timestampMs = 0;
+    std::string eventType;
+    std::string key;
+    std::string value;
+    context_engine::ContextMap context;
+};
+
+const std::vector<context_engine::Rule>& ruleSet();
+/** 与 ruleSet() 相同规则的 loadRules JSON */
+const std::string& ruleSetJson();
+
+const std::vector<StreamEvent>& eventStream();
+/** eventStream() 每条事件的上下文 JSON（evaluate(contextJson) 的输入） */
+const std::vector<std::string>& eventContextJson();
+/** eventStream() 的上下文，evaluateBatch 的输入 */
+const std::vector<context_engine::ContextMap>& eventContexts();
+
+std::vector<context_engine::Rule> makeRules(size_t n, uint32_t seed);
+std::vector<StreamEvent> makeDayStream(uint32_t seed);
+
+std::string rulesToJson(const std::vector<context_engine::Rule>& rules);
+bool saveRulesJson(const std::string& path, const std::vector<context_engine::Rule>& rules);
+bool loadRulesJson(const std::string& path, std::vector<context_engine::Rule>& out, std::string* error);
+
+bool saveEventsJsonl(const std::string& path, const std::vector<StreamEvent>& events);
+bool loadEventsJsonl(const std::string& path, std::vector<StreamEvent>& out, std::string* error);
+
+// ============================================================
+// 声纹
+// ============================================================
+
+struct SpeakerWorkload {
+    size_t dim = SPEAKER_DIM;
+    std::vector<std::string> names;
+    std::vector<float> embeddings;     // names.size() × dim，行优先
+    std::vector<float> queries;        // SPEAKER_QUERIES × dim
+    std::vector<int> queryOwner;       // 查询对应的说话人下标，库外说话人为 -1
+};
+
+const SpeakerWorkload& speakerWorkload();
+
+}  // namespace bench
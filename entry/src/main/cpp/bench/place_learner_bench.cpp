@@ -0,0 +1,298 @@
+/**
+ * place_learner_bench.cpp — SSID / CellID 倒排表 vs 遍历全部地点的 std::set
+ *
+ * 校验：findPlacesByWifi / findPlacesByCellId 与原实现（遍历 signals_ 的 set）结果一致，
+ * 覆盖重复学习、clear、restore、clearAll；learn 的返回值（是否学到新信号）与原实现一致；
+ * scorePlaces 与遍历全部地点逐个打分的结果一致（含 topK 截断与同分排序）。
+ * 然后对比地点数增长时单次反查的耗时。
+ *
+ * 用法: place_learner_bench [--places N] [--queries N] [--check-only]
+ */
+#include "place_learner/place_signal_learner.h"
+#include "perf_harness.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+using place_learner::PlaceQuery;
+using place_learner::PlaceScore;
+using place_learner::PlaceScoreWeights;
+using place_learner::PlaceSignalLearner;
+using perf::elapsedMs;
+using perf::check;
+
+namespace {
+
+// ============================================================
+// 原实现：std::map<placeId, std::set> + 遍历全部地点
+// ============================================================
+
+struct LegacyLearner {
+    struct Signals {
+        std::set<std::string> wifi, bt, cell;
+    };
+    std::map<std::string, Signals> signals;
+
+    bool learn(const std::string& placeId, const std::string& wifi, const std::string& bt, const std::string& cell) {
+        Signals& s = signals[placeId];
+        bool learned = false;
+        if (!wifi.empty()) learned |= s.wifi.insert(wifi).second;
+        if (!bt.empty()) learned |= s.bt.insert(bt).second;
+        if (!cell.empty()) learned |= s.cell.insert(cell).second;
+        return learned;
+    }
+
+    std::vector<std::string> findByWifi(const std::string& ssid) const {
+        std::vector<std::string> out;
+        for (const auto& pair : signals) {
+            if (pair.second.wifi.count(ssid) > 0) out.push_back(pair.first);
+        }
+        return out;
+    }
+
+    std::vector<std::string> findByCell(const std::string& cell) const {
+        std::vector<std::string> out;
+        for (const auto& pair : signals) {
+            if (pair.second.cell.count(cell) > 0) out.push_back(pair.first);
+        }
+        return out;
+    }
+};
+
+std::string cellName(int c) { return "460_0_" + std::to_string(c / 8) + "_" + std::to_string(c); }
+
+/** 地点沿路网分布：相邻地点共享基站，部分地点共享连锁店 WiFi */
+struct Observation {
+    std::string placeId, wifi, bt, cell;
+    int hour;
+};
+
+Observation randomObservation(size_t numPlaces, std::mt19937& rng) {
+    Observation o;
+    size_t p = rng() % numPlaces;
+    o.placeId = "place_" + std::to_string(p);
+    int kind = static_cast<int>(rng() % 10);
+    o.wifi = kind < 6 ? "wifi_" + std::to_string(p) : kind < 8 ? "chain_" + std::to_string(p % 13) : "";
+    o.bt = rng() % 3 == 0 ? "bt_" + std::to_string(rng() % 50) : "";
+    o.cell = rng() % 8 == 0 ? "" : cellName(static_cast<int>(p / 2 + rng() % 3));
+    o.hour = 7 + static_cast<int>(rng() % 14);
+    return o;
+}
+
+/** 对照打分：遍历全部地点 */
+std::vector<PlaceScore> bruteScore(const PlaceSignalLearner& learner, const LegacyLearner& legacy,
+                                   const PlaceQuery& q, size_t topK) {
+    PlaceScoreWeights w;
+    std::set<std::string> cells;
+    for (const auto& c : q.cellIds) {
+        if (!c.empty()) cells.insert(c);
+    }
+    std::vector<PlaceScore> out;
+    for (const auto& [placeId, s] : legacy.signals) {
+        PlaceScore r{placeId, 0.0, false, 0, false, 0};
+        if (!q.wifiSsid.empty() && s.wifi.count(q.wifiSsid)) {
+            r.wifiMatch = true;
+            for (const auto& h : *learner.wifiHits(q.wifiSsid)) {
+                if (h.placeId == placeId) r.hits += h.count;
+            }
+        }
+        for (const auto& c : cells) {
+            if (!s.cell.count(c)) continue;
+            r.cellMatches++;
+            for (const auto& h : *learner.cellHits(c)) {
+                if (h.placeId == placeId) r.hits += h.count;
+            }
+        }
+        if (!r.wifiMatch && r.cellMatches == 0) continue;
+        if (q.hour >= 0) {
+            for (const auto& tr : learner.getSignals(placeId)->typicalTimes) {
+                r.timeMatch = r.timeMatch || (q.hour >= tr.startHour && q.hour < tr.endHour);
+            }
+        }
+        r.score = (r.wifiMatch ? w.wifi : 0.0) +
+                  (cells.empty() ? 0.0 : w.cell * r.cellMatches / static_cast<double>(cells.size())) +
+                  (r.timeMatch ? w.time : 0.0);
+        out.push_back(r);
+    }
+    std::stable_sort(out.begin(), out.end(), [](const PlaceScore& a, const PlaceScore& b) {
+        return a.score != b.score ? a.score > b.score : a.hits > b.hits;
+    });
+    if (topK > 0 && out.size() > topK) out.resize(topK);
+    return out;
+}
+
+bool sameScores(const std::vector<PlaceScore>& a, const std::vector<PlaceScore>& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].placeId != b[i].placeId || a[i].score != b[i].score || a[i].hits != b[i].hits ||
+            a[i].wifiMatch != b[i].wifiMatch || a[i].cellMatches != b[i].cellMatches ||
+            a[i].timeMatch != b[i].timeMatch) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool lookupsAgree(const PlaceSignalLearner& learner, const LegacyLearner& legacy, size_t numPlaces) {
+    for (size_t p = 0; p < numPlaces; p++) {
+        std::string ssid = "wifi_" + std::to_string(p);
+        if (learner.findPlacesByWifi(ssid) != legacy.findByWifi(ssid)) return false;
+        std::string chain = "chain_" + std::to_string(p % 13);
+        if (learner.findPlacesByWifi(chain) != legacy.findByWifi(chain)) return false;
+        std::string cell = cellName(static_cast<int>(p));
+        if (learner.findPlacesByCellId(cell) != legacy.findByCell(cell)) return false;
+    }
+    return learner.findPlacesByWifi("nowhere").empty() && learner.findPlacesByCellId("").empty();
+}
+
+bool scoresAgree(const PlaceSignalLearner& learner, const LegacyLearner& legacy, size_t numPlaces,
+                 std::mt19937& rng, int queries) {
+    for (int i = 0; i < queries; i++) {
+        Observation o = randomObservation(numPlaces, rng);
+        PlaceQuery q;
+        q.wifiSsid = i % 5 == 0 ? "" : o.wifi;
+        int c = static_cast<int>(rng() % (numPlaces / 2 + 2));
+        q.cellIds = {cellName(c), cellName(c + 1), cellName(c), ""};
+        if (i % 7 == 0) q.cellIds.clear();
+        q.hour = i % 4 == 0 ? -1 : o.hour;
+        size_t topK = i % 3 == 0 ? 0 : 3;
+        if (!sameScores(learner.scorePlaces(q, topK), bruteScore(learner, legacy, q, topK))) return false;
+    }
+    return true;
+}
+
+// ============================================================
+// 校验
+// ============================================================
+
+int runCheck(size_t numPlaces) {
+    std::printf("check (%zu places):\n", numPlaces);
+    int failures = 0;
+    std::mt19937 rng(3);
+    PlaceSignalLearner learner;
+    LegacyLearner legacy;
+
+    bool sameLearned = true;
+    for (size_t i = 0; i < numPlaces * 6; i++) {
+        Observation o = randomObservation(numPlaces, rng);
+        bool a = learner.learnAt(o.placeId, o.wifi, o.bt, o.cell, static_cast<int64_t>(i), o.hour);
+        sameLearned = sameLearned && a == legacy.learn(o.placeId, o.wifi, o.bt, o.cell);
+    }
+    failures += check("learn() reports new signals like std::set", sameLearned);
+    failures += check("reverse lookups match full scan", lookupsAgree(learner, legacy, numPlaces));
+    failures += check("scorePlaces matches brute-force scoring", scoresAgree(learner, legacy, numPlaces, rng, 300));
+
+    for (size_t p = 0; p < numPlaces; p += 3) {
+        std::string id = "place_" + std::to_string(p);
+        learner.clear(id);
+        legacy.signals.erase(id);
+    }
+    failures += check("clear() drops postings",
+                      lookupsAgree(learner, legacy, numPlaces) && scoresAgree(learner, legacy, numPlaces, rng, 100) &&
+                          learner.placeCount() == legacy.signals.size());
+
+    // restore：替换已有地点的信号（旧信号的倒排条目要一并移除）
+    bool restored = true;
+    for (size_t p = 1; p < numPlaces; p += 5) {
+        std::string id = "place_" + std::to_string(p);
+        place_learner::LearnedSignals saved;
+        saved.wifiSSIDs = {"wifi_" + std::to_string(p), "restored_wifi", "restored_wifi"};
+        saved.cellIds = {cellName(static_cast<int>(p))};
+        saved.typicalTimes = {{9, 10}, {18, 19}};
+        saved.visitCount = 4;
+        learner.restore(id, saved);
+        auto& s = legacy.signals[id];
+        s = {};
+        s.wifi = {"wifi_" + std::to_string(p), "restored_wifi"};
+        s.cell = {cellName(static_cast<int>(p))};
+        const auto* sig = learner.getSignals(id);
+        restored = restored && sig->wifiSSIDs.size() == 2 && sig->visitCount == 4;
+    }
+    restored = restored && learner.findPlacesByWifi("restored_wifi") == legacy.findByWifi("restored_wifi");
+    failures += check("restore() replaces signals and postings",
+                      restored && lookupsAgree(learner, legacy, numPlaces) &&
+                          scoresAgree(learner, legacy, numPlaces, rng, 100));
+
+    PlaceQuery q;
+    q.wifiSsid = "restored_wifi";
+    q.hour = 9;
+    auto top = learner.scorePlaces(q, 1);
+    learner.clearAll();
+    failures += check("time bonus, clearAll()",
+                      top.size() == 1 && top[0].timeMatch && std::fabs(top[0].score - 0.7) < 1e-12 &&
+                          learner.findPlacesByWifi("restored_wifi").empty() && learner.scorePlaces(q).empty() &&
+                          learner.placeCount() == 0);
+    return failures;
+}
+
+// ============================================================
+// 计时
+// ============================================================
+
+void runTiming(int queries) {
+    std::printf("timing: findPlacesByWifi + findPlacesByCellId, %d queries\n", queries);
+    for (size_t numPlaces : {50, 500, 5000}) {
+        std::mt19937 rng(13);
+        PlaceSignalLearner learner;
+        LegacyLearner legacy;
+        for (size_t i = 0; i < numPlaces * 6; i++) {
+            Observation o = randomObservation(numPlaces, rng);
+            learner.learnAt(o.placeId, o.wifi, o.bt, o.cell, 0, o.hour);
+            legacy.learn(o.placeId, o.wifi, o.bt, o.cell);
+        }
+        std::vector<Observation> qs;
+        for (int i = 0; i < 256; i++) qs.push_back(randomObservation(numPlaces, rng));
+
+        size_t sink = 0;
+        auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < queries; i++) {
+            const auto& o = qs[i % qs.size()];
+            sink += legacy.findByWifi(o.wifi).size() + legacy.findByCell(o.cell).size();
+        }
+        double legacyUs = elapsedMs(t0) * 1000.0 / queries;
+
+        t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < queries; i++) {
+            const auto& o = qs[i % qs.size()];
+            sink += learner.findPlacesByWifi(o.wifi).size() + learner.findPlacesByCellId(o.cell).size();
+        }
+        double indexUs = elapsedMs(t0) * 1000.0 / queries;
+
+        t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < queries; i++) {
+            const auto& o = qs[i % qs.size()];
+            PlaceQuery q;
+            q.wifiSsid = o.wifi;
+            q.cellIds = {o.cell};
+            q.hour = o.hour;
+            sink += learner.scorePlaces(q, 3).size();
+        }
+        double scoreUs = elapsedMs(t0) * 1000.0 / queries;
+
+        std::printf("  %5zu places  set scan %9.2f us   inverted %7.2f us  (%.1fx)   scorePlaces top 3 %7.2f us\n",
+                    numPlaces, legacyUs, indexUs, indexUs > 0 ? legacyUs / indexUs : 0.0, scoreUs);
+        if (sink == 1) std::printf("\n");
+    }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t numPlaces = 400;
+    int queries = 20000;
+    bool checkOnly = false;
+    perf::Args()
+        .option("--places", numPlaces)
+        .option("--queries", queries)
+        .flag("--check-only", checkOnly)
+        .parse(argc, argv);
+
+    int failures = runCheck(numPlaces);
+    if (!checkOnly) runTiming(queries);
+
+    return perf::reportMatch(failures);
+}
@@ -0,0 +1,528 @@
+/**
+ * rule_engine_bench.cpp — 决策树增量修补 vs 全量重建
+ *
+ * 逐条 addRule 加入随机规则，中途随机删除 / 修改 / 启停，每一步之后与同一规则集
+ * loadRules 全量编译的引擎对比：树形（节点数 / 叶子数 / 深度）和随机上下文的
+ * evaluate 结果、规则列表（removeRule 留下的墓碑不出现在 ruleCount / exportRulesJson 中）必须一致；
+ * loadRules 留下的重复 id 由 removeRule 全部删除，只改优先级的批次在 commit 时发布且不重建树。
+ * 然后对比逐条 addRule、beginBatch/commit 与每次全量重建（旧行为）的耗时，以及逐条 removeRule 的耗时。
+ *
+ * evaluate() 稳态堆分配：复用 MatchResults 时，除冷却记录的 deque 增长外不应有任何分配
+ * （全局 operator new 计数）。
+ *
+ * evaluateBatch：dry run（并行 / 串行）与逐条 evaluate 结果一致、不改动冷却状态；
+ * 非 dry run 按模拟时间戳累计触发，遵守全局限流。并对比批量回放与逐条 evaluate 的耗时。
+ *
+ * softMatch：每种 op（含 recent / within / 未知 op）× 数值 / 非数值 / 畸形操作数 × 各类上下文值，
+ * 编译版与字符串版 softMatch(Condition) 的得分逐位相同。
+ *
+ * 用法: rule_engine_bench [--rules N] [--check-only]
+ */
+#include "context_engine.h"
+#include "perf_harness.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+using context_engine::BatchOptions;
+using context_engine::BatchResult;
+using context_engine::CompiledCondition;
+using context_engine::Condition;
+using context_engine::ContextMap;
+using context_engine::DenseContext;
+using context_engine::MatchResult;
+using context_engine::MatchResults;
+using context_engine::RateLimits;
+using context_engine::Rule;
+using context_engine::RuleEngine;
+using context_engine::SymbolTable;
+using context_engine::TreeStats;
+using perf::elapsedMs;
+
+namespace {
+std::atomic<size_t> g_allocations{0};
+}  // namespace
+
+void* operator new(size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+namespace {
+
+struct KeySpec {
+    const char* key;
+    std::vector<const char*> values;
+};
+
+const std::vector<KeySpec>& keySpecs() {
+    static const std::vector<KeySpec> specs = {
+        {"timeOfDay", {"morning", "noon", "afternoon", "evening", "night"}},
+        {"dayOfWeek", {"1", "2", "3", "4", "5", "6", "7"}},
+        {"isWeekend", {"true", "false"}},
+        {"motionState", {"still", "walking", "running", "driving"}},
+        {"geofence", {"home", "work", "gym", "mall", "station", "school"}},
+        {"networkType", {"wifi", "cellular", "none"}},
+        {"isCharging", {"true", "false"}},
+        {"batteryLevel", {"10", "20", "50", "80"}},
+        {"hour", {"6", "8", "12", "18", "22"}},
+    };
+    return specs;
+}
+
+Rule randomRule(std::mt19937& rng, int id) {
+    const auto& specs = keySpecs();
+    Rule r;
+    r.id = "rule_" + std::to_string(id);
+    r.name = r.id;
+    r.priority = 1.0 + (rng() % 4) * 0.5;
+    r.cooldownMs = 0;
+    r.enabled = rng() % 8 != 0;
+    r.action = {"action_" + std::to_string(rng() % 40), (rng() % 3 == 0) ? "automation" : "suggestion", "{}"};
+
+    int numConds = 1 + static_cast<int>(rng() % 4);
+    for (int c = 0; c < numConds; c++) {
+        const auto& spec = specs[rng() % specs.size()];
+        Condition cond;
+        cond.key = spec.key;
+        int kind = static_cast<int>(rng() % 10);
+        if (cond.key == "batteryLevel" || cond.key == "hour") {
+            cond.op = kind < 5 ? "gte" : (kind < 8 ? "lte" : "range");
+            cond.value = cond.op == "range" ? "8,18" : spec.values[rng() % spec.values.size()];
+        } else if (kind < 7) {
+            cond.op = "eq";
+            cond.value = spec.values[rng() % spec.values.size()];
+        } else if (kind < 9) {
+            cond.op = "in";
+            cond.value = std::string(spec.values[rng() % spec.values.size()]) + "," +
+                         spec.values[rng() % spec.values.size()];
+        } else {
+            cond.op = "neq";
+            cond.value = spec.values[rng() % spec.values.size()];
+        }
+        r.conditions.push_back(cond);
+    }
+    return r;
+}
+
+ContextMap randomContext(std::mt19937& rng) {
+    ContextMap ctx;
+    for (const auto& spec : keySpecs()) {
+        if (rng() % 5 == 0) continue;  // missing key → default branches
+        ctx[spec.key] = spec.values[rng() % spec.values.size()];
+    }
+    return ctx;
+}
+
+void noLimits(RuleEngine& engine) {
+    RateLimits limits;
+    limits.categoryCooldownCount = 1 << 30;
+    limits.globalMaxPerHour = 1 << 30;
+    engine.setLimits(limits);
+}
+
+bool sameResults(const MatchResults& a, const MatchResults& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].ruleId != b[i].ruleId || a[i].confidence != b[i].confidence) return false;
+    }
+    return true;
+}
+
+/** Compare the patched engine against a fresh full build of the same rules */
+bool matchesFullBuild(RuleEngine& patched, const std::vector<Rule>& rules, const std::vector<ContextMap>& contexts,
+                      int step, bool inBatch = false) {
+    RuleEngine full;
+    noLimits(full);
+    full.loadRules(rules);
+
+    for (const auto& ctx : contexts) {
+        if (!sameResults(patched.evaluate(ctx, 50), full.evaluate(ctx, 50))) {
+            std::printf("  step %d: evaluate differs\n", step);
+            return false;
+        }
+    }
+    // Tombstones left by removeRule must not show up in the rule list (which includes open batch edits)
+    if (!inBatch && (patched.ruleCount() != rules.size() || patched.exportRulesJson() != full.exportRulesJson())) {
+        std::printf("  step %d: %zu rules listed vs %zu\n", step, patched.ruleCount(), rules.size());
+        return false;
+    }
+    TreeStats a = patched.treeStats();
+    TreeStats b = full.treeStats();
+    if (a.nodeCount != b.nodeCount || a.leafCount != b.leafCount || a.maxDepth != b.maxDepth) {
+        std::printf("  step %d: tree shape %zu/%zu/%zu vs full %zu/%zu/%zu\n", step, a.nodeCount, a.leafCount,
+                    a.maxDepth, b.nodeCount, b.leafCount, b.maxDepth);
+        return false;
+    }
+    return true;
+}
+
+int runEquivalence(int numRules) {
+    std::mt19937 rng(2024);
+    std::vector<ContextMap> contexts;
+    for (int i = 0; i < 40; i++) contexts.push_back(randomContext(rng));
+
+    RuleEngine engine;
+    noLimits(engine);
+    std::vector<Rule> rules;  // mirror of the engine's rule list, same order
+    int nextId = 0;
+    int failures = 0;
+
+    for (int step = 0; step < numRules * 2 && failures == 0; step++) {
+        int op = static_cast<int>(rng() % 10);
+        if (rules.empty() || op < 6) {
+            rules.push_back(randomRule(rng, nextId++));
+            engine.addRule(rules.back());
+        } else if (op < 8) {
+            size_t i = rng() % rules.size();
+            engine.removeRule(rules[i].id);
+            rules.erase(rules.begin() + static_cast<long>(i));
+        } else {
+            // Update in place: new conditions / enabled flag, or priority only
+            size_t i = rng() % rules.size();
+            Rule updated = op == 8 ? randomRule(rng, 0) : rules[i];
+            updated.id = rules[i].id;
+            updated.priority += 0.25;
+            rules[i] = updated;
+            engine.addRule(updated);
+        }
+        if (step % 5 == 0 && !matchesFullBuild(engine, rules, contexts, step)) failures++;
+    }
+    if (failures == 0 && !matchesFullBuild(engine, rules, contexts, -1)) failures++;
+
+    // Batch: many edits, one build at commit; evaluate() mid-batch still sees the committed rules
+    std::vector<Rule> committed = rules;
+    engine.beginBatch();
+    for (int i = 0; i < numRules / 2; i++) {
+        rules.push_back(randomRule(rng, nextId++));
+        engine.addRule(rules.back());
+        if (i == numRules / 4 && !matchesFullBuild(engine, committed, contexts, -2, true)) failures++;
+    }
+    engine.removeRule(rules.front().id);
+    rules.erase(rules.begin());
+    engine.commit();
+    if (!matchesFullBuild(engine, rules, contexts, -3)) failures++;
+
+    // loadRules keeps duplicate ids; removeRule drops every copy, patched or inside a batch
+    for (int batched = 0; batched < 2 && failures == 0; batched++) {
+        Rule dup = randomRule(rng, nextId++);
+        std::vector<Rule> withDups = rules;
+        withDups.insert(withDups.begin() + static_cast<long>(withDups.size() / 2), dup);
+        dup.priority += 0.5;
+        withDups.push_back(dup);
+        engine.loadRules(withDups);
+        if (batched) engine.beginBatch();
+        bool removed = engine.removeRule(dup.id);
+        if (batched) engine.commit();
+        if (!removed || engine.ruleCount() != rules.size()) {
+            std::printf("  duplicate ids: %zu rules left after removeRule, expected %zu\n", engine.ruleCount(),
+                        rules.size());
+            failures++;
+        } else if (!matchesFullBuild(engine, rules, contexts, -4 - batched)) {
+            failures++;
+        }
+    }
+
+    // A batch of priority-only edits keeps the tree but must still be published at commit
+    if (failures == 0) {
+        engine.loadRules(rules);
+        std::vector<MatchResults> before(contexts.size());
+        for (size_t i = 0; i < contexts.size(); i++) engine.evaluate(contexts[i], 50, before[i]);
+        uint64_t fullBuilds = engine.treeStats().fullBuilds;
+        engine.beginBatch();
+        for (size_t i = 0; i < rules.size(); i++) {
+            rules[i].priority = 1.0 + static_cast<double>(rules.size() - i);  // reverse the ranking
+            engine.addRule(rules[i]);
+        }
+        engine.commit();
+        bool changed = false;
+        for (size_t i = 0; i < contexts.size(); i++) changed = changed || !sameResults(before[i], engine.evaluate(contexts[i], 50));
+        if (!changed || engine.treeStats().fullBuilds != fullBuilds) {
+            std::printf("  priority-only batch: %s\n", changed ? "rebuilt the tree" : "not published at commit");
+            failures++;
+        } else if (!matchesFullBuild(engine, rules, contexts, -6)) {
+            failures++;
+        }
+    }
+
+    TreeStats stats = engine.treeStats();
+    std::printf("equivalence: %zu rules, %zu nodes, %zu leaves, depth %zu, %llu patches, %llu full builds  %s\n",
+                rules.size(), stats.nodeCount, stats.leafCount, stats.maxDepth,
+                static_cast<unsigned long long>(stats.patches), static_cast<unsigned long long>(stats.fullBuilds),
+                failures == 0 ? "ok" : "FAIL");
+    return failures;
+}
+
+int runSoftMatchEquivalence() {
+    const char* ops[] = {"eq", "neq", "gt", "gte", "lt", "lte", "in", "range", "recent", "within", "near", ""};
+    const char* operands[] = {"5", "5.0", "-2", "1e3", "abc", "3,8", "a,abc", "8,3", "3,x", "", " 5"};
+    const char* values[] = {"5", "5.0", "4", "9", "-2", "1000", "abc", "a", "", "nan", "1e999", nullptr};
+
+    size_t cases = 0, mismatches = 0;
+    for (const char* op : ops) {
+        for (const char* operand : operands) {
+            Condition cond{"k", op, operand};
+            SymbolTable symbols;
+            CompiledCondition compiled = context_engine::compileCondition(cond, symbols);
+            std::vector<uint8_t> numericKeys(symbols.size(), 0);
+            if (context_engine::needsNumericContext(compiled)) numericKeys[compiled.key] = 1;
+            for (const char* value : values) {
+                ContextMap ctx;
+                if (value != nullptr) ctx["k"] = value;
+                DenseContext dense;
+                dense.bind(ctx, symbols, numericKeys);
+                double expected = context_engine::softMatch(cond, ctx);
+                double actual = context_engine::softMatch(compiled, dense);
+                cases++;
+                if (expected != actual) {
+                    if (mismatches++ < 5) {
+                        std::printf("  softMatch %s \"%s\" on \"%s\": compiled %.3f vs %.3f\n", op, operand,
+                                    value ? value : "(missing)", actual, expected);
+                    }
+                }
+            }
+        }
+    }
+    std::printf("softMatch: %zu op / operand / value cases, %zu differ  %s\n", cases, mismatches,
+                mismatches == 0 ? "ok" : "FAIL");
+    return mismatches == 0 ? 0 : 1;
+}
+
+int runAllocationCheck(int numRules) {
+    std::mt19937 rng(3);
+    std::vector<Rule> rules;
+    for (int i = 0; i < numRules; i++) rules.push_back(randomRule(rng, i));
+    std::vector<ContextMap> contexts;
+    for (int i = 0; i < 200; i++) contexts.push_back(randomContext(rng));
+
+    RuleEngine engine;
+    noLimits(engine);
+    engine.loadRules(rules);
+    MatchResults out;
+    for (int round = 0; round < 2; round++) {
+        for (const auto& ctx : contexts) engine.evaluate(ctx, 5, out);  // warm up scratch / result storage
+    }
+
+    size_t calls = 0, fired = 0;
+    size_t before = g_allocations.load();
+    for (int round = 0; round < 10; round++) {
+        for (const auto& ctx : contexts) {
+            engine.evaluate(ctx, 5, out);
+            calls++;
+            fired += out.empty() ? 0 : 1;
+        }
+    }
+    size_t allocations = g_allocations.load() - before;
+
+    // Only the firing history may still grow: one deque block per 64 timestamps (category + global),
+    // plus the occasional deque map reallocation
+    size_t allowed = 2 * (fired / 64 + 1) + 16;
+    bool ok = allocations <= allowed;
+    std::printf("allocations: %zu over %zu evaluate() calls (%zu fired, firing history allows %zu)  %s\n",
+                allocations, calls, fired, allowed, ok ? "ok" : "FAIL");
+    return ok ? 0 : 1;
+}
+
+/** Matches of context i from a columnar batch result */
+std::vector<std::pair<std::string, double>> batchRow(const BatchResult& batch, size_t i) {
+    std::vector<std::pair<std::string, double>> row;
+    for (uint32_t m = batch.offsets[i]; m < batch.offsets[i + 1]; m++) {
+        row.emplace_back(batch.ruleIds[batch.ruleIndex[m]], batch.confidence[m]);
+    }
+    return row;
+}
+
+bool sameRow(const MatchResults& a, const std::vector<std::pair<std::string, double>>& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].ruleId != b[i].first || a[i].confidence != b[i].second) return false;
+    }
+    return true;
+}
+
+bool sameBatch(const BatchResult& a, const BatchResult& b) {
+    return a.offsets == b.offsets && a.ruleIndex == b.ruleIndex && a.confidence == b.confidence;
+}
+
+int runBatchChecks(int numRules) {
+    std::mt19937 rng(7);
+    std::vector<Rule> rules;
+    for (int i = 0; i < numRules; i++) rules.push_back(randomRule(rng, i));
+    std::vector<ContextMap> contexts;
+    for (int i = 0; i < 500; i++) contexts.push_back(randomContext(rng));
+    int failures = 0;
+
+    // Without limits or cooldowns evaluate() is stateless: a dry run must match it row by row
+    RuleEngine engine;
+    noLimits(engine);
+    engine.loadRules(rules);
+    BatchOptions dry;
+    dry.dryRun = true;
+    dry.maxResults = 8;
+    BatchResult parallel = engine.evaluateBatch(contexts, dry);
+    dry.parallel = false;
+    BatchResult serial = engine.evaluateBatch(contexts, dry);
+    if (!sameBatch(parallel, serial)) {
+        std::printf("  batch: parallel and serial dry runs differ\n");
+        failures++;
+    }
+    for (size_t i = 0; i < contexts.size() && failures == 0; i++) {
+        if (!sameRow(engine.evaluate(contexts[i], 8), batchRow(parallel, i))) {
+            std::printf("  batch: context %zu differs from evaluate()\n", i);
+            failures++;
+        }
+    }
+
+    // Default limits + cooldowns: dry runs never record, a real replay does
+    for (auto& r : rules) r.cooldownMs = 30 * 60000;
+    RuleEngine limited;
+    limited.loadRules(rules);
+    BatchOptions replay;  // default options: firings recorded, like evaluate()
+    for (size_t i = 0; i < contexts.size(); i++) replay.timestampsMs.push_back(1000000000 + 1000 * i);
+    BatchOptions dryReplay = replay;
+    dryReplay.dryRun = true;
+
+    BatchResult before = limited.evaluateBatch(contexts, dryReplay);
+    BatchResult fired = limited.evaluateBatch(contexts, replay);
+    BatchResult again = limited.evaluateBatch(contexts, dryReplay);
+    size_t firedRows = 0;
+    for (size_t i = 0; i < contexts.size(); i++) firedRows += fired.offsets[i + 1] > fired.offsets[i];
+    if (firedRows > 10) {
+        std::printf("  batch: %zu rows fired within one simulated hour (limit 10)\n", firedRows);
+        failures++;
+    }
+    if (sameBatch(before, again) || before.ruleIndex.size() <= fired.ruleIndex.size()) {
+        std::printf("  batch: replay did not record firings\n");
+        failures++;
+    }
+    BatchResult againSerial = limited.evaluateBatch(contexts, [&] {
+        BatchOptions o = dryReplay;
+        o.parallel = false;
+        return o;
+    }());
+    if (!sameBatch(again, againSerial)) {
+        std::printf("  batch: dry runs over recorded state differ\n");
+        failures++;
+    }
+
+    std::printf("batch: %zu contexts, %zu dry-run matches, %zu fired rows on replay  %s\n", contexts.size(),
+                parallel.ruleIndex.size(), firedRows, failures == 0 ? "ok" : "FAIL");
+    return failures;
+}
+
+void runBatchTiming(int numRules) {
+    std::mt19937 rng(5);
+    std::vector<Rule> rules;
+    for (int i = 0; i < numRules; i++) rules.push_back(randomRule(rng, i));
+    std::vector<ContextMap> contexts;
+    for (int i = 0; i < 20000; i++) contexts.push_back(randomContext(rng));
+
+    RuleEngine engine;
+    noLimits(engine);
+    engine.loadRules(rules);
+
+    auto t0 = std::chrono::steady_clock::now();
+    size_t sink = 0;
+    for (const auto& ctx : contexts) sink += engine.evaluate(ctx).size();
+    double singleMs = elapsedMs(t0);
+
+    BatchOptions options;
+    options.dryRun = true;
+    options.parallel = false;
+    t0 = std::chrono::steady_clock::now();
+    sink += engine.evaluateBatch(contexts, options).ruleIndex.size();
+    double serialMs = elapsedMs(t0);
+
+    options.parallel = true;
+    t0 = std::chrono::steady_clock::now();
+    sink += engine.evaluateBatch(contexts, options).ruleIndex.size();
+    double parallelMs = elapsedMs(t0);
+
+    std::printf("timing: %zu contexts, %d rules\n", contexts.size(), numRules);
+    std::printf("  evaluate() per context %9.3f ms\n", singleMs);
+    std::printf("  evaluateBatch serial   %9.3f ms  (%.1fx)\n", serialMs, serialMs > 0 ? singleMs / serialMs : 0.0);
+    std::printf("  evaluateBatch parallel %9.3f ms  (%.1fx)\n", parallelMs,
+                parallelMs > 0 ? singleMs / parallelMs : 0.0);
+    if (sink == 0) std::printf("\n");
+}
+
+void runTiming(int numRules) {
+    std::mt19937 rng(99);
+    std::vector<Rule> rules;
+    for (int i = 0; i < numRules; i++) rules.push_back(randomRule(rng, i));
+
+    // Previous behaviour: every addRule recompiled the whole tree
+    RuleEngine rebuild;
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<Rule> prefix;
+    for (const auto& r : rules) {
+        prefix.push_back(r);
+        rebuild.loadRules(prefix);
+    }
+    double rebuildMs = elapsedMs(t0);
+
+    RuleEngine serial;
+    t0 = std::chrono::steady_clock::now();
+    for (const auto& r : rules) serial.addRule(r);
+    double serialMs = elapsedMs(t0);
+
+    RuleEngine batch;
+    t0 = std::chrono::steady_clock::now();
+    batch.beginBatch();
+    for (const auto& r : rules) batch.addRule(r);
+    batch.commit();
+    double batchMs = elapsedMs(t0);
+
+    // Feedback-style priority edits: the route is unchanged, only the rule table is republished
+    t0 = std::chrono::steady_clock::now();
+    for (auto& r : rules) {
+        r.priority += 0.1;
+        serial.addRule(r);
+    }
+    double priorityMs = elapsedMs(t0);
+
+    // Removals patch the tree and leave a tombstone; no rule index in the tree moves
+    t0 = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < rules.size(); i += 2) serial.removeRule(rules[i].id);
+    double removeMs = elapsedMs(t0);
+    size_t removes = (rules.size() + 1) / 2;
+
+    TreeStats stats = batch.treeStats();
+    std::printf("timing: %d rules one addRule at a time\n", numRules);
+    std::printf("  full rebuild per add  %9.3f ms\n", rebuildMs);
+    std::printf("  incremental patch     %9.3f ms  (%.1fx)\n", serialMs, serialMs > 0 ? rebuildMs / serialMs : 0.0);
+    std::printf("  beginBatch/commit     %9.3f ms  (%.1fx)  single build %.3f ms, %zu nodes\n", batchMs,
+                batchMs > 0 ? rebuildMs / batchMs : 0.0, stats.lastBuildMs, stats.nodeCount);
+    std::printf("  priority-only edits   %9.3f ms  (%.2f us per edit)\n", priorityMs,
+                numRules > 0 ? priorityMs * 1000 / numRules : 0.0);
+    std::printf("  removeRule            %9.3f ms  (%.2f us per removal)\n", removeMs,
+                removes > 0 ? removeMs * 1000 / removes : 0.0);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    int numRules = 250;
+    bool checkOnly = false;
+    perf::Args().option("--rules", numRules).flag("--check-only", checkOnly).parse(argc, argv);
+
+    int failures = runSoftMatchEquivalence();
+    failures += runEquivalence(checkOnly ? std::min(numRules, 120) : numRules);
+    failures += runAllocationCheck(checkOnly ? std::min(numRules, 120) : numRules);
+    failures += runBatchChecks(checkOnly ? std::min(numRules, 120) : numRules);
+    if (!checkOnly) {
+        runTiming(numRules);
+        runBatchTiming(numRules);
+    }
+
+    return perf::reportMatch(failures);
+}
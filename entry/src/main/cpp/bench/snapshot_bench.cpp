@@ -0,0 +1,262 @@
+/**
+ * snapshot_bench.cpp — 二进制快照 vs JSON 持久化
+ *
+ * 校验：规则 / MAB / LinUCB 写入快照再读回后，规则导出、MAB 统计与 LinUCB 选择完全一致；
+ * 少量臂更新后的再次保存只原地覆盖这些臂；新增臂触发整文件重写；
+ * 文件已损坏时打补丁前的校验失败，改为整文件重写；
+ * 任意位置翻转一个字节都会被校验和拒绝且不改动引擎状态；FeedbackLearner 偏好段读写。
+ * 然后在数百个臂下对比 JSON 导出 / 导入与快照保存 / 读取的耗时。
+ *
+ * 用法: snapshot_bench [--arms N] [--dir PATH] [--check-only]
+ */
+#include "context_engine.h"
+#include "feedback_learner/feedback_learner.h"
+#include "perf_harness.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+using context_engine::ContextMap;
+using context_engine::RuleEngine;
+using context_engine::SnapshotWriteStats;
+using perf::elapsedMs;
+using perf::check;
+
+namespace {
+
+ContextMap randomContext(std::mt19937& rng) {
+    static const char* const motions[] = {"stationary", "walking", "running", "driving"};
+    ContextMap ctx;
+    ctx["hour"] = std::to_string(rng() % 24);
+    ctx["batteryLevel"] = std::to_string(rng() % 101);
+    ctx["isCharging"] = rng() % 3 == 0 ? "true" : "false";
+    ctx["motionState"] = motions[rng() % 4];
+    return ctx;
+}
+
+std::vector<context_engine::Rule> makeRules(size_t n) {
+    std::vector<context_engine::Rule> rules;
+    for (size_t i = 0; i < n; i++) {
+        context_engine::Rule r;
+        r.id = "rule_" + std::to_string(i);
+        r.name = "规则 " + std::to_string(i);
+        r.conditions = {{"timeOfDay", "eq", i % 2 ? "morning" : "evening"},
+                        {"batteryLevel", "lt", std::to_string(20 + i % 60)}};
+        r.action = {"action_" + std::to_string(i % 7), "suggestion", "{\"text\":\"hi\"}"};
+        r.priority = 1.0 + static_cast<double>(i % 5);
+        r.cooldownMs = static_cast<int64_t>(i) * 1000;
+        r.enabled = i % 9 != 0;
+        rules.push_back(r);
+    }
+    return rules;
+}
+
+std::vector<std::string> armIds(size_t n) {
+    std::vector<std::string> ids;
+    for (size_t i = 0; i < n; i++) ids.push_back("action_" + std::to_string(i));
+    return ids;
+}
+
+/** 引擎里放入规则、MAB 统计和 numArms 个训练过的 LinUCB 臂 */
+void populate(RuleEngine& engine, size_t numArms, std::mt19937& rng) {
+    engine.loadRules(makeRules(40));
+    auto ids = armIds(numArms);
+    for (size_t i = 0; i < numArms * 4; i++) {
+        const std::string& id = ids[i % numArms];
+        double reward = (rng() % 3 == 0) ? 1.0 : 0.0;
+        engine.mab().update(id, reward);
+        engine.linucb().update(id, reward, randomContext(rng));
+    }
+}
+
+bool sameState(RuleEngine& a, RuleEngine& b, size_t numArms, std::mt19937& rng) {
+    if (a.exportRulesJson() != b.exportRulesJson()) return false;
+    auto sa = a.mab().getStats(), sb = b.mab().getStats();
+    if (sa.size() != sb.size()) return false;
+    for (const auto& [id, arm] : sa) {
+        auto it = sb.find(id);
+        if (it == sb.end() || it->second.pulls != arm.pulls || it->second.totalReward != arm.totalReward) return false;
+    }
+    auto ids = armIds(numArms);
+    for (int q = 0; q < 200; q++) {
+        ContextMap ctx = randomContext(rng);
+        if (a.linucb().select(ids, ctx) != b.linucb().select(ids, ctx)) return false;
+    }
+    return true;
+}
+
+std::string readFile(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+}
+
+void writeFile(const std::string& path, const std::string& bytes) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+}
+
+int runCheck(size_t numArms, const std::string& dir) {
+    std::printf("check: %zu arms\n", numArms);
+    std::mt19937 rng(5);
+    std::string path = dir + "/snapshot_bench_check.snap";
+    int failures = 0;
+
+    RuleEngine engine;
+    populate(engine, numArms, rng);
+    SnapshotWriteStats stats;
+    failures += check("first save rewrites whole file", engine.saveSnapshot(path, &stats) && stats.full &&
+                                                             stats.armsWritten == numArms);
+
+    RuleEngine restored;
+    failures += check("load restores rules / MAB / LinUCB", restored.loadSnapshot(path) &&
+                                                                sameState(engine, restored, numArms, rng));
+
+    // 更新 3 个已有臂：只覆盖这 3 个槽位 + MAB 段
+    auto ids = armIds(numArms);
+    for (int i = 0; i < 3; i++) {
+        engine.linucb().update(ids[i * 5], 1.0, randomContext(rng));
+        engine.mab().update(ids[i * 5], 1.0);
+    }
+    bool saved = engine.saveSnapshot(path, &stats);
+    size_t fullSize = readFile(path).size();
+    failures += check("dirty arms patched in place", saved && !stats.full && stats.armsWritten == 3 &&
+                                                         stats.bytesWritten < fullSize / 10);
+    RuleEngine patched;
+    failures += check("patched file loads to the same state", patched.loadSnapshot(path) &&
+                                                                  sameState(engine, patched, numArms, rng));
+
+    // 读回后的引擎继续增量写同一文件
+    patched.linucb().update(ids[1], 0.0, randomContext(rng));
+    saved = patched.saveSnapshot(path, &stats);
+    failures += check("loaded engine patches its own file", saved && !stats.full && stats.armsWritten == 1);
+
+    // 新臂没有槽位 → 整文件重写
+    engine.linucb().update("brand_new_action", 1.0, randomContext(rng));
+    failures += check("new arm rewrites whole file", engine.saveSnapshot(path, &stats) && stats.full &&
+                                                         stats.armsWritten == numArms + 1);
+    RuleEngine grown;
+    failures += check("rewritten file loads", grown.loadSnapshot(path) && sameState(engine, grown, numArms, rng));
+
+    // 规则变化（大小不同）同样整文件重写
+    engine.addRule(makeRules(41).back());
+    failures += check("rule edit rewrites whole file", engine.saveSnapshot(path, &stats) && stats.full);
+
+    // 文件被外部改坏（LinUCB 臂 id 区，段表仍有效）：校验在写入之前失败，整文件重写而不是在坏文件上打补丁
+    {
+        std::string bytes = readFile(path);
+        size_t idPos = bytes.rfind(ids[7]);
+        bytes[idPos] = static_cast<char>(bytes[idPos] ^ 0x5A);
+        writeFile(path, bytes);
+        engine.linucb().update(ids[2], 1.0, randomContext(rng));
+        engine.mab().update(ids[2], 1.0);
+        RuleEngine repaired;
+        failures += check("damaged file rewritten instead of patched", engine.saveSnapshot(path, &stats) &&
+                                                                          stats.full && repaired.loadSnapshot(path) &&
+                                                                          sameState(engine, repaired, numArms, rng));
+    }
+
+    // 逐段翻转字节：必须被拒绝，且引擎状态不变
+    std::string good = readFile(path);
+    RuleEngine probe;
+    probe.loadRules(makeRules(3));
+    std::string before = probe.exportRulesJson();
+    size_t accepted = 0, probes = 0;
+    for (size_t pos = 0; pos < good.size(); pos += 1 + good.size() / 97) {
+        std::string bad = good;
+        bad[pos] = static_cast<char>(bad[pos] ^ 0x5A);
+        writeFile(path, bad);
+        if (probe.loadSnapshot(path)) accepted++;
+        probes++;
+    }
+    writeFile(path, good.substr(0, good.size() / 2));
+    if (probe.loadSnapshot(path)) accepted++;
+    failures += check("corrupt / truncated files rejected", accepted == 0 && probe.exportRulesJson() == before);
+    std::printf("    (%zu corrupted copies + 1 truncated)\n", probes);
+
+    // FeedbackLearner 偏好段
+    feedback_learner::FeedbackLearner learner;
+    feedback_learner::FeedbackContext ctx{};
+    learner.recordSimpleFeedback("rule_1", feedback_learner::FeedbackType::USEFUL, ctx);
+    feedback_learner::AdjustmentValue adjust{"hour", 7.0, 7.5, "hour"};
+    learner.recordAdjustment("rule_2", ctx, adjust);
+    std::string prefsPath = dir + "/snapshot_bench_prefs.snap";
+    feedback_learner::FeedbackLearner reloaded;
+    failures += check("feedback preferences round trip", learner.savePreferences(prefsPath) &&
+                                                             reloaded.loadPreferences(prefsPath) &&
+                                                             reloaded.exportPreferences() == learner.exportPreferences());
+
+    std::remove(path.c_str());
+    std::remove(prefsPath.c_str());
+    return failures;
+}
+
+void runTiming(size_t numArms, const std::string& dir) {
+    std::mt19937 rng(9);
+    RuleEngine engine;
+    populate(engine, numArms, rng);
+    std::string path = dir + "/snapshot_bench_timing.snap";
+    const int rounds = 20;
+
+    auto t0 = std::chrono::steady_clock::now();
+    std::string json;
+    for (int i = 0; i < rounds; i++) json = engine.linucb().exportJson();
+    double exportMs = elapsedMs(t0) / rounds;
+
+    t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+        context_engine::LinUCB bandit;
+        bandit.importJson(json);
+    }
+    double importMs = elapsedMs(t0) / rounds;
+
+    // 交替写两个路径：每次都不是上次写的文件，必然整文件重写
+    std::string otherPath = dir + "/snapshot_bench_timing_full.snap";
+    SnapshotWriteStats full;
+    t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) engine.saveSnapshot(i % 2 ? path : otherPath, &full);
+    double saveFullMs = elapsedMs(t0) / rounds;
+
+    auto ids = armIds(numArms);
+    SnapshotWriteStats patch;
+    t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+        engine.linucb().update(ids[static_cast<size_t>(i) % numArms], 1.0, randomContext(rng));
+        engine.saveSnapshot(path, &patch);
+    }
+    double savePatchMs = elapsedMs(t0) / rounds;
+
+    t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+        RuleEngine fresh;
+        fresh.loadSnapshot(path);
+    }
+    double loadMs = elapsedMs(t0) / rounds;
+
+    std::printf("timing: %zu arms, 40 rules (mean of %d)\n", numArms, rounds);
+    std::printf("  JSON     export %8.3f ms  import %8.3f ms  (%zu bytes, LinUCB only)\n", exportMs, importMs,
+                json.size());
+    std::printf("  snapshot full save %8.3f ms (%zu bytes)  patch save %8.3f ms (%zu bytes)\n", saveFullMs,
+                full.bytesWritten, savePatchMs, patch.bytesWritten);
+    std::printf("  snapshot load %8.3f ms  (%.1fx faster than JSON import)\n", loadMs,
+                loadMs > 0 ? importMs / loadMs : 0.0);
+    std::remove(path.c_str());
+    std::remove(otherPath.c_str());
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t numArms = 300;
+    std::string dir = "/tmp";
+    bool checkOnly = false;
+    perf::Args().option("--arms", numArms).option("--dir", dir).flag("--check-only", checkOnly).parse(argc, argv);
+
+    int failures = runCheck(numArms, dir);
+    if (!checkOnly) runTiming(numArms, dir);
+
+    return perf::reportMatch(failures);
+}
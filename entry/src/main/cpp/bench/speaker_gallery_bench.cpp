@@ -0,0 +1,257 @@
+/**
+ * speaker_gallery_bench.cpp — 连续矩阵声纹库 vs std::map + 逐对 CosineSimilarity
+ *
+ * 校验：bestMatches / identify 与原实现（每次重算双方范数）的名字与分数一致；
+ * 随机删除（末行回填压缩）后仍一致；同名覆盖、导出原始向量、零向量、同分按名字排序；
+ * 多个线程同时查询时结果与单线程一致。
+ * 然后对比不同库规模下 getBestMatches(top 3) 的耗时。
+ *
+ * 用法: speaker_gallery_bench [--queries N] [--check-only]
+ */
+#include "voiceprint/speaker_gallery.h"
+#include "perf_harness.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using voiceprint::SpeakerGallery;
+using voiceprint::SpeakerMatch;
+using perf::elapsedMs;
+using perf::check;
+
+namespace {
+
+constexpr int DIM = 192;
+
+// ============================================================
+// 原实现：voiceprint_napi.cpp 中的 map + CosineSimilarity + sort
+// ============================================================
+
+double cosineSimilarity(const float* a, const float* b, int dim) {
+    double dot = 0.0, normA = 0.0, normB = 0.0;
+    for (int i = 0; i < dim; i++) {
+        dot += a[i] * b[i];
+        normA += a[i] * a[i];
+        normB += b[i] * b[i];
+    }
+    if (normA > 0 && normB > 0) {
+        return dot / (std::sqrt(normA) * std::sqrt(normB));
+    }
+    return 0.0;
+}
+
+using LegacyStore = std::map<std::string, std::vector<float>>;
+
+std::vector<std::pair<std::string, double>> legacyBestMatches(const LegacyStore& store, const float* query,
+                                                              double threshold, size_t topN) {
+    std::vector<std::pair<std::string, double>> matches;
+    for (auto& pair : store) {
+        double score = cosineSimilarity(query, pair.second.data(), DIM);
+        if (score >= threshold) matches.push_back({pair.first, score});
+    }
+    std::stable_sort(matches.begin(), matches.end(),
+                     [](const auto& a, const auto& b) { return a.second > b.second; });
+    if (matches.size() > topN) matches.resize(topN);
+    return matches;
+}
+
+// ============================================================
+// 数据：每个说话人一个随机中心，查询为中心 + 噪声
+// ============================================================
+
+std::vector<float> randomEmbedding(std::mt19937& rng) {
+    std::normal_distribution<float> g(0.0f, 1.0f);
+    std::vector<float> v(DIM);
+    for (auto& x : v) x = g(rng);
+    return v;
+}
+
+std::vector<float> noisy(const std::vector<float>& center, float sigma, std::mt19937& rng) {
+    std::normal_distribution<float> g(0.0f, sigma);
+    std::vector<float> v(center);
+    for (auto& x : v) x += g(rng);
+    return v;
+}
+
+void enroll(size_t n, std::mt19937& rng, LegacyStore& legacy, SpeakerGallery& gallery) {
+    for (size_t i = 0; i < n; i++) {
+        std::string name = "spk_" + std::to_string(i);
+        auto emb = randomEmbedding(rng);
+        legacy[name] = emb;
+        gallery.add(name, emb.data());
+    }
+}
+
+/** 名字一致、分数相差 < 1e-5；分数相差极小的相邻两名允许互换 */
+bool sameMatches(const std::vector<std::pair<std::string, double>>& expected, const std::vector<SpeakerMatch>& got) {
+    if (expected.size() != got.size()) return false;
+    for (size_t i = 0; i < got.size(); i++) {
+        if (std::fabs(expected[i].second - got[i].score) > 1e-5) return false;
+        if (expected[i].first != got[i].name) {
+            bool swapped = i + 1 < got.size() && expected[i].first == got[i + 1].name &&
+                           std::fabs(expected[i].second - expected[i + 1].second) < 1e-5;
+            bool swappedBack = i > 0 && expected[i].first == got[i - 1].name;
+            if (!swapped && !swappedBack) return false;
+        }
+    }
+    return true;
+}
+
+bool agreesWithLegacy(const LegacyStore& legacy, const SpeakerGallery& gallery, std::mt19937& rng, int queries) {
+    std::vector<std::vector<float>> centers;
+    for (auto& pair : legacy) centers.push_back(pair.second);
+    std::vector<SpeakerMatch> got;
+    for (int q = 0; q < queries; q++) {
+        auto query = q % 4 == 0 || centers.empty() ? randomEmbedding(rng) : noisy(centers[q % centers.size()], 0.6f, rng);
+        double threshold = q % 3 == 0 ? -1.0 : 0.3;
+        gallery.bestMatches(query.data(), threshold, 3, got);
+        if (!sameMatches(legacyBestMatches(legacy, query.data(), threshold, 3), got)) return false;
+        gallery.bestMatches(query.data(), threshold, 1, got);
+        if (!sameMatches(legacyBestMatches(legacy, query.data(), threshold, 1), got)) return false;
+    }
+    return true;
+}
+
+// ============================================================
+// 校验
+// ============================================================
+
+int runCheck() {
+    std::printf("check (%s kernel):\n", SpeakerGallery::backend());
+    int failures = 0;
+    std::mt19937 rng(7);
+
+    LegacyStore legacy;
+    SpeakerGallery gallery(DIM);
+    enroll(300, rng, legacy, gallery);
+    failures += check("bestMatches / identify match legacy", agreesWithLegacy(legacy, gallery, rng, 400));
+
+    std::vector<std::string> names = gallery.names();
+    std::shuffle(names.begin(), names.end(), rng);
+    for (size_t i = 0; i < 170; i++) {
+        legacy.erase(names[i]);
+        gallery.remove(names[i]);
+    }
+    bool consistent = gallery.size() == legacy.size() && !gallery.remove(names[0]) && !gallery.contains(names[1]);
+    for (auto& pair : legacy) consistent = consistent && gallery.contains(pair.first);
+    failures += check("removal compacts rows, results still match",
+                      consistent && agreesWithLegacy(legacy, gallery, rng, 200));
+
+    auto replacement = randomEmbedding(rng);
+    std::string kept = legacy.begin()->first;
+    legacy[kept] = replacement;
+    gallery.add(kept, replacement.data());
+    std::vector<float> exported;
+    bool exportOk = gallery.exportEmbedding(kept, exported) && exported.size() == DIM;
+    for (int i = 0; exportOk && i < DIM; i++) {
+        exportOk = std::fabs(exported[i] - replacement[i]) <= 1e-5f * (1.0f + std::fabs(replacement[i]));
+    }
+    failures += check("re-register replaces, export keeps scale",
+                      exportOk && gallery.size() == legacy.size() && !gallery.exportEmbedding("nobody", exported) &&
+                          std::fabs(gallery.similarity(kept, replacement.data()) - 1.0) < 1e-6 &&
+                          gallery.similarity("nobody", replacement.data()) == -1.0 &&
+                          agreesWithLegacy(legacy, gallery, rng, 100));
+
+    SpeakerGallery small(DIM);
+    std::vector<float> zero(DIM, 0.0f);
+    auto a = randomEmbedding(rng);
+    small.add("zero", zero.data());
+    small.add("b", a.data());
+    small.add("a", a.data());
+    std::vector<SpeakerMatch> got;
+    small.bestMatches(a.data(), -1.0, 3, got);
+    std::vector<float> scores;
+    small.scoreAll(zero.data(), scores);
+    failures += check("zero vectors score 0, ties ordered by name",
+                      got.size() == 3 && got[0].name == "a" && got[1].name == "b" && got[2].name == "zero" &&
+                          got[2].score == 0.0 && scores.size() == 3 && scores[0] == 0 && scores[1] == 0);
+
+    small.bestMatches(a.data(), 0.5, 0, got);
+    bool zeroK = got.empty();
+    small.clear();
+    small.bestMatches(a.data(), -1.0, 3, got);
+    failures += check("topK 0 / empty gallery", zeroK && got.empty() && small.size() == 0);
+
+    // 并发只读：多个线程同时 bestMatches / similarity，结果与单线程一致（scratch 按线程隔离）
+    std::vector<std::vector<float>> queries;
+    for (int i = 0; i < 64; i++) queries.push_back(randomEmbedding(rng));
+    std::vector<std::vector<SpeakerMatch>> expected(queries.size());
+    for (size_t i = 0; i < queries.size(); i++) gallery.bestMatches(queries[i].data(), 0.0, 5, expected[i]);
+    std::atomic<size_t> mismatched{0};
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; t++) {
+        readers.emplace_back([&, t] {
+            std::vector<SpeakerMatch> mine;
+            for (int round = 0; round < 50; round++) {
+                for (size_t i = t; i < queries.size(); i += 2) {
+                    gallery.bestMatches(queries[i].data(), 0.0, 5, mine);
+                    bool same = mine.size() == expected[i].size();
+                    for (size_t j = 0; same && j < mine.size(); j++) {
+                        same = mine[j].name == expected[i][j].name && mine[j].score == expected[i][j].score &&
+                               gallery.similarity(mine[j].name, queries[i].data()) == mine[j].score;
+                    }
+                    if (!same) mismatched++;
+                }
+            }
+        });
+    }
+    for (auto& t : readers) t.join();
+    failures += check("concurrent readers get single-thread results", mismatched == 0);
+    return failures;
+}
+
+// ============================================================
+// 计时
+// ============================================================
+
+void runTiming(int queries) {
+    std::printf("timing: getBestMatches(top 3), %d queries\n", queries);
+    for (size_t n : {8, 64, 512}) {
+        std::mt19937 rng(11);
+        LegacyStore legacy;
+        SpeakerGallery gallery(DIM);
+        enroll(n, rng, legacy, gallery);
+        std::vector<std::vector<float>> qs;
+        for (int q = 0; q < 256; q++) qs.push_back(randomEmbedding(rng));
+
+        size_t sink = 0;
+        auto t0 = std::chrono::steady_clock::now();
+        for (int q = 0; q < queries; q++) {
+            sink += legacyBestMatches(legacy, qs[q % qs.size()].data(), 0.0, 3).size();
+        }
+        double legacyUs = elapsedMs(t0) * 1000.0 / queries;
+
+        std::vector<SpeakerMatch> got;
+        t0 = std::chrono::steady_clock::now();
+        for (int q = 0; q < queries; q++) {
+            gallery.bestMatches(qs[q % qs.size()].data(), 0.0, 3, got);
+            sink += got.size();
+        }
+        double galleryUs = elapsedMs(t0) * 1000.0 / queries;
+
+        std::printf("  %4zu speakers  map + cosine %9.2f us   gallery %8.2f us  (%.1fx)\n", n, legacyUs, galleryUs,
+                    galleryUs > 0 ? legacyUs / galleryUs : 0.0);
+        if (sink == 1) std::printf("\n");
+    }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    int queries = 20000;
+    bool checkOnly = false;
+    perf::Args().option("--queries", queries).flag("--check-only", checkOnly).parse(argc, argv);
+
+    int failures = runCheck();
+    if (!checkOnly) runTiming(queries);
+
+    return perf::reportMatch(failures);
+}
@@ -0,0 +1,74 @@
+/**
+ * trace_gen.h — 基准用合成 GPS 轨迹
+ *
+ * 30 天内均匀分布的时间戳，家 / 公司 / 健身房 / 餐厅按权重采样，
+ * 10% 为家与公司之间的通勤散点。固定种子保证各基准输入一致。
+ */
+#pragma once
+
+#include "geo_utils.h"
+#include "spatial_grid.h"
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace bench {
+
+using geo_utils::GeoPoint;
+
+struct Place {
+    double lat;
+    double lng;
+    double weight;
+};
+
+inline std::vector<GeoPoint> makeTrace(size_t n, uint32_t seed) {
+    // 上海附近的几个常去地点
+    const std::vector<Place> places = {
+        {31.2304, 121.4737, 0.45},   // home
+        {31.2397, 121.4998, 0.30},   // work
+        {31.2200, 121.4600, 0.08},   // gym
+        {31.2350, 121.4850, 0.07},   // restaurant
+    };
+    const double commuteRatio = 0.10;
+
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> uni(0.0, 1.0);
+    std::normal_distribution<double> jitter(0.0, 15.0);   // 米
+
+    const int64_t start = 1735660800000LL;                  // 2025-01-01
+    const int64_t span = 30LL * 86400000LL;
+    const double mPerDeg = geo_utils::METERS_PER_DEG_LAT;
+
+    std::vector<GeoPoint> points;
+    points.reserve(n);
+    for (size_t i = 0; i < n; i++) {
+        GeoPoint p;
+        p.timestamp = start + static_cast<int64_t>(span * (static_cast<double>(i) / n));
+        p.accuracy = 10;
+
+        double r = uni(rng);
+        if (r < commuteRatio) {
+            // 通勤路上的散点：家和公司之间随机位置 + 较大抖动
+            double t = uni(rng);
+            p.latitude = places[0].lat + (places[1].lat - places[0].lat) * t + jitter(rng) * 10 / mPerDeg;
+            p.longitude = places[0].lng + (places[1].lng - places[0].lng) * t + jitter(rng) * 10 / mPerDeg;
+        } else {
+            r = (r - commuteRatio) / (1.0 - commuteRatio);
+            const Place* chosen = &places.back();
+            double acc = 0;
+            for (const auto& pl : places) {
+                acc += pl.weight;
+                if (r < acc) { chosen = &pl; break; }
+            }
+            double cosLat = std::cos(geo_utils::toRad(chosen->lat));
+            p.latitude = chosen->lat + jitter(rng) / mPerDeg;
+            p.longitude = chosen->lng + jitter(rng) / (mPerDeg * cosLat);
+        }
+        points.push_back(p);
+    }
+    return points;
+}
+
+}  // namespace bench
@@ -0,0 +1,435 @@
+/**
+ * binary_snapshot.h — 带版本与校验的二进制快照文件
+ *
+ * 文件布局（主机字节序，所有偏移 8 字节对齐）:
+ *   SnapshotHeader | SnapshotSection × sectionCount | 各段数据
+ *
+ * - 头部 CRC 覆盖头部与段表；每段数据有自己的 CRC。标记 SECTION_RECORD_CRC
+ *   的段由记录各自携带 CRC（段表里的 crc 为 0），这样可以只覆盖写改动的记录。
+ * - 读取：一次 mmap，段数据指针 = 映射基址 + 段偏移，定长记录直接按结构体读取。
+ * - 全量写入先写 path.tmp 再 rename，中途失败不会破坏旧文件；
+ *   SnapshotPatcher 在原文件上覆盖写段内字节，之后重新封装段表。
+ */
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace native_common {
+
+// ============================================================
+// 格式定义
+// ============================================================
+
+constexpr char SNAPSHOT_MAGIC[8] = {'N', 'A', 'T', 'S', 'N', 'A', 'P', '\0'};
+constexpr uint32_t SNAPSHOT_VERSION = 1;
+
+/** 段数据不整体校验，由其中的记录各自携带 CRC */
+constexpr uint32_t SECTION_RECORD_CRC = 1u << 0;
+
+/** 四字符段标签，如 snapshotTag("LUCB") */
+constexpr uint32_t snapshotTag(const char (&s)[5]) {
+    return static_cast<uint32_t>(static_cast<uint8_t>(s[0])) |
+           static_cast<uint32_t>(static_cast<uint8_t>(s[1])) << 8 |
+           static_cast<uint32_t>(static_cast<uint8_t>(s[2])) << 16 |
+           static_cast<uint32_t>(static_cast<uint8_t>(s[3])) << 24;
+}
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t sectionCount;
+    uint64_t fileSize;
+    uint32_t headerCrc;       // 头部（此字段置 0）+ 段表
+    uint32_t reserved;
+};
+
+struct SnapshotSection {
+    uint32_t tag;
+    uint32_t version;         // 段内布局版本，由各模块自行解释
+    uint64_t offset;          // 距文件起始
+    uint64_t size;
+    uint32_t crc;             // 段数据 CRC；SECTION_RECORD_CRC 时为 0
+    uint32_t flags;
+};
+
+static_assert(sizeof(SnapshotHeader) == 32, "snapshot header layout");
+static_assert(sizeof(SnapshotSection) == 32, "snapshot section layout");
+
+inline size_t alignSnapshot(size_t n) { return (n + 7) & ~size_t(7); }
+
+// ============================================================
+// CRC-32 (IEEE 802.3)
+// ============================================================
+
+namespace detail {
+
+constexpr std::array<uint32_t, 256> makeCrcTable() {
+    std::array<uint32_t, 256> table{};
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        table[i] = c;
+    }
+    return table;
+}
+
+inline constexpr std::array<uint32_t, 256> CRC_TABLE = makeCrcTable();
+
+}  // namespace detail
+
+/** 可分段累加：crc32(b, nb, crc32(a, na)) == crc32(a+b) */
+inline uint32_t crc32(const void* data, size_t len, uint32_t crc = 0) {
+    const auto* p = static_cast<const uint8_t*>(data);
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++) crc = detail::CRC_TABLE[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+inline uint32_t headerCrc(SnapshotHeader header, const SnapshotSection* sections) {
+    header.headerCrc = 0;
+    uint32_t crc = crc32(&header, sizeof(header));
+    return crc32(sections, sizeof(SnapshotSection) * header.sectionCount, crc);
+}
+
+// ============================================================
+// 段内顺序编码
+// ============================================================
+
+/** 追加写：定长字段按内存表示，字符串为 u32 长度 + 字节 */
+class ByteWriter {
+public:
+    template <class T>
+    void put(const T& value) {
+        const auto* p = reinterpret_cast<const char*>(&value);
+        bytes_.append(p, sizeof(T));
+    }
+
+    void putString(const std::string& s) {
+        put(static_cast<uint32_t>(s.size()));
+        bytes_.append(s);
+    }
+
+    void putBytes(const void* data, size_t len) { bytes_.append(static_cast<const char*>(data), len); }
+
+    /** 补零到 8 字节边界，后续定长记录可按结构体直接读取 */
+    void align() { bytes_.resize(alignSnapshot(bytes_.size()), '\0'); }
+
+    size_t size() const { return bytes_.size(); }
+    std::string& bytes() { return bytes_; }
+    const std::string& bytes() const { return bytes_; }
+
+private:
+    std::string bytes_;
+};
+
+/** ByteWriter 的逆过程，越界时 ok() 变为 false 且之后读到的都是零值 */
+class ByteReader {
+public:
+    ByteReader(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+
+    template <class T>
+    T get() {
+        T value{};
+        if (pos_ + sizeof(T) > size_) {
+            ok_ = false;
+            return value;
+        }
+        std::memcpy(&value, data_ + pos_, sizeof(T));
+        pos_ += sizeof(T);
+        return value;
+    }
+
+    std::string getString() {
+        uint32_t len = get<uint32_t>();
+        if (!ok_ || pos_ + len > size_) {
+            ok_ = false;
+            return {};
+        }
+        std::string s(reinterpret_cast<const char*>(data_ + pos_), len);
+        pos_ += len;
+        return s;
+    }
+
+    bool ok() const { return ok_; }
+    bool atEnd() const { return pos_ == size_; }
+
+private:
+    const uint8_t* data_;
+    size_t size_;
+    size_t pos_ = 0;
+    bool ok_ = true;
+};
+
+// ============================================================
+// 写入
+// ============================================================
+
+/** 收集各段后一次性生成整个文件 */
+class SnapshotWriter {
+public:
+    /** 新增一段，返回其内容缓冲区（引用在下次 addSection 前有效） */
+    ByteWriter& addSection(uint32_t tag, uint32_t version, uint32_t flags = 0) {
+        sections_.push_back({tag, version, flags, ByteWriter()});
+        return sections_.back().data;
+    }
+
+    /** 整个文件的字节 */
+    std::string finish() const {
+        size_t offset = alignSnapshot(sizeof(SnapshotHeader) + sizeof(SnapshotSection) * sections_.size());
+        std::vector<SnapshotSection> table;
+        for (const auto& s : sections_) {
+            SnapshotSection entry{};
+            entry.tag = s.tag;
+            entry.version = s.version;
+            entry.offset = offset;
+            entry.size = s.data.size();
+            entry.flags = s.flags;
+            entry.crc = (s.flags & SECTION_RECORD_CRC) ? 0 : crc32(s.data.bytes().data(), s.data.size());
+            table.push_back(entry);
+            offset = alignSnapshot(offset + s.data.size());
+        }
+
+        SnapshotHeader header{};
+        std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+        header.version = SNAPSHOT_VERSION;
+        header.sectionCount = static_cast<uint32_t>(table.size());
+        header.fileSize = offset;
+        header.headerCrc = headerCrc(header, table.data());
+
+        std::string out(offset, '\0');
+        std::memcpy(&out[0], &header, sizeof(header));
+        if (!table.empty()) std::memcpy(&out[sizeof(header)], table.data(), sizeof(SnapshotSection) * table.size());
+        for (size_t i = 0; i < table.size(); i++) {
+            const auto& bytes = sections_[i].data.bytes();
+            if (!bytes.empty()) std::memcpy(&out[table[i].offset], bytes.data(), bytes.size());
+        }
+        return out;
+    }
+
+    /** 写 path.tmp、fsync 后 rename 到 path；bytesWritten 可选，返回文件大小 */
+    bool writeFile(const std::string& path, size_t* bytesWritten = nullptr) const {
+        std::string bytes = finish();
+        if (bytesWritten != nullptr) *bytesWritten = bytes.size();
+        std::string tmp = path + ".tmp";
+        int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+        if (fd < 0) return false;
+        bool ok = writeAll(fd, bytes.data(), bytes.size()) && ::fsync(fd) == 0;
+        ok = ::close(fd) == 0 && ok;
+        if (ok) ok = ::rename(tmp.c_str(), path.c_str()) == 0;
+        if (!ok) ::unlink(tmp.c_str());
+        return ok;
+    }
+
+private:
+    static bool writeAll(int fd, const char* data, size_t len) {
+        while (len > 0) {
+            ssize_t n = ::write(fd, data, len);
+            if (n <= 0) return false;
+            data += n;
+            len -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    struct Pending {
+        uint32_t tag;
+        uint32_t version;
+        uint32_t flags;
+        ByteWriter data;
+    };
+    std::vector<Pending> sections_;
+};
+
+// ============================================================
+// 读取
+// ============================================================
+
+/** 只读映射整个快照文件；open() 校验头部、段表与整体校验的段 */
+class MappedSnapshot {
+public:
+    MappedSnapshot() = default;
+    MappedSnapshot(const MappedSnapshot&) = delete;
+    MappedSnapshot& operator=(const MappedSnapshot&) = delete;
+    ~MappedSnapshot() { close(); }
+
+    bool open(const std::string& path) {
+        close();
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st {};
+        if (::fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(SnapshotHeader))) {
+            ::close(fd);
+            return false;
+        }
+        void* base = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (base == MAP_FAILED) return false;
+        base_ = static_cast<const uint8_t*>(base);
+        size_ = static_cast<size_t>(st.st_size);
+        if (!validate()) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close() {
+        if (base_ != nullptr) ::munmap(const_cast<uint8_t*>(base_), size_);
+        base_ = nullptr;
+        size_ = 0;
+    }
+
+    /** 按标签查找段，不存在返回 nullptr */
+    const SnapshotSection* find(uint32_t tag) const {
+        for (uint32_t i = 0; i < header().sectionCount; i++) {
+            if (sections()[i].tag == tag) return &sections()[i];
+        }
+        return nullptr;
+    }
+
+    /** 段数据（8 字节对齐） */
+    const uint8_t* data(const SnapshotSection& section) const { return base_ + section.offset; }
+
+    ByteReader reader(const SnapshotSection& section) const {
+        return ByteReader(data(section), static_cast<size_t>(section.size));
+    }
+
+    const SnapshotHeader& header() const { return *reinterpret_cast<const SnapshotHeader*>(base_); }
+    const SnapshotSection* sections() const {
+        return reinterpret_cast<const SnapshotSection*>(base_ + sizeof(SnapshotHeader));
+    }
+
+private:
+    bool validate() const {
+        const SnapshotHeader& h = header();
+        if (std::memcmp(h.magic, SNAPSHOT_MAGIC, sizeof(h.magic)) != 0 || h.version != SNAPSHOT_VERSION) {
+            return false;
+        }
+        if (h.fileSize != size_ ||
+            sizeof(SnapshotHeader) + sizeof(SnapshotSection) * uint64_t(h.sectionCount) > size_) {
+            return false;
+        }
+        if (headerCrc(h, sections()) != h.headerCrc) return false;
+        for (uint32_t i = 0; i < h.sectionCount; i++) {
+            const SnapshotSection& s = sections()[i];
+            if (s.offset % 8 != 0 || s.offset > size_ || s.size > size_ - s.offset) return false;
+            if (!(s.flags & SECTION_RECORD_CRC) && crc32(data(s), static_cast<size_t>(s.size)) != s.crc) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    const uint8_t* base_ = nullptr;
+    size_t size_ = 0;
+};
+
+// ============================================================
+// 原地更新
+// ============================================================
+
+/**
+ * 在已有快照文件上覆盖写段内字节（段大小不变），commit() 重写段表 CRC 并 fdatasync。
+ * 覆盖写到一半掉电时对应段 / 记录的 CRC 对不上，读取方据此判定快照不可用。
+ */
+class SnapshotPatcher {
+public:
+    SnapshotPatcher() = default;
+    SnapshotPatcher(const SnapshotPatcher&) = delete;
+    SnapshotPatcher& operator=(const SnapshotPatcher&) = delete;
+    ~SnapshotPatcher() {
+        if (fd_ >= 0) ::close(fd_);
+    }
+
+    bool open(const std::string& path) {
+        fd_ = ::open(path.c_str(), O_RDWR);
+        if (fd_ < 0) return false;
+        if (!readAll(0, &header_, sizeof(header_)) ||
+            std::memcmp(header_.magic, SNAPSHOT_MAGIC, sizeof(header_.magic)) != 0 ||
+            header_.version != SNAPSHOT_VERSION) {
+            return false;
+        }
+        sections_.resize(header_.sectionCount);
+        return readAll(sizeof(header_), sections_.data(), sizeof(SnapshotSection) * sections_.size()) &&
+               headerCrc(header_, sections_.data()) == header_.headerCrc;
+    }
+
+    const SnapshotSection* find(uint32_t tag) const {
+        for (const auto& s : sections_) {
+            if (s.tag == tag) return &s;
+        }
+        return nullptr;
+    }
+
+    /** 读取段内 [offset, offset + len) */
+    bool read(const SnapshotSection& section, uint64_t offset, void* out, size_t len) const {
+        return offset + len <= section.size && readAll(section.offset + offset, out, len);
+    }
+
+    /** 覆盖写段内 [offset, offset + len) */
+    bool write(const SnapshotSection& section, uint64_t offset, const void* data, size_t len) {
+        if (offset + len > section.size) return false;
+        const auto* p = static_cast<const char*>(data);
+        uint64_t pos = section.offset + offset;
+        while (len > 0) {
+            ssize_t n = ::pwrite(fd_, p, len, static_cast<off_t>(pos));
+            if (n <= 0) return false;
+            p += n;
+            pos += static_cast<uint64_t>(n);
+            len -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    /** 整段重写（大小必须不变），并更新段 CRC */
+    bool rewrite(uint32_t tag, const std::string& bytes) {
+        auto* section = const_cast<SnapshotSection*>(find(tag));
+        if (section == nullptr || section->size != bytes.size()) return false;
+        if (!write(*section, 0, bytes.data(), bytes.size())) return false;
+        if (!(section->flags & SECTION_RECORD_CRC)) section->crc = crc32(bytes.data(), bytes.size());
+        tableDirty_ = true;
+        return true;
+    }
+
+    bool commit() {
+        if (tableDirty_) {
+            header_.headerCrc = headerCrc(header_, sections_.data());
+            if (::pwrite(fd_, sections_.data(), sizeof(SnapshotSection) * sections_.size(), sizeof(header_)) !=
+                    static_cast<ssize_t>(sizeof(SnapshotSection) * sections_.size()) ||
+                ::pwrite(fd_, &header_, sizeof(header_), 0) != static_cast<ssize_t>(sizeof(header_))) {
+                return false;
+            }
+            tableDirty_ = false;
+        }
+        return ::fdatasync(fd_) == 0;
+    }
+
+private:
+    bool readAll(uint64_t pos, void* out, size_t len) const {
+        auto* p = static_cast<char*>(out);
+        while (len > 0) {
+            ssize_t n = ::pread(fd_, p, len, static_cast<off_t>(pos));
+            if (n <= 0) return false;
+            p += n;
+            pos += static_cast<uint64_t>(n);
+            len -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    int fd_ = -1;
+    SnapshotHeader header_{};
+    std::vector<SnapshotSection> sections_;
+    bool tableDirty_ = false;
+};
+
+}  // namespace native_common
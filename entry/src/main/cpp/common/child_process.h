@@ -0,0 +1,326 @@
+/**
+ * child_process.h — posix_spawn 子进程 + 管道事件循环
+ *
+ * spawn() 用 /bin/sh -c 启动命令（stdin 接 /dev/null，stdout / stderr 各一根管道，
+ * 子进程自成一个进程组），run() 在调用线程上 poll 两根管道，按读到的块回调 sink，直到进程退出：
+ *   - 超时：向进程组发 timeoutSignal，killGraceMs 后仍未退出再发 SIGKILL
+ *   - kill(sig) / cancel() 可在任意线程调用；cancel 经唤醒管道通知 run() 立即 SIGKILL 并标记 cancelled
+ *   - shell 退出后读完管道里已有的数据就返回，不等后台子进程关闭管道
+ *   - 内核支持 pidfd 时同时 poll 进程退出事件，否则管道关闭后按递增间隔检查 waitpid
+ *
+ * 不依赖 NAPI；napi_exec.cpp 在 JS 线程（同步 execCmd）或独立工作线程（execAsync）上调用 run()。
+ */
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <fcntl.h>
+#include <poll.h>
+#include <spawn.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+namespace native_common {
+
+// ============================================================
+// 选项与结果
+// ============================================================
+
+enum class OutputStream : uint8_t { STDOUT = 1, STDERR = 2 };
+
+struct SpawnOptions {
+    std::string command;             // 交给 /bin/sh -c
+    std::string cwd;                 // 非空时先 cd 到该目录
+    int64_t timeoutMs = 0;           // 0 = 不限
+    int timeoutSignal = SIGTERM;
+    int64_t killGraceMs = 2000;      // 超时信号发出后仍未退出则 SIGKILL
+    bool mergeStderr = false;        // stderr 并入 stdout（等价 2>&1）
+};
+
+struct ExitStatus {
+    int exitCode = -1;       // 正常退出时的退出码；被信号终止或未启动为 -1
+    int signal = 0;          // 终止进程的信号，0 = 正常退出
+    bool timedOut = false;
+    bool cancelled = false;
+    int64_t durationMs = 0;
+};
+
+// ============================================================
+// 子进程
+// ============================================================
+
+class ChildProcess {
+public:
+    using ChunkSink = std::function<void(OutputStream stream, const char* data, size_t len)>;
+
+    static constexpr size_t READ_CHUNK = 16 * 1024;
+    static constexpr int TICK_MS = 100;              // 管道未关闭也定期检查进程是否已退出
+    static constexpr int MAX_READS_PER_WAKE = 8;     // 每轮每根管道最多读几块，避免一路饿死另一路
+    static constexpr int MAX_FINAL_READS = 64;       // 退出后收尾读取的上限，后台子进程持续写时也能返回
+
+    ChildProcess() = default;
+    ChildProcess(const ChildProcess&) = delete;
+    ChildProcess& operator=(const ChildProcess&) = delete;
+
+    ~ChildProcess() {
+        if (pid_ > 0 && !reaped_) {
+            ::kill(-pid_, SIGKILL);
+            int status = 0;
+            while (::waitpid(pid_, &status, 0) < 0 && errno == EINTR) {}
+        }
+        closeFd(outFd_);
+        closeFd(errFd_);
+        closeFd(pidFd_);
+        closeFd(wake_[0]);
+        closeFd(wake_[1]);
+    }
+
+    /**
+     * 启动子进程
+     * @return 管道创建或 posix_spawn 失败时返回 false，原因写入 error
+     */
+    bool spawn(const SpawnOptions& options, std::string* error = nullptr) {
+        if (pid_ > 0) return fail(error, "process already spawned");
+        options_ = options;
+
+        int out[2] = {-1, -1};
+        int err[2] = {-1, -1};
+        if (!makePipe(out) || (!options.mergeStderr && !makePipe(err)) || !makePipe(wake_)) {
+            std::string reason = std::string("pipe: ") + std::strerror(errno);
+            for (int* fd : {&out[0], &out[1], &err[0], &err[1], &wake_[0], &wake_[1]}) closeFd(*fd);
+            return fail(error, reason);
+        }
+
+        posix_spawn_file_actions_t actions;
+        posix_spawn_file_actions_init(&actions);
+        posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+        posix_spawn_file_actions_adddup2(&actions, out[1], STDOUT_FILENO);
+        posix_spawn_file_actions_adddup2(&actions, options.mergeStderr ? out[1] : err[1], STDERR_FILENO);
+
+        // 独立进程组便于整组终止；信号掩码清空、SIGPIPE 恢复默认（宿主进程通常忽略 SIGPIPE）
+        posix_spawnattr_t attr;
+        posix_spawnattr_init(&attr);
+        sigset_t mask;
+        sigemptyset(&mask);
+        posix_spawnattr_setsigmask(&attr, &mask);
+        sigset_t defaults;
+        sigemptyset(&defaults);
+        sigaddset(&defaults, SIGPIPE);
+        posix_spawnattr_setsigdefault(&attr, &defaults);
+        posix_spawnattr_setpgroup(&attr, 0);
+        posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP | POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF);
+
+        std::string script = options.cwd.empty() ? options.command
+                                                 : "cd " + shellQuote(options.cwd) + " && " + options.command;
+        const char* argv[] = {"/bin/sh", "-c", script.c_str(), nullptr};
+        pid_t pid = 0;
+        int rc = ::posix_spawn(&pid, "/bin/sh", &actions, &attr, const_cast<char* const*>(argv), environ);
+        posix_spawn_file_actions_destroy(&actions);
+        posix_spawnattr_destroy(&attr);
+        closeFd(out[1]);
+        closeFd(err[1]);
+
+        if (rc != 0) {
+            closeFd(out[0]);
+            closeFd(err[0]);
+            closeFd(wake_[0]);
+            closeFd(wake_[1]);
+            return fail(error, std::string("posix_spawn: ") + std::strerror(rc));
+        }
+
+        outFd_ = out[0];
+        errFd_ = err[0];
+        setNonBlocking(outFd_);
+        setNonBlocking(errFd_);
+        setNonBlocking(wake_[0]);
+        setNonBlocking(wake_[1]);
+#ifdef SYS_pidfd_open
+        pidFd_ = static_cast<int>(::syscall(SYS_pidfd_open, pid, 0));
+#endif
+        startMs_ = nowMs();
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            pid_ = pid;
+        }
+        return true;
+    }
+
+    /**
+     * 事件循环：读管道、处理超时 / 取消，直到进程退出
+     * sink 在调用 run() 的线程上被调用
+     */
+    ExitStatus run(const ChunkSink& sink) {
+        ExitStatus status;
+        if (pid_ <= 0) return status;
+
+        int64_t deadline = options_.timeoutMs > 0 ? startMs_ + options_.timeoutMs : -1;
+        int64_t killAt = -1;
+        int64_t idleTick = 0;   // 管道都已关闭后进程通常马上退出：先不等待再查一次，之后从 1 ms 起倍增
+        int waitStatus = 0;
+        for (;;) {
+            pollfd fds[4];
+            nfds_t n = 0;
+            if (outFd_ >= 0) fds[n++] = {outFd_, POLLIN, 0};
+            if (errFd_ >= 0) fds[n++] = {errFd_, POLLIN, 0};
+            if (pidFd_ >= 0) fds[n++] = {pidFd_, POLLIN, 0};
+            fds[n++] = {wake_[0], POLLIN, 0};
+
+            int64_t t = nowMs();
+            int64_t waitMs = TICK_MS;
+            if (pidFd_ < 0 && outFd_ < 0 && errFd_ < 0) {
+                waitMs = idleTick;
+                idleTick = std::min<int64_t>(std::max<int64_t>(idleTick * 2, 1), TICK_MS);
+            }
+            if (deadline >= 0 && !status.timedOut) waitMs = std::min(waitMs, deadline - t);
+            if (killAt >= 0) waitMs = std::min(waitMs, killAt - t);
+            ::poll(fds, n, static_cast<int>(std::max<int64_t>(waitMs, 0)));
+
+            readAvailable(outFd_, OutputStream::STDOUT, sink, MAX_READS_PER_WAKE);
+            readAvailable(errFd_, OutputStream::STDERR, sink, MAX_READS_PER_WAKE);
+            drainWake();
+
+            t = nowMs();
+            if (cancelRequested_.load(std::memory_order_acquire) && !status.cancelled) {
+                status.cancelled = true;
+                kill(SIGKILL);
+            }
+            if (deadline >= 0 && !status.timedOut && t >= deadline) {
+                status.timedOut = true;
+                kill(options_.timeoutSignal);
+                killAt = t + std::max<int64_t>(options_.killGraceMs, 0);
+            }
+            if (killAt >= 0 && t >= killAt) {
+                kill(SIGKILL);
+                killAt = -1;
+            }
+            if (reap(&waitStatus)) break;
+        }
+
+        // 进程已退出：读完管道中剩余的数据
+        readAvailable(outFd_, OutputStream::STDOUT, sink, MAX_FINAL_READS);
+        readAvailable(errFd_, OutputStream::STDERR, sink, MAX_FINAL_READS);
+        closeFd(outFd_);
+        closeFd(errFd_);
+        closeFd(pidFd_);
+
+        if (WIFEXITED(waitStatus)) {
+            status.exitCode = WEXITSTATUS(waitStatus);
+        } else if (WIFSIGNALED(waitStatus)) {
+            status.signal = WTERMSIG(waitStatus);
+        }
+        status.durationMs = nowMs() - startMs_;
+        return status;
+    }
+
+    /**
+     * 向进程组发送信号（任意线程）
+     * @return 进程尚未退出且信号已发出
+     */
+    bool kill(int sig = SIGTERM) {
+        std::lock_guard<std::mutex> lock(mu_);
+        if (pid_ <= 0 || reaped_) return false;
+        return ::kill(-pid_, sig) == 0;
+    }
+
+    /** 取消（任意线程）：run() 尽快 SIGKILL 进程组，结果标记 cancelled */
+    void cancel() {
+        cancelRequested_.store(true, std::memory_order_release);
+        if (wake_[1] >= 0) {
+            char b = 1;
+            ssize_t ignored = ::write(wake_[1], &b, 1);
+            (void)ignored;
+        }
+    }
+
+    pid_t pid() const { return pid_; }
+
+private:
+    SpawnOptions options_;
+    std::mutex mu_;            // 保护 pid_ / reaped_，回收后不再向可能被复用的 pid 发信号
+    pid_t pid_ = -1;
+    bool reaped_ = false;
+    int outFd_ = -1;
+    int errFd_ = -1;
+    int pidFd_ = -1;           // 进程退出时可读；内核不支持时为 -1
+    int wake_[2] = {-1, -1};
+    std::atomic<bool> cancelRequested_{false};
+    int64_t startMs_ = 0;
+
+    static int64_t nowMs() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    static bool fail(std::string* error, const std::string& message) {
+        if (error != nullptr) *error = message;
+        return false;
+    }
+
+    static bool makePipe(int fds[2]) { return ::pipe2(fds, O_CLOEXEC) == 0; }
+
+    static void setNonBlocking(int fd) {
+        if (fd < 0) return;
+        int flags = ::fcntl(fd, F_GETFL);
+        if (flags >= 0) ::fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+    }
+
+    static void closeFd(int& fd) {
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+    }
+
+    static std::string shellQuote(const std::string& s) {
+        std::string out = "'";
+        for (char c : s) {
+            if (c == '\'') {
+                out += "'\\''";
+            } else {
+                out += c;
+            }
+        }
+        out += "'";
+        return out;
+    }
+
+    /** 非阻塞读到 EAGAIN / EOF，最多 maxReads 块；EOF 时关闭 fd */
+    static void readAvailable(int& fd, OutputStream stream, const ChunkSink& sink, int maxReads) {
+        char buf[READ_CHUNK];
+        for (int i = 0; fd >= 0 && i < maxReads; i++) {
+            ssize_t n = ::read(fd, buf, sizeof(buf));
+            if (n > 0) {
+                if (sink) sink(stream, buf, static_cast<size_t>(n));
+                continue;
+            }
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+            closeFd(fd);
+        }
+    }
+
+    void drainWake() {
+        char buf[64];
+        while (::read(wake_[0], buf, sizeof(buf)) > 0) {}
+    }
+
+    bool reap(int* waitStatus) {
+        std::lock_guard<std::mutex> lock(mu_);
+        if (reaped_) return true;
+        pid_t r = ::waitpid(pid_, waitStatus, WNOHANG);
+        if (r == pid_ || (r < 0 && errno == ECHILD)) reaped_ = true;
+        return reaped_;
+    }
+};
+
+}  // namespace native_common
@@ -0,0 +1,524 @@
+/**
+ * json.cpp — common/json.h 的实现
+ *
+ * 递归下降，一遍生成节点带；容器节点在子树解析完后回填 end / count，
+ * 因此 Value 的遍历、size() 与跳过子树都是 O(1) 步进。
+ */
+#include "json.h"
+#include "metrics.h"
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+namespace native_common {
+namespace json {
+
+namespace {
+
+constexpr int MAX_DEPTH = 256;
+
+bool isSpace(char c) { return c == ' ' || c == '\n' || c == '\r' || c == '\t'; }
+
+int hexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+void appendUtf8(std::string& out, uint32_t cp) {
+    if (cp < 0x80) {
+        out += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+        out += static_cast<char>(0xC0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += static_cast<char>(0xE0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+}
+
+}  // namespace
+
+// ============================================================
+// Parser
+// ============================================================
+
+class Document::Parser {
+public:
+    Parser(Document& doc, std::string_view text) : doc_(doc), p_(text.data()), begin_(text.data()),
+                                                   end_(text.data() + text.size()) {}
+
+    bool run() {
+        skipSpace();
+        if (!parseValue(0)) return false;
+        skipSpace();
+        if (p_ != end_) return fail();
+        return true;
+    }
+
+    size_t offset() const { return static_cast<size_t>(p_ - begin_); }
+
+private:
+    bool fail() { return false; }
+
+    void skipSpace() {
+        while (p_ < end_ && isSpace(*p_)) p_++;
+    }
+
+    uint32_t push(Type type, const char* start) {
+        uint32_t index = static_cast<uint32_t>(doc_.nodes_.size());
+        doc_.nodes_.push_back({type, index + 1, 0, std::string_view(start, 0), 0.0});
+        return index;
+    }
+
+    void close(uint32_t index, const char* start, uint32_t count) {
+        Node& n = doc_.nodes_[index];
+        n.end = static_cast<uint32_t>(doc_.nodes_.size());
+        n.count = count;
+        n.text = std::string_view(start, static_cast<size_t>(p_ - start));
+    }
+
+    bool parseValue(int depth) {
+        if (p_ >= end_) return fail();
+        switch (*p_) {
+            case '{': return parseObject(depth);
+            case '[': return parseArray(depth);
+            case '"': {
+                uint32_t index = push(Type::String, p_);
+                return parseString(doc_.nodes_[index].text);
+            }
+            case 't': return parseLiteral("true", Type::True);
+            case 'f': return parseLiteral("false", Type::False);
+            case 'n': return parseLiteral("null", Type::Null);
+            default: return parseNumber();
+        }
+    }
+
+    bool parseLiteral(const char* word, Type type) {
+        size_t len = std::strlen(word);
+        if (static_cast<size_t>(end_ - p_) < len || std::memcmp(p_, word, len) != 0) return fail();
+        uint32_t index = push(type, p_);
+        p_ += len;
+        doc_.nodes_[index].text = std::string_view(p_ - len, len);
+        return true;
+    }
+
+    bool parseObject(int depth) {
+        if (depth >= MAX_DEPTH) return fail();
+        const char* start = p_;
+        uint32_t index = push(Type::Object, p_);
+        p_++;
+        skipSpace();
+        uint32_t count = 0;
+        if (p_ < end_ && *p_ == '}') {
+            p_++;
+            close(index, start, 0);
+            return true;
+        }
+        while (true) {
+            if (p_ >= end_ || *p_ != '"') return fail();
+            uint32_t keyIndex = push(Type::String, p_);
+            if (!parseString(doc_.nodes_[keyIndex].text)) return false;
+            skipSpace();
+            if (p_ >= end_ || *p_ != ':') return fail();
+            p_++;
+            skipSpace();
+            if (!parseValue(depth + 1)) return false;
+            count++;
+            skipSpace();
+            if (p_ >= end_) return fail();
+            if (*p_ == ',') {
+                p_++;
+                skipSpace();
+                continue;
+            }
+            if (*p_ != '}') return fail();
+            p_++;
+            close(index, start, count);
+            return true;
+        }
+    }
+
+    bool parseArray(int depth) {
+        if (depth >= MAX_DEPTH) return fail();
+        const char* start = p_;
+        uint32_t index = push(Type::Array, p_);
+        p_++;
+        skipSpace();
+        uint32_t count = 0;
+        if (p_ < end_ && *p_ == ']') {
+            p_++;
+            close(index, start, 0);
+            return true;
+        }
+        while (true) {
+            if (!parseValue(depth + 1)) return false;
+            count++;
+            skipSpace();
+            if (p_ >= end_) return fail();
+            if (*p_ == ',') {
+                p_++;
+                skipSpace();
+                continue;
+            }
+            if (*p_ != ']') return fail();
+            p_++;
+            close(index, start, count);
+            return true;
+        }
+    }
+
+    /** p_ at the opening quote; out = contents (view into the input unless escaped) */
+    bool parseString(std::string_view& out) {
+        const char* start = ++p_;
+        while (p_ < end_ && *p_ != '"' && *p_ != '\\' && static_cast<unsigned char>(*p_) >= 0x20) p_++;
+        if (p_ >= end_ || static_cast<unsigned char>(*p_) < 0x20) return fail();
+        if (*p_ == '"') {
+            out = std::string_view(start, static_cast<size_t>(p_ - start));
+            p_++;
+            return true;
+        }
+
+        // Escapes: decode into the document buffer (reserved up front, never reallocates)
+        std::string& buf = doc_.decoded_;
+        size_t from = buf.size();
+        buf.append(start, static_cast<size_t>(p_ - start));
+        while (p_ < end_ && *p_ != '"') {
+            if (*p_ != '\\') {
+                if (static_cast<unsigned char>(*p_) < 0x20) return fail();
+                buf += *p_++;
+                continue;
+            }
+            if (++p_ >= end_) return fail();
+            char c = *p_++;
+            switch (c) {
+                case '"': buf += '"'; break;
+                case '\\': buf += '\\'; break;
+                case '/': buf += '/'; break;
+                case 'b': buf += '\b'; break;
+                case 'f': buf += '\f'; break;
+                case 'n': buf += '\n'; break;
+                case 'r': buf += '\r'; break;
+                case 't': buf += '\t'; break;
+                case 'u': {
+                    uint32_t cp = 0;
+                    if (!parseHex4(cp)) return fail();
+                    if (cp >= 0xDC00 && cp < 0xE000) return fail();
+                    if (cp >= 0xD800 && cp < 0xDC00) {
+                        // High surrogate must be followed by an escaped low surrogate
+                        uint32_t low = 0;
+                        if (end_ - p_ < 6 || p_[0] != '\\' || p_[1] != 'u') return fail();
+                        p_ += 2;
+                        if (!parseHex4(low) || low < 0xDC00 || low >= 0xE000) return fail();
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    }
+                    appendUtf8(buf, cp);
+                    break;
+                }
+                default: return fail();
+            }
+        }
+        if (p_ >= end_) return fail();
+        p_++;
+        out = std::string_view(buf.data() + from, buf.size() - from);
+        return true;
+    }
+
+    bool parseHex4(uint32_t& out) {
+        if (end_ - p_ < 4) return false;
+        out = 0;
+        for (int i = 0; i < 4; i++) {
+            int d = hexDigit(p_[i]);
+            if (d < 0) return false;
+            out = out * 16 + static_cast<uint32_t>(d);
+        }
+        p_ += 4;
+        return true;
+    }
+
+    bool parseNumber() {
+        const char* start = p_;
+        bool negative = false;
+        if (p_ < end_ && *p_ == '-') {
+            negative = true;
+            p_++;
+        }
+        const char* digits = p_;
+        uint64_t mantissa = 0;
+        while (p_ < end_ && *p_ >= '0' && *p_ <= '9') {
+            mantissa = mantissa * 10 + static_cast<uint64_t>(*p_ - '0');
+            p_++;
+        }
+        size_t intDigits = static_cast<size_t>(p_ - digits);
+        if (intDigits == 0 || (intDigits > 1 && *digits == '0')) return fail();
+        bool simple = intDigits <= 15;
+        if (p_ < end_ && *p_ == '.') {
+            simple = false;
+            p_++;
+            const char* frac = p_;
+            while (p_ < end_ && *p_ >= '0' && *p_ <= '9') p_++;
+            if (p_ == frac) return fail();
+        }
+        if (p_ < end_ && (*p_ == 'e' || *p_ == 'E')) {
+            simple = false;
+            p_++;
+            if (p_ < end_ && (*p_ == '+' || *p_ == '-')) p_++;
+            const char* exp = p_;
+            while (p_ < end_ && *p_ >= '0' && *p_ <= '9') p_++;
+            if (p_ == exp) return fail();
+        }
+
+        uint32_t index = push(Type::Number, start);
+        Node& n = doc_.nodes_[index];
+        n.text = std::string_view(start, static_cast<size_t>(p_ - start));
+        if (simple) {
+            n.number = negative ? -static_cast<double>(mantissa) : static_cast<double>(mantissa);
+            return true;
+        }
+        // General case: strtod on a NUL-terminated copy (numbers are short)
+        char local[64];
+        if (n.text.size() < sizeof(local)) {
+            std::memcpy(local, n.text.data(), n.text.size());
+            local[n.text.size()] = '\0';
+            n.number = std::strtod(local, nullptr);
+        } else {
+            n.number = std::strtod(std::string(n.text).c_str(), nullptr);
+        }
+        return true;
+    }
+
+    Document& doc_;
+    const char* p_;
+    const char* begin_;
+    const char* end_;
+};
+
+bool Document::parse(std::string_view text) {
+    NATIVE_METRICS_SCOPE("json.parse");
+    NATIVE_METRICS_COUNT("json.parse_bytes", text.size());
+    size_t capacityBefore = nodes_.capacity() + decoded_.capacity();
+    nodes_.clear();
+    decoded_.clear();
+    decoded_.reserve(text.size());
+    errorOffset_ = 0;
+    Parser parser(*this, text);
+    bool ok = parser.run();
+    // A reused document only allocates when an input outgrows everything it has seen
+    if (nodes_.capacity() + decoded_.capacity() != capacityBefore) NATIVE_METRICS_COUNT("json.buffer_growths", 1);
+    if (ok) return true;
+    NATIVE_METRICS_COUNT("json.parse_errors", 1);
+    errorOffset_ = parser.offset();
+    nodes_.clear();
+    return false;
+}
+
+// ============================================================
+// Value
+// ============================================================
+
+Type Value::type() const { return doc_ ? doc_->node(index_).type : Type::Missing; }
+
+std::string_view Value::str(std::string_view def) const {
+    return type() == Type::String ? doc_->node(index_).text : def;
+}
+
+std::string_view Value::text() const { return doc_ ? doc_->node(index_).text : std::string_view(); }
+
+double Value::num(double def) const { return type() == Type::Number ? doc_->node(index_).number : def; }
+
+int64_t Value::int64(int64_t def) const {
+    if (type() != Type::Number) return def;
+    // Integer literals are read exactly (beyond 2^53 a double would round them)
+    std::string_view t = doc_->node(index_).text;
+    int64_t v = 0;
+    auto res = std::from_chars(t.data(), t.data() + t.size(), v);
+    if (res.ec == std::errc() && res.ptr == t.data() + t.size()) return v;
+    return static_cast<int64_t>(doc_->node(index_).number);
+}
+
+bool Value::boolean(bool def) const {
+    Type t = type();
+    if (t == Type::True) return true;
+    if (t == Type::False) return false;
+    return def;
+}
+
+size_t Value::size() const {
+    Type t = type();
+    return t == Type::Array || t == Type::Object ? doc_->node(index_).count : 0;
+}
+
+Value Value::operator[](std::string_view key) const {
+    if (type() != Type::Object) return Value();
+    for (auto [k, v] : members()) {
+        if (k == key) return v;
+    }
+    return Value();
+}
+
+Value Value::at(size_t i) const {
+    if (type() != Type::Array || i >= doc_->node(index_).count) return Value();
+    uint32_t index = index_ + 1;
+    for (size_t k = 0; k < i; k++) index = doc_->node(index).end;
+    return Value(doc_, index);
+}
+
+Value::ArrayRange Value::elements() const {
+    if (type() != Type::Array) return {doc_, 0, 0};
+    return {doc_, index_ + 1, doc_->node(index_).end};
+}
+
+Value::MemberRange Value::members() const {
+    if (type() != Type::Object) return {doc_, 0, 0};
+    return {doc_, index_ + 1, doc_->node(index_).end};
+}
+
+Value::ArrayIterator Value::ArrayRange::begin() const { return ArrayIterator(doc, first); }
+Value::ArrayIterator Value::ArrayRange::end() const { return ArrayIterator(doc, last); }
+Value::MemberIterator Value::MemberRange::begin() const { return MemberIterator(doc, first); }
+Value::MemberIterator Value::MemberRange::end() const { return MemberIterator(doc, last); }
+
+Value::ArrayIterator& Value::ArrayIterator::operator++() {
+    index_ = doc_->node(index_).end;
+    return *this;
+}
+
+std::pair<std::string_view, Value> Value::MemberIterator::operator*() const {
+    return {doc_->node(index_).text, Value(doc_, index_ + 1)};
+}
+
+Value::MemberIterator& Value::MemberIterator::operator++() {
+    index_ = doc_->node(index_ + 1).end;
+    return *this;
+}
+
+// ============================================================
+// Writer
+// ============================================================
+
+void Writer::separate() {
+    if (afterKey_) {
+        afterKey_ = false;
+        return;
+    }
+    uint64_t bit = uint64_t(1) << depth_;
+    if (firstMask_ & bit) {
+        firstMask_ &= ~bit;
+    } else {
+        out_ += ',';
+    }
+}
+
+void Writer::beginObject() {
+    separate();
+    out_ += '{';
+    depth_++;
+    firstMask_ |= uint64_t(1) << depth_;
+}
+
+void Writer::endObject() {
+    depth_--;
+    out_ += '}';
+}
+
+void Writer::beginArray() {
+    separate();
+    out_ += '[';
+    depth_++;
+    firstMask_ |= uint64_t(1) << depth_;
+}
+
+void Writer::endArray() {
+    depth_--;
+    out_ += ']';
+}
+
+void Writer::key(std::string_view k) {
+    separate();
+    appendEscaped(k);
+    out_ += ':';
+    afterKey_ = true;
+}
+
+void Writer::string(std::string_view s) {
+    separate();
+    appendEscaped(s);
+}
+
+void Writer::number(double v) {
+    if (!std::isfinite(v)) {
+        null();
+        return;
+    }
+    if (v == std::floor(v) && std::fabs(v) < 1e15) {
+        integer(static_cast<int64_t>(v));
+        return;
+    }
+    separate();
+    char buf[32];
+    // 默认取能唯一还原该 double 的最短十进制（无 snprintf 的格式解析与 locale 开销）
+    auto res = precision_ > 0
+                   ? std::to_chars(buf, buf + sizeof(buf), v, std::chars_format::general, precision_)
+                   : std::to_chars(buf, buf + sizeof(buf), v);
+    out_.append(buf, static_cast<size_t>(res.ptr - buf));
+}
+
+void Writer::integer(int64_t v) {
+    separate();
+    char buf[24];
+    auto res = std::to_chars(buf, buf + sizeof(buf), v);
+    out_.append(buf, static_cast<size_t>(res.ptr - buf));
+}
+
+void Writer::boolean(bool v) {
+    separate();
+    out_ += v ? "true" : "false";
+}
+
+void Writer::null() {
+    separate();
+    out_ += "null";
+}
+
+void Writer::raw(std::string_view json) {
+    separate();
+    out_ += json;
+}
+
+void Writer::appendEscaped(std::string_view s) {
+    static const char HEX[] = "0123456789abcdef";
+    out_ += '"';
+    size_t run = 0;
+    for (size_t i = 0; i < s.size(); i++) {
+        auto c = static_cast<unsigned char>(s[i]);
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+        out_.append(s.data() + run, i - run);
+        run = i + 1;
+        switch (c) {
+            case '"': out_ += "\\\""; break;
+            case '\\': out_ += "\\\\"; break;
+            case '\n': out_ += "\\n"; break;
+            case '\r': out_ += "\\r"; break;
+            case '\t': out_ += "\\t"; break;
+            case '\b': out_ += "\\b"; break;
+            case '\f': out_ += "\\f"; break;
+            default: {
+                char esc[6] = {'\\', 'u', '0', '0', HEX[c >> 4], HEX[c & 0xF]};
+                out_.append(esc, sizeof(esc));
+            }
+        }
+    }
+    out_.append(s.data() + run, s.size() - run);
+    out_ += '"';
+}
+
+}  // namespace json
+}  // namespace native_common
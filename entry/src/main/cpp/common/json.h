@@ -0,0 +1,201 @@
+/**
+ * json.h — 各 NAPI 模块共用的 JSON 解析 / 序列化
+ *
+ * 解析：Document::parse 一遍扫描输入，生成扁平的节点带（tape），
+ * 字符串与数字以 string_view 指向原输入，只有含转义的字符串才解码到文档自己的缓冲区。
+ * 输入必须在 Document 使用期间保持有效。Document 可反复 parse，节点带与缓冲区复用，
+ * 热路径上用 thread_local 文档即可不再分配。
+ *
+ * 序列化：Writer 追加到调用方提供的 std::string（可复用），自动处理逗号与字符串转义。
+ *
+ * 不依赖 NAPI，核心库与 host 端 bench 可直接使用。
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace native_common {
+namespace json {
+
+enum class Type : uint8_t { Missing, Null, False, True, Number, String, Array, Object };
+
+class Document;
+
+/**
+ * 文档中一个节点的轻量句柄（文档指针 + 下标），可按值传递。
+ * 取不存在的成员 / 越界元素得到 Missing 节点，对它的所有读取都返回默认值。
+ */
+class Value {
+public:
+    Value() = default;
+
+    Type type() const;
+    bool exists() const { return type() != Type::Missing; }
+    bool isNull() const { return type() == Type::Null; }
+    bool isBool() const { return type() == Type::True || type() == Type::False; }
+    bool isNumber() const { return type() == Type::Number; }
+    bool isString() const { return type() == Type::String; }
+    bool isArray() const { return type() == Type::Array; }
+    bool isObject() const { return type() == Type::Object; }
+
+    /** 字符串内容（已解码），非字符串返回 def */
+    std::string_view str(std::string_view def = {}) const;
+
+    /** 字符串返回内容，其他标量返回其 JSON 原文（如 42、true），对象 / 数组返回原文 */
+    std::string_view text() const;
+
+    double num(double def = 0.0) const;
+    int64_t int64(int64_t def = 0) const;
+    bool boolean(bool def = false) const;
+
+    /** 数组元素个数 / 对象成员个数 */
+    size_t size() const;
+
+    /** 对象成员（线性查找，对象一般只有几个字段），没有则 Missing */
+    Value operator[](std::string_view key) const;
+
+    /** 数组第 i 个元素，越界则 Missing */
+    Value at(size_t i) const;
+
+    /** 遍历数组元素 */
+    class ArrayIterator;
+    struct ArrayRange {
+        const Document* doc;
+        uint32_t first;
+        uint32_t last;
+        ArrayIterator begin() const;
+        ArrayIterator end() const;
+    };
+    ArrayRange elements() const;
+
+    /** 遍历对象成员 (key, value) */
+    class MemberIterator;
+    struct MemberRange {
+        const Document* doc;
+        uint32_t first;
+        uint32_t last;
+        MemberIterator begin() const;
+        MemberIterator end() const;
+    };
+    MemberRange members() const;
+
+private:
+    friend class Document;
+    Value(const Document* doc, uint32_t index) : doc_(doc), index_(index) {}
+
+    const Document* doc_ = nullptr;
+    uint32_t index_ = 0;
+};
+
+class Document {
+public:
+    /**
+     * 解析 text（须在文档使用期间有效）。
+     * @return 语法错误时返回 false，errorOffset() 为出错位置，root() 为 Missing
+     */
+    bool parse(std::string_view text);
+
+    Value root() const { return nodes_.empty() ? Value() : Value(this, 0); }
+    size_t errorOffset() const { return errorOffset_; }
+
+private:
+    friend class Value;
+
+    struct Node {
+        Type type;
+        uint32_t end;              // 容器：子树之后的第一个节点下标；标量：自身 + 1
+        uint32_t count;            // 容器的元素 / 成员个数
+        std::string_view text;     // 字符串：解码后内容；其他：JSON 原文
+        double number;
+    };
+
+    const Node& node(uint32_t i) const { return nodes_[i]; }
+
+    std::vector<Node> nodes_;
+    std::string decoded_;          // 含转义字符串的解码结果，容量按输入预留，不会重新分配
+    size_t errorOffset_ = 0;
+
+    class Parser;
+};
+
+class Value::ArrayIterator {
+public:
+    ArrayIterator(const Document* doc, uint32_t index) : doc_(doc), index_(index) {}
+    Value operator*() const { return Value(doc_, index_); }
+    ArrayIterator& operator++();
+    bool operator!=(const ArrayIterator& o) const { return index_ != o.index_; }
+
+private:
+    const Document* doc_;
+    uint32_t index_;
+};
+
+class Value::MemberIterator {
+public:
+    MemberIterator(const Document* doc, uint32_t index) : doc_(doc), index_(index) {}
+    std::pair<std::string_view, Value> operator*() const;
+    MemberIterator& operator++();
+    bool operator!=(const MemberIterator& o) const { return index_ != o.index_; }
+
+private:
+    const Document* doc_;
+    uint32_t index_;           // key node; its value is index_ + 1
+};
+
+// ============================================================
+// Writer
+// ============================================================
+
+/**
+ * 追加式 JSON 输出。对象内先 key() 再写值；逗号由嵌套栈自动插入。
+ *   std::string out;  Writer w(out);
+ *   w.beginObject(); w.key("id"); w.string(id); w.endObject();
+ */
+class Writer {
+public:
+    explicit Writer(std::string& out) : out_(out) {}
+
+    /** 浮点有效位数；默认 0 = 最短且能精确还原的表示 */
+    void setPrecision(int digits) { precision_ = digits; }
+
+    void beginObject();
+    void endObject();
+    void beginArray();
+    void endArray();
+    void key(std::string_view k);
+
+    void string(std::string_view s);
+    void number(double v);
+    void integer(int64_t v);
+    void boolean(bool v);
+    void null();
+
+    /** 已经是合法 JSON 的片段，原样写入 */
+    void raw(std::string_view json);
+
+    /** key + 值的简写 */
+    void member(std::string_view k, std::string_view v) { key(k); string(v); }
+    void member(std::string_view k, const char* v) { key(k); string(v); }
+    void member(std::string_view k, double v) { key(k); number(v); }
+    void member(std::string_view k, int64_t v) { key(k); integer(v); }
+    void member(std::string_view k, int v) { key(k); integer(v); }
+    void member(std::string_view k, uint64_t v) { key(k); integer(static_cast<int64_t>(v)); }
+    void member(std::string_view k, bool v) { key(k); boolean(v); }
+
+private:
+    void separate();
+    void appendEscaped(std::string_view s);
+
+    std::string& out_;
+    uint64_t firstMask_ = 1;   // bit d: next value at depth d is the first (no comma); depth ≤ 63
+    uint32_t depth_ = 0;
+    bool afterKey_ = false;
+    int precision_ = 0;
+};
+
+}  // namespace json
+}  // namespace native_common
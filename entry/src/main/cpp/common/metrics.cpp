@@ -0,0 +1,343 @@
+/**
+ * metrics.cpp — common/metrics.h 的实现
+ *
+ * 注册表只在注册名字、线程领取 / 交还分片、snapshot / reset 时加锁；
+ * record / add 只访问当前线程的分片。注册表与分片故意不析构（进程退出时
+ * 其他线程的 thread_local 析构仍可能交还分片）。
+ */
+#include "metrics.h"
+#include <algorithm>
+#include <atomic>
+#include <cinttypes>
+#include <cstring>
+#include <memory>
+
+#if defined(NATIVE_METRICS_OHOS)
+#include <hilog/log.h>
+#include <hitrace/trace.h>
+#endif
+
+namespace native_common {
+namespace metrics {
+
+namespace {
+
+constexpr const char* OVERFLOW_NAME = "metrics.overflow";
+
+/** 单写者累加：只有分片的属主线程写，读者 relaxed 读到的是某个已完成的值 */
+inline void bump(std::atomic<uint64_t>& cell, uint64_t n) {
+    cell.store(cell.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+struct HistogramCells {
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> sum{0};
+    std::atomic<uint64_t> max{0};
+    std::atomic<uint64_t> buckets[BUCKETS] = {};
+};
+
+struct Shard {
+    std::atomic<HistogramCells*> histograms[MAX_HISTOGRAMS] = {};
+    std::atomic<uint64_t> counters[MAX_COUNTERS] = {};
+};
+
+struct Gauge {
+    std::atomic<int64_t> value{0};
+    std::atomic<int64_t> max{INT64_MIN};
+    std::atomic<uint64_t> updates{0};
+};
+
+/** reset() 时的累计值；直方图按需展开 */
+struct Baseline {
+    std::vector<std::unique_ptr<HistogramSnapshot>> histograms;
+    std::array<uint64_t, MAX_COUNTERS> counters{};
+    std::array<uint64_t, MAX_GAUGES> gaugeUpdates{};
+};
+
+class Registry {
+public:
+    Registry() { baseline_.histograms.resize(MAX_HISTOGRAMS); }
+
+    MetricId registerName(const char* name, const char** names, std::atomic<size_t>& used, size_t capacity) {
+        std::lock_guard<std::mutex> lock(mu_);
+        size_t n = used.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < n; i++) {
+            if (names[i] == name || std::strcmp(names[i], name) == 0) return static_cast<MetricId>(i);
+        }
+        if (n + 1 >= capacity) {
+            // 最后一格留给溢出
+            names[capacity - 1] = OVERFLOW_NAME;
+            used.store(capacity, std::memory_order_release);
+            return static_cast<MetricId>(capacity - 1);
+        }
+        names[n] = name;
+        used.store(n + 1, std::memory_order_release);
+        return static_cast<MetricId>(n);
+    }
+
+    MetricId histogram(const char* name) {
+        return registerName(name, histogramNames_.data(), histogramsUsed_, MAX_HISTOGRAMS);
+    }
+    MetricId counter(const char* name) {
+        return registerName(name, counterNames_.data(), countersUsed_, MAX_COUNTERS);
+    }
+    MetricId gauge(const char* name) { return registerName(name, gaugeNames_.data(), gaugesUsed_, MAX_GAUGES); }
+
+    Shard* acquireShard() {
+        std::lock_guard<std::mutex> lock(mu_);
+        if (!free_.empty()) {
+            Shard* shard = free_.back();
+            free_.pop_back();
+            return shard;
+        }
+        shards_.push_back(std::make_unique<Shard>());
+        return shards_.back().get();
+    }
+
+    void releaseShard(Shard* shard) {
+        std::lock_guard<std::mutex> lock(mu_);
+        free_.push_back(shard);
+    }
+
+    Gauge& gaugeCell(MetricId id) { return gauges_[id]; }
+
+    Snapshot snapshot() {
+        std::lock_guard<std::mutex> lock(mu_);
+        Snapshot snap;
+        if (!ENABLED) return snap;
+        snap.threads = shards_.size();
+
+        size_t histogramCount = histogramsUsed_.load(std::memory_order_acquire);
+        for (size_t id = 0; id < histogramCount; id++) {
+            HistogramSnapshot h = totalLocked(id);
+            if (const auto& base = baseline_.histograms[id]) {
+                h.count -= base->count;
+                h.sumNs -= base->sumNs;
+                for (size_t b = 0; b < BUCKETS; b++) h.buckets[b] -= base->buckets[b];
+            }
+            if (h.count > 0) snap.histograms.push_back(h);
+        }
+
+        size_t counterCount = countersUsed_.load(std::memory_order_acquire);
+        for (size_t id = 0; id < counterCount; id++) {
+            uint64_t total = 0;
+            for (const auto& shard : shards_) total += shard->counters[id].load(std::memory_order_relaxed);
+            total -= baseline_.counters[id];
+            if (total > 0) snap.counters.push_back({counterNames_[id], total});
+        }
+
+        size_t gaugeCount = gaugesUsed_.load(std::memory_order_acquire);
+        for (size_t id = 0; id < gaugeCount; id++) {
+            const Gauge& g = gauges_[id];
+            uint64_t updates = g.updates.load(std::memory_order_relaxed) - baseline_.gaugeUpdates[id];
+            if (updates == 0) continue;
+            snap.gauges.push_back({gaugeNames_[id], g.value.load(std::memory_order_relaxed),
+                                   g.max.load(std::memory_order_relaxed), updates});
+        }
+        return snap;
+    }
+
+    void reset() {
+        std::lock_guard<std::mutex> lock(mu_);
+        size_t histogramCount = histogramsUsed_.load(std::memory_order_acquire);
+        for (size_t id = 0; id < histogramCount; id++) {
+            auto& base = baseline_.histograms[id];
+            if (!base) base = std::make_unique<HistogramSnapshot>();
+            *base = totalLocked(id);
+            for (const auto& shard : shards_) {
+                HistogramCells* cells = shard->histograms[id].load(std::memory_order_acquire);
+                if (cells != nullptr) cells->max.store(0, std::memory_order_relaxed);
+            }
+        }
+        size_t counterCount = countersUsed_.load(std::memory_order_acquire);
+        for (size_t id = 0; id < counterCount; id++) {
+            uint64_t total = 0;
+            for (const auto& shard : shards_) total += shard->counters[id].load(std::memory_order_relaxed);
+            baseline_.counters[id] = total;
+        }
+        size_t gaugeCount = gaugesUsed_.load(std::memory_order_acquire);
+        for (size_t id = 0; id < gaugeCount; id++) {
+            Gauge& g = gauges_[id];
+            baseline_.gaugeUpdates[id] = g.updates.load(std::memory_order_relaxed);
+            g.max.store(g.value.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+    }
+
+private:
+    /** 调用方持有 mu_；各分片之和（不扣基线），maxNs 为 reset 以来 */
+    HistogramSnapshot totalLocked(size_t id) const {
+        HistogramSnapshot h;
+        h.name = histogramNames_[id];
+        for (const auto& shard : shards_) {
+            const HistogramCells* cells = shard->histograms[id].load(std::memory_order_acquire);
+            if (cells == nullptr) continue;
+            h.count += cells->count.load(std::memory_order_relaxed);
+            h.sumNs += cells->sum.load(std::memory_order_relaxed);
+            h.maxNs = std::max(h.maxNs, cells->max.load(std::memory_order_relaxed));
+            for (size_t b = 0; b < BUCKETS; b++) h.buckets[b] += cells->buckets[b].load(std::memory_order_relaxed);
+        }
+        return h;
+    }
+
+    std::mutex mu_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::vector<Shard*> free_;
+    Baseline baseline_;
+
+    std::array<const char*, MAX_HISTOGRAMS> histogramNames_{};
+    std::array<const char*, MAX_COUNTERS> counterNames_{};
+    std::array<const char*, MAX_GAUGES> gaugeNames_{};
+    std::atomic<size_t> histogramsUsed_{0};
+    std::atomic<size_t> countersUsed_{0};
+    std::atomic<size_t> gaugesUsed_{0};
+    Gauge gauges_[MAX_GAUGES];
+};
+
+Registry& registry() {
+    static Registry* instance = new Registry();
+    return *instance;
+}
+
+/** 线程退出时把分片交回注册表，累计值留给后来的线程继续累加 */
+struct ShardHandle {
+    Shard* shard = nullptr;
+    ~ShardHandle() {
+        if (shard != nullptr) registry().releaseShard(shard);
+    }
+};
+
+thread_local ShardHandle t_shard;
+
+inline Shard& localShard() {
+    if (t_shard.shard == nullptr) t_shard.shard = registry().acquireShard();
+    return *t_shard.shard;
+}
+
+}  // namespace
+
+// ============================================================
+// 注册与记录
+// ============================================================
+
+MetricId histogram(const char* name) { return registry().histogram(name); }
+MetricId counter(const char* name) { return registry().counter(name); }
+MetricId gauge(const char* name) { return registry().gauge(name); }
+
+void record(MetricId id, uint64_t ns) {
+    if (id >= MAX_HISTOGRAMS) return;
+    Shard& shard = localShard();
+    HistogramCells* cells = shard.histograms[id].load(std::memory_order_relaxed);
+    if (cells == nullptr) {
+        cells = new HistogramCells();
+        shard.histograms[id].store(cells, std::memory_order_release);
+    }
+    bump(cells->count, 1);
+    bump(cells->sum, ns);
+    bump(cells->buckets[bucketOf(ns)], 1);
+    if (ns > cells->max.load(std::memory_order_relaxed)) cells->max.store(ns, std::memory_order_relaxed);
+}
+
+void add(MetricId id, uint64_t n) {
+    if (id >= MAX_COUNTERS) return;
+    bump(localShard().counters[id], n);
+}
+
+void set(MetricId id, int64_t value) {
+    if (id >= MAX_GAUGES) return;
+    Gauge& g = registry().gaugeCell(id);
+    g.value.store(value, std::memory_order_relaxed);
+    g.updates.fetch_add(1, std::memory_order_relaxed);
+    int64_t seen = g.max.load(std::memory_order_relaxed);
+    while (value > seen && !g.max.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {
+    }
+}
+
+void beginTrace(const char* name) {
+#if defined(NATIVE_METRICS_OHOS)
+    OH_HiTrace_StartTrace(name);
+#else
+    (void)name;
+#endif
+}
+
+void endTrace() {
+#if defined(NATIVE_METRICS_OHOS)
+    OH_HiTrace_FinishTrace();
+#endif
+}
+
+// ============================================================
+// 快照
+// ============================================================
+
+double HistogramSnapshot::percentileNs(double q) const {
+    if (count == 0) return 0.0;
+    q = std::min(1.0, std::max(0.0, q));
+    // 第 rank 个（从 1 起）样本所在的桶
+    double rank = std::max(1.0, q * static_cast<double>(count));
+    uint64_t seen = 0;
+    for (size_t b = 0; b < BUCKETS; b++) {
+        if (buckets[b] == 0) continue;
+        if (static_cast<double>(seen + buckets[b]) >= rank) {
+            double lower = static_cast<double>(bucketLower(b));
+            double width = static_cast<double>(bucketUpper(b) - bucketLower(b));
+            double within = (rank - static_cast<double>(seen) - 0.5) / static_cast<double>(buckets[b]);
+            double value = b < SUB_BUCKETS ? lower : lower + width * std::min(1.0, std::max(0.0, within));
+            return maxNs > 0 ? std::min(value, static_cast<double>(maxNs)) : value;
+        }
+        seen += buckets[b];
+    }
+    return static_cast<double>(maxNs);
+}
+
+const HistogramSnapshot* Snapshot::findHistogram(const char* name) const {
+    for (const auto& h : histograms) {
+        if (std::strcmp(h.name, name) == 0) return &h;
+    }
+    return nullptr;
+}
+
+uint64_t Snapshot::counterValue(const char* name) const {
+    for (const auto& c : counters) {
+        if (std::strcmp(c.name, name) == 0) return c.value;
+    }
+    return 0;
+}
+
+const GaugeSnapshot* Snapshot::findGauge(const char* name) const {
+    for (const auto& g : gauges) {
+        if (std::strcmp(g.name, name) == 0) return &g;
+    }
+    return nullptr;
+}
+
+Snapshot snapshot() { return registry().snapshot(); }
+
+void reset() { registry().reset(); }
+
+void logSummary(const char* module) {
+#if defined(NATIVE_METRICS_OHOS)
+    constexpr unsigned int LOG_DOMAIN_ID = 0x0000;
+    constexpr const char* LOG_TAG_NAME = "NativeMetrics";
+    Snapshot snap = snapshot();
+    for (const auto& h : snap.histograms) {
+        OH_LOG_Print(LOG_APP, LOG_INFO, LOG_DOMAIN_ID, LOG_TAG_NAME,
+                     "%{public}s %{public}s n=%{public}" PRIu64 " p50=%{public}.3fms p90=%{public}.3fms "
+                     "p99=%{public}.3fms max=%{public}.3fms",
+                     module, h.name, h.count, h.percentileNs(0.5) / 1e6, h.percentileNs(0.9) / 1e6,
+                     h.percentileNs(0.99) / 1e6, static_cast<double>(h.maxNs) / 1e6);
+    }
+    for (const auto& c : snap.counters) {
+        OH_LOG_Print(LOG_APP, LOG_INFO, LOG_DOMAIN_ID, LOG_TAG_NAME, "%{public}s %{public}s %{public}" PRIu64, module, c.name, c.value);
+    }
+    for (const auto& g : snap.gauges) {
+        OH_LOG_Print(LOG_APP, LOG_INFO, LOG_DOMAIN_ID, LOG_TAG_NAME, "%{public}s %{public}s value=%{public}" PRId64
+                     " max=%{public}" PRId64, module, g.name, g.value, g.max);
+    }
+#else
+    (void)module;
+#endif
+}
+
+}  // namespace metrics
+}  // namespace native_common
@@ -0,0 +1,253 @@
+/**
+ * metrics.h — 原生热路径埋点：延迟直方图、计数器、gauge
+ *
+ * 写入无锁：线程第一次记录时从注册表领取一个分片（thread_local），之后只写自己的分片，
+ * 单写者用 relaxed load + store 累加，没有 RMW 竞争，也不碰任何锁。
+ * 线程退出时分片交回空闲表，由下一个新线程接着累加，分片数 = 同时存活的最多线程数。
+ * snapshot() 遍历分片求和，不阻塞写者；reset() 记一条基线，之后的 snapshot 只报告基线之后的增量。
+ *
+ * 直方图以纳秒记录，对数分桶：每个 2 的幂区间 4 个子桶（相对误差 ≤ 12.5%），覆盖 0 ns ~ 18 min。
+ * 某个线程第一次记录某个直方图时才为它分配桶数组。
+ * gauge（树深度等）是模块内单值：最近一次的值与 reset 以来的最大值。
+ *
+ * 埋点用宏，名字必须是字符串字面量（注册表只保存指针），每个调用点首次执行时注册一次：
+ *   NATIVE_METRICS_SCOPE("rule_engine.evaluate");               作用域计时
+ *   NATIVE_METRICS_RECORD("exec.duration", ns);                 记录在别处测得的耗时
+ *   NATIVE_METRICS_TRACE("rule_engine.compile_tree");           作用域计时 + HiTrace 区间
+ *   NATIVE_METRICS_COUNT("rule_engine.rules_evaluated", n);
+ *   NATIVE_METRICS_GAUGE("rule_engine.tree_depth", depth);
+ *   NATIVE_METRICS_LOCK(lock, firing_.mu, "rule_engine.firing_lock_wait");  取锁并记录等待时间
+ * 定义 NATIVE_METRICS_DISABLED（CMake -DNATIVE_METRICS=OFF）后宏展开为空，
+ * NATIVE_METRICS_LOCK 退化为普通 unique_lock；snapshot() 照常可调，enabled = false、内容为空。
+ *
+ * 每个 .so 链接自己的一份 native_metrics（符号隐藏），getMetrics() 只报告本模块。
+ * 不依赖 NAPI；JS 导出见 metrics_napi.h。
+ */
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+namespace native_common {
+namespace metrics {
+
+constexpr size_t MAX_HISTOGRAMS = 48;
+constexpr size_t MAX_COUNTERS = 64;
+constexpr size_t MAX_GAUGES = 16;
+
+/** 每个 2 的幂区间的子桶数 = 2^SUB_BUCKET_BITS */
+constexpr unsigned SUB_BUCKET_BITS = 2;
+constexpr size_t SUB_BUCKETS = size_t{1} << SUB_BUCKET_BITS;
+/** 最高桶的 2 的幂（2^40 ns ≈ 18 min），更大的值记入最后一个桶 */
+constexpr unsigned MAX_OCTAVE = 40;
+constexpr size_t BUCKETS = (MAX_OCTAVE - SUB_BUCKET_BITS + 2) * SUB_BUCKETS;
+
+using MetricId = uint32_t;
+
+#if defined(NATIVE_METRICS_DISABLED)
+constexpr bool ENABLED = false;
+#else
+constexpr bool ENABLED = true;
+#endif
+
+// ============================================================
+// 分桶
+// ============================================================
+
+/** 纳秒值 → 桶号；< SUB_BUCKETS 的值各占一个精确桶 */
+inline size_t bucketOf(uint64_t ns) {
+    if (ns < SUB_BUCKETS) return static_cast<size_t>(ns);
+    unsigned octave = 63u - static_cast<unsigned>(__builtin_clzll(ns));
+    if (octave > MAX_OCTAVE) return BUCKETS - 1;
+    size_t sub = static_cast<size_t>(ns >> (octave - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+    return (octave - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + sub;
+}
+
+/** 桶的下界（含） */
+inline uint64_t bucketLower(size_t idx) {
+    if (idx < SUB_BUCKETS) return idx;
+    unsigned octave = static_cast<unsigned>(idx / SUB_BUCKETS) + SUB_BUCKET_BITS - 1;
+    uint64_t sub = idx % SUB_BUCKETS;
+    return (SUB_BUCKETS + sub) << (octave - SUB_BUCKET_BITS);
+}
+
+/** 桶的上界（不含） */
+inline uint64_t bucketUpper(size_t idx) {
+    if (idx < SUB_BUCKETS) return idx + 1;
+    unsigned octave = static_cast<unsigned>(idx / SUB_BUCKETS) + SUB_BUCKET_BITS - 1;
+    return bucketLower(idx) + (uint64_t{1} << (octave - SUB_BUCKET_BITS));
+}
+
+// ============================================================
+// 注册与记录
+// ============================================================
+
+/** 按名字注册（同名返回同一个 id）；超出容量时返回共用的 "metrics.overflow" */
+MetricId histogram(const char* name);
+MetricId counter(const char* name);
+MetricId gauge(const char* name);
+
+/** 写当前线程的分片，无锁 */
+void record(MetricId histogram, uint64_t ns);
+void add(MetricId counter, uint64_t n = 1);
+/** gauge 是模块级原子量，记最近值与最大值 */
+void set(MetricId gauge, int64_t value);
+
+/** HiTrace 同步区间（未接入 HiTrace 的构建里为空操作） */
+void beginTrace(const char* name);
+void endTrace();
+
+inline uint64_t nowNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+class ScopedTimer {
+public:
+    explicit ScopedTimer(MetricId id) : id_(id), start_(nowNs()) {}
+    ~ScopedTimer() { record(id_, nowNs() - start_); }
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    MetricId id_;
+    uint64_t start_;
+};
+
+class ScopedTrace {
+public:
+    explicit ScopedTrace(const char* name) { beginTrace(name); }
+    ~ScopedTrace() { endTrace(); }
+    ScopedTrace(const ScopedTrace&) = delete;
+    ScopedTrace& operator=(const ScopedTrace&) = delete;
+};
+
+/**
+ * 取锁并记录等待时间：try_lock 成功记 0（不读时钟），否则计时阻塞的 lock()。
+ * 直方图的 count 即取锁次数，分位数反映争用
+ */
+template <typename Mutex>
+std::unique_lock<Mutex> timedLock(Mutex& mu, MetricId id) {
+    std::unique_lock<Mutex> lock(mu, std::try_to_lock);
+    if (lock.owns_lock()) {
+        record(id, 0);
+        return lock;
+    }
+    uint64_t t0 = nowNs();
+    lock.lock();
+    record(id, nowNs() - t0);
+    return lock;
+}
+
+// ============================================================
+// 快照
+// ============================================================
+
+struct HistogramSnapshot {
+    const char* name = "";
+    uint64_t count = 0;
+    uint64_t sumNs = 0;
+    uint64_t maxNs = 0;
+    std::array<uint64_t, BUCKETS> buckets{};
+
+    double meanNs() const { return count > 0 ? static_cast<double>(sumNs) / static_cast<double>(count) : 0.0; }
+
+    /** q ∈ [0, 1]；在命中的桶内按秩线性插值，不超过 maxNs */
+    double percentileNs(double q) const;
+};
+
+struct CounterSnapshot {
+    const char* name = "";
+    uint64_t value = 0;
+};
+
+struct GaugeSnapshot {
+    const char* name = "";
+    int64_t value = 0;
+    int64_t max = 0;
+    uint64_t updates = 0;
+};
+
+struct Snapshot {
+    bool enabled = ENABLED;
+    size_t threads = 0;   // 领取过分片的线程槽位数
+    std::vector<HistogramSnapshot> histograms;   // 只含有记录的项，按注册顺序
+    std::vector<CounterSnapshot> counters;
+    std::vector<GaugeSnapshot> gauges;
+
+    const HistogramSnapshot* findHistogram(const char* name) const;
+    uint64_t counterValue(const char* name) const;
+    const GaugeSnapshot* findGauge(const char* name) const;
+};
+
+/** reset() 以来的累计值 */
+Snapshot snapshot();
+
+/**
+ * 以当前累计值为基线；最大值直接清零（与写者并发时可能保留重置前的值）
+ */
+void reset();
+
+/** 每个有记录的直方图 / 计数器 / gauge 一行写入 HiLog（未接入 HiLog 的构建里为空操作） */
+void logSummary(const char* module);
+
+}  // namespace metrics
+}  // namespace native_common
+
+// ============================================================
+// 埋点宏
+// ============================================================
+
+#define NATIVE_METRICS_CONCAT_INNER(a, b) a##b
+#define NATIVE_METRICS_CONCAT(a, b) NATIVE_METRICS_CONCAT_INNER(a, b)
+
+#if defined(NATIVE_METRICS_DISABLED)
+
+#define NATIVE_METRICS_SCOPE(name) ((void)0)
+#define NATIVE_METRICS_TRACE(name) ((void)0)
+#define NATIVE_METRICS_RECORD(name, ns) ((void)0)
+#define NATIVE_METRICS_COUNT(name, n) ((void)0)
+#define NATIVE_METRICS_GAUGE(name, value) ((void)0)
+#define NATIVE_METRICS_LOCK(lockVar, mutex, name) std::unique_lock<std::decay_t<decltype(mutex)>> lockVar(mutex)
+
+#else
+
+#define NATIVE_METRICS_SCOPE(name)                                                                            \
+    static const ::native_common::metrics::MetricId NATIVE_METRICS_CONCAT(nativeMetricsId_, __LINE__) =      \
+        ::native_common::metrics::histogram(name);                                                           \
+    ::native_common::metrics::ScopedTimer NATIVE_METRICS_CONCAT(nativeMetricsTimer_, __LINE__)(              \
+        NATIVE_METRICS_CONCAT(nativeMetricsId_, __LINE__))
+
+#define NATIVE_METRICS_TRACE(name)                                                                            \
+    ::native_common::metrics::ScopedTrace NATIVE_METRICS_CONCAT(nativeMetricsTrace_, __LINE__)(name);        \
+    NATIVE_METRICS_SCOPE(name)
+
+#define NATIVE_METRICS_RECORD(name, ns)                                                                       \
+    do {                                                                                                      \
+        static const ::native_common::metrics::MetricId nativeMetricsId_ = ::native_common::metrics::histogram(name); \
+        ::native_common::metrics::record(nativeMetricsId_, static_cast<uint64_t>(ns));                        \
+    } while (0)
+
+#define NATIVE_METRICS_COUNT(name, n)                                                                         \
+    do {                                                                                                      \
+        static const ::native_common::metrics::MetricId nativeMetricsId_ = ::native_common::metrics::counter(name); \
+        ::native_common::metrics::add(nativeMetricsId_, static_cast<uint64_t>(n));                            \
+    } while (0)
+
+#define NATIVE_METRICS_GAUGE(name, value)                                                                     \
+    do {                                                                                                      \
+        static const ::native_common::metrics::MetricId nativeMetricsId_ = ::native_common::metrics::gauge(name); \
+        ::native_common::metrics::set(nativeMetricsId_, static_cast<int64_t>(value));                         \
+    } while (0)
+
+#define NATIVE_METRICS_LOCK(lockVar, mutex, name)                                                             \
+    static const ::native_common::metrics::MetricId NATIVE_METRICS_CONCAT(nativeMetricsId_, __LINE__) =      \
+        ::native_common::metrics::histogram(name);                                                           \
+    auto lockVar = ::native_common::metrics::timedLock(mutex, NATIVE_METRICS_CONCAT(nativeMetricsId_, __LINE__))
+
+#endif
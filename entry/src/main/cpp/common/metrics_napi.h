@@ -0,0 +1,110 @@
+/**
+ * metrics_napi.h — 各模块共用的 getMetrics() 导出
+ *
+ *   getMetrics(options?: { reset?: boolean, log?: boolean }): NativeMetrics
+ *     { module, enabled, threads,
+ *       histograms: { [name]: { count, totalMs, meanMs, p50Ms, p90Ms, p99Ms, maxMs } },
+ *       counters: { [name]: number },
+ *       gauges: { [name]: { value, max } } }
+ *   返回上次 reset 以来的数据；reset: true 读完后开始新的统计窗口，log: true 同时写一份到 HiLog。
+ *
+ * 模块在 Init 的属性表里加一项 native_common::MetricsProperty("<模块名>") 即可。
+ */
+#pragma once
+
+#include <napi/native_api.h>
+#include "common/metrics.h"
+
+namespace native_common {
+
+namespace metrics_napi {
+
+inline void setNumber(napi_env env, napi_value obj, const char* key, double value) {
+    napi_value v;
+    napi_create_double(env, value, &v);
+    napi_set_named_property(env, obj, key, v);
+}
+
+inline bool optionFlag(napi_env env, napi_value options, const char* key) {
+    bool has = false;
+    if (napi_has_named_property(env, options, key, &has) != napi_ok || !has) return false;
+    napi_value v;
+    bool flag = false;
+    napi_get_named_property(env, options, key, &v);
+    napi_get_value_bool(env, v, &flag);
+    return flag;
+}
+
+inline napi_value GetMetrics(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    void* data = nullptr;
+    napi_get_cb_info(env, info, &argc, args, nullptr, &data);
+    const char* module = data != nullptr ? static_cast<const char*>(data) : "";
+
+    bool reset = false;
+    bool log = false;
+    napi_valuetype type = napi_undefined;
+    if (argc >= 1 && napi_typeof(env, args[0], &type) == napi_ok && type == napi_object) {
+        reset = optionFlag(env, args[0], "reset");
+        log = optionFlag(env, args[0], "log");
+    }
+
+    metrics::Snapshot snap = metrics::snapshot();
+    if (log) metrics::logSummary(module);
+    if (reset) metrics::reset();
+
+    napi_value result;
+    napi_create_object(env, &result);
+    napi_value moduleName;
+    napi_create_string_utf8(env, module, NAPI_AUTO_LENGTH, &moduleName);
+    napi_set_named_property(env, result, "module", moduleName);
+    napi_value enabled;
+    napi_get_boolean(env, snap.enabled, &enabled);
+    napi_set_named_property(env, result, "enabled", enabled);
+    setNumber(env, result, "threads", static_cast<double>(snap.threads));
+
+    constexpr double NS_PER_MS = 1e6;
+    napi_value histograms;
+    napi_create_object(env, &histograms);
+    for (const auto& h : snap.histograms) {
+        napi_value entry;
+        napi_create_object(env, &entry);
+        setNumber(env, entry, "count", static_cast<double>(h.count));
+        setNumber(env, entry, "totalMs", static_cast<double>(h.sumNs) / NS_PER_MS);
+        setNumber(env, entry, "meanMs", h.meanNs() / NS_PER_MS);
+        setNumber(env, entry, "p50Ms", h.percentileNs(0.5) / NS_PER_MS);
+        setNumber(env, entry, "p90Ms", h.percentileNs(0.9) / NS_PER_MS);
+        setNumber(env, entry, "p99Ms", h.percentileNs(0.99) / NS_PER_MS);
+        setNumber(env, entry, "maxMs", static_cast<double>(h.maxNs) / NS_PER_MS);
+        napi_set_named_property(env, histograms, h.name, entry);
+    }
+    napi_set_named_property(env, result, "histograms", histograms);
+
+    napi_value counters;
+    napi_create_object(env, &counters);
+    for (const auto& c : snap.counters) setNumber(env, counters, c.name, static_cast<double>(c.value));
+    napi_set_named_property(env, result, "counters", counters);
+
+    napi_value gauges;
+    napi_create_object(env, &gauges);
+    for (const auto& g : snap.gauges) {
+        napi_value entry;
+        napi_create_object(env, &entry);
+        setNumber(env, entry, "value", static_cast<double>(g.value));
+        setNumber(env, entry, "max", static_cast<double>(g.max));
+        napi_set_named_property(env, gauges, g.name, entry);
+    }
+    napi_set_named_property(env, result, "gauges", gauges);
+    return result;
+}
+
+}  // namespace metrics_napi
+
+/** 模块属性表里的 getMetrics 项；module 须为字符串字面量 */
+inline napi_property_descriptor MetricsProperty(const char* module) {
+    return {"getMetrics", nullptr, metrics_napi::GetMetrics, nullptr, nullptr, nullptr, napi_default,
+            const_cast<char*>(module)};
+}
+
+}  // namespace native_common
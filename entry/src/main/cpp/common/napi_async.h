@@ -0,0 +1,299 @@
+/**
+ * napi_async.h — 基于 napi_create_async_work 的 Promise 异步任务
+ *
+ * 耗时计算放到 NAPI 工作线程执行，JS 线程立即拿到 Promise：
+ *   - 并发上限：每个 env 同时运行的任务数不超过 maxConcurrent，多余的排队
+ *   - 取消：提交时可带 taskId，cancel(taskId) 后排队中的任务直接 reject，
+ *           运行中的任务通过 isCancelled() 轮询尽早退出，完成时同样 reject
+ *   - reject 的 Error.code：CANCELLED（被取消）/ FAILED（execute 中调用 fail()）
+ *
+ * execute() 在工作线程运行，不得调用任何 napi_*；result() 回到 JS 线程构建返回值。
+ * 每个 .so 各自持有一个 AsyncRunner（模块级静态对象）。
+ */
+#pragma once
+
+#include <napi/native_api.h>
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace native_common {
+
+class AsyncRunner;
+
+// ============================================================
+// 异步任务
+// ============================================================
+
+class AsyncTask {
+public:
+    virtual ~AsyncTask() = default;
+
+    /** 工作线程执行 */
+    virtual void execute() = 0;
+
+    /** JS 线程，execute 成功后构建 resolve 值 */
+    virtual napi_value result(napi_env env) = 0;
+
+    bool isCancelled() const { return cancelled_.load(std::memory_order_relaxed); }
+
+    /** 供长耗时算法轮询的取消标记 */
+    const std::atomic<bool>* cancelFlag() const { return &cancelled_; }
+
+    /** execute 中报告失败，Promise 以 FAILED reject */
+    void fail(const std::string& message) { error_ = message; }
+
+private:
+    friend class AsyncRunner;
+
+    std::atomic<bool> cancelled_{false};
+    std::string error_;
+    std::string taskId_;
+    napi_env env_ = nullptr;
+    napi_deferred deferred_ = nullptr;
+    napi_async_work work_ = nullptr;
+    AsyncRunner* runner_ = nullptr;
+};
+
+/**
+ * 由两个 lambda 组成的任务：exec(AsyncTask&) 在工作线程，done(napi_env) 在 JS 线程
+ * 两者之间的数据通过共同捕获的 shared_ptr 传递
+ */
+template <typename Exec, typename Done>
+class LambdaTask : public AsyncTask {
+public:
+    LambdaTask(Exec exec, Done done) : exec_(std::move(exec)), done_(std::move(done)) {}
+
+    void execute() override { exec_(*this); }
+
+    napi_value result(napi_env env) override { return done_(env); }
+
+private:
+    Exec exec_;
+    Done done_;
+};
+
+template <typename Exec, typename Done>
+std::unique_ptr<AsyncTask> makeAsyncTask(Exec exec, Done done) {
+    return std::make_unique<LambdaTask<Exec, Done>>(std::move(exec), std::move(done));
+}
+
+// ============================================================
+// 调度器
+// ============================================================
+
+class AsyncRunner {
+public:
+    static constexpr size_t DEFAULT_MAX_CONCURRENT = 2;
+
+    explicit AsyncRunner(const char* name, size_t maxConcurrent = DEFAULT_MAX_CONCURRENT)
+        : name_(name), maxConcurrent_(maxConcurrent == 0 ? 1 : maxConcurrent) {}
+
+    AsyncRunner(const AsyncRunner&) = delete;
+    AsyncRunner& operator=(const AsyncRunner&) = delete;
+
+    /**
+     * 提交任务，返回 Promise
+     * @param taskId 非空时可用于 cancel()，同一时刻不能重复
+     */
+    napi_value submit(napi_env env, std::unique_ptr<AsyncTask> task, const std::string& taskId = "") {
+        napi_value promise = nullptr;
+        napi_deferred deferred = nullptr;
+        if (napi_create_promise(env, &deferred, &promise) != napi_ok) {
+            napi_throw_error(env, nullptr, "Failed to create promise");
+            return nullptr;
+        }
+
+        AsyncTask* t = task.release();
+        t->env_ = env;
+        t->deferred_ = deferred;
+        t->runner_ = this;
+        t->taskId_ = taskId;
+
+        bool startNow = false;
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            if (!taskId.empty()) {
+                if (byId_.count(taskId)) {
+                    t->error_ = "Duplicate taskId: " + taskId;
+                    t->taskId_.clear();
+                } else {
+                    byId_[taskId] = t;
+                }
+            }
+            if (t->error_.empty()) {
+                EnvState& st = envs_[env];
+                if (st.running < maxConcurrent_) {
+                    st.running++;
+                    startNow = true;
+                } else {
+                    st.pending.push_back(t);
+                }
+            }
+        }
+
+        if (!t->error_.empty()) {
+            settle(env, t, false);
+        } else if (startNow) {
+            start(t);
+        }
+        return promise;
+    }
+
+    /**
+     * 取消任务：排队中的立即 reject，运行中的置取消标记并在完成时 reject
+     * @return 是否找到该任务
+     */
+    bool cancel(napi_env env, const std::string& taskId) {
+        AsyncTask* queued = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            auto it = byId_.find(taskId);
+            if (it == byId_.end()) return false;
+
+            AsyncTask* t = it->second;
+            t->cancelled_.store(true, std::memory_order_relaxed);
+
+            // 只能在任务所属 env 的线程上 settle，其余情况交给出队 / 完成时处理
+            if (t->env_ == env) {
+                auto& pending = envs_[env].pending;
+                for (auto pit = pending.begin(); pit != pending.end(); ++pit) {
+                    if (*pit == t) {
+                        pending.erase(pit);
+                        byId_.erase(it);
+                        queued = t;
+                        break;
+                    }
+                }
+            }
+        }
+
+        if (queued) {
+            settle(env, queued, false);
+        }
+        return true;
+    }
+
+    void setMaxConcurrent(size_t n) {
+        std::lock_guard<std::mutex> lock(mu_);
+        maxConcurrent_ = (n == 0) ? 1 : n;
+    }
+
+    size_t maxConcurrent() const {
+        std::lock_guard<std::mutex> lock(mu_);
+        return maxConcurrent_;
+    }
+
+private:
+    struct EnvState {
+        size_t running = 0;
+        std::deque<AsyncTask*> pending;
+    };
+
+    const char* name_;
+    mutable std::mutex mu_;
+    size_t maxConcurrent_;
+    std::unordered_map<napi_env, EnvState> envs_;
+    std::unordered_map<std::string, AsyncTask*> byId_;
+
+    static void Execute(napi_env /*env*/, void* data) {
+        auto* t = static_cast<AsyncTask*>(data);
+        if (!t->isCancelled()) {
+            t->execute();
+        }
+    }
+
+    static void Complete(napi_env env, napi_status status, void* data) {
+        auto* t = static_cast<AsyncTask*>(data);
+        t->runner_->finish(env, status, t);
+    }
+
+    void start(AsyncTask* t) {
+        napi_value resourceName;
+        napi_create_string_utf8(t->env_, name_, NAPI_AUTO_LENGTH, &resourceName);
+
+        napi_status status = napi_create_async_work(t->env_, nullptr, resourceName,
+                                                    Execute, Complete, t, &t->work_);
+        if (status == napi_ok) {
+            status = napi_queue_async_work(t->env_, t->work_);
+        }
+        if (status != napi_ok) {
+            t->error_ = "Failed to queue async work";
+            finish(t->env_, status, t);
+        }
+    }
+
+    void finish(napi_env env, napi_status status, AsyncTask* t) {
+        if (status == napi_cancelled) {
+            t->cancelled_.store(true, std::memory_order_relaxed);
+        }
+        bool ok = (status == napi_ok) && !t->isCancelled() && t->error_.empty();
+        settle(env, t, ok, true);
+        drain(env);
+    }
+
+    /**
+     * resolve / reject 并释放任务
+     * @param wasRunning 是否占用了一个并发名额
+     */
+    void settle(napi_env env, AsyncTask* t, bool ok, bool wasRunning = false) {
+        if (ok) {
+            napi_value value = t->result(env);
+            if (value == nullptr) napi_get_undefined(env, &value);
+            napi_resolve_deferred(env, t->deferred_, value);
+        } else {
+            bool cancelled = t->isCancelled();
+            const std::string msg = cancelled ? "Task cancelled" : t->error_;
+            napi_value code, message, error;
+            napi_create_string_utf8(env, cancelled ? "CANCELLED" : "FAILED", NAPI_AUTO_LENGTH, &code);
+            napi_create_string_utf8(env, msg.c_str(), msg.size(), &message);
+            napi_create_error(env, code, message, &error);
+            napi_reject_deferred(env, t->deferred_, error);
+        }
+
+        if (t->work_) {
+            napi_delete_async_work(env, t->work_);
+        }
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            if (!t->taskId_.empty()) {
+                auto it = byId_.find(t->taskId_);
+                if (it != byId_.end() && it->second == t) byId_.erase(it);
+            }
+            if (wasRunning) {
+                auto& st = envs_[env];
+                if (st.running > 0) st.running--;
+            }
+        }
+        delete t;
+    }
+
+    /**
+     * 释放名额后启动排队任务；出队时已被取消的直接 reject
+     */
+    void drain(napi_env env) {
+        for (;;) {
+            AsyncTask* next = nullptr;
+            {
+                std::lock_guard<std::mutex> lock(mu_);
+                auto& st = envs_[env];
+                if (st.pending.empty() || st.running >= maxConcurrent_) return;
+                next = st.pending.front();
+                st.pending.pop_front();
+                if (!next->isCancelled()) st.running++;
+            }
+            if (next->isCancelled()) {
+                settle(env, next, false);
+            } else {
+                start(next);
+            }
+        }
+    }
+};
+
+}  // namespace native_common
@@ -0,0 +1,81 @@
+/**
+ * napi_typed_array.h — Float64Array / ArrayBuffer 零拷贝读取与打包输出
+ *
+ * 大批量数据（GPS 点、聚类结果）按固定步长打包成 double 数组在 JS 与 C++ 之间传递，
+ * 避免逐元素 napi_get_element + 逐属性查找。读取直接拿 JS 堆上的缓冲区指针，
+ * 指针只在当前 NAPI 回调内有效，跨线程使用前必须先拷贝。
+ */
+#pragma once
+
+#include <napi/native_api.h>
+#include <cstddef>
+#include <cstring>
+
+namespace native_common {
+
+/** 只读的 double 视图 */
+struct Float64View {
+    const double* data = nullptr;
+    size_t length = 0;   // 元素个数
+};
+
+/**
+ * 读取 Float64Array，或按 double 解释的 ArrayBuffer
+ * @return 类型不符时返回 false
+ */
+inline bool GetFloat64View(napi_env env, napi_value value, Float64View& out) {
+    bool isTypedArray = false;
+    napi_is_typedarray(env, value, &isTypedArray);
+    if (isTypedArray) {
+        napi_typedarray_type type;
+        size_t length = 0;
+        void* data = nullptr;
+        napi_value arrayBuffer;
+        size_t byteOffset = 0;
+        if (napi_get_typedarray_info(env, value, &type, &length, &data, &arrayBuffer, &byteOffset) != napi_ok) {
+            return false;
+        }
+        if (type != napi_float64_array) return false;
+        out.data = static_cast<const double*>(data);
+        out.length = length;
+        return true;
+    }
+
+    bool isArrayBuffer = false;
+    napi_is_arraybuffer(env, value, &isArrayBuffer);
+    if (isArrayBuffer) {
+        void* data = nullptr;
+        size_t byteLength = 0;
+        if (napi_get_arraybuffer_info(env, value, &data, &byteLength) != napi_ok) return false;
+        out.data = static_cast<const double*>(data);
+        out.length = byteLength / sizeof(double);
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * 创建长度为 length 的 Float64Array，outData 指向可写缓冲区
+ */
+inline napi_value CreateFloat64Array(napi_env env, size_t length, double** outData) {
+    napi_value buffer;
+    void* data = nullptr;
+    napi_create_arraybuffer(env, length * sizeof(double), &data, &buffer);
+
+    napi_value array;
+    napi_create_typedarray(env, napi_float64_array, length, buffer, 0, &array);
+    *outData = static_cast<double*>(data);
+    return array;
+}
+
+inline napi_value CreateFloat64Array(napi_env env, const double* src, size_t length) {
+    double* dst = nullptr;
+    napi_value array = CreateFloat64Array(env, length, &dst);
+    if (length > 0 && dst) {
+        std::memcpy(dst, src, length * sizeof(double));
+    }
+    return array;
+}
+
+}  // namespace native_common
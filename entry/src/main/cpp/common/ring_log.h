@@ -0,0 +1,105 @@
+/**
+ * ring_log.h — 定长环形下标与列式日志
+ *
+ * 学习器的原始历史只用于回看和持久化，聚合量另外用运行值维护。历史按列存放：
+ * 每个字段一个 std::vector<T>，所有列共用一个 RingIndex，满了覆盖最旧的一行，内存上限固定。
+ * 列都是定长 POD，写快照时每列按从旧到新顺序整块写出（最多两段连续内存）。
+ */
+#pragma once
+
+#include "common/binary_snapshot.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace native_common {
+
+// ============================================================
+// 环形下标
+// ============================================================
+
+class RingIndex {
+public:
+    explicit RingIndex(size_t capacity) : capacity_(std::max<size_t>(capacity, 1)) {}
+
+    /** 追加一行，返回写入的槽位；满了覆盖最旧的一行 */
+    size_t push() {
+        size_t at = slot(count_ == capacity_ ? 0 : count_);
+        if (count_ == capacity_) {
+            head_ = at + 1 == capacity_ ? 0 : at + 1;
+        } else {
+            count_++;
+        }
+        total_++;
+        return at;
+    }
+
+    /** 丢弃最旧的一行 */
+    void popFront() {
+        if (count_ == 0) return;
+        head_ = head_ + 1 == capacity_ ? 0 : head_ + 1;
+        count_--;
+    }
+
+    /** 第 i 旧的行所在槽位（0 = 最旧） */
+    size_t slot(size_t i) const {
+        size_t at = head_ + i;
+        return at >= capacity_ ? at - capacity_ : at;
+    }
+
+    size_t front() const { return head_; }
+    size_t back() const { return slot(count_ - 1); }
+
+    size_t size() const { return count_; }
+    size_t capacity() const { return capacity_; }
+    bool empty() const { return count_ == 0; }
+    bool full() const { return count_ == capacity_; }
+
+    /** 累计追加的行数（含已被覆盖的） */
+    uint64_t total() const { return total_; }
+
+    void clear() {
+        head_ = 0;
+        count_ = 0;
+        total_ = 0;
+    }
+
+private:
+    size_t capacity_;
+    size_t head_ = 0;
+    size_t count_ = 0;
+    uint64_t total_ = 0;
+};
+
+// ============================================================
+// 列读写
+// ============================================================
+
+/** 列按容量分配，槽位由 RingIndex 给出 */
+template <class T>
+void resizeColumn(std::vector<T>& column, const RingIndex& index) {
+    column.assign(index.capacity(), T{});
+}
+
+/** 按从旧到新的顺序写出一列 */
+template <class T>
+void putColumn(ByteWriter& w, const RingIndex& index, const std::vector<T>& column) {
+    if (index.empty()) return;
+    size_t first = std::min(index.size(), index.capacity() - index.front());
+    w.putBytes(column.data() + index.front(), first * sizeof(T));
+    if (first < index.size()) w.putBytes(column.data(), (index.size() - first) * sizeof(T));
+}
+
+/**
+ * 读入 count 个值到 out（从旧到新）；调用方再按 RingIndex::push 的槽位放回各列
+ * @return 截断时返回 false
+ */
+template <class T>
+bool getColumn(ByteReader& r, size_t count, std::vector<T>& out) {
+    out.resize(count);
+    for (size_t i = 0; i < count && r.ok(); i++) out[i] = r.get<T>();
+    return r.ok();
+}
+
+}  // namespace native_common
@@ -0,0 +1,141 @@
+/**
+ * thread_pool.h — 进程内共享的小型线程池
+ *
+ * 只提供 parallelFor：调用线程自己也参与执行，工作线程从共享下标里抢任务，
+ * 因此即使在池线程内嵌套调用、或工作线程全部繁忙，也不会死锁。
+ *
+ * 工作线程数 = min(硬件线程数, 4) - 1，低端设备上不至于和 UI 线程抢核。
+ */
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace native_common {
+
+class ThreadPool {
+public:
+    static constexpr unsigned MAX_THREADS = 4;
+
+    explicit ThreadPool(unsigned workers) {
+        for (unsigned i = 0; i < workers; i++) {
+            workers_.emplace_back([this] { workerLoop(); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        for (auto& t : workers_) {
+            if (t.joinable()) t.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * 进程内共享实例（首次调用时创建）
+     */
+    static ThreadPool& shared() {
+        static ThreadPool pool(defaultWorkers());
+        return pool;
+    }
+
+    size_t workerCount() const { return workers_.size(); }
+
+    /**
+     * 并行执行 fn(i), i ∈ [0, n)，返回时全部完成
+     * fn 不应抛出异常
+     */
+    template <typename Fn>
+    void parallelFor(size_t n, Fn&& fn) {
+        if (n == 0) return;
+        if (n == 1 || workers_.empty()) {
+            for (size_t i = 0; i < n; i++) fn(i);
+            return;
+        }
+
+        auto job = std::make_shared<Job>();
+        job->total = n;
+        job->body = [&fn](size_t i) { fn(i); };
+
+        size_t helpers = std::min(workers_.size(), n - 1);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (size_t h = 0; h < helpers; h++) tasks_.push_back(job);
+        }
+        cv_.notify_all();
+
+        runJob(*job);
+
+        // 已被工作线程领走的下标必然会执行完；body 引用调用栈上的 fn，必须等到全部完成
+        std::unique_lock<std::mutex> lock(job->doneMutex);
+        job->doneCv.wait(lock, [&] { return job->done.load(std::memory_order_acquire) == job->total; });
+    }
+
+private:
+    struct Job {
+        size_t total = 0;
+        std::atomic<size_t> next{0};
+        std::atomic<size_t> done{0};
+        std::function<void(size_t)> body;
+        std::mutex doneMutex;
+        std::condition_variable doneCv;
+    };
+
+    std::vector<std::thread> workers_;
+    std::deque<std::shared_ptr<Job>> tasks_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stopping_ = false;
+
+    static unsigned defaultWorkers() {
+        unsigned hw = std::thread::hardware_concurrency();
+        if (hw == 0) hw = 2;
+        return std::min(hw, MAX_THREADS) - 1;
+    }
+
+    static void runJob(Job& job) {
+        size_t completed = 0;
+        for (;;) {
+            size_t i = job.next.fetch_add(1, std::memory_order_relaxed);
+            if (i >= job.total) break;
+            job.body(i);
+            completed++;
+        }
+        if (completed == 0) return;
+
+        if (job.done.fetch_add(completed, std::memory_order_acq_rel) + completed == job.total) {
+            std::lock_guard<std::mutex> lock(job.doneMutex);
+            job.doneCv.notify_all();
+        }
+    }
+
+    void workerLoop() {
+        for (;;) {
+            std::shared_ptr<Job> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+                if (stopping_ && tasks_.empty()) return;
+                job = std::move(tasks_.front());
+                tasks_.pop_front();
+            }
+            runJob(*job);
+        }
+    }
+};
+
+}  // namespace native_common
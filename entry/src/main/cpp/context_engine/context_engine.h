@@ -11,6 +11,7 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <array>
 #include <unordered_map>
@@ -56,16 +57,156 @@ struct Rule {
     bool enabled;
 };
 
-/** Evaluation result for a single rule */
+/**
+ * Evaluation result for a single rule. ruleId / action point into the rule
+ * snapshot kept alive by the MatchResults that holds this entry.
+ */
 struct MatchResult {
-    std::string ruleId;
+    uint32_t ruleIndex;        // into the snapshot's rules
+    std::string_view ruleId;
     double confidence;         // 0~1 combined confidence
-    Action action;
+    const Action* action;
 };
 
 /** Context snapshot — key-value pairs from sensors */
 using ContextMap = std::unordered_map<std::string, std::string>;
 
+// ============================================================
+// Symbol interning (compiled at rule load time)
+// ============================================================
+
+/** Small integer id for an interned key / value string */
+using SymbolId = uint32_t;
+constexpr SymbolId NO_SYMBOL = 0xFFFFFFFFu;
+
+/** Interned event type, stable for the lifetime of an EventBuffer */
+using EventTypeId = uint32_t;
+constexpr EventTypeId NO_EVENT_TYPE = 0xFFFFFFFFu;
+
+/**
+ * Interns condition keys and enum-like values (e.g. motionState / timeOfDay values)
+ * into dense ids. Rebuilt whenever the rule set changes.
+ */
+class SymbolTable {
+public:
+    /** Return the id for s, adding it if new */
+    SymbolId intern(const std::string& s) {
+        auto it = ids_.find(s);
+        if (it != ids_.end()) return it->second;
+        SymbolId id = static_cast<SymbolId>(names_.size());
+        names_.push_back(s);
+        ids_.emplace(s, id);
+        return id;
+    }
+
+    /** Return the id for s, or NO_SYMBOL if it was never interned */
+    SymbolId find(const std::string& s) const {
+        auto it = ids_.find(s);
+        return it == ids_.end() ? NO_SYMBOL : it->second;
+    }
+
+    const std::string& name(SymbolId id) const { return names_[id]; }
+
+    size_t size() const { return names_.size(); }
+
+    void clear() {
+        names_.clear();
+        ids_.clear();
+    }
+
+private:
+    std::vector<std::string> names_;
+    std::unordered_map<std::string, SymbolId> ids_;
+};
+
+/** Condition operator, parsed once from Condition::op */
+enum class CondOp : uint8_t {
+    Eq, Neq, Gt, Lt, Gte, Lte, In, Range, Recent, Within, Unknown
+};
+
+CondOp parseCondOp(const std::string& op);
+
+/** Parse the whole of s as a double (no exceptions); false on junk, empty or out of range */
+bool parseNumber(const std::string& s, double& out);
+
+/**
+ * A Condition compiled at rule load time: key / values resolved to ids,
+ * numeric thresholds and margins parsed, event types split out.
+ * Evaluation never touches the original strings.
+ */
+struct CompiledCondition {
+    SymbolId key = NO_SYMBOL;
+    CondOp op = CondOp::Unknown;
+    SymbolId value = NO_SYMBOL;         // interned Condition::value
+
+    // op == In: interned CSV options, sorted
+    std::vector<SymbolId> inValues;
+
+    // gt / gte / lt / lte: threshold; range: [lo, hi]. numeric = operand parsed OK.
+    // recent / within / unknown ops set numeric too: like softMatch(Condition) they score 0
+    // when both operand and context value are numbers, and fall back to equality otherwise
+    bool numeric = false;
+    double lo = 0.0;                    // threshold, or range low bound
+    double hi = 0.0;                    // range high bound
+    double margin = 1.0;                // soft decay width
+
+    // recent: eventA; within: eventA → eventB. windowMs < 0 = unparseable
+    std::string eventA;
+    std::string eventB;
+    int64_t windowMs = -1;
+    EventTypeId eventAType = NO_EVENT_TYPE;  // EventBuffer ids, set by RuleEngine::compileRule
+    EventTypeId eventBType = NO_EVENT_TYPE;
+};
+
+/** Compile cond, interning its key / value (and "in" options) into symbols */
+CompiledCondition compileCondition(const Condition& cond, SymbolTable& symbols);
+
+/** Whether softMatch(cond, ...) reads the parsed number of its key (DenseContext::bind numericKeys) */
+bool needsNumericContext(const CompiledCondition& cond);
+
+/**
+ * Context bound to a SymbolTable: one fixed slot per interned key.
+ * Slots are invalidated by bumping an epoch, so rebinding never reallocates
+ * once the slot array has grown to the symbol count.
+ */
+class DenseContext {
+public:
+    struct Slot {
+        uint32_t epoch = 0;
+        SymbolId value = NO_SYMBOL;         // interned value, NO_SYMBOL if no rule mentions it
+        bool numeric = false;               // num holds the parsed value
+        double num = 0.0;
+    };
+
+    /**
+     * Bind ctx: one symbol lookup per context entry, keys unknown to any rule are skipped.
+     * Values of keys flagged in numericKeys (indexed by SymbolId) are parsed once here.
+     */
+    void bind(const ContextMap& ctx, const SymbolTable& symbols, const std::vector<uint8_t>& numericKeys);
+
+    /** Slot for key, or nullptr if the key is absent from the bound context */
+    const Slot* get(SymbolId key) const {
+        if (key >= slots_.size() || slots_[key].epoch != epoch_) return nullptr;
+        return &slots_[key];
+    }
+
+    /**
+     * Append to changed every key below symbolCount whose slot differs from other's
+     * (presence, interned value or parsed number). Both must be bound against the
+     * same SymbolTable. Keys that compare equal here match every compiled condition
+     * identically, so rules not mentioning a changed key keep their confidence.
+     */
+    void diff(const DenseContext& other, size_t symbolCount, std::vector<SymbolId>& changed) const;
+
+    /** Rules matched against this binding / cut short by the early exit; reset by bind(), read for metrics */
+    mutable uint32_t rulesMatched = 0;
+    mutable uint32_t rulesShortCircuited = 0;
+
+private:
+    std::vector<Slot> slots_;
+    uint32_t epoch_ = 0;
+};
+
 // ============================================================
 // Event buffer (temporal context)
 // ============================================================
@@ -84,32 +225,100 @@ struct RateLimits {
     int globalMaxPerHour = 10;              // max total recommendations per hour
 };
 
-/** Thread-safe circular event buffer with auto-expiry */
+/** EventBuffer sizing, see EventBuffer::configure */
+struct EventBufferConfig {
+    size_t maxEvents = 100;              // across all types; the oldest event is dropped first
+    int64_t maxAgeMs = 86400000;         // events older than this are dropped on push (24 hours)
+    size_t maxContexts = 0;              // context snapshots kept for lastContext(); 0 = none
+};
+
+/** Growable FIFO over a power-of-two circular array; index 0 is the oldest element */
+template <typename T>
+class RingBuffer {
+public:
+    size_t size() const { return count_; }
+    bool empty() const { return count_ == 0; }
+    const T& operator[](size_t i) const { return buf_[(head_ + i) & (buf_.size() - 1)]; }
+    const T& front() const { return (*this)[0]; }
+    const T& back() const { return (*this)[count_ - 1]; }
+
+    void push_back(const T& value) {
+        if (count_ == buf_.size()) grow();
+        buf_[(head_ + count_) & (buf_.size() - 1)] = value;
+        count_++;
+    }
+    void pop_front() {
+        head_ = (head_ + 1) & (buf_.size() - 1);
+        count_--;
+    }
+
+private:
+    void grow() {
+        std::vector<T> next(buf_.empty() ? 8 : buf_.size() * 2);
+        for (size_t i = 0; i < count_; i++) next[i] = (*this)[i];
+        buf_.swap(next);
+        head_ = 0;
+    }
+
+    std::vector<T> buf_;
+    size_t head_ = 0;
+    size_t count_ = 0;
+};
+
+/**
+ * Thread-safe event buffer with auto-expiry, indexed by event type: one
+ * timestamp ring per interned type, so "recent" reads the newest entry of one
+ * ring and "within" binary-searches two. Context snapshots are kept apart and
+ * only when EventBufferConfig::maxContexts is set.
+ */
 class EventBuffer {
 public:
-    explicit EventBuffer(size_t maxSize = 100);
+    explicit EventBuffer(const EventBufferConfig& config = {});
+
+    /** Change limits; already buffered events beyond the new ones are dropped */
+    void configure(const EventBufferConfig& config);
+    EventBufferConfig config() const;
+
+    /** Id for an event type (registered if new); compiled conditions keep it */
+    EventTypeId internType(const std::string& eventType);
 
-    /** Push a new event. Automatically expires events older than 24 hours. */
+    /**
+     * Push a new event, expiring events older than maxAgeMs. Timestamps are
+     * expected in order; an earlier one is clamped to the newest seen so far.
+     */
     void push(const ContextEvent& event);
 
-    /** Check if an event of given type happened within the last withinMs. */
-    bool hasRecent(const std::string& eventType, int64_t withinMs) const;
+    /**
+     * Check if an event of given type happened within withinMs before nowMs.
+     * Events stamped after nowMs are ignored (replay at a simulated time).
+     */
+    bool hasRecent(EventTypeId eventType, int64_t withinMs, int64_t nowMs) const;
 
     /**
-     * Check if eventA happened before eventB, both within withinMs of now,
+     * Check if eventA happened before eventB, both within withinMs before nowMs,
      * and eventA.timestamp < eventB.timestamp.
      */
-    bool hasSequence(const std::string& eventA, const std::string& eventB,
-                     int64_t withinMs) const;
+    bool hasSequence(EventTypeId eventA, EventTypeId eventB, int64_t withinMs, int64_t nowMs) const;
+
+    /** Most recent kept context snapshot of an event type */
+    bool lastContext(const std::string& eventType, ContextMap& out) const;
 
     size_t size() const;
 
 private:
-    void expireOld();
-
-    std::deque<ContextEvent> events_;
-    size_t maxSize_;
-    static constexpr int64_t MAX_AGE_MS = 86400000;  // 24 hours
+    // All below: caller must hold mu_
+    EventTypeId internLocked(const std::string& eventType);
+    void trim(int64_t now);
+
+    /** Newest timestamp of ring at or before now, or INT64_MIN */
+    static int64_t latestAtOrBefore(const RingBuffer<int64_t>& ring, int64_t now);
+
+    EventBufferConfig config_;
+    std::unordered_map<std::string, EventTypeId> typeIds_;
+    std::vector<RingBuffer<int64_t>> rings_;   // EventTypeId → timestamps, oldest first
+    RingBuffer<EventTypeId> order_;            // arrival order across types, for maxEvents / maxAgeMs
+    std::deque<ContextEvent> contexts_;        // newest last, at most maxContexts
+    int64_t newestMs_ = INT64_MIN;
     mutable std::mutex mu_;
 };
 
@@ -120,11 +329,26 @@ private:
 struct TreeNode {
     // Internal node: split on a key
     std::string splitKey;                          // "" for leaf
-    std::vector<std::pair<std::string, int>> branches;  // value → child index
-    int defaultChild;                              // fallback child index (-1 if leaf)
+    SymbolId splitKeyId = NO_SYMBOL;               // interned splitKey
+    std::vector<std::pair<SymbolId, int>> branches;  // interned value → child index
+    int defaultChild = -1;                         // fallback child index (-1 if none)
+
+    // Rules routed to this node, sorted. Leaf: candidates to evaluate;
+    // internal: kept so addRule/removeRule can re-decide the split in place
+    std::vector<int> ruleIndices;                  // indices (slots) into RuleEngine::rules_
+    std::vector<std::pair<SymbolId, int>> keyCounts;  // condition count per key not yet split on
+};
 
-    // Leaf node: candidate rules to evaluate
-    std::vector<int> ruleIndices;                  // indices into RuleEngine::rules_
+/** Decision tree shape and build cost, for diagnostics */
+struct TreeStats {
+    size_t nodeCount = 0;          // nodes reachable from the root
+    size_t leafCount = 0;
+    size_t maxDepth = 0;
+    size_t garbageNodes = 0;       // detached by patching, reclaimed on the next full build
+    double lastBuildMs = 0.0;      // duration of the last full build or patch
+    bool lastBuildFull = true;
+    uint64_t fullBuilds = 0;
+    uint64_t patches = 0;
 };
 
 // ============================================================
@@ -163,43 +387,107 @@ private:
 // LinUCB Contextual Bandit
 // ============================================================
 
-constexpr int LINUCB_DIM = 8;  // feature dimension
+constexpr int LINUCB_DIM = 8;  // dimension of the built-in context features
 
-/** Per-arm state for LinUCB: A matrix and b vector */
-struct LinUCBArm {
-    std::array<std::array<double, LINUCB_DIM>, LINUCB_DIM> A;  // d×d matrix
-    std::array<double, LINUCB_DIM> b;                           // d-vector
+/**
+ * Per-arm ridge-regression state. Ainv and theta are kept in step with A and b
+ * (Sherman-Morrison on every update), so scoring an arm never inverts A.
+ */
+template <int Dim>
+struct LinUCBArmState {
+    using Vec = std::array<double, Dim>;
+    using Mat = std::array<Vec, Dim>;
+
+    Mat A;        // d×d, I + Σ x·xᵀ
+    Vec b;        // Σ reward·x
+    Mat Ainv;     // A⁻¹
+    Vec theta;    // A⁻¹·b
+    uint32_t updatesSinceInvert = 0;  // rank-1 updates since Ainv was last recomputed from A
+    uint64_t revision = 0;            // model-wide change sequence number of the last write to this arm
 };
 
-class LinUCB {
+using LinUCBArm = LinUCBArmState<LINUCB_DIM>;
+
+/**
+ * LinUCB over Dim-dimensional feature vectors.
+ * select() costs O(arms·d²): θ·x plus √(xᵀ·A⁻¹·x) per arm; update() is O(d²).
+ * Defined in linucb.cpp and instantiated there for the dimensions in use.
+ */
+template <int Dim>
+class LinUCBModel {
 public:
-    explicit LinUCB(double alpha = 1.0);
+    using Vec = std::array<double, Dim>;
+    using Arm = LinUCBArmState<Dim>;
 
-    /**
-     * Build feature vector from context map.
-     * Features: [hour_sin, hour_cos, battery/100, isCharging, isWeekend,
-     *            motion_stationary, motion_active, motion_vehicle]
-     */
-    std::array<double, LINUCB_DIM> buildFeatureVec(const ContextMap& ctx) const;
+    explicit LinUCBModel(double alpha = 1.0);
 
     /** Select best arm using UCB scores. Returns index into actionIds. */
-    int select(const std::vector<std::string>& actionIds, const ContextMap& ctx);
+    int select(const std::vector<std::string>& actionIds, const Vec& x);
 
-    /** Update arm with observed reward and the context that was active. */
-    void update(const std::string& actionId, double reward, const ContextMap& ctx);
+    /** Update arm with observed reward and the feature vector that was active. */
+    void update(const std::string& actionId, double reward, const Vec& x);
 
-    /** Export all arm state as JSON (for persistence). */
+    /** Export all arm state (alpha, A, b) as JSON (for persistence). */
     std::string exportJson() const;
 
-    /** Import arm state from JSON. */
+    /** Import arm state from JSON; A⁻¹ and θ are rebuilt from the imported A and b. */
     void importJson(const std::string& json);
 
+    double alpha() const {
+        std::lock_guard<std::mutex> lock(mu_);
+        return alpha_;
+    }
+
+    /**
+     * Call f(id, arm) for every arm under the model lock (snapshot writers).
+     * An arm whose revision is unchanged since the last visit has not been written since.
+     */
+    template <class F>
+    void forEachArm(F&& f) const {
+        std::lock_guard<std::mutex> lock(mu_);
+        for (const auto& [id, arm] : arms_) f(id, arm);
+    }
+
+    /** Replace all arms with complete state (A⁻¹, θ and revision included), e.g. from a binary snapshot */
+    void restoreArms(double alpha, std::vector<std::pair<std::string, Arm>> arms);
+
 private:
+    /** Arm for id, created as (A = I, b = 0) if new. Caller must hold mu_. */
+    Arm& armFor(const std::string& id);
+
     double alpha_;
-    std::unordered_map<std::string, LinUCBArm> arms_;
+    std::unordered_map<std::string, Arm> arms_;
+    uint64_t revision_ = 0;   // last revision handed out
     mutable std::mutex mu_;
 };
 
+extern template class LinUCBModel<LINUCB_DIM>;
+
+/** LinUCB on the built-in context features */
+class LinUCB : public LinUCBModel<LINUCB_DIM> {
+public:
+    using LinUCBModel<LINUCB_DIM>::LinUCBModel;
+    using LinUCBModel<LINUCB_DIM>::select;
+    using LinUCBModel<LINUCB_DIM>::update;
+
+    /**
+     * Build feature vector from context map.
+     * Features: [hour_sin, hour_cos, battery/100, isCharging, isWeekend,
+     *            motion_stationary, motion_active, motion_vehicle]
+     */
+    std::array<double, LINUCB_DIM> buildFeatureVec(const ContextMap& ctx) const;
+
+    /** Select best arm for this context. Returns index into actionIds. */
+    int select(const std::vector<std::string>& actionIds, const ContextMap& ctx) {
+        return select(actionIds, buildFeatureVec(ctx));
+    }
+
+    /** Update arm with observed reward and the context that was active. */
+    void update(const std::string& actionId, double reward, const ContextMap& ctx) {
+        update(actionId, reward, buildFeatureVec(ctx));
+    }
+};
+
 // ============================================================
 // Soft matching
 // ============================================================
@@ -207,10 +495,149 @@ private:
 /** Evaluate a single condition against context, returning 0~1 confidence */
 double softMatch(const Condition& cond, const ContextMap& ctx);
 
+/** Same as above on a compiled condition and bound context (no parsing, no string hashing) */
+double softMatch(const CompiledCondition& cond, const DenseContext& ctx);
+
 // ============================================================
 // Rule Engine (main interface)
 // ============================================================
 
+/** Rules are immutable once published: an edit swaps in a new Rule, every snapshot keeps the one it saw */
+using RulePtr = std::shared_ptr<const Rule>;
+
+/**
+ * Rule list with its per-rule ranking lookups; rebuilt on every rule edit.
+ * The Rule objects are shared with the writer and older snapshots, so a
+ * publish copies pointers, not ids, conditions and payloads.
+ */
+struct RuleTable {
+    std::vector<RulePtr> rules;
+    std::vector<double> priority;                          // per rule; duplicate ids → last one wins
+    std::vector<uint32_t> idGroup;                         // per rule: first rule index with the same id
+};
+
+/** Compiled conditions and what is derived from them; rebuilt only when a rule's route changes */
+struct ConditionTable {
+    std::vector<std::vector<CompiledCondition>> compiled;  // parallel to rules
+    SymbolTable symbols;
+    std::vector<uint8_t> numericKeys;                      // SymbolId → used by a numeric op
+
+    // Reverse index for evaluateIncremental: SymbolId → rules with a condition on that key
+    std::vector<std::vector<uint32_t>> keyRules;
+    std::vector<uint32_t> temporalRules;                   // rules with recent / within conditions
+};
+
+/**
+ * Everything evaluate() reads about the rules, compiled together and published
+ * as one immutable snapshot. Writers build a new one and swap it in atomically;
+ * evaluators keep the one they loaded alive for the duration of the call.
+ * Parts an edit leaves untouched are shared with the previous snapshot, so a
+ * priority / action / cooldown edit copies only the rule table.
+ */
+struct CompiledRuleSet {
+    std::shared_ptr<const RuleTable> ruleTable;
+    std::shared_ptr<const ConditionTable> conditionTable;
+    std::shared_ptr<const std::vector<TreeNode>> treeNodes;
+
+    const std::vector<RulePtr>& rules() const { return ruleTable->rules; }
+    const Rule& rule(size_t i) const { return *ruleTable->rules[i]; }
+    const std::vector<double>& priority() const { return ruleTable->priority; }
+    const std::vector<uint32_t>& idGroup() const { return ruleTable->idGroup; }
+    const std::vector<std::vector<CompiledCondition>>& compiled() const { return conditionTable->compiled; }
+    const SymbolTable& symbols() const { return conditionTable->symbols; }
+    const std::vector<uint8_t>& numericKeys() const { return conditionTable->numericKeys; }
+    const std::vector<std::vector<uint32_t>>& keyRules() const { return conditionTable->keyRules; }
+    const std::vector<uint32_t>& temporalRules() const { return conditionTable->temporalRules; }
+    const std::vector<TreeNode>& tree() const { return *treeNodes; }
+};
+
+/**
+ * evaluate() output, best first. Holds the rule snapshot its entries point
+ * into; reusing one across calls keeps evaluate() free of heap allocations.
+ */
+class MatchResults {
+public:
+    size_t size() const { return items_.size(); }
+    bool empty() const { return items_.empty(); }
+    const MatchResult& operator[](size_t i) const { return items_[i]; }
+    std::vector<MatchResult>::const_iterator begin() const { return items_.begin(); }
+    std::vector<MatchResult>::const_iterator end() const { return items_.end(); }
+
+private:
+    friend class RuleEngine;
+    std::shared_ptr<const CompiledRuleSet> snapshot_;
+    std::vector<MatchResult> items_;
+};
+
+/**
+ * Per-rule cooldown and category / global rate-limit bookkeeping.
+ * Guarded by its own mutex so evaluate() never waits on a rule reload.
+ */
+struct FiringState {
+    std::mutex mu;
+    RateLimits limits;
+    std::unordered_map<std::string, int64_t> lastFired;  // ruleId → timestamp
+    // Category cooldown: action.type → list of firing timestamps
+    std::unordered_map<std::string, std::deque<int64_t>> categoryFirings;
+    // Global rate limit: all firing timestamps in the last hour
+    std::deque<int64_t> globalFirings;
+
+    // All below: caller must hold mu
+
+    /** Per-rule cooldown still running */
+    bool onCooldown(const Rule& rule, int64_t now) const;
+
+    /** Check enhanced cooldown: category throttle + global rate limit */
+    bool isRateLimited(const Action& action, int64_t now);
+
+    /** Same verdict as isRateLimited, without dropping expired timestamps (dry run) */
+    bool peekRateLimited(const Action& action, int64_t now) const;
+
+    /** Record a firing for per-rule cooldown + rate limit tracking */
+    void record(const Rule& rule, int64_t now);
+
+    void clear();
+};
+
+/** Options for RuleEngine::evaluateBatch */
+struct BatchOptions {
+    int maxResults = 5;
+    // Dry run (opt-in): cooldown / rate limits are checked against the firing state
+    // as it was when the batch started and nothing is recorded. Off by default, so
+    // a batch records firings like the evaluate() calls it replaces
+    bool dryRun = false;
+    // Per-context evaluation time (steady ms, same clock as ContextEvent timestamps);
+    // empty → the current time for every context
+    std::vector<int64_t> timestampsMs;
+    // Dry run only: spread contexts over native_common::ThreadPool
+    bool parallel = true;
+};
+
+/**
+ * Columnar evaluateBatch result. Matches of context i are
+ * [offsets[i], offsets[i + 1]) in ruleIndex / confidence, best first.
+ */
+struct BatchResult {
+    std::vector<uint32_t> offsets;      // contexts + 1
+    std::vector<uint32_t> ruleIndex;    // into ruleIds
+    std::vector<double> confidence;
+    std::vector<std::string> ruleIds;   // rules of the snapshot the whole batch ran against ("" = removed-rule slot)
+};
+
+/** What the last evaluateIncremental() call did */
+struct IncrementalStats {
+    bool full = false;             // rule set changed or a tree split key on the routed path changed
+    size_t changedKeys = 0;        // keys mentioned by some rule whose value differs from the previous call
+    size_t rulesMatched = 0;       // matchRule calls (a full pass matches every rule of the routed leaf)
+};
+
+/** What saveSnapshot() did */
+struct SnapshotWriteStats {
+    bool full = false;             // whole file rewritten (tmp + rename) rather than patched in place
+    size_t bytesWritten = 0;
+    size_t armsWritten = 0;        // LinUCB arm slots written
+};
+
 class RuleEngine {
 public:
     RuleEngine();
@@ -219,14 +646,56 @@ public:
     /** Load rules (replaces all existing rules). Auto-compiles decision tree. */
     bool loadRules(const std::vector<Rule>& rules);
 
-    /** Add a single rule. Re-compiles tree. */
+    /** Add or update a single rule. Patches only the tree branches the rule routes to. */
     bool addRule(const Rule& rule);
 
-    /** Remove a rule by id. Re-compiles tree. */
+    /** Remove every rule with this id (loadRules keeps duplicates). Patches only the tree branches they were routed to. */
     bool removeRule(const std::string& ruleId);
 
-    /** Evaluate context against all rules. Returns matches sorted by confidence × priority. */
-    std::vector<MatchResult> evaluate(const ContextMap& ctx, int maxResults = 5);
+    /**
+     * Start a bulk edit: loadRules / addRule / removeRule until the matching
+     * commit() only update the rule list, and the tree is built once at commit.
+     * Nests; evaluate() inside a batch still sees the last published rule set.
+     */
+    void beginBatch();
+
+    /**
+     * End a bulk edit started by beginBatch(). The outermost commit publishes any
+     * edit and rebuilds the tree only if a rule's conditions or enabled flag changed.
+     */
+    void commit();
+
+    /** Current tree shape and build timings */
+    TreeStats treeStats() const;
+
+    /**
+     * Evaluate context against all rules. Returns matches sorted by confidence × priority.
+     * Lock-free on the rule set (reads the current snapshot); only the firing
+     * bookkeeping at the end takes FiringState::mu.
+     */
+    MatchResults evaluate(const ContextMap& ctx, int maxResults = 5);
+
+    /** Same, writing into out (replaces its contents, reuses its storage) */
+    void evaluate(const ContextMap& ctx, int maxResults, MatchResults& out);
+
+    /**
+     * Evaluate many context snapshots against one rule snapshot.
+     * Without dryRun this is N evaluate() calls in order (firings recorded at
+     * each context's timestamp); a dry run leaves the firing state untouched
+     * and may evaluate contexts in parallel.
+     */
+    BatchResult evaluateBatch(const std::vector<ContextMap>& contexts, const BatchOptions& options = {});
+
+    /**
+     * Same results as evaluate() (firings recorded), but re-matches only the rules
+     * whose condition keys changed since the previous evaluateIncremental() call,
+     * found through CompiledRuleSet::keyRules; rules with temporal conditions are
+     * always re-matched. A new rule set, or a change to a key the decision tree
+     * split on along the routed path, falls back to a full pass. Calls are
+     * serialized among themselves; meant for one periodic caller.
+     */
+    void evaluateIncremental(const ContextMap& ctx, int maxResults, MatchResults& out,
+                             IncrementalStats* stats = nullptr);
 
     /** Push a context event into the event buffer (for recent/sequence conditions) */
     void pushEvent(const ContextEvent& event);
@@ -240,38 +709,151 @@ public:
     /** Get the LinUCB bandit for contextual action selection */
     LinUCB& linucb() { return linucb_; }
 
-    /** Get rule count */
-    size_t ruleCount() const { return rules_.size(); }
+    /** Get the event buffer for sizing (configure) and context snapshot lookups */
+    EventBuffer& events() { return eventBuffer_; }
+
+    /** Get rule count (including edits of an open batch) */
+    size_t ruleCount() const;
+
+    /**
+     * Context keys that enabled rules of the published rule set have a condition
+     * on, sorted and unique. Temporal keys ("event:type" / "sequence:a,b") are
+     * included as written: they are not data tray keys, but the duty-cycle
+     * scheduler maps their event types to the sensors that produce them.
+     */
+    std::vector<std::string> referencedKeys() const;
 
     /** Export rules as JSON string */
     std::string exportRulesJson() const;
 
+    /**
+     * Write rules, MAB stats and LinUCB arms to a binary snapshot at path
+     * (common/binary_snapshot.h). If path holds the snapshot this engine last
+     * wrote or loaded and no arm was added since, only the changed sections and
+     * the arms updated since are overwritten in place; otherwise the whole file
+     * is rewritten.
+     */
+    bool saveSnapshot(const std::string& path, SnapshotWriteStats* stats = nullptr);
+
+    /** Restore rules, MAB stats and LinUCB arms from a snapshot. Missing / corrupt file → false, state untouched. */
+    bool loadSnapshot(const std::string& path);
+
 private:
+    /** Re-compile all rule conditions, then rebuild the decision tree */
     void compileTree();
-    void evaluateNode(int nodeIdx, const ContextMap& ctx,
-                      std::vector<MatchResult>& results);
+    void compileRules();
 
-    /** Evaluate a single condition, handling "recent"/"within" via event buffer */
-    double matchCondition(const Condition& cond, const ContextMap& ctx);
+    /** Compile rules_[ruleIdx] into compiled_[ruleIdx], interning new symbols */
+    void compileRule(size_t ruleIdx);
 
-    /** Check enhanced cooldown: category throttle + global rate limit */
-    bool isRateLimited(const Action& action, int64_t now);
+    /** Insert (add) or withdraw (!add) enabled rule ruleIdx from the tree, rebuilding only changed subtrees */
+    void patchTree(int ruleIdx, bool add);
+
+    /** Full rebuild once patching has left too many detached nodes or removed-rule tombstones behind */
+    void maybeCompactTree();
+
+    /** Drop the tombstones removeRule left in rules_ (before a full build renumbers the tree) */
+    void compactRules();
+
+    /** Snapshot parts for publish(); the ones not passed are shared with the current snapshot */
+    enum PublishParts : uint8_t { PUBLISH_RULES = 1, PUBLISH_CONDITIONS = 2, PUBLISH_TREE = 4, PUBLISH_ALL = 7 };
+
+    /** Copy the given parts of the working rule set into a new snapshot and swap it in for evaluators */
+    void publish(uint8_t parts = PUBLISH_ALL);
+
+    /** A rule that passed matching, before cooldown / rate-limit filtering */
+    struct Candidate {
+        int ruleIdx;
+        double confidence;
+    };
 
-    /** Record a firing for rate limit tracking */
-    void recordFiring(const Action& action, int64_t now);
+    void evaluateNode(const CompiledRuleSet& set, int nodeIdx, const DenseContext& ctx, int64_t now,
+                      std::vector<Candidate>& out) const;
 
-    std::vector<Rule> rules_;
+    /** Match all conditions of set.rules[ruleIdx] (product of confidences, early exit) */
+    double matchRule(const CompiledRuleSet& set, size_t ruleIdx, const DenseContext& ctx, int64_t now) const;
+
+    /** Evaluate a single condition, handling "recent"/"within" via event buffer */
+    double matchCondition(const CompiledCondition& cond, const DenseContext& ctx, int64_t now) const;
+
+    /** Bind ctx and collect every rule that matches it (tree walk, or linear without a tree) */
+    void collectCandidates(const CompiledRuleSet& set, const ContextMap& ctx, int64_t now,
+                           std::vector<Candidate>& out) const;
+
+    /**
+     * Drop candidates on cooldown / rate-limited, dedup by id, keep the best
+     * maxResults (bounded heap), best first; record the top one when record is
+     * set. Works in place without allocating once warmed up. Caller holds
+     * firing.mu unless firing is a private copy.
+     */
+    void selectResults(const CompiledRuleSet& set, std::vector<Candidate>& candidates, int64_t now,
+                       int maxResults, FiringState& firing, bool record) const;
+
+    // Writer-side working copy, guarded by mu_. Published to snapshot_ after each edit.
+    // removeRule leaves a tombstone (default Rule: disabled, no id, no conditions) in the removed
+    // rule's slot so the tree's rule indices stay valid; compactRules() drops them at the next full build.
+    // Rules are shared with published snapshots: edits replace the pointer, never the pointee
+    std::vector<RulePtr> rules_;
+    std::vector<uint8_t> removed_;                          // parallel to rules_: slot is a tombstone
+    size_t removedCount_ = 0;
     std::vector<TreeNode> tree_;
+    SymbolTable symbols_;
+    std::vector<std::vector<CompiledCondition>> compiled_;  // parallel to rules_
+    std::vector<uint8_t> numericKeys_;                      // SymbolId → used by a numeric op
+    int batchDepth_ = 0;                                    // beginBatch() nesting
+    bool treeDirty_ = false;                                // rules_ changed since the last build
+    bool batchEdited_ = false;                              // rules_ edited since beginBatch(), not yet published
+    TreeStats treeStats_;                                   // counters + last build timing
+
+    // Read side: loaded / stored with std::atomic_load / std::atomic_store
+    std::shared_ptr<const CompiledRuleSet> snapshot_;
+
     MAB mab_;
     LinUCB linucb_;
-    std::unordered_map<std::string, int64_t> lastFired_;  // ruleId → timestamp
     EventBuffer eventBuffer_;
-    RateLimits rateLimits_;
-
-    // Category cooldown: action.type → list of firing timestamps
-    std::unordered_map<std::string, std::deque<int64_t>> categoryFirings_;
-    // Global rate limit: all firing timestamps in the last hour
-    std::deque<int64_t> globalFirings_;
+    FiringState firing_;
+
+    /** The snapshot file as last written / loaded: where each arm's slot is and which revision it holds */
+    struct SnapshotSlot {
+        uint32_t slot;
+        uint64_t revision;
+    };
+    struct SnapshotLayout {
+        std::string path;
+        std::unordered_map<std::string, SnapshotSlot> arms;
+    };
+
+    /** Rewrite the whole snapshot file and reset the layout */
+    bool writeFullSnapshot(const std::string& path, const std::string& rules, const std::string& mab,
+                           SnapshotWriteStats& stats);
+
+    /** Overwrite changed sections / arm slots of the file described by snapshotLayout_; false → caller rewrites */
+    bool patchSnapshot(const std::string& rules, const std::string& mab,
+                       const std::vector<std::pair<SnapshotSlot*, LinUCBArm>>& dirty, SnapshotWriteStats& stats);
+
+    /** Cached per-rule confidences of the previous evaluateIncremental() call */
+    struct IncrementalState {
+        std::mutex mu;
+        std::shared_ptr<const CompiledRuleSet> set;   // rule set the cache was built against
+        DenseContext prev;                            // context of the previous call
+        DenseContext next;
+        std::vector<int> routedRules;                 // enabled rules of the leaf the context routes to
+        std::vector<uint8_t> routed;                  // per rule
+        std::vector<uint8_t> pathKeys;                // per SymbolId: split on along the routed path
+        std::vector<double> confidence;               // per routed rule
+        std::vector<uint32_t> stamp;                  // per rule: re-matched in call #stampEpoch
+        uint32_t stampEpoch = 0;
+        std::vector<SymbolId> changed;
+        std::vector<Candidate> candidates;
+    };
+
+    /** Walk the tree for inc.next and refill inc.routedRules / routed / pathKeys */
+    void routeIncremental(const CompiledRuleSet& set, IncrementalState& inc) const;
+
+    IncrementalState incremental_;
+
+    SnapshotLayout snapshotLayout_;
+    std::mutex snapshotMu_;        // serializes saveSnapshot / loadSnapshot
 
     mutable std::mutex mu_;
 };
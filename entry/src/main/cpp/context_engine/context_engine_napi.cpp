@@ -1,31 +1,59 @@
 /**
  * context_engine_napi.cpp — NAPI bridge: ArkTS ↔ C++ 规则引擎
  *
- * Exposed functions:
+ * Exposed functions (same order as the registration table in Init):
  *   loadRules(rulesJson: string): boolean
  *   addRule(ruleJson: string): boolean
  *   removeRule(ruleId: string): boolean
  *   evaluate(contextJson: string, maxResults?: number): string  // returns JSON
+ *   evaluateIncremental(contextJson: string, maxResults?: number): string  // evaluate() JSON, re-matches changed keys only
  *   updateReward(actionId: string, reward: number): void
+ *   selectAction(actionIdsJson: string, contextJson?: string): number  // LinUCB with context, else MAB
  *   getStats(): string  // MAB stats as JSON
  *   loadStats(statsJson: string): void
  *   getRuleCount(): number
+ *   getReferencedKeys(): string  // JSON array of context keys enabled rules read (duty-cycle scheduling)
  *   exportRules(): string
+ *   beginBatch(): void                        // rule edits until commitBatch() build the tree once
+ *   commitBatch(): void
+ *   getTreeStats(): string                    // decision tree shape / build timing as JSON
+ *   exportLinUCB(): string
+ *   importLinUCB(json: string): void
+ *   saveSnapshot(path: string): boolean       // binary rules + MAB + LinUCB, dirty arms patched in place
+ *   loadSnapshot(path: string): boolean       // false if missing / corrupt (state untouched)
  *   pushEvent(eventJson: string): void      // push event to buffer
  *   setLimits(limitsJson: string): void      // configure rate limits
+ *   configureEvents(configJson: string): void  // event buffer capacity / expiry / kept contexts
+ *   getEventContext(eventType: string): string // context JSON of the latest kept event, "" if none
+ *   evaluateAsync(contextJson: string, maxResults?: number, taskId?: string): Promise<string>
+ *   evaluateBatch(contextsJson: string, options?: object): BatchEvaluateResult  // columnar typed arrays, records firings unless dryRun
+ *   cancelAsync(taskId: string): boolean
+ *   setAsyncConcurrency(n: number): void
+ *   getMetrics(options?: { reset?, log? }): NativeMetrics  // common/metrics_napi.h
  */
 #include <napi/native_api.h>
 #include "context_engine.h"
+#include "rule_json.h"
+#include "common/napi_async.h"
+#include "common/napi_typed_array.h"
+#include "common/json.h"
+#include "common/metrics_napi.h"
 #include <string>
 #include <memory>
-#include <sstream>
 #include <chrono>
+#include <cstring>
 
-// Simple JSON parsing helpers (no external deps)
-// For MVP we use a minimal approach — production could use nlohmann/json
+using native_common::json::Document;
+using native_common::json::Value;
+using native_common::json::Writer;
 
 namespace {
 
+using context_engine::contextMapJson;
+using context_engine::matchResultsJson;
+using context_engine::parseContextMap;
+using context_engine::parseRule;
+
 context_engine::RuleEngine g_engine;
 
 std::string napiGetString(napi_env env, napi_value val) {
@@ -48,184 +76,27 @@ napi_value napiBool(napi_env env, bool b) {
     return val;
 }
 
-// Minimal JSON string extractor: find "key":"value" pattern
-std::string jsonGetStr(const std::string& json, const std::string& key) {
-    std::string needle = "\"" + key + "\"";
-    auto pos = json.find(needle);
-    if (pos == std::string::npos) return "";
-    pos = json.find(':', pos + needle.size());
-    if (pos == std::string::npos) return "";
-    pos = json.find('"', pos + 1);
-    if (pos == std::string::npos) return "";
-    auto end = json.find('"', pos + 1);
-    if (end == std::string::npos) return "";
-    return json.substr(pos + 1, end - pos - 1);
-}
-
-double jsonGetNum(const std::string& json, const std::string& key, double defVal) {
-    std::string needle = "\"" + key + "\"";
-    auto pos = json.find(needle);
-    if (pos == std::string::npos) return defVal;
-    pos = json.find(':', pos + needle.size());
-    if (pos == std::string::npos) return defVal;
-    pos++;
-    while (pos < json.size() && (json[pos] == ' ' || json[pos] == '\t')) pos++;
-    try { return std::stod(json.substr(pos)); } catch (...) { return defVal; }
-}
-
-bool jsonGetBool(const std::string& json, const std::string& key, bool defVal) {
-    std::string needle = "\"" + key + "\"";
-    auto pos = json.find(needle);
-    if (pos == std::string::npos) return defVal;
-    pos = json.find(':', pos + needle.size());
-    if (pos == std::string::npos) return defVal;
-    auto rest = json.substr(pos + 1);
-    if (rest.find("true") < rest.find("false")) return true;
-    if (rest.find("false") != std::string::npos) return false;
-    return defVal;
-}
-
-// Parse a single rule from a JSON object substring
-context_engine::Rule parseRule(const std::string& json) {
-    context_engine::Rule rule;
-    rule.id = jsonGetStr(json, "id");
-    rule.name = jsonGetStr(json, "name");
-    rule.priority = jsonGetNum(json, "priority", 1.0);
-    rule.cooldownMs = static_cast<int64_t>(jsonGetNum(json, "cooldownMs", 0));
-    rule.enabled = jsonGetBool(json, "enabled", true);
-
-    // Parse action
-    rule.action.id = jsonGetStr(json, "actionId");
-    if (rule.action.id.empty()) {
-        // Try nested action object
-        auto actionPos = json.find("\"action\"");
-        if (actionPos != std::string::npos) {
-            auto bracePos = json.find('{', actionPos);
-            if (bracePos != std::string::npos) {
-                int depth = 1;
-                size_t end = bracePos + 1;
-                while (end < json.size() && depth > 0) {
-                    if (json[end] == '{') depth++;
-                    else if (json[end] == '}') depth--;
-                    end++;
-                }
-                std::string actionJson = json.substr(bracePos, end - bracePos);
-                rule.action.id = jsonGetStr(actionJson, "id");
-                rule.action.type = jsonGetStr(actionJson, "type");
-                rule.action.payload = jsonGetStr(actionJson, "payload");
-            }
-        }
-    }
-
-    // Parse conditions array
-    auto condPos = json.find("\"conditions\"");
-    if (condPos != std::string::npos) {
-        auto arrStart = json.find('[', condPos);
-        if (arrStart != std::string::npos) {
-            // Find each {...} object in the array
-            size_t pos = arrStart + 1;
-            while (pos < json.size()) {
-                auto objStart = json.find('{', pos);
-                if (objStart == std::string::npos) break;
-                int depth = 1;
-                size_t objEnd = objStart + 1;
-                while (objEnd < json.size() && depth > 0) {
-                    if (json[objEnd] == '{') depth++;
-                    else if (json[objEnd] == '}') depth--;
-                    objEnd++;
-                }
-                std::string condJson = json.substr(objStart, objEnd - objStart);
-                context_engine::Condition cond;
-                cond.key = jsonGetStr(condJson, "key");
-                cond.op = jsonGetStr(condJson, "op");
-                cond.value = jsonGetStr(condJson, "value");
-                if (!cond.key.empty()) {
-                    rule.conditions.push_back(cond);
-                }
-                pos = objEnd;
-                // Check if we hit ] (end of array)
-                auto nextBrace = json.find_first_of("[]{}", pos);
-                if (nextBrace != std::string::npos && json[nextBrace] == ']') break;
-            }
-        }
-    }
+// Per-thread parse document and output buffer, reused across calls (input strings stay alive meanwhile)
+Document& scratchDocument() {
+    thread_local Document doc;
+    return doc;
+}
 
-    return rule;
+std::string& scratchOutput() {
+    thread_local std::string out;
+    out.clear();
+    return out;
 }
 
-// Parse JSON array of rules
+// Parse a JSON array of rules (or a single rule object)
 std::vector<context_engine::Rule> parseRulesArray(const std::string& json) {
-    std::vector<context_engine::Rule> rules;
-    size_t pos = json.find('[');
-    if (pos == std::string::npos) {
-        // Single rule object
-        rules.push_back(parseRule(json));
-        return rules;
-    }
-
-    pos++;
-    while (pos < json.size()) {
-        auto objStart = json.find('{', pos);
-        if (objStart == std::string::npos) break;
-        // Find matching closing brace (handling nesting)
-        int depth = 1;
-        size_t objEnd = objStart + 1;
-        while (objEnd < json.size() && depth > 0) {
-            if (json[objEnd] == '{') depth++;
-            else if (json[objEnd] == '}') depth--;
-            objEnd++;
-        }
-        std::string ruleJson = json.substr(objStart, objEnd - objStart);
-        rules.push_back(parseRule(ruleJson));
-        pos = objEnd;
-    }
-    return rules;
+    return context_engine::parseRulesArray(json, scratchDocument());
 }
 
-// Parse context JSON object into ContextMap
 context_engine::ContextMap parseContextMap(const std::string& json) {
     context_engine::ContextMap ctx;
-    // Simple parser: find all "key":"value" pairs
-    size_t pos = 0;
-    while (pos < json.size()) {
-        auto keyStart = json.find('"', pos);
-        if (keyStart == std::string::npos) break;
-        auto keyEnd = json.find('"', keyStart + 1);
-        if (keyEnd == std::string::npos) break;
-
-        std::string key = json.substr(keyStart + 1, keyEnd - keyStart - 1);
-
-        auto colon = json.find(':', keyEnd + 1);
-        if (colon == std::string::npos) break;
-
-        // Skip whitespace
-        size_t valStart = colon + 1;
-        while (valStart < json.size() && (json[valStart] == ' ' || json[valStart] == '\t')) valStart++;
-
-        if (valStart >= json.size()) break;
-
-        std::string value;
-        if (json[valStart] == '"') {
-            // String value
-            auto valEnd = json.find('"', valStart + 1);
-            if (valEnd == std::string::npos) break;
-            value = json.substr(valStart + 1, valEnd - valStart - 1);
-            pos = valEnd + 1;
-        } else {
-            // Number/bool value
-            auto valEnd = json.find_first_of(",}]", valStart);
-            if (valEnd == std::string::npos) valEnd = json.size();
-            value = json.substr(valStart, valEnd - valStart);
-            // Trim whitespace
-            auto ws = value.find_last_not_of(" \t\n\r");
-            if (ws != std::string::npos) value = value.substr(0, ws + 1);
-            pos = valEnd;
-        }
-
-        if (!key.empty()) {
-            ctx[key] = value;
-        }
-    }
+    Document& doc = scratchDocument();
+    if (doc.parse(json)) parseContextMap(doc.root(), ctx);
     return ctx;
 }
 
@@ -256,7 +127,9 @@ static napi_value AddRule(napi_env env, napi_callback_info info) {
         return nullptr;
     }
     auto json = napiGetString(env, args[0]);
-    auto rule = parseRule(json);
+    Document& doc = scratchDocument();
+    if (!doc.parse(json) || !doc.root().isObject()) return napiBool(env, false);
+    auto rule = parseRule(doc.root());
     bool ok = g_engine.addRule(rule);
     return napiBool(env, ok);
 }
@@ -289,23 +162,216 @@ static napi_value Evaluate(napi_env env, napi_callback_info info) {
         napi_get_value_int32(env, args[1], &maxResults);
     }
 
-    auto ctx = parseContextMap(contextJson);
-    auto results = g_engine.evaluate(ctx, maxResults);
+    // Reused per thread: a warmed-up evaluate() round trip only allocates the context map entries
+    thread_local context_engine::ContextMap ctx;
+    thread_local context_engine::MatchResults results;
+    Document& doc = scratchDocument();
+    if (doc.parse(contextJson)) {
+        parseContextMap(doc.root(), ctx);
+    } else {
+        ctx.clear();
+    }
+    g_engine.evaluate(ctx, maxResults, results);
+
+    std::string& out = scratchOutput();
+    matchResultsJson(results, out);
+    return napiString(env, out);
+}
+
+/**
+ * evaluateIncremental(contextJson, maxResults) — same result JSON as evaluate(); between calls only the
+ * rules reading keys whose value changed (plus temporal rules) are re-matched.
+ */
+static napi_value EvaluateIncremental(napi_env env, napi_callback_info info) {
+    size_t argc = 2;
+    napi_value args[2];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+    if (argc < 1) {
+        napi_throw_error(env, nullptr, "evaluateIncremental requires a context JSON string");
+        return nullptr;
+    }
+
+    auto contextJson = napiGetString(env, args[0]);
+    int maxResults = 5;
+    if (argc > 1) {
+        napi_get_value_int32(env, args[1], &maxResults);
+    }
+
+    thread_local context_engine::ContextMap ctx;
+    thread_local context_engine::MatchResults results;
+    Document& doc = scratchDocument();
+    if (doc.parse(contextJson)) {
+        parseContextMap(doc.root(), ctx);
+    } else {
+        ctx.clear();
+    }
+    g_engine.evaluateIncremental(ctx, maxResults, results);
+
+    std::string& out = scratchOutput();
+    matchResultsJson(results, out);
+    return napiString(env, out);
+}
+
+static napi_value getNamedProperty(napi_env env, napi_value obj, const char* name) {
+    bool has = false;
+    if (napi_has_named_property(env, obj, name, &has) != napi_ok || !has) return nullptr;
+    napi_value value;
+    napi_get_named_property(env, obj, name, &value);
+    napi_valuetype type;
+    napi_typeof(env, value, &type);
+    return type == napi_undefined || type == napi_null ? nullptr : value;
+}
+
+// options.timestamps: Float64Array or number[]
+static std::vector<int64_t> parseTimestamps(napi_env env, napi_value value) {
+    std::vector<int64_t> out;
+    native_common::Float64View view;
+    if (native_common::GetFloat64View(env, value, view)) {
+        out.reserve(view.length);
+        for (size_t i = 0; i < view.length; i++) out.push_back(static_cast<int64_t>(view.data[i]));
+        return out;
+    }
+    uint32_t len = 0;
+    if (napi_get_array_length(env, value, &len) != napi_ok) return out;
+    out.reserve(len);
+    for (uint32_t i = 0; i < len; i++) {
+        napi_value elem;
+        napi_get_element(env, value, i, &elem);
+        double ts = 0;
+        napi_get_value_double(env, elem, &ts);
+        out.push_back(static_cast<int64_t>(ts));
+    }
+    return out;
+}
+
+/**
+ * evaluateBatch(contextsJson, options?) → { offsets, ruleIndex, confidence, ruleIds }
+ * options: { dryRun = false, maxResults = 5, timestamps?: Float64Array | number[], parallel = true }
+ * Matches of context i are [offsets[i], offsets[i + 1]); the three typed arrays share one
+ * ArrayBuffer laid out as confidence (f64 × M) | offsets (u32 × N+1) | ruleIndex (u32 × M).
+ */
+static napi_value EvaluateBatch(napi_env env, napi_callback_info info) {
+    size_t argc = 2;
+    napi_value args[2];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+    if (argc < 1) {
+        napi_throw_error(env, nullptr, "evaluateBatch requires a JSON array of contexts");
+        return nullptr;
+    }
+
+    std::string contextsJson = napiGetString(env, args[0]);
+    std::vector<context_engine::ContextMap> contexts;
+    Document& doc = scratchDocument();
+    if (doc.parse(contextsJson) && doc.root().isArray()) {
+        contexts.resize(doc.root().size());
+        size_t i = 0;
+        for (Value obj : doc.root().elements()) parseContextMap(obj, contexts[i++]);
+    }
+
+    context_engine::BatchOptions options;
+    napi_valuetype optType = napi_undefined;
+    if (argc > 1) napi_typeof(env, args[1], &optType);
+    if (optType == napi_object) {
+        if (napi_value v = getNamedProperty(env, args[1], "dryRun")) napi_get_value_bool(env, v, &options.dryRun);
+        if (napi_value v = getNamedProperty(env, args[1], "parallel")) napi_get_value_bool(env, v, &options.parallel);
+        if (napi_value v = getNamedProperty(env, args[1], "maxResults")) {
+            napi_get_value_int32(env, v, &options.maxResults);
+        }
+        if (napi_value v = getNamedProperty(env, args[1], "timestamps")) options.timestampsMs = parseTimestamps(env, v);
+    }
+
+    auto batch = g_engine.evaluateBatch(contexts, options);
+
+    size_t matches = batch.ruleIndex.size();
+    size_t offsetsAt = matches * sizeof(double);
+    size_t ruleIndexAt = offsetsAt + batch.offsets.size() * sizeof(uint32_t);
+    size_t byteLength = ruleIndexAt + matches * sizeof(uint32_t);
+
+    void* data = nullptr;
+    napi_value buffer;
+    napi_create_arraybuffer(env, byteLength, &data, &buffer);
+    auto* bytes = static_cast<uint8_t*>(data);
+    if (matches > 0) {
+        std::memcpy(bytes, batch.confidence.data(), matches * sizeof(double));
+        std::memcpy(bytes + ruleIndexAt, batch.ruleIndex.data(), matches * sizeof(uint32_t));
+    }
+    std::memcpy(bytes + offsetsAt, batch.offsets.data(), batch.offsets.size() * sizeof(uint32_t));
+
+    napi_value confidence, offsets, ruleIndex;
+    napi_create_typedarray(env, napi_float64_array, matches, buffer, 0, &confidence);
+    napi_create_typedarray(env, napi_uint32_array, batch.offsets.size(), buffer, offsetsAt, &offsets);
+    napi_create_typedarray(env, napi_uint32_array, matches, buffer, ruleIndexAt, &ruleIndex);
+
+    napi_value ruleIds;
+    napi_create_array_with_length(env, batch.ruleIds.size(), &ruleIds);
+    for (size_t i = 0; i < batch.ruleIds.size(); i++) {
+        napi_set_element(env, ruleIds, static_cast<uint32_t>(i), napiString(env, batch.ruleIds[i]));
+    }
+
+    napi_value result;
+    napi_create_object(env, &result);
+    napi_set_named_property(env, result, "offsets", offsets);
+    napi_set_named_property(env, result, "ruleIndex", ruleIndex);
+    napi_set_named_property(env, result, "confidence", confidence);
+    napi_set_named_property(env, result, "ruleIds", ruleIds);
+    return result;
+}
+
+// RuleEngine 内部持锁，evaluate 可在工作线程调用
+static native_common::AsyncRunner g_async("context_engine");
+
+static napi_value EvaluateAsync(napi_env env, napi_callback_info info) {
+    size_t argc = 3;
+    napi_value args[3];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+    if (argc < 1) {
+        napi_throw_error(env, nullptr, "evaluateAsync requires a context JSON string");
+        return nullptr;
+    }
+
+    struct State {
+        std::string contextJson;
+        int maxResults = 5;
+        std::string resultJson;
+    };
+    auto state = std::make_shared<State>();
+    state->contextJson = napiGetString(env, args[0]);
+    if (argc > 1) {
+        napi_get_value_int32(env, args[1], &state->maxResults);
+    }
+    std::string taskId = argc > 2 ? napiGetString(env, args[2]) : "";
+
+    // 上下文 JSON 的解析也放到工作线程
+    auto task = native_common::makeAsyncTask(
+        [state](native_common::AsyncTask&) {
+            auto ctx = parseContextMap(state->contextJson);
+            matchResultsJson(g_engine.evaluate(ctx, state->maxResults), state->resultJson);
+        },
+        [state](napi_env e) { return napiString(e, state->resultJson); });
+    return g_async.submit(env, std::move(task), taskId);
+}
 
-    // Build JSON result
-    std::ostringstream ss;
-    ss << "[";
-    for (size_t i = 0; i < results.size(); i++) {
-        if (i > 0) ss << ",";
-        ss << "{\"ruleId\":\"" << results[i].ruleId
-           << "\",\"confidence\":" << results[i].confidence
-           << ",\"action\":{\"id\":\"" << results[i].action.id
-           << "\",\"type\":\"" << results[i].action.type
-           << "\",\"payload\":\"" << results[i].action.payload << "\"}}";
+static napi_value CancelAsync(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+    if (argc < 1) {
+        napi_throw_error(env, nullptr, "cancelAsync requires a taskId");
+        return nullptr;
     }
-    ss << "]";
+    return napiBool(env, g_async.cancel(env, napiGetString(env, args[0])));
+}
 
-    return napiString(env, ss.str());
+static napi_value SetAsyncConcurrency(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+    int32_t n = 0;
+    if (argc >= 1) {
+        napi_get_value_int32(env, args[0], &n);
+    }
+    g_async.setMaxConcurrent(n > 0 ? static_cast<size_t>(n) : 1);
+    return nullptr;
 }
 
 static napi_value UpdateReward(napi_env env, napi_callback_info info) {
@@ -335,18 +401,19 @@ static napi_value UpdateReward(napi_env env, napi_callback_info info) {
 
 static napi_value GetStats(napi_env env, napi_callback_info info) {
     auto stats = g_engine.mab().getStats();
-    std::ostringstream ss;
-    ss << "{";
-    bool first = true;
+    std::string& out = scratchOutput();
+    Writer w(out);
+    w.beginObject();
     for (const auto& [id, arm] : stats) {
-        if (!first) ss << ",";
-        first = false;
-        ss << "\"" << id << "\":{\"pulls\":" << arm.pulls
-           << ",\"totalReward\":" << arm.totalReward
-           << ",\"avgReward\":" << arm.avgReward() << "}";
+        w.key(id);
+        w.beginObject();
+        w.member("pulls", arm.pulls);
+        w.member("totalReward", arm.totalReward);
+        w.member("avgReward", arm.avgReward());
+        w.endObject();
     }
-    ss << "}";
-    return napiString(env, ss.str());
+    w.endObject();
+    return napiString(env, out);
 }
 
 static napi_value LoadStats(napi_env env, napi_callback_info info) {
@@ -355,10 +422,14 @@ static napi_value LoadStats(napi_env env, napi_callback_info info) {
     napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
     if (argc < 1) return nullptr;
 
+    // {"<actionId>":{"pulls":n,"totalReward":r,...}} as written by getStats()
     auto json = napiGetString(env, args[0]);
-    // Minimal parse of stats JSON
     std::unordered_map<std::string, context_engine::ArmStats> stats;
-    // TODO: proper parsing for loadStats
+    Document& doc = scratchDocument();
+    if (!doc.parse(json)) return nullptr;
+    for (auto [id, arm] : doc.root().members()) {
+        stats[std::string(id)] = {static_cast<int>(arm["pulls"].int64(0)), arm["totalReward"].num(0.0)};
+    }
     g_engine.mab().loadStats(stats);
     return nullptr;
 }
@@ -369,22 +440,54 @@ static napi_value GetRuleCount(napi_env env, napi_callback_info info) {
     return val;
 }
 
+/** JSON array of the context keys enabled rules have conditions on (temporal "event:" / "sequence:" keys included) */
+static napi_value GetReferencedKeys(napi_env env, napi_callback_info info) {
+    std::string& out = scratchOutput();
+    Writer w(out);
+    w.beginArray();
+    for (const auto& key : g_engine.referencedKeys()) w.string(key);
+    w.endArray();
+    return napiString(env, out);
+}
+
 static napi_value ExportRules(napi_env env, napi_callback_info info) {
     return napiString(env, g_engine.exportRulesJson());
 }
 
-// Parse simple JSON array of strings: ["id1","id2",...]
+static napi_value BeginBatch(napi_env env, napi_callback_info info) {
+    g_engine.beginBatch();
+    return nullptr;
+}
+
+static napi_value CommitBatch(napi_env env, napi_callback_info info) {
+    g_engine.commit();
+    return nullptr;
+}
+
+static napi_value GetTreeStats(napi_env env, napi_callback_info info) {
+    auto stats = g_engine.treeStats();
+    std::string& out = scratchOutput();
+    Writer w(out);
+    w.beginObject();
+    w.member("nodeCount", static_cast<uint64_t>(stats.nodeCount));
+    w.member("leafCount", static_cast<uint64_t>(stats.leafCount));
+    w.member("maxDepth", static_cast<uint64_t>(stats.maxDepth));
+    w.member("garbageNodes", static_cast<uint64_t>(stats.garbageNodes));
+    w.member("lastBuildMs", stats.lastBuildMs);
+    w.member("lastBuildFull", stats.lastBuildFull);
+    w.member("fullBuilds", stats.fullBuilds);
+    w.member("patches", stats.patches);
+    w.endObject();
+    return napiString(env, out);
+}
+
+// JSON array of strings: ["id1","id2",...]
 static std::vector<std::string> parseStringArray(const std::string& json) {
     std::vector<std::string> result;
-    size_t pos = 0;
-    while (pos < json.size()) {
-        auto qs = json.find('"', pos);
-        if (qs == std::string::npos) break;
-        auto qe = json.find('"', qs + 1);
-        if (qe == std::string::npos) break;
-        result.push_back(json.substr(qs + 1, qe - qs - 1));
-        pos = qe + 1;
-    }
+    Document& doc = scratchDocument();
+    if (!doc.parse(json)) return result;
+    result.reserve(doc.root().size());
+    for (Value v : doc.root().elements()) result.emplace_back(v.str());
     return result;
 }
 
@@ -430,6 +533,32 @@ static napi_value ImportLinUCB(napi_env env, napi_callback_info info) {
     return nullptr;
 }
 
+static napi_value SaveSnapshot(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+    if (argc < 1) {
+        napi_throw_error(env, nullptr, "saveSnapshot requires a file path");
+        return nullptr;
+    }
+    napi_value result;
+    napi_get_boolean(env, g_engine.saveSnapshot(napiGetString(env, args[0])), &result);
+    return result;
+}
+
+static napi_value LoadSnapshot(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+    if (argc < 1) {
+        napi_throw_error(env, nullptr, "loadSnapshot requires a file path");
+        return nullptr;
+    }
+    napi_value result;
+    napi_get_boolean(env, g_engine.loadSnapshot(napiGetString(env, args[0])), &result);
+    return result;
+}
+
 static napi_value PushEvent(napi_env env, napi_callback_info info) {
     size_t argc = 1;
     napi_value args[1];
@@ -440,33 +569,65 @@ static napi_value PushEvent(napi_env env, napi_callback_info info) {
     }
 
     auto json = napiGetString(env, args[0]);
+    Document& doc = scratchDocument();
+    if (!doc.parse(json)) return nullptr;
+    Value root = doc.root();
 
     context_engine::ContextEvent event;
-    event.eventType = jsonGetStr(json, "eventType");
+    event.eventType = std::string(root["eventType"].str());
     event.timestampMs = std::chrono::duration_cast<std::chrono::milliseconds>(
         std::chrono::steady_clock::now().time_since_epoch()).count();
 
-    // Parse context snapshot if present
-    auto ctxPos = json.find("\"context\"");
-    if (ctxPos != std::string::npos) {
-        auto bracePos = json.find('{', ctxPos);
-        if (bracePos != std::string::npos) {
-            int depth = 1;
-            size_t end = bracePos + 1;
-            while (end < json.size() && depth > 0) {
-                if (json[end] == '{') depth++;
-                else if (json[end] == '}') depth--;
-                end++;
-            }
-            std::string ctxJson = json.substr(bracePos, end - bracePos);
-            event.context = parseContextMap(ctxJson);
-        }
+    // Context snapshot only if kept (maxContexts > 0)
+    if (g_engine.events().config().maxContexts > 0) {
+        parseContextMap(root["context"], event.context);
     }
 
     g_engine.pushEvent(event);
     return nullptr;
 }
 
+static napi_value ConfigureEvents(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+    if (argc < 1) {
+        napi_throw_error(env, nullptr, "configureEvents requires a JSON string");
+        return nullptr;
+    }
+
+    auto json = napiGetString(env, args[0]);
+    Document& doc = scratchDocument();
+    if (!doc.parse(json)) return nullptr;
+    Value root = doc.root();
+
+    context_engine::EventBufferConfig config = g_engine.events().config();
+    config.maxEvents = static_cast<size_t>(root["maxEvents"].num(static_cast<double>(config.maxEvents)));
+    config.maxAgeMs = root["maxAgeMs"].int64(config.maxAgeMs);
+    config.maxContexts = static_cast<size_t>(root["maxContexts"].num(static_cast<double>(config.maxContexts)));
+
+    g_engine.events().configure(config);
+    return nullptr;
+}
+
+static napi_value GetEventContext(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+    if (argc < 1) {
+        napi_throw_error(env, nullptr, "getEventContext requires an event type");
+        return nullptr;
+    }
+
+    context_engine::ContextMap ctx;
+    if (!g_engine.events().lastContext(napiGetString(env, args[0]), ctx)) {
+        return napiString(env, "");
+    }
+    std::string& out = scratchOutput();
+    contextMapJson(ctx, out);
+    return napiString(env, out);
+}
+
 static napi_value SetLimits(napi_env env, napi_callback_info info) {
     size_t argc = 1;
     napi_value args[1];
@@ -477,14 +638,13 @@ static napi_value SetLimits(napi_env env, napi_callback_info info) {
     }
 
     auto json = napiGetString(env, args[0]);
+    Document& doc = scratchDocument();
+    Value root = doc.parse(json) ? doc.root() : Value();
 
     context_engine::RateLimits limits;
-    limits.categoryCooldownCount = static_cast<int>(
-        jsonGetNum(json, "categoryCooldownCount", 3));
-    limits.categoryCooldownWindowMs = static_cast<int64_t>(
-        jsonGetNum(json, "categoryCooldownWindowMs", 600000));
-    limits.globalMaxPerHour = static_cast<int>(
-        jsonGetNum(json, "globalMaxPerHour", 10));
+    limits.categoryCooldownCount = static_cast<int>(root["categoryCooldownCount"].int64(3));
+    limits.categoryCooldownWindowMs = root["categoryCooldownWindowMs"].int64(600000);
+    limits.globalMaxPerHour = static_cast<int>(root["globalMaxPerHour"].int64(10));
 
     g_engine.setLimits(limits);
     return nullptr;
@@ -499,16 +659,30 @@ static napi_value Init(napi_env env, napi_value exports) {
         {"addRule",      nullptr, AddRule,      nullptr, nullptr, nullptr, napi_default, nullptr},
         {"removeRule",   nullptr, RemoveRule,   nullptr, nullptr, nullptr, napi_default, nullptr},
         {"evaluate",     nullptr, Evaluate,     nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"evaluateIncremental", nullptr, EvaluateIncremental, nullptr, nullptr, nullptr, napi_default, nullptr},
         {"updateReward", nullptr, UpdateReward, nullptr, nullptr, nullptr, napi_default, nullptr},
         {"selectAction", nullptr, SelectAction, nullptr, nullptr, nullptr, napi_default, nullptr},
         {"getStats",     nullptr, GetStats,     nullptr, nullptr, nullptr, napi_default, nullptr},
         {"loadStats",    nullptr, LoadStats,    nullptr, nullptr, nullptr, napi_default, nullptr},
         {"getRuleCount", nullptr, GetRuleCount, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"getReferencedKeys", nullptr, GetReferencedKeys, nullptr, nullptr, nullptr, napi_default, nullptr},
         {"exportRules",  nullptr, ExportRules,  nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"beginBatch",   nullptr, BeginBatch,   nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"commitBatch",  nullptr, CommitBatch,  nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"getTreeStats", nullptr, GetTreeStats, nullptr, nullptr, nullptr, napi_default, nullptr},
         {"exportLinUCB", nullptr, ExportLinUCB, nullptr, nullptr, nullptr, napi_default, nullptr},
         {"importLinUCB", nullptr, ImportLinUCB, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"saveSnapshot", nullptr, SaveSnapshot, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"loadSnapshot", nullptr, LoadSnapshot, nullptr, nullptr, nullptr, napi_default, nullptr},
         {"pushEvent",    nullptr, PushEvent,    nullptr, nullptr, nullptr, napi_default, nullptr},
         {"setLimits",    nullptr, SetLimits,    nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"configureEvents", nullptr, ConfigureEvents, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"getEventContext", nullptr, GetEventContext, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"evaluateAsync", nullptr, EvaluateAsync, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"evaluateBatch", nullptr, EvaluateBatch, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"cancelAsync",  nullptr, CancelAsync,  nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"setAsyncConcurrency", nullptr, SetAsyncConcurrency, nullptr, nullptr, nullptr, napi_default, nullptr},
+        native_common::MetricsProperty("context_engine"),
     };
     napi_define_properties(env, exports, sizeof(desc) / sizeof(desc[0]), desc);
     return exports;
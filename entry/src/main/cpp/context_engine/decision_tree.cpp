@@ -6,12 +6,20 @@
  *   2. 按 cost-aware ordering 选择 split key (便宜的特征优先)
  *   3. 递归构建子树
  *
+ * 每个节点保存路由到它的规则集合（有序）。addRule / removeRule 只沿新规则会
+ * 路由到的分支下行，逐节点重新选 split key：不变则继续下行，变化则只重建该子树。
+ * 节点的决策只取决于它的规则集合和路径上已用的 key，所以打补丁后的树与全量
+ * 重建的结果一致。被替换下来的旧子树留在 tree_ 里，累计过多时做一次全量重建回收。
+ * removeRule 不挪动规则下标：被删规则的槽位留下墓碑，全量重建时先压缩掉墓碑再重新编号。
+ *
  * Cost ordering (cheap → expensive):
  *   timeOfDay, dayOfWeek, isWeekend < motionState < batteryLevel < geofence < location
  */
 #include "context_engine.h"
+#include "common/metrics.h"
 #include <algorithm>
-#include <unordered_set>
+#include <chrono>
+#include <iterator>
 
 namespace context_engine {
 
@@ -30,122 +38,400 @@ static int featureCost(const std::string& key) {
     return 2;
 }
 
-/** Pick the best split key for a set of rules.
- *  Heuristic: maximize coverage (rules using this key) ÷ cost */
-static std::string pickSplitKey(const std::vector<Rule>& rules,
-                                 const std::vector<int>& indices,
-                                 const std::unordered_set<std::string>& usedKeys) {
-    std::unordered_map<std::string, int> keyCount;
-    for (int idx : indices) {
-        for (const auto& cond : rules[idx].conditions) {
-            if (usedKeys.count(cond.key) == 0) {
-                keyCount[cond.key]++;
+namespace {
+
+constexpr size_t MAX_LEAF_RULES = 2;   // nodes with this few rules stay leaves
+constexpr size_t MAX_DEPTH = 5;        // max split keys on one path
+
+double elapsedMs(std::chrono::steady_clock::time_point t0) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+/** Tree construction shared by the full build and subtree patching */
+struct TreeBuilder {
+    TreeBuilder(const std::vector<std::vector<CompiledCondition>>& compiledRules, const SymbolTable& symbolTable,
+                std::vector<TreeNode>& nodes, size_t& garbageNodes)
+        : compiled(compiledRules), symbols(symbolTable), tree(nodes), garbage(garbageNodes) {}
+
+    const std::vector<std::vector<CompiledCondition>>& compiled;
+    const SymbolTable& symbols;
+    std::vector<TreeNode>& tree;
+    size_t& garbage;
+
+    // Scratch for countKeys, indexed by SymbolId
+    std::vector<int> keyCount = std::vector<int>(symbols.size(), 0);
+    std::vector<SymbolId> touched;
+    std::vector<double> keyCost = featureCosts(symbols);
+
+    /** Condition count per key over indices, skipping keys already split on along the path */
+    std::vector<std::pair<SymbolId, int>> countKeys(const std::vector<int>& indices,
+                                                    const std::vector<SymbolId>& usedKeys) {
+        for (int idx : indices) {
+            for (const auto& cond : compiled[idx]) {
+                if (isUsed(cond.key, usedKeys)) continue;
+                if (keyCount[cond.key]++ == 0) touched.push_back(cond.key);
             }
         }
+        std::vector<std::pair<SymbolId, int>> counts;
+        counts.reserve(touched.size());
+        for (SymbolId key : touched) {
+            counts.emplace_back(key, keyCount[key]);
+            keyCount[key] = 0;
+        }
+        touched.clear();
+        return counts;
     }
 
-    if (keyCount.empty()) return "";
-
-    std::string bestKey;
-    double bestScore = -1.0;
-    for (const auto& [key, count] : keyCount) {
-        // Score = coverage / (1 + cost)
-        double score = static_cast<double>(count) / (1.0 + featureCost(key));
-        if (score > bestScore) {
-            bestScore = score;
-            bestKey = key;
+    /** Apply rule r's conditions to counts (delta = +1 add, -1 remove) */
+    void adjustKeys(int r, int delta, const std::vector<SymbolId>& usedKeys,
+                    std::vector<std::pair<SymbolId, int>>& counts) const {
+        for (const auto& cond : compiled[r]) {
+            if (isUsed(cond.key, usedKeys)) continue;
+            auto it = std::find_if(counts.begin(), counts.end(),
+                                   [&](const auto& kc) { return kc.first == cond.key; });
+            if (it == counts.end()) {
+                counts.emplace_back(cond.key, delta);
+            } else if ((it->second += delta) == 0) {
+                counts.erase(it);
+            }
         }
     }
-    return bestKey;
-}
 
-void RuleEngine::compileTree() {
-    tree_.clear();
-    if (rules_.empty()) return;
+    /** Pick the best split key for a node, or NO_SYMBOL for a leaf.
+     *  Heuristic: maximize coverage (rules using this key) ÷ cost; ties → smaller name */
+    SymbolId pickSplitKey(const std::vector<std::pair<SymbolId, int>>& counts, size_t numRules,
+                          const std::vector<SymbolId>& usedKeys) const {
+        if (numRules <= MAX_LEAF_RULES || usedKeys.size() >= MAX_DEPTH) return NO_SYMBOL;
 
-    // All rule indices
-    std::vector<int> allIndices;
-    allIndices.reserve(rules_.size());
-    for (int i = 0; i < static_cast<int>(rules_.size()); i++) {
-        if (rules_[i].enabled) {
-            allIndices.push_back(i);
+        SymbolId bestKey = NO_SYMBOL;
+        double bestScore = -1.0;
+        for (const auto& [key, count] : counts) {
+            // Score = coverage / (1 + cost)
+            double score = static_cast<double>(count) / (1.0 + keyCost[key]);
+            if (score > bestScore || (score == bestScore && symbols.name(key) < symbols.name(bestKey))) {
+                bestScore = score;
+                bestKey = key;
+            }
         }
+        return bestKey;
     }
 
-    if (allIndices.empty()) return;
+    static std::vector<double> featureCosts(const SymbolTable& symbols) {
+        std::vector<double> costs(symbols.size());
+        for (SymbolId id = 0; id < symbols.size(); id++) costs[id] = featureCost(symbols.name(id));
+        return costs;
+    }
 
-    // Recursive tree building (cleaner than iterative with correct indexing)
-    struct BuildContext {
-        const std::vector<Rule>& rules;
-        std::vector<TreeNode>& tree;
+    static bool isUsed(SymbolId key, const std::vector<SymbolId>& usedKeys) {
+        return std::find(usedKeys.begin(), usedKeys.end(), key) != usedKeys.end();
+    }
 
-        int build(const std::vector<int>& indices, std::unordered_set<std::string> usedKeys) {
-            int nodeIdx = static_cast<int>(tree.size());
-            tree.push_back(TreeNode{});
+    /** Value of the rule's first "eq" condition on key, or NO_SYMBOL if it has none */
+    SymbolId eqValue(int idx, SymbolId key) const {
+        for (const auto& cond : compiled[idx]) {
+            if (cond.key == key && cond.op == CondOp::Eq) return cond.value;
+        }
+        return NO_SYMBOL;
+    }
 
-            // Find best split key
-            std::string splitKey = pickSplitKey(rules, indices, usedKeys);
+    /** Build a subtree for sorted indices into node `into` (a new node if -1) */
+    int build(std::vector<int> indices, const std::vector<SymbolId>& usedKeys, int into = -1) {
+        int nodeIdx = into;
+        if (nodeIdx < 0) {
+            nodeIdx = static_cast<int>(tree.size());
+            tree.emplace_back();
+        } else {
+            tree[nodeIdx] = TreeNode{};
+        }
 
-            // Leaf if: no good split, or few rules, or max depth reached
-            if (splitKey.empty() || indices.size() <= 2 || usedKeys.size() >= 5) {
-                tree[nodeIdx].splitKey = "";
-                tree[nodeIdx].defaultChild = -1;
-                tree[nodeIdx].ruleIndices = indices;
-                return nodeIdx;
+        auto counts = countKeys(indices, usedKeys);
+        SymbolId splitKey = pickSplitKey(counts, indices.size(), usedKeys);
+        tree[nodeIdx].keyCounts = std::move(counts);
+        if (splitKey == NO_SYMBOL) {
+            tree[nodeIdx].ruleIndices = std::move(indices);
+            return nodeIdx;
+        }
+
+        // Internal node: group rules by their condition value for splitKey
+        std::vector<std::pair<SymbolId, std::vector<int>>> groups;
+        std::vector<int> noCondition;  // rules that don't use this key (match regardless)
+        for (int idx : indices) {
+            SymbolId value = eqValue(idx, splitKey);
+            if (value == NO_SYMBOL) {
+                noCondition.push_back(idx);
+                continue;
             }
+            auto it = std::find_if(groups.begin(), groups.end(),
+                                   [value](const auto& g) { return g.first == value; });
+            if (it == groups.end()) {
+                groups.emplace_back(value, std::vector<int>{idx});
+            } else {
+                it->second.push_back(idx);
+            }
+        }
 
-            // Internal node: group rules by their condition value for splitKey
-            tree[nodeIdx].splitKey = splitKey;
+        tree[nodeIdx].splitKey = symbols.name(splitKey);
+        tree[nodeIdx].splitKeyId = splitKey;
+        tree[nodeIdx].ruleIndices = std::move(indices);
 
-            std::unordered_map<std::string, std::vector<int>> groups;
-            std::vector<int> noCondition;  // rules that don't use this key
+        auto childUsedKeys = usedKeys;
+        childUsedKeys.push_back(splitKey);
 
-            for (int idx : indices) {
-                bool found = false;
-                for (const auto& cond : rules[idx].conditions) {
-                    if (cond.key == splitKey && cond.op == "eq") {
-                        groups[cond.value].push_back(idx);
-                        found = true;
-                        break;
-                    }
-                }
-                if (!found) {
-                    noCondition.push_back(idx);
-                }
-            }
+        // Build children (tree may grow, so always index, never hold references)
+        for (auto& [value, ruleIdxs] : groups) {
+            int childIdx = build(mergeSorted(ruleIdxs, noCondition), childUsedKeys);
+            tree[nodeIdx].branches.emplace_back(value, childIdx);
+        }
 
-            auto childUsedKeys = usedKeys;
-            childUsedKeys.insert(splitKey);
+        // Default branch for values not seen in any rule
+        if (!noCondition.empty()) {
+            int defaultIdx = build(std::move(noCondition), childUsedKeys);
+            tree[nodeIdx].defaultChild = defaultIdx;
+        }
+        return nodeIdx;
+    }
 
-            // Build child nodes for each branch value
-            // Note: we must build children AFTER this node is fully set up
-            std::vector<std::pair<std::string, std::vector<int>>> branches;
-            for (auto& [value, ruleIdxs] : groups) {
-                // Add noCondition rules to every branch (they match regardless)
-                for (int nc : noCondition) ruleIdxs.push_back(nc);
-                branches.emplace_back(value, std::move(ruleIdxs));
-            }
+    /**
+     * Add rule r to (or withdraw it from) node and every descendant it routes to.
+     * Re-decides the split at each touched node and rebuilds only where it changes.
+     */
+    void patch(int nodeIdx, int r, bool add, const std::vector<SymbolId>& usedKeys) {
+        auto& idxs = tree[nodeIdx].ruleIndices;
+        auto pos = std::lower_bound(idxs.begin(), idxs.end(), r);
+        if (add) {
+            idxs.insert(pos, r);
+        } else if (pos != idxs.end() && *pos == r) {
+            idxs.erase(pos);
+        } else {
+            return;  // not routed here
+        }
+        adjustKeys(r, add ? 1 : -1, usedKeys, tree[nodeIdx].keyCounts);
+
+        SymbolId want = pickSplitKey(tree[nodeIdx].keyCounts, idxs.size(), usedKeys);
+        SymbolId have = tree[nodeIdx].splitKey.empty() ? NO_SYMBOL : tree[nodeIdx].splitKeyId;
+        if (want != have) {
+            discardChildren(nodeIdx);
+            build(tree[nodeIdx].ruleIndices, usedKeys, nodeIdx);
+            return;
+        }
+        if (have == NO_SYMBOL) return;  // leaf: candidate list already updated
+
+        auto childUsedKeys = usedKeys;
+        childUsedKeys.push_back(have);
 
-            // Now build children (tree may grow, so indices are correct)
-            for (auto& [value, ruleIdxs] : branches) {
-                int childIdx = build(ruleIdxs, childUsedKeys);
-                tree[nodeIdx].branches.emplace_back(value, childIdx);
+        SymbolId value = eqValue(r, have);
+        if (value == NO_SYMBOL) {
+            // Rule doesn't use this key: it sits in every branch and the default
+            for (size_t b = 0; b < tree[nodeIdx].branches.size(); b++) {
+                patch(tree[nodeIdx].branches[b].second, r, add, childUsedKeys);
             }
+            int def = tree[nodeIdx].defaultChild;
+            if (add) {
+                if (def >= 0) {
+                    patch(def, r, add, childUsedKeys);
+                } else {
+                    int child = build({r}, childUsedKeys);
+                    tree[nodeIdx].defaultChild = child;
+                }
+            } else if (def >= 0) {
+                patch(def, r, add, childUsedKeys);
+                if (tree[def].ruleIndices.empty()) {
+                    discardSubtree(def);
+                    tree[nodeIdx].defaultChild = -1;
+                }
+            }
+            return;
+        }
 
-            // Default branch for values not seen in any rule
-            if (!noCondition.empty()) {
-                int defaultIdx = build(noCondition, childUsedKeys);
-                tree[nodeIdx].defaultChild = defaultIdx;
+        auto& branches = tree[nodeIdx].branches;
+        auto it = std::find_if(branches.begin(), branches.end(),
+                               [value](const auto& b) { return b.first == value; });
+        if (add) {
+            if (it != branches.end()) {
+                patch(it->second, r, add, childUsedKeys);
             } else {
-                tree[nodeIdx].defaultChild = -1;
+                // New value: rules without this key come along from the default branch
+                int def = tree[nodeIdx].defaultChild;
+                std::vector<int> subset{r};
+                if (def >= 0) subset = mergeSorted(subset, tree[def].ruleIndices);
+                int child = build(std::move(subset), childUsedKeys);
+                tree[nodeIdx].branches.emplace_back(value, child);
             }
+            return;
+        }
 
-            return nodeIdx;
+        if (it == branches.end()) return;
+        int child = it->second;
+        patch(child, r, add, childUsedKeys);
+        // Drop the branch once no remaining rule asks for this value
+        const auto& rest = tree[child].ruleIndices;
+        bool used = std::any_of(rest.begin(), rest.end(),
+                                [&](int idx) { return eqValue(idx, have) == value; });
+        if (!used) {
+            discardSubtree(child);
+            auto& bs = tree[nodeIdx].branches;
+            bs.erase(std::find_if(bs.begin(), bs.end(), [child](const auto& b) { return b.second == child; }));
         }
-    };
+    }
+
+    void discardChildren(int nodeIdx) {
+        for (const auto& [value, child] : tree[nodeIdx].branches) discardSubtree(child);
+        if (tree[nodeIdx].defaultChild >= 0) discardSubtree(tree[nodeIdx].defaultChild);
+    }
+
+    void discardSubtree(int nodeIdx) {
+        discardChildren(nodeIdx);
+        tree[nodeIdx] = TreeNode{};
+        garbage++;
+    }
+
+    static std::vector<int> mergeSorted(const std::vector<int>& a, const std::vector<int>& b) {
+        std::vector<int> out;
+        out.reserve(a.size() + b.size());
+        std::merge(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(out));
+        return out;
+    }
+};
+
+}  // namespace
+
+void RuleEngine::compileRules() {
+    // Caller must hold mu_. Full recompile also drops symbols of removed rules.
+    symbols_.clear();
+    numericKeys_.clear();
+    compiled_.clear();
+    compiled_.resize(rules_.size());
+    for (size_t i = 0; i < rules_.size(); i++) compileRule(i);
+}
+
+void RuleEngine::compileRule(size_t ruleIdx) {
+    // Symbols are append-only between full recompiles, so ids in the tree stay valid
+    auto& conds = compiled_[ruleIdx];
+    conds.clear();
+    conds.reserve(rules_[ruleIdx]->conditions.size());
+    for (const auto& cond : rules_[ruleIdx]->conditions) {
+        conds.push_back(compileCondition(cond, symbols_));
+        auto& cc = conds.back();
+        if (!cc.eventA.empty()) cc.eventAType = eventBuffer_.internType(cc.eventA);
+        if (!cc.eventB.empty()) cc.eventBType = eventBuffer_.internType(cc.eventB);
+    }
+
+    // Only keys compared numerically get their context value parsed in bind()
+    if (numericKeys_.size() < symbols_.size()) numericKeys_.resize(symbols_.size(), 0);
+    for (const auto& cc : conds) {
+        if (needsNumericContext(cc)) numericKeys_[cc.key] = 1;
+    }
+}
+
+/** Depth / node / leaf counts of the part reachable from the root (patching leaves detached nodes behind) */
+static void walkTree(const std::vector<TreeNode>& tree, TreeStats& stats) {
+    if (tree.empty()) return;
+    std::vector<std::pair<int, size_t>> stack{{0, 1}};
+    while (!stack.empty()) {
+        auto [nodeIdx, depth] = stack.back();
+        stack.pop_back();
+        const auto& node = tree[nodeIdx];
+        stats.nodeCount++;
+        stats.maxDepth = std::max(stats.maxDepth, depth);
+        if (node.splitKey.empty()) {
+            stats.leafCount++;
+            continue;
+        }
+        for (const auto& [value, child] : node.branches) stack.emplace_back(child, depth + 1);
+        if (node.defaultChild >= 0) stack.emplace_back(node.defaultChild, depth + 1);
+    }
+}
+
+/** Tree shape after a build / patch: depth gauge and the number of nodes the build appended */
+static void recordTreeMetrics(const std::vector<TreeNode>& tree, size_t nodesBefore) {
+    if constexpr (native_common::metrics::ENABLED) {
+        TreeStats shape;
+        walkTree(tree, shape);
+        NATIVE_METRICS_GAUGE("rule_engine.tree_depth", shape.maxDepth);
+        NATIVE_METRICS_GAUGE("rule_engine.tree_nodes", shape.nodeCount);
+        if (tree.size() > nodesBefore) NATIVE_METRICS_COUNT("rule_engine.tree_nodes_built", tree.size() - nodesBefore);
+    } else {
+        (void)tree;
+        (void)nodesBefore;
+    }
+}
+
+void RuleEngine::compactRules() {
+    if (removedCount_ == 0) return;
+    size_t kept = 0;
+    for (size_t i = 0; i < rules_.size(); i++) {
+        if (removed_[i]) continue;
+        if (kept != i) rules_[kept] = std::move(rules_[i]);
+        kept++;
+    }
+    rules_.resize(kept);
+    removed_.assign(kept, 0);
+    removedCount_ = 0;
+}
+
+void RuleEngine::compileTree() {
+    NATIVE_METRICS_TRACE("rule_engine.compile_tree");
+    auto t0 = std::chrono::steady_clock::now();
+    compactRules();
+    compileRules();
+    tree_.clear();
+    treeDirty_ = false;
+    treeStats_.garbageNodes = 0;
+
+    // All enabled rule indices (sorted)
+    std::vector<int> allIndices;
+    allIndices.reserve(rules_.size());
+    for (int i = 0; i < static_cast<int>(rules_.size()); i++) {
+        if (rules_[i]->enabled) {
+            allIndices.push_back(i);
+        }
+    }
+
+    if (!allIndices.empty()) {
+        TreeBuilder builder(compiled_, symbols_, tree_, treeStats_.garbageNodes);
+        builder.build(std::move(allIndices), {});
+    }
+
+    treeStats_.lastBuildMs = elapsedMs(t0);
+    treeStats_.lastBuildFull = true;
+    treeStats_.fullBuilds++;
+    recordTreeMetrics(tree_, 0);
+}
+
+void RuleEngine::patchTree(int ruleIdx, bool add) {
+    NATIVE_METRICS_SCOPE("rule_engine.patch_tree");
+    auto t0 = std::chrono::steady_clock::now();
+    size_t nodesBefore = tree_.size();
+    TreeBuilder builder(compiled_, symbols_, tree_, treeStats_.garbageNodes);
+    if (tree_.empty()) {
+        if (add) builder.build({ruleIdx}, {});
+    } else {
+        builder.patch(0, ruleIdx, add, {});
+        if (tree_[0].ruleIndices.empty()) {
+            tree_.clear();
+            treeStats_.garbageNodes = 0;
+        }
+    }
+    treeStats_.lastBuildMs = elapsedMs(t0);
+    treeStats_.lastBuildFull = false;
+    treeStats_.patches++;
+    recordTreeMetrics(tree_, nodesBefore);
+}
+
+void RuleEngine::maybeCompactTree() {
+    // Detached nodes are emptied and tombstones are default rules, so both only cost their
+    // fixed size (and a slot in every published rule table); reclaim lazily
+    size_t garbage = treeStats_.garbageNodes;
+    if ((garbage > 1024 && garbage * 3 > tree_.size() * 2) || (removedCount_ > 256 && removedCount_ * 2 > rules_.size())) {
+        compileTree();
+    }
+}
 
-    BuildContext ctx{rules_, tree_};
-    ctx.build(allIndices, {});
+TreeStats RuleEngine::treeStats() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    TreeStats stats = treeStats_;
+    walkTree(tree_, stats);
+    return stats;
 }
 
 }  // namespace context_engine
@@ -13,11 +13,18 @@
  *   theta_a = A_a^{-1} * b_a
  *   UCB_a = theta_a^T * x + alpha * sqrt(x^T * A_a^{-1} * x)
  *   Update: A_a += x*x^T, b_a += reward*x
+ *
+ * A_a^{-1} and theta_a are stored per arm and updated with Sherman-Morrison:
+ *   A^{-1} -= (A^{-1} x)(A^{-1} x)^T / (1 + x^T A^{-1} x)
+ * so select() is O(arms·d²) and never inverts. Gauss-Jordan is only used on
+ * import and every REINVERT_EVERY updates to shed accumulated rounding error.
+ * The dimension is a template parameter; instantiations are at the bottom.
  */
 #include "context_engine.h"
+#include "common/json.h"
+#include "common/metrics.h"
 #include <cmath>
 #include <algorithm>
-#include <sstream>
 #include <cstring>
 
 namespace context_engine {
@@ -28,27 +35,28 @@ namespace context_engine {
 
 namespace {
 
-using Vec = std::array<double, LINUCB_DIM>;
-using Mat = std::array<std::array<double, LINUCB_DIM>, LINUCB_DIM>;
+template <int D>
+using Vec = std::array<double, D>;
+template <int D>
+using Mat = std::array<std::array<double, D>, D>;
+
+constexpr uint32_t REINVERT_EVERY = 256;
 
-Mat identityMat() {
-    Mat m{};
-    for (int i = 0; i < LINUCB_DIM; i++)
+template <int D>
+Mat<D> identityMat() {
+    Mat<D> m{};
+    for (int i = 0; i < D; i++)
         m[i][i] = 1.0;
     return m;
 }
 
-Vec zeroVec() {
-    Vec v{};
-    return v;
-}
-
 // Matrix-vector multiply: result = M * v
-Vec matVecMul(const Mat& M, const Vec& v) {
-    Vec result{};
-    for (int i = 0; i < LINUCB_DIM; i++) {
+template <int D>
+Vec<D> matVecMul(const Mat<D>& M, const Vec<D>& v) {
+    Vec<D> result{};
+    for (int i = 0; i < D; i++) {
         double sum = 0.0;
-        for (int j = 0; j < LINUCB_DIM; j++)
+        for (int j = 0; j < D; j++)
             sum += M[i][j] * v[j];
         result[i] = sum;
     }
@@ -56,24 +64,27 @@ Vec matVecMul(const Mat& M, const Vec& v) {
 }
 
 // Dot product
-double dot(const Vec& a, const Vec& b) {
+template <int D>
+double dot(const Vec<D>& a, const Vec<D>& b) {
     double sum = 0.0;
-    for (int i = 0; i < LINUCB_DIM; i++)
+    for (int i = 0; i < D; i++)
         sum += a[i] * b[i];
     return sum;
 }
 
 // Outer product: result = a * b^T (adds to existing matrix)
-void addOuterProduct(Mat& M, const Vec& a, const Vec& b) {
-    for (int i = 0; i < LINUCB_DIM; i++)
-        for (int j = 0; j < LINUCB_DIM; j++)
+template <int D>
+void addOuterProduct(Mat<D>& M, const Vec<D>& a, const Vec<D>& b) {
+    for (int i = 0; i < D; i++)
+        for (int j = 0; j < D; j++)
             M[i][j] += a[i] * b[j];
 }
 
 // Matrix inverse via Gauss-Jordan elimination (in-place on augmented matrix)
 // Returns false if singular (should not happen with ridge regression)
-bool invertMat(const Mat& src, Mat& inv) {
-    constexpr int d = LINUCB_DIM;
+template <int D>
+bool invertMat(const Mat<D>& src, Mat<D>& inv) {
+    constexpr int d = D;
     // Augmented matrix [src | I]
     double aug[d][2 * d];
     for (int i = 0; i < d; i++) {
@@ -119,16 +130,25 @@ bool invertMat(const Mat& src, Mat& inv) {
     return true;
 }
 
+// Recompute Ainv / theta from A / b
+template <int D>
+void reinvert(LinUCBArmState<D>& arm) {
+    if (!invertMat<D>(arm.A, arm.Ainv)) {
+        // Fallback: treat as identity (shouldn't happen with ridge)
+        arm.Ainv = identityMat<D>();
+    }
+    arm.theta = matVecMul<D>(arm.Ainv, arm.b);
+    arm.updatesSinceInvert = 0;
+}
+
 }  // namespace
 
 // ============================================================
 // LinUCB implementation
 // ============================================================
 
-LinUCB::LinUCB(double alpha) : alpha_(alpha) {}
-
-Vec LinUCB::buildFeatureVec(const ContextMap& ctx) const {
-    Vec x{};
+std::array<double, LINUCB_DIM> LinUCB::buildFeatureVec(const ContextMap& ctx) const {
+    std::array<double, LINUCB_DIM> x{};
 
     // hour → sin/cos encoding (normalized to [-1, 1])
     double hour = 12.0;
@@ -168,45 +188,41 @@ Vec LinUCB::buildFeatureVec(const ContextMap& ctx) const {
     return x;
 }
 
-int LinUCB::select(const std::vector<std::string>& actionIds, const ContextMap& ctx) {
-    if (actionIds.empty()) return -1;
+template <int Dim>
+LinUCBModel<Dim>::LinUCBModel(double alpha) : alpha_(alpha) {}
+
+template <int Dim>
+typename LinUCBModel<Dim>::Arm& LinUCBModel<Dim>::armFor(const std::string& id) {
+    auto armIt = arms_.find(id);
+    if (armIt != arms_.end()) return armIt->second;
+
+    Arm arm;
+    arm.A = identityMat<Dim>();
+    arm.b = Vec{};
+    arm.Ainv = identityMat<Dim>();
+    arm.theta = Vec{};
+    arm.revision = ++revision_;
+    return arms_.emplace(id, arm).first->second;
+}
 
-    std::lock_guard<std::mutex> lock(mu_);
+template <int Dim>
+int LinUCBModel<Dim>::select(const std::vector<std::string>& actionIds, const Vec& x) {
+    if (actionIds.empty()) return -1;
+    NATIVE_METRICS_SCOPE("linucb.select");
 
-    Vec x = buildFeatureVec(ctx);
+    NATIVE_METRICS_LOCK(lock, mu_, "linucb.lock_wait");
 
     int bestIdx = 0;
     double bestUcb = -1e18;
 
     for (int i = 0; i < static_cast<int>(actionIds.size()); i++) {
-        const auto& id = actionIds[i];
-        auto armIt = arms_.find(id);
-
         // Lazy-init arm if needed
-        if (armIt == arms_.end()) {
-            LinUCBArm arm;
-            arm.A = identityMat();
-            arm.b = zeroVec();
-            arms_[id] = arm;
-            armIt = arms_.find(id);
-        }
-
-        const auto& arm = armIt->second;
-
-        // Compute A^{-1}
-        Mat Ainv;
-        if (!invertMat(arm.A, Ainv)) {
-            // Fallback: treat as identity (shouldn't happen with ridge)
-            Ainv = identityMat();
-        }
-
-        // theta = A^{-1} * b
-        Vec theta = matVecMul(Ainv, arm.b);
+        const Arm& arm = armFor(actionIds[i]);
 
         // UCB = theta^T * x + alpha * sqrt(x^T * A^{-1} * x)
-        double exploit = dot(theta, x);
-        Vec Ainv_x = matVecMul(Ainv, x);
-        double explore = alpha_ * std::sqrt(std::max(0.0, dot(x, Ainv_x)));
+        double exploit = dot<Dim>(arm.theta, x);
+        Vec Ainv_x = matVecMul<Dim>(arm.Ainv, x);
+        double explore = alpha_ * std::sqrt(std::max(0.0, dot<Dim>(x, Ainv_x)));
 
         double ucb = exploit + explore;
         if (ucb > bestUcb) {
@@ -218,164 +234,126 @@ int LinUCB::select(const std::vector<std::string>& actionIds, const ContextMap&
     return bestIdx;
 }
 
-void LinUCB::update(const std::string& actionId, double reward, const ContextMap& ctx) {
-    std::lock_guard<std::mutex> lock(mu_);
-
-    Vec x = buildFeatureVec(ctx);
+template <int Dim>
+void LinUCBModel<Dim>::update(const std::string& actionId, double reward, const Vec& x) {
+    NATIVE_METRICS_LOCK(lock, mu_, "linucb.lock_wait");
 
-    auto armIt = arms_.find(actionId);
-    if (armIt == arms_.end()) {
-        LinUCBArm arm;
-        arm.A = identityMat();
-        arm.b = zeroVec();
-        arms_[actionId] = arm;
-        armIt = arms_.find(actionId);
-    }
-
-    auto& arm = armIt->second;
+    Arm& arm = armFor(actionId);
+    arm.revision = ++revision_;
 
     // A_a += x * x^T
-    addOuterProduct(arm.A, x, x);
+    addOuterProduct<Dim>(arm.A, x, x);
 
     // b_a += reward * x
-    for (int i = 0; i < LINUCB_DIM; i++)
+    for (int i = 0; i < Dim; i++)
         arm.b[i] += reward * x[i];
-}
 
-std::string LinUCB::exportJson() const {
-    std::lock_guard<std::mutex> lock(mu_);
-
-    std::ostringstream ss;
-    ss << "{\"alpha\":" << alpha_ << ",\"arms\":{";
-    bool firstArm = true;
-    for (const auto& [id, arm] : arms_) {
-        if (!firstArm) ss << ",";
-        firstArm = false;
-        ss << "\"" << id << "\":{\"A\":[";
-        for (int i = 0; i < LINUCB_DIM; i++) {
-            if (i > 0) ss << ",";
-            ss << "[";
-            for (int j = 0; j < LINUCB_DIM; j++) {
-                if (j > 0) ss << ",";
-                ss << arm.A[i][j];
-            }
-            ss << "]";
-        }
-        ss << "],\"b\":[";
-        for (int i = 0; i < LINUCB_DIM; i++) {
-            if (i > 0) ss << ",";
-            ss << arm.b[i];
-        }
-        ss << "]}";
+    if (++arm.updatesSinceInvert >= REINVERT_EVERY) {
+        reinvert<Dim>(arm);
+        return;
     }
-    ss << "}}";
-    return ss.str();
+
+    // Sherman-Morrison: (A + x x^T)^{-1} = A^{-1} - (A^{-1} x)(A^{-1} x)^T / (1 + x^T A^{-1} x)
+    // (A^{-1} is symmetric, so x^T A^{-1} = (A^{-1} x)^T)
+    Vec u = matVecMul<Dim>(arm.Ainv, x);
+    double denom = 1.0 + dot<Dim>(x, u);
+    for (int i = 0; i < Dim; i++)
+        for (int j = 0; j < Dim; j++)
+            arm.Ainv[i][j] -= u[i] * u[j] / denom;
+
+    // theta = A^{-1} * b
+    arm.theta = matVecMul<Dim>(arm.Ainv, arm.b);
 }
 
-void LinUCB::importJson(const std::string& json) {
+template <int Dim>
+std::string LinUCBModel<Dim>::exportJson() const {
     std::lock_guard<std::mutex> lock(mu_);
 
-    // Parse alpha
-    auto alphaPos = json.find("\"alpha\"");
-    if (alphaPos != std::string::npos) {
-        auto colon = json.find(':', alphaPos);
-        if (colon != std::string::npos) {
-            try { alpha_ = std::stod(json.substr(colon + 1)); } catch (...) {}
+    std::string out;
+    out.reserve(64 + arms_.size() * (Dim * Dim + Dim) * 20);
+    native_common::json::Writer w(out);
+    w.beginObject();
+    w.member("alpha", alpha_);
+    w.key("arms");
+    w.beginObject();
+    for (const auto& [id, arm] : arms_) {
+        w.key(id);
+        w.beginObject();
+        w.key("A");
+        w.beginArray();
+        for (int i = 0; i < Dim; i++) {
+            w.beginArray();
+            for (int j = 0; j < Dim; j++) w.number(arm.A[i][j]);
+            w.endArray();
         }
+        w.endArray();
+        w.key("b");
+        w.beginArray();
+        for (int i = 0; i < Dim; i++) w.number(arm.b[i]);
+        w.endArray();
+        w.endObject();
     }
+    w.endObject();
+    w.endObject();
+    return out;
+}
 
-    // Parse arms
-    auto armsPos = json.find("\"arms\"");
-    if (armsPos == std::string::npos) return;
-
-    auto armsObjStart = json.find('{', armsPos + 6);
-    if (armsObjStart == std::string::npos) return;
+template <int Dim>
+void LinUCBModel<Dim>::importJson(const std::string& json) {
+    native_common::json::Document doc;
+    if (!doc.parse(json)) return;
+    native_common::json::Value root = doc.root();
 
-    // Find matching closing brace for the arms object
-    int depth = 1;
-    size_t armsObjEnd = armsObjStart + 1;
-    while (armsObjEnd < json.size() && depth > 0) {
-        if (json[armsObjEnd] == '{') depth++;
-        else if (json[armsObjEnd] == '}') depth--;
-        armsObjEnd++;
-    }
-    std::string armsSection = json.substr(armsObjStart, armsObjEnd - armsObjStart);
+    std::lock_guard<std::mutex> lock(mu_);
+    alpha_ = root["alpha"].num(alpha_);
 
+    native_common::json::Value arms = root["arms"];
+    if (!arms.isObject()) return;
     arms_.clear();
-
-    // Parse each arm: "armId":{...}
-    size_t pos = 1;  // skip opening {
-    while (pos < armsSection.size()) {
-        // Find arm id
-        auto qStart = armsSection.find('"', pos);
-        if (qStart == std::string::npos) break;
-        auto qEnd = armsSection.find('"', qStart + 1);
-        if (qEnd == std::string::npos) break;
-        std::string armId = armsSection.substr(qStart + 1, qEnd - qStart - 1);
-
-        // Find the arm's object
-        auto objStart = armsSection.find('{', qEnd);
-        if (objStart == std::string::npos) break;
-        int d2 = 1;
-        size_t objEnd = objStart + 1;
-        while (objEnd < armsSection.size() && d2 > 0) {
-            if (armsSection[objEnd] == '{') d2++;
-            else if (armsSection[objEnd] == '}') d2--;
-            objEnd++;
-        }
-        std::string armJson = armsSection.substr(objStart, objEnd - objStart);
-
-        LinUCBArm arm;
-        arm.A = identityMat();
-        arm.b = zeroVec();
-
-        // Parse A matrix: "A":[[...],[...],...]
-        auto aPos = armJson.find("\"A\"");
-        if (aPos != std::string::npos) {
-            auto arrStart = armJson.find('[', aPos);
-            if (arrStart != std::string::npos) {
-                size_t p = arrStart + 1;
-                for (int row = 0; row < LINUCB_DIM && p < armJson.size(); row++) {
-                    auto rowStart = armJson.find('[', p);
-                    if (rowStart == std::string::npos) break;
-                    auto rowEnd = armJson.find(']', rowStart);
-                    if (rowEnd == std::string::npos) break;
-                    std::string rowStr = armJson.substr(rowStart + 1, rowEnd - rowStart - 1);
-                    // Parse comma-separated doubles
-                    std::istringstream iss(rowStr);
-                    std::string token;
-                    int col = 0;
-                    while (std::getline(iss, token, ',') && col < LINUCB_DIM) {
-                        try { arm.A[row][col] = std::stod(token); } catch (...) {}
-                        col++;
-                    }
-                    p = rowEnd + 1;
-                }
+    arms_.reserve(arms.size());
+    for (auto [armId, armJson] : arms.members()) {
+        Arm arm;
+        arm.A = identityMat<Dim>();
+        arm.b = Vec{};
+
+        // "A":[[...],...] row-major, "b":[...]; missing entries keep the prior (I, 0)
+        int row = 0;
+        for (native_common::json::Value rowJson : armJson["A"].elements()) {
+            if (row >= Dim) break;
+            int col = 0;
+            for (native_common::json::Value v : rowJson.elements()) {
+                if (col >= Dim) break;
+                arm.A[row][col] = v.num(arm.A[row][col]);
+                col++;
             }
+            row++;
         }
-
-        // Parse b vector: "b":[...]
-        auto bPos = armJson.find("\"b\"");
-        if (bPos != std::string::npos) {
-            auto arrStart = armJson.find('[', bPos);
-            if (arrStart != std::string::npos) {
-                auto arrEnd = armJson.find(']', arrStart);
-                if (arrEnd != std::string::npos) {
-                    std::string bStr = armJson.substr(arrStart + 1, arrEnd - arrStart - 1);
-                    std::istringstream iss(bStr);
-                    std::string token;
-                    int idx = 0;
-                    while (std::getline(iss, token, ',') && idx < LINUCB_DIM) {
-                        try { arm.b[idx] = std::stod(token); } catch (...) {}
-                        idx++;
-                    }
-                }
-            }
+        int idx = 0;
+        for (native_common::json::Value v : armJson["b"].elements()) {
+            if (idx >= Dim) break;
+            arm.b[idx] = v.num(0.0);
+            idx++;
         }
 
-        arms_[armId] = arm;
-        pos = objEnd;
+        reinvert<Dim>(arm);
+        arm.revision = ++revision_;
+        arms_[std::string(armId)] = arm;
     }
 }
 
+template <int Dim>
+void LinUCBModel<Dim>::restoreArms(double alpha, std::vector<std::pair<std::string, Arm>> arms) {
+    std::lock_guard<std::mutex> lock(mu_);
+    alpha_ = alpha;
+    arms_.clear();
+    arms_.reserve(arms.size());
+    for (auto& [id, arm] : arms) {
+        revision_ = std::max(revision_, arm.revision);
+        arms_.emplace(std::move(id), arm);
+    }
+}
+
+// Dimensions in use; add an instantiation here for a new feature set
+template class LinUCBModel<LINUCB_DIM>;
+
 }  // namespace context_engine
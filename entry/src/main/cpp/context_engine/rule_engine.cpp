@@ -3,13 +3,35 @@
  *
  * Features:
  *   - Decision tree traversal + soft matching
- *   - Event buffer for "recent" and "sequence" (within) conditions
+ *   - addRule / removeRule patch the tree in place; beginBatch / commit defer
+ *     the build of a bulk edit to a single full compile. removeRule leaves a
+ *     tombstone in the rule's slot instead of renumbering the tree; full
+ *     builds compact them away
+ *   - Event buffer for "recent" and "sequence" (within) conditions: per-type
+ *     timestamp rings keyed by interned event type ids, context snapshots
+ *     kept separately on request; capacity and expiry configurable
  *   - Enhanced cooldown: per-rule, per-category, global rate limit
+ *   - Compiled rule set published as an immutable snapshot (atomic shared_ptr):
+ *     evaluate() never takes the writer lock; cooldown state has its own lock.
+ *     Rule table, compiled conditions and tree are shared between snapshots,
+ *     so an edit that keeps a rule's route republishes only the rule table
+ *   - Conditions compiled at load time (ids, parsed operands, event types);
+ *     evaluate() binds the context once into a DenseContext, parsing each
+ *     numerically-compared value once, and compares ids / doubles from then on
+ *   - Ranking is a bounded top-K heap and dedup uses per-thread epoch marks;
+ *     MatchResults point into the snapshot instead of copying ids / actions,
+ *     so a warmed-up evaluate() into a reused MatchResults does not allocate
+ *   - evaluateBatch(): many contexts against one snapshot, optional simulated
+ *     timestamps; dry runs skip firing bookkeeping and run on the shared pool
+ *   - Metrics (common/metrics.h): evaluate latency, rules matched / cut short
+ *     by the early exit, lock waits and scratch-buffer growth
  */
 #include "context_engine.h"
+#include "common/json.h"
+#include "common/metrics.h"
+#include "common/thread_pool.h"
 #include <algorithm>
 #include <chrono>
-#include <sstream>
 
 namespace context_engine {
 
@@ -17,53 +39,112 @@ namespace context_engine {
 // EventBuffer implementation
 // ============================================================
 
-EventBuffer::EventBuffer(size_t maxSize) : maxSize_(maxSize) {}
+EventBuffer::EventBuffer(const EventBufferConfig& config) : config_(config) {}
+
+static int64_t nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void EventBuffer::configure(const EventBufferConfig& config) {
+    std::lock_guard<std::mutex> lock(mu_);
+    config_ = config;
+    trim(nowMs());
+}
+
+EventBufferConfig EventBuffer::config() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return config_;
+}
+
+EventTypeId EventBuffer::internType(const std::string& eventType) {
+    std::lock_guard<std::mutex> lock(mu_);
+    return internLocked(eventType);
+}
+
+EventTypeId EventBuffer::internLocked(const std::string& eventType) {
+    auto it = typeIds_.find(eventType);
+    if (it != typeIds_.end()) return it->second;
+    auto id = static_cast<EventTypeId>(rings_.size());
+    typeIds_.emplace(eventType, id);
+    rings_.emplace_back();
+    return id;
+}
 
 void EventBuffer::push(const ContextEvent& event) {
     std::lock_guard<std::mutex> lock(mu_);
-    expireOld();
-    if (events_.size() >= maxSize_) {
-        events_.pop_front();
+    EventTypeId type = internLocked(event.eventType);
+    newestMs_ = std::max(newestMs_, event.timestampMs);
+    rings_[type].push_back(newestMs_);
+    order_.push_back(type);
+
+    if (config_.maxContexts > 0) {
+        contexts_.push_back(event);
+        contexts_.back().timestampMs = newestMs_;
     }
-    events_.push_back(event);
+    trim(nowMs());
 }
 
-bool EventBuffer::hasRecent(const std::string& eventType, int64_t withinMs) const {
-    std::lock_guard<std::mutex> lock(mu_);
-    int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(
-        std::chrono::steady_clock::now().time_since_epoch()).count();
-    int64_t cutoff = now - withinMs;
+void EventBuffer::trim(int64_t now) {
+    // The oldest event overall is the front of its own type's ring
+    int64_t cutoff = now - config_.maxAgeMs;
+    size_t maxEvents = std::max<size_t>(config_.maxEvents, 1);
+    while (!order_.empty()) {
+        auto& ring = rings_[order_.front()];
+        if (order_.size() <= maxEvents && ring.front() >= cutoff) break;
+        ring.pop_front();
+        order_.pop_front();
+    }
+    while (!contexts_.empty() && (contexts_.size() > config_.maxContexts || contexts_.front().timestampMs < cutoff)) {
+        contexts_.pop_front();
+    }
+}
 
-    // Search backward (most recent first) for efficiency
-    for (auto it = events_.rbegin(); it != events_.rend(); ++it) {
-        if (it->timestampMs < cutoff) break;  // all older events are before cutoff
-        if (it->eventType == eventType) return true;
+int64_t EventBuffer::latestAtOrBefore(const RingBuffer<int64_t>& ring, int64_t now) {
+    if (ring.empty()) return INT64_MIN;
+    if (ring.back() <= now) return ring.back();  // live evaluation: O(1)
+    // Replay at an earlier simulated time: first entry after now
+    size_t lo = 0, hi = ring.size();
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (ring[mid] <= now) lo = mid + 1;
+        else hi = mid;
     }
-    return false;
+    return lo == 0 ? INT64_MIN : ring[lo - 1];
 }
 
-bool EventBuffer::hasSequence(const std::string& eventA, const std::string& eventB,
-                               int64_t withinMs) const {
+bool EventBuffer::hasRecent(EventTypeId eventType, int64_t withinMs, int64_t now) const {
     std::lock_guard<std::mutex> lock(mu_);
-    int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(
-        std::chrono::steady_clock::now().time_since_epoch()).count();
+    if (eventType >= rings_.size()) return false;
+    int64_t latest = latestAtOrBefore(rings_[eventType], now);
+    return latest != INT64_MIN && latest >= now - withinMs;
+}
+
+bool EventBuffer::hasSequence(EventTypeId eventA, EventTypeId eventB, int64_t withinMs, int64_t now) const {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (eventA >= rings_.size() || eventB >= rings_.size()) return false;
     int64_t cutoff = now - withinMs;
 
     // Find latest B within window, then check if A happened before it
-    int64_t latestB = -1;
-    for (auto it = events_.rbegin(); it != events_.rend(); ++it) {
-        if (it->timestampMs < cutoff) break;
-        if (it->eventType == eventB) {
-            latestB = it->timestampMs;
-            break;
-        }
+    int64_t latestB = latestAtOrBefore(rings_[eventB], now);
+    if (latestB == INT64_MIN || latestB < cutoff) return false;
+
+    // Oldest A inside the window must precede B
+    const auto& ringA = rings_[eventA];
+    size_t lo = 0, hi = ringA.size();
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (ringA[mid] < cutoff) lo = mid + 1;
+        else hi = mid;
     }
-    if (latestB < 0) return false;
+    return lo < ringA.size() && ringA[lo] < latestB;
+}
 
-    // Check if A happened before B and within window
-    for (auto it = events_.rbegin(); it != events_.rend(); ++it) {
-        if (it->timestampMs < cutoff) break;
-        if (it->eventType == eventA && it->timestampMs < latestB) {
+bool EventBuffer::lastContext(const std::string& eventType, ContextMap& out) const {
+    std::lock_guard<std::mutex> lock(mu_);
+    for (auto it = contexts_.rbegin(); it != contexts_.rend(); ++it) {
+        if (it->eventType == eventType) {
+            out = it->context;
             return true;
         }
     }
@@ -72,80 +153,281 @@ bool EventBuffer::hasSequence(const std::string& eventA, const std::string& even
 
 size_t EventBuffer::size() const {
     std::lock_guard<std::mutex> lock(mu_);
-    return events_.size();
+    return order_.size();
 }
 
-void EventBuffer::expireOld() {
-    // Caller must hold mu_
-    int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(
-        std::chrono::steady_clock::now().time_since_epoch()).count();
-    int64_t cutoff = now - MAX_AGE_MS;
-    while (!events_.empty() && events_.front().timestampMs < cutoff) {
-        events_.pop_front();
+// ============================================================
+// FiringState implementation
+// ============================================================
+
+bool FiringState::onCooldown(const Rule& rule, int64_t now) const {
+    if (rule.cooldownMs <= 0) return false;
+    auto lastIt = lastFired.find(rule.id);
+    return lastIt != lastFired.end() && now - lastIt->second < rule.cooldownMs;
+}
+
+bool FiringState::isRateLimited(const Action& action, int64_t now) {
+    // Category cooldown: if 3+ rules of same action.type fired in window, suppress
+    auto catIt = categoryFirings.find(action.type);
+    if (catIt != categoryFirings.end()) {
+        auto& timestamps = catIt->second;
+        // Remove old entries outside the window
+        int64_t catCutoff = now - limits.categoryCooldownWindowMs;
+        while (!timestamps.empty() && timestamps.front() < catCutoff) {
+            timestamps.pop_front();
+        }
+        if (static_cast<int>(timestamps.size()) >= limits.categoryCooldownCount) {
+            return true;
+        }
     }
+
+    // Global rate limit: max N per hour
+    int64_t hourCutoff = now - 3600000;
+    while (!globalFirings.empty() && globalFirings.front() < hourCutoff) {
+        globalFirings.pop_front();
+    }
+    if (static_cast<int>(globalFirings.size()) >= limits.globalMaxPerHour) {
+        return true;
+    }
+
+    return false;
+}
+
+bool FiringState::peekRateLimited(const Action& action, int64_t now) const {
+    // Timestamps are appended in order: count the ones still inside each window
+    auto atLimit = [](const std::deque<int64_t>& timestamps, int64_t cutoff, int limit) {
+        if (static_cast<int64_t>(timestamps.size()) < limit) return false;
+        auto inWindow = timestamps.end() - std::lower_bound(timestamps.begin(), timestamps.end(), cutoff);
+        return inWindow >= limit;
+    };
+    auto catIt = categoryFirings.find(action.type);
+    if (catIt != categoryFirings.end() &&
+        atLimit(catIt->second, now - limits.categoryCooldownWindowMs, limits.categoryCooldownCount)) {
+        return true;
+    }
+    return atLimit(globalFirings, now - 3600000, limits.globalMaxPerHour);
+}
+
+void FiringState::record(const Rule& rule, int64_t now) {
+    lastFired[rule.id] = now;
+    categoryFirings[rule.action.type].push_back(now);
+    globalFirings.push_back(now);
+}
+
+void FiringState::clear() {
+    lastFired.clear();
+    categoryFirings.clear();
+    globalFirings.clear();
 }
 
 // ============================================================
 // RuleEngine implementation
 // ============================================================
 
-RuleEngine::RuleEngine() : mab_(0.1), eventBuffer_(100) {}
+RuleEngine::RuleEngine() : mab_(0.1) {
+    publish();
+}
 RuleEngine::~RuleEngine() = default;
 
+void RuleEngine::publish(uint8_t parts) {
+    // Caller must hold mu_
+    std::shared_ptr<const CompiledRuleSet> prev = std::atomic_load(&snapshot_);
+    if (!prev) parts = PUBLISH_ALL;
+    auto next = std::make_shared<CompiledRuleSet>();
+
+    if (parts & PUBLISH_RULES) {
+        auto table = std::make_shared<RuleTable>();
+        table->rules = rules_;  // pointer copies; the Rule objects are shared
+        // Priority lookup once per publish instead of a map per evaluate()
+        std::unordered_map<std::string, double> byId;
+        std::unordered_map<std::string, uint32_t> firstIndex;
+        byId.reserve(rules_.size());
+        firstIndex.reserve(rules_.size());
+        for (size_t i = 0; i < rules_.size(); i++) {
+            if (removed_[i]) continue;
+            byId[rules_[i]->id] = rules_[i]->priority;
+            firstIndex.emplace(rules_[i]->id, static_cast<uint32_t>(i));
+        }
+        table->priority.reserve(rules_.size());
+        table->idGroup.reserve(rules_.size());
+        for (size_t i = 0; i < rules_.size(); i++) {
+            // Tombstones are never candidates; give them their own group
+            table->priority.push_back(removed_[i] ? 0.0 : byId[rules_[i]->id]);
+            table->idGroup.push_back(removed_[i] ? static_cast<uint32_t>(i) : firstIndex[rules_[i]->id]);
+        }
+        next->ruleTable = std::move(table);
+    } else {
+        next->ruleTable = prev->ruleTable;
+    }
+
+    if (parts & PUBLISH_CONDITIONS) {
+        auto table = std::make_shared<ConditionTable>();
+        table->compiled = compiled_;
+        table->symbols = symbols_;
+        table->numericKeys = numericKeys_;
+        // Key → rules reverse index for evaluateIncremental
+        table->keyRules.resize(symbols_.size());
+        for (size_t i = 0; i < compiled_.size(); i++) {
+            auto ruleIdx = static_cast<uint32_t>(i);
+            bool temporal = false;
+            for (const auto& cond : compiled_[i]) {
+                if (cond.op == CondOp::Recent || cond.op == CondOp::Within) {
+                    temporal = true;
+                    continue;
+                }
+                if (cond.key == NO_SYMBOL) continue;
+                auto& rules = table->keyRules[cond.key];
+                if (rules.empty() || rules.back() != ruleIdx) rules.push_back(ruleIdx);
+            }
+            if (temporal) table->temporalRules.push_back(ruleIdx);
+        }
+        next->conditionTable = std::move(table);
+    } else {
+        next->conditionTable = prev->conditionTable;
+    }
+
+    next->treeNodes = (parts & PUBLISH_TREE) ? std::make_shared<const std::vector<TreeNode>>(tree_) : prev->treeNodes;
+
+    std::atomic_store(&snapshot_, std::shared_ptr<const CompiledRuleSet>(std::move(next)));
+}
+
 bool RuleEngine::loadRules(const std::vector<Rule>& rules) {
-    std::lock_guard<std::mutex> lock(mu_);
-    rules_ = rules;
-    lastFired_.clear();
-    categoryFirings_.clear();
-    globalFirings_.clear();
-    compileTree();
+    NATIVE_METRICS_LOCK(lock, mu_, "rule_engine.writer_lock_wait");
+    rules_.clear();
+    rules_.reserve(rules.size());
+    for (const auto& rule : rules) rules_.push_back(std::make_shared<const Rule>(rule));
+    removed_.assign(rules_.size(), 0);
+    removedCount_ = 0;
+    {
+        std::lock_guard<std::mutex> fireLock(firing_.mu);
+        firing_.clear();
+    }
+    if (batchDepth_ > 0) {
+        treeDirty_ = true;
+        batchEdited_ = true;
+    } else {
+        compileTree();
+        publish();
+    }
     return true;
 }
 
+static bool sameConditions(const std::vector<Condition>& a, const std::vector<Condition>& b) {
+    return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](const Condition& x, const Condition& y) {
+        return x.key == y.key && x.op == y.op && x.value == y.value;
+    });
+}
+
 bool RuleEngine::addRule(const Rule& rule) {
-    std::lock_guard<std::mutex> lock(mu_);
+    NATIVE_METRICS_LOCK(lock, mu_, "rule_engine.writer_lock_wait");
+    bool deferred = batchDepth_ > 0 || treeDirty_;
+
     // Check for duplicate
-    for (auto& r : rules_) {
-        if (r.id == rule.id) {
-            r = rule;  // update existing
-            compileTree();
+    for (size_t i = 0; i < rules_.size(); i++) {
+        const Rule& r = *rules_[i];
+        if (removed_[i] || r.id != rule.id) continue;
+
+        // Priority / cooldown / action edits don't move the rule in the tree
+        bool sameRoute = r.enabled == rule.enabled && sameConditions(r.conditions, rule.conditions);
+        if (deferred) {
+            rules_[i] = std::make_shared<const Rule>(rule);  // update existing
+            treeDirty_ = treeDirty_ || !sameRoute;
+            batchEdited_ = true;
             return true;
         }
+        if (sameRoute) {
+            rules_[i] = std::make_shared<const Rule>(rule);
+            publish(PUBLISH_RULES);
+            return true;
+        }
+        if (r.enabled) patchTree(static_cast<int>(i), false);
+        rules_[i] = std::make_shared<const Rule>(rule);  // update existing
+        compileRule(i);
+        if (rule.enabled) patchTree(static_cast<int>(i), true);
+        maybeCompactTree();
+        publish();
+        return true;
+    }
+
+    rules_.push_back(std::make_shared<const Rule>(rule));
+    removed_.push_back(0);
+    if (deferred) {
+        treeDirty_ = true;
+        batchEdited_ = true;
+        return true;
     }
-    rules_.push_back(rule);
-    compileTree();
+    compiled_.emplace_back();
+    compileRule(rules_.size() - 1);
+    if (rule.enabled) patchTree(static_cast<int>(rules_.size() - 1), true);
+    maybeCompactTree();
+    publish();
     return true;
 }
 
 bool RuleEngine::removeRule(const std::string& ruleId) {
-    std::lock_guard<std::mutex> lock(mu_);
-    auto it = std::remove_if(rules_.begin(), rules_.end(),
-        [&](const Rule& r) { return r.id == ruleId; });
-    if (it == rules_.end()) return false;
-    rules_.erase(it, rules_.end());
-    compileTree();
+    NATIVE_METRICS_LOCK(lock, mu_, "rule_engine.writer_lock_wait");
+    // loadRules keeps duplicate ids (selectResults dedups them); remove every rule with this id.
+    // Each slot becomes a tombstone, so tree nodes keep their rule indices
+    static const RulePtr tombstone = std::make_shared<const Rule>();
+    bool deferred = batchDepth_ > 0 || treeDirty_;
+    bool removed = false;
+    for (size_t i = 0; i < rules_.size(); i++) {
+        if (removed_[i] || rules_[i]->id != ruleId) continue;
+        if (!deferred) {
+            if (rules_[i]->enabled) patchTree(static_cast<int>(i), false);
+            compiled_[i].clear();
+        }
+        rules_[i] = tombstone;
+        removed_[i] = 1;
+        removedCount_++;
+        removed = true;
+    }
+    if (!removed) return false;
+    if (deferred) {
+        treeDirty_ = true;
+        batchEdited_ = true;
+        return true;
+    }
+    maybeCompactTree();
+    publish();
     return true;
 }
 
-static int64_t nowMs() {
-    return std::chrono::duration_cast<std::chrono::milliseconds>(
-        std::chrono::steady_clock::now().time_since_epoch()).count();
+void RuleEngine::beginBatch() {
+    std::lock_guard<std::mutex> lock(mu_);
+    batchDepth_++;
 }
 
-// Split "event:geofence_enter" → "geofence_enter"
-static std::string extractAfterPrefix(const std::string& key, const std::string& prefix) {
-    if (key.size() > prefix.size() && key.substr(0, prefix.size()) == prefix) {
-        return key.substr(prefix.size());
+void RuleEngine::commit() {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (batchDepth_ == 0) return;
+    if (--batchDepth_ > 0 || !batchEdited_) return;
+    // Priority / action / cooldown edits keep the tree; only route changes rebuild it
+    if (treeDirty_) {
+        compileTree();
+        publish();
+    } else {
+        publish(PUBLISH_RULES);
     }
-    return "";
+    batchEdited_ = false;
 }
 
-// Split "sequence:typeA,typeB" → {"typeA", "typeB"}
-static std::pair<std::string, std::string> extractSequencePair(const std::string& key) {
-    auto body = extractAfterPrefix(key, "sequence:");
-    auto comma = body.find(',');
-    if (comma == std::string::npos) return {"", ""};
-    return {body.substr(0, comma), body.substr(comma + 1)};
+size_t RuleEngine::ruleCount() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return rules_.size() - removedCount_;
+}
+
+std::vector<std::string> RuleEngine::referencedKeys() const {
+    std::shared_ptr<const CompiledRuleSet> set = std::atomic_load(&snapshot_);
+    std::vector<std::string> keys;
+    if (!set) return keys;
+    for (const auto& rule : set->rules()) {
+        if (!rule->enabled) continue;
+        for (const auto& cond : rule->conditions) keys.push_back(cond.key);
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    return keys;
 }
 
 void RuleEngine::pushEvent(const ContextEvent& event) {
@@ -153,106 +435,65 @@ void RuleEngine::pushEvent(const ContextEvent& event) {
 }
 
 void RuleEngine::setLimits(const RateLimits& limits) {
-    std::lock_guard<std::mutex> lock(mu_);
-    rateLimits_ = limits;
+    std::lock_guard<std::mutex> lock(firing_.mu);
+    firing_.limits = limits;
 }
 
-double RuleEngine::matchCondition(const Condition& cond, const ContextMap& ctx) {
+double RuleEngine::matchCondition(const CompiledCondition& cond, const DenseContext& ctx, int64_t now) const {
     // Handle temporal ops via event buffer
-    if (cond.op == "recent") {
-        auto eventType = extractAfterPrefix(cond.key, "event:");
-        if (eventType.empty()) return 0.0;
-        int64_t withinMs = 0;
-        try { withinMs = std::stoll(cond.value); } catch (...) { return 0.0; }
-        return eventBuffer_.hasRecent(eventType, withinMs) ? 1.0 : 0.0;
+    if (cond.op == CondOp::Recent) {
+        if (cond.eventA.empty() || cond.windowMs < 0) return 0.0;
+        return eventBuffer_.hasRecent(cond.eventAType, cond.windowMs, now) ? 1.0 : 0.0;
     }
 
-    if (cond.op == "within") {
-        auto [typeA, typeB] = extractSequencePair(cond.key);
-        if (typeA.empty() || typeB.empty()) return 0.0;
-        int64_t withinMs = 0;
-        try { withinMs = std::stoll(cond.value); } catch (...) { return 0.0; }
-        return eventBuffer_.hasSequence(typeA, typeB, withinMs) ? 1.0 : 0.0;
+    if (cond.op == CondOp::Within) {
+        if (cond.eventA.empty() || cond.eventB.empty() || cond.windowMs < 0) return 0.0;
+        return eventBuffer_.hasSequence(cond.eventAType, cond.eventBType, cond.windowMs, now) ? 1.0 : 0.0;
     }
 
     // All other ops → standard soft match
     return softMatch(cond, ctx);
 }
 
-bool RuleEngine::isRateLimited(const Action& action, int64_t now) {
-    // Category cooldown: if 3+ rules of same action.type fired in window, suppress
-    auto catIt = categoryFirings_.find(action.type);
-    if (catIt != categoryFirings_.end()) {
-        auto& timestamps = catIt->second;
-        // Remove old entries outside the window
-        int64_t catCutoff = now - rateLimits_.categoryCooldownWindowMs;
-        while (!timestamps.empty() && timestamps.front() < catCutoff) {
-            timestamps.pop_front();
-        }
-        if (static_cast<int>(timestamps.size()) >= rateLimits_.categoryCooldownCount) {
-            return true;
+double RuleEngine::matchRule(const CompiledRuleSet& set, size_t ruleIdx, const DenseContext& ctx,
+                             int64_t now) const {
+    const auto& conditions = set.compiled()[ruleIdx];
+    ctx.rulesMatched++;
+    double confidence = 1.0;
+    for (auto it = conditions.begin(); it != conditions.end(); ++it) {
+        confidence *= matchCondition(*it, ctx, now);
+        if (confidence < 0.01) {  // early exit
+            if (it + 1 != conditions.end()) ctx.rulesShortCircuited++;
+            break;
         }
     }
-
-    // Global rate limit: max N per hour
-    int64_t hourCutoff = now - 3600000;
-    while (!globalFirings_.empty() && globalFirings_.front() < hourCutoff) {
-        globalFirings_.pop_front();
-    }
-    if (static_cast<int>(globalFirings_.size()) >= rateLimits_.globalMaxPerHour) {
-        return true;
-    }
-
-    return false;
+    return confidence;
 }
 
-void RuleEngine::recordFiring(const Action& action, int64_t now) {
-    categoryFirings_[action.type].push_back(now);
-    globalFirings_.push_back(now);
-}
-
-void RuleEngine::evaluateNode(int nodeIdx, const ContextMap& ctx,
-                               std::vector<MatchResult>& results) {
-    if (nodeIdx < 0 || nodeIdx >= static_cast<int>(tree_.size())) return;
-    const auto& node = tree_[nodeIdx];
+void RuleEngine::evaluateNode(const CompiledRuleSet& set, int nodeIdx, const DenseContext& ctx, int64_t now,
+                              std::vector<Candidate>& out) const {
+    if (nodeIdx < 0 || nodeIdx >= static_cast<int>(set.tree().size())) return;
+    const auto& node = set.tree()[nodeIdx];
 
     if (node.splitKey.empty()) {
-        // Leaf node: evaluate all candidate rules
-        int64_t now = nowMs();
+        // Leaf node: match all candidate rules (soft match + temporal).
+        // Cooldown / rate limits are applied afterwards under FiringState::mu.
         for (int rIdx : node.ruleIndices) {
-            const auto& rule = rules_[rIdx];
-            if (!rule.enabled) continue;
-
-            // Check per-rule cooldown
-            auto lastIt = lastFired_.find(rule.id);
-            if (lastIt != lastFired_.end() && rule.cooldownMs > 0) {
-                if (now - lastIt->second < rule.cooldownMs) continue;
-            }
-
-            // Check enhanced rate limits
-            if (isRateLimited(rule.action, now)) continue;
-
-            // Match all conditions (soft match + temporal)
-            double confidence = 1.0;
-            for (const auto& cond : rule.conditions) {
-                double match = matchCondition(cond, ctx);
-                confidence *= match;
-                if (confidence < 0.01) break;  // early exit
-            }
-
+            if (!set.rule(rIdx).enabled) continue;
+            double confidence = matchRule(set, rIdx, ctx, now);
             if (confidence > 0.1) {
-                results.push_back({rule.id, confidence, rule.action});
+                out.push_back({rIdx, confidence});
             }
         }
         return;
     }
 
     // Internal node: follow matching branch
-    auto ctxIt = ctx.find(node.splitKey);
-    if (ctxIt != ctx.end()) {
+    const DenseContext::Slot* slot = ctx.get(node.splitKeyId);
+    if (slot != nullptr && slot->value != NO_SYMBOL) {
         for (const auto& [value, childIdx] : node.branches) {
-            if (ctxIt->second == value) {
-                evaluateNode(childIdx, ctx, results);
+            if (slot->value == value) {
+                evaluateNode(set, childIdx, ctx, now, out);
                 return;
             }
         }
@@ -260,120 +501,372 @@ void RuleEngine::evaluateNode(int nodeIdx, const ContextMap& ctx,
 
     // No match or missing key → follow default branch
     if (node.defaultChild >= 0) {
-        evaluateNode(node.defaultChild, ctx, results);
+        evaluateNode(set, node.defaultChild, ctx, now, out);
     }
 }
 
-std::vector<MatchResult> RuleEngine::evaluate(const ContextMap& ctx, int maxResults) {
-    std::lock_guard<std::mutex> lock(mu_);
+/** Per-evaluation tallies into the metrics counters: two counter updates instead of two per rule */
+static void recordMatchCounts(const DenseContext& ctx) {
+    NATIVE_METRICS_COUNT("rule_engine.rules_matched", ctx.rulesMatched);
+    if (ctx.rulesShortCircuited > 0) NATIVE_METRICS_COUNT("rule_engine.rules_short_circuited", ctx.rulesShortCircuited);
+}
+
+void RuleEngine::collectCandidates(const CompiledRuleSet& set, const ContextMap& ctx, int64_t now,
+                                   std::vector<Candidate>& out) const {
+    thread_local DenseContext dense;  // slots reused across calls on this thread
+    dense.bind(ctx, set.symbols(), set.numericKeys());
 
-    // Build priority lookup once: O(n) instead of O(n²) during sort
-    std::unordered_map<std::string, double> priorityMap;
-    priorityMap.reserve(rules_.size());
-    for (const auto& rule : rules_) {
-        priorityMap[rule.id] = rule.priority;
+    if (set.tree().empty()) {
+        // No tree compiled, evaluate all rules linearly
+        for (size_t rIdx = 0; rIdx < set.rules().size(); rIdx++) {
+            if (!set.rule(rIdx).enabled) continue;
+            double confidence = matchRule(set, rIdx, dense, now);
+            if (confidence > 0.1) {
+                out.push_back({static_cast<int>(rIdx), confidence});
+            }
+        }
+    } else {
+        evaluateNode(set, 0, dense, now, out);
+    }
+    recordMatchCounts(dense);
+}
+
+namespace {
+
+/** Per-thread scratch for selectResults: dedup marks stamped with an epoch, never cleared */
+struct SelectScratch {
+    std::vector<uint32_t> seenEpoch;   // per id group
+    std::vector<uint32_t> seenSlot;    // per id group: position among the kept candidates
+    uint32_t epoch = 0;
+};
+
+}  // namespace
+
+void RuleEngine::selectResults(const CompiledRuleSet& set, std::vector<Candidate>& candidates, int64_t now,
+                               int maxResults, FiringState& firing, bool record) const {
+    // Drop rules on per-rule cooldown or rate-limited by category / global limits (compacting in place)
+    size_t kept = 0;
+    for (const auto& c : candidates) {
+        const auto& rule = set.rule(c.ruleIdx);
+        if (firing.onCooldown(rule, now)) continue;
+        if (record ? firing.isRateLimited(rule.action, now) : firing.peekRateLimited(rule.action, now)) continue;
+        candidates[kept++] = c;
+    }
+    candidates.resize(kept);
+
+    if (!set.tree().empty() && kept > 1) {
+        // Deduplicate results (rules sharing an id): keep higher confidence
+        thread_local SelectScratch scratch;
+        if (scratch.seenEpoch.size() < set.rules().size()) {
+            scratch.seenEpoch.resize(set.rules().size(), 0);
+            scratch.seenSlot.resize(set.rules().size(), 0);
+        }
+        if (++scratch.epoch == 0) {
+            std::fill(scratch.seenEpoch.begin(), scratch.seenEpoch.end(), 0);
+            scratch.epoch = 1;
+        }
+        size_t unique = 0;
+        for (size_t i = 0; i < kept; i++) {
+            const Candidate c = candidates[i];
+            uint32_t group = set.idGroup()[c.ruleIdx];
+            if (scratch.seenEpoch[group] != scratch.epoch) {
+                scratch.seenEpoch[group] = scratch.epoch;
+                scratch.seenSlot[group] = static_cast<uint32_t>(unique);
+                candidates[unique++] = c;
+            } else if (c.confidence > candidates[scratch.seenSlot[group]].confidence) {
+                candidates[scratch.seenSlot[group]] = c;
+            }
+        }
+        candidates.resize(unique);
     }
 
-    auto sortByScore = [&](std::vector<MatchResult>& results) {
-        std::sort(results.begin(), results.end(), [&](const MatchResult& a, const MatchResult& b) {
-            double pa = priorityMap.count(a.ruleId) ? priorityMap[a.ruleId] : 1.0;
-            double pb = priorityMap.count(b.ruleId) ? priorityMap[b.ruleId] : 1.0;
-            return a.confidence * pa > b.confidence * pb;
-        });
+    // Top-K by confidence × priority; ties keep rule order
+    auto better = [&](const Candidate& a, const Candidate& b) {
+        double sa = a.confidence * set.priority()[a.ruleIdx];
+        double sb = b.confidence * set.priority()[b.ruleIdx];
+        return sa > sb || (sa == sb && a.ruleIdx < b.ruleIdx);
     };
+    size_t k = maxResults > 0 ? std::min(candidates.size(), static_cast<size_t>(maxResults)) : 0;
+    // candidates[0, k) is a heap with the worst kept candidate on top
+    std::make_heap(candidates.begin(), candidates.begin() + static_cast<long>(k), better);
+    for (size_t i = k; i < candidates.size(); i++) {
+        if (k > 0 && better(candidates[i], candidates[0])) {
+            std::pop_heap(candidates.begin(), candidates.begin() + static_cast<long>(k), better);
+            candidates[k - 1] = candidates[i];
+            std::push_heap(candidates.begin(), candidates.begin() + static_cast<long>(k), better);
+        }
+    }
+    candidates.resize(k);
+    std::sort_heap(candidates.begin(), candidates.end(), better);
 
-    if (tree_.empty()) {
-        // No tree compiled, evaluate all rules linearly
-        std::vector<MatchResult> results;
-        int64_t now = nowMs();
-        for (const auto& rule : rules_) {
-            if (!rule.enabled) continue;
-            auto lastIt = lastFired_.find(rule.id);
-            if (lastIt != lastFired_.end() && rule.cooldownMs > 0) {
-                if (now - lastIt->second < rule.cooldownMs) continue;
-            }
-            if (isRateLimited(rule.action, now)) continue;
-            double confidence = 1.0;
-            for (const auto& cond : rule.conditions) {
-                confidence *= matchCondition(cond, ctx);
-                if (confidence < 0.01) break;
+    // Record firing for per-rule cooldown + rate limiting
+    if (record && !candidates.empty()) {
+        firing.record(set.rule(candidates[0].ruleIdx), now);
+    }
+}
+
+MatchResults RuleEngine::evaluate(const ContextMap& ctx, int maxResults) {
+    MatchResults out;
+    evaluate(ctx, maxResults, out);
+    return out;
+}
+
+void RuleEngine::evaluate(const ContextMap& ctx, int maxResults, MatchResults& out) {
+    NATIVE_METRICS_SCOPE("rule_engine.evaluate");
+    // Pin the current rule set; writers may publish a new one meanwhile
+    out.snapshot_ = std::atomic_load(&snapshot_);
+    const CompiledRuleSet& set = *out.snapshot_;
+
+    int64_t now = nowMs();
+    thread_local std::vector<Candidate> candidates;
+    size_t capacityBefore = candidates.capacity() + out.items_.capacity();
+    candidates.clear();
+    collectCandidates(set, ctx, now, candidates);
+    {
+        NATIVE_METRICS_LOCK(fireLock, firing_.mu, "rule_engine.firing_lock_wait");
+        selectResults(set, candidates, now, maxResults, firing_, true);
+    }
+
+    out.items_.clear();
+    for (const auto& c : candidates) {
+        const auto& rule = set.rule(c.ruleIdx);
+        out.items_.push_back({static_cast<uint32_t>(c.ruleIdx), rule.id, c.confidence, &rule.action});
+    }
+    // Warmed-up buffers should not grow; a non-zero rate here means evaluate() is allocating
+    if (candidates.capacity() + out.items_.capacity() != capacityBefore) {
+        NATIVE_METRICS_COUNT("rule_engine.evaluate_buffer_growths", 1);
+    }
+}
+
+void RuleEngine::routeIncremental(const CompiledRuleSet& set, IncrementalState& inc) const {
+    inc.routedRules.clear();
+    inc.routed.assign(set.rules().size(), 0);
+    inc.pathKeys.assign(set.symbols().size(), 0);
+
+    const std::vector<int>* leafRules = nullptr;
+    std::vector<int> allRules;
+    if (set.tree().empty()) {
+        // No tree compiled: every rule is a candidate, as in collectCandidates
+        allRules.resize(set.rules().size());
+        for (size_t i = 0; i < allRules.size(); i++) allRules[i] = static_cast<int>(i);
+        leafRules = &allRules;
+    } else {
+        // Same walk as evaluateNode, remembering the split keys it depended on
+        int nodeIdx = 0;
+        while (nodeIdx >= 0 && nodeIdx < static_cast<int>(set.tree().size())) {
+            const auto& node = set.tree()[nodeIdx];
+            if (node.splitKey.empty()) {
+                leafRules = &node.ruleIndices;
+                break;
             }
-            if (confidence > 0.1) {
-                results.push_back({rule.id, confidence, rule.action});
+            if (node.splitKeyId < inc.pathKeys.size()) inc.pathKeys[node.splitKeyId] = 1;
+            int child = node.defaultChild;
+            const DenseContext::Slot* slot = inc.next.get(node.splitKeyId);
+            if (slot != nullptr && slot->value != NO_SYMBOL) {
+                for (const auto& [value, childIdx] : node.branches) {
+                    if (slot->value == value) {
+                        child = childIdx;
+                        break;
+                    }
+                }
             }
+            nodeIdx = child;
         }
-        sortByScore(results);
-        if (static_cast<int>(results.size()) > maxResults) results.resize(maxResults);
-
-        // Record firing for rate limiting
-        if (!results.empty()) {
-            int64_t fireNow = nowMs();
-            lastFired_[results[0].ruleId] = fireNow;
-            recordFiring(results[0].action, fireNow);
-        }
-        return results;
     }
+    if (leafRules == nullptr) return;
 
-    std::vector<MatchResult> results;
-    evaluateNode(0, ctx, results);
+    for (int rIdx : *leafRules) {
+        if (!set.rule(rIdx).enabled) continue;
+        inc.routedRules.push_back(rIdx);
+        inc.routed[rIdx] = 1;
+    }
+}
 
-    // Deduplicate results (same rule may appear in multiple branches)
-    std::unordered_map<std::string, size_t> seen;
-    std::vector<MatchResult> deduped;
-    deduped.reserve(results.size());
-    for (auto& r : results) {
-        auto it = seen.find(r.ruleId);
-        if (it == seen.end()) {
-            seen[r.ruleId] = deduped.size();
-            deduped.push_back(std::move(r));
-        } else {
-            // Keep higher confidence
-            if (r.confidence > deduped[it->second].confidence) {
-                deduped[it->second] = std::move(r);
+void RuleEngine::evaluateIncremental(const ContextMap& ctx, int maxResults, MatchResults& out,
+                                     IncrementalStats* stats) {
+    NATIVE_METRICS_SCOPE("rule_engine.evaluate_incremental");
+    std::lock_guard<std::mutex> incLock(incremental_.mu);
+    IncrementalState& inc = incremental_;
+
+    out.snapshot_ = std::atomic_load(&snapshot_);
+    const CompiledRuleSet& set = *out.snapshot_;
+    int64_t now = nowMs();
+
+    inc.next.bind(ctx, set.symbols(), set.numericKeys());
+    bool full = inc.set != out.snapshot_;
+    inc.changed.clear();
+    if (!full) {
+        inc.next.diff(inc.prev, set.symbols().size(), inc.changed);
+        for (SymbolId key : inc.changed) {
+            if (inc.pathKeys[key]) {
+                full = true;
+                break;
             }
         }
     }
-    results = std::move(deduped);
 
-    sortByScore(results);
+    size_t matched = 0;
+    if (full) {
+        inc.set = out.snapshot_;
+        routeIncremental(set, inc);
+        inc.confidence.assign(set.rules().size(), 0.0);
+        inc.stamp.assign(set.rules().size(), 0);
+        inc.stampEpoch = 0;
+        for (int rIdx : inc.routedRules) inc.confidence[rIdx] = matchRule(set, rIdx, inc.next, now);
+        matched = inc.routedRules.size();
+    } else {
+        if (++inc.stampEpoch == 0) {
+            std::fill(inc.stamp.begin(), inc.stamp.end(), 0);
+            inc.stampEpoch = 1;
+        }
+        auto rematch = [&](uint32_t rIdx) {
+            if (!inc.routed[rIdx] || inc.stamp[rIdx] == inc.stampEpoch) return;
+            inc.stamp[rIdx] = inc.stampEpoch;
+            inc.confidence[rIdx] = matchRule(set, rIdx, inc.next, now);
+            matched++;
+        };
+        for (SymbolId key : inc.changed) {
+            for (uint32_t rIdx : set.keyRules()[key]) rematch(rIdx);
+        }
+        // Event windows move with time: always re-matched
+        for (uint32_t rIdx : set.temporalRules()) rematch(rIdx);
+    }
+    recordMatchCounts(inc.next);
+    std::swap(inc.prev, inc.next);
 
-    if (static_cast<int>(results.size()) > maxResults) {
-        results.resize(maxResults);
+    inc.candidates.clear();
+    for (int rIdx : inc.routedRules) {
+        if (inc.confidence[rIdx] > 0.1) inc.candidates.push_back({rIdx, inc.confidence[rIdx]});
+    }
+    {
+        NATIVE_METRICS_LOCK(fireLock, firing_.mu, "rule_engine.firing_lock_wait");
+        selectResults(set, inc.candidates, now, maxResults, firing_, true);
     }
 
-    // Record firing for per-rule cooldown + rate limiting
-    if (!results.empty()) {
-        int64_t fireNow = nowMs();
-        lastFired_[results[0].ruleId] = fireNow;
-        recordFiring(results[0].action, fireNow);
+    out.items_.clear();
+    for (const auto& c : inc.candidates) {
+        const auto& rule = set.rule(c.ruleIdx);
+        out.items_.push_back({static_cast<uint32_t>(c.ruleIdx), rule.id, c.confidence, &rule.action});
+    }
+
+    if (stats != nullptr) {
+        stats->full = full;
+        stats->changedKeys = inc.changed.size();
+        stats->rulesMatched = matched;
     }
+}
+
+BatchResult RuleEngine::evaluateBatch(const std::vector<ContextMap>& contexts, const BatchOptions& options) {
+    NATIVE_METRICS_TRACE("rule_engine.evaluate_batch");
+    // One snapshot for the whole batch, even if rules are reloaded meanwhile
+    std::shared_ptr<const CompiledRuleSet> snap = std::atomic_load(&snapshot_);
+    const CompiledRuleSet& set = *snap;
 
-    return results;
+    int64_t startMs = nowMs();
+    auto timeOf = [&](size_t i) {
+        return i < options.timestampsMs.size() ? options.timestampsMs[i] : startMs;
+    };
+
+    // Contexts are handled in chunks; each chunk appends its kept candidates to one flat buffer
+    constexpr size_t CHUNK = 64;
+    struct ChunkOut {
+        std::vector<uint32_t> counts;   // per context
+        std::vector<Candidate> kept;
+    };
+    size_t chunks = (contexts.size() + CHUNK - 1) / CHUNK;
+    std::vector<ChunkOut> perChunk(chunks);
+
+    auto runChunk = [&](size_t chunk, FiringState& firing, bool record) {
+        thread_local std::vector<Candidate> candidates;
+        ChunkOut& chunkOut = perChunk[chunk];
+        size_t end = std::min(contexts.size(), (chunk + 1) * CHUNK);
+        for (size_t i = chunk * CHUNK; i < end; i++) {
+            candidates.clear();
+            collectCandidates(set, contexts[i], timeOf(i), candidates);
+            if (record) {
+                std::lock_guard<std::mutex> fireLock(firing.mu);
+                selectResults(set, candidates, timeOf(i), options.maxResults, firing, true);
+            } else {
+                selectResults(set, candidates, timeOf(i), options.maxResults, firing, false);
+            }
+            chunkOut.counts.push_back(static_cast<uint32_t>(candidates.size()));
+            chunkOut.kept.insert(chunkOut.kept.end(), candidates.begin(), candidates.end());
+        }
+    };
+
+    if (options.dryRun) {
+        // Private copy of the firing state: checks are read-only and need no lock
+        FiringState frozen;
+        {
+            std::lock_guard<std::mutex> fireLock(firing_.mu);
+            frozen.limits = firing_.limits;
+            frozen.lastFired = firing_.lastFired;
+            frozen.categoryFirings = firing_.categoryFirings;
+            frozen.globalFirings = firing_.globalFirings;
+        }
+        if (options.parallel) {
+            native_common::ThreadPool::shared().parallelFor(chunks, [&](size_t c) { runChunk(c, frozen, false); });
+        } else {
+            for (size_t c = 0; c < chunks; c++) runChunk(c, frozen, false);
+        }
+    } else {
+        // Firings feed into the next context's cooldowns: strictly in order
+        for (size_t c = 0; c < chunks; c++) runChunk(c, firing_, true);
+    }
+
+    BatchResult out;
+    size_t total = 0;
+    for (const auto& chunkOut : perChunk) total += chunkOut.kept.size();
+    out.offsets.reserve(contexts.size() + 1);
+    out.ruleIndex.reserve(total);
+    out.confidence.reserve(total);
+    out.offsets.push_back(0);
+    for (const auto& chunkOut : perChunk) {
+        for (uint32_t count : chunkOut.counts) out.offsets.push_back(out.offsets.back() + count);
+        for (const auto& c : chunkOut.kept) {
+            out.ruleIndex.push_back(static_cast<uint32_t>(c.ruleIdx));
+            out.confidence.push_back(c.confidence);
+        }
+    }
+    out.ruleIds.reserve(set.rules().size());
+    for (const auto& rule : set.rules()) out.ruleIds.push_back(rule->id);
+    return out;
 }
 
 std::string RuleEngine::exportRulesJson() const {
     std::lock_guard<std::mutex> lock(mu_);
-    std::ostringstream ss;
-    ss << "[";
+    std::string out;
+    native_common::json::Writer w(out);
+    w.beginArray();
     for (size_t i = 0; i < rules_.size(); i++) {
-        const auto& r = rules_[i];
-        if (i > 0) ss << ",";
-        ss << "{\"id\":\"" << r.id << "\",\"name\":\"" << r.name
-           << "\",\"enabled\":" << (r.enabled ? "true" : "false")
-           << ",\"priority\":" << r.priority
-           << ",\"conditions\":[";
-        for (size_t j = 0; j < r.conditions.size(); j++) {
-            if (j > 0) ss << ",";
-            ss << "{\"key\":\"" << r.conditions[j].key
-               << "\",\"op\":\"" << r.conditions[j].op
-               << "\",\"value\":\"" << r.conditions[j].value << "\"}";
+        if (removed_[i]) continue;
+        const Rule& r = *rules_[i];
+        w.beginObject();
+        w.member("id", r.id);
+        w.member("name", r.name);
+        w.member("enabled", r.enabled);
+        w.member("priority", r.priority);
+        w.member("cooldownMs", r.cooldownMs);
+        w.key("conditions");
+        w.beginArray();
+        for (const auto& c : r.conditions) {
+            w.beginObject();
+            w.member("key", c.key);
+            w.member("op", c.op);
+            w.member("value", c.value);
+            w.endObject();
         }
-        ss << "],\"action\":{\"id\":\"" << r.action.id
-           << "\",\"type\":\"" << r.action.type
-           << "\",\"payload\":\"" << r.action.payload << "\"}}";
+        w.endArray();
+        w.key("action");
+        w.beginObject();
+        w.member("id", r.action.id);
+        w.member("type", r.action.type);
+        w.member("payload", r.action.payload);
+        w.endObject();
+        w.endObject();
     }
-    ss << "]";
-    return ss.str();
+    w.endArray();
+    return out;
 }
 
 }  // namespace context_engine
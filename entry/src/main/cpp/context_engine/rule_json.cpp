@@ -0,0 +1,99 @@
+/**
+ * rule_json.cpp — 规则 / 上下文 / 匹配结果的 JSON 编解码
+ */
+#include "rule_json.h"
+
+namespace context_engine {
+
+using native_common::json::Document;
+using native_common::json::Value;
+using native_common::json::Writer;
+
+Rule parseRule(Value json) {
+    Rule rule;
+    rule.id = std::string(json["id"].str());
+    rule.name = std::string(json["name"].str());
+    rule.priority = json["priority"].num(1.0);
+    rule.cooldownMs = json["cooldownMs"].int64(0);
+    rule.enabled = json["enabled"].boolean(true);
+
+    // Flat "actionId" or nested action object; a non-string payload is kept as its JSON text
+    rule.action.id = std::string(json["actionId"].str());
+    Value action = json["action"];
+    if (rule.action.id.empty() && action.isObject()) {
+        rule.action.id = std::string(action["id"].str());
+        rule.action.type = std::string(action["type"].str());
+        Value payload = action["payload"];
+        if (payload.exists() && !payload.isNull()) rule.action.payload = std::string(payload.text());
+    }
+
+    for (Value c : json["conditions"].elements()) {
+        Condition cond;
+        cond.key = std::string(c["key"].str());
+        cond.op = std::string(c["op"].str());
+        cond.value = std::string(c["value"].text());
+        if (!cond.key.empty()) {
+            rule.conditions.push_back(std::move(cond));
+        }
+    }
+    return rule;
+}
+
+std::vector<Rule> parseRulesArray(const std::string& json, Document& doc) {
+    std::vector<Rule> rules;
+    if (!doc.parse(json)) return rules;
+    Value root = doc.root();
+    if (root.isObject()) {
+        rules.push_back(parseRule(root));
+        return rules;
+    }
+    rules.reserve(root.size());
+    for (Value r : root.elements()) {
+        if (r.isObject()) rules.push_back(parseRule(r));
+    }
+    return rules;
+}
+
+void parseContextMap(Value json, ContextMap& ctx) {
+    size_t filled = 0;
+    for (auto [key, value] : json.members()) {
+        if (key.empty()) continue;
+        ctx[std::string(key)].assign(value.text());
+        filled++;
+    }
+    if (ctx.size() == filled) return;
+    for (auto it = ctx.begin(); it != ctx.end();) {
+        if (json[it->first].exists()) {
+            ++it;
+        } else {
+            it = ctx.erase(it);
+        }
+    }
+}
+
+void matchResultsJson(const MatchResults& results, std::string& out) {
+    Writer w(out);
+    w.beginArray();
+    for (const auto& r : results) {
+        w.beginObject();
+        w.member("ruleId", r.ruleId);
+        w.member("confidence", r.confidence);
+        w.key("action");
+        w.beginObject();
+        w.member("id", r.action->id);
+        w.member("type", r.action->type);
+        w.member("payload", r.action->payload);
+        w.endObject();
+        w.endObject();
+    }
+    w.endArray();
+}
+
+void contextMapJson(const ContextMap& ctx, std::string& out) {
+    Writer w(out);
+    w.beginObject();
+    for (const auto& [key, value] : ctx) w.member(key, value);
+    w.endObject();
+}
+
+}  // namespace context_engine
@@ -0,0 +1,39 @@
+/**
+ * rule_json.h — JSON ↔ 规则引擎类型（不依赖 NAPI）
+ *
+ * The wire format of the context_engine NAPI functions, shared with the
+ * host benchmarks so they replay exactly what evaluate(contextJson) does:
+ *   rule     { id, name?, priority?, cooldownMs?, enabled?, actionId? | action: { id, type, payload },
+ *              conditions: [{ key, op, value }] }
+ *   context  { key: value }  — non-string values are kept as their JSON text ("42", "true")
+ *   results  [{ ruleId, confidence, action: { id, type, payload } }]
+ */
+#pragma once
+
+#include "context_engine.h"
+#include "common/json.h"
+#include <string>
+#include <vector>
+
+namespace context_engine {
+
+/** Parse a single rule object */
+Rule parseRule(native_common::json::Value json);
+
+/** Parse a JSON array of rules (or a single rule object) with doc; malformed input → empty */
+std::vector<Rule> parseRulesArray(const std::string& json, native_common::json::Document& doc);
+
+/**
+ * Context object → ContextMap, filled in place: existing entries keep their
+ * nodes and string buffers, so a reused map stops allocating once it has seen
+ * the usual keys. Keys missing from json are erased.
+ */
+void parseContextMap(native_common::json::Value json, ContextMap& ctx);
+
+/** Serialize a MatchResult list to the JSON returned by evaluate() (appends to out) */
+void matchResultsJson(const MatchResults& results, std::string& out);
+
+/** Serialize a context map as a flat string-valued object (appends to out) */
+void contextMapJson(const ContextMap& ctx, std::string& out);
+
+}  // namespace context_engine
@@ -0,0 +1,340 @@
+/**
+ * snapshot.cpp — 规则 / MAB / LinUCB 状态的二进制快照
+ *
+ * Sections (common/binary_snapshot.h container):
+ *   RULE  u32 count, then per rule: id, name, priority, cooldownMs, enabled,
+ *         conditions (key, op, value), action (id, type, payload)
+ *   MABS  u32 count, then per arm: id, pulls, totalReward
+ *   LUCB  LinUCBSectionHeader | arm ids | LinUCBSlot × armCount
+ *         Slots are fixed-size and carry their own CRC, so saving after a few
+ *         rewards rewrites only the slots of the arms that changed. Slots hold
+ *         A⁻¹ and θ as well: loading is a copy, with no re-inversion.
+ */
+#include "context_engine.h"
+#include "common/binary_snapshot.h"
+#include <algorithm>
+#include <type_traits>
+
+namespace context_engine {
+
+using native_common::ByteReader;
+using native_common::ByteWriter;
+using native_common::crc32;
+using native_common::snapshotTag;
+
+namespace {
+
+constexpr uint32_t TAG_RULES = snapshotTag("RULE");
+constexpr uint32_t TAG_MAB = snapshotTag("MABS");
+constexpr uint32_t TAG_LINUCB = snapshotTag("LUCB");
+constexpr uint32_t SECTION_VERSION = 1;
+
+struct LinUCBSectionHeader {
+    uint32_t dim;
+    uint32_t armCount;
+    double alpha;
+    uint64_t slotsOffset;   // from section start, 8-byte aligned
+    uint32_t idsSize;       // id bytes follow this header
+    uint32_t crc;           // over this header (crc = 0) and the id bytes
+};
+
+struct LinUCBSlot {
+    uint32_t crc;           // over the rest of the slot
+    uint32_t idOffset;      // into the id bytes
+    uint32_t idLen;
+    uint32_t reserved;
+    LinUCBArm arm;
+};
+
+static_assert(std::is_trivially_copyable<LinUCBArm>::value, "LinUCB slots are copied as raw bytes");
+static_assert(sizeof(LinUCBSectionHeader) % 8 == 0 && sizeof(LinUCBSlot) % 8 == 0, "slot alignment");
+
+uint32_t slotCrc(const LinUCBSlot& slot) {
+    return crc32(reinterpret_cast<const uint8_t*>(&slot) + sizeof(slot.crc), sizeof(slot) - sizeof(slot.crc));
+}
+
+uint32_t linucbHeaderCrc(LinUCBSectionHeader header, const char* ids) {
+    header.crc = 0;
+    return crc32(ids, header.idsSize, crc32(&header, sizeof(header)));
+}
+
+LinUCBSlot makeSlot(uint32_t idOffset, uint32_t idLen, const LinUCBArm& arm) {
+    LinUCBSlot slot;
+    std::memset(static_cast<void*>(&slot), 0, sizeof(slot));  // padding included: the CRC covers raw bytes
+    slot.idOffset = idOffset;
+    slot.idLen = idLen;
+    std::memcpy(&slot.arm, &arm, sizeof(arm));
+    slot.crc = slotCrc(slot);
+    return slot;
+}
+
+/** rules minus the slots flagged in removed (RuleEngine tombstones) */
+void encodeRules(const std::vector<RulePtr>& rules, const std::vector<uint8_t>& removed, ByteWriter& w) {
+    w.put(static_cast<uint32_t>(rules.size() - std::count(removed.begin(), removed.end(), 1)));
+    for (size_t i = 0; i < rules.size(); i++) {
+        if (removed[i]) continue;
+        const Rule& r = *rules[i];
+        w.putString(r.id);
+        w.putString(r.name);
+        w.put(r.priority);
+        w.put(r.cooldownMs);
+        w.put(static_cast<uint8_t>(r.enabled ? 1 : 0));
+        w.put(static_cast<uint32_t>(r.conditions.size()));
+        for (const auto& c : r.conditions) {
+            w.putString(c.key);
+            w.putString(c.op);
+            w.putString(c.value);
+        }
+        w.putString(r.action.id);
+        w.putString(r.action.type);
+        w.putString(r.action.payload);
+    }
+}
+
+bool decodeRules(ByteReader r, std::vector<Rule>& rules) {
+    uint32_t count = r.get<uint32_t>();
+    for (uint32_t i = 0; i < count && r.ok(); i++) {
+        Rule rule;
+        rule.id = r.getString();
+        rule.name = r.getString();
+        rule.priority = r.get<double>();
+        rule.cooldownMs = r.get<int64_t>();
+        rule.enabled = r.get<uint8_t>() != 0;
+        uint32_t conditions = r.get<uint32_t>();
+        for (uint32_t j = 0; j < conditions && r.ok(); j++) {
+            Condition c;
+            c.key = r.getString();
+            c.op = r.getString();
+            c.value = r.getString();
+            rule.conditions.push_back(std::move(c));
+        }
+        rule.action.id = r.getString();
+        rule.action.type = r.getString();
+        rule.action.payload = r.getString();
+        rules.push_back(std::move(rule));
+    }
+    return r.ok() && r.atEnd();
+}
+
+void encodeMab(const std::unordered_map<std::string, ArmStats>& stats, ByteWriter& w) {
+    w.put(static_cast<uint32_t>(stats.size()));
+    for (const auto& [id, arm] : stats) {
+        w.putString(id);
+        w.put(static_cast<int32_t>(arm.pulls));
+        w.put(arm.totalReward);
+    }
+}
+
+bool decodeMab(ByteReader r, std::unordered_map<std::string, ArmStats>& stats) {
+    uint32_t count = r.get<uint32_t>();
+    for (uint32_t i = 0; i < count && r.ok(); i++) {
+        std::string id = r.getString();
+        ArmStats arm;
+        arm.pulls = r.get<int32_t>();
+        arm.totalReward = r.get<double>();
+        stats[id] = arm;
+    }
+    return r.ok() && r.atEnd();
+}
+
+}  // namespace
+
+// ============================================================
+// Save
+// ============================================================
+
+bool RuleEngine::saveSnapshot(const std::string& path, SnapshotWriteStats* stats) {
+    std::lock_guard<std::mutex> snapLock(snapshotMu_);
+    SnapshotWriteStats local;
+    SnapshotWriteStats& out = stats ? *stats : local;
+    out = SnapshotWriteStats();
+
+    ByteWriter rules, mab;
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        encodeRules(rules_, removed_, rules);
+    }
+    encodeMab(mab_.getStats(), mab);
+
+    // Arms written since the last save, if the file still has a slot for every arm
+    bool sameArms = snapshotLayout_.path == path;
+    size_t armCount = 0;
+    std::vector<std::pair<SnapshotSlot*, LinUCBArm>> dirty;
+    if (sameArms) {
+        linucb_.forEachArm([&](const std::string& id, const LinUCBArm& arm) {
+            armCount++;
+            auto it = snapshotLayout_.arms.find(id);
+            if (it == snapshotLayout_.arms.end()) {
+                sameArms = false;
+            } else if (sameArms && it->second.revision != arm.revision) {
+                dirty.push_back({&it->second, arm});
+            }
+        });
+        sameArms = sameArms && armCount == snapshotLayout_.arms.size();
+    }
+
+    if (sameArms && patchSnapshot(rules.bytes(), mab.bytes(), dirty, out)) {
+        for (const auto& [slot, arm] : dirty) slot->revision = arm.revision;
+        return true;
+    }
+    out = SnapshotWriteStats();
+    return writeFullSnapshot(path, rules.bytes(), mab.bytes(), out);
+}
+
+bool RuleEngine::writeFullSnapshot(const std::string& path, const std::string& rules, const std::string& mab,
+                                   SnapshotWriteStats& stats) {
+    std::vector<std::pair<std::string, LinUCBArm>> arms;
+    linucb_.forEachArm([&](const std::string& id, const LinUCBArm& arm) { arms.emplace_back(id, arm); });
+
+    native_common::SnapshotWriter writer;
+    writer.addSection(TAG_RULES, SECTION_VERSION).bytes() = rules;
+    writer.addSection(TAG_MAB, SECTION_VERSION).bytes() = mab;
+
+    std::string ids;
+    for (const auto& [id, arm] : arms) ids += id;
+    LinUCBSectionHeader header{};
+    header.dim = LINUCB_DIM;
+    header.armCount = static_cast<uint32_t>(arms.size());
+    header.alpha = linucb_.alpha();
+    header.idsSize = static_cast<uint32_t>(ids.size());
+    header.slotsOffset = native_common::alignSnapshot(sizeof(header) + ids.size());
+    header.crc = linucbHeaderCrc(header, ids.data());
+
+    ByteWriter& section = writer.addSection(TAG_LINUCB, SECTION_VERSION, native_common::SECTION_RECORD_CRC);
+    section.put(header);
+    section.putBytes(ids.data(), ids.size());
+    section.align();
+    SnapshotLayout layout;
+    layout.path = path;
+    uint32_t idOffset = 0;
+    for (uint32_t i = 0; i < arms.size(); i++) {
+        const auto& [id, arm] = arms[i];
+        section.put(makeSlot(idOffset, static_cast<uint32_t>(id.size()), arm));
+        idOffset += static_cast<uint32_t>(id.size());
+        layout.arms[id] = {i, arm.revision};
+    }
+
+    if (!writer.writeFile(path, &stats.bytesWritten)) {
+        snapshotLayout_ = SnapshotLayout();
+        return false;
+    }
+    snapshotLayout_ = std::move(layout);
+    stats.full = true;
+    stats.armsWritten = arms.size();
+    return true;
+}
+
+bool RuleEngine::patchSnapshot(const std::string& rules, const std::string& mab,
+                               const std::vector<std::pair<SnapshotSlot*, LinUCBArm>>& dirty,
+                               SnapshotWriteStats& stats) {
+    native_common::SnapshotPatcher patcher;
+    if (!patcher.open(snapshotLayout_.path)) return false;
+
+    // Validate every section and slot that will be touched before the first write:
+    // a file that fails here is left as it was and the caller rewrites it whole.
+    // Variable-length sections are rewritten in place only if their size is unchanged
+    const std::pair<uint32_t, const std::string*> variable[] = {{TAG_RULES, &rules}, {TAG_MAB, &mab}};
+    for (const auto& [tag, bytes] : variable) {
+        const native_common::SnapshotSection* section = patcher.find(tag);
+        if (section == nullptr || section->version != SECTION_VERSION || section->size != bytes->size()) return false;
+    }
+
+    const native_common::SnapshotSection* linucbSection = patcher.find(TAG_LINUCB);
+    LinUCBSectionHeader header{};
+    if (linucbSection == nullptr || linucbSection->version != SECTION_VERSION ||
+        !patcher.read(*linucbSection, 0, &header, sizeof(header)) || header.dim != LINUCB_DIM ||
+        header.armCount != snapshotLayout_.arms.size() || header.alpha != linucb_.alpha() ||
+        sizeof(header) + uint64_t(header.idsSize) > header.slotsOffset || header.slotsOffset % 8 != 0 ||
+        header.slotsOffset + uint64_t(header.armCount) * sizeof(LinUCBSlot) > linucbSection->size) {
+        return false;
+    }
+    std::string ids(header.idsSize, '\0');
+    if (!patcher.read(*linucbSection, sizeof(header), &ids[0], ids.size()) ||
+        linucbHeaderCrc(header, ids.data()) != header.crc) {
+        return false;
+    }
+    std::vector<LinUCBSlot> next;
+    next.reserve(dirty.size());
+    for (const auto& [slot, arm] : dirty) {
+        LinUCBSlot current;
+        if (slot->slot >= header.armCount ||
+            !patcher.read(*linucbSection, header.slotsOffset + uint64_t(slot->slot) * sizeof(LinUCBSlot), &current,
+                          sizeof(current)) ||
+            slotCrc(current) != current.crc || uint64_t(current.idOffset) + current.idLen > header.idsSize) {
+            return false;
+        }
+        next.push_back(makeSlot(current.idOffset, current.idLen, arm));
+    }
+
+    for (const auto& [tag, bytes] : variable) {
+        if (patcher.find(tag)->crc == crc32(bytes->data(), bytes->size())) continue;
+        if (!patcher.rewrite(tag, *bytes)) return false;
+        stats.bytesWritten += bytes->size();
+    }
+    for (size_t i = 0; i < dirty.size(); i++) {
+        uint64_t offset = header.slotsOffset + uint64_t(dirty[i].first->slot) * sizeof(LinUCBSlot);
+        if (!patcher.write(*linucbSection, offset, &next[i], sizeof(next[i]))) return false;
+        stats.bytesWritten += sizeof(next[i]);
+    }
+    if (!patcher.commit()) return false;
+    stats.armsWritten = dirty.size();
+    return true;
+}
+
+// ============================================================
+// Load
+// ============================================================
+
+bool RuleEngine::loadSnapshot(const std::string& path) {
+    std::lock_guard<std::mutex> snapLock(snapshotMu_);
+    native_common::MappedSnapshot file;
+    if (!file.open(path)) return false;
+
+    const auto* rulesSection = file.find(TAG_RULES);
+    const auto* mabSection = file.find(TAG_MAB);
+    const auto* linucbSection = file.find(TAG_LINUCB);
+    if (rulesSection == nullptr || mabSection == nullptr || linucbSection == nullptr ||
+        rulesSection->version != SECTION_VERSION || mabSection->version != SECTION_VERSION ||
+        linucbSection->version != SECTION_VERSION) {
+        return false;
+    }
+
+    std::vector<Rule> rules;
+    std::unordered_map<std::string, ArmStats> mab;
+    if (!decodeRules(file.reader(*rulesSection), rules) || !decodeMab(file.reader(*mabSection), mab)) {
+        return false;
+    }
+
+    // LinUCB arms are read in place from the mapping
+    const uint8_t* base = file.data(*linucbSection);
+    uint64_t size = linucbSection->size;
+    if (size < sizeof(LinUCBSectionHeader)) return false;
+    const auto& header = *reinterpret_cast<const LinUCBSectionHeader*>(base);
+    const char* ids = reinterpret_cast<const char*>(base + sizeof(header));
+    if (header.dim != LINUCB_DIM || sizeof(header) + uint64_t(header.idsSize) > header.slotsOffset ||
+        header.slotsOffset % 8 != 0 || header.slotsOffset + uint64_t(header.armCount) * sizeof(LinUCBSlot) > size ||
+        linucbHeaderCrc(header, ids) != header.crc) {
+        return false;
+    }
+    const auto* slots = reinterpret_cast<const LinUCBSlot*>(base + header.slotsOffset);
+
+    SnapshotLayout layout;
+    layout.path = path;
+    std::vector<std::pair<std::string, LinUCBArm>> arms;
+    arms.reserve(header.armCount);
+    for (uint32_t i = 0; i < header.armCount; i++) {
+        const LinUCBSlot& slot = slots[i];
+        if (slotCrc(slot) != slot.crc || uint64_t(slot.idOffset) + slot.idLen > header.idsSize) return false;
+        std::string id(ids + slot.idOffset, slot.idLen);
+        layout.arms[id] = {i, slot.arm.revision};
+        arms.emplace_back(std::move(id), slot.arm);
+    }
+
+    loadRules(rules);
+    mab_.loadStats(mab);
+    linucb_.restoreArms(header.alpha, std::move(arms));
+    snapshotLayout_ = std::move(layout);
+    return true;
+}
+
+}  // namespace context_engine
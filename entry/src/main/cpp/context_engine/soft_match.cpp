@@ -7,22 +7,30 @@
  *   - gt/lt/gte/lte: 数值比较，超出范围时线性衰减
  *   - in:    值在集合中=1.0
  *   - range: 值在范围内=1.0, 范围外线性衰减
+ *
+ * 规则加载时条件被编译成 CompiledCondition（symbol id、解析好的阈值 / 衰减宽度、
+ * 排序后的 in 集合、拆好的事件类型），求值走 DenseContext 版本：
+ * eq / neq / in 比较 symbol id，键查找是数组下标，上下文数值在 bind 时只解析一次。
  */
 #include "context_engine.h"
+#include <cerrno>
 #include <cmath>
+#include <cstdlib>
 #include <sstream>
 #include <algorithm>
 
 namespace context_engine {
 
-static bool tryParseDouble(const std::string& s, double& out) {
-    try {
-        size_t pos;
-        out = std::stod(s, &pos);
-        return pos == s.size();
-    } catch (...) {
-        return false;
-    }
+bool parseNumber(const std::string& s, double& out) {
+    // Same acceptance as std::stod + full-consumption check, without exceptions
+    if (s.empty()) return false;
+    const char* begin = s.c_str();
+    char* end = nullptr;
+    errno = 0;
+    double v = std::strtod(begin, &end);
+    if (end != begin + s.size() || errno == ERANGE) return false;
+    out = v;
+    return true;
 }
 
 static std::vector<std::string> splitCsv(const std::string& s) {
@@ -40,6 +48,136 @@ static std::vector<std::string> splitCsv(const std::string& s) {
     return parts;
 }
 
+CondOp parseCondOp(const std::string& op) {
+    if (op == "eq") return CondOp::Eq;
+    if (op == "neq") return CondOp::Neq;
+    if (op == "gt") return CondOp::Gt;
+    if (op == "lt") return CondOp::Lt;
+    if (op == "gte") return CondOp::Gte;
+    if (op == "lte") return CondOp::Lte;
+    if (op == "in") return CondOp::In;
+    if (op == "range") return CondOp::Range;
+    if (op == "recent") return CondOp::Recent;
+    if (op == "within") return CondOp::Within;
+    return CondOp::Unknown;
+}
+
+// Split "event:geofence_enter" → "geofence_enter"
+static std::string extractAfterPrefix(const std::string& key, const std::string& prefix) {
+    if (key.size() > prefix.size() && key.substr(0, prefix.size()) == prefix) {
+        return key.substr(prefix.size());
+    }
+    return "";
+}
+
+// Split "sequence:typeA,typeB" → {"typeA", "typeB"}
+static std::pair<std::string, std::string> extractSequencePair(const std::string& key) {
+    auto body = extractAfterPrefix(key, "sequence:");
+    auto comma = body.find(',');
+    if (comma == std::string::npos) return {"", ""};
+    return {body.substr(0, comma), body.substr(comma + 1)};
+}
+
+// Window in ms; same leniency as std::stoll (leading digits), -1 if none
+static int64_t parseWindowMs(const std::string& s) {
+    const char* begin = s.c_str();
+    char* end = nullptr;
+    errno = 0;
+    long long v = std::strtoll(begin, &end, 10);
+    if (end == begin || errno == ERANGE) return -1;
+    return static_cast<int64_t>(v);
+}
+
+CompiledCondition compileCondition(const Condition& cond, SymbolTable& symbols) {
+    CompiledCondition cc;
+    cc.key = symbols.intern(cond.key);
+    cc.op = parseCondOp(cond.op);
+    cc.value = symbols.intern(cond.value);
+
+    switch (cc.op) {
+        case CondOp::In:
+            for (const auto& opt : splitCsv(cond.value)) {
+                cc.inValues.push_back(symbols.intern(opt));
+            }
+            std::sort(cc.inValues.begin(), cc.inValues.end());
+            cc.inValues.erase(std::unique(cc.inValues.begin(), cc.inValues.end()), cc.inValues.end());
+            break;
+        case CondOp::Gt: case CondOp::Gte: case CondOp::Lt: case CondOp::Lte:
+            cc.numeric = parseNumber(cond.value, cc.lo);
+            // Soft decay margin (10% of value or 1.0, whichever is larger)
+            if (cc.numeric) cc.margin = std::max(std::abs(cc.lo) * 0.1, 1.0);
+            break;
+        case CondOp::Range: {
+            auto parts = splitCsv(cond.value);
+            cc.numeric = parts.size() == 2 && parseNumber(parts[0], cc.lo) && parseNumber(parts[1], cc.hi);
+            if (cc.numeric) cc.margin = std::max((cc.hi - cc.lo) * 0.1, 1.0);
+            break;
+        }
+        case CondOp::Recent:
+            cc.eventA = extractAfterPrefix(cond.key, "event:");
+            cc.windowMs = parseWindowMs(cond.value);
+            cc.numeric = parseNumber(cond.value, cc.lo);
+            break;
+        case CondOp::Within: {
+            auto [typeA, typeB] = extractSequencePair(cond.key);
+            cc.eventA = std::move(typeA);
+            cc.eventB = std::move(typeB);
+            cc.windowMs = parseWindowMs(cond.value);
+            cc.numeric = parseNumber(cond.value, cc.lo);
+            break;
+        }
+        case CondOp::Unknown:
+            cc.numeric = parseNumber(cond.value, cc.lo);
+            break;
+        default:
+            break;
+    }
+    return cc;
+}
+
+bool needsNumericContext(const CompiledCondition& cond) {
+    switch (cond.op) {
+        case CondOp::Eq: case CondOp::Neq: case CondOp::In:
+            return false;
+        case CondOp::Gt: case CondOp::Gte: case CondOp::Lt: case CondOp::Lte: case CondOp::Range:
+            return true;
+        default:
+            // Numeric operand: a numeric context value scores 0 instead of comparing equal
+            return cond.numeric;
+    }
+}
+
+void DenseContext::bind(const ContextMap& ctx, const SymbolTable& symbols,
+                        const std::vector<uint8_t>& numericKeys) {
+    rulesMatched = 0;
+    rulesShortCircuited = 0;
+    if (slots_.size() < symbols.size()) slots_.resize(symbols.size());
+    if (++epoch_ == 0) {
+        for (auto& slot : slots_) slot.epoch = 0;
+        epoch_ = 1;
+    }
+    for (const auto& [key, value] : ctx) {
+        SymbolId k = symbols.find(key);
+        if (k == NO_SYMBOL) continue;
+        Slot& slot = slots_[k];
+        slot.epoch = epoch_;
+        slot.value = symbols.find(value);
+        slot.numeric = k < numericKeys.size() && numericKeys[k] && parseNumber(value, slot.num);
+    }
+}
+
+void DenseContext::diff(const DenseContext& other, size_t symbolCount, std::vector<SymbolId>& changed) const {
+    for (SymbolId k = 0; k < symbolCount; k++) {
+        const Slot* a = get(k);
+        const Slot* b = other.get(k);
+        if (a == nullptr && b == nullptr) continue;
+        if (a == nullptr || b == nullptr || a->value != b->value || a->numeric != b->numeric ||
+            (a->numeric && a->num != b->num)) {
+            changed.push_back(k);
+        }
+    }
+}
+
 double softMatch(const Condition& cond, const ContextMap& ctx) {
     auto it = ctx.find(cond.key);
     if (it == ctx.end()) {
@@ -65,9 +203,21 @@ double softMatch(const Condition& cond, const ContextMap& ctx) {
         return 0.0;
     }
 
+    if (cond.op == "range") {
+        auto parts = splitCsv(cond.value);
+        if (parts.size() != 2) return 0.0;
+        double actualNum, lo, hi;
+        if (!parseNumber(actual, actualNum) || !parseNumber(parts[0], lo) || !parseNumber(parts[1], hi)) return 0.0;
+
+        if (actualNum >= lo && actualNum <= hi) return 1.0;
+        double dist = actualNum < lo ? (lo - actualNum) : (actualNum - hi);
+        double rangeMargin = std::max((hi - lo) * 0.1, 1.0);
+        return std::max(0.0, 1.0 - dist / rangeMargin);
+    }
+
     // Numeric comparisons
     double actualNum, valueNum;
-    if (!tryParseDouble(actual, actualNum) || !tryParseDouble(cond.value, valueNum)) {
+    if (!parseNumber(actual, actualNum) || !parseNumber(cond.value, valueNum)) {
         // Can't parse as number → hard fail
         return actual == cond.value ? 1.0 : 0.0;
     }
@@ -96,19 +246,66 @@ double softMatch(const Condition& cond, const ContextMap& ctx) {
         return std::max(0.0, 1.0 - diff / margin);
     }
 
-    if (cond.op == "range") {
-        auto parts = splitCsv(cond.value);
-        if (parts.size() != 2) return 0.0;
-        double lo, hi;
-        if (!tryParseDouble(parts[0], lo) || !tryParseDouble(parts[1], hi)) return 0.0;
+    return 0.0;
+}
 
-        if (actualNum >= lo && actualNum <= hi) return 1.0;
-        double dist = actualNum < lo ? (lo - actualNum) : (actualNum - hi);
-        double rangeMargin = std::max((hi - lo) * 0.1, 1.0);
-        return std::max(0.0, 1.0 - dist / rangeMargin);
+double softMatch(const CompiledCondition& cond, const DenseContext& ctx) {
+    const DenseContext::Slot* slot = ctx.get(cond.key);
+    if (slot == nullptr) {
+        // Missing data → 0.5 (uncertain, not penalized)
+        return 0.5;
     }
 
-    return 0.0;
+    switch (cond.op) {
+        case CondOp::Eq:
+            return slot->value == cond.value ? 1.0 : 0.0;
+        case CondOp::Neq:
+            return slot->value != cond.value ? 1.0 : 0.0;
+        case CondOp::In:
+            if (slot->value == NO_SYMBOL) return 0.0;
+            if (cond.inValues.size() <= 8) {
+                for (SymbolId opt : cond.inValues) {
+                    if (slot->value == opt) return 1.0;
+                }
+                return 0.0;
+            }
+            return std::binary_search(cond.inValues.begin(), cond.inValues.end(), slot->value) ? 1.0 : 0.0;
+        case CondOp::Range: {
+            // Malformed "lo,hi" or non-numeric context value never matches
+            if (!cond.numeric || !slot->numeric) return 0.0;
+            double actualNum = slot->num;
+            if (actualNum >= cond.lo && actualNum <= cond.hi) return 1.0;
+            double dist = actualNum < cond.lo ? (cond.lo - actualNum) : (actualNum - cond.hi);
+            return std::max(0.0, 1.0 - dist / cond.margin);
+        }
+        default:
+            break;
+    }
+
+    // Numeric comparisons (recent / within / unknown ops too: two numbers score 0 below)
+    if (!cond.numeric || !slot->numeric) {
+        // Can't parse as number → hard fail
+        return slot->value == cond.value ? 1.0 : 0.0;
+    }
+    double actualNum = slot->num;
+    double valueNum = cond.lo;
+
+    switch (cond.op) {
+        case CondOp::Gt:
+            if (actualNum > valueNum) return 1.0;
+            return std::max(0.0, 1.0 - (valueNum - actualNum) / cond.margin);
+        case CondOp::Gte:
+            if (actualNum >= valueNum) return 1.0;
+            return std::max(0.0, 1.0 - (valueNum - actualNum) / cond.margin);
+        case CondOp::Lt:
+            if (actualNum < valueNum) return 1.0;
+            return std::max(0.0, 1.0 - (actualNum - valueNum) / cond.margin);
+        case CondOp::Lte:
+            if (actualNum <= valueNum) return 1.0;
+            return std::max(0.0, 1.0 - (actualNum - valueNum) / cond.margin);
+        default:
+            return 0.0;
+    }
 }
 
 }  // namespace context_engine
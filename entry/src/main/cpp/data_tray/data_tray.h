@@ -4,15 +4,39 @@
  * 感知层和决策层之间的缓存中间层。
  * 传感器异步写入 (put)，引擎同步读取 (get/getSnapshot)。
  * 每个槽位携带 TTL，过期数据 quality 线性衰减。
+ *
+ * 并发模型：
+ *   槽位是定长数组，key 在首次出现时注册一次（之后只读），常用 key 在构造时预注册并有固定 id。
+ *   每个槽位由自己的 seqlock 保护：写者之间按槽位互斥，读者从不加锁、从不阻塞写者，
+ *   读到写了一半的数据时按序号重试。值按类型存放（double / int / bool / 字符串），
+ *   字符串内联在槽位里，超出容量时按 UTF-8 边界截断。
+ *
+ * 变化跟踪：
+ *   每次“实质变化”（数值超出该 key 的阈值、字符串 / 布尔值改变、类型改变、被清除）
+ *   从全局 epoch 取一个新版本号记在槽位上；getChangedSince(epoch) 取出之后变化过的槽位，
+ *   订阅者（subscribe）在写线程上同步收到通知。阈值内的抖动只刷新时间戳与 quality。
  */
 #pragma once
 
-#include <string>
-#include <unordered_map>
+#include "common/metrics.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
 #include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
 #include <mutex>
 #include <optional>
-#include <cstdint>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 namespace data_tray {
 
@@ -20,19 +44,70 @@ namespace data_tray {
 // Data types
 // ============================================================
 
-/** 托盘槽位 */
-struct TraySlot {
-    std::string key;
-    std::string value;
-    int64_t updatedAt;    // steady_clock ms
-    int64_t ttlMs;
-    double quality;       // 0~1
-    std::string source;
+/** 槽位值类型 */
+enum class TrayValueType : uint8_t { None, Double, Int, Bool, String };
+
+/** 带类型的槽位值 */
+struct TrayValue {
+    TrayValueType type = TrayValueType::None;
+    double number = 0.0;
+    int64_t integer = 0;
+    bool flag = false;
+    std::string text;
+
+    bool has() const { return type != TrayValueType::None; }
+
+    /** 数值视图：Int / Double / Bool 直接取值，字符串按数字解析，失败返回 def */
+    double asDouble(double def = 0.0) const {
+        switch (type) {
+            case TrayValueType::Double: return number;
+            case TrayValueType::Int: return static_cast<double>(integer);
+            case TrayValueType::Bool: return flag ? 1.0 : 0.0;
+            case TrayValueType::String: {
+                char* end = nullptr;
+                double v = std::strtod(text.c_str(), &end);
+                return end != text.c_str() ? v : def;
+            }
+            default: return def;
+        }
+    }
+
+    /** 字符串形式（规则引擎的 ContextMap 与 ArkTS 侧都用字符串） */
+    std::string toString() const {
+        char buf[32];
+        switch (type) {
+            case TrayValueType::Double: {
+                if (std::isfinite(number) && number == std::floor(number) && std::fabs(number) < 1e15) {
+                    auto res = std::to_chars(buf, buf + sizeof(buf), static_cast<int64_t>(number));
+                    return std::string(buf, res.ptr);
+                }
+                auto res = std::to_chars(buf, buf + sizeof(buf), number);
+                return std::string(buf, res.ptr);
+            }
+            case TrayValueType::Int: {
+                auto res = std::to_chars(buf, buf + sizeof(buf), integer);
+                return std::string(buf, res.ptr);
+            }
+            case TrayValueType::Bool: return flag ? "true" : "false";
+            case TrayValueType::String: return text;
+            default: return "";
+        }
+    }
+
+    static TrayValue ofDouble(double v) { TrayValue t; t.type = TrayValueType::Double; t.number = v; return t; }
+    static TrayValue ofInt(int64_t v) { TrayValue t; t.type = TrayValueType::Int; t.integer = v; return t; }
+    static TrayValue ofBool(bool v) { TrayValue t; t.type = TrayValueType::Bool; t.flag = v; return t; }
+    static TrayValue ofString(std::string v) {
+        TrayValue t;
+        t.type = TrayValueType::String;
+        t.text = std::move(v);
+        return t;
+    }
 };
 
 /** 读取结果（含 TTL 衰减后的有效 quality） */
 struct TrayReadResult {
-    std::optional<std::string> value;
+    TrayValue value;      // type None = 没有数据
     double quality;       // effective quality after TTL decay
     bool fresh;           // age < ttl
     int64_t ageMs;        // how old the data is
@@ -49,6 +124,16 @@ struct TrayStatus {
     std::string source;
 };
 
+/** 一次实质变化（getChangedSince / 订阅回调）；value.type None = 被清除 */
+struct TrayChange {
+    std::string key;
+    TrayValue value;
+    uint64_t version;     // 全局 epoch 中的序号
+};
+
+/** 变化订阅回调，在执行 put / clear 的线程上调用，应尽快返回 */
+using TrayChangeListener = std::function<void(const TrayChange&)>;
+
 /** 上下文快照 */
 struct ContextSnapshot {
     std::string timeOfDay;
@@ -112,226 +197,483 @@ inline int64_t getDefaultTTL(const std::string& key) {
     return 2 * 60 * 1000;  // FALLBACK: 2 min
 }
 
+// ============================================================
+// 槽位 id
+// ============================================================
+
+/** 构造时预注册的槽位，id 固定；getSnapshot 直接按 id 读取 */
+enum WellKnownSlot : int {
+    SLOT_TIME_OF_DAY,
+    SLOT_HOUR,
+    SLOT_DAY_OF_WEEK,
+    SLOT_IS_WEEKEND,
+    SLOT_MOTION_STATE,
+    SLOT_BATTERY_LEVEL,
+    SLOT_IS_CHARGING,
+    SLOT_NETWORK_TYPE,
+    SLOT_GEOFENCE,
+    SLOT_WIFI_SSID,
+    SLOT_WIFI_LOST_WORK,
+    SLOT_CELL_ID,
+    SLOT_LATITUDE,
+    SLOT_LONGITUDE,
+    SLOT_STEP_COUNT,
+    WELL_KNOWN_SLOT_COUNT
+};
+
+inline const char* wellKnownSlotKey(int id) {
+    static const char* const keys[WELL_KNOWN_SLOT_COUNT] = {
+        "timeOfDay", "hour", "dayOfWeek", "isWeekend", "motionState",
+        "batteryLevel", "isCharging", "networkType", "geofence", "wifiSsid",
+        "wifiLostWork", "cellId", "latitude", "longitude", "stepCount",
+    };
+    return keys[id];
+}
+
 // ============================================================
 // SensorDataTray 主类
 // ============================================================
 
 class SensorDataTray {
 public:
+    // 槽位上限：key 只注册不回收，第 65 个不同的 key 起 put() 返回 false，值被丢弃
+    static constexpr int MAX_SLOTS = 64;
+    static constexpr size_t MAX_VALUE_BYTES = 95;    // 内联字符串容量（SSID ≤ 32 字节，geofence id 等都够用）
+    static constexpr size_t MAX_SOURCE_BYTES = 31;
+
     static SensorDataTray& getInstance() {
         static SensorDataTray instance;
         return instance;
     }
 
+    /**
+     * 解析 key 对应的槽位 id，不存在则注册（之后可用 id 直接写入，省去查找）
+     * @return 槽位 id；槽位已满返回 -1
+     */
+    int slotId(const std::string& key) {
+        int id = findSlot(key);
+        return id >= 0 ? id : registerSlot(key);
+    }
+
     /**
      * 传感器写入数据
      * @param key      传感器标识
-     * @param value    最新值（字符串）
+     * @param value    最新值
      * @param quality  数据质量 0~1，默认 1.0
      * @param source   来源标识，默认与 key 相同
+     * @return 槽位已满（key 过多）时返回 false
      */
-    void put(const std::string& key, const std::string& value,
+    bool put(const std::string& key, const TrayValue& value,
              double quality = 1.0, const std::string& source = "") {
-        std::lock_guard<std::mutex> lock(mu_);
-        
-        int64_t ttl = getTTL(key);
-        TraySlot slot{
-            key,
-            value,
-            nowMs(),
-            ttl,
-            quality,
-            source.empty() ? key : source
-        };
-        slots_[key] = slot;
+        return put(slotId(key), value, quality, source);
+    }
+
+    bool put(const std::string& key, const std::string& value,
+             double quality = 1.0, const std::string& source = "") {
+        return write(slotId(key), TrayValueType::String, 0.0, 0, false, value, quality, source);
+    }
+
+    bool put(int id, const TrayValue& value, double quality = 1.0, const std::string& source = "") {
+        return write(id, value.type, value.number, value.integer, value.flag, value.text, quality, source);
     }
 
     /**
      * 引擎读取数据（含 TTL 衰减）
      */
-    TrayReadResult get(const std::string& key) {
-        std::lock_guard<std::mutex> lock(mu_);
-        
-        auto it = slots_.find(key);
-        if (it == slots_.end()) {
-            return {std::nullopt, 0.5, false, 0};
-        }
-
-        const TraySlot& slot = it->second;
-        int64_t age = nowMs() - slot.updatedAt;
-        int64_t ttl = slot.ttlMs;
+    TrayReadResult get(const std::string& key) const {
+        int id = findSlot(key);
+        if (id < 0) return {TrayValue(), 0.5, false, 0};
+        return get(id, nowMs());
+    }
 
-        // 新鲜
-        if (age < ttl) {
-            return {slot.value, slot.quality, true, age};
-        }
+    TrayReadResult get(int id, int64_t now) const {
+        if (id < 0 || id >= registered_.load(std::memory_order_acquire)) return {TrayValue(), 0.5, false, 0};
+        Payload p;
+        read(slots_[id], p);
+        if (p.type == TrayValueType::None) return {TrayValue(), 0.5, false, 0};
 
-        // 过期但未超过 2x TTL — quality 线性衰减
-        double decay = 1.0 - static_cast<double>(age - ttl) / static_cast<double>(ttl);
-        if (decay < 0) decay = 0;
-        double effectiveQuality = slot.quality * decay;
-
-        return {slot.value, effectiveQuality, false, age};
+        int64_t age = now - p.updatedAt;
+        int64_t ttl = slots_[id].ttlMs.load(std::memory_order_relaxed);
+        return {toValue(p), effectiveQuality(p.quality, age, ttl), age < ttl, age};
     }
 
     /**
-     * 从所有槽位构建 ContextSnapshot
+     * 从固定槽位构建 ContextSnapshot（只读值，不需要时钟）
      */
-    ContextSnapshot getSnapshot() {
-        std::lock_guard<std::mutex> lock(mu_);
-        
+    ContextSnapshot getSnapshot() const {
+        NATIVE_METRICS_SCOPE("data_tray.get_snapshot");
         ContextSnapshot snap;
-        snap.timeOfDay = getValueOrDefault("timeOfDay", "unknown");
-        snap.hour = getValueOrDefault("hour", "0");
-        snap.dayOfWeek = getValueOrDefault("dayOfWeek", "0");
-        snap.isWeekend = getValueOrDefault("isWeekend", "false");
-        snap.motionState = getValueOrDefault("motionState", "unknown");
-        snap.batteryLevel = getValueOrDefault("batteryLevel", "100");
-        snap.isCharging = getValueOrDefault("isCharging", "false");
-        snap.networkType = getValueOrDefault("networkType", "none");
+        snap.timeOfDay = stringOr(SLOT_TIME_OF_DAY, "unknown");
+        snap.hour = stringOr(SLOT_HOUR, "0");
+        snap.dayOfWeek = stringOr(SLOT_DAY_OF_WEEK, "0");
+        snap.isWeekend = stringOr(SLOT_IS_WEEKEND, "false");
+        snap.motionState = stringOr(SLOT_MOTION_STATE, "unknown");
+        snap.batteryLevel = stringOr(SLOT_BATTERY_LEVEL, "100");
+        snap.isCharging = stringOr(SLOT_IS_CHARGING, "false");
+        snap.networkType = stringOr(SLOT_NETWORK_TYPE, "none");
 
         // Optional fields
-        auto geofence = getUnlocked("geofence");
-        if (geofence.value.has_value()) {
-            snap.geofence = geofence.value;
-        }
-        auto wifiSsid = getUnlocked("wifiSsid");
-        if (wifiSsid.value.has_value()) {
-            snap.wifiSsid = wifiSsid.value;
-        }
-        auto wifiLostWork = getUnlocked("wifiLostWork");
-        if (wifiLostWork.value.has_value()) {
-            snap.wifiLostWork = wifiLostWork.value;
-        }
-        auto cellId = getUnlocked("cellId");
-        if (cellId.value.has_value()) {
-            snap.cellId = cellId.value;
-        }
-        auto lat = getUnlocked("latitude");
-        if (lat.value.has_value()) {
-            snap.latitude = lat.value;
-        }
-        auto lon = getUnlocked("longitude");
-        if (lon.value.has_value()) {
-            snap.longitude = lon.value;
-        }
-        auto steps = getUnlocked("stepCount");
-        if (steps.value.has_value()) {
-            snap.stepCount = steps.value;
-        }
-
+        snap.geofence = optionalString(SLOT_GEOFENCE);
+        snap.wifiSsid = optionalString(SLOT_WIFI_SSID);
+        snap.wifiLostWork = optionalString(SLOT_WIFI_LOST_WORK);
+        snap.cellId = optionalString(SLOT_CELL_ID);
+        snap.latitude = optionalString(SLOT_LATITUDE);
+        snap.longitude = optionalString(SLOT_LONGITUDE);
+        snap.stepCount = optionalString(SLOT_STEP_COUNT);
         return snap;
     }
 
     /**
-     * 配置单个 key 的 TTL
+     * 配置单个 key 的 TTL（对已有数据立即生效，clear() 后仍保留）
      */
     void setTTL(const std::string& key, int64_t ttlMs) {
-        std::lock_guard<std::mutex> lock(mu_);
-        
-        ttlOverrides_[key] = ttlMs;
-        // 更新已有槽位
-        auto it = slots_.find(key);
-        if (it != slots_.end()) {
-            it->second.ttlMs = ttlMs;
+        {
+            std::lock_guard<std::mutex> lock(registerMu_);
+            ttlOverrides_[key] = ttlMs;
         }
+        int id = slotId(key);
+        if (id >= 0) slots_[id].ttlMs.store(ttlMs, std::memory_order_relaxed);
     }
 
     /**
-     * 获取所有槽位的调试状态
+     * 配置 key 的实质变化阈值：数值与上次变化时的值相差不足 delta 不算变化（如电量 ±5）。
+     * 0（默认）= 任何不同的值都算；对字符串 / 布尔值无效
      */
-    std::vector<TrayStatus> getStatus() {
-        std::lock_guard<std::mutex> lock(mu_);
-        
+    void setChangeThreshold(const std::string& key, double delta) {
+        int id = slotId(key);
+        if (id >= 0) slots_[id].threshold.store(delta, std::memory_order_relaxed);
+    }
+
+    /** 最近一次实质变化的版本号（尚无变化为 0） */
+    uint64_t epoch() const { return epoch_.load(std::memory_order_acquire); }
+
+    /**
+     * since 之后（不含）发生过实质变化的槽位及其当前值
+     * @param epochOut 本次读到的 epoch，下次作为 since 传入即可不漏不重
+     *                 （并发写入时偶尔会重报一次，永不漏报）
+     */
+    std::vector<TrayChange> getChangedSince(uint64_t since, uint64_t* epochOut = nullptr) const {
+        // 先读 epoch 再扫槽位：版本号 ≤ epoch 的写入在取号时已把槽位置为“正在写”，扫描会等它写完
+        uint64_t current = epoch_.load(std::memory_order_acquire);
+        if (epochOut != nullptr) *epochOut = current;
+        std::vector<TrayChange> changes;
+        if (current <= since) return changes;
+
+        int count = registered_.load(std::memory_order_acquire);
+        Payload p;
+        for (int id = 0; id < count; id++) {
+            read(slots_[id], p);
+            if (p.version > since) changes.push_back({keys_[id], toValue(p), p.version});
+        }
+        return changes;
+    }
+
+    /**
+     * 订阅实质变化
+     * @return 订阅 token，传给 unsubscribe 取消
+     */
+    int subscribe(TrayChangeListener listener) {
+        std::lock_guard<std::mutex> lock(listenerMu_);
+        auto next = std::make_shared<ListenerList>(listeners_ ? *listeners_ : ListenerList());
+        int token = ++lastListenerToken_;
+        next->emplace_back(token, std::move(listener));
+        std::atomic_store(&listeners_, std::shared_ptr<const ListenerList>(std::move(next)));
+        return token;
+    }
+
+    void unsubscribe(int token) {
+        std::lock_guard<std::mutex> lock(listenerMu_);
+        if (!listeners_) return;
+        auto next = std::make_shared<ListenerList>();
+        for (const auto& entry : *listeners_) {
+            if (entry.first != token) next->push_back(entry);
+        }
+        std::shared_ptr<const ListenerList> published;
+        if (!next->empty()) published = std::move(next);
+        std::atomic_store(&listeners_, published);
+    }
+
+    /**
+     * 获取所有有数据槽位的调试状态
+     */
+    std::vector<TrayStatus> getStatus() const {
         int64_t now = nowMs();
+        int count = registered_.load(std::memory_order_acquire);
         std::vector<TrayStatus> result;
-        result.reserve(slots_.size());
-        
-        for (const auto& [key, slot] : slots_) {
-            int64_t age = now - slot.updatedAt;
-            bool fresh = age < slot.ttlMs;
-            double decay = fresh ? 1.0 : std::max(0.0, 1.0 - static_cast<double>(age - slot.ttlMs) / static_cast<double>(slot.ttlMs));
-            double eq = slot.quality * decay;
-            
+        result.reserve(static_cast<size_t>(count));
+
+        Payload p;
+        for (int id = 0; id < count; id++) {
+            read(slots_[id], p);
+            if (p.type == TrayValueType::None) continue;
+            int64_t age = now - p.updatedAt;
+            int64_t ttl = slots_[id].ttlMs.load(std::memory_order_relaxed);
             result.push_back({
-                slot.key,
-                slot.value,
+                keys_[id],
+                toValue(p).toString(),
                 age,
-                slot.ttlMs,
-                fresh,
-                eq,
-                slot.source
+                ttl,
+                age < ttl,
+                effectiveQuality(p.quality, age, ttl),
+                std::string(p.source, p.sourceLen)
             });
         }
         return result;
     }
 
     /**
-     * 清除所有数据（测试用）
+     * 清除所有数据（测试用）；已注册的槽位、TTL 与阈值配置保留。
+     * 有数据的槽位记一次变化（value 为 None）
      */
     void clear() {
-        std::lock_guard<std::mutex> lock(mu_);
-        slots_.clear();
+        int count = registered_.load(std::memory_order_acquire);
+        for (int id = 0; id < count; id++) {
+            Slot& slot = slots_[id];
+            uint32_t seq = beginWrite(slot);
+            bool had = slot.payload.type != TrayValueType::None;
+            if (had) {
+                slot.payload.type = TrayValueType::None;
+                slot.payload.version = epoch_.fetch_add(1, std::memory_order_acq_rel) + 1;
+            }
+            uint64_t version = slot.payload.version;
+            endWrite(slot, seq);
+            if (had) notify(id, TrayValue(), version);
+        }
     }
 
     /**
-     * 获取槽位数量
+     * 获取有数据的槽位数量
      */
     size_t size() const {
-        std::lock_guard<std::mutex> lock(mu_);
-        return slots_.size();
+        int count = registered_.load(std::memory_order_acquire);
+        size_t n = 0;
+        Payload p;
+        for (int id = 0; id < count; id++) {
+            read(slots_[id], p);
+            if (p.type != TrayValueType::None) n++;
+        }
+        return n;
     }
 
 private:
-    SensorDataTray() = default;
+    /** seqlock 保护的槽位内容；平凡可复制，读者整体拷出后再校验序号 */
+    struct Payload {
+        TrayValueType type;
+        uint8_t textLen;
+        uint8_t sourceLen;
+        bool flag;
+        double number;
+        int64_t integer;
+        int64_t updatedAt;
+        double quality;
+        uint64_t version;                      // 最近一次实质变化的 epoch 序号
+        double changedNumber;                  // 最近一次实质变化时的数值（阈值比较基准）
+        char text[MAX_VALUE_BYTES];
+        char source[MAX_SOURCE_BYTES];
+    };
+
+    struct alignas(64) Slot {
+        std::atomic<uint32_t> seq{0};           // 奇数 = 正在写
+        std::atomic<int64_t> ttlMs{0};
+        std::atomic<double> threshold{0.0};
+        Payload payload{};
+    };
+
+    SensorDataTray() {
+        for (int id = 0; id < WELL_KNOWN_SLOT_COUNT; id++) registerSlot(wellKnownSlotKey(id));
+    }
     SensorDataTray(const SensorDataTray&) = delete;
     SensorDataTray& operator=(const SensorDataTray&) = delete;
 
-    int64_t nowMs() const {
+    bool write(int id, TrayValueType type, double number, int64_t integer, bool flag, std::string_view text,
+               double quality, const std::string& source) {
+        if (id < 0 || id >= registered_.load(std::memory_order_acquire)) return false;
+        Slot& slot = slots_[id];
+        std::string_view src = source.empty() ? std::string_view(keys_[id]) : std::string_view(source);
+        int64_t now = nowMs();
+
+        uint32_t seq = beginWrite(slot);
+        Payload& p = slot.payload;
+        double numeric = type == TrayValueType::Int ? static_cast<double>(integer) : number;
+        bool changed = isMaterialChange(p, type, numeric, flag, text, slot.threshold.load(std::memory_order_relaxed));
+        if (changed) {
+            // 在槽位处于“正在写”时取号，见 getChangedSince
+            p.version = epoch_.fetch_add(1, std::memory_order_acq_rel) + 1;
+            p.changedNumber = numeric;
+        }
+        p.type = type;
+        p.number = number;
+        p.integer = integer;
+        p.flag = flag;
+        p.textLen = static_cast<uint8_t>(copyTruncated(p.text, MAX_VALUE_BYTES, text));
+        p.sourceLen = static_cast<uint8_t>(copyTruncated(p.source, MAX_SOURCE_BYTES, src));
+        p.updatedAt = now;
+        p.quality = quality;
+        uint64_t version = p.version;
+        endWrite(slot, seq);
+
+        if (changed && std::atomic_load(&listeners_)) {
+            TrayValue value;
+            value.type = type;
+            value.number = number;
+            value.integer = integer;
+            value.flag = flag;
+            if (type == TrayValueType::String) value.text.assign(text.data(), utf8Prefix(text, MAX_VALUE_BYTES));
+            notify(id, value, version);
+        }
+        return true;
+    }
+
+    /** 调用方持有槽位写锁；p 仍是写入前的内容 */
+    static bool isMaterialChange(const Payload& p, TrayValueType type, double numeric, bool flag,
+                                 std::string_view text, double threshold) {
+        if (p.type != type) return true;
+        switch (type) {
+            case TrayValueType::Double:
+            case TrayValueType::Int:
+                return threshold > 0 ? std::fabs(numeric - p.changedNumber) >= threshold : numeric != p.changedNumber;
+            case TrayValueType::Bool: return flag != p.flag;
+            case TrayValueType::String: {
+                size_t n = utf8Prefix(text, MAX_VALUE_BYTES);
+                return n != p.textLen || std::memcmp(text.data(), p.text, n) != 0;
+            }
+            default: return false;
+        }
+    }
+
+    void notify(int id, TrayValue value, uint64_t version) const {
+        std::shared_ptr<const ListenerList> listeners = std::atomic_load(&listeners_);
+        if (!listeners) return;
+        TrayChange change{keys_[id], std::move(value), version};
+        for (const auto& entry : *listeners) entry.second(change);
+    }
+
+    static int64_t nowMs() {
         auto now = std::chrono::steady_clock::now();
         return std::chrono::duration_cast<std::chrono::milliseconds>(
             now.time_since_epoch()).count();
     }
 
-    std::string getValueOrDefault(const std::string& key, const std::string& defaultValue) {
-        auto result = getUnlocked(key);
-        return result.value.has_value() ? result.value.value() : defaultValue;
+    static double effectiveQuality(double quality, int64_t age, int64_t ttl) {
+        // 新鲜
+        if (age < ttl) return quality;
+        // 过期但未超过 2x TTL — quality 线性衰减
+        double decay = 1.0 - static_cast<double>(age - ttl) / static_cast<double>(ttl);
+        return quality * std::max(0.0, decay);
     }
 
-    // 不加锁版本，内部使用
-    TrayReadResult getUnlocked(const std::string& key) {
-        auto it = slots_.find(key);
-        if (it == slots_.end()) {
-            return {std::nullopt, 0.5, false, 0};
+    /** 写者之间互斥：把序号从偶数 CAS 成奇数 */
+    static uint32_t beginWrite(Slot& slot) {
+        uint32_t seq = slot.seq.load(std::memory_order_relaxed);
+        while (true) {
+            if ((seq & 1u) == 0 &&
+                slot.seq.compare_exchange_weak(seq, seq + 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+                std::atomic_thread_fence(std::memory_order_release);
+                return seq;
+            }
+            NATIVE_METRICS_COUNT("data_tray.write_spins", 1);
+            std::this_thread::yield();
+            seq = slot.seq.load(std::memory_order_relaxed);
         }
+    }
 
-        const TraySlot& slot = it->second;
-        int64_t age = nowMs() - slot.updatedAt;
-        int64_t ttl = slot.ttlMs;
+    static void endWrite(Slot& slot, uint32_t seq) {
+        slot.seq.store(seq + 2, std::memory_order_release);
+    }
 
-        if (age < ttl) {
-            return {slot.value, slot.quality, true, age};
+    /** 无锁读：序号为奇数或前后不一致则重试 */
+    static void read(const Slot& slot, Payload& out) {
+        while (true) {
+            uint32_t before = slot.seq.load(std::memory_order_acquire);
+            if (before & 1u) {
+                NATIVE_METRICS_COUNT("data_tray.read_retries", 1);
+                std::this_thread::yield();
+                continue;
+            }
+            std::memcpy(static_cast<void*>(&out), &slot.payload, sizeof(Payload));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.seq.load(std::memory_order_relaxed) == before) return;
+            NATIVE_METRICS_COUNT("data_tray.read_retries", 1);
         }
+    }
 
-        double decay = 1.0 - static_cast<double>(age - ttl) / static_cast<double>(ttl);
-        if (decay < 0) decay = 0;
-        double effectiveQuality = slot.quality * decay;
+    static TrayValue toValue(const Payload& p) {
+        TrayValue v;
+        v.type = p.type;
+        v.number = p.number;
+        v.integer = p.integer;
+        v.flag = p.flag;
+        if (p.type == TrayValueType::String) v.text.assign(p.text, p.textLen);
+        return v;
+    }
+
+    /** 至多 cap 字节的前缀长度，不截断 UTF-8 多字节字符 */
+    static size_t utf8Prefix(std::string_view src, size_t cap) {
+        size_t n = src.size();
+        if (n > cap) {
+            n = cap;
+            while (n > 0 && (static_cast<unsigned char>(src[n]) & 0xC0) == 0x80) n--;
+        }
+        return n;
+    }
+
+    static size_t copyTruncated(char* dst, size_t cap, std::string_view src) {
+        size_t n = utf8Prefix(src, cap);
+        std::memcpy(dst, src.data(), n);
+        return n;
+    }
+
+    std::string stringOr(int id, const char* defaultValue) const {
+        Payload p;
+        read(slots_[id], p);
+        return p.type == TrayValueType::None ? std::string(defaultValue) : toValue(p).toString();
+    }
+
+    std::optional<std::string> optionalString(int id) const {
+        Payload p;
+        read(slots_[id], p);
+        if (p.type == TrayValueType::None) return std::nullopt;
+        return toValue(p).toString();
+    }
 
-        return {slot.value, effectiveQuality, false, age};
+    /** 已注册 key 只追加不修改，读者按 registered_ 的 acquire 看到完整的名字 */
+    int findSlot(const std::string& key) const {
+        int count = registered_.load(std::memory_order_acquire);
+        for (int id = 0; id < count; id++) {
+            if (keys_[id] == key) return id;
+        }
+        return -1;
     }
 
-    int64_t getTTL(const std::string& key) {
+    int registerSlot(const std::string& key) {
+        std::lock_guard<std::mutex> lock(registerMu_);
+        int count = registered_.load(std::memory_order_relaxed);
+        for (int id = 0; id < count; id++) {
+            if (keys_[id] == key) return id;
+        }
+        if (count >= MAX_SLOTS) return -1;
+
+        keys_[count] = key;
         // 优先用用户覆盖
         auto overrideIt = ttlOverrides_.find(key);
-        if (overrideIt != ttlOverrides_.end()) {
-            return overrideIt->second;
-        }
-        return getDefaultTTL(key);
+        slots_[count].ttlMs.store(overrideIt != ttlOverrides_.end() ? overrideIt->second : getDefaultTTL(key),
+                                  std::memory_order_relaxed);
+        registered_.store(count + 1, std::memory_order_release);
+        return count;
     }
 
-    std::unordered_map<std::string, TraySlot> slots_;
-    std::unordered_map<std::string, int64_t> ttlOverrides_;
-    mutable std::mutex mu_;
+    std::array<Slot, MAX_SLOTS> slots_;
+    std::array<std::string, MAX_SLOTS> keys_;
+    std::atomic<int> registered_{0};
+    std::unordered_map<std::string, int64_t> ttlOverrides_;    // guarded by registerMu_
+    std::mutex registerMu_;
+    std::atomic<uint64_t> epoch_{0};
+
+    // 订阅者列表写时复制：写入路径只做一次 atomic_load
+    using ListenerList = std::vector<std::pair<int, TrayChangeListener>>;
+    std::shared_ptr<const ListenerList> listeners_;           // std::atomic_load / std::atomic_store
+    std::mutex listenerMu_;
+    int lastListenerToken_ = 0;                               // guarded by listenerMu_
 };
 
 }  // namespace data_tray
@@ -3,6 +3,7 @@
  */
 #include <napi/native_api.h>
 #include "data_tray.h"
+#include "common/metrics_napi.h"
 #include <vector>
 #include <string>
 
@@ -75,7 +76,9 @@ static napi_value CreateBool(napi_env env, bool val) {
 // ============================================================
 
 /**
- * dataTray.put(key, value, quality?, source?)
+ * dataTray.put(key, value, quality?, source?) → boolean
+ * value 可以是 string / number / boolean，按类型存入槽位
+ * 返回 false：key 是新的且 SensorDataTray::MAX_SLOTS（64）个槽位已占满，值被丢弃
  */
 static napi_value Put(napi_env env, napi_callback_info info) {
     size_t argc = 4;
@@ -89,15 +92,29 @@ static napi_value Put(napi_env env, napi_callback_info info) {
 
     // 直接从参数取值，不是从对象属性取
     size_t len;
-    std::string key, value, source;
+    std::string key, source;
     
     napi_get_value_string_utf8(env, args[0], nullptr, 0, &len);
     key.resize(len);
     napi_get_value_string_utf8(env, args[0], &key[0], len + 1, &len);
-    
-    napi_get_value_string_utf8(env, args[1], nullptr, 0, &len);
-    value.resize(len);
-    napi_get_value_string_utf8(env, args[1], &value[0], len + 1, &len);
+
+    TrayValue value;
+    napi_valuetype valueType;
+    napi_typeof(env, args[1], &valueType);
+    if (valueType == napi_number) {
+        double number = 0.0;
+        napi_get_value_double(env, args[1], &number);
+        value = TrayValue::ofDouble(number);
+    } else if (valueType == napi_boolean) {
+        bool flag = false;
+        napi_get_value_bool(env, args[1], &flag);
+        value = TrayValue::ofBool(flag);
+    } else {
+        napi_get_value_string_utf8(env, args[1], nullptr, 0, &len);
+        value.type = TrayValueType::String;
+        value.text.resize(len);
+        napi_get_value_string_utf8(env, args[1], &value.text[0], len + 1, &len);
+    }
     
     double quality = 1.0;
     if (argc >= 3) {
@@ -110,9 +127,7 @@ static napi_value Put(napi_env env, napi_callback_info info) {
         napi_get_value_string_utf8(env, args[3], &source[0], len + 1, &len);
     }
 
-    SensorDataTray::getInstance().put(key, value, quality, source);
-
-    return nullptr;
+    return CreateBool(env, SensorDataTray::getInstance().put(key, value, quality, source));
 }
 
 /**
@@ -139,8 +154,8 @@ static napi_value Get(napi_env env, napi_callback_info info) {
     napi_create_object(env, &obj);
 
     // value: string | null
-    if (result.value.has_value()) {
-        napi_set_named_property(env, obj, "value", CreateString(env, result.value.value()));
+    if (result.value.has()) {
+        napi_set_named_property(env, obj, "value", CreateString(env, result.value.toString()));
     } else {
         napi_value nullVal;
         napi_get_null(env, &nullVal);
@@ -182,6 +197,9 @@ static napi_value GetSnapshot(napi_env env, napi_callback_info info) {
     if (snap.wifiLostWork.has_value()) {
         napi_set_named_property(env, obj, "wifiLostWork", CreateString(env, snap.wifiLostWork.value()));
     }
+    if (snap.cellId.has_value()) {
+        napi_set_named_property(env, obj, "cellId", CreateString(env, snap.cellId.value()));
+    }
     if (snap.latitude.has_value()) {
         napi_set_named_property(env, obj, "latitude", CreateString(env, snap.latitude.value()));
     }
@@ -250,6 +268,83 @@ static napi_value GetStatus(napi_env env, napi_callback_info info) {
     return arr;
 }
 
+/**
+ * dataTray.setChangeThreshold(key, delta)
+ */
+static napi_value SetChangeThreshold(napi_env env, napi_callback_info info) {
+    size_t argc = 2;
+    napi_value args[2];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+
+    if (argc < 2) {
+        napi_throw_error(env, nullptr, "Expected 2 arguments: key, delta");
+        return nullptr;
+    }
+
+    size_t keyLen;
+    napi_get_value_string_utf8(env, args[0], nullptr, 0, &keyLen);
+    std::string key(keyLen, '\0');
+    napi_get_value_string_utf8(env, args[0], &key[0], keyLen + 1, &keyLen);
+
+    double delta = 0.0;
+    napi_get_value_double(env, args[1], &delta);
+
+    SensorDataTray::getInstance().setChangeThreshold(key, delta);
+
+    return nullptr;
+}
+
+/**
+ * dataTray.getEpoch() → number
+ */
+static napi_value GetEpoch(napi_env env, napi_callback_info info) {
+    return CreateDouble(env, static_cast<double>(SensorDataTray::getInstance().epoch()));
+}
+
+/**
+ * dataTray.getChangedSince(epoch) → { epoch, changes: [{ key, value, version }] }
+ * value 为 null 表示该槽位被清除
+ */
+static napi_value GetChangedSince(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+
+    double since = 0.0;
+    if (argc >= 1) {
+        napi_get_value_double(env, args[0], &since);
+    }
+
+    uint64_t epoch = 0;
+    std::vector<TrayChange> changes =
+        SensorDataTray::getInstance().getChangedSince(since > 0 ? static_cast<uint64_t>(since) : 0, &epoch);
+
+    napi_value arr;
+    napi_create_array_with_length(env, changes.size(), &arr);
+    for (size_t i = 0; i < changes.size(); i++) {
+        const TrayChange& c = changes[i];
+
+        napi_value obj;
+        napi_create_object(env, &obj);
+        napi_set_named_property(env, obj, "key", CreateString(env, c.key));
+        if (c.value.has()) {
+            napi_set_named_property(env, obj, "value", CreateString(env, c.value.toString()));
+        } else {
+            napi_value nullVal;
+            napi_get_null(env, &nullVal);
+            napi_set_named_property(env, obj, "value", nullVal);
+        }
+        napi_set_named_property(env, obj, "version", CreateDouble(env, static_cast<double>(c.version)));
+        napi_set_element(env, arr, i, obj);
+    }
+
+    napi_value result;
+    napi_create_object(env, &result);
+    napi_set_named_property(env, result, "epoch", CreateDouble(env, static_cast<double>(epoch)));
+    napi_set_named_property(env, result, "changes", arr);
+    return result;
+}
+
 /**
  * dataTray.clear()
  */
@@ -281,8 +376,12 @@ static napi_value Init(napi_env env, napi_value exports) {
         {"getSnapshot", nullptr, GetSnapshot, nullptr, nullptr, nullptr, napi_default, nullptr},
         {"setTTL", nullptr, SetTTL, nullptr, nullptr, nullptr, napi_default, nullptr},
         {"getStatus", nullptr, GetStatus, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"setChangeThreshold", nullptr, SetChangeThreshold, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"getEpoch", nullptr, GetEpoch, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"getChangedSince", nullptr, GetChangedSince, nullptr, nullptr, nullptr, napi_default, nullptr},
         {"clear", nullptr, Clear, nullptr, nullptr, nullptr, napi_default, nullptr},
         {"size", nullptr, Size, nullptr, nullptr, nullptr, napi_default, nullptr},
+        native_common::MetricsProperty("data_tray"),
     };
 
     napi_define_properties(env, exports, sizeof(desc) / sizeof(desc[0]), desc);
@@ -6,10 +6,17 @@
 #pragma once
 
 #include "geo_utils.h"
+#include "spatial_grid.h"
+#include "geo_batch.h"
+#include "common/metrics.h"
+#include "common/thread_pool.h"
 #include <vector>
 #include <unordered_set>
+#include <unordered_map>
 #include <string>
 #include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <cstdint>
 
 namespace dbscan {
@@ -19,6 +26,8 @@ using geo_utils::GeoPoint;
 using geo_utils::haversineDistance;
 using geo_utils::calculateCenter;
 using geo_utils::calculatePercentileRadius;
+using geo_utils::SpatialGrid;
+using geo_utils::GeoPointSoA;
 
 // ============================================================
 // 数据类型
@@ -26,16 +35,19 @@ using geo_utils::calculatePercentileRadius;
 
 /** 时间模式 */
 struct TimePattern {
-    std::vector<int> weekdayHours;   // 工作日出现的小时
-    std::vector<int> weekendHours;   // 周末出现的小时
-    int nightCount;                  // 22:00-06:00 出现次数
-    int workdayCount;                // 工作日 09:00-18:00 出现次数
-    int weekendCount;                // 周末出现次数
+    std::vector<int> weekdayHours;   // 工作日出现的小时（升序）
+    std::vector<int> weekendHours;   // 周末出现的小时（升序）
+    uint32_t weekdayHourMask = 0;    // bit h 置位 = 工作日 h 点出现过
+    uint32_t weekendHourMask = 0;    // bit h 置位 = 周末 h 点出现过
+    int nightCount = 0;              // 22:00-06:00 出现次数
+    int workdayCount = 0;            // 工作日 09:00-18:00 出现次数
+    int weekendCount = 0;            // 周末出现次数
 };
 
 /** 聚类结果（扩展） */
 struct ClusterResult {
     std::string id;
+    int clusterId = 0;                // id 的数字部分（"cluster_" + clusterId）
     double centerLat;
     double centerLng;
     double radiusMeters;
@@ -54,8 +66,130 @@ struct ClusterConfig {
     double epsilonMeters = 50.0;      // DBSCAN 半径
     int minSamples = 10;               // 最小点数
     int64_t maxStayGapMs = 3600000;   // 1小时内视为连续停留
+    bool useSpatialIndex = true;      // false 时退回逐点线性扫描（基准对比用）
 };
 
+// ============================================================
+// 打包输出
+// ============================================================
+
+/**
+ * 打包结果中每个簇占 PACKED_CLUSTER_STRIDE 个 double，字段顺序见 PackedClusterField
+ * 类别用 categoryCode() 编码，名称由调用方按类别自行生成
+ */
+enum PackedClusterField {
+    PACKED_CLUSTER_ID = 0,
+    PACKED_CENTER_LAT,
+    PACKED_CENTER_LNG,
+    PACKED_RADIUS,
+    PACKED_POINT_COUNT,
+    PACKED_FIRST_SEEN,
+    PACKED_LAST_SEEN,
+    PACKED_TOTAL_STAY_MS,
+    PACKED_CONFIDENCE,
+    PACKED_CATEGORY,
+    PACKED_NIGHT_COUNT,
+    PACKED_WORKDAY_COUNT,
+    PACKED_WEEKEND_COUNT,
+    PACKED_WEEKDAY_HOUR_MASK,
+    PACKED_WEEKEND_HOUR_MASK,
+    PACKED_CLUSTER_STRIDE
+};
+
+/** 类别编码：home=0, work=1, gym=2, restaurant=3, other=4 */
+inline int categoryCode(const std::string& category) {
+    static const char* const codes[] = {"home", "work", "gym", "restaurant"};
+    for (int i = 0; i < 4; i++) {
+        if (category == codes[i]) return i;
+    }
+    return 4;
+}
+
+/**
+ * 把结果写入 out（长度至少 results.size() * PACKED_CLUSTER_STRIDE）
+ */
+inline void packClusterResults(const std::vector<ClusterResult>& results, double* out) {
+    for (size_t i = 0; i < results.size(); i++) {
+        const auto& r = results[i];
+        double* rec = out + i * PACKED_CLUSTER_STRIDE;
+        rec[PACKED_CLUSTER_ID] = r.clusterId;
+        rec[PACKED_CENTER_LAT] = r.centerLat;
+        rec[PACKED_CENTER_LNG] = r.centerLng;
+        rec[PACKED_RADIUS] = r.radiusMeters;
+        rec[PACKED_POINT_COUNT] = r.pointCount;
+        rec[PACKED_FIRST_SEEN] = static_cast<double>(r.firstSeen);
+        rec[PACKED_LAST_SEEN] = static_cast<double>(r.lastSeen);
+        rec[PACKED_TOTAL_STAY_MS] = static_cast<double>(r.totalStayMs);
+        rec[PACKED_CONFIDENCE] = r.confidence;
+        rec[PACKED_CATEGORY] = categoryCode(r.suggestedCategory);
+        rec[PACKED_NIGHT_COUNT] = r.timePattern.nightCount;
+        rec[PACKED_WORKDAY_COUNT] = r.timePattern.workdayCount;
+        rec[PACKED_WEEKEND_COUNT] = r.timePattern.weekendCount;
+        rec[PACKED_WEEKDAY_HOUR_MASK] = r.timePattern.weekdayHourMask;
+        rec[PACKED_WEEKEND_HOUR_MASK] = r.timePattern.weekendHourMask;
+    }
+}
+
+// ============================================================
+// 邻居查询
+// ============================================================
+
+/**
+ * 网格索引版邻居查询：(lat, lng) 半径 eps 内的点追加到 neighbors，跳过 exclude
+ * 先用等距矩形近似的平面距离平方粗筛，再对剩余候选做精确 haversine
+ */
+inline void queryNeighborsAt(const SpatialGrid& grid, const std::vector<GeoPoint>& points,
+                             double lat, double lng, double eps, size_t exclude,
+                             std::vector<size_t>& neighbors) {
+    // 平面近似在几百米内误差远小于 1%，放宽 1% 保证不误删
+    const double planarLimit = eps * 1.01 + 0.5;
+    const double planarLimitSq = planarLimit * planarLimit;
+    const double mPerDegLng = geo_utils::METERS_PER_DEG_LAT * std::cos(geo_utils::toRad(lat));
+    
+    grid.forEachCandidate(lat, lng, eps, [&](uint32_t i) {
+        if (i == exclude) return;
+        
+        const auto& q = points[i];
+        double dy = (q.latitude - lat) * geo_utils::METERS_PER_DEG_LAT;
+        double dx = (q.longitude - lng) * mPerDegLng;
+        if (dx * dx + dy * dy > planarLimitSq) return;
+        
+        double dist = haversineDistance(lat, lng, q.latitude, q.longitude);
+        if (dist <= eps) {
+            neighbors.push_back(i);
+        }
+    });
+}
+
+/**
+ * SoA 版邻居查询：haversine(p, q) <= eps 等价于单位球弦长² <= (2·sin(eps / 2R))²，
+ * 候选只需一次乘加比较，不再调用三角函数
+ */
+inline void queryNeighborsAt(const SpatialGrid& grid, const GeoPointSoA& pts,
+                             size_t idx, double eps, std::vector<size_t>& neighbors) {
+    const double halfChord = std::sin(std::min(eps / (2.0 * geo_utils::EARTH_RADIUS_METERS), geo_utils::PI / 2));
+    const double chordLimitSq = 4.0 * halfChord * halfChord;
+    const double qx = pts.x[idx], qy = pts.y[idx], qz = pts.z[idx];
+    
+    grid.forEachCandidate(pts.lat[idx], pts.lng[idx], eps, [&](uint32_t i) {
+        if (i == idx) return;
+        double dx = pts.x[i] - qx;
+        double dy = pts.y[i] - qy;
+        double dz = pts.z[i] - qz;
+        if (dx * dx + dy * dy + dz * dz <= chordLimitSq) {
+            neighbors.push_back(i);
+        }
+    });
+}
+
+/**
+ * points[idx] 的邻居（不含自身）
+ */
+inline void queryNeighbors(const SpatialGrid& grid, const std::vector<GeoPoint>& points,
+                           size_t idx, double eps, std::vector<size_t>& neighbors) {
+    queryNeighborsAt(grid, points, points[idx].latitude, points[idx].longitude, eps, idx, neighbors);
+}
+
 // ============================================================
 // DBSCAN 算法
 // ============================================================
@@ -65,129 +199,99 @@ public:
     explicit DBSCAN(const ClusterConfig& config = ClusterConfig{})
         : config_(config) {}
     
+    /**
+     * 设置取消标记（异步调用时使用），置位后 cluster() 尽快返回空结果
+     */
+    void setCancelFlag(const std::atomic<bool>* flag) { cancelFlag_ = flag; }
+    
     /**
      * 对点集进行聚类
      * @param points 输入点集
      * @return 聚类结果列表
      */
     std::vector<ClusterResult> cluster(const std::vector<GeoPoint>& points) {
+        NATIVE_METRICS_TRACE("dbscan.cluster");
+        NATIVE_METRICS_COUNT("dbscan.points_clustered", points.size());
         std::vector<ClusterResult> results;
         
         if (points.size() < static_cast<size_t>(config_.minSamples)) {
             return results;
         }
         
+        // 每次调用建一次网格索引，格子边长 = epsilon，邻域只落在相邻格子
+        // 点集转成 SoA（预计算单位球坐标）：索引路径做弦长比较，线性扫描走批量距离内核
+        soa_.assign(points);
+        if (config_.useSpatialIndex) {
+            grid_.reset(config_.epsilonMeters);
+            grid_.build(points);
+        }
+        
         // 访问标记
         std::vector<int> labels(points.size(), -1);  // -1 = unclassified, -2 = noise, >=0 = cluster id
         int clusterId = 0;
         
+        // 入队标记：queuedEpoch_[i] == epoch_ 表示 i 已在当前簇的队列中
+        queuedEpoch_.assign(points.size(), 0);
+        epoch_ = 0;
+        
         // DBSCAN 主循环
         for (size_t i = 0; i < points.size(); i++) {
             if (labels[i] != -1) continue;  // already processed
+            if (isCancelled()) {
+                releaseIndex();
+                return results;
+            }
             
-            auto neighbors = getNeighbors(points, i);
-            if (neighbors.size() < static_cast<size_t>(config_.minSamples)) {
+            getNeighbors(points, i, seedBuf_);
+            if (seedBuf_.size() < static_cast<size_t>(config_.minSamples)) {
                 labels[i] = -2;  // noise
                 continue;
             }
             
             // 扩展聚类
-            expandCluster(points, i, neighbors, labels, clusterId);
+            expandCluster(points, i, seedBuf_, labels, clusterId);
             clusterId++;
         }
         
-        // 构建聚类结果
-        for (int cid = 0; cid < clusterId; cid++) {
-            std::vector<size_t> indices;
-            for (size_t i = 0; i < points.size(); i++) {
-                if (labels[i] == cid) {
-                    indices.push_back(i);
-                }
-            }
-            
-            if (indices.size() >= static_cast<size_t>(config_.minSamples)) {
-                auto result = buildClusterResult(points, indices, cid);
-                results.push_back(result);
+        // 构建聚类结果：一次遍历按标签分桶，再并行构建各簇结果
+        std::vector<std::vector<size_t>> buckets(clusterId);
+        for (size_t i = 0; i < points.size(); i++) {
+            if (labels[i] >= 0) {
+                buckets[labels[i]].push_back(i);
             }
         }
         
-        return results;
-    }
-
-private:
-    ClusterConfig config_;
-    
-    /**
-     * 获取邻居点
-     */
-    std::vector<size_t> getNeighbors(const std::vector<GeoPoint>& points, size_t idx) {
-        std::vector<size_t> neighbors;
-        const auto& p = points[idx];
-        
-        for (size_t i = 0; i < points.size(); i++) {
-            if (i == idx) continue;
-            
-            double dist = haversineDistance(p.latitude, p.longitude, 
-                                           points[i].latitude, points[i].longitude);
-            if (dist <= config_.epsilonMeters) {
-                neighbors.push_back(i);
+        std::vector<int> kept;
+        for (int cid = 0; cid < clusterId; cid++) {
+            if (buckets[cid].size() >= static_cast<size_t>(config_.minSamples)) {
+                kept.push_back(cid);
             }
         }
         
-        return neighbors;
-    }
-    
-    /**
-     * 扩展聚类
-     */
-    void expandCluster(const std::vector<GeoPoint>& points,
-                       size_t idx,
-                       std::vector<size_t>& neighbors,
-                       std::vector<int>& labels,
-                       int clusterId) {
-        labels[idx] = clusterId;
-        
-        std::vector<size_t> queue = neighbors;
-        size_t queueIdx = 0;
-        
-        while (queueIdx < queue.size()) {
-            size_t current = queue[queueIdx];
-            queueIdx++;
-            
-            if (labels[current] == -2) {
-                labels[current] = clusterId;  // change noise to border point
-            }
-            
-            if (labels[current] != -1) continue;  // already processed
-            
-            labels[current] = clusterId;
-            
-            auto currentNeighbors = getNeighbors(points, current);
-            if (currentNeighbors.size() >= static_cast<size_t>(config_.minSamples)) {
-                // 添加新邻居到队列
-                for (size_t n : currentNeighbors) {
-                    if (labels[n] == -1 || labels[n] == -2) {
-                        bool found = false;
-                        for (size_t q : queue) {
-                            if (q == n) { found = true; break; }
-                        }
-                        if (!found) {
-                            queue.push_back(n);
-                        }
-                    }
-                }
-            }
+        results.resize(kept.size());
+        auto build = [&](size_t k) {
+            results[k] = buildClusterResult(points, buckets[kept[k]], kept[k]);
+        };
+        if (kept.size() >= PARALLEL_BUILD_MIN_CLUSTERS) {
+            native_common::ThreadPool::shared().parallelFor(kept.size(), build);
+        } else {
+            for (size_t k = 0; k < kept.size(); k++) build(k);
         }
+        
+        releaseIndex();
+        return results;
     }
     
     /**
-     * 构建聚类结果
+     * 由簇成员下标构建聚类结果（IncrementalDBSCAN 复用）
+     * 只读成员状态，可在多个线程中并发调用
      */
     ClusterResult buildClusterResult(const std::vector<GeoPoint>& points,
                                      const std::vector<size_t>& indices,
-                                     int clusterId) {
+                                     int clusterId) const {
         ClusterResult result;
         result.id = "cluster_" + std::to_string(clusterId);
+        result.clusterId = clusterId;
         
         // 提取点
         std::vector<GeoPoint> clusterPoints;
@@ -200,9 +304,9 @@ private:
         calculateCenter(clusterPoints, result.centerLat, result.centerLng);
         
         // 计算半径
-        result.radiusMeters = calculatePercentileRadius(clusterPoints, 
-                                                        result.centerLat, 
-                                                        result.centerLng, 0.95);
+        GeoPointSoA soa;
+        soa.assign(clusterPoints);
+        result.radiusMeters = calculatePercentileRadius(soa, result.centerLat, result.centerLng, 0.95);
         
         result.pointCount = static_cast<int>(clusterPoints.size());
         
@@ -241,34 +345,135 @@ private:
         
         return result;
     }
+
+private:
+    // 簇数达到该值才分发到线程池，少量簇时线程唤醒开销大于收益
+    static constexpr size_t PARALLEL_BUILD_MIN_CLUSTERS = 4;
+    
+    ClusterConfig config_;
+    SpatialGrid grid_;
+    GeoPointSoA soa_;
+    const std::atomic<bool>* cancelFlag_ = nullptr;
+    
+    // 跨调用复用的缓冲区，避免每次邻居查询都分配新 vector
+    std::vector<size_t> seedBuf_;
+    std::vector<size_t> neighborBuf_;
+    std::vector<size_t> queue_;
+    std::vector<uint32_t> queuedEpoch_;
+    std::vector<double> distBuf_;
+    uint32_t epoch_ = 0;
+    
+    bool isCancelled() const {
+        return cancelFlag_ && cancelFlag_->load(std::memory_order_relaxed);
+    }
+    
+    /** 释放本次 cluster() 建的索引 */
+    void releaseIndex() {
+        grid_.clear();
+        soa_.clear();
+    }
+    
+    /**
+     * 获取邻居点（结果写入 neighbors，原有内容会被清空）
+     */
+    void getNeighbors(const std::vector<GeoPoint>& points, size_t idx, std::vector<size_t>& neighbors) {
+        NATIVE_METRICS_COUNT("dbscan.region_queries", 1);
+        neighbors.clear();
+        if (config_.useSpatialIndex) {
+            getNeighborsIndexed(points, idx, neighbors);
+            return;
+        }
+        
+        const auto& p = points[idx];
+        geo_utils::haversineMany(p.latitude, p.longitude, soa_, distBuf_);
+        
+        for (size_t i = 0; i < points.size(); i++) {
+            if (i == idx) continue;
+            if (distBuf_[i] <= config_.epsilonMeters) {
+                neighbors.push_back(i);
+            }
+        }
+    }
+    
+    void getNeighborsIndexed(const std::vector<GeoPoint>& /*points*/, size_t idx, std::vector<size_t>& neighbors) {
+        queryNeighborsAt(grid_, soa_, idx, config_.epsilonMeters, neighbors);
+    }
+    
+    /**
+     * 扩展聚类
+     * 队列去重用 epoch 标记，O(1) 判断是否已入队
+     */
+    void expandCluster(const std::vector<GeoPoint>& points,
+                       size_t idx,
+                       const std::vector<size_t>& neighbors,
+                       std::vector<int>& labels,
+                       int clusterId) {
+        labels[idx] = clusterId;
+        
+        // 每个簇一个新 epoch，无需清空标记数组
+        if (++epoch_ == 0) {
+            std::fill(queuedEpoch_.begin(), queuedEpoch_.end(), 0);
+            epoch_ = 1;
+        }
+        
+        queue_.assign(neighbors.begin(), neighbors.end());
+        for (size_t n : neighbors) {
+            queuedEpoch_[n] = epoch_;
+        }
+        size_t queueIdx = 0;
+        
+        while (queueIdx < queue_.size()) {
+            // 大簇扩展可能很久，定期检查取消（主循环随后返回）
+            if ((queueIdx & 0xFF) == 0 && isCancelled()) return;
+            
+            size_t current = queue_[queueIdx];
+            queueIdx++;
+            
+            if (labels[current] == -2) {
+                labels[current] = clusterId;  // change noise to border point
+            }
+            
+            if (labels[current] != -1) continue;  // already processed
+            
+            labels[current] = clusterId;
+            
+            getNeighbors(points, current, neighborBuf_);
+            if (neighborBuf_.size() >= static_cast<size_t>(config_.minSamples)) {
+                // 添加新邻居到队列
+                for (size_t n : neighborBuf_) {
+                    if ((labels[n] == -1 || labels[n] == -2) && queuedEpoch_[n] != epoch_) {
+                        queuedEpoch_[n] = epoch_;
+                        queue_.push_back(n);
+                    }
+                }
+            }
+        }
+    }
     
     /**
      * 分析时间模式
+     * 出现过的小时用 24 位掩码记录，最后按位展开为升序小时列表
      */
-    TimePattern analyzeTimePattern(const std::vector<GeoPoint>& points) {
+    TimePattern analyzeTimePattern(const std::vector<GeoPoint>& points) const {
         TimePattern pattern;
         
         for (const auto& p : points) {
             // 简化：假设 timestamp 是 Unix 毫秒
             int64_t seconds = p.timestamp / 1000;
-            int hour = (seconds / 3600) % 24;
-            int dayOfWeek = ((seconds / 86400) + 4) % 7;  // 1970-01-01 是周四
+            int hour = static_cast<int>((seconds / 3600) % 24);
+            int dayOfWeek = static_cast<int>(((seconds / 86400) + 4) % 7);  // 1970-01-01 是周四
+            if (hour < 0) hour += 24;   // 1970 年以前的时间戳，保证移位合法
+            if (dayOfWeek < 0) dayOfWeek += 7;
             
             bool isWeekend = (dayOfWeek == 0 || dayOfWeek == 6);
             bool isNight = (hour >= 22 || hour < 6);
             bool isWorkHour = (hour >= 9 && hour < 18);
             
             if (isWeekend) {
-                if (std::find(pattern.weekendHours.begin(), pattern.weekendHours.end(), hour) 
-                    == pattern.weekendHours.end()) {
-                    pattern.weekendHours.push_back(hour);
-                }
+                pattern.weekendHourMask |= (1u << hour);
                 pattern.weekendCount++;
             } else {
-                if (std::find(pattern.weekdayHours.begin(), pattern.weekdayHours.end(), hour) 
-                    == pattern.weekdayHours.end()) {
-                    pattern.weekdayHours.push_back(hour);
-                }
+                pattern.weekdayHourMask |= (1u << hour);
                 if (isWorkHour) {
                     pattern.workdayCount++;
                 }
@@ -279,13 +484,18 @@ private:
             }
         }
         
+        for (int h = 0; h < 24; h++) {
+            if (pattern.weekdayHourMask & (1u << h)) pattern.weekdayHours.push_back(h);
+            if (pattern.weekendHourMask & (1u << h)) pattern.weekendHours.push_back(h);
+        }
+        
         return pattern;
     }
     
     /**
      * 推断类别
      */
-    std::string inferCategory(const TimePattern& pattern, int totalPoints) {
+    std::string inferCategory(const TimePattern& pattern, int totalPoints) const {
         double nightRatio = static_cast<double>(pattern.nightCount) / totalPoints;
         double workdayRatio = static_cast<double>(pattern.workdayCount) / totalPoints;
         double weekendRatio = static_cast<double>(pattern.weekendCount) / totalPoints;
@@ -293,11 +503,10 @@ private:
         if (nightRatio > 0.4) return "home";
         if (workdayRatio > 0.5 && weekendRatio < 0.2) return "work";
         if (weekendRatio > 0.4) return "gym";
-        if (!pattern.weekdayHours.empty()) {
-            for (int h : pattern.weekdayHours) {
-                if (h >= 11 && h <= 14) return "restaurant";
-            }
-        }
+        
+        // 工作日 11:00-14:59 出现过
+        constexpr uint32_t LUNCH_HOURS = (1u << 11) | (1u << 12) | (1u << 13) | (1u << 14);
+        if (pattern.weekdayHourMask & LUNCH_HOURS) return "restaurant";
         
         return "other";
     }
@@ -305,7 +514,7 @@ private:
     /**
      * 生成名称
      */
-    std::string generateName(const std::string& category) {
+    std::string generateName(const std::string& category) const {
         static const std::unordered_map<std::string, std::string> names = {
             {"home", "家"},
             {"work", "公司"},
@@ -321,7 +530,7 @@ private:
     /**
      * 计算置信度
      */
-    double calculateConfidence(const ClusterResult& result) {
+    double calculateConfidence(const ClusterResult& result) const {
         double score = 0;
         
         // 点数
@@ -332,8 +541,8 @@ private:
         
         // 时间规律性
         double regularity = 0;
-        if (!result.timePattern.weekdayHours.empty()) regularity += 0.2;
-        if (!result.timePattern.weekendHours.empty()) regularity += 0.2;
+        if (result.timePattern.weekdayHourMask != 0) regularity += 0.2;
+        if (result.timePattern.weekendHourMask != 0) regularity += 0.2;
         score += regularity;
         
         return std::min(score, 1.0);
@@ -3,6 +3,11 @@
  */
 #include <napi/native_api.h>
 #include "dbscan_cluster.h"
+#include "incremental_dbscan.h"
+#include "common/napi_async.h"
+#include "common/napi_typed_array.h"
+#include "common/metrics_napi.h"
+#include <memory>
 #include <vector>
 #include <string>
 
@@ -71,42 +76,37 @@ static napi_value CreateIntArray(napi_env env, const std::vector<int>& arr) {
     return result;
 }
 
-// ============================================================
-// NAPI bindings
-// ============================================================
+static std::string GetStringArg(napi_env env, napi_value val) {
+    size_t len = 0;
+    if (napi_get_value_string_utf8(env, val, nullptr, 0, &len) != napi_ok) return "";
+    std::string result(len, '\0');
+    napi_get_value_string_utf8(env, val, &result[0], len + 1, &len);
+    return result;
+}
 
-/**
- * dbscan.cluster(points, config?) → ClusterResult[]
- * 
- * points: [{ latitude, longitude, timestamp, accuracy }]
- * config: { epsilonMeters?, minSamples? }
- */
-static napi_value RunCluster(napi_env env, napi_callback_info info) {
-    size_t argc = 2;
-    napi_value args[2];
-    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
-    
-    if (argc < 1) {
-        napi_throw_error(env, nullptr, "Expected at least 1 argument: points");
-        return nullptr;
-    }
-    
-    // 解析配置
+static napi_value CreateBool(napi_env env, bool val) {
+    napi_value result;
+    napi_get_boolean(env, val, &result);
+    return result;
+}
+
+static ClusterConfig ParseConfig(napi_env env, napi_value obj) {
     ClusterConfig config;
-    if (argc >= 2) {
-        config.epsilonMeters = GetDoubleProp(env, args[1], "epsilonMeters", 50.0);
-        config.minSamples = GetIntProp(env, args[1], "minSamples", 10);
-    }
-    
-    // 解析 points 数组
+    config.epsilonMeters = GetDoubleProp(env, obj, "epsilonMeters", 50.0);
+    config.minSamples = GetIntProp(env, obj, "minSamples", 10);
+    return config;
+}
+
+static std::vector<GeoPoint> ParsePoints(napi_env env, napi_value arr) {
+    NATIVE_METRICS_SCOPE("dbscan.parse_points");
     std::vector<GeoPoint> points;
-    uint32_t arrayLen;
-    napi_get_array_length(env, args[0], &arrayLen);
+    uint32_t arrayLen = 0;
+    napi_get_array_length(env, arr, &arrayLen);
     points.reserve(arrayLen);
     
     for (uint32_t i = 0; i < arrayLen; i++) {
         napi_value elem;
-        napi_get_element(env, args[0], i, &elem);
+        napi_get_element(env, arr, i, &elem);
         
         GeoPoint p;
         p.latitude = GetDoubleProp(env, elem, "latitude", 0);
@@ -116,12 +116,43 @@ static napi_value RunCluster(napi_env env, napi_callback_info info) {
         
         points.push_back(p);
     }
+    return points;
+}
+
+/**
+ * 读取打包点集（Float64Array / ArrayBuffer，步长 stride），类型不符时抛错并返回 false
+ */
+static bool ParsePackedPoints(napi_env env, napi_value data, napi_value strideArg, std::vector<GeoPoint>& out) {
+    NATIVE_METRICS_SCOPE("dbscan.parse_points");
+    native_common::Float64View view;
+    if (!native_common::GetFloat64View(env, data, view)) {
+        napi_throw_type_error(env, nullptr, "Expected Float64Array or ArrayBuffer of packed points");
+        return false;
+    }
     
-    // 执行聚类
-    DBSCAN dbscan(config);
-    auto results = dbscan.cluster(points);
+    int32_t stride = 3;
+    if (strideArg != nullptr) {
+        napi_valuetype type;
+        napi_typeof(env, strideArg, &type);
+        if (type == napi_number) napi_get_value_int32(env, strideArg, &stride);
+    }
+    if (stride < 2) {
+        napi_throw_range_error(env, nullptr, "stride must be >= 2");
+        return false;
+    }
     
-    // 构建返回数组
+    out = geo_utils::unpackPoints(view.data, view.length, static_cast<size_t>(stride));
+    return true;
+}
+
+static napi_value CreatePackedClusterArray(napi_env env, const std::vector<ClusterResult>& results) {
+    double* out = nullptr;
+    napi_value array = native_common::CreateFloat64Array(env, results.size() * PACKED_CLUSTER_STRIDE, &out);
+    if (out) packClusterResults(results, out);
+    return array;
+}
+
+static napi_value CreateClusterResultArray(napi_env env, const std::vector<ClusterResult>& results) {
     napi_value resultArray;
     napi_create_array_with_length(env, results.size(), &resultArray);
     
@@ -160,6 +191,287 @@ static napi_value RunCluster(napi_env env, napi_callback_info info) {
     return resultArray;
 }
 
+// ============================================================
+// NAPI bindings
+// ============================================================
+
+/**
+ * dbscan.cluster(points, config?) → ClusterResult[]
+ * 
+ * points: [{ latitude, longitude, timestamp, accuracy }]
+ * config: { epsilonMeters?, minSamples? }
+ */
+static napi_value RunCluster(napi_env env, napi_callback_info info) {
+    size_t argc = 2;
+    napi_value args[2];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+    
+    if (argc < 1) {
+        napi_throw_error(env, nullptr, "Expected at least 1 argument: points");
+        return nullptr;
+    }
+    
+    // 解析配置
+    ClusterConfig config;
+    if (argc >= 2) {
+        config = ParseConfig(env, args[1]);
+    }
+    
+    // 解析 points 数组
+    std::vector<GeoPoint> points = ParsePoints(env, args[0]);
+    
+    // 执行聚类
+    DBSCAN dbscan(config);
+    auto results = dbscan.cluster(points);
+    
+    return CreateClusterResultArray(env, results);
+}
+
+// ============================================================
+// Packed (typed array) variants
+// ============================================================
+
+/**
+ * dbscan.clusterPacked(data, stride?, config?) → Float64Array
+ *
+ * data: Float64Array / ArrayBuffer，每点 stride 个 double
+ *       [lat, lng, timestamp(, accuracy)]，stride 默认 3
+ * 返回: 每簇 PACKED_CLUSTER_STRIDE 个 double，字段顺序见 dbscan_cluster.h PackedClusterField
+ */
+static napi_value ClusterPacked(napi_env env, napi_callback_info info) {
+    size_t argc = 3;
+    napi_value args[3];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+    
+    if (argc < 1) {
+        napi_throw_error(env, nullptr, "Expected at least 1 argument: data");
+        return nullptr;
+    }
+    
+    std::vector<GeoPoint> points;
+    if (!ParsePackedPoints(env, args[0], argc >= 2 ? args[1] : nullptr, points)) return nullptr;
+    
+    ClusterConfig config;
+    if (argc >= 3) {
+        config = ParseConfig(env, args[2]);
+    }
+    
+    DBSCAN dbscan(config);
+    return CreatePackedClusterArray(env, dbscan.cluster(points));
+}
+
+// ============================================================
+// Async variants
+// ============================================================
+
+static native_common::AsyncRunner g_async("dbscan");
+
+/**
+ * dbscan.clusterAsync(points, config?, taskId?) → Promise<ClusterResult[]>
+ * 输入在 JS 线程解析，聚类在工作线程执行
+ */
+static napi_value ClusterAsync(napi_env env, napi_callback_info info) {
+    size_t argc = 3;
+    napi_value args[3];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+    
+    if (argc < 1) {
+        napi_throw_error(env, nullptr, "Expected at least 1 argument: points");
+        return nullptr;
+    }
+    
+    struct State {
+        ClusterConfig config;
+        std::vector<GeoPoint> points;
+        std::vector<ClusterResult> results;
+    };
+    auto state = std::make_shared<State>();
+    if (argc >= 2) {
+        napi_valuetype type;
+        napi_typeof(env, args[1], &type);
+        if (type == napi_object) state->config = ParseConfig(env, args[1]);
+    }
+    state->points = ParsePoints(env, args[0]);
+    std::string taskId = argc >= 3 ? GetStringArg(env, args[2]) : "";
+    
+    auto task = native_common::makeAsyncTask(
+        [state](native_common::AsyncTask& self) {
+            DBSCAN dbscan(state->config);
+            dbscan.setCancelFlag(self.cancelFlag());
+            state->results = dbscan.cluster(state->points);
+        },
+        [state](napi_env e) { return CreateClusterResultArray(e, state->results); });
+    return g_async.submit(env, std::move(task), taskId);
+}
+
+/**
+ * dbscan.clusterPackedAsync(data, stride?, config?, taskId?) → Promise<Float64Array>
+ * 输入缓冲区在 JS 线程拷贝，之后修改不影响计算
+ */
+static napi_value ClusterPackedAsync(napi_env env, napi_callback_info info) {
+    size_t argc = 4;
+    napi_value args[4];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+    
+    if (argc < 1) {
+        napi_throw_error(env, nullptr, "Expected at least 1 argument: data");
+        return nullptr;
+    }
+    
+    struct State {
+        ClusterConfig config;
+        std::vector<GeoPoint> points;
+        std::vector<ClusterResult> results;
+    };
+    auto state = std::make_shared<State>();
+    if (!ParsePackedPoints(env, args[0], argc >= 2 ? args[1] : nullptr, state->points)) return nullptr;
+    if (argc >= 3) {
+        napi_valuetype type;
+        napi_typeof(env, args[2], &type);
+        if (type == napi_object) state->config = ParseConfig(env, args[2]);
+    }
+    std::string taskId = argc >= 4 ? GetStringArg(env, args[3]) : "";
+    
+    auto task = native_common::makeAsyncTask(
+        [state](native_common::AsyncTask& self) {
+            DBSCAN dbscan(state->config);
+            dbscan.setCancelFlag(self.cancelFlag());
+            state->results = dbscan.cluster(state->points);
+        },
+        [state](napi_env e) { return CreatePackedClusterArray(e, state->results); });
+    return g_async.submit(env, std::move(task), taskId);
+}
+
+/**
+ * dbscan.cancelAsync(taskId) → boolean  是否找到该任务
+ */
+static napi_value CancelAsync(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+    
+    if (argc < 1) {
+        napi_throw_error(env, nullptr, "Expected 1 argument: taskId");
+        return nullptr;
+    }
+    return CreateBool(env, g_async.cancel(env, GetStringArg(env, args[0])));
+}
+
+/**
+ * dbscan.setAsyncConcurrency(n) → void  同时运行的异步任务上限
+ */
+static napi_value SetAsyncConcurrency(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+    
+    int32_t n = 0;
+    if (argc >= 1) napi_get_value_int32(env, args[0], &n);
+    g_async.setMaxConcurrent(n > 0 ? static_cast<size_t>(n) : 1);
+    return nullptr;
+}
+
+// ============================================================
+// Incremental clustering
+// ============================================================
+
+// 增量聚类状态常驻模块内，后台任务每次唤醒只追加新点
+static std::unique_ptr<IncrementalDBSCAN> g_incremental;
+
+static IncrementalDBSCAN& Incremental() {
+    if (!g_incremental) {
+        g_incremental = std::make_unique<IncrementalDBSCAN>();
+    }
+    return *g_incremental;
+}
+
+/**
+ * dbscan.incrementalInit(config?) → void
+ * 丢弃已有状态并以新配置重建
+ */
+static napi_value IncrementalInit(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+    
+    ClusterConfig config;
+    if (argc >= 1) {
+        config = ParseConfig(env, args[0]);
+    }
+    g_incremental = std::make_unique<IncrementalDBSCAN>(config);
+    return nullptr;
+}
+
+/**
+ * dbscan.incrementalInsert(points) → number  当前保留的点数
+ */
+static napi_value IncrementalInsert(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+    
+    if (argc < 1) {
+        napi_throw_error(env, nullptr, "Expected 1 argument: points");
+        return nullptr;
+    }
+    
+    size_t total = Incremental().insert(ParsePoints(env, args[0]));
+    return CreateInt64(env, static_cast<int64_t>(total));
+}
+
+/**
+ * dbscan.incrementalInsertPacked(data, stride?) → number
+ */
+static napi_value IncrementalInsertPacked(napi_env env, napi_callback_info info) {
+    size_t argc = 2;
+    napi_value args[2];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+    
+    if (argc < 1) {
+        napi_throw_error(env, nullptr, "Expected at least 1 argument: data");
+        return nullptr;
+    }
+    
+    std::vector<GeoPoint> points;
+    if (!ParsePackedPoints(env, args[0], argc >= 2 ? args[1] : nullptr, points)) return nullptr;
+    size_t total = Incremental().insert(points);
+    return CreateInt64(env, static_cast<int64_t>(total));
+}
+
+/**
+ * dbscan.incrementalExpire(olderThan) → number  删除的点数
+ */
+static napi_value IncrementalExpire(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+    
+    if (argc < 1) {
+        napi_throw_error(env, nullptr, "Expected 1 argument: olderThan");
+        return nullptr;
+    }
+    
+    int64_t olderThan = 0;
+    napi_get_value_int64(env, args[0], &olderThan);
+    size_t removed = Incremental().expire(olderThan);
+    return CreateInt64(env, static_cast<int64_t>(removed));
+}
+
+/**
+ * dbscan.incrementalSnapshot() → ClusterResult[]
+ * 簇 id 在多次调用间保持稳定
+ */
+static napi_value IncrementalSnapshot(napi_env env, napi_callback_info info) {
+    return CreateClusterResultArray(env, Incremental().snapshot());
+}
+
+/**
+ * dbscan.incrementalSnapshotPacked() → Float64Array  布局同 clusterPacked
+ */
+static napi_value IncrementalSnapshotPacked(napi_env env, napi_callback_info info) {
+    return CreatePackedClusterArray(env, Incremental().snapshot());
+}
+
 // ============================================================
 // Module registration
 // ============================================================
@@ -169,6 +481,20 @@ EXTERN_C_START
 static napi_value Init(napi_env env, napi_value exports) {
     napi_property_descriptor desc[] = {
         {"cluster", nullptr, RunCluster, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"clusterPacked", nullptr, ClusterPacked, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"clusterAsync", nullptr, ClusterAsync, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"clusterPackedAsync", nullptr, ClusterPackedAsync, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"cancelAsync", nullptr, CancelAsync, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"setAsyncConcurrency", nullptr, SetAsyncConcurrency, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"incrementalInit", nullptr, IncrementalInit, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"incrementalInsert", nullptr, IncrementalInsert, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"incrementalInsertPacked", nullptr, IncrementalInsertPacked, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"incrementalExpire", nullptr, IncrementalExpire, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"incrementalSnapshot", nullptr, IncrementalSnapshot, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"incrementalSnapshotPacked", nullptr, IncrementalSnapshotPacked, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"packedClusterStride", nullptr, nullptr, nullptr, nullptr,
+         CreateInt64(env, PACKED_CLUSTER_STRIDE), napi_default, nullptr},
+        native_common::MetricsProperty("dbscan"),
     };
     
     napi_define_properties(env, exports, sizeof(desc) / sizeof(desc[0]), desc);
@@ -0,0 +1,674 @@
+/**
+ * incremental_dbscan.h — 增量 DBSCAN
+ *
+ * 在两次调用之间保留点集、邻居计数、核心点标记、簇标签与网格索引：
+ *   - insert(points)     新点只会让簇合并或扩张，按核心点变化做并查式合并，不重扫
+ *   - expire(olderThan)  删点可能导致簇分裂，只对受影响的簇重新扩展
+ *   - snapshot()         只重算成员有变化的簇，其余返回缓存结果
+ *
+ * 簇编号在多次调用间保持稳定：合并取较大簇的编号，重扩展后按成员重叠度
+ * 继承旧编号，保证"家""公司"等地点的 id 不会因为新增数据而错位。
+ *
+ * 核心点定义与 DBSCAN::cluster() 一致：epsilon 内邻居数（不含自身）>= minSamples。
+ */
+#pragma once
+
+#include "dbscan_cluster.h"
+#include <vector>
+#include <unordered_map>
+#include <queue>
+#include <algorithm>
+#include <functional>
+#include <cstdint>
+#include <utility>
+
+namespace dbscan {
+
+class IncrementalDBSCAN {
+public:
+    explicit IncrementalDBSCAN(const ClusterConfig& config = ClusterConfig{})
+        : config_(config), builder_(config), grid_(config.epsilonMeters) {}
+
+    /**
+     * 加入一批新点
+     * @return 当前存活点数
+     */
+    size_t insert(const std::vector<GeoPoint>& newPoints) {
+        if (newPoints.empty()) return aliveCount_;
+        NATIVE_METRICS_SCOPE("dbscan.incremental_insert");
+
+        // 1. 分配槽位并入网格（先全部入网格，新点之间互相可见）
+        std::vector<size_t> added;
+        added.reserve(newPoints.size());
+        for (const auto& p : newPoints) {
+            size_t slot = allocSlot(p);
+            grid_.insert(static_cast<uint32_t>(slot), p.latitude, p.longitude);
+            expiry_.push({p.timestamp, slot, gen_[slot]});
+            added.push_back(slot);
+        }
+
+        // 2. 维护邻居计数：新点做完整查询，老点只累加新邻居；
+        //    老点计数恰好达到 minSamples 时即被"提拔"为核心点
+        std::vector<size_t> newCores;
+        for (size_t s : added) {
+            neighborBuf_.clear();
+            queryNeighborsAt(grid_, soa_, s, config_.epsilonMeters, neighborBuf_);
+            nbrCount_[s] = static_cast<uint32_t>(neighborBuf_.size());
+            for (size_t q : neighborBuf_) {
+                if (pendingNew_[q]) continue;
+                if (++nbrCount_[q] == minSamples() && !isCore_[q]) {
+                    isCore_[q] = 1;
+                    newCores.push_back(q);
+                }
+            }
+        }
+
+        // 3. 新点中的核心点
+        for (size_t s : added) {
+            if (nbrCount_[s] >= minSamples()) {
+                isCore_[s] = 1;
+                newCores.push_back(s);
+            }
+        }
+
+        // 4. 每个新核心点合并其核心邻居所在的簇，并吸收非核心邻居为边界点
+        for (size_t c : newCores) {
+            absorbCore(c);
+        }
+
+        // 5. 剩余新点：有核心邻居则成为边界点，否则为噪声
+        for (size_t s : added) {
+            if (labels_[s] >= 0) continue;
+            labels_[s] = NOISE;
+            neighborBuf_.clear();
+            queryNeighborsAt(grid_, soa_, s, config_.epsilonMeters, neighborBuf_);
+            for (size_t q : neighborBuf_) {
+                if (isCore_[q] && labels_[q] >= 0) {
+                    addMember(labels_[q], s);
+                    break;
+                }
+            }
+        }
+
+        for (size_t s : added) pendingNew_[s] = 0;
+        return aliveCount_;
+    }
+
+    /**
+     * 删除 timestamp < olderThan 的所有点
+     * @return 删除的点数
+     */
+    size_t expire(int64_t olderThan) {
+        NATIVE_METRICS_SCOPE("dbscan.incremental_expire");
+        std::vector<size_t> removed;
+        while (!expiry_.empty() && expiry_.top().timestamp < olderThan) {
+            ExpiryEntry e = expiry_.top();
+            expiry_.pop();
+            if (!alive_[e.slot] || gen_[e.slot] != e.gen) continue;   // 槽位已被回收
+            removed.push_back(e.slot);
+        }
+        if (removed.empty()) return 0;
+
+        // 1. 先全部移出网格，被删点之间不再互相计数
+        for (size_t s : removed) {
+            grid_.remove(static_cast<uint32_t>(s), points_[s].latitude, points_[s].longitude);
+        }
+
+        // 2. 更新邻居计数；被删的核心点与失去核心身份的点，其邻居是连通性可能变化的边界
+        std::vector<size_t> lostCores;
+        std::vector<int> touched;
+        for (size_t s : removed) {
+            if (labels_[s] >= 0) touched.push_back(labels_[s]);
+            if (isCore_[s]) lostCores.push_back(s);
+            neighborBuf_.clear();
+            queryNeighborsAt(grid_, soa_, s, config_.epsilonMeters, neighborBuf_);
+            for (size_t q : neighborBuf_) {
+                nbrCount_[q]--;
+                if (isCore_[q] && nbrCount_[q] < minSamples()) {
+                    isCore_[q] = 0;
+                    lostCores.push_back(q);
+                }
+            }
+        }
+        for (size_t s : removed) {
+            freeSlot(s);
+        }
+
+        // 3. 按簇收集：仍为核心的邻居作为连通性检查的种子，非核心邻居需要重新判定归属
+        std::unordered_map<int, std::vector<size_t>> seeds;
+        std::vector<size_t> borders;
+        if (touchMark_.size() < points_.size()) touchMark_.resize(points_.size(), 0);
+        uint32_t touchEpoch = nextEpoch();
+        for (size_t c : lostCores) {
+            if (alive_[c] && touchMark_[c] != touchEpoch) {
+                touchMark_[c] = touchEpoch;
+                borders.push_back(c);   // 降级后的点本身也要重新判定
+            }
+            // 已删除的点不在网格中，按其坐标查询即可
+            neighborBuf_.clear();
+            queryNeighborsAt(grid_, soa_, c, config_.epsilonMeters, neighborBuf_);
+            for (size_t q : neighborBuf_) {
+                if (touchMark_[q] == touchEpoch) continue;
+                touchMark_[q] = touchEpoch;
+                if (labels_[q] < 0) continue;
+                if (isCore_[q]) {
+                    seeds[labels_[q]].push_back(q);
+                } else {
+                    borders.push_back(q);
+                }
+            }
+        }
+
+        // 4. 种子在簇内仍全部经核心点互相可达则簇未分裂，否则只对该簇重新扩展
+        std::vector<int> affected;
+        for (auto& kv : seeds) {
+            touched.push_back(kv.first);
+            if (!coresConnected(kv.first, kv.second)) {
+                affected.push_back(kv.first);
+            }
+        }
+        std::sort(affected.begin(), affected.end());
+        reexpand(affected);
+
+        // 5. 未重扩展的簇：边界点找新的核心邻居，找不到则成为噪声
+        for (size_t q : borders) {
+            int cid = labels_[q];
+            if (cid < 0 || isCore_[q]) continue;
+            if (std::binary_search(affected.begin(), affected.end(), cid)) continue;
+            touched.push_back(cid);
+
+            int newLabel = NOISE;
+            neighborBuf_.clear();
+            queryNeighborsAt(grid_, soa_, q, config_.epsilonMeters, neighborBuf_);
+            for (size_t n : neighborBuf_) {
+                if (isCore_[n] && labels_[n] >= 0) {
+                    newLabel = labels_[n];
+                    if (newLabel == cid) break;   // 优先留在原簇
+                }
+            }
+            if (newLabel != cid) {
+                labels_[q] = NOISE;
+                if (newLabel >= 0) addMember(newLabel, q);
+            }
+        }
+
+        // 6. 剔除成员表中已删除 / 已转出的点，空簇直接移除
+        std::sort(touched.begin(), touched.end());
+        touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+        for (int cid : touched) {
+            auto it = clusters_.find(cid);
+            if (it == clusters_.end()) continue;
+            auto& members = it->second.members;
+            members.erase(std::remove_if(members.begin(), members.end(),
+                                         [&](size_t m) { return labels_[m] != cid; }),
+                          members.end());
+            it->second.dirty = true;
+            if (members.empty()) clusters_.erase(it);
+        }
+
+        return removed.size();
+    }
+
+    /**
+     * 当前聚类结果（按簇编号升序），只重算有变化的簇
+     */
+    std::vector<ClusterResult> snapshot() {
+        std::vector<int> ids;
+        ids.reserve(clusters_.size());
+        for (const auto& kv : clusters_) ids.push_back(kv.first);
+        std::sort(ids.begin(), ids.end());
+
+        // 有变化的簇并行重算
+        std::vector<std::pair<int, Cluster*>> dirty;
+        for (int id : ids) {
+            auto& cl = clusters_[id];
+            if (cl.dirty && cl.members.size() >= static_cast<size_t>(config_.minSamples)) {
+                dirty.emplace_back(id, &cl);
+            }
+        }
+        native_common::ThreadPool::shared().parallelFor(dirty.size(), [&](size_t k) {
+            Cluster& cl = *dirty[k].second;
+            cl.cached = builder_.buildClusterResult(points_, cl.members, dirty[k].first);
+            cl.dirty = false;
+        });
+
+        std::vector<ClusterResult> results;
+        for (int id : ids) {
+            const auto& cl = clusters_[id];
+            if (cl.members.size() < static_cast<size_t>(config_.minSamples)) continue;
+            results.push_back(cl.cached);
+        }
+        return results;
+    }
+
+    /**
+     * 清空全部状态（簇编号从 0 重新开始）
+     */
+    void clear() {
+        points_.clear();
+        soa_.clear();
+        labels_.clear();
+        nbrCount_.clear();
+        isCore_.clear();
+        alive_.clear();
+        gen_.clear();
+        freeSlots_.clear();
+        pendingNew_.clear();
+        queuedEpoch_.clear();
+        touchMark_.clear();
+        expiry_ = ExpiryHeap();
+        clusters_.clear();
+        grid_.reset(config_.epsilonMeters);
+        aliveCount_ = 0;
+        nextClusterId_ = 0;
+    }
+
+    /**
+     * 逐个访问存活点：fn(point, clusterId, isCore)，clusterId < 0 为噪声
+     * 基准用它与全量 DBSCAN 的划分逐点比较
+     */
+    template <typename Fn>
+    void forEachPoint(Fn&& fn) const {
+        for (size_t s = 0; s < points_.size(); s++) {
+            if (alive_[s]) fn(points_[s], labels_[s] >= 0 ? labels_[s] : -1, isCore_[s] != 0);
+        }
+    }
+
+    size_t size() const { return aliveCount_; }
+
+    size_t clusterCount() const { return clusters_.size(); }
+
+    const ClusterConfig& config() const { return config_; }
+
+private:
+    static constexpr int UNCLASSIFIED = -1;
+    static constexpr int NOISE = -2;
+    static constexpr int REMOVED = -3;
+
+    struct Cluster {
+        std::vector<size_t> members;
+        bool dirty = true;
+        ClusterResult cached;
+    };
+
+    struct ExpiryEntry {
+        int64_t timestamp;
+        size_t slot;
+        uint32_t gen;
+        bool operator>(const ExpiryEntry& o) const { return timestamp > o.timestamp; }
+    };
+    using ExpiryHeap = std::priority_queue<ExpiryEntry, std::vector<ExpiryEntry>, std::greater<ExpiryEntry>>;
+
+    ClusterConfig config_;
+    DBSCAN builder_;
+    SpatialGrid grid_;
+
+    // 按槽位存储，删除的槽位进入 freeSlots_ 复用，网格中的 id 即槽位号
+    std::vector<GeoPoint> points_;
+    GeoPointSoA soa_;   // 与 points_ 同槽位，邻居查询用单位球坐标
+    std::vector<int> labels_;
+    std::vector<uint32_t> nbrCount_;
+    std::vector<uint8_t> isCore_;
+    std::vector<uint8_t> alive_;
+    std::vector<uint32_t> gen_;
+    std::vector<size_t> freeSlots_;
+    size_t aliveCount_ = 0;
+
+    ExpiryHeap expiry_;
+    std::unordered_map<int, Cluster> clusters_;
+    int nextClusterId_ = 0;
+
+    // 当前 insert 批次内的新槽位标记
+    std::vector<uint8_t> pendingNew_;
+
+    // 复用缓冲区
+    std::vector<size_t> neighborBuf_;
+    std::vector<size_t> coreNbrBuf_;
+    std::vector<size_t> queue_;
+    std::vector<uint32_t> queuedEpoch_;
+    std::vector<uint32_t> touchMark_;
+    uint32_t epoch_ = 0;
+
+    uint32_t minSamples() const {
+        return static_cast<uint32_t>(std::max(config_.minSamples, 0));
+    }
+
+    size_t allocSlot(const GeoPoint& p) {
+        size_t slot;
+        if (!freeSlots_.empty()) {
+            slot = freeSlots_.back();
+            freeSlots_.pop_back();
+            points_[slot] = p;
+            soa_.set(slot, p.latitude, p.longitude, p.timestamp);
+            gen_[slot]++;
+        } else {
+            slot = points_.size();
+            points_.push_back(p);
+            soa_.push_back(p.latitude, p.longitude, p.timestamp);
+            labels_.push_back(UNCLASSIFIED);
+            nbrCount_.push_back(0);
+            isCore_.push_back(0);
+            alive_.push_back(0);
+            gen_.push_back(0);
+        }
+        labels_[slot] = UNCLASSIFIED;
+        nbrCount_[slot] = 0;
+        isCore_[slot] = 0;
+        alive_[slot] = 1;
+        aliveCount_++;
+
+        if (pendingNew_.size() < points_.size()) pendingNew_.resize(points_.size(), 0);
+        pendingNew_[slot] = 1;
+        return slot;
+    }
+
+    void freeSlot(size_t slot) {
+        alive_[slot] = 0;
+        isCore_[slot] = 0;
+        nbrCount_[slot] = 0;
+        labels_[slot] = REMOVED;
+        freeSlots_.push_back(slot);
+        aliveCount_--;
+    }
+
+    int newClusterId() {
+        int id = nextClusterId_++;
+        clusters_[id];
+        return id;
+    }
+
+    void addMember(int cid, size_t slot) {
+        auto& cl = clusters_[cid];
+        cl.members.push_back(slot);
+        cl.dirty = true;
+        labels_[slot] = cid;
+    }
+
+    /**
+     * 把簇 from 并入簇 into
+     */
+    void mergeInto(int into, int from) {
+        auto it = clusters_.find(from);
+        if (it == clusters_.end() || into == from) return;
+        auto& dst = clusters_[into];
+        for (size_t m : it->second.members) {
+            if (labels_[m] == from) {
+                labels_[m] = into;
+                dst.members.push_back(m);
+            }
+        }
+        dst.dirty = true;
+        clusters_.erase(it);
+    }
+
+    /**
+     * 新核心点 c：合并所有核心邻居所在的簇（保留成员最多的编号），
+     * 然后把未归属 / 噪声邻居吸收为边界点
+     */
+    void absorbCore(size_t c) {
+        coreNbrBuf_.clear();
+        queryNeighborsAt(grid_, soa_, c, config_.epsilonMeters, coreNbrBuf_);
+
+        int target = -1;
+        size_t targetSize = 0;
+        if (labels_[c] >= 0) {
+            target = labels_[c];
+            targetSize = clusters_[target].members.size();
+        }
+        for (size_t q : coreNbrBuf_) {
+            if (!isCore_[q] || labels_[q] < 0) continue;
+            size_t sz = clusters_[labels_[q]].members.size();
+            if (target < 0 || sz > targetSize) {
+                target = labels_[q];
+                targetSize = sz;
+            }
+        }
+
+        if (target < 0) {
+            target = newClusterId();
+        }
+
+        // c 原本是别的簇的边界点时，该簇经由 c 与 target 密度相连，同样合并
+        if (labels_[c] >= 0 && labels_[c] != target) {
+            mergeInto(target, labels_[c]);
+        }
+        for (size_t q : coreNbrBuf_) {
+            if (isCore_[q] && labels_[q] >= 0 && labels_[q] != target) {
+                mergeInto(target, labels_[q]);
+            }
+        }
+
+        if (labels_[c] != target) {
+            addMember(target, c);
+        }
+        for (size_t q : coreNbrBuf_) {
+            if (labels_[q] == UNCLASSIFIED || labels_[q] == NOISE) {
+                addMember(target, q);
+            }
+        }
+    }
+
+    uint32_t nextEpoch() {
+        if (++epoch_ == 0) {
+            std::fill(queuedEpoch_.begin(), queuedEpoch_.end(), 0);
+            std::fill(touchMark_.begin(), touchMark_.end(), 0);
+            epoch_ = 1;
+        }
+        return epoch_;
+    }
+
+    /**
+     * 判断簇 cid 中的种子核心点是否仍然两两经核心点可达
+     *
+     * 先做廉价的贪心覆盖：从 seeds[0] 的核心邻域出发，未覆盖的种子只要邻域里有一个
+     * 已覆盖的核心点即与之直接相连，并把自己的核心邻域并入覆盖集。密集簇里通常
+     * 几次查询即可确认；贪心无法确认时才退回沿核心点的完整 BFS。
+     */
+    bool coresConnected(int cid, const std::vector<size_t>& seeds) {
+        if (seeds.size() <= 1) return true;
+
+        if (queuedEpoch_.size() < points_.size()) queuedEpoch_.resize(points_.size(), 0);
+        uint32_t ep = nextEpoch();
+
+        auto isClusterCore = [&](size_t n) { return isCore_[n] && labels_[n] == cid; };
+        auto cover = [&](size_t from) {
+            queuedEpoch_[from] = ep;
+            for (size_t n : coreNbrBuf_) {
+                if (isClusterCore(n)) queuedEpoch_[n] = ep;
+            }
+        };
+
+        coreNbrBuf_.clear();
+        queryNeighborsAt(grid_, soa_, seeds[0], config_.epsilonMeters, coreNbrBuf_);
+        cover(seeds[0]);
+
+        std::vector<size_t> pending(seeds.begin() + 1, seeds.end());
+        bool progress = true;
+        while (!pending.empty() && progress) {
+            progress = false;
+            size_t kept = 0;
+            for (size_t s : pending) {
+                if (queuedEpoch_[s] == ep) {
+                    progress = true;
+                    continue;
+                }
+                coreNbrBuf_.clear();
+                queryNeighborsAt(grid_, soa_, s, config_.epsilonMeters, coreNbrBuf_);
+                bool linked = false;
+                for (size_t n : coreNbrBuf_) {
+                    if (isClusterCore(n) && queuedEpoch_[n] == ep) {
+                        linked = true;
+                        break;
+                    }
+                }
+                if (linked) {
+                    cover(s);
+                    progress = true;
+                } else {
+                    pending[kept++] = s;
+                }
+            }
+            pending.resize(kept);
+        }
+        if (pending.empty()) return true;
+
+        // 贪心未能确认：从 seeds[0] 沿核心点完整 BFS，全部种子可达即提前返回
+        ep = nextEpoch();
+        if (touchMark_.size() < points_.size()) touchMark_.resize(points_.size(), 0);
+        for (size_t s : seeds) touchMark_[s] = ep;
+        size_t remaining = seeds.size() - 1;
+
+        queue_.clear();
+        queue_.push_back(seeds[0]);
+        queuedEpoch_[seeds[0]] = ep;
+        size_t head = 0;
+        while (head < queue_.size()) {
+            size_t cur = queue_[head++];
+            coreNbrBuf_.clear();
+            queryNeighborsAt(grid_, soa_, cur, config_.epsilonMeters, coreNbrBuf_);
+            for (size_t n : coreNbrBuf_) {
+                if (!isClusterCore(n) || queuedEpoch_[n] == ep) continue;
+                queuedEpoch_[n] = ep;
+                if (touchMark_[n] == ep && --remaining == 0) return true;
+                queue_.push_back(n);
+            }
+        }
+        return false;
+    }
+
+    /**
+     * 对受影响的簇清空标签后重新扩展，按成员重叠度继承旧编号
+     */
+    void reexpand(const std::vector<int>& affected) {
+        if (affected.empty()) return;
+
+        // 1. 收集待重扩展的点，记录旧簇编号
+        std::vector<size_t> region;
+        std::unordered_map<size_t, int> oldLabel;
+        for (int cid : affected) {
+            auto it = clusters_.find(cid);
+            if (it == clusters_.end()) continue;
+            for (size_t m : it->second.members) {
+                if (!alive_[m] || labels_[m] != cid) continue;
+                region.push_back(m);
+                oldLabel[m] = cid;
+                labels_[m] = UNCLASSIFIED;
+            }
+            clusters_.erase(it);
+        }
+        std::sort(region.begin(), region.end());
+
+        if (queuedEpoch_.size() < points_.size()) queuedEpoch_.resize(points_.size(), 0);
+
+        // 2. 与 DBSCAN::cluster() 相同的扩展过程，只从区域内的核心点出发
+        std::vector<std::vector<size_t>> pieces;
+        for (size_t i : region) {
+            if (labels_[i] != UNCLASSIFIED) continue;
+            if (!isCore_[i]) {
+                labels_[i] = NOISE;
+                continue;
+            }
+
+            int tmp = -(static_cast<int>(pieces.size()) + 10);   // 临时编号，避免与正式编号冲突
+            pieces.emplace_back();
+            auto& piece = pieces.back();
+            expandTemp(i, tmp, piece);
+        }
+
+        // 3. 继承编号：按重叠度从大到小贪心匹配，每个旧编号最多用一次
+        struct Match { size_t overlap; size_t piece; int oldId; };
+        std::vector<Match> matches;
+        for (size_t pi = 0; pi < pieces.size(); pi++) {
+            std::unordered_map<int, size_t> overlap;
+            for (size_t m : pieces[pi]) {
+                auto it = oldLabel.find(m);
+                if (it != oldLabel.end()) overlap[it->second]++;
+            }
+            for (const auto& kv : overlap) {
+                matches.push_back({kv.second, pi, kv.first});
+            }
+        }
+        std::sort(matches.begin(), matches.end(), [](const Match& a, const Match& b) {
+            if (a.overlap != b.overlap) return a.overlap > b.overlap;
+            return a.oldId < b.oldId;
+        });
+
+        std::vector<int> assigned(pieces.size(), -1);
+        std::unordered_map<int, bool> used;
+        for (const auto& m : matches) {
+            if (assigned[m.piece] >= 0 || used[m.oldId]) continue;
+            assigned[m.piece] = m.oldId;
+            used[m.oldId] = true;
+        }
+
+        for (size_t pi = 0; pi < pieces.size(); pi++) {
+            int cid = assigned[pi];
+            if (cid < 0) {
+                cid = nextClusterId_++;
+            }
+            auto& cl = clusters_[cid];
+            cl.dirty = true;
+            cl.members = std::move(pieces[pi]);
+            for (size_t m : cl.members) labels_[m] = cid;
+        }
+
+        // 4. 区域内没被任何碎片吸收的非核心点：可能仍与区域外其他簇的核心点相邻，成为该簇的边界点
+        for (size_t i : region) {
+            if (labels_[i] != NOISE) continue;
+            neighborBuf_.clear();
+            queryNeighborsAt(grid_, soa_, i, config_.epsilonMeters, neighborBuf_);
+            for (size_t n : neighborBuf_) {
+                if (isCore_[n] && labels_[n] >= 0) {
+                    addMember(labels_[n], i);
+                    break;
+                }
+            }
+        }
+    }
+
+    /**
+     * 从核心点 seed 扩展一个临时簇，成员写入 piece
+     */
+    void expandTemp(size_t seed, int tmpLabel, std::vector<size_t>& piece) {
+        uint32_t ep = nextEpoch();
+
+        labels_[seed] = tmpLabel;
+        piece.push_back(seed);
+
+        queue_.clear();
+        neighborBuf_.clear();
+        queryNeighborsAt(grid_, soa_, seed, config_.epsilonMeters, neighborBuf_);
+        for (size_t n : neighborBuf_) {
+            queuedEpoch_[n] = ep;
+            queue_.push_back(n);
+        }
+        queuedEpoch_[seed] = ep;
+
+        size_t queueIdx = 0;
+        while (queueIdx < queue_.size()) {
+            size_t current = queue_[queueIdx++];
+
+            if (labels_[current] == NOISE) {
+                labels_[current] = tmpLabel;   // 原噪声点成为边界点
+                piece.push_back(current);
+                continue;
+            }
+            if (labels_[current] != UNCLASSIFIED) continue;   // 已属于其他簇
+
+            labels_[current] = tmpLabel;
+            piece.push_back(current);
+            if (!isCore_[current]) continue;
+
+            neighborBuf_.clear();
+            queryNeighborsAt(grid_, soa_, current, config_.epsilonMeters, neighborBuf_);
+            for (size_t n : neighborBuf_) {
+                if ((labels_[n] == UNCLASSIFIED || labels_[n] == NOISE) && queuedEpoch_[n] != ep) {
+                    queuedEpoch_[n] = ep;
+                    queue_.push_back(n);
+                }
+            }
+        }
+    }
+};
+
+}  // namespace dbscan
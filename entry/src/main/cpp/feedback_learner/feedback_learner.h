@@ -7,10 +7,18 @@
  * - 用户调整值（如希望的提醒时间）
  *
  * 用于优化规则参数
+ *
+ * 偏好（每条规则的计数与调整值）随每条反馈 O(1) 更新；原始反馈不再无限追加，
+ * 只保留在定长列式日志里（common/ring_log.h）：时间、规则（字典编号）、类型、小时与调整值，
+ * 可随偏好快照一起持久化。
  */
 #pragma once
 
+#include "common/binary_snapshot.h"
+#include "common/ring_log.h"
+#include <chrono>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include <map>
 #include <cstdint>
@@ -103,13 +111,23 @@ struct RulePreference {
 
 class FeedbackLearner {
 public:
-    FeedbackLearner() {}
+    static constexpr size_t DEFAULT_LOG_CAPACITY = 2048;
+
+    explicit FeedbackLearner(size_t logCapacity = DEFAULT_LOG_CAPACITY) : log_(logCapacity) {
+        native_common::resizeColumn(logTime_, log_);
+        native_common::resizeColumn(logRule_, log_);
+        native_common::resizeColumn(logType_, log_);
+        native_common::resizeColumn(logHour_, log_);
+        native_common::resizeColumn(logAdjustKey_, log_);
+        native_common::resizeColumn(logOriginal_, log_);
+        native_common::resizeColumn(logAdjusted_, log_);
+    }
     
     /**
      * 记录用户反馈
      */
     void recordFeedback(const FeedbackRecord& record) {
-        records_.push_back(record);
+        appendLog(record);
         updatePreference(record);
     }
     
@@ -177,6 +195,60 @@ public:
     void clearPreference(const std::string& ruleId) {
         preferences_.erase(ruleId);
     }
+
+    /** 日志中的一条反馈（上下文只保留小时） */
+    struct LoggedFeedback {
+        std::string ruleId;
+        FeedbackType type;
+        int64_t timestamp;
+        int hour;                    // -1 = 未知
+        std::string adjustKey;       // 空 = 无调整
+        double originalValue;
+        double adjustedValue;
+    };
+
+    /**
+     * 最近的反馈，从新到旧，最多 limit 条（0 = 日志中全部）
+     * @param ruleId 非空时只返回该规则的反馈
+     */
+    std::vector<LoggedFeedback> recentFeedback(size_t limit = 0, const std::string& ruleId = "") const {
+        std::vector<LoggedFeedback> out;
+        uint32_t rule = 0;
+        if (!ruleId.empty()) {
+            auto it = ruleIndex_.find(ruleId);
+            if (it == ruleIndex_.end()) return out;
+            rule = it->second;
+        }
+        for (size_t i = log_.size(); i > 0; i--) {
+            size_t at = log_.slot(i - 1);
+            if (!ruleId.empty() && logRule_[at] != rule) continue;
+            LoggedFeedback f;
+            f.ruleId = ruleNames_[logRule_[at]];
+            f.type = static_cast<FeedbackType>(logType_[at]);
+            f.timestamp = logTime_[at];
+            f.hour = logHour_[at];
+            f.adjustKey = adjustKeyName(logAdjustKey_[at]);
+            f.originalValue = logOriginal_[at];
+            f.adjustedValue = logAdjusted_[at];
+            out.push_back(std::move(f));
+            if (limit > 0 && out.size() >= limit) break;
+        }
+        return out;
+    }
+
+    /** 日志中保留的反馈数 */
+    size_t loggedFeedback() const { return log_.size(); }
+
+    /** 累计记录的反馈数（含已从日志淘汰的） */
+    uint64_t totalFeedback() const { return log_.total(); }
+
+    /** 清空偏好与反馈日志 */
+    void clear() {
+        preferences_.clear();
+        log_.clear();
+        ruleNames_.clear();
+        ruleIndex_.clear();
+    }
     
     /**
      * 导出偏好为JSON
@@ -200,9 +272,200 @@ public:
         return result;
     }
 
+    /** 快照段标签与布局版本：FBPR = 偏好，FBLG = 反馈日志 */
+    static constexpr uint32_t SNAPSHOT_TAG = native_common::snapshotTag("FBPR");
+    static constexpr uint32_t LOG_SNAPSHOT_TAG = native_common::snapshotTag("FBLG");
+    static constexpr uint32_t SNAPSHOT_VERSION = 1;
+
+    /**
+     * 偏好写入快照段（common/binary_snapshot.h），可与其他模块的段放进同一文件
+     * 每条: ruleId, preferredHour, preferredMinute, hourAdjustment, confidence,
+     *       usefulCount, inaccurateCount, dismissCount, adjustCount, lastFeedbackTime
+     */
+    void appendSnapshot(native_common::SnapshotWriter& writer) const {
+        native_common::ByteWriter& w = writer.addSection(SNAPSHOT_TAG, SNAPSHOT_VERSION);
+        w.put(static_cast<uint32_t>(preferences_.size()));
+        for (const auto& [id, pref] : preferences_) {
+            w.putString(id);
+            w.put(pref.preferredHour);
+            w.put(pref.preferredMinute);
+            w.put(pref.hourAdjustment);
+            w.put(pref.confidence);
+            w.put(static_cast<int32_t>(pref.usefulCount));
+            w.put(static_cast<int32_t>(pref.inaccurateCount));
+            w.put(static_cast<int32_t>(pref.dismissCount));
+            w.put(static_cast<int32_t>(pref.adjustCount));
+            w.put(pref.lastFeedbackTime);
+        }
+    }
+
+    /**
+     * 反馈日志写入快照段：规则字典 + 各列（从旧到新）
+     */
+    void appendLogSnapshot(native_common::SnapshotWriter& writer) const {
+        native_common::ByteWriter& w = writer.addSection(LOG_SNAPSHOT_TAG, SNAPSHOT_VERSION);
+        w.put(static_cast<uint32_t>(ruleNames_.size()));
+        for (const auto& name : ruleNames_) w.putString(name);
+        w.put(static_cast<uint32_t>(log_.size()));
+        native_common::putColumn(w, log_, logTime_);
+        native_common::putColumn(w, log_, logRule_);
+        native_common::putColumn(w, log_, logType_);
+        native_common::putColumn(w, log_, logHour_);
+        native_common::putColumn(w, log_, logAdjustKey_);
+        native_common::putColumn(w, log_, logOriginal_);
+        native_common::putColumn(w, log_, logAdjusted_);
+    }
+
+    /**
+     * 从快照恢复反馈日志（替换现有）
+     * @return 段缺失、版本不符、内容截断或规则编号越界时返回 false，现有日志不变
+     */
+    bool loadLogSnapshot(const native_common::MappedSnapshot& snapshot) {
+        const native_common::SnapshotSection* section = snapshot.find(LOG_SNAPSHOT_TAG);
+        if (section == nullptr || section->version != SNAPSHOT_VERSION) return false;
+        native_common::ByteReader r = snapshot.reader(*section);
+        FeedbackLearner loaded(log_.capacity());
+        uint32_t ruleCount = r.get<uint32_t>();
+        for (uint32_t i = 0; i < ruleCount && r.ok(); i++) loaded.internRule(r.getString());
+        size_t count = r.get<uint32_t>();
+        std::vector<int64_t> time;
+        std::vector<uint32_t> rule;
+        std::vector<uint8_t> type, adjustKey;
+        std::vector<int8_t> hour;
+        std::vector<float> original, adjusted;
+        if (!native_common::getColumn(r, count, time) || !native_common::getColumn(r, count, rule) ||
+            !native_common::getColumn(r, count, type) || !native_common::getColumn(r, count, hour) ||
+            !native_common::getColumn(r, count, adjustKey) || !native_common::getColumn(r, count, original) ||
+            !native_common::getColumn(r, count, adjusted) || !r.atEnd()) {
+            return false;
+        }
+        if (loaded.ruleNames_.size() != ruleCount) return false;
+        for (size_t i = 0; i < count; i++) {
+            if (rule[i] >= ruleCount) return false;
+            size_t at = loaded.log_.push();
+            loaded.logTime_[at] = time[i];
+            loaded.logRule_[at] = rule[i];
+            loaded.logType_[at] = type[i];
+            loaded.logHour_[at] = hour[i];
+            loaded.logAdjustKey_[at] = adjustKey[i];
+            loaded.logOriginal_[at] = original[i];
+            loaded.logAdjusted_[at] = adjusted[i];
+        }
+        log_ = loaded.log_;
+        logTime_ = std::move(loaded.logTime_);
+        logRule_ = std::move(loaded.logRule_);
+        logType_ = std::move(loaded.logType_);
+        logHour_ = std::move(loaded.logHour_);
+        logAdjustKey_ = std::move(loaded.logAdjustKey_);
+        logOriginal_ = std::move(loaded.logOriginal_);
+        logAdjusted_ = std::move(loaded.logAdjusted_);
+        ruleNames_ = std::move(loaded.ruleNames_);
+        ruleIndex_ = std::move(loaded.ruleIndex_);
+        return true;
+    }
+
+    /**
+     * 从快照恢复偏好（替换现有）
+     * @return 段缺失、版本不符或内容截断时返回 false，现有偏好不变
+     */
+    bool loadSnapshot(const native_common::MappedSnapshot& snapshot) {
+        const native_common::SnapshotSection* section = snapshot.find(SNAPSHOT_TAG);
+        if (section == nullptr || section->version != SNAPSHOT_VERSION) return false;
+        native_common::ByteReader r = snapshot.reader(*section);
+        std::map<std::string, RulePreference> loaded;
+        uint32_t count = r.get<uint32_t>();
+        for (uint32_t i = 0; i < count && r.ok(); i++) {
+            RulePreference pref;
+            pref.ruleId = r.getString();
+            pref.preferredHour = r.get<double>();
+            pref.preferredMinute = r.get<double>();
+            pref.hourAdjustment = r.get<double>();
+            pref.confidence = r.get<double>();
+            pref.usefulCount = r.get<int32_t>();
+            pref.inaccurateCount = r.get<int32_t>();
+            pref.dismissCount = r.get<int32_t>();
+            pref.adjustCount = r.get<int32_t>();
+            pref.lastFeedbackTime = r.get<int64_t>();
+            loaded[pref.ruleId] = pref;
+        }
+        if (!r.ok() || !r.atEnd()) return false;
+        preferences_ = std::move(loaded);
+        return true;
+    }
+
+    /**
+     * 偏好单独写成一个快照文件
+     * @param includeLog 同时写出反馈日志
+     */
+    bool savePreferences(const std::string& path, bool includeLog = false) const {
+        native_common::SnapshotWriter writer;
+        appendSnapshot(writer);
+        if (includeLog) appendLogSnapshot(writer);
+        return writer.writeFile(path);
+    }
+
+    /** 读取 savePreferences 写出的文件；文件里有反馈日志段时一并恢复 */
+    bool loadPreferences(const std::string& path) {
+        native_common::MappedSnapshot snapshot;
+        if (!snapshot.open(path) || !loadSnapshot(snapshot)) return false;
+        if (snapshot.find(LOG_SNAPSHOT_TAG) != nullptr) return loadLogSnapshot(snapshot);
+        return true;
+    }
+
 private:
-    std::vector<FeedbackRecord> records_;
+    enum AdjustKeyCode : uint8_t { ADJUST_NONE = 0, ADJUST_HOUR = 1, ADJUST_MINUTE = 2, ADJUST_OTHER = 3 };
+
     std::map<std::string, RulePreference> preferences_;
+
+    // 反馈日志（列式），规则 id 存字典编号
+    native_common::RingIndex log_;
+    std::vector<int64_t> logTime_;
+    std::vector<uint32_t> logRule_;
+    std::vector<uint8_t> logType_;
+    std::vector<int8_t> logHour_;
+    std::vector<uint8_t> logAdjustKey_;
+    std::vector<float> logOriginal_;
+    std::vector<float> logAdjusted_;
+    std::vector<std::string> ruleNames_;
+    std::unordered_map<std::string, uint32_t> ruleIndex_;
+    uint64_t nextId_ = 0;
+
+    uint32_t internRule(const std::string& ruleId) {
+        auto it = ruleIndex_.find(ruleId);
+        if (it != ruleIndex_.end()) return it->second;
+        uint32_t id = static_cast<uint32_t>(ruleNames_.size());
+        ruleNames_.push_back(ruleId);
+        ruleIndex_.emplace(ruleId, id);
+        return id;
+    }
+
+    static uint8_t adjustKeyCode(const std::string& key) {
+        if (key.empty()) return ADJUST_NONE;
+        if (key == "hour") return ADJUST_HOUR;
+        if (key == "minute") return ADJUST_MINUTE;
+        return ADJUST_OTHER;
+    }
+
+    static const char* adjustKeyName(uint8_t code) {
+        switch (code) {
+            case ADJUST_HOUR: return "hour";
+            case ADJUST_MINUTE: return "minute";
+            case ADJUST_OTHER: return "other";
+            default: return "";
+        }
+    }
+
+    void appendLog(const FeedbackRecord& record) {
+        bool adjust = record.type == FeedbackType::ADJUST;
+        size_t at = log_.push();
+        logTime_[at] = record.timestamp;
+        logRule_[at] = internRule(record.context.ruleId);
+        logType_[at] = static_cast<uint8_t>(record.type);
+        logHour_[at] = static_cast<int8_t>(record.context.hour >= 0 && record.context.hour < 24 ? record.context.hour : -1);
+        logAdjustKey_[at] = adjust ? adjustKeyCode(record.adjustment.key) : static_cast<uint8_t>(ADJUST_NONE);
+        logOriginal_[at] = adjust ? static_cast<float>(record.adjustment.originalValue) : 0.0f;
+        logAdjusted_[at] = adjust ? static_cast<float>(record.adjustment.adjustedValue) : 0.0f;
+    }
     
     void updatePreference(const FeedbackRecord& record) {
         const std::string& ruleId = record.context.ruleId;
@@ -240,12 +503,13 @@ private:
         }
     }
     
-    std::string generateId() const {
-        return "fb_" + std::to_string(currentTimeMs());
+    std::string generateId() {
+        return "fb_" + std::to_string(currentTimeMs()) + "_" + std::to_string(nextId_++);
     }
     
     int64_t currentTimeMs() const {
-        return 0;  // 实际实现需要平台特定代码
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
     }
 };
 
@@ -0,0 +1,345 @@
+/**
+ * feedback_learner_napi.cpp — 用户反馈学习 NAPI 绑定
+ */
+#include <napi/native_api.h>
+#include "feedback_learner.h"
+#include "common/metrics_napi.h"
+#include <string>
+#include <vector>
+
+using namespace feedback_learner;
+
+// 模块级常驻学习器，只在 JS 线程访问
+static FeedbackLearner g_learner;
+
+// ============================================================
+// Helper functions
+// ============================================================
+
+static double GetDoubleProp(napi_env env, napi_value obj, const char* key, double defaultVal = 0.0) {
+    napi_value prop;
+    napi_status status = napi_get_named_property(env, obj, key, &prop);
+    if (status != napi_ok) return defaultVal;
+
+    double val;
+    status = napi_get_value_double(env, prop, &val);
+    return (status == napi_ok) ? val : defaultVal;
+}
+
+static std::string GetStringValue(napi_env env, napi_value val) {
+    size_t len = 0;
+    if (napi_get_value_string_utf8(env, val, nullptr, 0, &len) != napi_ok) return "";
+    std::string result(len, '\0');
+    napi_get_value_string_utf8(env, val, &result[0], len + 1, &len);
+    return result;
+}
+
+static std::string GetStringProp(napi_env env, napi_value obj, const char* key, const std::string& defaultVal = "") {
+    napi_value prop;
+    if (napi_get_named_property(env, obj, key, &prop) != napi_ok) return defaultVal;
+    napi_valuetype type = napi_undefined;
+    napi_typeof(env, prop, &type);
+    return type == napi_string ? GetStringValue(env, prop) : defaultVal;
+}
+
+static bool IsType(napi_env env, napi_value val, napi_valuetype expected) {
+    napi_valuetype type = napi_undefined;
+    napi_typeof(env, val, &type);
+    return type == expected;
+}
+
+static napi_value CreateString(napi_env env, const std::string& str) {
+    napi_value result;
+    napi_create_string_utf8(env, str.c_str(), str.length(), &result);
+    return result;
+}
+
+static napi_value CreateDouble(napi_env env, double val) {
+    napi_value result;
+    napi_create_double(env, val, &result);
+    return result;
+}
+
+static napi_value CreateBool(napi_env env, bool val) {
+    napi_value result;
+    napi_get_boolean(env, val, &result);
+    return result;
+}
+
+static bool ParseFeedbackType(const std::string& name, FeedbackType& out) {
+    if (name == "useful") out = FeedbackType::USEFUL;
+    else if (name == "inaccurate") out = FeedbackType::INACCURATE;
+    else if (name == "dismiss") out = FeedbackType::DISMISS;
+    else if (name == "adjust") out = FeedbackType::ADJUST;
+    else return false;
+    return true;
+}
+
+static const char* FeedbackTypeName(FeedbackType type) {
+    switch (type) {
+        case FeedbackType::USEFUL: return "useful";
+        case FeedbackType::INACCURATE: return "inaccurate";
+        case FeedbackType::DISMISS: return "dismiss";
+        default: return "adjust";
+    }
+}
+
+static napi_value PreferenceToJs(napi_env env, const RulePreference& pref) {
+    napi_value obj;
+    napi_create_object(env, &obj);
+    napi_set_named_property(env, obj, "ruleId", CreateString(env, pref.ruleId));
+    napi_set_named_property(env, obj, "preferredHour", CreateDouble(env, pref.preferredHour));
+    napi_set_named_property(env, obj, "preferredMinute", CreateDouble(env, pref.preferredMinute));
+    napi_set_named_property(env, obj, "hourAdjustment", CreateDouble(env, pref.hourAdjustment));
+    napi_set_named_property(env, obj, "confidence", CreateDouble(env, pref.confidence));
+    napi_set_named_property(env, obj, "usefulCount", CreateDouble(env, pref.usefulCount));
+    napi_set_named_property(env, obj, "inaccurateCount", CreateDouble(env, pref.inaccurateCount));
+    napi_set_named_property(env, obj, "dismissCount", CreateDouble(env, pref.dismissCount));
+    napi_set_named_property(env, obj, "adjustCount", CreateDouble(env, pref.adjustCount));
+    napi_set_named_property(env, obj, "lastFeedbackTime", CreateDouble(env, static_cast<double>(pref.lastFeedbackTime)));
+    return obj;
+}
+
+// ============================================================
+// NAPI bindings
+// ============================================================
+
+/**
+ * feedbackLearner.recordFeedback(params) → void
+ *
+ * params: { ruleId, type: 'useful' | 'inaccurate' | 'dismiss' | 'adjust', timestamp?, hour?,
+ *           adjustment?: { key, originalValue, adjustedValue } }
+ * timestamp 缺省取当前时间；type 为 adjust 时必须带 adjustment
+ */
+static napi_value RecordFeedback(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+
+    if (argc < 1 || !IsType(env, args[0], napi_object)) {
+        napi_throw_error(env, nullptr, "Expected 1 argument: params");
+        return nullptr;
+    }
+
+    FeedbackRecord record{};
+    record.context.ruleId = GetStringProp(env, args[0], "ruleId");
+    if (record.context.ruleId.empty()) {
+        napi_throw_error(env, nullptr, "ruleId is required");
+        return nullptr;
+    }
+    if (!ParseFeedbackType(GetStringProp(env, args[0], "type"), record.type)) {
+        napi_throw_error(env, nullptr, "type must be one of useful / inaccurate / dismiss / adjust");
+        return nullptr;
+    }
+    record.context.hour = static_cast<int>(GetDoubleProp(env, args[0], "hour", -1));
+
+    bool hasTimestamp = false;
+    napi_has_named_property(env, args[0], "timestamp", &hasTimestamp);
+    if (hasTimestamp) record.timestamp = static_cast<int64_t>(GetDoubleProp(env, args[0], "timestamp", 0));
+
+    if (record.type == FeedbackType::ADJUST) {
+        napi_value adj;
+        if (napi_get_named_property(env, args[0], "adjustment", &adj) != napi_ok || !IsType(env, adj, napi_object)) {
+            napi_throw_error(env, nullptr, "adjust feedback requires adjustment: { key, originalValue, adjustedValue }");
+            return nullptr;
+        }
+        record.adjustment.key = GetStringProp(env, adj, "key");
+        record.adjustment.originalValue = GetDoubleProp(env, adj, "originalValue", 0);
+        record.adjustment.adjustedValue = GetDoubleProp(env, adj, "adjustedValue", 0);
+        record.adjustment.unit = GetStringProp(env, adj, "unit");
+    }
+
+    if (hasTimestamp) {
+        record.id = "fb_" + std::to_string(record.timestamp);
+        g_learner.recordFeedback(record);
+    } else if (record.type == FeedbackType::ADJUST) {
+        g_learner.recordAdjustment(record.context.ruleId, record.context, record.adjustment);
+    } else {
+        g_learner.recordSimpleFeedback(record.context.ruleId, record.type, record.context);
+    }
+    return nullptr;
+}
+
+/**
+ * feedbackLearner.getPreference(ruleId) → RulePreference | null
+ */
+static napi_value GetPreference(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+
+    if (argc < 1) {
+        napi_throw_error(env, nullptr, "Expected 1 argument: ruleId");
+        return nullptr;
+    }
+
+    const RulePreference* pref = g_learner.getPreference(GetStringValue(env, args[0]));
+    if (pref == nullptr) {
+        napi_value nullValue;
+        napi_get_null(env, &nullValue);
+        return nullValue;
+    }
+    return PreferenceToJs(env, *pref);
+}
+
+/**
+ * feedbackLearner.getAdjustedHour(ruleId, originalHour) → number
+ */
+static napi_value GetAdjustedHour(napi_env env, napi_callback_info info) {
+    size_t argc = 2;
+    napi_value args[2];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+
+    if (argc < 2) {
+        napi_throw_error(env, nullptr, "Expected 2 arguments: ruleId, originalHour");
+        return nullptr;
+    }
+
+    double hour = 0;
+    napi_get_value_double(env, args[1], &hour);
+    return CreateDouble(env, g_learner.getAdjustedHour(GetStringValue(env, args[0]), hour));
+}
+
+/**
+ * feedbackLearner.exportPreferences() → string  JSON
+ */
+static napi_value ExportPreferences(napi_env env, napi_callback_info info) {
+    return CreateString(env, g_learner.exportPreferences());
+}
+
+/**
+ * feedbackLearner.getRecentFeedback(limit?, ruleId?) → LoggedFeedback[]  从新到旧
+ */
+static napi_value GetRecentFeedback(napi_env env, napi_callback_info info) {
+    size_t argc = 2;
+    napi_value args[2];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+
+    int32_t limit = 0;
+    if (argc >= 1) napi_get_value_int32(env, args[0], &limit);
+    std::string ruleId;
+    if (argc >= 2 && IsType(env, args[1], napi_string)) ruleId = GetStringValue(env, args[1]);
+
+    auto list = g_learner.recentFeedback(limit > 0 ? static_cast<size_t>(limit) : 0, ruleId);
+    napi_value arr;
+    napi_create_array_with_length(env, list.size(), &arr);
+    for (size_t i = 0; i < list.size(); i++) {
+        const auto& f = list[i];
+        napi_value obj;
+        napi_create_object(env, &obj);
+        napi_set_named_property(env, obj, "ruleId", CreateString(env, f.ruleId));
+        napi_set_named_property(env, obj, "type", CreateString(env, FeedbackTypeName(f.type)));
+        napi_set_named_property(env, obj, "timestamp", CreateDouble(env, static_cast<double>(f.timestamp)));
+        napi_set_named_property(env, obj, "hour", CreateDouble(env, f.hour));
+        if (!f.adjustKey.empty()) {
+            napi_value adj;
+            napi_create_object(env, &adj);
+            napi_set_named_property(env, adj, "key", CreateString(env, f.adjustKey));
+            napi_set_named_property(env, adj, "originalValue", CreateDouble(env, f.originalValue));
+            napi_set_named_property(env, adj, "adjustedValue", CreateDouble(env, f.adjustedValue));
+            napi_set_named_property(env, obj, "adjustment", adj);
+        }
+        napi_set_element(env, arr, static_cast<uint32_t>(i), obj);
+    }
+    return arr;
+}
+
+/**
+ * feedbackLearner.getStats() → { logged, total, rules }
+ */
+static napi_value GetStats(napi_env env, napi_callback_info info) {
+    napi_value obj;
+    napi_create_object(env, &obj);
+    napi_set_named_property(env, obj, "logged", CreateDouble(env, static_cast<double>(g_learner.loggedFeedback())));
+    napi_set_named_property(env, obj, "total", CreateDouble(env, static_cast<double>(g_learner.totalFeedback())));
+    napi_set_named_property(env, obj, "rules", CreateDouble(env, static_cast<double>(g_learner.getAllPreferences().size())));
+    return obj;
+}
+
+/**
+ * feedbackLearner.clear(ruleId?) → void  传 id 时只清除该规则的偏好，否则清空偏好与日志
+ */
+static napi_value Clear(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+
+    if (argc >= 1 && IsType(env, args[0], napi_string)) {
+        g_learner.clearPreference(GetStringValue(env, args[0]));
+    } else {
+        g_learner.clear();
+    }
+    return nullptr;
+}
+
+/**
+ * feedbackLearner.save(path, includeLog?) → boolean  includeLog 缺省为 false
+ */
+static napi_value Save(napi_env env, napi_callback_info info) {
+    size_t argc = 2;
+    napi_value args[2];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+
+    if (argc < 1 || !IsType(env, args[0], napi_string)) {
+        napi_throw_error(env, nullptr, "save requires a file path");
+        return nullptr;
+    }
+    bool includeLog = false;
+    if (argc >= 2 && IsType(env, args[1], napi_boolean)) napi_get_value_bool(env, args[1], &includeLog);
+    return CreateBool(env, g_learner.savePreferences(GetStringValue(env, args[0]), includeLog));
+}
+
+/**
+ * feedbackLearner.load(path) → boolean  文件缺失或损坏时返回 false，现有状态不变
+ */
+static napi_value Load(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+
+    if (argc < 1 || !IsType(env, args[0], napi_string)) {
+        napi_throw_error(env, nullptr, "load requires a file path");
+        return nullptr;
+    }
+    return CreateBool(env, g_learner.loadPreferences(GetStringValue(env, args[0])));
+}
+
+// ============================================================
+// Module registration
+// ============================================================
+
+EXTERN_C_START
+
+static napi_value Init(napi_env env, napi_value exports) {
+    napi_property_descriptor desc[] = {
+        {"recordFeedback", nullptr, RecordFeedback, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"getPreference", nullptr, GetPreference, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"getAdjustedHour", nullptr, GetAdjustedHour, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"exportPreferences", nullptr, ExportPreferences, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"getRecentFeedback", nullptr, GetRecentFeedback, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"getStats", nullptr, GetStats, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"clear", nullptr, Clear, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"save", nullptr, Save, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"load", nullptr, Load, nullptr, nullptr, nullptr, napi_default, nullptr},
+        native_common::MetricsProperty("feedback_learner"),
+    };
+
+    napi_define_properties(env, exports, sizeof(desc) / sizeof(desc[0]), desc);
+    return exports;
+}
+
+static napi_module feedback_learner_module = {
+    .nm_version = 1,
+    .nm_flags = NAPI_MODULE_VERSION,
+    .nm_filename = nullptr,
+    .nm_register_func = Init,
+    .nm_modname = "feedback_learner",
+    .nm_priv = nullptr,
+    .reserved = {0},
+};
+
+EXTERN_C_END
+
+extern "C" __attribute__((constructor)) void RegisterFeedbackLearnerModule(void) {
+    napi_module_register(&feedback_learner_module);
+}
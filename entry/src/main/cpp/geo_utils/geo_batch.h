@@ -0,0 +1,334 @@
+/**
+ * geo_batch.h — SoA 点集与批量 haversine 内核
+ *
+ * 一个查询点对 N 个点求距离时，逐对调用 haversineDistance 每次要 5 次三角函数。
+ * 这里把点集按列存放，并预先算好单位球面坐标 (x, y, z)：
+ *
+ *   chord² = |p - q|²,  h = chord / 2 = sin(θ / 2),  d = 2R · asin(h)
+ *
+ * 与 haversine 数学上等价，内核只剩乘加、一次 sqrt 和一个有理函数 asin，
+ * 可以直接向量化：arm64 用 NEON，x86（模拟器）用 AVX / SSE2，其余平台标量。
+ * 近距离时各坐标分量之差不存在 1 - cos 式的抵消，精度不低于标量版本。
+ */
+#pragma once
+
+#include "geo_utils.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define GEO_BATCH_AVX 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define GEO_BATCH_SSE2 1
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define GEO_BATCH_NEON 1
+#endif
+
+namespace geo_utils {
+
+// ============================================================
+// SoA 点集
+// ============================================================
+
+/**
+ * 列存点集：lat / lng / timestamp 各占一列，x / y / z 为预计算的单位球面坐标
+ */
+struct GeoPointSoA {
+    std::vector<double> lat;
+    std::vector<double> lng;
+    std::vector<int64_t> timestamp;
+    std::vector<double> x;
+    std::vector<double> y;
+    std::vector<double> z;
+
+    size_t size() const { return lat.size(); }
+    bool empty() const { return lat.empty(); }
+
+    void clear() {
+        lat.clear(); lng.clear(); timestamp.clear();
+        x.clear(); y.clear(); z.clear();
+    }
+
+    void reserve(size_t n) {
+        lat.reserve(n); lng.reserve(n); timestamp.reserve(n);
+        x.reserve(n); y.reserve(n); z.reserve(n);
+    }
+
+    void push_back(double latitude, double longitude, int64_t ts = 0) {
+        size_t n = size() + 1;
+        lat.resize(n); lng.resize(n); timestamp.resize(n);
+        x.resize(n); y.resize(n); z.resize(n);
+        set(n - 1, latitude, longitude, ts);
+    }
+
+    /** 覆盖第 i 个点（槽位复用） */
+    void set(size_t i, double latitude, double longitude, int64_t ts = 0) {
+        double phi = toRad(latitude);
+        double lambda = toRad(longitude);
+        double cosPhi = std::cos(phi);
+        lat[i] = latitude;
+        lng[i] = longitude;
+        timestamp[i] = ts;
+        x[i] = cosPhi * std::cos(lambda);
+        y[i] = cosPhi * std::sin(lambda);
+        z[i] = std::sin(phi);
+    }
+
+    void assign(const std::vector<GeoPoint>& points) {
+        clear();
+        reserve(points.size());
+        for (const auto& p : points) push_back(p.latitude, p.longitude, p.timestamp);
+    }
+
+    /** 围栏中心点集，下标与 geofences 一致 */
+    void assign(const std::vector<Geofence>& geofences) {
+        clear();
+        reserve(geofences.size());
+        for (const auto& gf : geofences) push_back(gf.latitude, gf.longitude);
+    }
+};
+
+// ============================================================
+// 内核
+// ============================================================
+
+namespace detail {
+
+/** 有理逼近覆盖 h ≤ ASIN_SMALL_MAX（θ ≤ 77°，约 8600 km），更远的走 std::asin */
+constexpr double ASIN_SMALL_MAX = 0.625;
+
+// asin(h) = h + h·z·P(z)/Q(z), z = h²（Cephes asin.c，相对误差 < 3e-16）
+constexpr double ASIN_P0 = 4.253011369004428248960E-3;
+constexpr double ASIN_P1 = -6.019598008014123785661E-1;
+constexpr double ASIN_P2 = 5.444622390564711410273E0;
+constexpr double ASIN_P3 = -1.626247967210700244449E1;
+constexpr double ASIN_P4 = 1.956261983317594739197E1;
+constexpr double ASIN_P5 = -8.198089802484824371615E0;
+constexpr double ASIN_Q1 = -1.474091372988853791896E1;
+constexpr double ASIN_Q2 = 7.049610280856842141659E1;
+constexpr double ASIN_Q3 = -1.471791292232726029859E2;
+constexpr double ASIN_Q4 = 1.395105614657485689735E2;
+constexpr double ASIN_Q5 = -4.918853881490881290097E1;
+
+inline double asinSmall(double h) {
+    double z = h * h;
+    double p = ((((ASIN_P0 * z + ASIN_P1) * z + ASIN_P2) * z + ASIN_P3) * z + ASIN_P4) * z + ASIN_P5;
+    double q = ((((z + ASIN_Q1) * z + ASIN_Q2) * z + ASIN_Q3) * z + ASIN_Q4) * z + ASIN_Q5;
+    return h + h * z * p / q;
+}
+
+/** 单个点：h = 半弦长，返回米 */
+inline double chordToMeters(double h) {
+    if (h > 1.0) h = 1.0;
+    double angle = h <= ASIN_SMALL_MAX ? asinSmall(h) : std::asin(h);
+    return 2.0 * EARTH_RADIUS_METERS * angle;
+}
+
+inline void haversineManyScalar(double qx, double qy, double qz,
+                                const double* x, const double* y, const double* z,
+                                size_t n, double* out) {
+    for (size_t i = 0; i < n; i++) {
+        double dx = x[i] - qx;
+        double dy = y[i] - qy;
+        double dz = z[i] - qz;
+        out[i] = chordToMeters(0.5 * std::sqrt(dx * dx + dy * dy + dz * dz));
+    }
+}
+
+#if defined(GEO_BATCH_AVX) || defined(GEO_BATCH_SSE2) || defined(GEO_BATCH_NEON)
+
+#if defined(GEO_BATCH_AVX)
+struct Simd {
+    using V = __m256d;
+    static constexpr size_t WIDTH = 4;
+    static V load(const double* p) { return _mm256_loadu_pd(p); }
+    static void store(double* p, V v) { _mm256_storeu_pd(p, v); }
+    static V set1(double v) { return _mm256_set1_pd(v); }
+    static V add(V a, V b) { return _mm256_add_pd(a, b); }
+    static V sub(V a, V b) { return _mm256_sub_pd(a, b); }
+    static V mul(V a, V b) { return _mm256_mul_pd(a, b); }
+    static V div(V a, V b) { return _mm256_div_pd(a, b); }
+    static V sqrt(V a) { return _mm256_sqrt_pd(a); }
+    static bool anyGreater(V a, V limit) {
+        return _mm256_movemask_pd(_mm256_cmp_pd(a, limit, _CMP_GT_OQ)) != 0;
+    }
+};
+#elif defined(GEO_BATCH_SSE2)
+struct Simd {
+    using V = __m128d;
+    static constexpr size_t WIDTH = 2;
+    static V load(const double* p) { return _mm_loadu_pd(p); }
+    static void store(double* p, V v) { _mm_storeu_pd(p, v); }
+    static V set1(double v) { return _mm_set1_pd(v); }
+    static V add(V a, V b) { return _mm_add_pd(a, b); }
+    static V sub(V a, V b) { return _mm_sub_pd(a, b); }
+    static V mul(V a, V b) { return _mm_mul_pd(a, b); }
+    static V div(V a, V b) { return _mm_div_pd(a, b); }
+    static V sqrt(V a) { return _mm_sqrt_pd(a); }
+    static bool anyGreater(V a, V limit) { return _mm_movemask_pd(_mm_cmpgt_pd(a, limit)) != 0; }
+};
+#else
+struct Simd {
+    using V = float64x2_t;
+    static constexpr size_t WIDTH = 2;
+    static V load(const double* p) { return vld1q_f64(p); }
+    static void store(double* p, V v) { vst1q_f64(p, v); }
+    static V set1(double v) { return vdupq_n_f64(v); }
+    static V add(V a, V b) { return vaddq_f64(a, b); }
+    static V sub(V a, V b) { return vsubq_f64(a, b); }
+    static V mul(V a, V b) { return vmulq_f64(a, b); }
+    static V div(V a, V b) { return vdivq_f64(a, b); }
+    static V sqrt(V a) { return vsqrtq_f64(a); }
+    static bool anyGreater(V a, V limit) { return vmaxvq_u64(vcgtq_f64(a, limit)) != 0; }
+};
+#endif
+
+inline void haversineManySimd(double qx, double qy, double qz,
+                              const double* x, const double* y, const double* z,
+                              size_t n, double* out) {
+    using S = Simd;
+    const S::V vqx = S::set1(qx), vqy = S::set1(qy), vqz = S::set1(qz);
+    const S::V half = S::set1(0.5);
+    const S::V limit = S::set1(ASIN_SMALL_MAX);
+    const S::V scale = S::set1(2.0 * EARTH_RADIUS_METERS);
+
+    size_t i = 0;
+    for (; i + S::WIDTH <= n; i += S::WIDTH) {
+        S::V dx = S::sub(S::load(x + i), vqx);
+        S::V dy = S::sub(S::load(y + i), vqy);
+        S::V dz = S::sub(S::load(z + i), vqz);
+        S::V c2 = S::add(S::add(S::mul(dx, dx), S::mul(dy, dy)), S::mul(dz, dz));
+        S::V h = S::mul(half, S::sqrt(c2));
+
+        if (S::anyGreater(h, limit)) {
+            // 超远距离很少见，整组退回标量
+            double hs[S::WIDTH];
+            S::store(hs, h);
+            for (size_t k = 0; k < S::WIDTH; k++) out[i + k] = chordToMeters(hs[k]);
+            continue;
+        }
+
+        S::V zz = S::mul(h, h);
+        S::V p = S::set1(ASIN_P0);
+        p = S::add(S::mul(p, zz), S::set1(ASIN_P1));
+        p = S::add(S::mul(p, zz), S::set1(ASIN_P2));
+        p = S::add(S::mul(p, zz), S::set1(ASIN_P3));
+        p = S::add(S::mul(p, zz), S::set1(ASIN_P4));
+        p = S::add(S::mul(p, zz), S::set1(ASIN_P5));
+        S::V q = S::add(zz, S::set1(ASIN_Q1));
+        q = S::add(S::mul(q, zz), S::set1(ASIN_Q2));
+        q = S::add(S::mul(q, zz), S::set1(ASIN_Q3));
+        q = S::add(S::mul(q, zz), S::set1(ASIN_Q4));
+        q = S::add(S::mul(q, zz), S::set1(ASIN_Q5));
+        S::V angle = S::add(h, S::div(S::mul(S::mul(h, zz), p), q));
+        S::store(out + i, S::mul(scale, angle));
+    }
+    haversineManyScalar(qx, qy, qz, x + i, y + i, z + i, n - i, out + i);
+}
+
+#endif
+
+inline void toUnit(double lat, double lng, double& x, double& y, double& z) {
+    double phi = toRad(lat);
+    double lambda = toRad(lng);
+    double cosPhi = std::cos(phi);
+    x = cosPhi * std::cos(lambda);
+    y = cosPhi * std::sin(lambda);
+    z = std::sin(phi);
+}
+
+}  // namespace detail
+
+/** 编译期选中的内核："avx" / "sse2" / "neon" / "scalar" */
+inline const char* geoBatchBackend() {
+#if defined(GEO_BATCH_AVX)
+    return "avx";
+#elif defined(GEO_BATCH_SSE2)
+    return "sse2";
+#elif defined(GEO_BATCH_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+/**
+ * (lat, lng) 到 pts[begin, begin + count) 的距离（米），写入 out[0, count)
+ */
+inline void haversineMany(double lat, double lng, const GeoPointSoA& pts,
+                          size_t begin, size_t count, double* out) {
+    if (count == 0) return;
+    double qx, qy, qz;
+    detail::toUnit(lat, lng, qx, qy, qz);
+#if defined(GEO_BATCH_AVX) || defined(GEO_BATCH_SSE2) || defined(GEO_BATCH_NEON)
+    detail::haversineManySimd(qx, qy, qz, pts.x.data() + begin, pts.y.data() + begin,
+                              pts.z.data() + begin, count, out);
+#else
+    detail::haversineManyScalar(qx, qy, qz, pts.x.data() + begin, pts.y.data() + begin,
+                                pts.z.data() + begin, count, out);
+#endif
+}
+
+/**
+ * (lat, lng) 到全部点的距离，out 会被 resize 为 pts.size()
+ */
+inline void haversineMany(double lat, double lng, const GeoPointSoA& pts, std::vector<double>& out) {
+    out.resize(pts.size());
+    haversineMany(lat, lng, pts, 0, pts.size(), out.data());
+}
+
+/** 强制走标量内核（精度对照用） */
+inline void haversineManyScalar(double lat, double lng, const GeoPointSoA& pts,
+                                size_t begin, size_t count, double* out) {
+    double qx, qy, qz;
+    detail::toUnit(lat, lng, qx, qy, qz);
+    detail::haversineManyScalar(qx, qy, qz, pts.x.data() + begin, pts.y.data() + begin,
+                                pts.z.data() + begin, count, out);
+}
+
+// ============================================================
+// 批量版几何工具
+// ============================================================
+
+/**
+ * 与 getGeofencesAtLocation 相同，centers 为 geofences 的中心点集（可跨查询复用）
+ */
+inline std::vector<GeofenceMatch> getGeofencesAtLocation(
+    double lat, double lon, const std::vector<Geofence>& geofences, const GeoPointSoA& centers) {
+
+    std::vector<double> dist;
+    haversineMany(lat, lon, centers, dist);
+
+    std::vector<GeofenceMatch> result;
+    result.reserve(geofences.size());
+    for (size_t i = 0; i < geofences.size(); i++) {
+        result.push_back({geofences[i].id, dist[i], dist[i] <= geofences[i].radiusMeters});
+    }
+    return result;
+}
+
+/**
+ * 与 calculatePercentileRadius 相同，输入为 SoA 点集
+ */
+inline double calculatePercentileRadius(const GeoPointSoA& pts, double centerLat, double centerLng,
+                                        double percentile = 0.95) {
+    if (pts.empty()) return 100.0;
+
+    std::vector<double> distances;
+    haversineMany(centerLat, centerLng, pts, distances);
+
+    size_t idx = static_cast<size_t>(distances.size() * percentile);
+    if (idx >= distances.size()) idx = distances.size() - 1;
+    std::nth_element(distances.begin(), distances.begin() + idx, distances.end());
+
+    double radius = distances[idx];
+    return std::max(50.0, std::min(500.0, radius));
+}
+
+}  // namespace geo_utils
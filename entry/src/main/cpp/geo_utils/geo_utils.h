@@ -8,6 +8,8 @@
 #include <string>
 #include <vector>
 #include <cmath>
+#include <algorithm>
+#include <cstdint>
 
 namespace geo_utils {
 
@@ -169,6 +171,28 @@ inline double calculatePercentileRadius(
     return std::max(50.0, std::min(500.0, radius));
 }
 
+/**
+ * 从打包的 double 数组解出点集
+ * 每个点占 stride 个 double：[lat, lng] / [lat, lng, timestamp] / [lat, lng, timestamp, accuracy]
+ * 缺省字段：timestamp = 0，accuracy = 10；stride > 4 时多余字段忽略
+ */
+inline std::vector<GeoPoint> unpackPoints(const double* data, size_t length, size_t stride) {
+    std::vector<GeoPoint> points;
+    if (stride < 2 || data == nullptr) return points;
+    
+    size_t count = length / stride;
+    points.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        const double* rec = data + i * stride;
+        GeoPoint& p = points[i];
+        p.latitude = rec[0];
+        p.longitude = rec[1];
+        p.timestamp = stride >= 3 ? static_cast<int64_t>(rec[2]) : 0;
+        p.accuracy = stride >= 4 ? rec[3] : 10.0;
+    }
+    return points;
+}
+
 /**
  * 计算两点间的时间差（毫秒）
  */
@@ -3,6 +3,12 @@
  */
 #include <napi/native_api.h>
 #include "geo_utils.h"
+#include "geo_batch.h"
+#include "geofence_index.h"
+#include "common/napi_async.h"
+#include "common/napi_typed_array.h"
+#include "common/metrics_napi.h"
+#include <memory>
 #include <vector>
 #include <string>
 
@@ -54,6 +60,58 @@ static napi_value CreateString(napi_env env, const std::string& str) {
     return result;
 }
 
+static std::string GetStringArg(napi_env env, napi_value val) {
+    size_t len = 0;
+    if (napi_get_value_string_utf8(env, val, nullptr, 0, &len) != napi_ok) return "";
+    std::string result(len, '\0');
+    napi_get_value_string_utf8(env, val, &result[0], len + 1, &len);
+    return result;
+}
+
+static Geofence ParseGeofence(napi_env env, napi_value obj) {
+    Geofence gf;
+    gf.id = GetStringProp(env, obj, "id", "");
+    gf.name = GetStringProp(env, obj, "name", "");
+    gf.latitude = GetDoubleProp(env, obj, "latitude", 0);
+    gf.longitude = GetDoubleProp(env, obj, "longitude", 0);
+    gf.radiusMeters = GetDoubleProp(env, obj, "radiusMeters", 100);
+    gf.category = GetStringProp(env, obj, "category", "");
+    return gf;
+}
+
+static std::vector<Geofence> ParseGeofences(napi_env env, napi_value arr) {
+    NATIVE_METRICS_SCOPE("geo_utils.parse_geofences");
+    std::vector<Geofence> geofences;
+    uint32_t arrayLen = 0;
+    napi_get_array_length(env, arr, &arrayLen);
+    geofences.reserve(arrayLen);
+    
+    for (uint32_t i = 0; i < arrayLen; i++) {
+        napi_value elem;
+        napi_get_element(env, arr, i, &elem);
+        geofences.push_back(ParseGeofence(env, elem));
+    }
+    return geofences;
+}
+
+static napi_value CreateMatchArray(napi_env env, const std::vector<GeofenceMatch>& matches) {
+    napi_value result;
+    napi_create_array_with_length(env, matches.size(), &result);
+    
+    for (size_t i = 0; i < matches.size(); i++) {
+        napi_value obj;
+        napi_create_object(env, &obj);
+        
+        napi_set_named_property(env, obj, "geofenceId", CreateString(env, matches[i].geofenceId));
+        napi_set_named_property(env, obj, "distance", CreateDouble(env, matches[i].distance));
+        napi_set_named_property(env, obj, "inside", CreateBool(env, matches[i].inside));
+        
+        napi_set_element(env, result, i, obj);
+    }
+    
+    return result;
+}
+
 // ============================================================
 // NAPI bindings
 // ============================================================
@@ -129,66 +187,41 @@ static napi_value GetGeofencesAtLocation(napi_env env, napi_callback_info info)
     napi_get_value_double(env, args[1], &lon);
     
     // 解析 geofences 数组
-    std::vector<Geofence> geofences;
-    uint32_t arrayLen;
-    napi_get_array_length(env, args[2], &arrayLen);
-    
-    for (uint32_t i = 0; i < arrayLen; i++) {
-        napi_value elem;
-        napi_get_element(env, args[2], i, &elem);
-        
-        Geofence gf;
-        gf.id = GetStringProp(env, elem, "id", "");
-        gf.latitude = GetDoubleProp(env, elem, "latitude", 0);
-        gf.longitude = GetDoubleProp(env, elem, "longitude", 0);
-        gf.radiusMeters = GetDoubleProp(env, elem, "radiusMeters", 100);
-        
-        geofences.push_back(gf);
-    }
+    std::vector<Geofence> geofences = ParseGeofences(env, args[2]);
     
     // 计算
-    auto matches = getGeofencesAtLocation(lat, lon, geofences);
-    
-    // 返回结果数组
-    napi_value result;
-    napi_create_array_with_length(env, matches.size(), &result);
-    
-    for (size_t i = 0; i < matches.size(); i++) {
-        napi_value obj;
-        napi_create_object(env, &obj);
-        
-        napi_set_named_property(env, obj, "geofenceId", CreateString(env, matches[i].geofenceId));
-        napi_set_named_property(env, obj, "distance", CreateDouble(env, matches[i].distance));
-        napi_set_named_property(env, obj, "inside", CreateBool(env, matches[i].inside));
-        
-        napi_set_element(env, result, i, obj);
-    }
+    GeoPointSoA centers;
+    centers.assign(geofences);
+    auto matches = getGeofencesAtLocation(lat, lon, geofences, centers);
     
-    return result;
+    return CreateMatchArray(env, matches);
 }
 
 /**
- * geoUtils.calculateCenter(points) → { latitude, longitude }
- * points: [{ latitude, longitude, ... }]
+ * 解析点集参数：[{ latitude, longitude }] 或打包的 Float64Array / ArrayBuffer
+ * 打包格式每点 stride 个 double，前两个为 lat, lng，stride 默认 2
  */
-static napi_value CalculateCenter(napi_env env, napi_callback_info info) {
-    size_t argc = 1;
-    napi_value args[1];
-    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
-    
-    if (argc < 1) {
-        napi_throw_error(env, nullptr, "Expected 1 argument: points");
-        return nullptr;
+static std::vector<GeoPoint> ParsePointsArg(napi_env env, napi_value value, napi_value strideArg) {
+    NATIVE_METRICS_SCOPE("geo_utils.parse_points");
+    native_common::Float64View view;
+    if (native_common::GetFloat64View(env, value, view)) {
+        int32_t stride = 2;
+        if (strideArg != nullptr) {
+            napi_valuetype type;
+            napi_typeof(env, strideArg, &type);
+            if (type == napi_number) napi_get_value_int32(env, strideArg, &stride);
+        }
+        return unpackPoints(view.data, view.length, static_cast<size_t>(stride < 2 ? 2 : stride));
     }
     
-    // 解析 points 数组
     std::vector<GeoPoint> points;
-    uint32_t arrayLen;
-    napi_get_array_length(env, args[0], &arrayLen);
+    uint32_t arrayLen = 0;
+    napi_get_array_length(env, value, &arrayLen);
+    points.reserve(arrayLen);
     
     for (uint32_t i = 0; i < arrayLen; i++) {
         napi_value elem;
-        napi_get_element(env, args[0], i, &elem);
+        napi_get_element(env, value, i, &elem);
         
         GeoPoint p;
         p.latitude = GetDoubleProp(env, elem, "latitude", 0);
@@ -196,6 +229,24 @@ static napi_value CalculateCenter(napi_env env, napi_callback_info info) {
         
         points.push_back(p);
     }
+    return points;
+}
+
+/**
+ * geoUtils.calculateCenter(points, stride?) → { latitude, longitude }
+ * points: [{ latitude, longitude, ... }] 或 Float64Array（stride 默认 2）
+ */
+static napi_value CalculateCenter(napi_env env, napi_callback_info info) {
+    size_t argc = 2;
+    napi_value args[2];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+    
+    if (argc < 1) {
+        napi_throw_error(env, nullptr, "Expected 1 argument: points");
+        return nullptr;
+    }
+    
+    std::vector<GeoPoint> points = ParsePointsArg(env, args[0], argc >= 2 ? args[1] : nullptr);
     
     // 计算
     double centerLat, centerLng;
@@ -212,11 +263,12 @@ static napi_value CalculateCenter(napi_env env, napi_callback_info info) {
 }
 
 /**
- * geoUtils.calculateRadius(points, centerLat, centerLng, percentile) → meters
+ * geoUtils.calculateRadius(points, centerLat, centerLng, percentile?, stride?) → meters
+ * points 同 calculateCenter
  */
 static napi_value CalculateRadius(napi_env env, napi_callback_info info) {
-    size_t argc = 4;
-    napi_value args[4];
+    size_t argc = 5;
+    napi_value args[5];
     napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
     
     if (argc < 3) {
@@ -224,21 +276,7 @@ static napi_value CalculateRadius(napi_env env, napi_callback_info info) {
         return nullptr;
     }
     
-    // 解析 points 数组
-    std::vector<GeoPoint> points;
-    uint32_t arrayLen;
-    napi_get_array_length(env, args[0], &arrayLen);
-    
-    for (uint32_t i = 0; i < arrayLen; i++) {
-        napi_value elem;
-        napi_get_element(env, args[0], i, &elem);
-        
-        GeoPoint p;
-        p.latitude = GetDoubleProp(env, elem, "latitude", 0);
-        p.longitude = GetDoubleProp(env, elem, "longitude", 0);
-        
-        points.push_back(p);
-    }
+    std::vector<GeoPoint> points = ParsePointsArg(env, args[0], argc >= 5 ? args[4] : nullptr);
     
     double centerLat, centerLng;
     napi_get_value_double(env, args[1], &centerLat);
@@ -246,14 +284,211 @@ static napi_value CalculateRadius(napi_env env, napi_callback_info info) {
     
     double percentile = 0.95;
     if (argc >= 4) {
-        napi_get_value_double(env, args[3], &percentile);
+        napi_valuetype type;
+        napi_typeof(env, args[3], &type);
+        if (type == napi_number) napi_get_value_double(env, args[3], &percentile);
     }
     
-    double radius = calculatePercentileRadius(points, centerLat, centerLng, percentile);
+    GeoPointSoA soa;
+    soa.assign(points);
+    double radius = calculatePercentileRadius(soa, centerLat, centerLng, percentile);
     
     return CreateDouble(env, radius);
 }
 
+// ============================================================
+// Persistent geofence index
+// ============================================================
+
+// 模块级常驻索引，只在 JS 线程访问
+static GeofenceIndex g_geofenceIndex;
+
+/**
+ * geoUtils.geofenceIndexSet(geofences) → number  整体替换索引，返回围栏数
+ */
+static napi_value GeofenceIndexSet(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+    
+    if (argc < 1) {
+        napi_throw_error(env, nullptr, "Expected 1 argument: geofences");
+        return nullptr;
+    }
+    
+    g_geofenceIndex.assign(ParseGeofences(env, args[0]));
+    return CreateDouble(env, static_cast<double>(g_geofenceIndex.size()));
+}
+
+/**
+ * geoUtils.geofenceIndexUpsert(geofence | geofences) → number  同 id 覆盖，返回围栏数
+ */
+static napi_value GeofenceIndexUpsert(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+    
+    if (argc < 1) {
+        napi_throw_error(env, nullptr, "Expected 1 argument: geofence or geofences");
+        return nullptr;
+    }
+    
+    bool isArray = false;
+    napi_is_array(env, args[0], &isArray);
+    if (isArray) {
+        for (const auto& gf : ParseGeofences(env, args[0])) g_geofenceIndex.upsert(gf);
+    } else {
+        g_geofenceIndex.upsert(ParseGeofence(env, args[0]));
+    }
+    return CreateDouble(env, static_cast<double>(g_geofenceIndex.size()));
+}
+
+/**
+ * geoUtils.geofenceIndexRemove(id) → boolean
+ */
+static napi_value GeofenceIndexRemove(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+    
+    if (argc < 1) {
+        napi_throw_error(env, nullptr, "Expected 1 argument: id");
+        return nullptr;
+    }
+    return CreateBool(env, g_geofenceIndex.remove(GetStringArg(env, args[0])));
+}
+
+/**
+ * geoUtils.geofenceIndexClear() → void
+ */
+static napi_value GeofenceIndexClear(napi_env env, napi_callback_info info) {
+    g_geofenceIndex.clear();
+    return nullptr;
+}
+
+/**
+ * geoUtils.geofenceIndexSize() → number
+ */
+static napi_value GeofenceIndexSize(napi_env env, napi_callback_info info) {
+    return CreateDouble(env, static_cast<double>(g_geofenceIndex.size()));
+}
+
+/**
+ * geoUtils.queryGeofencesNearby(lat, lon, marginMeters) → [{ geofenceId, distance, inside }]
+ * 只返回边界距离 ≤ marginMeters 的围栏，按距离升序；可直接作为 locationFusion 的 geofenceDistances
+ */
+static napi_value QueryGeofencesNearby(napi_env env, napi_callback_info info) {
+    size_t argc = 3;
+    napi_value args[3];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+    
+    if (argc < 2) {
+        napi_throw_error(env, nullptr, "Expected 2-3 arguments: lat, lon, marginMeters?");
+        return nullptr;
+    }
+    
+    double lat, lon;
+    napi_get_value_double(env, args[0], &lat);
+    napi_get_value_double(env, args[1], &lon);
+    
+    double margin = 0;
+    if (argc >= 3) {
+        napi_get_value_double(env, args[2], &margin);
+    }
+    
+    return CreateMatchArray(env, g_geofenceIndex.queryNearby(lat, lon, margin));
+}
+
+/**
+ * geoUtils.queryGeofencesContaining(lat, lon) → [{ geofenceId, distance, inside }]
+ */
+static napi_value QueryGeofencesContaining(napi_env env, napi_callback_info info) {
+    size_t argc = 2;
+    napi_value args[2];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+    
+    if (argc < 2) {
+        napi_throw_error(env, nullptr, "Expected 2 arguments: lat, lon");
+        return nullptr;
+    }
+    
+    double lat, lon;
+    napi_get_value_double(env, args[0], &lat);
+    napi_get_value_double(env, args[1], &lon);
+    
+    return CreateMatchArray(env, g_geofenceIndex.queryContaining(lat, lon));
+}
+
+// ============================================================
+// Async variants
+// ============================================================
+
+static native_common::AsyncRunner g_async("geo_utils");
+
+/**
+ * geoUtils.getGeofencesAtLocationAsync(lat, lon, geofences, taskId?) → Promise<GeofenceMatch[]>
+ */
+static napi_value GetGeofencesAtLocationAsync(napi_env env, napi_callback_info info) {
+    size_t argc = 4;
+    napi_value args[4];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+    
+    if (argc < 3) {
+        napi_throw_error(env, nullptr, "Expected 3-4 arguments: lat, lon, geofences, taskId?");
+        return nullptr;
+    }
+    
+    struct State {
+        double lat = 0;
+        double lon = 0;
+        std::vector<Geofence> geofences;
+        std::vector<GeofenceMatch> matches;
+    };
+    auto state = std::make_shared<State>();
+    napi_get_value_double(env, args[0], &state->lat);
+    napi_get_value_double(env, args[1], &state->lon);
+    state->geofences = ParseGeofences(env, args[2]);
+    std::string taskId = argc >= 4 ? GetStringArg(env, args[3]) : "";
+    
+    auto task = native_common::makeAsyncTask(
+        [state](native_common::AsyncTask&) {
+            GeoPointSoA centers;
+            centers.assign(state->geofences);
+            state->matches = getGeofencesAtLocation(state->lat, state->lon, state->geofences, centers);
+        },
+        [state](napi_env e) { return CreateMatchArray(e, state->matches); });
+    return g_async.submit(env, std::move(task), taskId);
+}
+
+/**
+ * geoUtils.cancelAsync(taskId) → boolean
+ */
+static napi_value CancelAsync(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+    
+    if (argc < 1) {
+        napi_throw_error(env, nullptr, "Expected 1 argument: taskId");
+        return nullptr;
+    }
+    return CreateBool(env, g_async.cancel(env, GetStringArg(env, args[0])));
+}
+
+/**
+ * geoUtils.setAsyncConcurrency(n) → void
+ */
+static napi_value SetAsyncConcurrency(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+    
+    int32_t n = 0;
+    if (argc >= 1) napi_get_value_int32(env, args[0], &n);
+    g_async.setMaxConcurrent(n > 0 ? static_cast<size_t>(n) : 1);
+    return nullptr;
+}
+
 // ============================================================
 // Module registration
 // ============================================================
@@ -267,6 +502,17 @@ static napi_value Init(napi_env env, napi_value exports) {
         {"getGeofencesAtLocation", nullptr, GetGeofencesAtLocation, nullptr, nullptr, nullptr, napi_default, nullptr},
         {"calculateCenter", nullptr, CalculateCenter, nullptr, nullptr, nullptr, napi_default, nullptr},
         {"calculateRadius", nullptr, CalculateRadius, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"geofenceIndexSet", nullptr, GeofenceIndexSet, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"geofenceIndexUpsert", nullptr, GeofenceIndexUpsert, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"geofenceIndexRemove", nullptr, GeofenceIndexRemove, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"geofenceIndexClear", nullptr, GeofenceIndexClear, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"geofenceIndexSize", nullptr, GeofenceIndexSize, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"queryGeofencesNearby", nullptr, QueryGeofencesNearby, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"queryGeofencesContaining", nullptr, QueryGeofencesContaining, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"getGeofencesAtLocationAsync", nullptr, GetGeofencesAtLocationAsync, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"cancelAsync", nullptr, CancelAsync, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"setAsyncConcurrency", nullptr, SetAsyncConcurrency, nullptr, nullptr, nullptr, napi_default, nullptr},
+        native_common::MetricsProperty("geo_utils"),
     };
     
     napi_define_properties(env, exports, sizeof(desc) / sizeof(desc[0]), desc);
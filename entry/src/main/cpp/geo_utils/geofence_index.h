@@ -0,0 +1,143 @@
+/**
+ * geofence_index.h — 常驻围栏空间索引
+ *
+ * getGeofencesAtLocation 每次对全部围栏算距离并全部返回。学习地点 + 导入 POI 上百个时，
+ * 每次定位更新都要付出 O(N) 的代价，而真正有用的只有附近几个。
+ *
+ * 这里把围栏按外接矩形放进 SpatialGrid（insertCircle），支持增量 upsert / remove，
+ * 查询只对附近格子里的候选算精确距离：
+ *   - queryNearby(lat, lon, margin)：边界距离 ≤ margin 的围栏（distance ≤ radius + margin）
+ *   - queryContaining(lat, lon)：包含该点的围栏
+ * 半径过大、覆盖格子数超过 MAX_CELLS_PER_FENCE 的围栏不进网格，单独列出、每次查询都检查。
+ *
+ * 非线程安全：读写由调用方串行化（NAPI 层只在 JS 线程访问）。
+ */
+#pragma once
+
+#include "geo_utils.h"
+#include "spatial_grid.h"
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace geo_utils {
+
+class GeofenceIndex {
+public:
+    static constexpr double DEFAULT_CELL_METERS = 500.0;
+    static constexpr size_t MAX_CELLS_PER_FENCE = 64;
+
+    explicit GeofenceIndex(double cellMeters = DEFAULT_CELL_METERS) : grid_(cellMeters) {}
+
+    /**
+     * 添加或替换同 id 的围栏
+     * @return true = 新增，false = 替换
+     */
+    bool upsert(const Geofence& gf) {
+        bool replaced = remove(gf.id);
+
+        uint32_t slot;
+        if (!freeSlots_.empty()) {
+            slot = freeSlots_.back();
+            freeSlots_.pop_back();
+            fences_[slot] = gf;
+        } else {
+            slot = static_cast<uint32_t>(fences_.size());
+            fences_.push_back(gf);
+            large_.push_back(0);
+        }
+        byId_[gf.id] = slot;
+
+        large_[slot] = grid_.insertCircle(slot, gf.latitude, gf.longitude, gf.radiusMeters, MAX_CELLS_PER_FENCE) ? 0 : 1;
+        if (large_[slot]) largeSlots_.push_back(slot);
+        return !replaced;
+    }
+
+    /**
+     * @return 是否存在该 id
+     */
+    bool remove(const std::string& id) {
+        auto it = byId_.find(id);
+        if (it == byId_.end()) return false;
+
+        uint32_t slot = it->second;
+        const Geofence& gf = fences_[slot];
+        if (large_[slot]) {
+            largeSlots_.erase(std::find(largeSlots_.begin(), largeSlots_.end(), slot));
+        } else {
+            grid_.removeCircle(slot, gf.latitude, gf.longitude, gf.radiusMeters);
+        }
+        fences_[slot] = Geofence{};
+        freeSlots_.push_back(slot);
+        byId_.erase(it);
+        return true;
+    }
+
+    /** 用 geofences 整体替换索引内容 */
+    void assign(const std::vector<Geofence>& geofences) {
+        clear();
+        for (const auto& gf : geofences) upsert(gf);
+    }
+
+    void clear() {
+        grid_.clear();
+        fences_.clear();
+        large_.clear();
+        largeSlots_.clear();
+        freeSlots_.clear();
+        byId_.clear();
+    }
+
+    size_t size() const { return byId_.size(); }
+
+    const Geofence* find(const std::string& id) const {
+        auto it = byId_.find(id);
+        return it == byId_.end() ? nullptr : &fences_[it->second];
+    }
+
+    /**
+     * 边界距离不超过 marginMeters 的围栏，按中心距离升序
+     * GeofenceMatch.distance 为到围栏中心的距离，与 getGeofencesAtLocation 一致
+     */
+    std::vector<GeofenceMatch> queryNearby(double lat, double lon, double marginMeters) const {
+        marginMeters = std::max(marginMeters, 0.0);
+
+        // 跨多个格子的围栏会重复出现，先收集再去重
+        std::vector<uint32_t> candidates;
+        grid_.forEachCandidate(lat, lon, marginMeters, [&](uint32_t slot) { candidates.push_back(slot); });
+        std::sort(candidates.begin(), candidates.end());
+        candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+        candidates.insert(candidates.end(), largeSlots_.begin(), largeSlots_.end());
+
+        std::vector<GeofenceMatch> result;
+        for (uint32_t slot : candidates) {
+            const Geofence& gf = fences_[slot];
+            double dist = haversineDistance(lat, lon, gf.latitude, gf.longitude);
+            if (dist <= gf.radiusMeters + marginMeters) {
+                result.push_back({gf.id, dist, dist <= gf.radiusMeters});
+            }
+        }
+        std::sort(result.begin(), result.end(),
+                  [](const GeofenceMatch& a, const GeofenceMatch& b) { return a.distance < b.distance; });
+        return result;
+    }
+
+    /** 包含 (lat, lon) 的围栏，按中心距离升序 */
+    std::vector<GeofenceMatch> queryContaining(double lat, double lon) const {
+        return queryNearby(lat, lon, 0.0);
+    }
+
+private:
+    SpatialGrid grid_;
+
+    // 按槽位存储，网格中的 id 即槽位号
+    std::vector<Geofence> fences_;
+    std::vector<uint8_t> large_;
+    std::vector<uint32_t> largeSlots_;
+    std::vector<uint32_t> freeSlots_;
+    std::unordered_map<std::string, uint32_t> byId_;
+};
+
+}  // namespace geo_utils
@@ -0,0 +1,190 @@
+/**
+ * spatial_grid.h — 等距矩形网格空间索引
+ *
+ * 按固定边长（米）把经纬度平面切成网格，半径查询只访问与查询圆外接矩形
+ * 相交的格子。每一行（纬度带）的经度格宽按该行绝对值最大的纬度放大，
+ * 保证任意纬度下格子东西方向的实际宽度都不小于 cellMeters。
+ * 点用 insert 放进单个格子；带半径的对象用 insertCircle 放进外接矩形覆盖的所有格子。
+ *
+ * 注意：不处理 ±180° 经线回绕（使用场景不会跨越日界线）。
+ */
+#pragma once
+
+#include "geo_utils.h"
+#include <unordered_map>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace geo_utils {
+
+/** 每纬度对应的米数 */
+constexpr double METERS_PER_DEG_LAT = EARTH_RADIUS_METERS * PI / 180.0;
+
+class SpatialGrid {
+public:
+    explicit SpatialGrid(double cellMeters = 50.0) {
+        reset(cellMeters);
+    }
+
+    /**
+     * 清空并设置格子边长
+     */
+    void reset(double cellMeters) {
+        cellMeters_ = std::max(cellMeters, 1.0);
+        cellDegLat_ = cellMeters_ / METERS_PER_DEG_LAT;
+        cells_.clear();
+    }
+
+    /**
+     * 批量建索引，id 即点在 points 中的下标
+     */
+    void build(const std::vector<GeoPoint>& points) {
+        cells_.clear();
+        cells_.reserve(points.size() / 4 + 1);
+        for (size_t i = 0; i < points.size(); i++) {
+            insert(static_cast<uint32_t>(i), points[i].latitude, points[i].longitude);
+        }
+    }
+
+    void insert(uint32_t id, double lat, double lng) {
+        int32_t row = rowOf(lat);
+        cells_[cellKey(row, colOf(lng, rowCos(row)))].push_back(id);
+    }
+
+    /**
+     * 删除一个 id（坐标必须与插入时一致）
+     * @return 是否找到
+     */
+    bool remove(uint32_t id, double lat, double lng) {
+        int32_t row = rowOf(lat);
+        auto it = cells_.find(cellKey(row, colOf(lng, rowCos(row))));
+        if (it == cells_.end()) return false;
+
+        auto& ids = it->second;
+        auto pos = std::find(ids.begin(), ids.end(), id);
+        if (pos == ids.end()) return false;
+
+        *pos = ids.back();
+        ids.pop_back();
+        if (ids.empty()) {
+            cells_.erase(it);
+        }
+        return true;
+    }
+
+    /**
+     * 按圆的外接矩形插入：id 进入与之相交的每个格子（用于带半径的对象，如围栏）
+     * @param maxCells 覆盖格子数超过该值时不插入并返回 false，由调用方另行处理
+     */
+    bool insertCircle(uint32_t id, double lat, double lng, double radiusMeters, size_t maxCells) {
+        size_t count = 0;
+        forEachCellInRange(lat, lng, radiusMeters, [&](uint64_t) { count++; });
+        if (count > maxCells) return false;
+        forEachCellInRange(lat, lng, radiusMeters, [&](uint64_t key) { cells_[key].push_back(id); });
+        return true;
+    }
+
+    /**
+     * 删除 insertCircle 插入的 id（参数必须与插入时一致）
+     */
+    void removeCircle(uint32_t id, double lat, double lng, double radiusMeters) {
+        forEachCellInRange(lat, lng, radiusMeters, [&](uint64_t key) {
+            auto it = cells_.find(key);
+            if (it == cells_.end()) return;
+            auto& ids = it->second;
+            auto pos = std::find(ids.begin(), ids.end(), id);
+            if (pos == ids.end()) return;
+            *pos = ids.back();
+            ids.pop_back();
+            if (ids.empty()) cells_.erase(it);
+        });
+    }
+
+    /**
+     * 枚举可能落在 (lat, lng) 半径 radiusMeters 内的候选 id
+     * 候选是超集，调用方仍需做精确距离判断；insertCircle 插入的 id 可能重复出现
+     */
+    template <typename Fn>
+    void forEachCandidate(double lat, double lng, double radiusMeters, Fn&& fn) const {
+        if (cells_.empty()) return;
+
+        forEachCellInRange(lat, lng, radiusMeters, [&](uint64_t key) {
+            auto it = cells_.find(key);
+            if (it == cells_.end()) return;
+            for (uint32_t id : it->second) {
+                fn(id);
+            }
+        });
+    }
+
+    void clear() { cells_.clear(); }
+
+    size_t cellCount() const { return cells_.size(); }
+
+    double cellMeters() const { return cellMeters_; }
+
+private:
+    static constexpr double MAX_ABS_LAT = 89.0;   // 极点附近 cos→0，截断
+    static constexpr double MIN_COS = 0.01;
+
+    struct KeyHash {
+        size_t operator()(uint64_t k) const {
+            // splitmix64 finalizer，避免 row/col 直接拼接后分布不均
+            k ^= k >> 30; k *= 0xbf58476d1ce4e5b9ULL;
+            k ^= k >> 27; k *= 0x94d049bb133111ebULL;
+            k ^= k >> 31;
+            return static_cast<size_t>(k);
+        }
+    };
+
+    double cellMeters_ = 50.0;
+    double cellDegLat_ = 0.0;
+    std::unordered_map<uint64_t, std::vector<uint32_t>, KeyHash> cells_;
+
+    static uint64_t cellKey(int32_t row, int32_t col) {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(row)) << 32) |
+               static_cast<uint32_t>(col);
+    }
+
+    int32_t rowOf(double lat) const {
+        return static_cast<int32_t>(std::floor(lat / cellDegLat_));
+    }
+
+    /** 该行纬度带内最小的 cos(lat) */
+    double rowCos(int32_t row) const {
+        double lo = std::abs(row * cellDegLat_);
+        double hi = std::abs((row + 1) * cellDegLat_);
+        double maxAbsLat = std::min(std::max(lo, hi), MAX_ABS_LAT);
+        return std::max(std::cos(toRad(maxAbsLat)), MIN_COS);
+    }
+
+    int32_t colOf(double lng, double cosRow) const {
+        return static_cast<int32_t>(std::floor(lng * cosRow / cellDegLat_));
+    }
+
+    /**
+     * 枚举与 (lat, lng) 半径 radiusMeters 外接矩形相交的格子
+     */
+    template <typename Fn>
+    void forEachCellInRange(double lat, double lng, double radiusMeters, Fn&& fn) const {
+        double dLat = radiusMeters / METERS_PER_DEG_LAT;
+        int32_t rowLo = rowOf(lat - dLat);
+        int32_t rowHi = rowOf(lat + dLat);
+
+        for (int32_t row = rowLo; row <= rowHi; row++) {
+            // 同一行内用该行最小的 cos，经度方向的查询范围只会偏大
+            double cosRow = rowCos(row);
+            double dLng = radiusMeters / (METERS_PER_DEG_LAT * cosRow);
+            int32_t colLo = colOf(lng - dLng, cosRow);
+            int32_t colHi = colOf(lng + dLng, cosRow);
+
+            for (int32_t col = colLo; col <= colHi; col++) {
+                fn(cellKey(row, col));
+            }
+        }
+    }
+};
+
+}  // namespace geo_utils
@@ -0,0 +1,301 @@
+/**
+ * fusion_index.h — 常驻编译版位置融合索引
+ *
+ * calculateAllConfidences 每次都要按围栏 id 查 LearnedSignals，对每个围栏哈希一次当前 SSID、
+ * 再把当前 BT 设备逐个查一遍 unordered_map<string, int>；办公室里一次 BT 扫描就有 50+ 个设备，
+ * 代价是 O(围栏数 × 设备数) 次字符串哈希。
+ *
+ * 这里把已学习信号编译进常驻索引：
+ *   - SSID / BT 设备名驻留为整数 id
+ *   - 倒排表：信号 id → 已学会它的围栏；learningMinObservations 阈值在学习时应用一次，
+ *     只有 “观测次数达标且围栏总观测达标” 的信号才进倒排表
+ *   - 围栏几何放在 geo_utils::GeofenceIndex 里，GPS 候选来自其 queryNearby
+ * 一次扫描只对当前 SSID / 每个 BT 设备各哈希一次，只访问倒排表命中的围栏和 GPS 候选围栏。
+ *
+ * 未被访问到的围栏置信度不超过 floorConfidence()（GPS 最低值或 WiFi 不匹配值），
+ * scan 不返回它们；返回的围栏结果与 LocationFusion::calculateConfidence 逐项一致。
+ *
+ * 非线程安全：读写由调用方串行化（NAPI 层只在 JS 线程访问）。
+ */
+#pragma once
+
+#include "location_fusion.h"
+#include "geofence_index.h"
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace location_fusion {
+
+/** 一次扫描的观测输入 */
+struct FusionScan {
+    bool hasLocation = false;
+    double latitude = 0;
+    double longitude = 0;
+    double gpsAccuracy = 100;
+    std::string currentWifiSsid;
+    std::vector<std::string> currentBtDevices;
+};
+
+class FusionIndex {
+public:
+    explicit FusionIndex(const FusionConfig& config = FusionConfig{}) : fusion_(config) {}
+
+    // ============================================================
+    // 围栏几何
+    // ============================================================
+
+    /** 整体替换围栏列表；不在列表中的围栏保留已学习信号，但不再参与扫描 */
+    void assignFences(const std::vector<geo_utils::Geofence>& geofences) {
+        geo_.assign(geofences);
+        for (auto& e : entries_) e.order = NO_FENCE;
+        for (size_t i = 0; i < geofences.size(); i++) {
+            entries_[slotFor(geofences[i].id)].order = static_cast<uint32_t>(i);
+        }
+        nextOrder_ = static_cast<uint32_t>(geofences.size());
+    }
+
+    void upsertFence(const geo_utils::Geofence& gf) {
+        geo_.upsert(gf);
+        Entry& e = entries_[slotFor(gf.id)];
+        if (e.order == NO_FENCE) e.order = nextOrder_++;
+    }
+
+    bool removeFence(const std::string& id) {
+        if (!geo_.remove(id)) return false;
+        entries_[bySlot_.at(id)].order = NO_FENCE;
+        return true;
+    }
+
+    size_t fenceCount() const { return geo_.size(); }
+
+    // ============================================================
+    // 已学习信号
+    // ============================================================
+
+    /** 用完整的 LearnedSignals 替换某围栏的信号（加载持久化数据时用） */
+    void setSignals(const std::string& geofenceId, const LearnedSignals& signals) {
+        uint32_t slot = slotFor(geofenceId);
+        Entry& e = entries_[slot];
+        e.wifiCounts.clear();
+        e.btCounts.clear();
+        for (const auto& [ssid, count] : signals.wifiSsids) {
+            e.wifiCounts[intern(wifiIds_, wifiPostings_, ssid)] = count;
+        }
+        for (const auto& [device, count] : signals.btDevices) {
+            e.btCounts[intern(btIds_, btPostings_, device)] = count;
+        }
+        e.totalObservations = signals.totalObservations;
+        recompile(slot);
+    }
+
+    /** 与 LocationFusion::learnSignal 相同的一次观测 */
+    void learn(const std::string& geofenceId, const std::string& wifiSsid, const std::vector<std::string>& btDevices) {
+        uint32_t slot = slotFor(geofenceId);
+        Entry& e = entries_[slot];
+        if (!wifiSsid.empty()) e.wifiCounts[intern(wifiIds_, wifiPostings_, wifiSsid)]++;
+        for (const auto& device : btDevices) {
+            if (!device.empty()) e.btCounts[intern(btIds_, btPostings_, device)]++;
+        }
+        e.totalObservations++;
+        recompile(slot);
+    }
+
+    void clearSignals(const std::string& geofenceId) {
+        auto it = bySlot_.find(geofenceId);
+        if (it == bySlot_.end()) return;
+        Entry& e = entries_[it->second];
+        e.wifiCounts.clear();
+        e.btCounts.clear();
+        e.totalObservations = 0;
+        recompile(it->second);
+    }
+
+    void clearAllSignals() {
+        for (uint32_t slot = 0; slot < entries_.size(); slot++) {
+            Entry& e = entries_[slot];
+            e.wifiCounts.clear();
+            e.btCounts.clear();
+            e.totalObservations = 0;
+            e.wifiPosted.clear();
+            e.btPosted.clear();
+        }
+        for (auto& p : wifiPostings_) p.clear();
+        for (auto& p : btPostings_) p.clear();
+    }
+
+    // ============================================================
+    // 扫描
+    // ============================================================
+
+    /** 未返回的围栏置信度上限 */
+    double floorConfidence() const {
+        return std::max(fusion_.config().gpsMinConfidence, fusion_.config().wifiNoMatchConfidence);
+    }
+
+    /**
+     * 可能高于 floorConfidence() 的围栏，按置信度降序；同分按围栏列表顺序
+     * （与按列表顺序逐个 calculateConfidence、取严格更大者的结果一致）
+     */
+    void scan(const FusionScan& in, std::vector<FusionResult>& out) const {
+        out.clear();
+        const FusionConfig& cfg = fusion_.config();
+        if (++stamp_ == 0) {
+            std::fill(seen_.begin(), seen_.end(), 0);
+            stamp_ = 1;
+        }
+        seen_.resize(entries_.size(), 0);
+        touched_.clear();
+
+        // GPS 候选：中心距离 < 3 × 衰减尺度，更远的 GPS 置信度恒为最小值
+        const double gpsReach = cfg.gpsDecayScale * 3;
+        if (in.hasLocation) {
+            for (const auto& m : geo_.queryNearby(in.latitude, in.longitude, gpsReach)) {
+                if (m.distance >= gpsReach) continue;
+                touch(bySlot_.at(m.geofenceId)).distance = m.distance;
+            }
+        }
+
+        if (!in.currentWifiSsid.empty()) {
+            auto it = wifiIds_.find(in.currentWifiSsid);
+            if (it != wifiIds_.end()) {
+                for (uint32_t slot : wifiPostings_[it->second]) touch(slot).wifiMatch = true;
+            }
+        }
+        for (const auto& device : in.currentBtDevices) {
+            auto it = btIds_.find(device);
+            if (it == btIds_.end()) continue;
+            for (uint32_t slot : btPostings_[it->second]) touch(slot).btMatch = true;
+        }
+
+        std::vector<std::pair<uint32_t, size_t>> ranked;
+        for (const Touch& t : touched_) {
+            const Entry& e = entries_[t.slot];
+            if (e.order == NO_FENCE) continue;
+            bool mature = e.totalObservations >= cfg.learningMinObservations;
+
+            double wifi = 0;
+            if (!in.currentWifiSsid.empty() && mature) {
+                if (t.wifiMatch) {
+                    wifi = cfg.wifiMatchConfidence;
+                } else if (!e.wifiCounts.empty()) {
+                    wifi = cfg.wifiNoMatchConfidence;
+                }
+            }
+            double bt = t.btMatch ? cfg.btMatchConfidence : 0;
+            double gps = fusion_.calcGpsConfidence(t.distance, in.gpsAccuracy);
+
+            ranked.emplace_back(e.order, out.size());
+            out.push_back(LocationFusion::fuse(e.id, gps, wifi, bt, in.gpsAccuracy));
+        }
+
+        std::sort(ranked.begin(), ranked.end(), [&](const auto& a, const auto& b) {
+            double ca = out[a.second].confidence, cb = out[b.second].confidence;
+            return ca != cb ? ca > cb : a.first < b.first;
+        });
+        std::vector<FusionResult> sorted;
+        sorted.reserve(out.size());
+        for (const auto& r : ranked) sorted.push_back(std::move(out[r.second]));
+        out.swap(sorted);
+    }
+
+    /** 上一次 scan 访问的围栏数（含已移除几何的） */
+    size_t lastTouched() const { return touched_.size(); }
+
+private:
+    static constexpr uint32_t NO_FENCE = UINT32_MAX;
+
+    struct Entry {
+        std::string id;
+        uint32_t order = NO_FENCE;  // 在围栏列表中的位置；NO_FENCE = 当前没有几何
+        int totalObservations = 0;
+        std::unordered_map<uint32_t, int> wifiCounts;  // 信号 id → 观测次数
+        std::unordered_map<uint32_t, int> btCounts;
+        std::vector<uint32_t> wifiPosted;  // 已进入倒排表的信号 id
+        std::vector<uint32_t> btPosted;
+    };
+
+    struct Touch {
+        uint32_t slot;
+        double distance;
+        bool wifiMatch;
+        bool btMatch;
+    };
+
+    uint32_t slotFor(const std::string& id) {
+        auto it = bySlot_.find(id);
+        if (it != bySlot_.end()) return it->second;
+        uint32_t slot = static_cast<uint32_t>(entries_.size());
+        entries_.emplace_back();
+        entries_.back().id = id;
+        bySlot_.emplace(id, slot);
+        return slot;
+    }
+
+    static uint32_t intern(std::unordered_map<std::string, uint32_t>& ids,
+                           std::vector<std::vector<uint32_t>>& postings, const std::string& name) {
+        auto [it, inserted] = ids.emplace(name, static_cast<uint32_t>(postings.size()));
+        if (inserted) postings.emplace_back();
+        return it->second;
+    }
+
+    /** 按学习阈值重建某围栏在倒排表中的条目 */
+    void recompile(uint32_t slot) {
+        Entry& e = entries_[slot];
+        auto unpost = [slot](std::vector<std::vector<uint32_t>>& postings, std::vector<uint32_t>& posted) {
+            for (uint32_t sig : posted) {
+                auto& list = postings[sig];
+                list.erase(std::find(list.begin(), list.end(), slot));
+            }
+            posted.clear();
+        };
+        unpost(wifiPostings_, e.wifiPosted);
+        unpost(btPostings_, e.btPosted);
+
+        const int minObs = fusion_.config().learningMinObservations;
+        if (e.totalObservations < minObs) return;
+        for (const auto& [sig, count] : e.wifiCounts) {
+            if (count < minObs) continue;
+            wifiPostings_[sig].push_back(slot);
+            e.wifiPosted.push_back(sig);
+        }
+        for (const auto& [sig, count] : e.btCounts) {
+            if (count < minObs) continue;
+            btPostings_[sig].push_back(slot);
+            e.btPosted.push_back(sig);
+        }
+    }
+
+    Touch& touch(uint32_t slot) const {
+        if (seen_[slot] != stamp_) {
+            seen_[slot] = stamp_;
+            slotTouch_.resize(entries_.size());
+            slotTouch_[slot] = static_cast<uint32_t>(touched_.size());
+            // 非 GPS 候选：距离视为无穷远，GPS 置信度取最小值
+            touched_.push_back({slot, 99999.0, false, false});
+        }
+        return touched_[slotTouch_[slot]];
+    }
+
+    LocationFusion fusion_;
+    geo_utils::GeofenceIndex geo_;
+
+    std::vector<Entry> entries_;
+    std::unordered_map<std::string, uint32_t> bySlot_;
+    uint32_t nextOrder_ = 0;
+
+    std::unordered_map<std::string, uint32_t> wifiIds_;
+    std::unordered_map<std::string, uint32_t> btIds_;
+    std::vector<std::vector<uint32_t>> wifiPostings_;  // SSID id → 围栏槽位
+    std::vector<std::vector<uint32_t>> btPostings_;    // BT id → 围栏槽位
+
+    // 扫描暂存：按槽位打标去重
+    mutable std::vector<uint32_t> seen_;
+    mutable std::vector<uint32_t> slotTouch_;
+    mutable std::vector<Touch> touched_;
+    mutable uint32_t stamp_ = 0;
+};
+
+}  // namespace location_fusion
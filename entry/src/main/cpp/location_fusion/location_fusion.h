@@ -5,9 +5,11 @@
  */
 #pragma once
 
+#include "geo_utils.h"
 #include <string>
 #include <vector>
 #include <unordered_map>
+#include <algorithm>
 #include <cmath>
 
 namespace location_fusion {
@@ -20,7 +22,7 @@ namespace location_fusion {
 struct LearnedSignals {
     std::unordered_map<std::string, int> wifiSsids;    // ssid → 观测次数
     std::unordered_map<std::string, int> btDevices;    // deviceName → 观测次数
-    int totalObservations;
+    int totalObservations = 0;
 };
 
 /** 融合结果 */
@@ -71,17 +73,23 @@ public:
         const std::vector<std::string>& currentBtDevices,
         const LearnedSignals& signals) {
         
+        return fuse(geofenceId,
+                    calcGpsConfidence(distance, gpsAccuracy),
+                    calcWifiConfidence(currentWifiSsid, signals),
+                    calcBtConfidence(currentBtDevices, signals),
+                    gpsAccuracy);
+    }
+    
+    /**
+     * 由三路分项置信度得到融合结果（FusionIndex 也走这里，保证两条路径结果一致）
+     */
+    static FusionResult fuse(const std::string& geofenceId, double gpsConfidence, double wifiConfidence,
+                             double btConfidence, double gpsAccuracy) {
         FusionResult result;
         result.geofenceId = geofenceId;
-        
-        // GPS 置信度
-        result.gpsConfidence = calcGpsConfidence(distance, gpsAccuracy);
-        
-        // WiFi 置信度
-        result.wifiConfidence = calcWifiConfidence(currentWifiSsid, signals);
-        
-        // BT 置信度
-        result.btConfidence = calcBtConfidence(currentBtDevices, signals);
+        result.gpsConfidence = gpsConfidence;
+        result.wifiConfidence = wifiConfidence;
+        result.btConfidence = btConfidence;
         
         // 融合：取最大值
         result.confidence = std::max({result.gpsConfidence, result.wifiConfidence, result.btConfidence});
@@ -118,9 +126,10 @@ public:
         std::vector<FusionResult> results;
         results.reserve(geofenceDistances.size());
         
+        static const LearnedSignals kNoSignals;
         for (const auto& [gfId, distance] : geofenceDistances) {
             auto it = allSignals.find(gfId);
-            const LearnedSignals& signals = (it != allSignals.end()) ? it->second : LearnedSignals{};
+            const LearnedSignals& signals = (it != allSignals.end()) ? it->second : kNoSignals;
             
             auto result = calculateConfidence(gfId, distance, gpsAccuracy, 
                                              currentWifiSsid, currentBtDevices, signals);
@@ -130,6 +139,24 @@ public:
         return results;
     }
     
+    /**
+     * 直接接收 GeofenceIndex::queryNearby / getGeofencesAtLocation 的输出
+     */
+    std::vector<FusionResult> calculateAllConfidences(
+        const std::vector<geo_utils::GeofenceMatch>& matches,
+        double gpsAccuracy,
+        const std::string& currentWifiSsid,
+        const std::vector<std::string>& currentBtDevices,
+        const std::unordered_map<std::string, LearnedSignals>& allSignals) {
+        
+        std::vector<std::pair<std::string, double>> geofenceDistances;
+        geofenceDistances.reserve(matches.size());
+        for (const auto& m : matches) {
+            geofenceDistances.emplace_back(m.geofenceId, m.distance);
+        }
+        return calculateAllConfidences(geofenceDistances, gpsAccuracy, currentWifiSsid, currentBtDevices, allSignals);
+    }
+    
     /**
      * 学习信号（当 GPS 高精度确认在围栏内时调用）
      */
@@ -151,13 +178,12 @@ public:
         signals.totalObservations++;
     }
 
-private:
-    FusionConfig config_;
+    const FusionConfig& config() const { return config_; }
     
     /**
      * 计算 GPS 置信度
      */
-    double calcGpsConfidence(double distance, double accuracy) {
+    double calcGpsConfidence(double distance, double accuracy) const {
         if (distance < config_.gpsHighConfidenceRadius) {
             return 1.0;
         }
@@ -171,10 +197,13 @@ private:
         return config_.gpsMinConfidence;
     }
     
+private:
+    FusionConfig config_;
+    
     /**
      * 计算 WiFi 置信度
      */
-    double calcWifiConfidence(const std::string& currentSsid, const LearnedSignals& signals) {
+    double calcWifiConfidence(const std::string& currentSsid, const LearnedSignals& signals) const {
         if (currentSsid.empty()) return 0;
         
         if (signals.totalObservations < config_.learningMinObservations) {
@@ -198,7 +227,7 @@ private:
      * 计算蓝牙置信度
      */
     double calcBtConfidence(const std::vector<std::string>& currentDevices, 
-                           const LearnedSignals& signals) {
+                           const LearnedSignals& signals) const {
         if (currentDevices.empty()) return 0;
         
         if (signals.totalObservations < config_.learningMinObservations) {
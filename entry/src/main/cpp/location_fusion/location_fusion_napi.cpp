@@ -3,6 +3,10 @@
  */
 #include <napi/native_api.h>
 #include "location_fusion.h"
+#include "fusion_index.h"
+#include "common/napi_async.h"
+#include "common/metrics_napi.h"
+#include <memory>
 #include <vector>
 #include <string>
 #include <unordered_map>
@@ -47,6 +51,14 @@ static std::string GetStringProp(napi_env env, napi_value obj, const char* key,
     return (status == napi_ok) ? result : defaultVal;
 }
 
+static std::string getStringArg(napi_env env, napi_value val) {
+    size_t len = 0;
+    if (napi_get_value_string_utf8(env, val, nullptr, 0, &len) != napi_ok) return "";
+    std::string result(len, '\0');
+    napi_get_value_string_utf8(env, val, &result[0], len + 1, &len);
+    return result;
+}
+
 static napi_value CreateDouble(napi_env env, double val) {
     napi_value result;
     napi_create_double(env, val, &result);
@@ -75,7 +87,7 @@ static LearnedSignals parseLearnedSignals(napi_env env, napi_value obj) {
             napi_value key;
             napi_get_element(env, keys, i, &key);
             
-            std::string ssid = GetStringProp(env, key, "");
+            std::string ssid = getStringArg(env, key);
             napi_value val;
             napi_get_property(env, wifiProp, key, &val);
             
@@ -100,7 +112,7 @@ static LearnedSignals parseLearnedSignals(napi_env env, napi_value obj) {
             napi_value key;
             napi_get_element(env, keys, i, &key);
             
-            std::string device = GetStringProp(env, key, "");
+            std::string device = getStringArg(env, key);
             napi_value val;
             napi_get_property(env, btProp, key, &val);
             
@@ -154,7 +166,7 @@ static napi_value CalculateConfidence(napi_env env, napi_callback_info info) {
         for (uint32_t i = 0; i < len; i++) {
             napi_value elem;
             napi_get_element(env, btArray, i, &elem);
-            currentBtDevices.push_back(GetStringProp(env, elem, ""));
+            currentBtDevices.push_back(getStringArg(env, elem));
         }
     }
     
@@ -184,54 +196,51 @@ static napi_value CalculateConfidence(napi_env env, napi_callback_info info) {
     return obj;
 }
 
-/**
- * locationFusion.calculateAllConfidences(params) → FusionResult[]
- */
-static napi_value CalculateAllConfidences(napi_env env, napi_callback_info info) {
-    size_t argc = 1;
-    napi_value args[1];
-    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
-    
-    if (argc < 1) {
-        napi_throw_error(env, nullptr, "Expected 1 argument: params");
-        return nullptr;
-    }
-    
-    double gpsAccuracy = GetDoubleProp(env, args[0], "gpsAccuracy", 100);
-    std::string currentWifiSsid = GetStringProp(env, args[0], "currentWifiSsid", "");
+/** calculateAllConfidences 的全部输入，JS 线程解析后可交给工作线程 */
+struct AllConfidencesParams {
+    double gpsAccuracy = 100;
+    std::string currentWifiSsid;
+    std::vector<std::string> currentBtDevices;
+    std::vector<std::pair<std::string, double>> geofenceDistances;
+    std::unordered_map<std::string, LearnedSignals> allSignals;
+};
+
+static AllConfidencesParams parseAllConfidencesParams(napi_env env, napi_value obj) {
+    AllConfidencesParams params;
+    params.gpsAccuracy = GetDoubleProp(env, obj, "gpsAccuracy", 100);
+    params.currentWifiSsid = GetStringProp(env, obj, "currentWifiSsid", "");
     
     // 解析 currentBtDevices
-    std::vector<std::string> currentBtDevices;
     napi_value btArray;
-    if (napi_get_named_property(env, args[0], "currentBtDevices", &btArray) == napi_ok) {
+    if (napi_get_named_property(env, obj, "currentBtDevices", &btArray) == napi_ok) {
         uint32_t len;
         napi_get_array_length(env, btArray, &len);
         for (uint32_t i = 0; i < len; i++) {
             napi_value elem;
             napi_get_element(env, btArray, i, &elem);
-            currentBtDevices.push_back(GetStringProp(env, elem, ""));
+            params.currentBtDevices.push_back(getStringArg(env, elem));
         }
     }
     
     // 解析 geofenceDistances: [{ id, distance }]
-    std::vector<std::pair<std::string, double>> geofenceDistances;
+    // 也接受 geoUtils.queryGeofencesNearby / getGeofencesAtLocation 的输出 [{ geofenceId, distance, inside }]
     napi_value distArray;
-    if (napi_get_named_property(env, args[0], "geofenceDistances", &distArray) == napi_ok) {
+    if (napi_get_named_property(env, obj, "geofenceDistances", &distArray) == napi_ok) {
         uint32_t len;
         napi_get_array_length(env, distArray, &len);
         for (uint32_t i = 0; i < len; i++) {
             napi_value elem;
             napi_get_element(env, distArray, i, &elem);
             std::string id = GetStringProp(env, elem, "id", "");
+            if (id.empty()) id = GetStringProp(env, elem, "geofenceId", "");
             double dist = GetDoubleProp(env, elem, "distance", 9999);
-            geofenceDistances.push_back({id, dist});
+            params.geofenceDistances.push_back({id, dist});
         }
     }
     
     // 解析 allSignals: { [geofenceId]: LearnedSignals }
-    std::unordered_map<std::string, LearnedSignals> allSignals;
     napi_value signalsObj;
-    if (napi_get_named_property(env, args[0], "allSignals", &signalsObj) == napi_ok) {
+    if (napi_get_named_property(env, obj, "allSignals", &signalsObj) == napi_ok) {
         napi_value keys;
         napi_get_property_names(env, signalsObj, &keys);
         uint32_t keysLen;
@@ -240,21 +249,26 @@ static napi_value CalculateAllConfidences(napi_env env, napi_callback_info info)
         for (uint32_t i = 0; i < keysLen; i++) {
             napi_value key;
             napi_get_element(env, keys, i, &key);
-            std::string gfId = GetStringProp(env, key, "");
+            std::string gfId = getStringArg(env, key);
             
             napi_value sigObj;
             napi_get_property(env, signalsObj, key, &sigObj);
             
-            allSignals[gfId] = parseLearnedSignals(env, sigObj);
+            params.allSignals[gfId] = parseLearnedSignals(env, sigObj);
         }
     }
     
-    // 计算
+    return params;
+}
+
+static std::vector<FusionResult> runAllConfidences(const AllConfidencesParams& params) {
+    NATIVE_METRICS_SCOPE("location_fusion.all_confidences");
     LocationFusion fusion;
-    auto results = fusion.calculateAllConfidences(geofenceDistances, gpsAccuracy,
-                                                  currentWifiSsid, currentBtDevices, allSignals);
-    
-    // 返回数组
+    return fusion.calculateAllConfidences(params.geofenceDistances, params.gpsAccuracy,
+                                          params.currentWifiSsid, params.currentBtDevices, params.allSignals);
+}
+
+static napi_value createFusionResultArray(napi_env env, const std::vector<FusionResult>& results) {
     napi_value resultArray;
     napi_create_array_with_length(env, results.size(), &resultArray);
     
@@ -277,6 +291,275 @@ static napi_value CalculateAllConfidences(napi_env env, napi_callback_info info)
     return resultArray;
 }
 
+/**
+ * locationFusion.calculateAllConfidences(params) → FusionResult[]
+ */
+static napi_value CalculateAllConfidences(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+    
+    if (argc < 1) {
+        napi_throw_error(env, nullptr, "Expected 1 argument: params");
+        return nullptr;
+    }
+    
+    auto params = parseAllConfidencesParams(env, args[0]);
+    return createFusionResultArray(env, runAllConfidences(params));
+}
+
+// ============================================================
+// Resident fusion index
+// ============================================================
+
+// 模块级常驻索引，只在 JS 线程访问
+static FusionIndex g_fusionIndex;
+
+static std::vector<std::string> parseStringArray(napi_env env, napi_value obj, const char* key) {
+    std::vector<std::string> out;
+    napi_value arr;
+    if (napi_get_named_property(env, obj, key, &arr) != napi_ok) return out;
+    uint32_t len = 0;
+    napi_get_array_length(env, arr, &len);
+    out.reserve(len);
+    for (uint32_t i = 0; i < len; i++) {
+        napi_value elem;
+        napi_get_element(env, arr, i, &elem);
+        out.push_back(getStringArg(env, elem));
+    }
+    return out;
+}
+
+static geo_utils::Geofence parseGeofence(napi_env env, napi_value obj) {
+    geo_utils::Geofence gf;
+    gf.id = GetStringProp(env, obj, "id", "");
+    gf.name = GetStringProp(env, obj, "name", "");
+    gf.latitude = GetDoubleProp(env, obj, "latitude", 0);
+    gf.longitude = GetDoubleProp(env, obj, "longitude", 0);
+    gf.radiusMeters = GetDoubleProp(env, obj, "radiusMeters", 100);
+    gf.category = GetStringProp(env, obj, "category", "");
+    return gf;
+}
+
+static std::vector<geo_utils::Geofence> parseGeofences(napi_env env, napi_value arr) {
+    NATIVE_METRICS_SCOPE("location_fusion.parse_geofences");
+    std::vector<geo_utils::Geofence> geofences;
+    uint32_t len = 0;
+    napi_get_array_length(env, arr, &len);
+    geofences.reserve(len);
+    for (uint32_t i = 0; i < len; i++) {
+        napi_value elem;
+        napi_get_element(env, arr, i, &elem);
+        geofences.push_back(parseGeofence(env, elem));
+    }
+    return geofences;
+}
+
+/**
+ * locationFusion.setFences(geofences) → number  整体替换索引中的围栏，返回围栏数
+ */
+static napi_value SetFences(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+    
+    if (argc < 1) {
+        napi_throw_error(env, nullptr, "Expected 1 argument: geofences");
+        return nullptr;
+    }
+    
+    g_fusionIndex.assignFences(parseGeofences(env, args[0]));
+    return CreateDouble(env, static_cast<double>(g_fusionIndex.fenceCount()));
+}
+
+/**
+ * locationFusion.upsertFence(geofence) → number  同 id 覆盖，返回围栏数
+ */
+static napi_value UpsertFence(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+    
+    if (argc < 1) {
+        napi_throw_error(env, nullptr, "Expected 1 argument: geofence");
+        return nullptr;
+    }
+    
+    g_fusionIndex.upsertFence(parseGeofence(env, args[0]));
+    return CreateDouble(env, static_cast<double>(g_fusionIndex.fenceCount()));
+}
+
+/**
+ * locationFusion.removeFence(id) → boolean  已学习信号保留，围栏重新加入后继续生效
+ */
+static napi_value RemoveFence(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+    
+    if (argc < 1) {
+        napi_throw_error(env, nullptr, "Expected 1 argument: id");
+        return nullptr;
+    }
+    
+    napi_value result;
+    napi_get_boolean(env, g_fusionIndex.removeFence(getStringArg(env, args[0])), &result);
+    return result;
+}
+
+/**
+ * locationFusion.setSignals(geofenceId, signals) → void  加载持久化的 LearnedSignals
+ */
+static napi_value SetSignals(napi_env env, napi_callback_info info) {
+    size_t argc = 2;
+    napi_value args[2];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+    
+    if (argc < 2) {
+        napi_throw_error(env, nullptr, "Expected 2 arguments: geofenceId, signals");
+        return nullptr;
+    }
+    
+    g_fusionIndex.setSignals(getStringArg(env, args[0]), parseLearnedSignals(env, args[1]));
+    return nullptr;
+}
+
+/**
+ * locationFusion.learnSignal(params) → void
+ *
+ * params: { geofenceId, currentWifiSsid, currentBtDevices[] }
+ */
+static napi_value LearnSignal(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+    
+    if (argc < 1) {
+        napi_throw_error(env, nullptr, "Expected 1 argument: params");
+        return nullptr;
+    }
+    
+    g_fusionIndex.learn(GetStringProp(env, args[0], "geofenceId", ""),
+                        GetStringProp(env, args[0], "currentWifiSsid", ""),
+                        parseStringArray(env, args[0], "currentBtDevices"));
+    return nullptr;
+}
+
+/**
+ * locationFusion.clearSignals(geofenceId?) → void  不传 id 时清空全部
+ */
+static napi_value ClearSignals(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+    
+    napi_valuetype type = napi_undefined;
+    if (argc >= 1) napi_typeof(env, args[0], &type);
+    if (type == napi_string) {
+        g_fusionIndex.clearSignals(getStringArg(env, args[0]));
+    } else {
+        g_fusionIndex.clearAllSignals();
+    }
+    return nullptr;
+}
+
+/**
+ * locationFusion.scan(params) → FusionResult[]
+ *
+ * params: { latitude?, longitude?, gpsAccuracy, currentWifiSsid, currentBtDevices[] }
+ * 只返回 GPS 附近或信号命中的围栏（置信度降序）；其余围栏置信度不超过 0.1
+ */
+static napi_value Scan(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+    
+    if (argc < 1) {
+        napi_throw_error(env, nullptr, "Expected 1 argument: params");
+        return nullptr;
+    }
+    
+    FusionScan in;
+    bool hasLat = false;
+    bool hasLon = false;
+    napi_has_named_property(env, args[0], "latitude", &hasLat);
+    napi_has_named_property(env, args[0], "longitude", &hasLon);
+    in.hasLocation = hasLat && hasLon;
+    in.latitude = GetDoubleProp(env, args[0], "latitude", 0);
+    in.longitude = GetDoubleProp(env, args[0], "longitude", 0);
+    in.gpsAccuracy = GetDoubleProp(env, args[0], "gpsAccuracy", 100);
+    in.currentWifiSsid = GetStringProp(env, args[0], "currentWifiSsid", "");
+    in.currentBtDevices = parseStringArray(env, args[0], "currentBtDevices");
+    
+    std::vector<FusionResult> results;
+    g_fusionIndex.scan(in, results);
+    return createFusionResultArray(env, results);
+}
+
+// ============================================================
+// Async variants
+// ============================================================
+
+static native_common::AsyncRunner g_async("location_fusion");
+
+/**
+ * locationFusion.calculateAllConfidencesAsync(params, taskId?) → Promise<FusionResult[]>
+ */
+static napi_value CalculateAllConfidencesAsync(napi_env env, napi_callback_info info) {
+    size_t argc = 2;
+    napi_value args[2];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+    
+    if (argc < 1) {
+        napi_throw_error(env, nullptr, "Expected 1-2 arguments: params, taskId?");
+        return nullptr;
+    }
+    
+    struct State {
+        AllConfidencesParams params;
+        std::vector<FusionResult> results;
+    };
+    auto state = std::make_shared<State>();
+    state->params = parseAllConfidencesParams(env, args[0]);
+    std::string taskId = argc >= 2 ? getStringArg(env, args[1]) : "";
+    
+    auto task = native_common::makeAsyncTask(
+        [state](native_common::AsyncTask&) { state->results = runAllConfidences(state->params); },
+        [state](napi_env e) { return createFusionResultArray(e, state->results); });
+    return g_async.submit(env, std::move(task), taskId);
+}
+
+/**
+ * locationFusion.cancelAsync(taskId) → boolean
+ */
+static napi_value CancelAsync(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+    
+    if (argc < 1) {
+        napi_throw_error(env, nullptr, "Expected 1 argument: taskId");
+        return nullptr;
+    }
+    napi_value result;
+    napi_get_boolean(env, g_async.cancel(env, getStringArg(env, args[0])), &result);
+    return result;
+}
+
+/**
+ * locationFusion.setAsyncConcurrency(n) → void
+ */
+static napi_value SetAsyncConcurrency(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+    
+    int32_t n = 0;
+    if (argc >= 1) napi_get_value_int32(env, args[0], &n);
+    g_async.setMaxConcurrent(n > 0 ? static_cast<size_t>(n) : 1);
+    return nullptr;
+}
+
 // ============================================================
 // Module registration
 // ============================================================
@@ -287,6 +570,17 @@ static napi_value Init(napi_env env, napi_value exports) {
     napi_property_descriptor desc[] = {
         {"calculateConfidence", nullptr, CalculateConfidence, nullptr, nullptr, nullptr, napi_default, nullptr},
         {"calculateAllConfidences", nullptr, CalculateAllConfidences, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"calculateAllConfidencesAsync", nullptr, CalculateAllConfidencesAsync, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"cancelAsync", nullptr, CancelAsync, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"setAsyncConcurrency", nullptr, SetAsyncConcurrency, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"setFences", nullptr, SetFences, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"upsertFence", nullptr, UpsertFence, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"removeFence", nullptr, RemoveFence, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"setSignals", nullptr, SetSignals, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"learnSignal", nullptr, LearnSignal, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"clearSignals", nullptr, ClearSignals, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"scan", nullptr, Scan, nullptr, nullptr, nullptr, napi_default, nullptr},
+        native_common::MetricsProperty("location_fusion"),
     };
     
     napi_define_properties(env, exports, sizeof(desc) / sizeof(desc[0]), desc);
@@ -0,0 +1,233 @@
+/**
+ * duty_cycle_scheduler.h — 自适应占空比调度
+ *
+ * SamplingStrategy 只按运动状态给出固定间隔；这里在它之上综合几路输入，算出每个传感器的下次唤醒时间：
+ *   1. 运动状态 → SensorIntervals 基础间隔
+ *   2. 规则真正引用的 key（RuleEngine::referencedKeys）→ 哪些传感器需要采样；
+ *      没有任何启用的规则引用位置类 key 时 GPS 完全不采样，WiFi 同理。
+ *      时序 key（event:type / sequence:a,b）按事件类型映射：geofence_* → GPS，wifi_* → WiFi，motion_* → 加速度计。
+ *      新地点发现不经过规则：placeDiscovery 打开时，即使没有规则引用位置，GPS 也按
+ *      PLACE_DISCOVERY_GPS_INTERVAL_MS 的最低频率采样（规则需要更密时取规则的间隔）
+ *   3. 这些 key 在 SensorDataTray 中的 age / TTL → 在数据过期前唤醒对应传感器
+ *   4. 到最近围栏边界的距离 → 离边界越近 GPS 越密，远离所有围栏时放宽到基础间隔的数倍
+ *
+ * 唤醒合并：取最早到期的传感器作为唤醒点，其余传感器若在各自的容差内也快到期，就提前到同一次唤醒一起采样。
+ * 只会提前、不会推迟，规则看到的数据不会比单独调度时更旧。
+ *
+ * 加速度计：订阅采样间隔取基础间隔；调度的是“把攒好的一批样本交给 MotionDetector”的时机，
+ * 每批 ACCEL_BATCH_SAMPLES 个样本，与 GPS / WiFi 一起合并唤醒。
+ */
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "sampling_strategy.h"
+
+namespace sampling_strategy {
+
+// ============================================================
+// 输入 / 输出
+// ============================================================
+
+enum class Sensor : uint8_t { GPS = 0, WIFI = 1, ACCEL = 2 };
+
+constexpr size_t SENSOR_COUNT = 3;
+
+inline const char* sensorName(Sensor s) {
+    switch (s) {
+        case Sensor::GPS: return "gps";
+        case Sensor::WIFI: return "wifi";
+        default: return "accel";
+    }
+}
+
+/** 规则依赖的一个托盘 key 的新鲜度（SensorDataTray::getStatus 的 ageMs / ttlMs） */
+struct KeyFreshness {
+    std::string key;
+    int64_t ageMs = -1;     // < 0 = 托盘里没有数据
+    int64_t ttlMs = 0;
+};
+
+struct SchedulerInputs {
+    int64_t nowMs = 0;
+    motion_detector::MotionState motion = motion_detector::MotionState::UNKNOWN;
+    std::vector<std::string> ruleKeys;        // 启用规则引用的 key
+    std::vector<KeyFreshness> freshness;      // 托盘中 key 的 age / TTL，可以包含规则不引用的 key
+    double fenceDistanceMeters = -1;          // 到最近围栏边界的距离，< 0 = 未知 / 没有围栏
+    double speedMps = -1;                     // GPS 速度，< 0 = 未知
+    bool gpsAvailable = true;                 // 没有定位权限时为 false
+    bool placeDiscovery = false;              // 新地点发现在运行：GPS 至少按 PLACE_DISCOVERY_GPS_INTERVAL_MS 采样
+};
+
+/** 单个传感器的调度结果 */
+struct SensorPlan {
+    bool enabled = false;
+    int64_t intervalMs = 0;   // 综合运动状态与围栏距离后的采样间隔
+    int64_t dueMs = 0;        // 单独调度时的到期时间
+    bool fire = false;        // 在本次唤醒（WakePlan::wakeAtMs）时采样
+};
+
+struct WakePlan {
+    int64_t wakeAtMs = 0;                       // 下次唤醒时间；没有启用的传感器时为 -1
+    std::array<SensorPlan, SENSOR_COUNT> sensors;
+    int64_t accelSampleIntervalNs = 0;          // 加速度计订阅间隔
+
+    const SensorPlan& operator[](Sensor s) const { return sensors[static_cast<size_t>(s)]; }
+};
+
+// ============================================================
+// 调度器
+// ============================================================
+
+class DutyCycleScheduler {
+public:
+    static constexpr int64_t MIN_GPS_INTERVAL_MS = 5 * 1000;
+    static constexpr int64_t MIN_WIFI_INTERVAL_MS = 15 * 1000;
+    static constexpr int64_t MIN_ACCEL_INTERVAL_MS = 1000;
+    static constexpr double MAX_GPS_STRETCH = 4.0;           // 远离围栏时 GPS 间隔最多放宽到基础间隔的倍数
+    static constexpr double BOUNDARY_SAMPLES = 2.0;          // 到达围栏边界前至少采样的次数
+    static constexpr int64_t ACCEL_BATCH_SAMPLES = 5;        // 与 MotionConfig::historySize 一致
+    static constexpr int64_t COALESCE_WINDOW_MS = 30 * 1000; // 提前合并的上限
+    static constexpr double COALESCE_FRACTION = 0.25;        // 提前量不超过该传感器间隔的 1/4
+    // 新地点发现的最低 GPS 频率：停留判定要求 5 分钟内漂移 < 100m，与静止状态的基础间隔相同
+    static constexpr int64_t PLACE_DISCOVERY_GPS_INTERVAL_MS = 5 * 60 * 1000;
+
+    /** key 由哪些传感器刷新（按 Sensor 位掩码）；不对应任何传感器返回 0 */
+    static uint8_t sensorsForKey(const std::string& key) {
+        const uint8_t gps = bit(Sensor::GPS), wifi = bit(Sensor::WIFI), accel = bit(Sensor::ACCEL);
+        if (key.rfind("event:", 0) == 0) return sensorsForEvent(key.substr(6));
+        if (key.rfind("sequence:", 0) == 0) {             // 两个事件都要能被观察到
+            size_t comma = key.find(',', 9);
+            if (comma == std::string::npos) return 0;
+            return sensorsForEvent(key.substr(9, comma - 9)) | sensorsForEvent(key.substr(comma + 1));
+        }
+        if (key == "geofence") return gps | wifi;          // 围栏判定融合 GPS 与 WiFi 信号
+        if (key == "latitude" || key == "longitude" || key == "gpsSpeed" || key == "locationAccuracy") return gps;
+        if (key.rfind("wifi", 0) == 0) return wifi;          // wifiSsid / wifiGeofence / wifiLost*
+        if (key == "motionState" || key == "stepCount") return accel;
+        return 0;
+    }
+
+    /** pushEvent 事件类型由哪个传感器的采样产生（ContextAwarenessService 里的 geofence_enter / wifi_lost_home / motion_walking ...） */
+    static uint8_t sensorsForEvent(const std::string& type) {
+        if (type.rfind("geofence_", 0) == 0) return bit(Sensor::GPS);
+        if (type.rfind("wifi_", 0) == 0) return bit(Sensor::WIFI);
+        if (type.rfind("motion_", 0) == 0) return bit(Sensor::ACCEL);
+        return 0;
+    }
+
+    /** 记录一次采样（传感器真正完成采样后调用） */
+    void markSampled(Sensor s, int64_t atMs) { lastSampleMs_[static_cast<size_t>(s)] = atMs; }
+
+    int64_t lastSampled(Sensor s) const { return lastSampleMs_[static_cast<size_t>(s)]; }
+
+    void reset() { lastSampleMs_.fill(-1); }
+
+    WakePlan plan(const SchedulerInputs& in) const {
+        SensorIntervals base = strategy_.getIntervalsForState(in.motion);
+        WakePlan out;
+        out.accelSampleIntervalNs = base.accelIntervalNs;
+
+        uint8_t needed = bit(Sensor::ACCEL);   // 运动状态驱动整个调度，加速度计始终开启
+        for (const auto& key : in.ruleKeys) needed |= sensorsForKey(key);
+
+        SensorPlan& gps = out.sensors[static_cast<size_t>(Sensor::GPS)];
+        bool gpsForRules = (needed & bit(Sensor::GPS)) != 0;
+        gps.enabled = in.gpsAvailable && (gpsForRules || in.placeDiscovery) && base.gpsIntervalMs > 0;
+        // 只为新地点发现采样时不按围栏距离放宽：远离所有围栏的地方正是新地点出现的地方
+        gps.intervalMs = gpsForRules ? gpsInterval(base.gpsIntervalMs, in)
+                                     : std::max(base.gpsIntervalMs, PLACE_DISCOVERY_GPS_INTERVAL_MS);
+
+        SensorPlan& wifi = out.sensors[static_cast<size_t>(Sensor::WIFI)];
+        wifi.enabled = (needed & bit(Sensor::WIFI)) && base.wifiIntervalMs > 0;
+        wifi.intervalMs = std::max(base.wifiIntervalMs, MIN_WIFI_INTERVAL_MS);
+
+        SensorPlan& accel = out.sensors[static_cast<size_t>(Sensor::ACCEL)];
+        accel.enabled = true;
+        accel.intervalMs = std::max(base.accelIntervalNs / 1000000 * ACCEL_BATCH_SAMPLES, MIN_ACCEL_INTERVAL_MS);
+
+        // 单独调度的到期时间
+        int64_t earliest = -1;
+        for (size_t i = 0; i < SENSOR_COUNT; i++) {
+            SensorPlan& p = out.sensors[i];
+            if (!p.enabled) continue;
+            p.dueMs = dueTime(static_cast<Sensor>(i), p.intervalMs, in);
+            if (earliest < 0 || p.dueMs < earliest) earliest = p.dueMs;
+        }
+        out.wakeAtMs = earliest;
+        if (earliest < 0) return out;
+
+        // 合并：容差内快到期的传感器提前到同一次唤醒
+        for (auto& p : out.sensors) {
+            if (!p.enabled) continue;
+            int64_t slack = std::min(COALESCE_WINDOW_MS,
+                                     static_cast<int64_t>(static_cast<double>(p.intervalMs) * COALESCE_FRACTION));
+            p.fire = p.dueMs <= earliest + slack;
+        }
+        return out;
+    }
+
+    const SamplingStrategy& strategy() const { return strategy_; }
+    SamplingStrategy& strategy() { return strategy_; }
+
+private:
+    static uint8_t bit(Sensor s) { return static_cast<uint8_t>(1u << static_cast<unsigned>(s)); }
+
+    /** 按运动状态的典型速度估计到达边界的时间（GPS 速度未知或偏小时用它兜底） */
+    static double typicalSpeed(motion_detector::MotionState state) {
+        switch (state) {
+            case motion_detector::MotionState::STATIONARY: return 0.5;
+            case motion_detector::MotionState::WALKING: return 1.4;
+            case motion_detector::MotionState::RUNNING: return 3.0;
+            case motion_detector::MotionState::DRIVING: return 15.0;
+            default: return 1.4;
+        }
+    }
+
+    /** 围栏距离已知时：在到达边界前采样 BOUNDARY_SAMPLES 次，限制在 [MIN_GPS_INTERVAL_MS, 基础间隔 × MAX_GPS_STRETCH] */
+    static int64_t gpsInterval(int64_t baseMs, const SchedulerInputs& in) {
+        if (baseMs <= 0) return 0;
+        if (in.fenceDistanceMeters < 0) return std::max(baseMs, MIN_GPS_INTERVAL_MS);
+        double speed = std::max(in.speedMps, typicalSpeed(in.motion));
+        double toBoundaryMs = in.fenceDistanceMeters / speed * 1000.0;
+        double interval = toBoundaryMs / BOUNDARY_SAMPLES;
+        double maxMs = static_cast<double>(baseMs) * MAX_GPS_STRETCH;
+        return static_cast<int64_t>(std::clamp(interval, static_cast<double>(MIN_GPS_INTERVAL_MS), maxMs));
+    }
+
+    static int64_t minInterval(Sensor s) {
+        switch (s) {
+            case Sensor::GPS: return MIN_GPS_INTERVAL_MS;
+            case Sensor::WIFI: return MIN_WIFI_INTERVAL_MS;
+            default: return MIN_ACCEL_INTERVAL_MS;
+        }
+    }
+
+    /**
+     * 上次采样 + 间隔；规则引用的 key 会更早过期时提前到过期时刻。
+     * 已经过期的 key 不再收紧（说明这次采样没有刷新它，再密也无济于事），托盘里没有的 key 也不参与。
+     * 从未采样过 → 立即。
+     */
+    int64_t dueTime(Sensor s, int64_t intervalMs, const SchedulerInputs& in) const {
+        int64_t last = lastSampleMs_[static_cast<size_t>(s)];
+        if (last < 0) return in.nowMs;
+
+        int64_t due = last + intervalMs;
+        for (const auto& f : in.freshness) {
+            if (f.ageMs < 0 || f.ageMs >= f.ttlMs) continue;
+            if (!(sensorsForKey(f.key) & bit(s))) continue;
+            if (std::find(in.ruleKeys.begin(), in.ruleKeys.end(), f.key) == in.ruleKeys.end()) continue;
+            due = std::min(due, in.nowMs + (f.ttlMs - f.ageMs));
+        }
+        due = std::max(due, last + minInterval(s));
+        return std::max(due, in.nowMs);
+    }
+
+    SamplingStrategy strategy_;
+    std::array<int64_t, SENSOR_COUNT> lastSampleMs_{{-1, -1, -1}};
+};
+
+}  // namespace sampling_strategy
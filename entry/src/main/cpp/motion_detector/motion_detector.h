@@ -3,12 +3,16 @@
  *
  * 基于加速度计和GPS速度检测运动状态
  * 支持检测：静止、步行、跑步、驾驶
+ *
+ * 逐样本 detect() 与整批 detectBatch() 共用 motion_features.h 的环形特征窗口，
+ * 窗口均值 O(1) 更新；detectBatch 一次处理传感器按原生采样率上报的整批样本。
  */
 #pragma once
 
 #include <string>
 #include <cmath>
-#include <vector>
+#include <cstdint>
+#include "motion_features.h"
 
 namespace motion_detector {
 
@@ -40,6 +44,7 @@ struct MotionResult {
     double gpsSpeed;       // GPS速度 (m/s)
     double confidence;     // 置信度 0-1
     bool stateChanged;
+    MotionFeatures features;  // 当前窗口特征
 };
 
 /** 配置参数 */
@@ -53,8 +58,11 @@ struct MotionConfig {
     double drivingSpeedThreshold = 5.0;   // > 此值为驾驶
     double highSpeedThreshold = 20.0;     // > 此值为高速驾驶
     
-    // 历史窗口大小
+    // 历史窗口大小（样本数）
     int historySize = 5;
+    
+    // 加速度计采样率 (Hz)，用于步态带通与步频；逐样本调用时默认 1 秒一次
+    double sampleRateHz = 1.0;
 };
 
 // ============================================================
@@ -63,10 +71,11 @@ struct MotionConfig {
 
 class MotionDetector {
 public:
-    MotionDetector() : lastState_(MotionState::UNKNOWN), config_() {}
+    MotionDetector() : MotionDetector(MotionConfig{}) {}
     
     explicit MotionDetector(const MotionConfig& config) 
-        : lastState_(MotionState::UNKNOWN), config_(config) {}
+        : lastState_(MotionState::UNKNOWN), config_(config),
+          window_(config.sampleRateHz, static_cast<size_t>(std::max(config.historySize, 1))) {}
     
     /**
      * 检测运动状态
@@ -75,30 +84,74 @@ public:
      * @return 检测结果
      */
     MotionResult detect(const AccelerometerData& accel, double gpsSpeed) {
-        MotionResult result;
-        result.gpsSpeed = gpsSpeed;
-        
         // 计算加速度幅度
-        result.magnitude = std::sqrt(
+        double magnitude = std::sqrt(
             accel.x * accel.x + 
             accel.y * accel.y + 
             accel.z * accel.z
         );
         
-        // 添加到历史记录
-        magnitudeHistory_.push_back(result.magnitude);
-        if (static_cast<int>(magnitudeHistory_.size()) > config_.historySize) {
-            magnitudeHistory_.erase(magnitudeHistory_.begin());
+        // 添加到历史窗口
+        window_.push(magnitude);
+        return decide(magnitude, gpsSpeed);
+    }
+    
+    /**
+     * 整批检测：样本按 config.sampleRateHz 连续采集
+     * @param packed 打包样本，每个 stride 个 double，前三个为 x, y, z
+     * @param count 样本数
+     * @param gpsSpeed GPS速度 (m/s)，如果没有传-1
+     * @return 整批推入后的检测结果（magnitude 为最后一个样本）
+     */
+    MotionResult detectBatch(const double* packed, size_t count, double gpsSpeed, size_t stride = 3) {
+        window_.pushBatch(packed, count, stride);
+        return decide(window_.magnitudes().back(), gpsSpeed);
+    }
+    
+    MotionFeatures features() const { return window_.features(); }
+    
+    const MotionConfig& config() const { return config_; }
+    
+    /**
+     * 获取运动状态名称
+     */
+    static std::string stateToString(MotionState state) {
+        switch (state) {
+            case MotionState::STATIONARY: return "stationary";
+            case MotionState::WALKING: return "walking";
+            case MotionState::RUNNING: return "running";
+            case MotionState::DRIVING: return "driving";
+            default: return "unknown";
         }
+    }
+    
+    /**
+     * 从字符串解析运动状态
+     */
+    static MotionState stringToState(const std::string& str) {
+        if (str == "stationary") return MotionState::STATIONARY;
+        if (str == "walking") return MotionState::WALKING;
+        if (str == "running") return MotionState::RUNNING;
+        if (str == "driving") return MotionState::DRIVING;
+        return MotionState::UNKNOWN;
+    }
+    
+    MotionState getLastState() const { return lastState_; }
+    
+    void reset() {
+        lastState_ = MotionState::UNKNOWN;
+        window_.reset();
+    }
+
+private:
+    MotionResult decide(double magnitude, double gpsSpeed) {
+        MotionResult result;
+        result.gpsSpeed = gpsSpeed;
+        result.magnitude = magnitude;
+        result.features = window_.features();
         
-        // 计算平均幅度
-        double avgMagnitude = 0;
-        if (!magnitudeHistory_.empty()) {
-            for (double m : magnitudeHistory_) {
-                avgMagnitude += m;
-            }
-            avgMagnitude /= magnitudeHistory_.size();
-        }
+        // 窗口平均幅度
+        double avgMagnitude = result.features.meanMagnitude;
         
         // 优先使用GPS速度判断（解决开车/高铁匀速问题）
         if (gpsSpeed >= 0) {
@@ -135,38 +188,6 @@ public:
         return result;
     }
     
-    /**
-     * 获取运动状态名称
-     */
-    static std::string stateToString(MotionState state) {
-        switch (state) {
-            case MotionState::STATIONARY: return "stationary";
-            case MotionState::WALKING: return "walking";
-            case MotionState::RUNNING: return "running";
-            case MotionState::DRIVING: return "driving";
-            default: return "unknown";
-        }
-    }
-    
-    /**
-     * 从字符串解析运动状态
-     */
-    static MotionState stringToState(const std::string& str) {
-        if (str == "stationary") return MotionState::STATIONARY;
-        if (str == "walking") return MotionState::WALKING;
-        if (str == "running") return MotionState::RUNNING;
-        if (str == "driving") return MotionState::DRIVING;
-        return MotionState::UNKNOWN;
-    }
-    
-    MotionState getLastState() const { return lastState_; }
-    
-    void reset() {
-        lastState_ = MotionState::UNKNOWN;
-        magnitudeHistory_.clear();
-    }
-
-private:
     MotionState detectFromAcceleration(double magnitude) {
         if (magnitude < config_.stationaryThreshold) {
             return MotionState::STATIONARY;
@@ -181,7 +202,7 @@ private:
     
     MotionState lastState_;
     MotionConfig config_;
-    std::vector<double> magnitudeHistory_;
+    MotionFeatureWindow window_;
 };
 
 }  // namespace motion_detector
@@ -0,0 +1,377 @@
+/**
+ * motion_detector_napi.cpp — 运动状态检测 NAPI 绑定
+ *
+ * 加速度计样本在 JS 侧按原生采样率攒成一批，以 Float64Array 打包 [x0, y0, z0, x1, ...]
+ * 一次交给 pushBatch，不再每个样本跨一次 NAPI 边界。
+ * planWakeups 用 duty_cycle_scheduler.h 合并 GPS / WiFi / 加速度计的唤醒。
+ */
+#include <napi/native_api.h>
+#include "motion_detector.h"
+#include "duty_cycle_scheduler.h"
+#include "common/napi_typed_array.h"
+#include "common/metrics_napi.h"
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace motion_detector;
+using sampling_strategy::DutyCycleScheduler;
+using sampling_strategy::KeyFreshness;
+using sampling_strategy::SchedulerInputs;
+using sampling_strategy::Sensor;
+using sampling_strategy::SensorPlan;
+using sampling_strategy::WakePlan;
+
+// 模块级常驻检测器，只在 JS 线程访问；configure 时按新采样率重建
+static std::unique_ptr<MotionDetector> g_detector;
+
+static MotionDetector& Detector() {
+    if (!g_detector) g_detector.reset(new MotionDetector());
+    return *g_detector;
+}
+
+// 占空比调度器：记录各传感器上次采样时间
+static DutyCycleScheduler g_scheduler;
+
+// ============================================================
+// Helper functions
+// ============================================================
+
+static bool IsObject(napi_env env, napi_value value) {
+    napi_valuetype type = napi_undefined;
+    napi_typeof(env, value, &type);
+    return type == napi_object;
+}
+
+static double GetDoubleProp(napi_env env, napi_value obj, const char* key, double defaultVal = 0.0) {
+    napi_value prop;
+    napi_status status = napi_get_named_property(env, obj, key, &prop);
+    if (status != napi_ok) return defaultVal;
+
+    double val;
+    status = napi_get_value_double(env, prop, &val);
+    return (status == napi_ok) ? val : defaultVal;
+}
+
+static double GetDoubleArg(napi_env env, napi_value value, double defaultVal) {
+    double val;
+    return napi_get_value_double(env, value, &val) == napi_ok ? val : defaultVal;
+}
+
+static std::string GetStringValue(napi_env env, napi_value val) {
+    size_t len = 0;
+    if (napi_get_value_string_utf8(env, val, nullptr, 0, &len) != napi_ok) return "";
+    std::string result(len, '\0');
+    napi_get_value_string_utf8(env, val, &result[0], len + 1, &len);
+    return result;
+}
+
+static std::string GetStringProp(napi_env env, napi_value obj, const char* key, const std::string& defaultVal = "") {
+    napi_value prop;
+    if (napi_get_named_property(env, obj, key, &prop) != napi_ok) return defaultVal;
+    napi_valuetype type = napi_undefined;
+    napi_typeof(env, prop, &type);
+    return type == napi_string ? GetStringValue(env, prop) : defaultVal;
+}
+
+/** 读取数组属性的每个元素；缺失或不是数组时不调用 fn */
+template <typename F>
+static void ForEachElement(napi_env env, napi_value obj, const char* key, F&& fn) {
+    napi_value arr;
+    bool isArray = false;
+    if (napi_get_named_property(env, obj, key, &arr) != napi_ok) return;
+    if (napi_is_array(env, arr, &isArray) != napi_ok || !isArray) return;
+    uint32_t len = 0;
+    napi_get_array_length(env, arr, &len);
+    for (uint32_t i = 0; i < len; i++) {
+        napi_value elem;
+        if (napi_get_element(env, arr, i, &elem) == napi_ok) fn(elem);
+    }
+}
+
+static bool ParseSensor(const std::string& name, Sensor& out) {
+    if (name == "gps") out = Sensor::GPS;
+    else if (name == "wifi") out = Sensor::WIFI;
+    else if (name == "accel") out = Sensor::ACCEL;
+    else return false;
+    return true;
+}
+
+static int64_t NowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static napi_value CreateString(napi_env env, const std::string& str) {
+    napi_value result;
+    napi_create_string_utf8(env, str.c_str(), str.length(), &result);
+    return result;
+}
+
+static napi_value CreateDouble(napi_env env, double val) {
+    napi_value result;
+    napi_create_double(env, val, &result);
+    return result;
+}
+
+static napi_value CreateBool(napi_env env, bool val) {
+    napi_value result;
+    napi_get_boolean(env, val, &result);
+    return result;
+}
+
+static napi_value FeaturesToJs(napi_env env, const MotionFeatures& f) {
+    napi_value obj;
+    napi_create_object(env, &obj);
+    napi_set_named_property(env, obj, "samples", CreateDouble(env, static_cast<double>(f.samples)));
+    napi_set_named_property(env, obj, "windowSeconds", CreateDouble(env, f.windowSeconds));
+    napi_set_named_property(env, obj, "meanMagnitude", CreateDouble(env, f.meanMagnitude));
+    napi_set_named_property(env, obj, "variance", CreateDouble(env, f.variance));
+    napi_set_named_property(env, obj, "bandEnergy", CreateDouble(env, f.bandEnergy));
+    napi_set_named_property(env, obj, "steps", CreateDouble(env, f.steps));
+    napi_set_named_property(env, obj, "cadence", CreateDouble(env, f.cadence));
+    return obj;
+}
+
+static napi_value ResultToJs(napi_env env, const MotionResult& r) {
+    napi_value obj;
+    napi_create_object(env, &obj);
+    napi_set_named_property(env, obj, "state", CreateString(env, MotionDetector::stateToString(r.state)));
+    napi_set_named_property(env, obj, "magnitude", CreateDouble(env, r.magnitude));
+    napi_set_named_property(env, obj, "gpsSpeed", CreateDouble(env, r.gpsSpeed));
+    napi_set_named_property(env, obj, "confidence", CreateDouble(env, r.confidence));
+    napi_set_named_property(env, obj, "stateChanged", CreateBool(env, r.stateChanged));
+    napi_set_named_property(env, obj, "features", FeaturesToJs(env, r.features));
+    return obj;
+}
+
+static napi_value SensorPlanToJs(napi_env env, const SensorPlan& p) {
+    napi_value obj;
+    napi_create_object(env, &obj);
+    napi_set_named_property(env, obj, "enabled", CreateBool(env, p.enabled));
+    napi_set_named_property(env, obj, "intervalMs", CreateDouble(env, static_cast<double>(p.intervalMs)));
+    napi_set_named_property(env, obj, "dueMs", CreateDouble(env, static_cast<double>(p.dueMs)));
+    napi_set_named_property(env, obj, "fire", CreateBool(env, p.fire));
+    return obj;
+}
+
+// ============================================================
+// NAPI functions
+// ============================================================
+
+/**
+ * motionDetector.configure({ sampleRateHz, windowSeconds?, stationaryThreshold?, ... }) → void
+ * 重建检测器（清空窗口）；窗口样本数 = round(sampleRateHz * windowSeconds)，至少 1
+ */
+static napi_value Configure(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+
+    MotionConfig config;
+    if (argc >= 1 && IsObject(env, args[0])) {
+        napi_value obj = args[0];
+        config.stationaryThreshold = GetDoubleProp(env, obj, "stationaryThreshold", config.stationaryThreshold);
+        config.walkingThreshold = GetDoubleProp(env, obj, "walkingThreshold", config.walkingThreshold);
+        config.runningThreshold = GetDoubleProp(env, obj, "runningThreshold", config.runningThreshold);
+        config.drivingSpeedThreshold = GetDoubleProp(env, obj, "drivingSpeedThreshold", config.drivingSpeedThreshold);
+        config.highSpeedThreshold = GetDoubleProp(env, obj, "highSpeedThreshold", config.highSpeedThreshold);
+
+        double rate = GetDoubleProp(env, obj, "sampleRateHz", config.sampleRateHz);
+        if (rate > 0) config.sampleRateHz = rate;
+        double windowSeconds = GetDoubleProp(env, obj, "windowSeconds",
+            config.historySize / config.sampleRateHz);
+        double samples = std::round(config.sampleRateHz * windowSeconds);
+        config.historySize = samples >= 1 ? static_cast<int>(samples) : 1;
+    }
+    g_detector.reset(new MotionDetector(config));
+    return nullptr;
+}
+
+/**
+ * motionDetector.detect({ x, y, z }, gpsSpeed?) → MotionResult  单个样本
+ */
+static napi_value Detect(napi_env env, napi_callback_info info) {
+    size_t argc = 2;
+    napi_value args[2];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+    if (argc < 1 || !IsObject(env, args[0])) {
+        napi_throw_type_error(env, nullptr, "detect requires {x, y, z}");
+        return nullptr;
+    }
+
+    AccelerometerData accel;
+    accel.x = GetDoubleProp(env, args[0], "x");
+    accel.y = GetDoubleProp(env, args[0], "y");
+    accel.z = GetDoubleProp(env, args[0], "z");
+    accel.timestamp = static_cast<int64_t>(GetDoubleProp(env, args[0], "timestamp"));
+    double gpsSpeed = argc >= 2 ? GetDoubleArg(env, args[1], -1) : -1;
+
+    return ResultToJs(env, Detector().detect(accel, gpsSpeed));
+}
+
+/**
+ * motionDetector.pushBatch(samples: Float64Array, gpsSpeed?, stride?) → MotionResult | null
+ * samples 按 stride（默认 3）打包 x, y, z；空批返回 null
+ */
+static napi_value PushBatch(napi_env env, napi_callback_info info) {
+    size_t argc = 3;
+    napi_value args[3];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+
+    native_common::Float64View view;
+    if (argc < 1 || !native_common::GetFloat64View(env, args[0], view)) {
+        napi_throw_type_error(env, nullptr, "pushBatch requires a Float64Array");
+        return nullptr;
+    }
+    double gpsSpeed = argc >= 2 ? GetDoubleArg(env, args[1], -1) : -1;
+    double strideArg = argc >= 3 ? GetDoubleArg(env, args[2], 3) : 3;
+    size_t stride = strideArg >= 3 ? static_cast<size_t>(strideArg) : 3;
+
+    size_t count = view.length / stride;
+    if (count == 0) {
+        napi_value nullValue;
+        napi_get_null(env, &nullValue);
+        return nullValue;
+    }
+    return ResultToJs(env, Detector().detectBatch(view.data, count, gpsSpeed, stride));
+}
+
+/**
+ * motionDetector.getFeatures() → MotionFeatures  当前窗口特征
+ */
+static napi_value GetFeatures(napi_env env, napi_callback_info info) {
+    return FeaturesToJs(env, Detector().features());
+}
+
+/**
+ * motionDetector.getState() → string
+ */
+static napi_value GetState(napi_env env, napi_callback_info info) {
+    return CreateString(env, MotionDetector::stateToString(Detector().getLastState()));
+}
+
+/**
+ * motionDetector.reset() → void  清空窗口，保留配置
+ */
+static napi_value Reset(napi_env env, napi_callback_info info) {
+    Detector().reset();
+    return nullptr;
+}
+
+/**
+ * motionDetector.planWakeups({
+ *   nowMs?, motionState, ruleKeys: string[], freshness: [{ key, ageMs, ttlMs }],
+ *   fenceDistanceMeters?, speedMps?, gpsAvailable?, placeDiscovery?, sampled?: string[]
+ * }) → { wakeAtMs, wakeInMs, accelIntervalNs, gps, wifi, accel }
+ * sampled 为刚在 nowMs 完成采样的传感器（"gps" / "wifi" / "accel"），先记录再规划下一次唤醒
+ * placeDiscovery（缺省 false）：没有规则引用位置时 GPS 仍按新地点发现的最低频率采样
+ */
+static napi_value PlanWakeups(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+    if (argc < 1 || !IsObject(env, args[0])) {
+        napi_throw_type_error(env, nullptr, "planWakeups requires an inputs object");
+        return nullptr;
+    }
+    napi_value obj = args[0];
+
+    SchedulerInputs in;
+    double now = GetDoubleProp(env, obj, "nowMs", -1);
+    in.nowMs = now >= 0 ? static_cast<int64_t>(now) : NowMs();
+    in.motion = MotionDetector::stringToState(GetStringProp(env, obj, "motionState", "unknown"));
+    in.fenceDistanceMeters = GetDoubleProp(env, obj, "fenceDistanceMeters", -1);
+    in.speedMps = GetDoubleProp(env, obj, "speedMps", -1);
+    napi_value gpsAvailable;
+    bool flag = true;
+    if (napi_get_named_property(env, obj, "gpsAvailable", &gpsAvailable) == napi_ok &&
+        napi_get_value_bool(env, gpsAvailable, &flag) == napi_ok) {
+        in.gpsAvailable = flag;
+    }
+    napi_value placeDiscovery;
+    flag = false;
+    if (napi_get_named_property(env, obj, "placeDiscovery", &placeDiscovery) == napi_ok &&
+        napi_get_value_bool(env, placeDiscovery, &flag) == napi_ok) {
+        in.placeDiscovery = flag;
+    }
+    ForEachElement(env, obj, "ruleKeys", [&](napi_value elem) {
+        in.ruleKeys.push_back(GetStringValue(env, elem));
+    });
+    ForEachElement(env, obj, "freshness", [&](napi_value elem) {
+        if (!IsObject(env, elem)) return;
+        KeyFreshness f;
+        f.key = GetStringProp(env, elem, "key");
+        f.ageMs = static_cast<int64_t>(GetDoubleProp(env, elem, "ageMs", -1));
+        f.ttlMs = static_cast<int64_t>(GetDoubleProp(env, elem, "ttlMs", 0));
+        in.freshness.push_back(std::move(f));
+    });
+    ForEachElement(env, obj, "sampled", [&](napi_value elem) {
+        Sensor s;
+        if (ParseSensor(GetStringValue(env, elem), s)) g_scheduler.markSampled(s, in.nowMs);
+    });
+
+    WakePlan plan = g_scheduler.plan(in);
+
+    napi_value result;
+    napi_create_object(env, &result);
+    napi_set_named_property(env, result, "wakeAtMs", CreateDouble(env, static_cast<double>(plan.wakeAtMs)));
+    napi_set_named_property(env, result, "wakeInMs",
+        CreateDouble(env, plan.wakeAtMs < 0 ? -1.0 : static_cast<double>(plan.wakeAtMs - in.nowMs)));
+    napi_set_named_property(env, result, "accelIntervalNs",
+        CreateDouble(env, static_cast<double>(plan.accelSampleIntervalNs)));
+    for (Sensor s : {Sensor::GPS, Sensor::WIFI, Sensor::ACCEL}) {
+        napi_set_named_property(env, result, sampling_strategy::sensorName(s), SensorPlanToJs(env, plan[s]));
+    }
+    return result;
+}
+
+/**
+ * motionDetector.resetScheduler() → void  忘记各传感器的上次采样时间（下次规划全部立即到期）
+ */
+static napi_value ResetScheduler(napi_env env, napi_callback_info info) {
+    g_scheduler.reset();
+    return nullptr;
+}
+
+// ============================================================
+// Module registration
+// ============================================================
+
+EXTERN_C_START
+
+static napi_value Init(napi_env env, napi_value exports) {
+    napi_property_descriptor desc[] = {
+        {"configure", nullptr, Configure, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"detect", nullptr, Detect, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"pushBatch", nullptr, PushBatch, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"getFeatures", nullptr, GetFeatures, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"getState", nullptr, GetState, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"reset", nullptr, Reset, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"planWakeups", nullptr, PlanWakeups, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"resetScheduler", nullptr, ResetScheduler, nullptr, nullptr, nullptr, napi_default, nullptr},
+        native_common::MetricsProperty("motion_detector"),
+    };
+
+    napi_define_properties(env, exports, sizeof(desc) / sizeof(desc[0]), desc);
+    return exports;
+}
+
+static napi_module motion_detector_module = {
+    .nm_version = 1,
+    .nm_flags = NAPI_MODULE_VERSION,
+    .nm_filename = nullptr,
+    .nm_register_func = Init,
+    .nm_modname = "motion_detector",
+    .nm_priv = nullptr,
+    .reserved = {0},
+};
+
+
+EXTERN_C_END
+
+extern "C" __attribute__((constructor)) void RegisterMotionDetectorModule(void) {
+    napi_module_register(&motion_detector_module);
+}
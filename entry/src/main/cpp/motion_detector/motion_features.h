@@ -0,0 +1,277 @@
+/**
+ * motion_features.h — 加速度计流式特征窗口
+ *
+ * 传感器按原生采样率批量上报（一次几十到几百个样本），这里一次处理整批：
+ *   1. 先对整批打包的 x, y, z 算幅度（一遍连续循环，可被编译器向量化）
+ *   2. 再逐样本推入固定容量的环形缓冲，窗口均值 / 方差用运行和 O(1) 更新，
+ *      不再 erase(begin()) + 每个样本重算全窗口
+ *   3. 同一遍里做步态带通滤波（约 0.7 – 3.5 Hz 的二阶 IIR）：带内能量与步频同样用运行和维护
+ *
+ * 特征：窗口均值 / 方差、步态频带能量、窗口内步数与步频（步 / 分钟）。
+ * 采样率低于 MIN_BAND_RATE_HZ 时带通无意义，带内能量与步频恒为 0。
+ */
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace motion_detector {
+
+// ============================================================
+// 固定容量环形窗口
+// ============================================================
+
+/**
+ * 最近 capacity 个值的运行均值 / 方差
+ *
+ * 运行和以窗口首个值为偏移累加，避免幅度约 9.8 时 sumSq / n - mean² 的相消误差；
+ * 每淘汰 RESUM_PERIOD 轮窗口重新求和一次，消除加减累积的舍入漂移。
+ */
+class RunningWindow {
+public:
+    explicit RunningWindow(size_t capacity) : buf_(std::max<size_t>(capacity, 1)) {}
+
+    void push(double v) {
+        if (count_ == 0) shift_ = v;
+        double d = v - shift_;
+        bool evict = count_ == buf_.size();
+        if (evict) {
+            double old = buf_[head_];
+            sum_ -= old;
+            sumSq_ -= old * old;
+        } else {
+            count_++;
+        }
+        buf_[head_] = d;
+        sum_ += d;
+        sumSq_ += d * d;
+        head_ = head_ + 1 == buf_.size() ? 0 : head_ + 1;
+        if (evict && ++evictions_ >= buf_.size() * RESUM_PERIOD) resum();
+    }
+
+    size_t size() const { return count_; }
+    size_t capacity() const { return buf_.size(); }
+    bool full() const { return count_ == buf_.size(); }
+
+    double sum() const { return sum_ + shift_ * static_cast<double>(count_); }
+
+    double mean() const { return count_ == 0 ? 0.0 : shift_ + sum_ / static_cast<double>(count_); }
+
+    /** 总体方差 */
+    double variance() const {
+        if (count_ == 0) return 0.0;
+        double n = static_cast<double>(count_);
+        double m = sum_ / n;
+        return std::max(sumSq_ / n - m * m, 0.0);
+    }
+
+    /** 均方值 E[v²] */
+    double meanSquare() const {
+        double m = mean();
+        return variance() + m * m;
+    }
+
+    /** 最新的值；窗口为空时返回 0 */
+    double back() const {
+        if (count_ == 0) return 0.0;
+        return buf_[head_ == 0 ? buf_.size() - 1 : head_ - 1] + shift_;
+    }
+
+    /** 从旧到新遍历 */
+    template <typename F>
+    void forEach(F&& fn) const {
+        size_t start = (head_ + buf_.size() - count_) % buf_.size();
+        for (size_t i = 0; i < count_; i++) {
+            size_t at = start + i;
+            if (at >= buf_.size()) at -= buf_.size();
+            fn(buf_[at] + shift_);
+        }
+    }
+
+    void clear() {
+        head_ = 0;
+        count_ = 0;
+        sum_ = 0;
+        sumSq_ = 0;
+        shift_ = 0;
+        evictions_ = 0;
+    }
+
+private:
+    static constexpr size_t RESUM_PERIOD = 64;
+
+    void resum() {
+        sum_ = 0;
+        sumSq_ = 0;
+        for (size_t i = 0; i < count_; i++) {
+            sum_ += buf_[i];
+            sumSq_ += buf_[i] * buf_[i];
+        }
+        evictions_ = 0;
+    }
+
+    std::vector<double> buf_;
+    size_t head_ = 0;
+    size_t count_ = 0;
+    double shift_ = 0;
+    double sum_ = 0;
+    double sumSq_ = 0;
+    size_t evictions_ = 0;
+};
+
+// ============================================================
+// 步态带通滤波
+// ============================================================
+
+/** 二阶带通（RBJ cookbook，峰值增益 0 dB），直接 II 型转置 */
+class BandPassFilter {
+public:
+    BandPassFilter() = default;
+
+    BandPassFilter(double sampleRateHz, double centerHz, double q) {
+        const double pi = 3.14159265358979323846;
+        double w0 = 2.0 * pi * centerHz / sampleRateHz;
+        double alpha = std::sin(w0) / (2.0 * q);
+        double a0 = 1.0 + alpha;
+        b0_ = alpha / a0;
+        b2_ = -alpha / a0;
+        a1_ = -2.0 * std::cos(w0) / a0;
+        a2_ = (1.0 - alpha) / a0;
+    }
+
+    double step(double x) {
+        double y = b0_ * x + z1_;
+        z1_ = -a1_ * y + z2_;
+        z2_ = b2_ * x - a2_ * y;
+        return y;
+    }
+
+    /** 把状态置为输入恒为 x 时的稳态（输出 0），避免首个样本的重力阶跃被当成步子 */
+    void prime(double x) {
+        z1_ = b2_ * x;
+        z2_ = b2_ * x;
+    }
+
+    void reset() {
+        z1_ = 0;
+        z2_ = 0;
+    }
+
+private:
+    double b0_ = 0, b2_ = 0, a1_ = 0, a2_ = 0;
+    double z1_ = 0, z2_ = 0;
+};
+
+// ============================================================
+// 特征窗口
+// ============================================================
+
+/** 窗口特征 */
+struct MotionFeatures {
+    size_t samples = 0;          // 窗口内样本数
+    double windowSeconds = 0;    // 窗口覆盖时长
+    double meanMagnitude = 0;    // 幅度均值 (m/s²)
+    double variance = 0;         // 幅度方差
+    double bandEnergy = 0;       // 步态频带均方值 (m/s²)²
+    int steps = 0;               // 窗口内步数
+    double cadence = 0;          // 步频（步 / 分钟）
+};
+
+class MotionFeatureWindow {
+public:
+    static constexpr double MIN_BAND_RATE_HZ = 8.0;
+    static constexpr double GAIT_CENTER_HZ = 1.6;
+    static constexpr double GAIT_Q = 0.6;
+    static constexpr double STEP_THRESHOLD = 0.6;    // 带通后幅度超过 ±0.6 m/s² 计一步（迟滞）
+    static constexpr double MIN_STEP_SECONDS = 0.25;  // 步间隔下限，对应 240 步 / 分钟
+
+    MotionFeatureWindow(double sampleRateHz, size_t windowSamples)
+        : rate_(sampleRateHz > 0 ? sampleRateHz : 1.0),
+          magnitudes_(windowSamples),
+          band_(windowSamples),
+          stepFlags_(windowSamples),
+          bandEnabled_(rate_ >= MIN_BAND_RATE_HZ),
+          minStepSamples_(static_cast<int64_t>(std::ceil(MIN_STEP_SECONDS * rate_))) {
+        if (bandEnabled_) filter_ = BandPassFilter(rate_, GAIT_CENTER_HZ, GAIT_Q);
+    }
+
+    /** 推入一个幅度样本 */
+    void push(double magnitude) {
+        magnitudes_.push(magnitude);
+        if (!bandEnabled_) return;
+
+        // 去掉重力：带通对直流增益为 0，直接对幅度滤波即可
+        if (band_.size() == 0) filter_.prime(magnitude);
+        double y = filter_.step(magnitude);
+        band_.push(y);
+
+        bool step = false;
+        sinceStep_++;
+        if (y < -STEP_THRESHOLD) {
+            armed_ = true;
+        } else if (armed_ && y > STEP_THRESHOLD && sinceStep_ >= minStepSamples_) {
+            step = true;
+            armed_ = false;
+            sinceStep_ = 0;
+        }
+        stepFlags_.push(step ? 1.0 : 0.0);
+    }
+
+    /**
+     * 推入一批打包样本：每个样本 stride 个 double，前三个为 x, y, z
+     */
+    void pushBatch(const double* packed, size_t count, size_t stride = 3) {
+        if (stride < 3) stride = 3;
+        scratch_.resize(count);
+        double* out = scratch_.data();
+        for (size_t i = 0; i < count; i++) {
+            const double* s = packed + i * stride;
+            out[i] = std::sqrt(s[0] * s[0] + s[1] * s[1] + s[2] * s[2]);
+        }
+        for (size_t i = 0; i < count; i++) push(out[i]);
+    }
+
+    MotionFeatures features() const {
+        MotionFeatures f;
+        f.samples = magnitudes_.size();
+        f.windowSeconds = static_cast<double>(f.samples) / rate_;
+        f.meanMagnitude = magnitudes_.mean();
+        f.variance = magnitudes_.variance();
+        if (bandEnabled_) {
+            f.bandEnergy = band_.meanSquare();
+            f.steps = static_cast<int>(std::lround(stepFlags_.sum()));
+            f.cadence = f.windowSeconds > 0 ? f.steps * 60.0 / f.windowSeconds : 0.0;
+        }
+        return f;
+    }
+
+    const RunningWindow& magnitudes() const { return magnitudes_; }
+    double sampleRate() const { return rate_; }
+    bool bandEnabled() const { return bandEnabled_; }
+
+    void reset() {
+        magnitudes_.clear();
+        band_.clear();
+        stepFlags_.clear();
+        filter_.reset();
+        armed_ = false;
+        sinceStep_ = 0;
+    }
+
+private:
+    double rate_;
+    RunningWindow magnitudes_;
+    RunningWindow band_;
+    RunningWindow stepFlags_;
+    BandPassFilter filter_;
+    bool bandEnabled_;
+    int64_t minStepSamples_;
+    bool armed_ = false;
+    int64_t sinceStep_ = 0;
+    std::vector<double> scratch_;
+};
+
+}  // namespace motion_detector
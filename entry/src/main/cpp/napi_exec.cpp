@@ -1,94 +1,416 @@
 /**
  * Native module for executing shell commands on HarmonyOS NEXT.
- * Uses popen() to run commands and capture stdout/stderr.
+ *
+ * Commands are started with posix_spawn() (common/child_process.h) and read through pipes:
+ *   - execAsync() runs the pipe loop on its own worker thread and returns a Promise. stdout / stderr
+ *     chunks are streamed to an optional callback through a threadsafe function; without a
+ *     callback the output is collected (capped) into the result. Supports timeouts, kill and cancel.
+ *   - execCmd() is the synchronous convenience wrapper: same spawn path on the JS thread,
+ *     stderr merged into stdout, output capped at 64KB.
  */
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <memory>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <napi/native_api.h>
+#include "common/child_process.h"
+#include "common/metrics_napi.h"
+
+using native_common::ChildProcess;
+using native_common::ExitStatus;
+using native_common::OutputStream;
+using native_common::SpawnOptions;
 
 // Max output size: 64KB
 static constexpr size_t MAX_OUTPUT = 65536;
 
+// Chunks waiting for the JS callback; a full queue blocks the reader thread (and so the child)
+static constexpr size_t CHUNK_QUEUE_SIZE = 16;
+
+// ============================================================
+// Helpers
+// ============================================================
+
+static std::string GetStringValue(napi_env env, napi_value val) {
+    size_t len = 0;
+    if (napi_get_value_string_utf8(env, val, nullptr, 0, &len) != napi_ok) return "";
+    std::string result(len, '\0');
+    napi_get_value_string_utf8(env, val, &result[0], len + 1, &len);
+    return result;
+}
+
+static bool IsType(napi_env env, napi_value val, napi_valuetype expected) {
+    napi_valuetype type = napi_undefined;
+    napi_typeof(env, val, &type);
+    return type == expected;
+}
+
+static bool GetNamed(napi_env env, napi_value obj, const char* key, napi_valuetype type, napi_value* out) {
+    bool has = false;
+    if (napi_has_named_property(env, obj, key, &has) != napi_ok || !has) return false;
+    if (napi_get_named_property(env, obj, key, out) != napi_ok) return false;
+    return IsType(env, *out, type);
+}
+
+static napi_value CreateString(napi_env env, const std::string& str) {
+    napi_value result;
+    napi_create_string_utf8(env, str.c_str(), str.size(), &result);
+    return result;
+}
+
+static napi_value CreateInt(napi_env env, int64_t val) {
+    napi_value result;
+    napi_create_int64(env, val, &result);
+    return result;
+}
+
+static napi_value CreateBool(napi_env env, bool val) {
+    napi_value result;
+    napi_get_boolean(env, val, &result);
+    return result;
+}
+
+/** Length of the longest prefix that does not end inside a UTF-8 sequence */
+static size_t Utf8CompleteLength(const std::string& s) {
+    size_t n = s.size();
+    size_t i = n;
+    // Walk back over at most 3 continuation bytes to the lead byte
+    while (i > 0 && n - i < 4 && (static_cast<unsigned char>(s[i - 1]) & 0xC0) == 0x80) i--;
+    if (i == 0) return n;
+    unsigned char lead = static_cast<unsigned char>(s[i - 1]);
+    size_t need = lead >= 0xF0 ? 4 : lead >= 0xE0 ? 3 : lead >= 0xC0 ? 2 : 1;
+    return n - (i - 1) < need ? i - 1 : n;
+}
+
+static void RejectWithCode(napi_env env, napi_deferred deferred, const char* code, const std::string& msg) {
+    napi_value codeVal, message, error;
+    napi_create_string_utf8(env, code, NAPI_AUTO_LENGTH, &codeVal);
+    napi_create_string_utf8(env, msg.c_str(), msg.size(), &message);
+    napi_create_error(env, codeVal, message, &error);
+    napi_reject_deferred(env, deferred, error);
+}
+
+static napi_value ExecResultObject(napi_env env, const std::string& out, const std::string& err, int exitCode) {
+    napi_value result;
+    napi_create_object(env, &result);
+    napi_set_named_property(env, result, "stdout", CreateString(env, out));
+    napi_set_named_property(env, result, "stderr", CreateString(env, err));
+    napi_set_named_property(env, result, "exitCode", CreateInt(env, exitCode));
+    return result;
+}
+
+/** Command duration and timeout / cancel counts for getMetrics() */
+static void RecordExit(const ExitStatus& status) {
+    NATIVE_METRICS_RECORD("exec.duration", status.durationMs * 1e6);
+    if (status.timedOut) NATIVE_METRICS_COUNT("exec.timeouts", 1);
+    if (status.cancelled) NATIVE_METRICS_COUNT("exec.cancelled", 1);
+}
+
+// ============================================================
+// execCmd (sync)
+// ============================================================
+
 /**
  * execCmd(command: string, timeoutMs?: number): { stdout: string, stderr: string, exitCode: number }
  *
- * Runs a shell command via popen() and returns captured output.
- * stderr is captured by appending 2>&1 to the command.
+ * Runs a shell command on the JS thread and returns captured output.
+ * stderr is merged into stdout (like 2>&1). Past 64KB the read end is treated as closed:
+ * the process group gets SIGPIPE, as a popen() reader that stopped reading would cause.
  */
 static napi_value ExecCmd(napi_env env, napi_callback_info info) {
     size_t argc = 2;
     napi_value args[2];
     napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
 
-    if (argc < 1) {
+    if (argc < 1 || !IsType(env, args[0], napi_string)) {
         napi_throw_error(env, nullptr, "execCmd requires a command string");
         return nullptr;
     }
 
-    // Get command string
-    size_t cmdLen = 0;
-    napi_get_value_string_utf8(env, args[0], nullptr, 0, &cmdLen);
-    std::string command(cmdLen, '\0');
-    napi_get_value_string_utf8(env, args[0], &command[0], cmdLen + 1, &cmdLen);
-
-    // Append 2>&1 to capture stderr in stdout
-    std::string fullCmd = command + " 2>&1";
-
-    // Execute
-    FILE *pipe = popen(fullCmd.c_str(), "r");
-    if (!pipe) {
-        // Return error result
-        napi_value result;
-        napi_create_object(env, &result);
-
-        napi_value stdoutVal, stderrVal, exitCodeVal;
-        napi_create_string_utf8(env, "", 0, &stdoutVal);
-        napi_create_string_utf8(env, "popen() failed", 14, &stderrVal);
-        napi_create_int32(env, -1, &exitCodeVal);
+    SpawnOptions options;
+    options.command = GetStringValue(env, args[0]);
+    options.mergeStderr = true;
+    if (argc >= 2 && IsType(env, args[1], napi_number)) {
+        napi_get_value_int64(env, args[1], &options.timeoutMs);
+    }
 
-        napi_set_named_property(env, result, "stdout", stdoutVal);
-        napi_set_named_property(env, result, "stderr", stderrVal);
-        napi_set_named_property(env, result, "exitCode", exitCodeVal);
-        return result;
+    ChildProcess proc;
+    std::string error;
+    if (!proc.spawn(options, &error)) {
+        return ExecResultObject(env, "", error, -1);
     }
 
-    // Read output
     std::string output;
-    char buf[4096];
-    while (fgets(buf, sizeof(buf), pipe) != nullptr) {
-        output += buf;
+    bool truncated = false;
+    ExitStatus status = proc.run([&](OutputStream, const char* data, size_t len) {
+        if (truncated) return;
+        output.append(data, len);
         if (output.size() >= MAX_OUTPUT) {
-            output = output.substr(0, MAX_OUTPUT);
+            output.resize(MAX_OUTPUT);
             output += "\n...[truncated at 64KB]";
-            break;
+            truncated = true;
+            proc.kill(SIGPIPE);
         }
+    });
+
+    RecordExit(status);
+    return ExecResultObject(env, output, status.timedOut ? "timed out" : "", status.exitCode);
+}
+
+// ============================================================
+// execAsync
+// ============================================================
+
+struct ExecJob {
+    std::string taskId;
+    bool streaming = false;          // chunks go to the JS callback instead of the result
+    size_t maxOutput = MAX_OUTPUT;   // per stream, collect mode only
+    ChildProcess proc;
+    napi_threadsafe_function tsfn = nullptr;
+    napi_deferred deferred = nullptr;
+
+    // Worker thread until the done message is posted, then JS thread
+    std::string out, err;
+    std::string carry[2];            // incomplete trailing UTF-8 bytes per stream
+    bool truncated[2] = {false, false};  // per stream (stdout, stderr), collect mode
+    ExitStatus status;
+};
+
+struct ExecMessage {
+    std::shared_ptr<ExecJob> job;
+    bool done = false;
+    OutputStream stream = OutputStream::STDOUT;
+    std::string data;
+};
+
+// JS thread only: running jobs that were given a taskId
+static std::unordered_map<std::string, std::shared_ptr<ExecJob>> g_jobs;
+
+static const char* StreamName(OutputStream s) {
+    return s == OutputStream::STDERR ? "stderr" : "stdout";
+}
+
+// JS thread: deliver a chunk to the callback, or settle the promise
+static void CallExecJs(napi_env env, napi_value jsCallback, void* context, void* data) {
+    std::unique_ptr<ExecMessage> msg(static_cast<ExecMessage*>(data));
+    if (env == nullptr) return;
+
+    if (!msg->done) {
+        if (jsCallback == nullptr) return;
+        napi_value undefined, chunk;
+        napi_get_undefined(env, &undefined);
+        napi_create_object(env, &chunk);
+        napi_set_named_property(env, chunk, "stream", CreateString(env, StreamName(msg->stream)));
+        napi_set_named_property(env, chunk, "data", CreateString(env, msg->data));
+        napi_call_function(env, undefined, jsCallback, 1, &chunk, nullptr);
+        return;
     }
 
-    int status = pclose(pipe);
-    int exitCode = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+    ExecJob& job = *msg->job;
+    if (!job.taskId.empty()) {
+        auto it = g_jobs.find(job.taskId);
+        if (it != g_jobs.end() && it->second == msg->job) g_jobs.erase(it);
+    }
 
-    // Build result object
-    napi_value result;
-    napi_create_object(env, &result);
+    if (job.status.cancelled) {
+        RejectWithCode(env, job.deferred, "CANCELLED", "Exec cancelled");
+        return;
+    }
+    napi_value result = ExecResultObject(env, job.out, job.err, job.status.exitCode);
+    napi_set_named_property(env, result, "signal", CreateInt(env, job.status.signal));
+    napi_set_named_property(env, result, "timedOut", CreateBool(env, job.status.timedOut));
+    napi_set_named_property(env, result, "truncated", CreateBool(env, job.truncated[0] || job.truncated[1]));
+    napi_set_named_property(env, result, "stdoutTruncated", CreateBool(env, job.truncated[0]));
+    napi_set_named_property(env, result, "stderrTruncated", CreateBool(env, job.truncated[1]));
+    napi_set_named_property(env, result, "durationMs", CreateInt(env, job.status.durationMs));
+    napi_resolve_deferred(env, job.deferred, result);
+}
+
+/** Worker thread: post one chunk, keeping an incomplete UTF-8 tail for the next one */
+static void PostChunk(const std::shared_ptr<ExecJob>& job, OutputStream stream, std::string data, bool flush) {
+    std::string& carry = job->carry[stream == OutputStream::STDERR ? 1 : 0];
+    if (!carry.empty()) data.insert(0, carry);
+    carry.clear();
+    if (!flush) {
+        size_t keep = Utf8CompleteLength(data);
+        carry.assign(data, keep, std::string::npos);
+        data.resize(keep);
+    }
+    if (data.empty()) return;
 
-    napi_value stdoutVal, stderrVal, exitCodeVal;
-    napi_create_string_utf8(env, output.c_str(), output.size(), &stdoutVal);
-    napi_create_string_utf8(env, "", 0, &stderrVal);
-    napi_create_int32(env, exitCode, &exitCodeVal);
+    auto* msg = new ExecMessage{job, false, stream, std::move(data)};
+    if (napi_call_threadsafe_function(job->tsfn, msg, napi_tsfn_blocking) != napi_ok) {
+        delete msg;
+        job->proc.cancel();   // env is shutting down
+    }
+}
 
-    napi_set_named_property(env, result, "stdout", stdoutVal);
-    napi_set_named_property(env, result, "stderr", stderrVal);
-    napi_set_named_property(env, result, "exitCode", exitCodeVal);
+/**
+ * Worker thread: collect mode, at most maxOutput bytes per stream. The stream that hits the
+ * cap is flagged and dropped from then on; the other keeps collecting until the command exits.
+ */
+static void CollectChunk(ExecJob& job, OutputStream stream, const char* data, size_t len) {
+    int s = stream == OutputStream::STDERR ? 1 : 0;
+    if (job.truncated[s]) return;
+    std::string& buf = s == 1 ? job.err : job.out;
+    buf.append(data, len);
+    if (buf.size() > job.maxOutput) {
+        buf.resize(job.maxOutput);
+        buf.resize(Utf8CompleteLength(buf));
+        job.truncated[s] = true;
+        job.proc.kill(SIGPIPE);
+    }
+}
 
-    return result;
+static void RunJob(std::shared_ptr<ExecJob> job) {
+    job->status = job->proc.run([&job](OutputStream stream, const char* data, size_t len) {
+        if (job->streaming) {
+            PostChunk(job, stream, std::string(data, len), false);
+        } else {
+            CollectChunk(*job, stream, data, len);
+        }
+    });
+    RecordExit(job->status);
+    if (job->streaming) {
+        PostChunk(job, OutputStream::STDOUT, std::string(), true);
+        PostChunk(job, OutputStream::STDERR, std::string(), true);
+    }
+
+    auto* done = new ExecMessage{job, true, OutputStream::STDOUT, std::string()};
+    if (napi_call_threadsafe_function(job->tsfn, done, napi_tsfn_blocking) != napi_ok) delete done;
+    napi_release_threadsafe_function(job->tsfn, napi_tsfn_release);
+}
+
+/**
+ * execAsync(command: string, options?: ExecOptions, onChunk?: (chunk: ExecChunk) => void): Promise<AsyncExecResult>
+ *
+ * options: { timeoutMs?, killGraceMs?, cwd?, mergeStderr?, maxOutputBytes?, taskId? }
+ * With onChunk, stdout / stderr are streamed and the result's stdout / stderr are empty.
+ * Without it, each stream is collected up to maxOutputBytes (default 64KB); past that the
+ * process group gets SIGPIPE and that stream's stdoutTruncated / stderrTruncated is set
+ * (truncated = either). Output the other stream writes before the command exits is kept.
+ * Timeouts resolve with timedOut = true; cancelExec() rejects with Error.code CANCELLED;
+ * spawn failures reject with FAILED.
+ */
+static napi_value ExecAsync(napi_env env, napi_callback_info info) {
+    size_t argc = 3;
+    napi_value args[3];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+
+    if (argc < 1 || !IsType(env, args[0], napi_string)) {
+        napi_throw_error(env, nullptr, "execAsync requires a command string");
+        return nullptr;
+    }
+
+    auto job = std::make_shared<ExecJob>();
+    SpawnOptions options;
+    options.command = GetStringValue(env, args[0]);
+
+    if (argc >= 2 && IsType(env, args[1], napi_object)) {
+        napi_value v;
+        if (GetNamed(env, args[1], "timeoutMs", napi_number, &v)) napi_get_value_int64(env, v, &options.timeoutMs);
+        if (GetNamed(env, args[1], "killGraceMs", napi_number, &v)) napi_get_value_int64(env, v, &options.killGraceMs);
+        if (GetNamed(env, args[1], "cwd", napi_string, &v)) options.cwd = GetStringValue(env, v);
+        if (GetNamed(env, args[1], "mergeStderr", napi_boolean, &v)) napi_get_value_bool(env, v, &options.mergeStderr);
+        if (GetNamed(env, args[1], "taskId", napi_string, &v)) job->taskId = GetStringValue(env, v);
+        if (GetNamed(env, args[1], "maxOutputBytes", napi_number, &v)) {
+            int64_t cap = 0;
+            napi_get_value_int64(env, v, &cap);
+            if (cap > 0) job->maxOutput = static_cast<size_t>(cap);
+        }
+    }
+    napi_value callback = nullptr;
+    if (argc >= 3 && IsType(env, args[2], napi_function)) {
+        callback = args[2];
+        job->streaming = true;
+    }
+
+    napi_value promise;
+    if (napi_create_promise(env, &job->deferred, &promise) != napi_ok) {
+        napi_throw_error(env, nullptr, "Failed to create promise");
+        return nullptr;
+    }
+
+    if (!job->taskId.empty() && g_jobs.count(job->taskId)) {
+        RejectWithCode(env, job->deferred, "FAILED", "Duplicate taskId: " + job->taskId);
+        return promise;
+    }
+
+    std::string error;
+    if (!job->proc.spawn(options, &error)) {
+        RejectWithCode(env, job->deferred, "FAILED", error);
+        return promise;
+    }
+
+    napi_value resourceName;
+    napi_create_string_utf8(env, "execAsync", NAPI_AUTO_LENGTH, &resourceName);
+    if (napi_create_threadsafe_function(env, callback, nullptr, resourceName, CHUNK_QUEUE_SIZE, 1, nullptr, nullptr,
+                                        nullptr, CallExecJs, &job->tsfn) != napi_ok) {
+        job->proc.kill(SIGKILL);
+        RejectWithCode(env, job->deferred, "FAILED", "Failed to create exec callback");
+        return promise;
+    }
+
+    if (!job->taskId.empty()) g_jobs[job->taskId] = job;
+    std::thread(RunJob, job).detach();
+    return promise;
+}
+
+/**
+ * killExec(taskId: string, signal?: number): boolean
+ *
+ * Sends a signal (default SIGTERM) to the command's process group; the promise still resolves,
+ * with the terminating signal in result.signal. Returns false if no such running command.
+ */
+static napi_value KillExec(napi_env env, napi_callback_info info) {
+    size_t argc = 2;
+    napi_value args[2];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+
+    if (argc < 1 || !IsType(env, args[0], napi_string)) {
+        napi_throw_error(env, nullptr, "killExec requires a taskId");
+        return nullptr;
+    }
+
+    int32_t sig = SIGTERM;
+    if (argc >= 2 && IsType(env, args[1], napi_number)) napi_get_value_int32(env, args[1], &sig);
+
+    auto it = g_jobs.find(GetStringValue(env, args[0]));
+    return CreateBool(env, it != g_jobs.end() && it->second->proc.kill(sig));
+}
+
+/**
+ * cancelExec(taskId: string): boolean
+ *
+ * Kills the command's process group and rejects its promise with Error.code CANCELLED.
+ */
+static napi_value CancelExec(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+
+    if (argc < 1 || !IsType(env, args[0], napi_string)) {
+        napi_throw_error(env, nullptr, "cancelExec requires a taskId");
+        return nullptr;
+    }
+
+    auto it = g_jobs.find(GetStringValue(env, args[0]));
+    if (it == g_jobs.end()) return CreateBool(env, false);
+    it->second->proc.cancel();
+    return CreateBool(env, true);
 }
 
 EXTERN_C_START
 static napi_value Init(napi_env env, napi_value exports) {
     napi_property_descriptor desc[] = {
-        {"execCmd", nullptr, ExecCmd, nullptr, nullptr, nullptr, napi_default, nullptr}
+        {"execCmd", nullptr, ExecCmd, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"execAsync", nullptr, ExecAsync, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"killExec", nullptr, KillExec, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"cancelExec", nullptr, CancelExec, nullptr, nullptr, nullptr, napi_default, nullptr},
+        native_common::MetricsProperty("exec"),
     };
     napi_define_properties(env, exports, sizeof(desc) / sizeof(desc[0]), desc);
     return exports;
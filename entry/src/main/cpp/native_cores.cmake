@@ -0,0 +1,70 @@
+# native_cores.cmake - NAPI-free module cores
+#
+# Shared by the HAP build (CMakeLists.txt) and the host benchmarks (bench/CMakeLists.txt):
+# each NAPI module is its *_napi.cpp bridge linked against the core below, the host
+# build links the same cores without libace_napi. The includer defines native_json and
+# native_metrics first (the HAP variant exports to HiTrace / HiLog, the host one does not
+# and carries the pthread link the thread pool needs).
+set(NATIVE_CORE_ROOT ${CMAKE_CURRENT_LIST_DIR})
+
+# geo_utils_core - haversine, batch distance kernels, spatial grid, geofence index (header-only)
+add_library(geo_utils_core INTERFACE)
+target_include_directories(geo_utils_core INTERFACE ${NATIVE_CORE_ROOT} ${NATIVE_CORE_ROOT}/geo_utils)
+target_compile_features(geo_utils_core INTERFACE cxx_std_17)
+
+# dbscan_core - grid-indexed DBSCAN + incremental DBSCAN (header-only, common/thread_pool.h)
+add_library(dbscan_core INTERFACE)
+target_include_directories(dbscan_core INTERFACE ${NATIVE_CORE_ROOT}/dbscan_cluster)
+target_link_libraries(dbscan_core INTERFACE geo_utils_core native_metrics)
+
+# location_fusion_core - multi-source confidence + compiled signal / geofence index (header-only)
+add_library(location_fusion_core INTERFACE)
+target_include_directories(location_fusion_core INTERFACE ${NATIVE_CORE_ROOT}/location_fusion)
+target_link_libraries(location_fusion_core INTERFACE geo_utils_core)
+
+# data_tray_core - seqlock slot table with TTL (header-only)
+add_library(data_tray_core INTERFACE)
+target_include_directories(data_tray_core INTERFACE ${NATIVE_CORE_ROOT}/data_tray)
+target_link_libraries(data_tray_core INTERFACE native_metrics)
+
+# place_learner_core / motion_detector_core / sleep_pattern_core / feedback_learner_core (header-only)
+add_library(place_learner_core INTERFACE)
+target_include_directories(place_learner_core INTERFACE ${NATIVE_CORE_ROOT} ${NATIVE_CORE_ROOT}/place_learner)
+target_compile_features(place_learner_core INTERFACE cxx_std_17)
+
+add_library(motion_detector_core INTERFACE)
+target_include_directories(motion_detector_core INTERFACE ${NATIVE_CORE_ROOT} ${NATIVE_CORE_ROOT}/motion_detector)
+target_compile_features(motion_detector_core INTERFACE cxx_std_17)
+
+add_library(sleep_pattern_core INTERFACE)
+target_include_directories(sleep_pattern_core INTERFACE ${NATIVE_CORE_ROOT} ${NATIVE_CORE_ROOT}/sleep_pattern)
+target_compile_features(sleep_pattern_core INTERFACE cxx_std_17)
+
+add_library(feedback_learner_core INTERFACE)
+target_include_directories(feedback_learner_core INTERFACE ${NATIVE_CORE_ROOT} ${NATIVE_CORE_ROOT}/feedback_learner)
+target_compile_features(feedback_learner_core INTERFACE cxx_std_17)
+
+# context_engine_core - rule engine, decision tree, soft matching, MAB, LinUCB, snapshots, rule JSON codec
+add_library(context_engine_core STATIC
+    ${NATIVE_CORE_ROOT}/context_engine/rule_engine.cpp
+    ${NATIVE_CORE_ROOT}/context_engine/decision_tree.cpp
+    ${NATIVE_CORE_ROOT}/context_engine/soft_match.cpp
+    ${NATIVE_CORE_ROOT}/context_engine/mab.cpp
+    ${NATIVE_CORE_ROOT}/context_engine/linucb.cpp
+    ${NATIVE_CORE_ROOT}/context_engine/snapshot.cpp
+    ${NATIVE_CORE_ROOT}/context_engine/rule_json.cpp
+)
+set_target_properties(context_engine_core PROPERTIES POSITION_INDEPENDENT_CODE ON)
+target_include_directories(context_engine_core PUBLIC ${NATIVE_CORE_ROOT} ${NATIVE_CORE_ROOT}/context_engine)
+target_compile_features(context_engine_core PUBLIC cxx_std_17)
+target_link_libraries(context_engine_core PUBLIC native_json native_metrics)
+
+# voiceprint_core - contiguous speaker gallery + streaming embedding extraction
+add_library(voiceprint_core STATIC
+    ${NATIVE_CORE_ROOT}/voiceprint/speaker_gallery.cpp
+    ${NATIVE_CORE_ROOT}/voiceprint/embedding_stream.cpp
+)
+set_target_properties(voiceprint_core PROPERTIES POSITION_INDEPENDENT_CODE ON)
+target_include_directories(voiceprint_core PUBLIC ${NATIVE_CORE_ROOT} ${NATIVE_CORE_ROOT}/voiceprint)
+target_compile_features(voiceprint_core PUBLIC cxx_std_17)
+target_link_libraries(voiceprint_core PUBLIC native_metrics)
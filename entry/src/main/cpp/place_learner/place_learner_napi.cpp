@@ -0,0 +1,333 @@
+/**
+ * place_learner_napi.cpp — 地点信号学习 NAPI 绑定
+ */
+#include <napi/native_api.h>
+#include "place_signal_learner.h"
+#include "common/metrics_napi.h"
+#include <vector>
+#include <string>
+
+using namespace place_learner;
+
+// 模块级常驻学习器，只在 JS 线程访问
+static PlaceSignalLearner g_learner;
+
+// ============================================================
+// Helper functions
+// ============================================================
+
+static double GetDoubleProp(napi_env env, napi_value obj, const char* key, double defaultVal = 0.0) {
+    napi_value prop;
+    napi_status status = napi_get_named_property(env, obj, key, &prop);
+    if (status != napi_ok) return defaultVal;
+
+    double val;
+    status = napi_get_value_double(env, prop, &val);
+    return (status == napi_ok) ? val : defaultVal;
+}
+
+static std::string GetStringValue(napi_env env, napi_value val) {
+    size_t len = 0;
+    if (napi_get_value_string_utf8(env, val, nullptr, 0, &len) != napi_ok) return "";
+    std::string result(len, '\0');
+    napi_get_value_string_utf8(env, val, &result[0], len + 1, &len);
+    return result;
+}
+
+static std::string GetStringProp(napi_env env, napi_value obj, const char* key, const std::string& defaultVal = "") {
+    napi_value prop;
+    if (napi_get_named_property(env, obj, key, &prop) != napi_ok) return defaultVal;
+    napi_valuetype type = napi_undefined;
+    napi_typeof(env, prop, &type);
+    return type == napi_string ? GetStringValue(env, prop) : defaultVal;
+}
+
+/** 读取字符串数组属性；缺失或不是数组时返回空 */
+static std::vector<std::string> GetStringArrayProp(napi_env env, napi_value obj, const char* key) {
+    std::vector<std::string> out;
+    napi_value arr;
+    bool isArray = false;
+    if (napi_get_named_property(env, obj, key, &arr) != napi_ok) return out;
+    if (napi_is_array(env, arr, &isArray) != napi_ok || !isArray) return out;
+    uint32_t len = 0;
+    napi_get_array_length(env, arr, &len);
+    out.reserve(len);
+    for (uint32_t i = 0; i < len; i++) {
+        napi_value elem;
+        napi_get_element(env, arr, i, &elem);
+        out.push_back(GetStringValue(env, elem));
+    }
+    return out;
+}
+
+static napi_value CreateString(napi_env env, const std::string& str) {
+    napi_value result;
+    napi_create_string_utf8(env, str.c_str(), str.length(), &result);
+    return result;
+}
+
+static napi_value CreateDouble(napi_env env, double val) {
+    napi_value result;
+    napi_create_double(env, val, &result);
+    return result;
+}
+
+static napi_value CreateBool(napi_env env, bool val) {
+    napi_value result;
+    napi_get_boolean(env, val, &result);
+    return result;
+}
+
+static napi_value CreateStringArray(napi_env env, const std::vector<std::string>& list) {
+    napi_value arr;
+    napi_create_array_with_length(env, list.size(), &arr);
+    for (size_t i = 0; i < list.size(); i++) {
+        napi_set_element(env, arr, static_cast<uint32_t>(i), CreateString(env, list[i]));
+    }
+    return arr;
+}
+
+// ============================================================
+// NAPI bindings
+// ============================================================
+
+/**
+ * placeLearner.learn(params) → boolean  是否学到了新信号
+ *
+ * params: { placeId, wifiSsid?, btDevice?, cellId?, timestamp?, hour? }
+ * timestamp / hour 缺省取当前时间
+ */
+static napi_value Learn(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+
+    if (argc < 1) {
+        napi_throw_error(env, nullptr, "Expected 1 argument: params");
+        return nullptr;
+    }
+
+    std::string placeId = GetStringProp(env, args[0], "placeId");
+    if (placeId.empty()) {
+        napi_throw_error(env, nullptr, "placeId is required");
+        return nullptr;
+    }
+    std::string wifiSsid = GetStringProp(env, args[0], "wifiSsid");
+    std::string btDevice = GetStringProp(env, args[0], "btDevice");
+    std::string cellId = GetStringProp(env, args[0], "cellId");
+
+    bool hasTimestamp = false;
+    bool hasHour = false;
+    napi_has_named_property(env, args[0], "timestamp", &hasTimestamp);
+    napi_has_named_property(env, args[0], "hour", &hasHour);
+    bool learned;
+    if (hasTimestamp && hasHour) {
+        learned = g_learner.learnAt(placeId, wifiSsid, btDevice, cellId,
+                                    static_cast<int64_t>(GetDoubleProp(env, args[0], "timestamp", 0)),
+                                    static_cast<int>(GetDoubleProp(env, args[0], "hour", 0)));
+    } else {
+        learned = g_learner.learn(placeId, wifiSsid, btDevice, cellId);
+    }
+    return CreateBool(env, learned);
+}
+
+/**
+ * placeLearner.restore(placeId, signals) → void  载入持久化的地点信号
+ *
+ * signals: { wifiSSIDs?, bluetoothDevices?, cellIds?, typicalHours?: number[], lastSeen?, visitCount? }
+ */
+static napi_value Restore(napi_env env, napi_callback_info info) {
+    size_t argc = 2;
+    napi_value args[2];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+
+    if (argc < 2) {
+        napi_throw_error(env, nullptr, "Expected 2 arguments: placeId, signals");
+        return nullptr;
+    }
+
+    LearnedSignals signals;
+    signals.wifiSSIDs = GetStringArrayProp(env, args[1], "wifiSSIDs");
+    signals.bluetoothDevices = GetStringArrayProp(env, args[1], "bluetoothDevices");
+    signals.cellIds = GetStringArrayProp(env, args[1], "cellIds");
+    signals.lastSeen = static_cast<int64_t>(GetDoubleProp(env, args[1], "lastSeen", 0));
+    signals.visitCount = static_cast<int>(GetDoubleProp(env, args[1], "visitCount", 0));
+
+    napi_value hours;
+    bool isArray = false;
+    if (napi_get_named_property(env, args[1], "typicalHours", &hours) == napi_ok &&
+        napi_is_array(env, hours, &isArray) == napi_ok && isArray) {
+        uint32_t len = 0;
+        napi_get_array_length(env, hours, &len);
+        for (uint32_t i = 0; i < len; i++) {
+            napi_value elem;
+            int32_t hour = -1;
+            napi_get_element(env, hours, i, &elem);
+            if (napi_get_value_int32(env, elem, &hour) == napi_ok && hour >= 0 && hour < 24) {
+                signals.typicalTimes.push_back({hour, hour + 1});
+            }
+        }
+    }
+
+    g_learner.restore(GetStringValue(env, args[0]), signals);
+    return nullptr;
+}
+
+/**
+ * placeLearner.findPlacesByWifi(ssid) → string[]
+ */
+static napi_value FindPlacesByWifi(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+
+    if (argc < 1) {
+        napi_throw_error(env, nullptr, "Expected 1 argument: ssid");
+        return nullptr;
+    }
+    return CreateStringArray(env, g_learner.findPlacesByWifi(GetStringValue(env, args[0])));
+}
+
+/**
+ * placeLearner.findPlacesByCellId(cellId) → string[]
+ */
+static napi_value FindPlacesByCellId(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+
+    if (argc < 1) {
+        napi_throw_error(env, nullptr, "Expected 1 argument: cellId");
+        return nullptr;
+    }
+    return CreateStringArray(env, g_learner.findPlacesByCellId(GetStringValue(env, args[0])));
+}
+
+/**
+ * placeLearner.scorePlaces(query, topK?) → PlaceScore[]
+ *
+ * query: { wifiSsid?, cellIds?: string[], hour? }
+ */
+static napi_value ScorePlaces(napi_env env, napi_callback_info info) {
+    size_t argc = 2;
+    napi_value args[2];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+
+    if (argc < 1) {
+        napi_throw_error(env, nullptr, "Expected 1-2 arguments: query, topK?");
+        return nullptr;
+    }
+
+    PlaceQuery query;
+    query.wifiSsid = GetStringProp(env, args[0], "wifiSsid");
+    query.cellIds = GetStringArrayProp(env, args[0], "cellIds");
+    query.hour = static_cast<int>(GetDoubleProp(env, args[0], "hour", -1));
+
+    int32_t topK = 0;
+    if (argc >= 2) napi_get_value_int32(env, args[1], &topK);
+
+    auto scores = g_learner.scorePlaces(query, topK > 0 ? static_cast<size_t>(topK) : 0);
+
+    napi_value arr;
+    napi_create_array_with_length(env, scores.size(), &arr);
+    for (size_t i = 0; i < scores.size(); i++) {
+        const auto& s = scores[i];
+        napi_value obj;
+        napi_create_object(env, &obj);
+        napi_set_named_property(env, obj, "placeId", CreateString(env, s.placeId));
+        napi_set_named_property(env, obj, "score", CreateDouble(env, s.score));
+        napi_set_named_property(env, obj, "wifiMatch", CreateBool(env, s.wifiMatch));
+        napi_set_named_property(env, obj, "cellMatches", CreateDouble(env, s.cellMatches));
+        napi_set_named_property(env, obj, "timeMatch", CreateBool(env, s.timeMatch));
+        napi_set_named_property(env, obj, "hits", CreateDouble(env, s.hits));
+        napi_set_element(env, arr, static_cast<uint32_t>(i), obj);
+    }
+    return arr;
+}
+
+/**
+ * placeLearner.getSummary(placeId) → { wifiList, btList, visitCount }
+ */
+static napi_value GetSummary(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+
+    if (argc < 1) {
+        napi_throw_error(env, nullptr, "Expected 1 argument: placeId");
+        return nullptr;
+    }
+
+    SignalSummary summary = g_learner.getSummary(GetStringValue(env, args[0]));
+    napi_value obj;
+    napi_create_object(env, &obj);
+    napi_set_named_property(env, obj, "wifiList", CreateStringArray(env, summary.wifiList));
+    napi_set_named_property(env, obj, "btList", CreateStringArray(env, summary.btList));
+    napi_set_named_property(env, obj, "visitCount", CreateDouble(env, summary.visitCount));
+    return obj;
+}
+
+/**
+ * placeLearner.clear(placeId?) → void  不传 id 时清空全部
+ */
+static napi_value Clear(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+
+    napi_valuetype type = napi_undefined;
+    if (argc >= 1) napi_typeof(env, args[0], &type);
+    if (type == napi_string) {
+        g_learner.clear(GetStringValue(env, args[0]));
+    } else {
+        g_learner.clearAll();
+    }
+    return nullptr;
+}
+
+/**
+ * placeLearner.size() → number  已学习的地点数
+ */
+static napi_value Size(napi_env env, napi_callback_info info) {
+    return CreateDouble(env, static_cast<double>(g_learner.placeCount()));
+}
+
+// ============================================================
+// Module registration
+// ============================================================
+
+EXTERN_C_START
+
+static napi_value Init(napi_env env, napi_value exports) {
+    napi_property_descriptor desc[] = {
+        {"learn", nullptr, Learn, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"restore", nullptr, Restore, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"findPlacesByWifi", nullptr, FindPlacesByWifi, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"findPlacesByCellId", nullptr, FindPlacesByCellId, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"scorePlaces", nullptr, ScorePlaces, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"getSummary", nullptr, GetSummary, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"clear", nullptr, Clear, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"size", nullptr, Size, nullptr, nullptr, nullptr, napi_default, nullptr},
+        native_common::MetricsProperty("place_learner"),
+    };
+
+    napi_define_properties(env, exports, sizeof(desc) / sizeof(desc[0]), desc);
+    return exports;
+}
+
+static napi_module place_learner_module = {
+    .nm_version = 1,
+    .nm_flags = NAPI_MODULE_VERSION,
+    .nm_filename = nullptr,
+    .nm_register_func = Init,
+    .nm_modname = "place_learner",
+    .nm_priv = nullptr,
+    .reserved = {0},
+};
+
+
+EXTERN_C_END
+
+extern "C" __attribute__((constructor)) void RegisterPlaceLearnerModule(void) {
+    napi_module_register(&place_learner_module);
+}
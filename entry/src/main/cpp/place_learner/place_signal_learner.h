@@ -2,13 +2,21 @@
  * place_signal_learner.h — 地点信号学习 C++ 实现
  *
  * 学习围栏关联的WiFi/蓝牙/CellID/时间特征
+ *
+ * 按信号反查地点（findPlacesByWifi / findPlacesByCellId）在 GPS 关闭时的基站兜底路径上，
+ * 这里维护 SSID / CellID → 地点的倒排表（含观测次数），learn / clear 时增量更新，
+ * 查询只访问学到过该信号的地点，不再遍历全部地点。
+ * 各地点的信号集合用有序 vector 存储（地点的信号数很少，连续内存比红黑树节点更省）。
  */
 #pragma once
 
+#include <algorithm>
+#include <chrono>
+#include <ctime>
 #include <string>
 #include <vector>
 #include <map>
-#include <set>
+#include <unordered_map>
 #include <cstdint>
 
 namespace place_learner {
@@ -30,26 +38,26 @@ struct CellIdInfo {
     int lac;          // Location Area Code (GSM) or Tracking Area Code (LTE)
     int cellId;       // Cell ID
     int signalStrength;
-    
+
     std::string toString() const {
-        return std::to_string(mcc) + "_" + std::to_string(mnc) + "_" + 
+        return std::to_string(mcc) + "_" + std::to_string(mnc) + "_" +
                std::to_string(lac) + "_" + std::to_string(cellId);
     }
-    
+
     bool operator<(const CellIdInfo& other) const {
         return toString() < other.toString();
     }
 };
 
-/** 学习的地点信号 */
+/** 学习的地点信号；三个信号列表均升序、无重复 */
 struct LearnedSignals {
-    std::set<std::string> wifiSSIDs;
-    std::set<std::string> bluetoothDevices;
-    std::set<std::string> cellIds;        // CellID 字符串集合
+    std::vector<std::string> wifiSSIDs;
+    std::vector<std::string> bluetoothDevices;
+    std::vector<std::string> cellIds;        // CellID 字符串集合
     std::vector<TimeRange> typicalTimes;
     int64_t lastSeen;
     int visitCount;
-    
+
     LearnedSignals() : lastSeen(0), visitCount(0) {}
 };
 
@@ -57,7 +65,37 @@ struct LearnedSignals {
 struct SignalSummary {
     std::vector<std::string> wifiList;
     std::vector<std::string> btList;
-    int visitCount;
+    int visitCount = 0;
+};
+
+/** 倒排表条目：学到该信号的地点及其观测次数 */
+struct PlaceHit {
+    std::string placeId;
+    int count;
+};
+
+/** 组合查询输入；空字段 / hour < 0 表示该路信号缺失 */
+struct PlaceQuery {
+    std::string wifiSsid;
+    std::vector<std::string> cellIds;   // 当前服务小区 + 邻区
+    int hour = -1;                      // 0 – 23
+};
+
+/** 组合查询权重：WiFi 最可靠，基站覆盖范围大，时间只做加成 */
+struct PlaceScoreWeights {
+    double wifi = 0.6;
+    double cell = 0.3;
+    double time = 0.1;
+};
+
+/** 组合查询结果 */
+struct PlaceScore {
+    std::string placeId;
+    double score;        // 0~1
+    bool wifiMatch;
+    int cellMatches;     // 命中的查询小区数
+    bool timeMatch;
+    int hits;            // 命中信号的观测次数之和，同分时优先
 };
 
 // ============================================================
@@ -67,7 +105,7 @@ struct SignalSummary {
 class PlaceSignalLearner {
 public:
     PlaceSignalLearner() {}
-    
+
     /**
      * 学习地点信号
      * @param placeId 地点ID
@@ -76,36 +114,42 @@ public:
      * @param cellId 当前CellID字符串 (mcc_mnc_lac_cellid)
      * @return 是否学到了新信号
      */
-    bool learn(const std::string& placeId, const std::string& wifiSsid, 
+    bool learn(const std::string& placeId, const std::string& wifiSsid,
                const std::string& btDevice = "", const std::string& cellId = "") {
+        return learnAt(placeId, wifiSsid, btDevice, cellId, currentTimeMs(), currentHour());
+    }
+
+    /**
+     * 同 learn，时间由调用方给出（NAPI 层传入 JS 侧时间，便于测试）
+     */
+    bool learnAt(const std::string& placeId, const std::string& wifiSsid, const std::string& btDevice,
+                 const std::string& cellId, int64_t nowMs, int hour) {
         bool learned = false;
-        
+
         LearnedSignals& signals = signals_[placeId];
-        
+
         // 学习WiFi
-        if (!wifiSsid.empty() && signals.wifiSSIDs.find(wifiSsid) == signals.wifiSSIDs.end()) {
-            signals.wifiSSIDs.insert(wifiSsid);
-            learned = true;
+        if (!wifiSsid.empty()) {
+            learned |= insertSorted(signals.wifiSSIDs, wifiSsid);
+            addHit(wifiIndex_, wifiSsid, placeId);
         }
-        
+
         // 学习蓝牙
-        if (!btDevice.empty() && signals.bluetoothDevices.find(btDevice) == signals.bluetoothDevices.end()) {
-            signals.bluetoothDevices.insert(btDevice);
-            learned = true;
+        if (!btDevice.empty()) {
+            learned |= insertSorted(signals.bluetoothDevices, btDevice);
         }
-        
+
         // 学习CellID
-        if (!cellId.empty() && signals.cellIds.find(cellId) == signals.cellIds.end()) {
-            signals.cellIds.insert(cellId);
-            learned = true;
+        if (!cellId.empty()) {
+            learned |= insertSorted(signals.cellIds, cellId);
+            addHit(cellIndex_, cellId, placeId);
         }
-        
+
         // 更新访问统计
         signals.visitCount++;
-        signals.lastSeen = currentTimeMs();
-        
+        signals.lastSeen = nowMs;
+
         // 学习典型时间
-        int hour = currentHour();
         bool hasHour = false;
         for (const auto& tr : signals.typicalTimes) {
             if (tr.startHour == hour) {
@@ -119,58 +163,153 @@ public:
                 signals.typicalTimes.erase(signals.typicalTimes.begin());
             }
         }
-        
+
         return learned;
     }
-    
+
+    /**
+     * 用持久化的信号替换某地点的信号（ArkTS 侧不保存观测次数，每个信号按 1 次计）
+     */
+    void restore(const std::string& placeId, const LearnedSignals& saved) {
+        clear(placeId);
+        LearnedSignals& signals = signals_[placeId];
+        for (const auto& ssid : saved.wifiSSIDs) {
+            if (!ssid.empty() && insertSorted(signals.wifiSSIDs, ssid)) addHit(wifiIndex_, ssid, placeId);
+        }
+        for (const auto& bt : saved.bluetoothDevices) {
+            if (!bt.empty()) insertSorted(signals.bluetoothDevices, bt);
+        }
+        for (const auto& cell : saved.cellIds) {
+            if (!cell.empty() && insertSorted(signals.cellIds, cell)) addHit(cellIndex_, cell, placeId);
+        }
+        signals.typicalTimes = saved.typicalTimes;
+        if (signals.typicalTimes.size() > 5) {
+            signals.typicalTimes.erase(signals.typicalTimes.begin(),
+                                       signals.typicalTimes.end() - 5);
+        }
+        signals.lastSeen = saved.lastSeen;
+        signals.visitCount = saved.visitCount;
+    }
+
     /**
      * 检查WiFi是否匹配地点
      */
     bool matchesWifi(const std::string& placeId, const std::string& wifiSsid) const {
         auto it = signals_.find(placeId);
         if (it == signals_.end()) return false;
-        return it->second.wifiSSIDs.count(wifiSsid) > 0;
+        return containsSorted(it->second.wifiSSIDs, wifiSsid);
     }
-    
+
     /**
      * 检查CellID是否匹配地点
      */
     bool matchesCellId(const std::string& placeId, const std::string& cellId) const {
         auto it = signals_.find(placeId);
         if (it == signals_.end()) return false;
-        return it->second.cellIds.count(cellId) > 0;
+        return containsSorted(it->second.cellIds, cellId);
     }
-    
+
     /**
-     * 根据WiFi查找匹配的地点
+     * 根据WiFi查找匹配的地点（按地点ID升序）
      */
     std::vector<std::string> findPlacesByWifi(const std::string& wifiSsid) const {
-        std::vector<std::string> result;
-        for (const auto& pair : signals_) {
-            if (pair.second.wifiSSIDs.count(wifiSsid) > 0) {
-                result.push_back(pair.first);
-            }
-        }
-        return result;
+        return placesOf(wifiIndex_, wifiSsid);
     }
-    
+
     /**
-     * 根据CellID查找匹配的地点
+     * 根据CellID查找匹配的地点（按地点ID升序）
      */
     std::vector<std::string> findPlacesByCellId(const std::string& cellId) const {
-        std::vector<std::string> result;
-        for (const auto& pair : signals_) {
-            if (pair.second.cellIds.count(cellId) > 0) {
-                result.push_back(pair.first);
+        return placesOf(cellIndex_, cellId);
+    }
+
+    /** 学到该 SSID 的地点及观测次数（按地点ID升序） */
+    const std::vector<PlaceHit>* wifiHits(const std::string& wifiSsid) const {
+        auto it = wifiIndex_.find(wifiSsid);
+        return it != wifiIndex_.end() ? &it->second : nullptr;
+    }
+
+    /** 学到该 CellID 的地点及观测次数（按地点ID升序） */
+    const std::vector<PlaceHit>* cellHits(const std::string& cellId) const {
+        auto it = cellIndex_.find(cellId);
+        return it != cellIndex_.end() ? &it->second : nullptr;
+    }
+
+    /**
+     * WiFi + CellID + 时段组合打分
+     *
+     * 候选地点只来自 WiFi / CellID 倒排表（时段本身不能召回地点）：
+     *   score = wifi 权重 × 是否命中 SSID
+     *         + cell 权重 × 命中的查询小区比例
+     *         + time 权重 × hour 是否落在典型时段内
+     * 按 score 降序，同分按命中观测次数降序、再按地点ID升序；topK = 0 表示不限。
+     */
+    std::vector<PlaceScore> scorePlaces(const PlaceQuery& query, size_t topK = 0,
+                                        const PlaceScoreWeights& weights = PlaceScoreWeights{}) const {
+        std::unordered_map<std::string, PlaceScore> byPlace;
+        auto entry = [&](const std::string& placeId) -> PlaceScore& {
+            auto [it, inserted] = byPlace.try_emplace(placeId);
+            if (inserted) it->second = {placeId, 0.0, false, 0, false, 0};
+            return it->second;
+        };
+
+        if (!query.wifiSsid.empty()) {
+            if (const auto* hits = wifiHits(query.wifiSsid)) {
+                for (const auto& h : *hits) {
+                    PlaceScore& s = entry(h.placeId);
+                    s.wifiMatch = true;
+                    s.hits += h.count;
+                }
             }
         }
-        return result;
-    }
+
+        // 查询小区去重，避免同一小区重复计分
+        std::vector<std::string> cells(query.cellIds);
+        cells.erase(std::remove(cells.begin(), cells.end(), std::string()), cells.end());
+        std::sort(cells.begin(), cells.end());
+        cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+        for (const auto& cell : cells) {
+            if (const auto* hits = cellHits(cell)) {
+                for (const auto& h : *hits) {
+                    PlaceScore& s = entry(h.placeId);
+                    s.cellMatches++;
+                    s.hits += h.count;
+                }
+            }
+        }
+
+        std::vector<PlaceScore> result;
+        result.reserve(byPlace.size());
+        for (auto& [placeId, s] : byPlace) {
+            if (query.hour >= 0) {
+                const LearnedSignals& signals = signals_.at(placeId);
+                for (const auto& tr : signals.typicalTimes) {
+                    if (query.hour >= tr.startHour && query.hour < tr.endHour) {
+                        s.timeMatch = true;
+                        break;
+                    }
+                }
             }
+            s.score = (s.wifiMatch ? weights.wifi : 0.0) +
+                      (cells.empty() ? 0.0 : weights.cell * s.cellMatches / static_cast<double>(cells.size())) +
+                      (s.timeMatch ? weights.time : 0.0);
+            result.push_back(std::move(s));
+        }
+
+        auto better = [](const PlaceScore& a, const PlaceScore& b) {
+            if (a.score != b.score) return a.score > b.score;
+            if (a.hits != b.hits) return a.hits > b.hits;
+            return a.placeId < b.placeId;
+        };
+        if (topK > 0 && topK < result.size()) {
+            std::partial_sort(result.begin(), result.begin() + topK, result.end(), better);
+            result.resize(topK);
+        } else {
+            std::sort(result.begin(), result.end(), better);
         }
         return result;
     }
-    
+
     /**
      * 获取地点的学习信号
      */
@@ -178,7 +317,7 @@ public:
         auto it = signals_.find(placeId);
         return it != signals_.end() ? &it->second : nullptr;
     }
-    
+
     /**
      * 获取信号摘要 (用于序列化)
      */
@@ -186,41 +325,96 @@ public:
         SignalSummary summary;
         auto it = signals_.find(placeId);
         if (it != signals_.end()) {
-            for (const auto& ssid : it->second.wifiSSIDs) {
-                summary.wifiList.push_back(ssid);
-            }
-            for (const auto& bt : it->second.bluetoothDevices) {
-                summary.btList.push_back(bt);
-            }
+            summary.wifiList = it->second.wifiSSIDs;
+            summary.btList = it->second.bluetoothDevices;
             summary.visitCount = it->second.visitCount;
         }
         return summary;
     }
-    
+
+    size_t placeCount() const { return signals_.size(); }
+
     /**
      * 清除地点信号
      */
     void clear(const std::string& placeId) {
-        signals_.erase(placeId);
+        auto it = signals_.find(placeId);
+        if (it == signals_.end()) return;
+        for (const auto& ssid : it->second.wifiSSIDs) removeHit(wifiIndex_, ssid, placeId);
+        for (const auto& cell : it->second.cellIds) removeHit(cellIndex_, cell, placeId);
+        signals_.erase(it);
     }
-    
+
     /**
      * 清除所有
      */
     void clearAll() {
         signals_.clear();
+        wifiIndex_.clear();
+        cellIndex_.clear();
     }
 
 private:
+    using HitIndex = std::unordered_map<std::string, std::vector<PlaceHit>>;
+
     std::map<std::string, LearnedSignals> signals_;
-    
+    HitIndex wifiIndex_;   // SSID → 地点
+    HitIndex cellIndex_;   // CellID → 地点
+
+    /** 插入有序 vector，已存在返回 false */
+    static bool insertSorted(std::vector<std::string>& list, const std::string& value) {
+        auto pos = std::lower_bound(list.begin(), list.end(), value);
+        if (pos != list.end() && *pos == value) return false;
+        list.insert(pos, value);
+        return true;
+    }
+
+    static bool containsSorted(const std::vector<std::string>& list, const std::string& value) {
+        return std::binary_search(list.begin(), list.end(), value);
+    }
+
+    static auto findHit(std::vector<PlaceHit>& hits, const std::string& placeId) {
+        return std::lower_bound(hits.begin(), hits.end(), placeId,
+                                [](const PlaceHit& h, const std::string& id) { return h.placeId < id; });
+    }
+
+    static void addHit(HitIndex& index, const std::string& signal, const std::string& placeId) {
+        auto& hits = index[signal];
+        auto pos = findHit(hits, placeId);
+        if (pos != hits.end() && pos->placeId == placeId) {
+            pos->count++;
+        } else {
+            hits.insert(pos, {placeId, 1});
+        }
+    }
+
+    static void removeHit(HitIndex& index, const std::string& signal, const std::string& placeId) {
+        auto it = index.find(signal);
+        if (it == index.end()) return;
+        auto pos = findHit(it->second, placeId);
+        if (pos != it->second.end() && pos->placeId == placeId) it->second.erase(pos);
+        if (it->second.empty()) index.erase(it);
+    }
+
+    static std::vector<std::string> placesOf(const HitIndex& index, const std::string& signal) {
+        std::vector<std::string> result;
+        auto it = index.find(signal);
+        if (it == index.end()) return result;
+        result.reserve(it->second.size());
+        for (const auto& h : it->second) result.push_back(h.placeId);
+        return result;
+    }
+
     static int64_t currentTimeMs() {
-        // 使用系统时间
-        return 0; // 实际实现需要平台特定代码
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
     }
-    
+
     static int currentHour() {
-        return 0; // 实际实现需要平台特定代码
+        std::time_t now = std::time(nullptr);
+        std::tm local{};
+        localtime_r(&now, &local);
+        return local.tm_hour;
     }
 };
 
@@ -3,14 +3,23 @@
  *
  * 根据用户运动数据推断睡眠时间
  * 结合穿戴设备数据（如果有）进行精确判断
+ *
+ * 常驻后台进程里长期运行，所以每次更新都是 O(1)：
+ *   - 运动变化只推进一个“当前静止段”的状态机，不再每次重扫 24 小时历史
+ *   - 典型入睡 / 起床时间用跨午夜的 EWMA 维护，不再每插入一条记录就遍历全部记录
+ *   - 原始历史只保留在定长列式日志里（common/ring_log.h），可随快照一起持久化
  */
 #pragma once
 
-#include <string>
-#include <vector>
-#include <map>
+#include "common/binary_snapshot.h"
+#include "common/ring_log.h"
+#include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
 
 namespace sleep_pattern {
 
@@ -20,37 +29,37 @@ namespace sleep_pattern {
 
 /** 单日睡眠模式 */
 struct SleepDayPattern {
-    double bedtime;       // 入睡时间 (小时 0-23.99)
-    double wakeTime;      // 起床时间 (小时 0-23.99)
-    int sampleCount;      // 样本数量
+    double bedtime = 0;       // 入睡时间 (小时 0-23.99)
+    double wakeTime = 0;      // 起床时间 (小时 0-23.99)
+    int sampleCount = 0;      // 样本数量
 };
 
 /** 睡眠模式 */
 struct SleepPattern {
-    double typicalBedtime;      // 典型入睡时间
-    double typicalWakeTime;     // 典型起床时间
-    double sleepDurationHours;  // 平均睡眠时长
-    SleepDayPattern weekdays;   // 工作日
-    SleepDayPattern weekends;   // 周末
-    int64_t lastUpdated;
-    double confidence;          // 置信度 0-1
+    double typicalBedtime = 0;      // 典型入睡时间
+    double typicalWakeTime = 0;     // 典型起床时间
+    double sleepDurationHours = 0;  // 平均睡眠时长
+    SleepDayPattern weekdays;       // 工作日
+    SleepDayPattern weekends;       // 周末（周五、周六晚）
+    int64_t lastUpdated = 0;
+    double confidence = 0;          // 置信度 0-1
 };
 
 /** 单次睡眠记录 */
 struct SleepRecord {
     std::string date;           // "YYYY-MM-DD"
-    int64_t bedtime;            // 入睡时间戳
-    int64_t wakeTime;           // 起床时间戳
-    int64_t durationMs;
+    int64_t bedtime = 0;        // 入睡时间戳
+    int64_t wakeTime = 0;       // 起床时间戳
+    int64_t durationMs = 0;
     std::string source;         // "wearable", "inferred", "manual"
 };
 
 /** 运动状态快照 */
 struct MotionSnapshot {
     std::string state;          // stationary, walking, etc.
-    int64_t timestamp;
-    double latitude;
-    double longitude;
+    int64_t timestamp = 0;
+    double latitude = 0;
+    double longitude = 0;
     std::string geofence;
 };
 
@@ -60,43 +69,63 @@ struct MotionSnapshot {
 
 class SleepPatternLearner {
 public:
-    SleepPatternLearner() : pattern_(), records_(), motionHistory_() {
-        pattern_.confidence = 0;
-        pattern_.lastUpdated = 0;
+    static constexpr int64_t HOUR_MS = 60 * 60 * 1000;
+    static constexpr int64_t DAY_MS = 24 * HOUR_MS;
+    static constexpr int64_t MIN_SLEEP_MS = 4 * HOUR_MS;     // 静止超过 4 小时才算睡眠
+    static constexpr size_t MIN_MOTION_SAMPLES = 10;         // 24 小时内至少这么多次运动变化才推断
+    static constexpr double PATTERN_ALPHA = 0.1;             // EWMA 权重；前 10 条等价于算术平均
+    static constexpr double FULL_CONFIDENCE_RECORDS = 7.0;   // 7 天数据达到 100% 置信度
+    static constexpr size_t DEFAULT_RECORD_CAPACITY = 120;   // 睡眠记录日志保留约 4 个月
+    static constexpr size_t DEFAULT_MOTION_CAPACITY = 512;   // 24 小时运动变化日志上限
+
+    explicit SleepPatternLearner(size_t recordCapacity = DEFAULT_RECORD_CAPACITY,
+                                 size_t motionCapacity = DEFAULT_MOTION_CAPACITY)
+        : records_(recordCapacity), motion_(motionCapacity) {
+        native_common::resizeColumn(recBedtime_, records_);
+        native_common::resizeColumn(recWakeTime_, records_);
+        native_common::resizeColumn(recDurationSec_, records_);
+        native_common::resizeColumn(recSource_, records_);
+        native_common::resizeColumn(motionTime_, motion_);
+        native_common::resizeColumn(motionState_, motion_);
     }
-    
+
+    /**
+     * 时间戳换算本地小时时使用的 UTC 偏移（分钟，东八区为 480）
+     * 只影响之后的记录，已有聚合不回算
+     */
+    void setUtcOffsetMinutes(int minutes) { utcOffsetMs_ = static_cast<int64_t>(minutes) * 60 * 1000; }
+
     /**
      * 记录运动状态变化
      * 用于推断睡眠时间
      */
     void recordMotionChange(const MotionSnapshot& snapshot) {
-        motionHistory_.push_back(snapshot);
-        
+        size_t at = motion_.push();
+        motionTime_[at] = snapshot.timestamp;
+        motionState_[at] = stateCode(snapshot.state);
+
         // 保持最近24小时的历史
-        int64_t cutoff = snapshot.timestamp - 24 * 60 * 60 * 1000;
-        while (motionHistory_.size() > 2 && motionHistory_.front().timestamp < cutoff) {
-            motionHistory_.erase(motionHistory_.begin());
-        }
-        
+        int64_t cutoff = snapshot.timestamp - DAY_MS;
+        while (motion_.size() > 2 && motionTime_[motion_.front()] < cutoff) motion_.popFront();
+
         // 检测睡眠
-        detectSleep();
+        detectSleep(motionState_[at], snapshot.timestamp);
     }
-    
+
     /**
      * 从穿戴设备记录睡眠
      */
     void recordFromWearable(const SleepRecord& record) {
-        records_.push_back(record);
-        updatePattern();
+        addRecord(record.bedtime, record.wakeTime, record.durationMs, sourceCode(record.source));
     }
-    
+
     /**
      * 获取睡眠模式
      */
     const SleepPattern& getPattern() const {
         return pattern_;
     }
-    
+
     /**
      * 获取推荐的睡前提醒时间
      * @return 小时 (0-23.99)
@@ -111,122 +140,339 @@ public:
         if (reminder < 0) reminder += 24;
         return reminder;
     }
-    
+
     /**
      * 判断当前是否接近睡眠时间
      */
     bool isNearBedtime(int currentHour, int currentMinute, int marginMinutes = 30) const {
         double current = currentHour + currentMinute / 60.0;
         double bedtime = pattern_.confidence >= 0.3 ? pattern_.typicalBedtime : 22.0;
-        
+
         double diff = std::abs(current - bedtime);
         if (diff > 12) diff = 24 - diff;  // 处理跨午夜情况
-        
+
         return diff * 60 <= marginMinutes;
     }
-    
+
+    /** 计入聚合的记录数（含已从日志淘汰的） */
+    int recordCount() const { return samples_; }
+
+    /** 日志中保留的睡眠记录数 */
+    size_t loggedRecords() const { return records_.size(); }
+
+    /** 24 小时窗口内的运动变化数 */
+    size_t motionWindowSize() const { return motion_.size(); }
+
+    /**
+     * 最近的睡眠记录，从新到旧，最多 limit 条（0 = 日志中全部）
+     * date 由入睡时间按 UTC 偏移推算
+     */
+    std::vector<SleepRecord> recentRecords(size_t limit = 0) const {
+        size_t n = records_.size();
+        if (limit > 0 && limit < n) n = limit;
+        std::vector<SleepRecord> out;
+        out.reserve(n);
+        for (size_t i = 0; i < n; i++) {
+            size_t at = records_.slot(records_.size() - 1 - i);
+            SleepRecord rec;
+            rec.bedtime = recBedtime_[at];
+            rec.wakeTime = recWakeTime_[at];
+            rec.durationMs = static_cast<int64_t>(recDurationSec_[at]) * 1000;
+            rec.source = sourceName(recSource_[at]);
+            rec.date = formatDate(localDay(rec.bedtime));
+            out.push_back(std::move(rec));
+        }
+        return out;
+    }
+
     /**
      * 清除所有记录
      */
     void clear() {
         records_.clear();
-        motionHistory_.clear();
-        pattern_.confidence = 0;
+        motion_.clear();
+        pattern_ = SleepPattern();
+        bedtime_ = Ewma();
+        wake_ = Ewma();
+        duration_ = Ewma();
+        weekdayBed_ = Ewma();
+        weekdayWake_ = Ewma();
+        weekendBed_ = Ewma();
+        weekendWake_ = Ewma();
+        samples_ = 0;
+        inStationary_ = false;
+        stationaryStart_ = 0;
+        stationaryEnd_ = 0;
     }
 
-private:
-    SleepPattern pattern_;
-    std::vector<SleepRecord> records_;
-    std::vector<MotionSnapshot> motionHistory_;
-    
+    // ============================================================
+    // 快照
+    // ============================================================
+
+    /** 快照段标签与布局版本：SLPP = 聚合与进行中的静止段，SLPL = 睡眠记录日志 */
+    static constexpr uint32_t SNAPSHOT_TAG = native_common::snapshotTag("SLPP");
+    static constexpr uint32_t LOG_SNAPSHOT_TAG = native_common::snapshotTag("SLPL");
+    static constexpr uint32_t SNAPSHOT_VERSION = 1;
+
     /**
-     * 从运动历史推断睡眠
+     * 写入快照段（common/binary_snapshot.h）
+     * @param includeLog 同时写出睡眠记录日志；只需要聚合结果时可以不写
      */
-    void detectSleep() {
-        if (motionHistory_.size() < 10) return;
-        
-        // 寻找长时间静止的时段（可能是睡眠）
-        int64_t stationaryStart = 0;
-        int64_t stationaryEnd = 0;
-        bool inStationary = false;
-        
-        for (size_t i = 0; i < motionHistory_.size(); i++) {
-            const auto& snap = motionHistory_[i];
-            
-            if (snap.state == "stationary") {
-                if (!inStationary) {
-                    stationaryStart = snap.timestamp;
-                    inStationary = true;
-                }
-                stationaryEnd = snap.timestamp;
-            } else {
-                if (inStationary) {
-                    // 检查静止时长
-                    int64_t duration = stationaryEnd - stationaryStart;
-                    if (duration > 4 * 60 * 60 * 1000) {  // > 4小时
-                        // 可能是睡眠
-                        addInferredSleep(stationaryStart, stationaryEnd);
-                    }
-                    inStationary = false;
-                }
+    void appendSnapshot(native_common::SnapshotWriter& writer, bool includeLog = true) const {
+        native_common::ByteWriter& w = writer.addSection(SNAPSHOT_TAG, SNAPSHOT_VERSION);
+        w.put(utcOffsetMs_);
+        w.put(static_cast<int32_t>(samples_));
+        w.put(pattern_.lastUpdated);
+        for (const Ewma* e : {&bedtime_, &wake_, &duration_, &weekdayBed_, &weekdayWake_, &weekendBed_, &weekendWake_}) {
+            w.put(e->value);
+            w.put(static_cast<int32_t>(e->n));
+        }
+        w.put(static_cast<uint8_t>(inStationary_ ? 1 : 0));
+        w.put(stationaryStart_);
+        w.put(stationaryEnd_);
+
+        if (!includeLog) return;
+        native_common::ByteWriter& log = writer.addSection(LOG_SNAPSHOT_TAG, SNAPSHOT_VERSION);
+        log.put(static_cast<uint32_t>(records_.size()));
+        native_common::putColumn(log, records_, recBedtime_);
+        native_common::putColumn(log, records_, recWakeTime_);
+        native_common::putColumn(log, records_, recDurationSec_);
+        native_common::putColumn(log, records_, recSource_);
+    }
+
+    /**
+     * 从快照恢复（替换现有）；日志段缺失时记录日志为空
+     * @return 聚合段缺失、版本不符或内容截断时返回 false，现有状态不变
+     */
+    bool loadSnapshot(const native_common::MappedSnapshot& snapshot) {
+        const native_common::SnapshotSection* section = snapshot.find(SNAPSHOT_TAG);
+        if (section == nullptr || section->version != SNAPSHOT_VERSION) return false;
+        native_common::ByteReader r = snapshot.reader(*section);
+        SleepPatternLearner loaded(records_.capacity(), motion_.capacity());
+        loaded.utcOffsetMs_ = r.get<int64_t>();
+        loaded.samples_ = r.get<int32_t>();
+        loaded.pattern_.lastUpdated = r.get<int64_t>();
+        for (Ewma* e : {&loaded.bedtime_, &loaded.wake_, &loaded.duration_, &loaded.weekdayBed_,
+                        &loaded.weekdayWake_, &loaded.weekendBed_, &loaded.weekendWake_}) {
+            e->value = r.get<double>();
+            e->n = r.get<int32_t>();
+        }
+        loaded.inStationary_ = r.get<uint8_t>() != 0;
+        loaded.stationaryStart_ = r.get<int64_t>();
+        loaded.stationaryEnd_ = r.get<int64_t>();
+        if (!r.ok() || !r.atEnd()) return false;
+
+        const native_common::SnapshotSection* logSection = snapshot.find(LOG_SNAPSHOT_TAG);
+        if (logSection != nullptr) {
+            if (logSection->version != SNAPSHOT_VERSION) return false;
+            native_common::ByteReader lr = snapshot.reader(*logSection);
+            size_t count = lr.get<uint32_t>();
+            std::vector<int64_t> bed, wake;
+            std::vector<uint32_t> dur;
+            std::vector<uint8_t> src;
+            if (!native_common::getColumn(lr, count, bed) || !native_common::getColumn(lr, count, wake) ||
+                !native_common::getColumn(lr, count, dur) || !native_common::getColumn(lr, count, src) ||
+                !lr.atEnd()) {
+                return false;
             }
+            for (size_t i = 0; i < count; i++) loaded.logRecord(bed[i], wake[i], dur[i], src[i]);
         }
+
+        loaded.publishPattern();
+        *this = std::move(loaded);
+        return true;
+    }
+
+    /** 单独写成一个快照文件 */
+    bool save(const std::string& path, bool includeLog = true) const {
+        native_common::SnapshotWriter writer;
+        appendSnapshot(writer, includeLog);
+        return writer.writeFile(path);
     }
-    
+
+    /** 读取 save 写出的文件 */
+    bool load(const std::string& path) {
+        native_common::MappedSnapshot snapshot;
+        return snapshot.open(path) && loadSnapshot(snapshot);
+    }
+
+private:
+    enum MotionCode : uint8_t { MOTION_OTHER = 0, MOTION_STATIONARY = 1 };
+    enum SourceCode : uint8_t { SOURCE_INFERRED = 0, SOURCE_WEARABLE = 1, SOURCE_MANUAL = 2 };
+
     /**
-     * 添加推断的睡眠记录
+     * 运行 EWMA：第 n 个样本权重 max(1/n, PATTERN_ALPHA)，样本少时等价于算术平均
+     * 小时值在 24 小时圆周上更新，23:30 与 00:30 的平均是 00:00 而不是 12:00
      */
-    void addInferredSleep(int64_t start, int64_t end) {
-        SleepRecord record;
-        record.bedtime = start;
-        record.wakeTime = end;
-        record.durationMs = end - start;
-        record.source = "inferred";
-        
-        // 从时间戳提取日期
-        // 简化处理，实际需要正确的时间转换
-        record.date = "inferred";
-        
-        records_.push_back(record);
-        updatePattern();
-    }
-    
+    struct Ewma {
+        double value = 0;
+        int n = 0;
+
+        void addLinear(double x) {
+            n++;
+            value += (x - value) * weight();
+        }
+
+        void addHour(double hour) {
+            n++;
+            double delta = hour - value;
+            if (delta >= 12) delta -= 24;
+            if (delta < -12) delta += 24;
+            value += delta * weight();
+            if (value < 0) value += 24;
+            if (value >= 24) value -= 24;
+        }
+
+        double weight() const { return std::max(1.0 / n, PATTERN_ALPHA); }
+    };
+
+    SleepPattern pattern_;
+    Ewma bedtime_, wake_, duration_;
+    Ewma weekdayBed_, weekdayWake_, weekendBed_, weekendWake_;
+    int samples_ = 0;
+    int64_t utcOffsetMs_ = 0;
+
+    // 睡眠记录日志（列式）
+    native_common::RingIndex records_;
+    std::vector<int64_t> recBedtime_;
+    std::vector<int64_t> recWakeTime_;
+    std::vector<uint32_t> recDurationSec_;
+    std::vector<uint8_t> recSource_;
+
+    // 24 小时运动变化日志（列式）
+    native_common::RingIndex motion_;
+    std::vector<int64_t> motionTime_;
+    std::vector<uint8_t> motionState_;
+
+    // 进行中的静止段
+    bool inStationary_ = false;
+    int64_t stationaryStart_ = 0;
+    int64_t stationaryEnd_ = 0;
+
+    static uint8_t stateCode(const std::string& state) {
+        return state == "stationary" ? MOTION_STATIONARY : MOTION_OTHER;
+    }
+
+    static uint8_t sourceCode(const std::string& source) {
+        if (source == "wearable") return SOURCE_WEARABLE;
+        if (source == "manual") return SOURCE_MANUAL;
+        return SOURCE_INFERRED;
+    }
+
+    static const char* sourceName(uint8_t code) {
+        switch (code) {
+            case SOURCE_WEARABLE: return "wearable";
+            case SOURCE_MANUAL: return "manual";
+            default: return "inferred";
+        }
+    }
+
     /**
-     * 更新睡眠模式
+     * 推进静止段状态机：一段静止在下一次非静止时结束，超过 4 小时记为一次睡眠
+     * 每段只记一次（原先每次运动变化重扫 24 小时历史，同一晚会被重复计入）
      */
-    void updatePattern() {
-        if (records_.empty()) return;
-        
-        // 计算平均睡眠时间
-        double bedtimeSum = 0;
-        double wakeTimeSum = 0;
-        double durationSum = 0;
-        int count = 0;
-        
-        for (const auto& rec : records_) {
-            if (rec.bedtime > 0 && rec.wakeTime > 0) {
-                // 从时间戳提取小时
-                double bedtimeHour = (rec.bedtime / (1000 * 60 * 60)) % 24;
-                double wakeHour = (rec.wakeTime / (1000 * 60 * 60)) % 24;
-                
-                bedtimeSum += bedtimeHour;
-                wakeTimeSum += wakeHour;
-                durationSum += rec.durationMs / (1000.0 * 60 * 60);
-                count++;
+    void detectSleep(uint8_t state, int64_t timestamp) {
+        if (state == MOTION_STATIONARY) {
+            if (!inStationary_) {
+                stationaryStart_ = timestamp;
+                inStationary_ = true;
             }
+            stationaryEnd_ = timestamp;
+            return;
         }
-        
-        if (count > 0) {
-            pattern_.typicalBedtime = bedtimeSum / count;
-            pattern_.typicalWakeTime = wakeTimeSum / count;
-            pattern_.sleepDurationHours = durationSum / count;
-            pattern_.confidence = std::min(1.0, count / 7.0);  // 7天数据达到100%置信度
-            pattern_.lastUpdated = currentTimeMs();
+        if (!inStationary_) return;
+        inStationary_ = false;
+        if (motion_.size() < MIN_MOTION_SAMPLES) return;
+        if (stationaryEnd_ - stationaryStart_ > MIN_SLEEP_MS) {
+            // 可能是睡眠
+            addRecord(stationaryStart_, stationaryEnd_, stationaryEnd_ - stationaryStart_, SOURCE_INFERRED);
         }
     }
-    
+
+    void logRecord(int64_t bedtime, int64_t wakeTime, uint32_t durationSec, uint8_t source) {
+        size_t at = records_.push();
+        recBedtime_[at] = bedtime;
+        recWakeTime_[at] = wakeTime;
+        recDurationSec_[at] = durationSec;
+        recSource_[at] = source;
+    }
+
+    /**
+     * 记一条睡眠并 O(1) 更新模式
+     */
+    void addRecord(int64_t bedtime, int64_t wakeTime, int64_t durationMs, uint8_t source) {
+        if (durationMs <= 0) durationMs = wakeTime - bedtime;
+        logRecord(bedtime, wakeTime, static_cast<uint32_t>(std::max<int64_t>(durationMs, 0) / 1000), source);
+        if (bedtime <= 0 || wakeTime <= 0) return;
+
+        double bedHour = localHour(bedtime);
+        double wakeHour = localHour(wakeTime);
+        bedtime_.addHour(bedHour);
+        wake_.addHour(wakeHour);
+        duration_.addLinear(static_cast<double>(durationMs) / HOUR_MS);
+        if (isWeekendNight(bedtime)) {
+            weekendBed_.addHour(bedHour);
+            weekendWake_.addHour(wakeHour);
+        } else {
+            weekdayBed_.addHour(bedHour);
+            weekdayWake_.addHour(wakeHour);
+        }
+        samples_++;
+        pattern_.lastUpdated = std::max(pattern_.lastUpdated, currentTimeMs());
+        publishPattern();
+    }
+
+    void publishPattern() {
+        if (samples_ == 0) {
+            pattern_ = SleepPattern();
+            return;
+        }
+        pattern_.typicalBedtime = bedtime_.value;
+        pattern_.typicalWakeTime = wake_.value;
+        pattern_.sleepDurationHours = duration_.value;
+        pattern_.weekdays = {weekdayBed_.value, weekdayWake_.value, weekdayBed_.n};
+        pattern_.weekends = {weekendBed_.value, weekendWake_.value, weekendBed_.n};
+        pattern_.confidence = std::min(1.0, samples_ / FULL_CONFIDENCE_RECORDS);
+    }
+
+    /** 本地时间从 1970-01-01 起的天数（向下取整） */
+    int64_t localDay(int64_t timestampMs) const {
+        int64_t local = timestampMs + utcOffsetMs_;
+        return local >= 0 ? local / DAY_MS : -((-local + DAY_MS - 1) / DAY_MS);
+    }
+
+    double localHour(int64_t timestampMs) const {
+        int64_t local = timestampMs + utcOffsetMs_;
+        int64_t inDay = local - localDay(timestampMs) * DAY_MS;
+        return static_cast<double>(inDay) / HOUR_MS;
+    }
+
+    /** 周五、周六晚入睡算周末；凌晨入睡按前一晚算（先回退 12 小时） */
+    bool isWeekendNight(int64_t bedtimeMs) const {
+        int64_t day = localDay(bedtimeMs - 12 * HOUR_MS);
+        int weekday = static_cast<int>(((day + 4) % 7 + 7) % 7);  // 1970-01-01 是周四，0 = 周日
+        return weekday == 5 || weekday == 6;
+    }
+
+    /** 天数 → "YYYY-MM-DD"（公历） */
+    static std::string formatDate(int64_t days) {
+        int64_t z = days + 719468;
+        int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+        int64_t doe = z - era * 146097;
+        int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+        int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+        int64_t mp = (5 * doy + 2) / 153;
+        int64_t d = doy - (153 * mp + 2) / 5 + 1;
+        int64_t m = mp < 10 ? mp + 3 : mp - 9;
+        int64_t y = yoe + era * 400 + (m <= 2 ? 1 : 0);
+        char buf[40];   // 按三个任意 int 的最长输出留足空间
+        std::snprintf(buf, sizeof(buf), "%04d-%02d-%02d", static_cast<int>(y), static_cast<int>(m), static_cast<int>(d));
+        return buf;
+    }
+
     int64_t currentTimeMs() const {
-        return 0;  // 实际实现需要平台特定代码
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
     }
 };
 
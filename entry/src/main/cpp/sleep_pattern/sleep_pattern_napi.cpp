@@ -0,0 +1,298 @@
+/**
+ * sleep_pattern_napi.cpp — 睡眠时间学习 NAPI 绑定
+ */
+#include <napi/native_api.h>
+#include "sleep_pattern.h"
+#include "common/metrics_napi.h"
+#include <string>
+#include <vector>
+
+using namespace sleep_pattern;
+
+// 模块级常驻学习器，只在 JS 线程访问
+static SleepPatternLearner g_learner;
+
+// ============================================================
+// Helper functions
+// ============================================================
+
+static double GetDoubleProp(napi_env env, napi_value obj, const char* key, double defaultVal = 0.0) {
+    napi_value prop;
+    napi_status status = napi_get_named_property(env, obj, key, &prop);
+    if (status != napi_ok) return defaultVal;
+
+    double val;
+    status = napi_get_value_double(env, prop, &val);
+    return (status == napi_ok) ? val : defaultVal;
+}
+
+static std::string GetStringValue(napi_env env, napi_value val) {
+    size_t len = 0;
+    if (napi_get_value_string_utf8(env, val, nullptr, 0, &len) != napi_ok) return "";
+    std::string result(len, '\0');
+    napi_get_value_string_utf8(env, val, &result[0], len + 1, &len);
+    return result;
+}
+
+static std::string GetStringProp(napi_env env, napi_value obj, const char* key, const std::string& defaultVal = "") {
+    napi_value prop;
+    if (napi_get_named_property(env, obj, key, &prop) != napi_ok) return defaultVal;
+    napi_valuetype type = napi_undefined;
+    napi_typeof(env, prop, &type);
+    return type == napi_string ? GetStringValue(env, prop) : defaultVal;
+}
+
+static bool IsType(napi_env env, napi_value val, napi_valuetype expected) {
+    napi_valuetype type = napi_undefined;
+    napi_typeof(env, val, &type);
+    return type == expected;
+}
+
+static napi_value CreateString(napi_env env, const std::string& str) {
+    napi_value result;
+    napi_create_string_utf8(env, str.c_str(), str.length(), &result);
+    return result;
+}
+
+static napi_value CreateDouble(napi_env env, double val) {
+    napi_value result;
+    napi_create_double(env, val, &result);
+    return result;
+}
+
+static napi_value CreateBool(napi_env env, bool val) {
+    napi_value result;
+    napi_get_boolean(env, val, &result);
+    return result;
+}
+
+static napi_value DayPatternToJs(napi_env env, const SleepDayPattern& day) {
+    napi_value obj;
+    napi_create_object(env, &obj);
+    napi_set_named_property(env, obj, "bedtime", CreateDouble(env, day.bedtime));
+    napi_set_named_property(env, obj, "wakeTime", CreateDouble(env, day.wakeTime));
+    napi_set_named_property(env, obj, "sampleCount", CreateDouble(env, day.sampleCount));
+    return obj;
+}
+
+// ============================================================
+// NAPI bindings
+// ============================================================
+
+/**
+ * sleepPattern.recordMotion({ state, timestamp }) → void
+ */
+static napi_value RecordMotion(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+
+    if (argc < 1 || !IsType(env, args[0], napi_object)) {
+        napi_throw_error(env, nullptr, "Expected 1 argument: { state, timestamp }");
+        return nullptr;
+    }
+
+    MotionSnapshot snapshot;
+    snapshot.state = GetStringProp(env, args[0], "state");
+    snapshot.timestamp = static_cast<int64_t>(GetDoubleProp(env, args[0], "timestamp", 0));
+    g_learner.recordMotionChange(snapshot);
+    return nullptr;
+}
+
+/**
+ * sleepPattern.recordSleep({ bedtime, wakeTime, durationMs?, source? }) → void
+ *
+ * source 缺省为 "wearable"
+ */
+static napi_value RecordSleep(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+
+    if (argc < 1 || !IsType(env, args[0], napi_object)) {
+        napi_throw_error(env, nullptr, "Expected 1 argument: { bedtime, wakeTime, durationMs?, source? }");
+        return nullptr;
+    }
+
+    SleepRecord record;
+    record.bedtime = static_cast<int64_t>(GetDoubleProp(env, args[0], "bedtime", 0));
+    record.wakeTime = static_cast<int64_t>(GetDoubleProp(env, args[0], "wakeTime", 0));
+    record.durationMs = static_cast<int64_t>(GetDoubleProp(env, args[0], "durationMs", 0));
+    record.source = GetStringProp(env, args[0], "source", "wearable");
+    if (record.wakeTime <= record.bedtime) {
+        napi_throw_error(env, nullptr, "wakeTime must be after bedtime");
+        return nullptr;
+    }
+    g_learner.recordFromWearable(record);
+    return nullptr;
+}
+
+/**
+ * sleepPattern.getPattern() → SleepPattern
+ */
+static napi_value GetPattern(napi_env env, napi_callback_info info) {
+    const SleepPattern& p = g_learner.getPattern();
+    napi_value obj;
+    napi_create_object(env, &obj);
+    napi_set_named_property(env, obj, "typicalBedtime", CreateDouble(env, p.typicalBedtime));
+    napi_set_named_property(env, obj, "typicalWakeTime", CreateDouble(env, p.typicalWakeTime));
+    napi_set_named_property(env, obj, "sleepDurationHours", CreateDouble(env, p.sleepDurationHours));
+    napi_set_named_property(env, obj, "weekdays", DayPatternToJs(env, p.weekdays));
+    napi_set_named_property(env, obj, "weekends", DayPatternToJs(env, p.weekends));
+    napi_set_named_property(env, obj, "lastUpdated", CreateDouble(env, static_cast<double>(p.lastUpdated)));
+    napi_set_named_property(env, obj, "confidence", CreateDouble(env, p.confidence));
+    return obj;
+}
+
+/**
+ * sleepPattern.getBedtimeReminder() → number  推荐的睡前提醒时间（小时）
+ */
+static napi_value GetBedtimeReminder(napi_env env, napi_callback_info info) {
+    return CreateDouble(env, g_learner.getRecommendedBedtimeReminder());
+}
+
+/**
+ * sleepPattern.isNearBedtime(hour, minute, marginMinutes?) → boolean
+ */
+static napi_value IsNearBedtime(napi_env env, napi_callback_info info) {
+    size_t argc = 3;
+    napi_value args[3];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+
+    if (argc < 2) {
+        napi_throw_error(env, nullptr, "Expected 2-3 arguments: hour, minute, marginMinutes?");
+        return nullptr;
+    }
+
+    int32_t hour = 0, minute = 0, margin = 30;
+    napi_get_value_int32(env, args[0], &hour);
+    napi_get_value_int32(env, args[1], &minute);
+    if (argc >= 3) napi_get_value_int32(env, args[2], &margin);
+    return CreateBool(env, g_learner.isNearBedtime(hour, minute, margin));
+}
+
+/**
+ * sleepPattern.getRecords(limit?) → SleepRecord[]  从新到旧
+ */
+static napi_value GetRecords(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+
+    int32_t limit = 0;
+    if (argc >= 1) napi_get_value_int32(env, args[0], &limit);
+
+    auto records = g_learner.recentRecords(limit > 0 ? static_cast<size_t>(limit) : 0);
+    napi_value arr;
+    napi_create_array_with_length(env, records.size(), &arr);
+    for (size_t i = 0; i < records.size(); i++) {
+        const auto& r = records[i];
+        napi_value obj;
+        napi_create_object(env, &obj);
+        napi_set_named_property(env, obj, "date", CreateString(env, r.date));
+        napi_set_named_property(env, obj, "bedtime", CreateDouble(env, static_cast<double>(r.bedtime)));
+        napi_set_named_property(env, obj, "wakeTime", CreateDouble(env, static_cast<double>(r.wakeTime)));
+        napi_set_named_property(env, obj, "durationMs", CreateDouble(env, static_cast<double>(r.durationMs)));
+        napi_set_named_property(env, obj, "source", CreateString(env, r.source));
+        napi_set_element(env, arr, static_cast<uint32_t>(i), obj);
+    }
+    return arr;
+}
+
+/**
+ * sleepPattern.setUtcOffset(minutes) → void  本地时区偏移，如 480
+ */
+static napi_value SetUtcOffset(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+
+    int32_t minutes = 0;
+    if (argc < 1 || napi_get_value_int32(env, args[0], &minutes) != napi_ok) {
+        napi_throw_error(env, nullptr, "Expected 1 argument: minutes");
+        return nullptr;
+    }
+    g_learner.setUtcOffsetMinutes(minutes);
+    return nullptr;
+}
+
+/**
+ * sleepPattern.save(path, includeLog?) → boolean  includeLog 缺省为 true
+ */
+static napi_value Save(napi_env env, napi_callback_info info) {
+    size_t argc = 2;
+    napi_value args[2];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+
+    if (argc < 1 || !IsType(env, args[0], napi_string)) {
+        napi_throw_error(env, nullptr, "save requires a file path");
+        return nullptr;
+    }
+    bool includeLog = true;
+    if (argc >= 2 && IsType(env, args[1], napi_boolean)) napi_get_value_bool(env, args[1], &includeLog);
+    return CreateBool(env, g_learner.save(GetStringValue(env, args[0]), includeLog));
+}
+
+/**
+ * sleepPattern.load(path) → boolean  文件缺失或损坏时返回 false，现有状态不变
+ */
+static napi_value Load(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+
+    if (argc < 1 || !IsType(env, args[0], napi_string)) {
+        napi_throw_error(env, nullptr, "load requires a file path");
+        return nullptr;
+    }
+    return CreateBool(env, g_learner.load(GetStringValue(env, args[0])));
+}
+
+/**
+ * sleepPattern.clear() → void
+ */
+static napi_value Clear(napi_env env, napi_callback_info info) {
+    g_learner.clear();
+    return nullptr;
+}
+
+// ============================================================
+// Module registration
+// ============================================================
+
+EXTERN_C_START
+
+static napi_value Init(napi_env env, napi_value exports) {
+    napi_property_descriptor desc[] = {
+        {"recordMotion", nullptr, RecordMotion, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"recordSleep", nullptr, RecordSleep, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"getPattern", nullptr, GetPattern, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"getBedtimeReminder", nullptr, GetBedtimeReminder, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"isNearBedtime", nullptr, IsNearBedtime, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"getRecords", nullptr, GetRecords, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"setUtcOffset", nullptr, SetUtcOffset, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"save", nullptr, Save, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"load", nullptr, Load, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"clear", nullptr, Clear, nullptr, nullptr, nullptr, napi_default, nullptr},
+        native_common::MetricsProperty("sleep_pattern"),
+    };
+
+    napi_define_properties(env, exports, sizeof(desc) / sizeof(desc[0]), desc);
+    return exports;
+}
+
+static napi_module sleep_pattern_module = {
+    .nm_version = 1,
+    .nm_flags = NAPI_MODULE_VERSION,
+    .nm_filename = nullptr,
+    .nm_register_func = Init,
+    .nm_modname = "sleep_pattern",
+    .nm_priv = nullptr,
+    .reserved = {0},
+};
+
+EXTERN_C_END
+
+extern "C" __attribute__((constructor)) void RegisterSleepPatternModule(void) {
+    napi_module_register(&sleep_pattern_module);
+}
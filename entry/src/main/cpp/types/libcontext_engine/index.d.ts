@@ -30,12 +30,28 @@
  */
 export const loadRules: (rulesJson: string) => boolean;
 
-/** Add or update a single rule (JSON string). Recompiles tree. */
+/** Add or update a single rule (JSON string). Patches only the affected tree branches. */
 export const addRule: (ruleJson: string) => boolean;
 
-/** Remove a rule by ID. Recompiles tree. */
+/** Remove a rule by ID. Patches only the affected tree branches. */
 export const removeRule: (ruleId: string) => boolean;
 
+/**
+ * Start a bulk edit: loadRules/addRule/removeRule until commitBatch() only update
+ * the rule list and the tree is built once at commit. Calls nest.
+ */
+export const beginBatch: () => void;
+
+/** End a bulk edit; the outermost commit rebuilds the decision tree */
+export const commitBatch: () => void;
+
+/**
+ * Decision tree shape and build timing as JSON string:
+ *   {"nodeCount":N,"leafCount":N,"maxDepth":N,"garbageNodes":N,
+ *    "lastBuildMs":0.12,"lastBuildFull":false,"fullBuilds":N,"patches":N}
+ */
+export const getTreeStats: () => string;
+
 /**
  * Evaluate current context against all rules.
  * @param contextJson - JSON object with key-value pairs, e.g.:
@@ -46,6 +62,43 @@ export const removeRule: (ruleId: string) => boolean;
  */
 export const evaluate: (contextJson: string, maxResults?: number) => string;
 
+/**
+ * Same results as evaluate(), but between calls only rules reading keys whose value changed
+ * (plus rules with time-based conditions) are re-matched. Falls back to a full pass when the
+ * rule set or a decision-tree split key changes.
+ */
+export const evaluateIncremental: (contextJson: string, maxResults?: number) => string;
+
+/** Options for evaluateBatch */
+export interface BatchEvaluateOptions {
+  /** Check cooldowns / rate limits without recording firings (default false: firings are recorded like evaluate()) */
+  dryRun?: boolean;
+  /** Max results per context (default 5) */
+  maxResults?: number;
+  /** Per-context evaluation time, steady-clock ms like pushEvent timestamps (default: now) */
+  timestamps?: Float64Array | number[];
+  /** Dry run only: evaluate contexts on native worker threads (default true) */
+  parallel?: boolean;
+}
+
+/**
+ * Columnar evaluateBatch result. Matches of context i are [offsets[i], offsets[i + 1]),
+ * best first; the three typed arrays are views on one ArrayBuffer.
+ */
+export interface BatchEvaluateResult {
+  offsets: Uint32Array;      // contexts + 1
+  ruleIndex: Uint32Array;    // into ruleIds
+  confidence: Float64Array;
+  ruleIds: string[];         // rules of the snapshot the whole batch ran against
+}
+
+/**
+ * Evaluate many context snapshots in one call (replay / offline tuning).
+ * @param contextsJson - JSON array of context objects as passed to evaluate()
+ * Without dryRun, contexts are evaluated in order and firings recorded at their timestamps.
+ */
+export const evaluateBatch: (contextsJson: string, options?: BatchEvaluateOptions) => BatchEvaluateResult;
+
 /**
  * Update MAB reward for an action (user feedback).
  * @param actionId - The action ID that was shown
@@ -69,5 +122,71 @@ export const loadStats: (statsJson: string) => void;
 /** Get current rule count */
 export const getRuleCount: () => number;
 
+/** JSON array of context keys that enabled rules have conditions on, including "event:..." / "sequence:..." keys */
+export const getReferencedKeys: () => string;
+
 /** Export all rules as JSON string */
 export const exportRules: () => string;
+
+/**
+ * Write rules, MAB stats and LinUCB arms to a binary snapshot file.
+ * Saving again to the same path overwrites only what changed (updated arms,
+ * changed sections) unless arms were added, which rewrites the whole file.
+ * @param path - absolute file path, e.g. `${filesDir}/context_engine.snap`
+ * @returns false if the file could not be written
+ */
+export const saveSnapshot: (path: string) => boolean;
+
+/**
+ * Restore rules, MAB stats and LinUCB arms from a snapshot written by saveSnapshot.
+ * @returns false if the file is missing, from another format version or fails its checksums;
+ *   engine state is then unchanged
+ */
+export const loadSnapshot: (path: string) => boolean;
+
+/**
+ * Size the event buffer behind "recent"/"within" conditions; omitted fields keep their value.
+ * @param configJson - {"maxEvents":100,"maxAgeMs":86400000,"maxContexts":0}
+ *   maxEvents: across all event types, oldest dropped first
+ *   maxAgeMs: events older than this are dropped
+ *   maxContexts: pushEvent context snapshots kept for getEventContext (0 = none)
+ */
+export const configureEvents: (configJson: string) => void;
+
+/** Context JSON pushed with the latest kept event of this type, "" if none is kept */
+export const getEventContext: (eventType: string) => string;
+
+/**
+ * Async evaluate on a native worker thread; resolves with the same JSON as evaluate().
+ * @param taskId - Optional id for cancelAsync(); rejected Error.code is 'CANCELLED' or 'FAILED'
+ */
+export const evaluateAsync: (contextJson: string, maxResults?: number, taskId?: string) => Promise<string>;
+
+/** Cancel a pending/running async task. Returns false if taskId is unknown. */
+export const cancelAsync: (taskId: string) => boolean;
+
+/** Max number of async tasks running at once (default 2); extra tasks are queued. */
+export const setAsyncConcurrency: (n: number) => void;
+
+export interface NativeMetricsHistogram {
+  count: number;
+  totalMs: number;
+  meanMs: number;
+  p50Ms: number;
+  p90Ms: number;
+  p99Ms: number;
+  maxMs: number;
+}
+
+export interface NativeMetrics {
+  module: string;
+  /** false when the native build was configured with -DNATIVE_METRICS=OFF */
+  enabled: boolean;
+  threads: number;
+  histograms: Record<string, NativeMetricsHistogram>;
+  counters: Record<string, number>;
+  gauges: Record<string, { value: number; max: number }>;
+}
+
+/** Latency histograms, counters and gauges recorded in this module since the last reset. */
+export const getMetrics: (options?: { reset?: boolean; log?: boolean }) => NativeMetrics;
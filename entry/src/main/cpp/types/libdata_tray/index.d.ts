@@ -1,14 +1,48 @@
-export const put: (key: string, value: string, quality?: number, source?: string) => void;
+/**
+ * Store a sensor value. Keys are registered on first use and never released; the tray holds
+ * at most 64 distinct keys, and put() with a new key after that returns false and drops the value.
+ */
+export const put: (key: string, value: string | number | boolean, quality?: number, source?: string) => boolean;
 export const get: (key: string) => { value: string | null; quality: number; fresh: boolean; ageMs: number };
 export const getSnapshot: () => {
   timeOfDay: string; hour: string; dayOfWeek: string; isWeekend: string;
   motionState: string; batteryLevel: string; isCharging: string; networkType: string;
-  geofence?: string; latitude?: string; longitude?: string; stepCount?: string;
+  geofence?: string; wifiSsid?: string; wifiLostWork?: string; cellId?: string;
+  latitude?: string; longitude?: string; stepCount?: string;
 };
 export const setTTL: (key: string, ttlMs: number) => void;
 export const getStatus: () => Array<{
   key: string; value: string; ageMs: number; ttlMs: number;
   fresh: boolean; effectiveQuality: number; source: string;
 }>;
+export const setChangeThreshold: (key: string, delta: number) => void;
+export const getEpoch: () => number;
+export const getChangedSince: (epoch: number) => {
+  epoch: number;
+  changes: Array<{ key: string; value: string | null; version: number }>;
+};
 export const clear: () => void;
 export const size: () => number;
+
+export interface NativeMetricsHistogram {
+  count: number;
+  totalMs: number;
+  meanMs: number;
+  p50Ms: number;
+  p90Ms: number;
+  p99Ms: number;
+  maxMs: number;
+}
+
+export interface NativeMetrics {
+  module: string;
+  /** false when the native build was configured with -DNATIVE_METRICS=OFF */
+  enabled: boolean;
+  threads: number;
+  histograms: Record<string, NativeMetricsHistogram>;
+  counters: Record<string, number>;
+  gauges: Record<string, { value: number; max: number }>;
+}
+
+/** Latency histograms, counters and gauges recorded in this module since the last reset. */
+export const getMetrics: (options?: { reset?: boolean; log?: boolean }) => NativeMetrics;
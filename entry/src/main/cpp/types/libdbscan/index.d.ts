@@ -1,7 +1,4 @@
-export const cluster: (
-  points: Array<{ latitude: number; longitude: number; timestamp: number; accuracy: number }>,
-  config?: { epsilonMeters?: number; minSamples?: number }
-) => Array<{
+export interface ClusterResult {
   id: string;
   centerLat: number;
   centerLng: number;
@@ -20,4 +17,78 @@ export const cluster: (
   suggestedCategory: string;
   suggestedName: string;
   confidence: number;
-}>;
+}
+
+export const cluster: (
+  points: Array<{ latitude: number; longitude: number; timestamp: number; accuracy: number }>,
+  config?: { epsilonMeters?: number; minSamples?: number }
+) => ClusterResult[];
+
+export const clusterAsync: (
+  points: Array<{ latitude: number; longitude: number; timestamp: number; accuracy: number }>,
+  config?: { epsilonMeters?: number; minSamples?: number },
+  taskId?: string
+) => Promise<ClusterResult[]>;
+
+export const cancelAsync: (taskId: string) => boolean;
+
+export const setAsyncConcurrency: (n: number) => void;
+
+export const incrementalInit: (config?: { epsilonMeters?: number; minSamples?: number }) => void;
+
+export const incrementalInsert: (
+  points: Array<{ latitude: number; longitude: number; timestamp: number; accuracy: number }>
+) => number;
+
+export const incrementalExpire: (olderThan: number) => number;
+
+export const incrementalSnapshot: () => ClusterResult[];
+
+/**
+ * Packed layouts. Input: stride doubles per point [lat, lng, timestamp(, accuracy)], stride defaults to 3.
+ * Output: packedClusterStride doubles per cluster
+ * [clusterId, centerLat, centerLng, radiusMeters, pointCount, firstSeen, lastSeen, totalStayMs,
+ *  confidence, categoryCode, nightCount, workdayCount, weekendCount, weekdayHourMask, weekendHourMask].
+ * categoryCode: 0 home, 1 work, 2 gym, 3 restaurant, 4 other.
+ */
+export const packedClusterStride: number;
+
+export const clusterPacked: (
+  data: Float64Array | ArrayBuffer,
+  stride?: number,
+  config?: { epsilonMeters?: number; minSamples?: number }
+) => Float64Array;
+
+export const clusterPackedAsync: (
+  data: Float64Array | ArrayBuffer,
+  stride?: number,
+  config?: { epsilonMeters?: number; minSamples?: number },
+  taskId?: string
+) => Promise<Float64Array>;
+
+export const incrementalInsertPacked: (data: Float64Array | ArrayBuffer, stride?: number) => number;
+
+export const incrementalSnapshotPacked: () => Float64Array;
+
+export interface NativeMetricsHistogram {
+  count: number;
+  totalMs: number;
+  meanMs: number;
+  p50Ms: number;
+  p90Ms: number;
+  p99Ms: number;
+  maxMs: number;
+}
+
+export interface NativeMetrics {
+  module: string;
+  /** false when the native build was configured with -DNATIVE_METRICS=OFF */
+  enabled: boolean;
+  threads: number;
+  histograms: Record<string, NativeMetricsHistogram>;
+  counters: Record<string, number>;
+  gauges: Record<string, { value: number; max: number }>;
+}
+
+/** Latency histograms, counters and gauges recorded in this module since the last reset. */
+export const getMetrics: (options?: { reset?: boolean; log?: boolean }) => NativeMetrics;
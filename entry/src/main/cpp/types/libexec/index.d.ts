@@ -1,5 +1,5 @@
 /**
- * Native exec module - runs shell commands via popen().
+ * Native exec module - runs shell commands via posix_spawn().
  */
 
 export interface ExecResult {
@@ -8,9 +8,81 @@ export interface ExecResult {
   exitCode: number;
 }
 
+export interface ExecOptions {
+  /** Kill the command after this many ms (0 / omitted = no limit). */
+  timeoutMs?: number;
+  /** After the timeout signal (SIGTERM), wait this long before SIGKILL. Default 2000. */
+  killGraceMs?: number;
+  /** Working directory. */
+  cwd?: string;
+  /** Merge stderr into stdout (like 2>&1). */
+  mergeStderr?: boolean;
+  /** Collect mode only: per-stream cap, default 64KB. Past it the command gets SIGPIPE. */
+  maxOutputBytes?: number;
+  /** Id for killExec / cancelExec; must be unique among running commands. */
+  taskId?: string;
+}
+
+export interface ExecChunk {
+  stream: 'stdout' | 'stderr';
+  data: string;
+}
+
+export interface AsyncExecResult extends ExecResult {
+  /** Signal that terminated the command, 0 if it exited normally. */
+  signal: number;
+  timedOut: boolean;
+  /** stdoutTruncated || stderrTruncated */
+  truncated: boolean;
+  /** Collect mode: this stream hit maxOutputBytes and was cut there; the command then got SIGPIPE. */
+  stdoutTruncated: boolean;
+  stderrTruncated: boolean;
+  durationMs: number;
+}
+
 /**
- * Execute a shell command and return the result synchronously.
+ * Execute a shell command and return the result synchronously (blocks the calling thread).
+ * stderr is merged into stdout; output is capped at 64KB.
  * @param command - The shell command to execute.
+ * @param timeoutMs - Optional time limit.
  * @returns ExecResult with stdout, stderr, and exitCode.
  */
-export const execCmd: (command: string) => ExecResult;
+export const execCmd: (command: string, timeoutMs?: number) => ExecResult;
+
+/**
+ * Execute a shell command on a worker thread.
+ * With onChunk, output is streamed as it arrives and the result's stdout / stderr are empty;
+ * otherwise output is collected into the result.
+ * Rejects with Error.code CANCELLED after cancelExec(), FAILED if the command cannot be started.
+ */
+export const execAsync: (command: string, options?: ExecOptions,
+  onChunk?: (chunk: ExecChunk) => void) => Promise<AsyncExecResult>;
+
+/** Send a signal (default 15 = SIGTERM) to a running command started with a taskId. */
+export const killExec: (taskId: string, signal?: number) => boolean;
+
+/** Kill a running command started with a taskId and reject its promise with CANCELLED. */
+export const cancelExec: (taskId: string) => boolean;
+
+export interface NativeMetricsHistogram {
+  count: number;
+  totalMs: number;
+  meanMs: number;
+  p50Ms: number;
+  p90Ms: number;
+  p99Ms: number;
+  maxMs: number;
+}
+
+export interface NativeMetrics {
+  module: string;
+  /** false when the native build was configured with -DNATIVE_METRICS=OFF */
+  enabled: boolean;
+  threads: number;
+  histograms: Record<string, NativeMetricsHistogram>;
+  counters: Record<string, number>;
+  gauges: Record<string, { value: number; max: number }>;
+}
+
+/** Latency histograms, counters and gauges recorded in this module since the last reset. */
+export const getMetrics: (options?: { reset?: boolean; log?: boolean }) => NativeMetrics;
@@ -0,0 +1,73 @@
+interface FeedbackAdjustment {
+  key: string;
+  originalValue: number;
+  adjustedValue: number;
+  unit?: string;
+}
+
+interface RulePreference {
+  ruleId: string;
+  preferredHour: number;
+  preferredMinute: number;
+  hourAdjustment: number;
+  confidence: number;
+  usefulCount: number;
+  inaccurateCount: number;
+  dismissCount: number;
+  adjustCount: number;
+  lastFeedbackTime: number;
+}
+
+interface LoggedFeedback {
+  ruleId: string;
+  type: string;
+  timestamp: number;
+  hour: number;
+  adjustment?: FeedbackAdjustment;
+}
+
+interface FeedbackLogStats {
+  logged: number;
+  total: number;
+  rules: number;
+}
+
+export const recordFeedback: (params: {
+  ruleId: string;
+  type: string;
+  timestamp?: number;
+  hour?: number;
+  adjustment?: FeedbackAdjustment;
+}) => void;
+
+export const getPreference: (ruleId: string) => RulePreference | null;
+export const getAdjustedHour: (ruleId: string, originalHour: number) => number;
+export const exportPreferences: () => string;
+export const getRecentFeedback: (limit?: number, ruleId?: string) => LoggedFeedback[];
+export const getStats: () => FeedbackLogStats;
+export const clear: (ruleId?: string) => void;
+export const save: (path: string, includeLog?: boolean) => boolean;
+export const load: (path: string) => boolean;
+
+export interface NativeMetricsHistogram {
+  count: number;
+  totalMs: number;
+  meanMs: number;
+  p50Ms: number;
+  p90Ms: number;
+  p99Ms: number;
+  maxMs: number;
+}
+
+export interface NativeMetrics {
+  module: string;
+  /** false when the native build was configured with -DNATIVE_METRICS=OFF */
+  enabled: boolean;
+  threads: number;
+  histograms: Record<string, NativeMetricsHistogram>;
+  counters: Record<string, number>;
+  gauges: Record<string, { value: number; max: number }>;
+}
+
+/** Latency histograms, counters and gauges recorded in this module since the last reset. */
+export const getMetrics: (options?: { reset?: boolean; log?: boolean }) => NativeMetrics;
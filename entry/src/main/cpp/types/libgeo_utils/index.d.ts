@@ -5,10 +5,52 @@ export const isInsideGeofence: (lat: number, lon: number, geofence: {
 export const getGeofencesAtLocation: (lat: number, lon: number, geofences: Array<{
   id: string; latitude: number; longitude: number; radiusMeters: number;
 }>) => Array<{ geofenceId: string; distance: number; inside: boolean }>;
-export const calculateCenter: (points: Array<{ latitude: number; longitude: number }>) => {
+export const calculateCenter: (
+  points: Array<{ latitude: number; longitude: number }> | Float64Array | ArrayBuffer, stride?: number
+) => {
   latitude: number; longitude: number;
 };
 export const calculateRadius: (
-  points: Array<{ latitude: number; longitude: number }>,
-  centerLat: number, centerLng: number, percentile?: number
+  points: Array<{ latitude: number; longitude: number }> | Float64Array | ArrayBuffer,
+  centerLat: number, centerLng: number, percentile?: number, stride?: number
 ) => number;
+export const getGeofencesAtLocationAsync: (lat: number, lon: number, geofences: Array<{
+  id: string; latitude: number; longitude: number; radiusMeters: number;
+}>, taskId?: string) => Promise<Array<{ geofenceId: string; distance: number; inside: boolean }>>;
+export const cancelAsync: (taskId: string) => boolean;
+export const setAsyncConcurrency: (n: number) => void;
+
+type GeofenceInput = {
+  id: string; name?: string; latitude: number; longitude: number; radiusMeters: number; category?: string;
+};
+type GeofenceMatch = { geofenceId: string; distance: number; inside: boolean };
+export const geofenceIndexSet: (geofences: GeofenceInput[]) => number;
+export const geofenceIndexUpsert: (geofence: GeofenceInput | GeofenceInput[]) => number;
+export const geofenceIndexRemove: (id: string) => boolean;
+export const geofenceIndexClear: () => void;
+export const geofenceIndexSize: () => number;
+export const queryGeofencesNearby: (lat: number, lon: number, marginMeters?: number) => GeofenceMatch[];
+export const queryGeofencesContaining: (lat: number, lon: number) => GeofenceMatch[];
+
+export interface NativeMetricsHistogram {
+  count: number;
+  totalMs: number;
+  meanMs: number;
+  p50Ms: number;
+  p90Ms: number;
+  p99Ms: number;
+  maxMs: number;
+}
+
+export interface NativeMetrics {
+  module: string;
+  /** false when the native build was configured with -DNATIVE_METRICS=OFF */
+  enabled: boolean;
+  threads: number;
+  histograms: Record<string, NativeMetricsHistogram>;
+  counters: Record<string, number>;
+  gauges: Record<string, { value: number; max: number }>;
+}
+
+/** Latency histograms, counters and gauges recorded in this module since the last reset. */
+export const getMetrics: (options?: { reset?: boolean; log?: boolean }) => NativeMetrics;
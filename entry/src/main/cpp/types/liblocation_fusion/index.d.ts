@@ -23,9 +23,61 @@ export const calculateConfidence: (params: {
 }) => FusionResult;
 
 export const calculateAllConfidences: (params: {
-  geofenceDistances: Array<{ id: string; distance: number }>;
+  geofenceDistances: Array<{ id: string; distance: number }> | Array<{ geofenceId: string; distance: number; inside?: boolean }>;
   gpsAccuracy: number;
   currentWifiSsid: string;
   currentBtDevices: string[];
   allSignals: Record<string, LearnedSignals>;
 }) => FusionResult[];
+
+export const calculateAllConfidencesAsync: (params: {
+  geofenceDistances: Array<{ id: string; distance: number }> | Array<{ geofenceId: string; distance: number; inside?: boolean }>;
+  gpsAccuracy: number;
+  currentWifiSsid: string;
+  currentBtDevices: string[];
+  allSignals: Record<string, LearnedSignals>;
+}, taskId?: string) => Promise<FusionResult[]>;
+
+export const cancelAsync: (taskId: string) => boolean;
+
+export const setAsyncConcurrency: (n: number) => void;
+
+type FusionFenceInput = {
+  id: string; name?: string; latitude: number; longitude: number; radiusMeters: number; category?: string;
+};
+export const setFences: (geofences: FusionFenceInput[]) => number;
+export const upsertFence: (geofence: FusionFenceInput) => number;
+export const removeFence: (id: string) => boolean;
+export const setSignals: (geofenceId: string, signals: LearnedSignals) => void;
+export const learnSignal: (params: { geofenceId: string; currentWifiSsid: string; currentBtDevices: string[] }) => void;
+export const clearSignals: (geofenceId?: string) => void;
+export const scan: (params: {
+  latitude?: number;
+  longitude?: number;
+  gpsAccuracy: number;
+  currentWifiSsid: string;
+  currentBtDevices: string[];
+}) => FusionResult[];
+
+export interface NativeMetricsHistogram {
+  count: number;
+  totalMs: number;
+  meanMs: number;
+  p50Ms: number;
+  p90Ms: number;
+  p99Ms: number;
+  maxMs: number;
+}
+
+export interface NativeMetrics {
+  module: string;
+  /** false when the native build was configured with -DNATIVE_METRICS=OFF */
+  enabled: boolean;
+  threads: number;
+  histograms: Record<string, NativeMetricsHistogram>;
+  counters: Record<string, number>;
+  gauges: Record<string, { value: number; max: number }>;
+}
+
+/** Latency histograms, counters and gauges recorded in this module since the last reset. */
+export const getMetrics: (options?: { reset?: boolean; log?: boolean }) => NativeMetrics;
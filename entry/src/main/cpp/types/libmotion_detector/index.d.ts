@@ -0,0 +1,87 @@
+interface MotionFeatures {
+  samples: number;
+  windowSeconds: number;
+  meanMagnitude: number;
+  variance: number;
+  bandEnergy: number;
+  steps: number;
+  cadence: number;
+}
+
+interface MotionResult {
+  state: string;
+  magnitude: number;
+  gpsSpeed: number;
+  confidence: number;
+  stateChanged: boolean;
+  features: MotionFeatures;
+}
+
+export const configure: (config: {
+  sampleRateHz: number;
+  windowSeconds?: number;
+  stationaryThreshold?: number;
+  walkingThreshold?: number;
+  runningThreshold?: number;
+  drivingSpeedThreshold?: number;
+  highSpeedThreshold?: number;
+}) => void;
+
+export const detect: (accel: { x: number; y: number; z: number; timestamp?: number }, gpsSpeed?: number) => MotionResult;
+export const pushBatch: (samples: Float64Array, gpsSpeed?: number, stride?: number) => MotionResult | null;
+export const getFeatures: () => MotionFeatures;
+export const getState: () => string;
+export const reset: () => void;
+
+interface SensorPlan {
+  enabled: boolean;
+  intervalMs: number;
+  dueMs: number;
+  fire: boolean;
+}
+
+interface WakePlan {
+  wakeAtMs: number;
+  wakeInMs: number;
+  accelIntervalNs: number;
+  gps: SensorPlan;
+  wifi: SensorPlan;
+  accel: SensorPlan;
+}
+
+export const planWakeups: (inputs: {
+  nowMs?: number;
+  motionState: string;
+  ruleKeys: string[];
+  freshness: { key: string; ageMs: number; ttlMs: number }[];
+  fenceDistanceMeters?: number;
+  speedMps?: number;
+  gpsAvailable?: boolean;
+  /** New-place discovery is running: GPS stays on at least every 5 minutes even if no rule reads a location key (default false) */
+  placeDiscovery?: boolean;
+  sampled?: string[];
+}) => WakePlan;
+export const resetScheduler: () => void;
+
+export interface NativeMetricsHistogram {
+  count: number;
+  totalMs: number;
+  meanMs: number;
+  p50Ms: number;
+  p90Ms: number;
+  p99Ms: number;
+  maxMs: number;
+}
+
+export interface NativeMetrics {
+  module: string;
+  /** false when the native build was configured with -DNATIVE_METRICS=OFF */
+  enabled: boolean;
+  threads: number;
+  histograms: Record<string, NativeMetricsHistogram>;
+  counters: Record<string, number>;
+  gauges: Record<string, { value: number; max: number }>;
+}
+
+/** Latency histograms, counters and gauges recorded in this module since the last reset. */
+export const getMetrics: (options?: { reset?: boolean; log?: boolean }) => NativeMetrics;
@@ -0,0 +1,62 @@
+interface PlaceScore {
+  placeId: string;
+  score: number;
+  wifiMatch: boolean;
+  cellMatches: number;
+  timeMatch: boolean;
+  hits: number;
+}
+
+interface SignalSummary {
+  wifiList: string[];
+  btList: string[];
+  visitCount: number;
+}
+
+export const learn: (params: {
+  placeId: string;
+  wifiSsid?: string;
+  btDevice?: string;
+  cellId?: string;
+  timestamp?: number;
+  hour?: number;
+}) => boolean;
+
+export const restore: (placeId: string, signals: {
+  wifiSSIDs?: string[];
+  bluetoothDevices?: string[];
+  cellIds?: string[];
+  typicalHours?: number[];
+  lastSeen?: number;
+  visitCount?: number;
+}) => void;
+
+export const findPlacesByWifi: (ssid: string) => string[];
+export const findPlacesByCellId: (cellId: string) => string[];
+export const scorePlaces: (query: { wifiSsid?: string; cellIds?: string[]; hour?: number }, topK?: number) => PlaceScore[];
+export const getSummary: (placeId: string) => SignalSummary;
+export const clear: (placeId?: string) => void;
+export const size: () => number;
+
+export interface NativeMetricsHistogram {
+  count: number;
+  totalMs: number;
+  meanMs: number;
+  p50Ms: number;
+  p90Ms: number;
+  p99Ms: number;
+  maxMs: number;
+}
+
+export interface NativeMetrics {
+  module: string;
+  /** false when the native build was configured with -DNATIVE_METRICS=OFF */
+  enabled: boolean;
+  threads: number;
+  histograms: Record<string, NativeMetricsHistogram>;
+  counters: Record<string, number>;
+  gauges: Record<string, { value: number; max: number }>;
+}
+
+/** Latency histograms, counters and gauges recorded in this module since the last reset. */
+export const getMetrics: (options?: { reset?: boolean; log?: boolean }) => NativeMetrics;
@@ -0,0 +1,57 @@
+interface SleepDayPattern {
+  bedtime: number;
+  wakeTime: number;
+  sampleCount: number;
+}
+
+interface SleepPattern {
+  typicalBedtime: number;
+  typicalWakeTime: number;
+  sleepDurationHours: number;
+  weekdays: SleepDayPattern;
+  weekends: SleepDayPattern;
+  lastUpdated: number;
+  confidence: number;
+}
+
+interface SleepRecord {
+  date: string;
+  bedtime: number;
+  wakeTime: number;
+  durationMs: number;
+  source: string;
+}
+
+export const recordMotion: (snapshot: { state: string; timestamp: number }) => void;
+export const recordSleep: (record: { bedtime: number; wakeTime: number; durationMs?: number; source?: string }) => void;
+export const getPattern: () => SleepPattern;
+export const getBedtimeReminder: () => number;
+export const isNearBedtime: (hour: number, minute: number, marginMinutes?: number) => boolean;
+export const getRecords: (limit?: number) => SleepRecord[];
+export const setUtcOffset: (minutes: number) => void;
+export const save: (path: string, includeLog?: boolean) => boolean;
+export const load: (path: string) => boolean;
+export const clear: () => void;
+
+export interface NativeMetricsHistogram {
+  count: number;
+  totalMs: number;
+  meanMs: number;
+  p50Ms: number;
+  p90Ms: number;
+  p99Ms: number;
+  maxMs: number;
+}
+
+export interface NativeMetrics {
+  module: string;
+  /** false when the native build was configured with -DNATIVE_METRICS=OFF */
+  enabled: boolean;
+  threads: number;
+  histograms: Record<string, NativeMetricsHistogram>;
+  counters: Record<string, number>;
+  gauges: Record<string, { value: number; max: number }>;
+}
+
+/** Latency histograms, counters and gauges recorded in this module since the last reset. */
+export const getMetrics: (options?: { reset?: boolean; log?: boolean }) => NativeMetrics;
@@ -4,11 +4,12 @@
 
 /**
  * Initialize the speaker embedding model.
- * Must be called before extractEmbedding or computeSimilarity.
+ * Must be called before extractEmbedding, computeSimilarity or createStream.
  * @param modelDir - Path to directory containing the ONNX model file
+ * @param numThreads - Inference threads; also the size of the streaming worker pool (default 2)
  * @returns true if initialization succeeded
  */
-export const initModel: (modelDir: string) => boolean;
+export const initModel: (modelDir: string, numThreads?: number) => boolean;
 
 /**
  * Extract a 192-dimensional speaker embedding from PCM audio.
@@ -38,6 +39,62 @@ export const getEmbeddingDim: () => number;
  */
 export const isModelLoaded: () => boolean;
 
+// ===== Streaming Extraction =====
+
+export interface StreamOptions {
+  /** Sample rate of the chunks (default 16000) */
+  sampleRate?: number;
+  /** Analysis window length in ms (default 1500) */
+  windowMs?: number;
+  /** Window advance while speech continues, <= windowMs (default 750) */
+  hopMs?: number;
+}
+
+export interface StreamEmbedding {
+  streamId: number;
+  /** Window sequence number within the stream */
+  segment: number;
+  /** Sample range covered, counted from the stream's first sample */
+  startSample: number;
+  endSample: number;
+  /** Last window of an utterance (queued by inputFinished) */
+  final: boolean;
+  embedding: Float32Array;
+}
+
+/**
+ * Open a streaming extraction session. Every complete window is extracted on a
+ * native worker while audio keeps arriving; windows queued meanwhile are batched
+ * into one inference call.
+ * @param options - Window configuration
+ * @param onResult - Called on the JS thread for each embedding; without it use poll()
+ * @returns Stream id
+ */
+export const createStream: (options?: StreamOptions, onResult?: (result: StreamEmbedding) => void) => number;
+
+/**
+ * Append PCM samples to a stream.
+ * @returns false if the stream does not exist
+ */
+export const acceptWaveform: (streamId: number, chunk: Float32Array) => boolean;
+
+/**
+ * End the current utterance (e.g. on VAD end): queues the final window covering the
+ * last windowMs and resets the stream for the next utterance.
+ * @returns false if the stream does not exist or received no samples since the last call
+ */
+export const inputFinished: (streamId: number) => boolean;
+
+/**
+ * Embeddings ready for a stream created without onResult, ordered by segment.
+ */
+export const poll: (streamId: number) => StreamEmbedding[];
+
+/**
+ * Close a stream. Pending windows are dropped and no further results are delivered.
+ */
+export const destroyStream: (streamId: number) => boolean;
+
 // ===== Speaker Management (Manager API) =====
 
 export interface SpeakerMatch {
@@ -120,3 +177,26 @@ export const exportSpeakerEmbedding: (name: string) => Float32Array | null;
  * @returns true if import succeeded
  */
 export const importSpeakerEmbedding: (name: string, embedding: Float32Array) => boolean;
+
+export interface NativeMetricsHistogram {
+  count: number;
+  totalMs: number;
+  meanMs: number;
+  p50Ms: number;
+  p90Ms: number;
+  p99Ms: number;
+  maxMs: number;
+}
+
+export interface NativeMetrics {
+  module: string;
+  /** false when the native build was configured with -DNATIVE_METRICS=OFF */
+  enabled: boolean;
+  threads: number;
+  histograms: Record<string, NativeMetricsHistogram>;
+  counters: Record<string, number>;
+  gauges: Record<string, { value: number; max: number }>;
+}
+
+/** Latency histograms, counters and gauges recorded in this module since the last reset. */
+export const getMetrics: (options?: { reset?: boolean; log?: boolean }) => NativeMetrics;
@@ -0,0 +1,249 @@
+/**
+ * embedding_stream.cpp — Streaming extraction: windowing, batching worker pool
+ */
+#include "embedding_stream.h"
+#include "common/metrics.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace voiceprint {
+
+// ============================================================
+// EnergyStubExtractor
+// ============================================================
+
+void EnergyStubExtractor::computeBatch(const std::vector<AudioSegment>& segments,
+                                       std::vector<std::vector<float>>& out) {
+    out.resize(segments.size());
+    for (size_t s = 0; s < segments.size(); s++) {
+        const AudioSegment& seg = segments[s];
+        std::vector<float>& embedding = out[s];
+        embedding.assign(dim_, 0.0f);
+        if (seg.length == 0) continue;
+        double energy = 0.0;
+        for (size_t i = 0; i < seg.length; i++) {
+            energy += seg.samples[i] * seg.samples[i];
+        }
+        energy = std::sqrt(energy / seg.length);
+        // Fill with small deterministic values so similarity works
+        for (size_t i = 0; i < dim_; i++) {
+            embedding[i] = static_cast<float>(std::sin(static_cast<double>(i) * 0.1 + energy * 10.0) * 0.5);
+        }
+    }
+}
+
+// ============================================================
+// StreamingExtractor
+// ============================================================
+
+StreamingExtractor::StreamingExtractor(std::shared_ptr<EmbeddingExtractor> extractor, unsigned workers,
+                                       size_t maxBatch)
+    : extractor_(std::move(extractor)), maxBatch_(maxBatch == 0 ? 1 : maxBatch) {
+    if (workers == 0) workers = 1;
+    for (unsigned i = 0; i < workers; i++) {
+        workers_.emplace_back([this] { workerLoop(); });
+    }
+}
+
+StreamingExtractor::~StreamingExtractor() {
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        stopping_ = true;
+        queue_.clear();
+    }
+    workCv_.notify_all();
+    for (auto& t : workers_) {
+        if (t.joinable()) t.join();
+    }
+}
+
+int StreamingExtractor::createStream(const StreamOptions& options, StreamResultSink sink) {
+    auto stream = std::make_shared<Stream>();
+    stream->options = options;
+    if (stream->options.sampleRate <= 0) stream->options.sampleRate = 16000;
+    if (stream->options.windowMs <= 0) stream->options.windowMs = StreamOptions().windowMs;
+    if (stream->options.hopMs <= 0 || stream->options.hopMs > stream->options.windowMs) {
+        stream->options.hopMs = stream->options.windowMs;
+    }
+    const int64_t rate = stream->options.sampleRate;
+    stream->windowSamples = static_cast<size_t>(rate * stream->options.windowMs / 1000);
+    stream->hopSamples = std::max<size_t>(1, static_cast<size_t>(rate * stream->options.hopMs / 1000));
+    stream->sink = std::move(sink);
+
+    std::lock_guard<std::mutex> lock(mu_);
+    stream->id = nextStreamId_++;
+    streams_[stream->id] = stream;
+    return stream->id;
+}
+
+void StreamingExtractor::enqueueLocked(const std::shared_ptr<Stream>& stream, int64_t start, size_t length,
+                                       bool final) {
+    Job job;
+    job.stream = stream;
+    job.segment = stream->nextSegment++;
+    job.startSample = start;
+    job.final = final;
+    auto first = stream->audio.begin() + (start - stream->bufferStart);
+    job.samples.assign(first, first + static_cast<std::ptrdiff_t>(length));
+    queue_.push_back(std::move(job));
+}
+
+bool StreamingExtractor::acceptWaveform(int streamId, const float* samples, size_t length) {
+    size_t queued = 0;
+    {
+        NATIVE_METRICS_LOCK(lock, mu_, "voiceprint.stream_lock_wait");
+        auto it = streams_.find(streamId);
+        if (it == streams_.end()) return false;
+        Stream& s = *it->second;
+        s.audio.insert(s.audio.end(), samples, samples + length);
+
+        const int64_t total = s.bufferStart + static_cast<int64_t>(s.audio.size());
+        const int64_t window = static_cast<int64_t>(s.windowSamples);
+        while (s.nextWindowStart + window <= total) {
+            enqueueLocked(it->second, s.nextWindowStart, s.windowSamples, false);
+            s.nextWindowStart += static_cast<int64_t>(s.hopSamples);
+            queued++;
+        }
+
+        // Keep what the next window and the final window (last windowMs of the utterance) can still need
+        int64_t keepFrom = std::min(s.nextWindowStart, std::max(s.utteranceStart, total - window));
+        if (keepFrom > s.bufferStart) {
+            s.audio.erase(s.audio.begin(), s.audio.begin() + (keepFrom - s.bufferStart));
+            s.bufferStart = keepFrom;
+        }
+    }
+    if (queued == 1) {
+        workCv_.notify_one();
+    } else if (queued > 1) {
+        workCv_.notify_all();
+    }
+    return true;
+}
+
+bool StreamingExtractor::inputFinished(int streamId) {
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        auto it = streams_.find(streamId);
+        if (it == streams_.end()) return false;
+        Stream& s = *it->second;
+        const int64_t total = s.bufferStart + static_cast<int64_t>(s.audio.size());
+        if (total == s.utteranceStart) return false;
+
+        int64_t start = std::max(s.utteranceStart, total - static_cast<int64_t>(s.windowSamples));
+        enqueueLocked(it->second, start, static_cast<size_t>(total - start), true);
+
+        s.audio.clear();
+        s.bufferStart = total;
+        s.nextWindowStart = total;
+        s.utteranceStart = total;
+    }
+    workCv_.notify_one();
+    return true;
+}
+
+std::vector<StreamResult> StreamingExtractor::poll(int streamId) {
+    std::vector<StreamResult> out;
+    std::lock_guard<std::mutex> lock(mu_);
+    auto it = streams_.find(streamId);
+    if (it == streams_.end()) return out;
+    auto& ready = it->second->ready;
+    out.reserve(ready.size());
+    for (auto& r : ready) out.push_back(std::move(r));
+    ready.clear();
+    return out;
+}
+
+bool StreamingExtractor::destroyStream(int streamId) {
+    std::shared_ptr<Stream> stream;
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        auto it = streams_.find(streamId);
+        if (it == streams_.end()) return false;
+        stream = std::move(it->second);
+        streams_.erase(it);
+        stream->closed.store(true, std::memory_order_release);
+        queue_.erase(std::remove_if(queue_.begin(), queue_.end(),
+                                    [&](const Job& job) { return job.stream == stream; }),
+                     queue_.end());
+        if (queue_.empty() && inFlight_ == 0) idleCv_.notify_all();
+    }
+    // The sink (and whatever it owns) is released here, or by the last in-flight job
+    return true;
+}
+
+void StreamingExtractor::flush() {
+    std::unique_lock<std::mutex> lock(mu_);
+    idleCv_.wait(lock, [this] { return queue_.empty() && inFlight_ == 0; });
+}
+
+StreamingStats StreamingExtractor::stats() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return stats_;
+}
+
+void StreamingExtractor::workerLoop() {
+    std::vector<Job> batch;
+    std::vector<AudioSegment> segments;
+    std::vector<std::vector<float>> embeddings;
+    for (;;) {
+        batch.clear();
+        {
+            std::unique_lock<std::mutex> lock(mu_);
+            workCv_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+            if (stopping_) return;
+            while (!queue_.empty() && batch.size() < maxBatch_) {
+                batch.push_back(std::move(queue_.front()));
+                queue_.pop_front();
+            }
+            inFlight_ += batch.size();
+            stats_.segments += batch.size();
+            stats_.batches++;
+            stats_.largestBatch = std::max(stats_.largestBatch, batch.size());
+        }
+
+        segments.clear();
+        for (const Job& job : batch) {
+            segments.push_back({job.samples.data(), job.samples.size(), job.stream->options.sampleRate});
+        }
+        {
+            NATIVE_METRICS_TRACE("voiceprint.extract_batch");
+            extractor_->computeBatch(segments, embeddings);
+        }
+        NATIVE_METRICS_COUNT("voiceprint.segments_extracted", batch.size());
+
+        for (size_t i = 0; i < batch.size(); i++) {
+            Job& job = batch[i];
+            Stream& s = *job.stream;
+            if (s.closed.load(std::memory_order_acquire)) continue;
+
+            StreamResult r;
+            r.streamId = s.id;
+            r.segment = job.segment;
+            r.startSample = job.startSample;
+            r.endSample = job.startSample + static_cast<int64_t>(job.samples.size());
+            r.final = job.final;
+            r.embedding = std::move(embeddings[i]);
+
+            if (s.sink) {
+                s.sink(std::move(r));
+                continue;
+            }
+            // With several workers, batches can finish out of order; keep ready sorted by segment
+            std::lock_guard<std::mutex> lock(mu_);
+            auto pos = std::upper_bound(s.ready.begin(), s.ready.end(), r.segment,
+                                        [](uint32_t seg, const StreamResult& x) { return seg < x.segment; });
+            s.ready.insert(pos, std::move(r));
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            inFlight_ -= batch.size();
+            if (queue_.empty() && inFlight_ == 0) idleCv_.notify_all();
+        }
+        // Jobs hold the last reference to destroyed streams; release it outside the lock
+        batch.clear();
+    }
+}
+
+}  // namespace voiceprint
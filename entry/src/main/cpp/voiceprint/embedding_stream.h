@@ -0,0 +1,190 @@
+/**
+ * embedding_stream.h — Streaming speaker-embedding extraction on native workers.
+ *
+ * A stream takes audio in chunks while the user is still talking. When a full
+ * analysis window has arrived (windowMs, advancing by hopMs), a copy of it is
+ * queued for extraction. inputFinished() queues the final window, which covers
+ * the last windowMs of the utterance, and then resets the stream for the next
+ * utterance. So when speech ends, only one window is still pending, not the
+ * whole clip.
+ *
+ * Worker threads share one reusable extractor. Each wakeup drains up to
+ * maxBatch queued windows, from any stream, into a single computeBatch() call.
+ * Overlapping windows that pile up during an inference are therefore batched
+ * into the next one.
+ * Results go to the stream's sink on the worker thread (the NAPI layer forwards
+ * them through a threadsafe function), or wait in the stream until poll().
+ *
+ * No NAPI dependency; the NAPI binding lives in voiceprint_napi.cpp.
+ */
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace voiceprint {
+
+// ============================================================
+// Extractor
+// ============================================================
+
+/** Read-only view of one audio segment */
+struct AudioSegment {
+    const float* samples;
+    size_t length;
+    int sampleRate;
+};
+
+/**
+ * Speaker-embedding model. computeBatch() may be called from several worker
+ * threads at once and must be thread-safe.
+ */
+class EmbeddingExtractor {
+public:
+    virtual ~EmbeddingExtractor() = default;
+    virtual size_t dim() const = 0;
+    /** out[i] receives the embedding of segments[i] */
+    virtual void computeBatch(const std::vector<AudioSegment>& segments, std::vector<std::vector<float>>& out) = 0;
+};
+
+/**
+ * Stub used until sherpa-onnx is linked: deterministic pseudo-embedding from
+ * the segment's RMS energy (the same values extractEmbedding() always returned).
+ */
+class EnergyStubExtractor : public EmbeddingExtractor {
+public:
+    explicit EnergyStubExtractor(size_t dim) : dim_(dim) {}
+    size_t dim() const override { return dim_; }
+    void computeBatch(const std::vector<AudioSegment>& segments, std::vector<std::vector<float>>& out) override;
+
+private:
+    size_t dim_;
+};
+
+// ============================================================
+// Streams
+// ============================================================
+
+struct StreamOptions {
+    int sampleRate = 16000;
+    /** Analysis window length; 1.5 s is enough for a stable 3D-Speaker embedding */
+    int windowMs = 1500;
+    /** Window advance while speech continues; hop < window makes windows overlap */
+    int hopMs = 750;
+};
+
+struct StreamResult {
+    int streamId = 0;
+    /** Sequence number of the window within the stream (continues across utterances) */
+    uint32_t segment = 0;
+    /** Sample range covered, counted from the stream's first sample */
+    int64_t startSample = 0;
+    int64_t endSample = 0;
+    /** Last window of an utterance (queued by inputFinished) */
+    bool final = false;
+    std::vector<float> embedding;
+};
+
+/** Called on a worker thread; must not block for long */
+using StreamResultSink = std::function<void(StreamResult&&)>;
+
+struct StreamingStats {
+    uint64_t segments = 0;
+    uint64_t batches = 0;
+    size_t largestBatch = 0;
+};
+
+class StreamingExtractor {
+public:
+    static constexpr size_t DEFAULT_MAX_BATCH = 8;
+
+    StreamingExtractor(std::shared_ptr<EmbeddingExtractor> extractor, unsigned workers,
+                       size_t maxBatch = DEFAULT_MAX_BATCH);
+    ~StreamingExtractor();
+
+    StreamingExtractor(const StreamingExtractor&) = delete;
+    StreamingExtractor& operator=(const StreamingExtractor&) = delete;
+
+    /**
+     * Open a stream. With a sink, results are pushed to it; without one they
+     * queue in the stream until poll(). Returns the stream id (> 0).
+     */
+    int createStream(const StreamOptions& options, StreamResultSink sink = nullptr);
+
+    /** Append samples; queues every window that becomes complete. False for an unknown id. */
+    bool acceptWaveform(int streamId, const float* samples, size_t length);
+
+    /**
+     * End the current utterance: queues the final window (the last windowMs, or
+     * everything if shorter) and resets the stream. False for an unknown id or
+     * when no samples arrived since the previous utterance.
+     */
+    bool inputFinished(int streamId);
+
+    /** Results ready for a sink-less stream, ordered by segment */
+    std::vector<StreamResult> poll(int streamId);
+
+    /** Close a stream; its queued windows are dropped and no further results are delivered */
+    bool destroyStream(int streamId);
+
+    /** Block until every queued window has been extracted and delivered */
+    void flush();
+
+    StreamingStats stats() const;
+    size_t workerCount() const { return workers_.size(); }
+    size_t dim() const { return extractor_->dim(); }
+
+private:
+    struct Stream {
+        int id = 0;
+        StreamOptions options;
+        size_t windowSamples = 0;
+        size_t hopSamples = 0;
+        StreamResultSink sink;
+        std::atomic<bool> closed{false};
+        // audio[0] is stream sample `bufferStart`
+        std::vector<float> audio;
+        int64_t bufferStart = 0;
+        int64_t nextWindowStart = 0;
+        int64_t utteranceStart = 0;
+        uint32_t nextSegment = 0;
+        std::deque<StreamResult> ready;
+    };
+
+    struct Job {
+        std::shared_ptr<Stream> stream;
+        uint32_t segment;
+        int64_t startSample;
+        bool final;
+        std::vector<float> samples;
+    };
+
+    void enqueueLocked(const std::shared_ptr<Stream>& stream, int64_t start, size_t length, bool final);
+    void workerLoop();
+
+    std::shared_ptr<EmbeddingExtractor> extractor_;
+    size_t maxBatch_;
+
+    mutable std::mutex mu_;
+    std::condition_variable workCv_;
+    std::condition_variable idleCv_;
+    std::unordered_map<int, std::shared_ptr<Stream>> streams_;
+    std::deque<Job> queue_;
+    size_t inFlight_ = 0;
+    int nextStreamId_ = 1;
+    bool stopping_ = false;
+    StreamingStats stats_;
+
+    std::vector<std::thread> workers_;
+};
+
+}  // namespace voiceprint
@@ -0,0 +1,218 @@
+/**
+ * speaker_gallery.cpp — Contiguous speaker gallery and matrix-vector kernels
+ */
+#include "speaker_gallery.h"
+#include "common/metrics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace voiceprint {
+
+namespace {
+
+// ============================================================
+// Dot-product kernels (n is a multiple of ROW_MULTIPLE, both operands 64-byte aligned)
+// ============================================================
+
+inline float dotScalar(const float* a, const float* b, size_t n) {
+    float acc[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    for (size_t i = 0; i < n; i += 4) {
+        acc[0] += a[i] * b[i];
+        acc[1] += a[i + 1] * b[i + 1];
+        acc[2] += a[i + 2] * b[i + 2];
+        acc[3] += a[i + 3] * b[i + 3];
+    }
+    return (acc[0] + acc[1]) + (acc[2] + acc[3]);
+}
+
+#if defined(SPEAKER_GALLERY_AVX)
+inline float dot(const float* a, const float* b, size_t n) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    for (size_t i = 0; i < n; i += 16) {
+        acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(_mm256_load_ps(a + i), _mm256_load_ps(b + i)));
+        acc1 = _mm256_add_ps(acc1, _mm256_mul_ps(_mm256_load_ps(a + i + 8), _mm256_load_ps(b + i + 8)));
+    }
+    __m256 sum = _mm256_add_ps(acc0, acc1);
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+    return _mm_cvtss_f32(s);
+}
+#elif defined(SPEAKER_GALLERY_SSE2)
+inline float dot(const float* a, const float* b, size_t n) {
+    __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+    __m128 acc2 = _mm_setzero_ps(), acc3 = _mm_setzero_ps();
+    for (size_t i = 0; i < n; i += 16) {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_load_ps(a + i), _mm_load_ps(b + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_load_ps(a + i + 4), _mm_load_ps(b + i + 4)));
+        acc2 = _mm_add_ps(acc2, _mm_mul_ps(_mm_load_ps(a + i + 8), _mm_load_ps(b + i + 8)));
+        acc3 = _mm_add_ps(acc3, _mm_mul_ps(_mm_load_ps(a + i + 12), _mm_load_ps(b + i + 12)));
+    }
+    __m128 s = _mm_add_ps(_mm_add_ps(acc0, acc1), _mm_add_ps(acc2, acc3));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+    return _mm_cvtss_f32(s);
+}
+#elif defined(SPEAKER_GALLERY_NEON)
+inline float dot(const float* a, const float* b, size_t n) {
+    float32x4_t acc0 = vdupq_n_f32(0.0f), acc1 = vdupq_n_f32(0.0f);
+    float32x4_t acc2 = vdupq_n_f32(0.0f), acc3 = vdupq_n_f32(0.0f);
+    for (size_t i = 0; i < n; i += 16) {
+        acc0 = vfmaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+        acc1 = vfmaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+        acc2 = vfmaq_f32(acc2, vld1q_f32(a + i + 8), vld1q_f32(b + i + 8));
+        acc3 = vfmaq_f32(acc3, vld1q_f32(a + i + 12), vld1q_f32(b + i + 12));
+    }
+    return vaddvq_f32(vaddq_f32(vaddq_f32(acc0, acc1), vaddq_f32(acc2, acc3)));
+}
+#else
+inline float dot(const float* a, const float* b, size_t n) { return dotScalar(a, b, n); }
+#endif
+
+// Per-thread scratch for the const scoring paths: concurrent identify() calls never share buffers
+struct QueryScratch {
+    std::vector<float, AlignedAllocator<float, SpeakerGallery::ALIGN_BYTES>> query;
+    std::vector<float> scores;
+    std::vector<size_t> candidates;
+};
+
+QueryScratch& queryScratch() {
+    thread_local QueryScratch scratch;
+    return scratch;
+}
+
+}  // namespace
+
+// ============================================================
+// SpeakerGallery
+// ============================================================
+
+SpeakerGallery::SpeakerGallery(size_t dim)
+    : dim_(dim), stride_((dim + ROW_MULTIPLE - 1) / ROW_MULTIPLE * ROW_MULTIPLE) {}
+
+const char* SpeakerGallery::backend() {
+#if defined(SPEAKER_GALLERY_AVX)
+    return "avx";
+#elif defined(SPEAKER_GALLERY_SSE2)
+    return "sse2";
+#elif defined(SPEAKER_GALLERY_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+float SpeakerGallery::normalizeInto(const float* src, float* dst) const {
+    double sumSq = 0.0;
+    for (size_t i = 0; i < dim_; i++) sumSq += static_cast<double>(src[i]) * src[i];
+    double norm = std::sqrt(sumSq);
+    float inv = norm > 0 ? static_cast<float>(1.0 / norm) : 0.0f;
+    for (size_t i = 0; i < dim_; i++) dst[i] = src[i] * inv;
+    std::fill(dst + dim_, dst + stride_, 0.0f);
+    return static_cast<float>(norm);
+}
+
+const float* SpeakerGallery::prepareQuery(const float* query) const {
+    QueryScratch& scratch = queryScratch();
+    if (scratch.query.size() < stride_) scratch.query.resize(stride_);
+    normalizeInto(query, scratch.query.data());
+    return scratch.query.data();
+}
+
+void SpeakerGallery::add(const std::string& name, const float* embedding) {
+    auto it = index_.find(name);
+    size_t row;
+    if (it != index_.end()) {
+        row = it->second;
+    } else {
+        row = names_.size();
+        rows_.resize((row + 1) * stride_);
+        norms_.push_back(0.0f);
+        names_.push_back(name);
+        index_.emplace(name, row);
+    }
+    norms_[row] = normalizeInto(embedding, rows_.data() + row * stride_);
+}
+
+bool SpeakerGallery::remove(const std::string& name) {
+    auto it = index_.find(name);
+    if (it == index_.end()) return false;
+    size_t row = it->second;
+    size_t last = names_.size() - 1;
+    index_.erase(it);
+    if (row != last) {
+        std::memcpy(rows_.data() + row * stride_, rows_.data() + last * stride_, stride_ * sizeof(float));
+        norms_[row] = norms_[last];
+        names_[row] = std::move(names_[last]);
+        index_[names_[row]] = row;
+    }
+    rows_.resize(last * stride_);
+    norms_.pop_back();
+    names_.pop_back();
+    return true;
+}
+
+void SpeakerGallery::clear() {
+    rows_.clear();
+    norms_.clear();
+    names_.clear();
+    index_.clear();
+}
+
+bool SpeakerGallery::exportEmbedding(const std::string& name, std::vector<float>& out) const {
+    auto it = index_.find(name);
+    if (it == index_.end()) return false;
+    const float* row = rows_.data() + it->second * stride_;
+    float norm = norms_[it->second];
+    out.resize(dim_);
+    for (size_t i = 0; i < dim_; i++) out[i] = row[i] * norm;
+    return true;
+}
+
+void SpeakerGallery::scoreAll(const float* query, std::vector<float>& scores) const {
+    const float* q = prepareQuery(query);
+    size_t n = names_.size();
+    scores.resize(n);
+    const float* row = rows_.data();
+    for (size_t r = 0; r < n; r++, row += stride_) {
+        scores[r] = dot(row, q, stride_);
+    }
+}
+
+void SpeakerGallery::bestMatches(const float* query, double threshold, size_t topK,
+                                 std::vector<SpeakerMatch>& out) const {
+    NATIVE_METRICS_SCOPE("voiceprint.identify");
+    out.clear();
+    if (topK == 0 || names_.empty()) return;
+    QueryScratch& scratch = queryScratch();
+    std::vector<float>& scores = scratch.scores;
+    std::vector<size_t>& candidates = scratch.candidates;
+    scoreAll(query, scores);
+
+    candidates.clear();
+    for (size_t r = 0; r < scores.size(); r++) {
+        if (scores[r] >= threshold) candidates.push_back(r);
+    }
+    auto better = [this, &scores](size_t a, size_t b) {
+        if (scores[a] != scores[b]) return scores[a] > scores[b];
+        return names_[a] < names_[b];
+    };
+    size_t k = std::min(topK, candidates.size());
+    std::partial_sort(candidates.begin(), candidates.begin() + k, candidates.end(), better);
+
+    out.reserve(k);
+    for (size_t i = 0; i < k; i++) {
+        out.push_back({names_[candidates[i]], static_cast<double>(scores[candidates[i]])});
+    }
+}
+
+double SpeakerGallery::similarity(const std::string& name, const float* query) const {
+    auto it = index_.find(name);
+    if (it == index_.end()) return -1.0;
+    return dot(rows_.data() + it->second * stride_, prepareQuery(query), stride_);
+}
+
+}  // namespace voiceprint
@@ -0,0 +1,128 @@
+/**
+ * speaker_gallery.h — Enrolled speaker embeddings as one contiguous matrix.
+ *
+ * Every enrolled speaker is one row of a row-major float matrix. The matrix is
+ * 64-byte aligned and each row is padded to a multiple of 16 floats. Rows are
+ * L2-normalized when a speaker is registered, so cosine similarity against the
+ * whole gallery is a single matrix-vector product. The query is normalized and
+ * padded once, and the scores are then ranked for top-K.
+ *
+ * Kernels match geo_batch.h: NEON on arm64, AVX / SSE2 on x86 (simulator),
+ * scalar elsewhere. Names live in a side array with the same row order.
+ * Removal moves the last row into the hole, so the matrix never has gaps.
+ *
+ * Threading: const methods keep their query / score scratch in thread-local
+ * buffers, so any number of threads may score at once. add / remove / clear
+ * must not run concurrently with anything else.
+ */
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define SPEAKER_GALLERY_AVX 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SPEAKER_GALLERY_SSE2 1
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define SPEAKER_GALLERY_NEON 1
+#endif
+
+namespace voiceprint {
+
+/** Minimal over-aligned allocator so rows start on cache-line boundaries */
+template <typename T, size_t Align>
+struct AlignedAllocator {
+    using value_type = T;
+    template <typename U>
+    struct rebind { using other = AlignedAllocator<U, Align>; };
+
+    AlignedAllocator() = default;
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Align>&) {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(Align)));
+    }
+    void deallocate(T* p, size_t) { ::operator delete(p, std::align_val_t(Align)); }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U, Align>&) const { return true; }
+    template <typename U>
+    bool operator!=(const AlignedAllocator<U, Align>&) const { return false; }
+};
+
+struct SpeakerMatch {
+    std::string name;
+    double score;
+};
+
+class SpeakerGallery {
+public:
+    static constexpr size_t ALIGN_BYTES = 64;
+    static constexpr size_t ROW_MULTIPLE = ALIGN_BYTES / sizeof(float);
+
+    explicit SpeakerGallery(size_t dim);
+
+    /**
+     * Register or replace a speaker. The stored row is L2-normalized. A zero
+     * vector is kept as an all-zero row and scores 0 against every query.
+     */
+    void add(const std::string& name, const float* embedding);
+
+    /** Remove a speaker; the last row is moved into its slot */
+    bool remove(const std::string& name);
+
+    bool contains(const std::string& name) const { return index_.count(name) > 0; }
+    size_t size() const { return names_.size(); }
+    size_t dim() const { return dim_; }
+    void clear();
+
+    /** Names in row order */
+    const std::vector<std::string>& names() const { return names_; }
+
+    /**
+     * Embedding as registered: the normalized row scaled back by its original
+     * norm. Returns false if the speaker is unknown.
+     */
+    bool exportEmbedding(const std::string& name, std::vector<float>& out) const;
+
+    /** Cosine similarity of the query against every row; scores is resized to size() */
+    void scoreAll(const float* query, std::vector<float>& scores) const;
+
+    /**
+     * Up to topK speakers scoring >= threshold, sorted by score descending.
+     * Ties are broken by name so the order does not depend on enrollment order.
+     */
+    void bestMatches(const float* query, double threshold, size_t topK, std::vector<SpeakerMatch>& out) const;
+
+    /** Cosine similarity against one speaker; -1 if the speaker is unknown */
+    double similarity(const std::string& name, const float* query) const;
+
+    /** Kernel chosen at compile time: "avx" / "sse2" / "neon" / "scalar" */
+    static const char* backend();
+
+private:
+    using AlignedFloats = std::vector<float, AlignedAllocator<float, ALIGN_BYTES>>;
+
+    /** Copies the normalized, zero-padded embedding into dst[0, stride_); returns the original norm */
+    float normalizeInto(const float* src, float* dst) const;
+
+    /** Normalized, padded copy of the query in this thread's scratch buffer */
+    const float* prepareQuery(const float* query) const;
+
+    size_t dim_;
+    size_t stride_;
+    AlignedFloats rows_;
+    std::vector<float> norms_;
+    std::vector<std::string> names_;
+    std::unordered_map<std::string, size_t> index_;
+};
+
+}  // namespace voiceprint
@@ -5,12 +5,17 @@
  * Dependencies: sherpa-onnx with ONNX Runtime
  * Model: 3D-Speaker (192-dim embeddings)
  */
+#include <algorithm>
 #include <cmath>
 #include <cstring>
+#include <memory>
 #include <string>
+#include <unordered_set>
 #include <vector>
-#include <map>
 #include <napi/native_api.h>
+#include "embedding_stream.h"
+#include "speaker_gallery.h"
+#include "common/metrics_napi.h"
 
 // TODO: Include sherpa-onnx headers when library is integrated
 // #include "sherpa-onnx/c-api/c-api.h"
@@ -21,12 +26,21 @@ static constexpr int EMBEDDING_DIM = 192;
 // Whether the model has been initialized
 static bool g_initialized = false;
 
+// Extractor shared by extractEmbedding() and the streaming workers (created once, reused)
+static std::shared_ptr<voiceprint::EmbeddingExtractor> g_extractor;
+static std::unique_ptr<voiceprint::StreamingExtractor> g_streaming;
+static constexpr int DEFAULT_NUM_THREADS = 2;
+
+// Streams opened from JS; only touched on the JS thread
+static std::unordered_set<int> g_liveStreams;
+
 // TODO: sherpa-onnx speaker embedding extractor handle
 // static const SherpaOnnxSpeakerEmbeddingExtractor *g_extractor = nullptr;
 // static const SherpaOnnxSpeakerEmbeddingManager *g_manager = nullptr;
 
-// In-memory speaker store (stub for Manager until sherpa-onnx is linked)
-static std::map<std::string, std::vector<float>> g_speakers;
+// In-memory speaker store (stub for Manager until sherpa-onnx is linked).
+// Rows are L2-normalized at registration; identification is one matrix-vector product.
+static voiceprint::SpeakerGallery g_speakers(EMBEDDING_DIM);
 
 // ===== Helper: get string from napi_value =====
 static std::string NapiGetString(napi_env env, napi_value value) {
@@ -77,11 +91,11 @@ static double CosineSimilarity(const float *a, const float *b, int dim) {
 }
 
 /**
- * initModel(modelDir: string): boolean
+ * initModel(modelDir: string, numThreads?: number): boolean
  */
 static napi_value InitModel(napi_env env, napi_callback_info info) {
-    size_t argc = 1;
-    napi_value args[1];
+    size_t argc = 2;
+    napi_value args[2];
     napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
 
     if (argc < 1) {
@@ -90,17 +104,31 @@ static napi_value InitModel(napi_env env, napi_callback_info info) {
     }
 
     std::string modelDir = NapiGetString(env, args[0]);
+    int32_t numThreads = DEFAULT_NUM_THREADS;
+    if (argc > 1) {
+        napi_get_value_int32(env, args[1], &numThreads);
+        if (numThreads < 1) numThreads = 1;
+    }
 
     // TODO: Initialize sherpa-onnx speaker embedding extractor
     // SherpaOnnxSpeakerEmbeddingExtractorConfig config;
     // memset(&config, 0, sizeof(config));
     // config.model = (modelDir + "/3dspeaker_speech_eres2net_base_sv_zh-cn_3dspeaker_16k.onnx").c_str();
-    // config.num_threads = 2;
+    // config.num_threads = numThreads;
     // config.provider = "cpu";
     // g_extractor = SherpaOnnxCreateSpeakerEmbeddingExtractor(&config);
     // int dim = SherpaOnnxSpeakerEmbeddingExtractorDim(g_extractor);
     // g_manager = SherpaOnnxCreateSpeakerEmbeddingManager(dim);
 
+    if (!g_extractor) {
+        g_extractor = std::make_shared<voiceprint::EnergyStubExtractor>(EMBEDDING_DIM);
+    }
+    // Worker pool follows numThreads; only rebuilt while no stream is open
+    if (!g_streaming || (g_liveStreams.empty() && g_streaming->workerCount() != static_cast<size_t>(numThreads))) {
+        g_streaming.reset();
+        g_streaming = std::make_unique<voiceprint::StreamingExtractor>(g_extractor, static_cast<unsigned>(numThreads));
+    }
+
     g_initialized = true; // Stub: always succeed for now
 
     napi_value result;
@@ -143,21 +171,12 @@ static napi_value ExtractEmbedding(napi_env env, napi_callback_info info) {
     // if (!SherpaOnnxSpeakerEmbeddingExtractorIsReady(g_extractor, stream)) { ... }
     // const float *embedding = SherpaOnnxSpeakerEmbeddingExtractorComputeEmbedding(g_extractor, stream);
 
-    // Stub: return deterministic pseudo-embedding based on audio energy
-    std::vector<float> embedding(EMBEDDING_DIM, 0.0f);
-    if (length > 0) {
-        double energy = 0.0;
-        for (size_t i = 0; i < length; i++) {
-            energy += pcmSamples[i] * pcmSamples[i];
-        }
-        energy = std::sqrt(energy / length);
-        // Fill with small deterministic values so similarity works
-        for (int i = 0; i < EMBEDDING_DIM; i++) {
-            embedding[i] = static_cast<float>(std::sin(i * 0.1 + energy * 10.0) * 0.5);
-        }
-    }
+    // Stub: deterministic pseudo-embedding based on audio energy (see EnergyStubExtractor)
+    std::vector<voiceprint::AudioSegment> segments = {{pcmSamples, length, sampleRate}};
+    std::vector<std::vector<float>> embeddings;
+    g_extractor->computeBatch(segments, embeddings);
 
-    return NapiCreateFloat32Array(env, embedding.data(), EMBEDDING_DIM);
+    return NapiCreateFloat32Array(env, embeddings[0].data(), EMBEDDING_DIM);
 }
 
 /**
@@ -212,6 +231,210 @@ static napi_value IsModelLoaded(napi_env env, napi_callback_info info) {
     return result;
 }
 
+// ===== Streaming Extraction =====
+
+static napi_value NapiStreamResult(napi_env env, const voiceprint::StreamResult &r) {
+    napi_value obj;
+    napi_create_object(env, &obj);
+
+    napi_value streamId, segment, startSample, endSample, final;
+    napi_create_int32(env, r.streamId, &streamId);
+    napi_create_uint32(env, r.segment, &segment);
+    napi_create_int64(env, r.startSample, &startSample);
+    napi_create_int64(env, r.endSample, &endSample);
+    napi_get_boolean(env, r.final, &final);
+
+    napi_set_named_property(env, obj, "streamId", streamId);
+    napi_set_named_property(env, obj, "segment", segment);
+    napi_set_named_property(env, obj, "startSample", startSample);
+    napi_set_named_property(env, obj, "endSample", endSample);
+    napi_set_named_property(env, obj, "final", final);
+    napi_set_named_property(env, obj, "embedding",
+        NapiCreateFloat32Array(env, r.embedding.data(), r.embedding.size()));
+    return obj;
+}
+
+// Owns a stream's threadsafe function; released when the stream and its in-flight windows are gone
+struct StreamCallback {
+    napi_threadsafe_function tsfn = nullptr;
+    ~StreamCallback() {
+        if (tsfn) napi_release_threadsafe_function(tsfn, napi_tsfn_release);
+    }
+};
+
+// JS thread: results queued before destroyStream() are dropped here
+static void CallStreamCallback(napi_env env, napi_value jsCallback, void *context, void *data) {
+    std::unique_ptr<voiceprint::StreamResult> r(static_cast<voiceprint::StreamResult *>(data));
+    if (env == nullptr || jsCallback == nullptr || g_liveStreams.count(r->streamId) == 0) return;
+
+    napi_value undefined, arg;
+    napi_get_undefined(env, &undefined);
+    arg = NapiStreamResult(env, *r);
+    napi_call_function(env, undefined, jsCallback, 1, &arg, nullptr);
+}
+
+static bool NapiGetIntProperty(napi_env env, napi_value obj, const char *name, int *out) {
+    bool has = false;
+    if (napi_has_named_property(env, obj, name, &has) != napi_ok || !has) return false;
+    napi_value value;
+    napi_get_named_property(env, obj, name, &value);
+    int32_t v = 0;
+    if (napi_get_value_int32(env, value, &v) != napi_ok) return false;
+    *out = v;
+    return true;
+}
+
+static int32_t NapiGetStreamId(napi_env env, napi_value value) {
+    int32_t id = 0;
+    napi_get_value_int32(env, value, &id);
+    return id;
+}
+
+/**
+ * createStream(options?: StreamOptions, onResult?: (result: StreamEmbedding) => void): number
+ */
+static napi_value CreateStream(napi_env env, napi_callback_info info) {
+    size_t argc = 2;
+    napi_value args[2];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+
+    if (!g_initialized || !g_streaming) {
+        napi_throw_error(env, nullptr, "Model not initialized. Call initModel() first.");
+        return nullptr;
+    }
+
+    voiceprint::StreamOptions options;
+    napi_valuetype type = napi_undefined;
+    if (argc > 0) napi_typeof(env, args[0], &type);
+    if (type == napi_object) {
+        NapiGetIntProperty(env, args[0], "sampleRate", &options.sampleRate);
+        NapiGetIntProperty(env, args[0], "windowMs", &options.windowMs);
+        NapiGetIntProperty(env, args[0], "hopMs", &options.hopMs);
+    }
+
+    voiceprint::StreamResultSink sink;
+    type = napi_undefined;
+    if (argc > 1) napi_typeof(env, args[1], &type);
+    if (type == napi_function) {
+        auto callback = std::make_shared<StreamCallback>();
+        napi_value resourceName;
+        napi_create_string_utf8(env, "voiceprintStream", NAPI_AUTO_LENGTH, &resourceName);
+        if (napi_create_threadsafe_function(env, args[1], nullptr, resourceName, 0, 1, nullptr, nullptr, nullptr,
+                                            CallStreamCallback, &callback->tsfn) != napi_ok) {
+            napi_throw_error(env, nullptr, "Failed to create stream callback");
+            return nullptr;
+        }
+        // Open streams must not keep the event loop alive
+        napi_unref_threadsafe_function(env, callback->tsfn);
+        sink = [callback](voiceprint::StreamResult &&r) {
+            auto *data = new voiceprint::StreamResult(std::move(r));
+            if (napi_call_threadsafe_function(callback->tsfn, data, napi_tsfn_nonblocking) != napi_ok) {
+                delete data;
+            }
+        };
+    }
+
+    int id = g_streaming->createStream(options, std::move(sink));
+    g_liveStreams.insert(id);
+
+    napi_value result;
+    napi_create_int32(env, id, &result);
+    return result;
+}
+
+/**
+ * acceptWaveform(streamId: number, chunk: Float32Array): boolean
+ */
+static napi_value AcceptWaveform(napi_env env, napi_callback_info info) {
+    size_t argc = 2;
+    napi_value args[2];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+
+    if (argc < 2) {
+        napi_throw_error(env, nullptr, "acceptWaveform requires (streamId, chunk: Float32Array)");
+        return nullptr;
+    }
+
+    float *samples = nullptr;
+    size_t length = 0;
+    if (!NapiGetFloat32Array(env, args[1], &samples, &length)) {
+        napi_throw_error(env, nullptr, "chunk must be a Float32Array");
+        return nullptr;
+    }
+
+    bool ok = g_streaming && g_streaming->acceptWaveform(NapiGetStreamId(env, args[0]), samples, length);
+
+    napi_value result;
+    napi_get_boolean(env, ok, &result);
+    return result;
+}
+
+/**
+ * inputFinished(streamId: number): boolean
+ */
+static napi_value InputFinished(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+
+    if (argc < 1) {
+        napi_throw_error(env, nullptr, "inputFinished requires streamId");
+        return nullptr;
+    }
+
+    bool ok = g_streaming && g_streaming->inputFinished(NapiGetStreamId(env, args[0]));
+
+    napi_value result;
+    napi_get_boolean(env, ok, &result);
+    return result;
+}
+
+/**
+ * poll(streamId: number): StreamEmbedding[]
+ */
+static napi_value Poll(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+
+    if (argc < 1) {
+        napi_throw_error(env, nullptr, "poll requires streamId");
+        return nullptr;
+    }
+
+    std::vector<voiceprint::StreamResult> ready;
+    if (g_streaming) ready = g_streaming->poll(NapiGetStreamId(env, args[0]));
+
+    napi_value result;
+    napi_create_array_with_length(env, ready.size(), &result);
+    for (size_t i = 0; i < ready.size(); i++) {
+        napi_set_element(env, result, static_cast<uint32_t>(i), NapiStreamResult(env, ready[i]));
+    }
+    return result;
+}
+
+/**
+ * destroyStream(streamId: number): boolean
+ */
+static napi_value DestroyStream(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+
+    if (argc < 1) {
+        napi_throw_error(env, nullptr, "destroyStream requires streamId");
+        return nullptr;
+    }
+
+    int32_t id = NapiGetStreamId(env, args[0]);
+    g_liveStreams.erase(id);
+    bool ok = g_streaming && g_streaming->destroyStream(id);
+
+    napi_value result;
+    napi_get_boolean(env, ok, &result);
+    return result;
+}
+
 // ===== Speaker Management Functions =====
 
 /**
@@ -269,7 +492,7 @@ static napi_value RegisterSpeaker(napi_env env, napi_callback_info info) {
     }
 
     // TODO: Use SherpaOnnxSpeakerEmbeddingManagerAddListFlattened when sherpa-onnx is linked
-    g_speakers[name] = avgEmb;
+    g_speakers.add(name, avgEmb.data());
 
     napi_value result;
     napi_get_boolean(env, true, &result);
@@ -290,7 +513,7 @@ static napi_value RemoveSpeaker(napi_env env, napi_callback_info info) {
     }
 
     std::string name = NapiGetString(env, args[0]);
-    bool removed = g_speakers.erase(name) > 0;
+    bool removed = g_speakers.remove(name);
 
     napi_value result;
     napi_get_boolean(env, removed, &result);
@@ -301,13 +524,17 @@ static napi_value RemoveSpeaker(napi_env env, napi_callback_info info) {
  * getAllSpeakers(): string[]
  */
 static napi_value GetAllSpeakers(napi_env env, napi_callback_info info) {
+    // Gallery rows are in enrollment order; keep returning names sorted
+    std::vector<std::string> names = g_speakers.names();
+    std::sort(names.begin(), names.end());
+
     napi_value result;
-    napi_create_array_with_length(env, g_speakers.size(), &result);
+    napi_create_array_with_length(env, names.size(), &result);
 
     uint32_t idx = 0;
-    for (auto &pair : g_speakers) {
+    for (auto &name : names) {
         napi_value nameVal;
-        napi_create_string_utf8(env, pair.first.c_str(), pair.first.length(), &nameVal);
+        napi_create_string_utf8(env, name.c_str(), name.length(), &nameVal);
         napi_set_element(env, result, idx++, nameVal);
     }
 
@@ -337,7 +564,7 @@ static napi_value ContainsSpeaker(napi_env env, napi_callback_info info) {
     }
 
     std::string name = NapiGetString(env, args[0]);
-    bool found = g_speakers.find(name) != g_speakers.end();
+    bool found = g_speakers.contains(name);
 
     napi_value result;
     napi_get_boolean(env, found, &result);
@@ -367,16 +594,10 @@ static napi_value IdentifySpeaker(napi_env env, napi_callback_info info) {
     double threshold = 0.5;
     napi_get_value_double(env, args[1], &threshold);
 
-    std::string bestName;
-    double bestScore = -1.0;
-
-    for (auto &pair : g_speakers) {
-        double score = CosineSimilarity(embData, pair.second.data(), EMBEDDING_DIM);
-        if (score >= threshold && score > bestScore) {
-            bestScore = score;
-            bestName = pair.first;
-        }
-    }
+    thread_local std::vector<voiceprint::SpeakerMatch> best;
+    g_speakers.bestMatches(embData, threshold, 1, best);
+    std::string bestName = best.empty() ? std::string() : best[0].name;
+    double bestScore = best.empty() ? -1.0 : best[0].score;
 
     // Create result object { name: string, score: number }
     napi_value result;
@@ -417,23 +638,9 @@ static napi_value GetBestMatches(napi_env env, napi_callback_info info) {
     int32_t topN = 3;
     napi_get_value_int32(env, args[2], &topN);
 
-    // Collect matches above threshold
-    std::vector<std::pair<std::string, double>> matches;
-    for (auto &pair : g_speakers) {
-        double score = CosineSimilarity(embData, pair.second.data(), EMBEDDING_DIM);
-        if (score >= threshold) {
-            matches.push_back({pair.first, score});
-        }
-    }
-
-    // Sort by score descending
-    std::sort(matches.begin(), matches.end(),
-        [](const auto &a, const auto &b) { return a.second > b.second; });
-
-    // Limit to topN
-    if (matches.size() > static_cast<size_t>(topN)) {
-        matches.resize(topN);
-    }
+    // Matches above threshold, top-N by score descending
+    thread_local std::vector<voiceprint::SpeakerMatch> matches;
+    g_speakers.bestMatches(embData, threshold, static_cast<size_t>(topN), matches);
 
     // Create result array
     napi_value result;
@@ -444,8 +651,8 @@ static napi_value GetBestMatches(napi_env env, napi_callback_info info) {
         napi_create_object(env, &obj);
 
         napi_value nameVal, scoreVal;
-        napi_create_string_utf8(env, matches[i].first.c_str(), matches[i].first.length(), &nameVal);
-        napi_create_double(env, matches[i].second, &scoreVal);
+        napi_create_string_utf8(env, matches[i].name.c_str(), matches[i].name.length(), &nameVal);
+        napi_create_double(env, matches[i].score, &scoreVal);
 
         napi_set_named_property(env, obj, "name", nameVal);
         napi_set_named_property(env, obj, "score", scoreVal);
@@ -480,12 +687,7 @@ static napi_value VerifySpeaker(napi_env env, napi_callback_info info) {
     double threshold = 0.6;
     napi_get_value_double(env, args[2], &threshold);
 
-    bool verified = false;
-    auto it = g_speakers.find(name);
-    if (it != g_speakers.end()) {
-        double score = CosineSimilarity(embData, it->second.data(), EMBEDDING_DIM);
-        verified = score >= threshold;
-    }
+    bool verified = g_speakers.contains(name) && g_speakers.similarity(name, embData) >= threshold;
 
     napi_value result;
     napi_get_boolean(env, verified, &result);
@@ -507,14 +709,14 @@ static napi_value ExportSpeakerEmbedding(napi_env env, napi_callback_info info)
 
     std::string name = NapiGetString(env, args[0]);
 
-    auto it = g_speakers.find(name);
-    if (it == g_speakers.end()) {
+    std::vector<float> embedding;
+    if (!g_speakers.exportEmbedding(name, embedding)) {
         napi_value null;
         napi_get_null(env, &null);
         return null;
     }
 
-    return NapiCreateFloat32Array(env, it->second.data(), EMBEDDING_DIM);
+    return NapiCreateFloat32Array(env, embedding.data(), EMBEDDING_DIM);
 }
 
 /**
@@ -540,8 +742,7 @@ static napi_value ImportSpeakerEmbedding(napi_env env, napi_callback_info info)
     }
 
     // Copy embedding into storage
-    std::vector<float> emb(embData, embData + EMBEDDING_DIM);
-    g_speakers[name] = emb;
+    g_speakers.add(name, embData);
 
     napi_value result;
     napi_get_boolean(env, true, &result);
@@ -558,6 +759,12 @@ static napi_value Init(napi_env env, napi_value exports) {
         {"computeSimilarity", nullptr, ComputeSimilarity, nullptr, nullptr, nullptr, napi_default, nullptr},
         {"getEmbeddingDim", nullptr, GetEmbeddingDim, nullptr, nullptr, nullptr, napi_default, nullptr},
         {"isModelLoaded", nullptr, IsModelLoaded, nullptr, nullptr, nullptr, napi_default, nullptr},
+        // Streaming extraction
+        {"createStream", nullptr, CreateStream, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"acceptWaveform", nullptr, AcceptWaveform, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"inputFinished", nullptr, InputFinished, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"poll", nullptr, Poll, nullptr, nullptr, nullptr, napi_default, nullptr},
+        {"destroyStream", nullptr, DestroyStream, nullptr, nullptr, nullptr, napi_default, nullptr},
         // Speaker Management
         {"registerSpeaker", nullptr, RegisterSpeaker, nullptr, nullptr, nullptr, napi_default, nullptr},
         {"removeSpeaker", nullptr, RemoveSpeaker, nullptr, nullptr, nullptr, napi_default, nullptr},
@@ -569,6 +776,7 @@ static napi_value Init(napi_env env, napi_value exports) {
         {"verifySpeaker", nullptr, VerifySpeaker, nullptr, nullptr, nullptr, napi_default, nullptr},
         {"exportSpeakerEmbedding", nullptr, ExportSpeakerEmbedding, nullptr, nullptr, nullptr, napi_default, nullptr},
         {"importSpeakerEmbedding", nullptr, ImportSpeakerEmbedding, nullptr, nullptr, nullptr, napi_default, nullptr},
+        native_common::MetricsProperty("voiceprint"),
     };
     napi_define_properties(env, exports, sizeof(desc) / sizeof(desc[0]), desc);
     return exports;